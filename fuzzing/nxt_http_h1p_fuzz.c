@@ -15,6 +15,9 @@
 extern int LLVMFuzzerInitialize(int *argc, char ***argv);
 extern int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
 
+static void nxt_http_h1p_fuzz_compare(const uint8_t *data, size_t size,
+    nxt_int_t rc, nxt_http_request_parse_t *rp);
+
 
 extern char  **environ;
 
@@ -92,6 +95,9 @@ LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
     }
 
     rc = nxt_http_parse_request(&rp, &buf);
+
+    nxt_http_h1p_fuzz_compare(data, size, rc, &rp);
+
     if (rc != NXT_DONE) {
         goto failed;
     }
@@ -104,3 +110,78 @@ LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
 
     return 0;
 }
+
+
+/*
+ * Parses the input again using the scalar field value lookup and aborts
+ * if the result differs from the one of the CPU specific lookup.
+ */
+
+static void
+nxt_http_h1p_fuzz_compare(const uint8_t *data, size_t size, nxt_int_t rc,
+    nxt_http_request_parse_t *rp)
+{
+    nxt_mp_t                  *mp;
+    nxt_int_t                 scalar_rc;
+    nxt_uint_t                n, features;
+    nxt_buf_mem_t             buf;
+    nxt_http_field_t          *field, *scalar_field;
+    nxt_http_request_parse_t  scalar_rp;
+
+    if (nxt_cpu_features == 0) {
+        return;
+    }
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (mp == NULL) {
+        return;
+    }
+
+    nxt_memzero(&scalar_rp, sizeof(nxt_http_request_parse_t));
+
+    if (nxt_http_parse_request_init(&scalar_rp, mp) != NXT_OK) {
+        goto done;
+    }
+
+    buf.start = (u_char *) data;
+    buf.end = (u_char *) data + size;
+    buf.pos = buf.start;
+    buf.free = buf.end;
+
+    features = nxt_cpu_features;
+    nxt_cpu_features = 0;
+
+    scalar_rc = nxt_http_parse_request(&scalar_rp, &buf);
+
+    nxt_cpu_features = features;
+
+    if (scalar_rc != rc) {
+        abort();
+    }
+
+    if (rc != NXT_DONE) {
+        goto done;
+    }
+
+    if (nxt_list_nelts(rp->fields) != nxt_list_nelts(scalar_rp.fields)) {
+        abort();
+    }
+
+    n = 0;
+
+    nxt_list_each(field, rp->fields) {
+
+        scalar_field = nxt_list_elt(scalar_rp.fields, n++);
+
+        if (field->value != scalar_field->value
+            || field->value_length != scalar_field->value_length)
+        {
+            abort();
+        }
+
+    } nxt_list_loop;
+
+done:
+
+    nxt_mp_destroy(mp);
+}
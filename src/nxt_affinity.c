@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_affinity.h>
+
+#if (NXT_HAVE_LINUX_MEMPOLICY)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+
+#define NXT_NUMA_MASK_BITS  (8 * sizeof(unsigned long))
+
+
+static nxt_int_t nxt_cpu_set_bind(nxt_task_t *task, cpu_set_t *set);
+
+
+nxt_array_t *
+nxt_cpus_parse(nxt_mp_t *mp, const nxt_str_t *list)
+{
+    u_char       *p, *end, *sep, *dash;
+    uint32_t     *cpu;
+    nxt_int_t    first, last;
+    nxt_array_t  *cpus;
+
+    cpus = nxt_array_create(mp, 8, sizeof(uint32_t));
+    if (nxt_slow_path(cpus == NULL)) {
+        return NULL;
+    }
+
+    p = list->start;
+    end = p + list->length;
+
+    for ( ;; ) {
+        sep = memchr(p, ',', end - p);
+        if (sep == NULL) {
+            sep = end;
+        }
+
+        dash = memchr(p, '-', sep - p);
+
+        if (dash == NULL) {
+            first = nxt_int_parse(p, sep - p);
+            last = first;
+
+        } else {
+            first = nxt_int_parse(p, dash - p);
+            last = nxt_int_parse(dash + 1, sep - dash - 1);
+        }
+
+        if (first < 0 || last < first || last >= NXT_CPUS_MAX) {
+            return NULL;
+        }
+
+        while (first <= last) {
+            cpu = nxt_array_add(cpus);
+            if (nxt_slow_path(cpu == NULL)) {
+                return NULL;
+            }
+
+            *cpu = first++;
+        }
+
+        if (sep == end) {
+            return cpus;
+        }
+
+        p = sep + 1;
+    }
+}
+
+
+nxt_int_t
+nxt_cpus_bind(nxt_task_t *task, nxt_array_t *cpus)
+{
+    uint32_t    *cpu;
+    cpu_set_t   set;
+    nxt_uint_t  i;
+
+    CPU_ZERO(&set);
+
+    cpu = cpus->elts;
+
+    for (i = 0; i < cpus->nelts; i++) {
+        CPU_SET(cpu[i], &set);
+    }
+
+    return nxt_cpu_set_bind(task, &set);
+}
+
+
+/*
+ * Binds the calling thread to the CPU, a negative number restores
+ * the affinity of the process main thread.
+ */
+
+nxt_int_t
+nxt_cpu_bind(nxt_task_t *task, nxt_int_t cpu)
+{
+    cpu_set_t  set;
+
+    if (cpu >= 0) {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+    } else if (sched_getaffinity(nxt_pid, sizeof(cpu_set_t), &set) != 0) {
+        nxt_alert(task, "sched_getaffinity(%PI) failed %E", nxt_pid,
+                  nxt_errno);
+        return NXT_ERROR;
+    }
+
+    return nxt_cpu_set_bind(task, &set);
+}
+
+
+static nxt_int_t
+nxt_cpu_set_bind(nxt_task_t *task, cpu_set_t *set)
+{
+    nxt_debug(task, "sched_setaffinity(%d CPUs)", CPU_COUNT(set));
+
+    if (nxt_slow_path(sched_setaffinity(0, sizeof(cpu_set_t), set) != 0)) {
+        nxt_alert(task, "sched_setaffinity() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+nxt_array_t *
+nxt_numa_node_cpus(nxt_task_t *task, nxt_mp_t *mp, nxt_uint_t node)
+{
+    ssize_t      n;
+    nxt_str_t    list;
+    nxt_file_t   file;
+    nxt_array_t  *cpus;
+    u_char       buf[1024], name[64];
+
+    nxt_memzero(&file, sizeof(nxt_file_t));
+
+    (void) nxt_sprintf(name, name + sizeof(name),
+                       "/sys/devices/system/node/node%ui/cpulist%Z", node);
+
+    file.name = name;
+    file.log_level = NXT_LOG_ERR;
+
+    if (nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0)
+        != NXT_OK)
+    {
+        return NULL;
+    }
+
+    n = nxt_file_read(&file, buf, sizeof(buf), 0);
+
+    nxt_file_close(task, &file);
+
+    if (n <= 0) {
+        return NULL;
+    }
+
+    list.start = buf;
+    list.length = n;
+
+    while (list.length != 0 && list.start[list.length - 1] == '\n') {
+        list.length--;
+    }
+
+    cpus = nxt_cpus_parse(mp, &list);
+
+    if (cpus == NULL) {
+        nxt_alert(task, "invalid \"%s\" contents: \"%V\"", name, &list);
+    }
+
+    return cpus;
+}
+
+
+void
+nxt_numa_bind(nxt_task_t *task, nxt_uint_t node)
+{
+#if (NXT_HAVE_LINUX_MEMPOLICY)
+    unsigned long  mask[NXT_NUMA_NODES_MAX / NXT_NUMA_MASK_BITS];
+
+    nxt_memzero(mask, sizeof(mask));
+
+    mask[node / NXT_NUMA_MASK_BITS] = 1UL << (node % NXT_NUMA_MASK_BITS);
+
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                NXT_NUMA_NODES_MAX + 1)
+        != 0)
+    {
+        nxt_log(task, NXT_LOG_WARN, "set_mempolicy(%ui) failed %E",
+                node, nxt_errno);
+    }
+#endif
+}
+
+
+void
+nxt_numa_mem_bind(nxt_task_t *task, void *mem, size_t size, nxt_uint_t node)
+{
+#if (NXT_HAVE_LINUX_MEMPOLICY)
+    unsigned long  mask[NXT_NUMA_NODES_MAX / NXT_NUMA_MASK_BITS];
+
+    nxt_memzero(mask, sizeof(mask));
+
+    mask[node / NXT_NUMA_MASK_BITS] = 1UL << (node % NXT_NUMA_MASK_BITS);
+
+    if (syscall(SYS_mbind, mem, size, MPOL_PREFERRED, mask,
+                NXT_NUMA_NODES_MAX + 1, 0)
+        != 0)
+    {
+        nxt_debug(task, "mbind(%p, %uz, %ui) failed %E",
+                  mem, size, node, nxt_errno);
+    }
+#endif
+}
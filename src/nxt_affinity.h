@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#ifndef _NXT_AFFINITY_H_INCLUDED_
+#define _NXT_AFFINITY_H_INCLUDED_
+
+
+#define NXT_CPUS_MAX        CPU_SETSIZE
+#define NXT_NUMA_NODES_MAX  1024
+
+
+/*
+ * A CPU list has the kernel "cpulist" format, e.g. "0-3,8,10-11".
+ * Returns an array of uint32_t CPU numbers or NULL if the list is invalid.
+ */
+NXT_EXPORT nxt_array_t *nxt_cpus_parse(nxt_mp_t *mp, const nxt_str_t *list);
+
+nxt_int_t nxt_cpus_bind(nxt_task_t *task, nxt_array_t *cpus);
+nxt_int_t nxt_cpu_bind(nxt_task_t *task, nxt_int_t cpu);
+
+nxt_array_t *nxt_numa_node_cpus(nxt_task_t *task, nxt_mp_t *mp,
+    nxt_uint_t node);
+void nxt_numa_bind(nxt_task_t *task, nxt_uint_t node);
+void nxt_numa_mem_bind(nxt_task_t *task, void *mem, size_t size,
+    nxt_uint_t node);
+
+
+#endif /* _NXT_AFFINITY_H_INCLUDED_ */
@@ -162,4 +162,64 @@ nxt_app_nncq_dequeue(nxt_app_nncq_t volatile *q)
 }
 
 
+/*
+ * Dequeues up to "n" consecutive ready entries with a single head update.
+ * Returns the number of entries stored in "vals", 0 if the queue is empty.
+ */
+
+static nxt_app_nncq_atomic_t
+nxt_app_nncq_dequeue_batch(nxt_app_nncq_t volatile *q,
+    nxt_app_nncq_atomic_t *vals, nxt_app_nncq_atomic_t n)
+{
+    nxt_app_nncq_cycle_t   e_cycle, h_cycle;
+    nxt_app_nncq_atomic_t  h, i, j, e;
+
+    for ( ;; ) {
+        h = nxt_app_nncq_head(q);
+
+        for (i = 0; i < n; i++) {
+            j = nxt_app_nncq_map(q, h + i);
+            e = q->entries[j];
+
+            e_cycle = nxt_app_nncq_cycle(q, e);
+            h_cycle = nxt_app_nncq_cycle(q, h + i);
+
+            if (e_cycle != h_cycle) {
+                break;
+            }
+
+            vals[i] = nxt_app_nncq_index(q, e);
+        }
+
+        if (i == 0) {
+            e = q->entries[nxt_app_nncq_map(q, h)];
+
+            if (nxt_app_nncq_next_cycle(q, nxt_app_nncq_cycle(q, e))
+                == nxt_app_nncq_cycle(q, h))
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        if (nxt_atomic_cmp_set(&q->head, h, h + i)) {
+            return i;
+        }
+    }
+}
+
+
+static void
+nxt_app_nncq_enqueue_batch(nxt_app_nncq_t volatile *q,
+    const nxt_app_nncq_atomic_t *vals, nxt_app_nncq_atomic_t n)
+{
+    nxt_app_nncq_atomic_t  i;
+
+    for (i = 0; i < n; i++) {
+        nxt_app_nncq_enqueue(q, vals[i]);
+    }
+}
+
+
 #endif /* _NXT_APP_NNCQ_H_INCLUDED_ */
@@ -14,6 +14,7 @@
 
 #define NXT_APP_QUEUE_SIZE      NXT_APP_NNCQ_SIZE
 #define NXT_APP_QUEUE_MSG_SIZE  31
+#define NXT_APP_QUEUE_BATCH     16
 
 typedef struct {
     uint8_t   size;
@@ -22,11 +23,23 @@ typedef struct {
 } nxt_app_queue_item_t;
 
 
+typedef struct {
+    uint8_t   size;
+    uint8_t   data[NXT_APP_QUEUE_MSG_SIZE];
+    uint32_t  tracking;
+    uint32_t  cookie;
+} nxt_app_queue_msg_t;
+
+
 typedef struct {
     nxt_app_nncq_atomic_t  notified;
     nxt_app_nncq_t         free_items;
     nxt_app_nncq_t         queue;
     nxt_app_queue_item_t   items[NXT_APP_QUEUE_SIZE];
+
+    /* Receives completed by spinning and by waking up, see "spin_wait". */
+    nxt_atomic_t           spins;
+    nxt_atomic_t           wakeups;
 } nxt_app_queue_t;
 
 
@@ -43,6 +56,9 @@ nxt_app_queue_init(nxt_app_queue_t volatile *q)
     }
 
     q->notified = 0;
+
+    q->spins = 0;
+    q->wakeups = 0;
 }
 
 
@@ -78,6 +94,47 @@ nxt_app_queue_send(nxt_app_queue_t volatile *q, const void *p,
 }
 
 
+/*
+ * Enqueues "n" messages and sets the notification flag once for the whole
+ * batch.  Returns the number of messages enqueued, which is less than "n"
+ * only if the queue is full.
+ */
+
+nxt_inline nxt_uint_t
+nxt_app_queue_send_batch(nxt_app_queue_t volatile *q,
+    nxt_app_queue_msg_t *msgs, nxt_uint_t n, int *notify)
+{
+    int                    res;
+    nxt_uint_t             k;
+    nxt_app_queue_item_t   *qi;
+    nxt_app_nncq_atomic_t  i;
+
+    for (k = 0; k < n; k++) {
+        i = nxt_app_nncq_dequeue(&q->free_items);
+        if (i == nxt_app_nncq_empty(&q->free_items)) {
+            break;
+        }
+
+        qi = (nxt_app_queue_item_t *) &q->items[i];
+
+        qi->size = msgs[k].size;
+        nxt_memcpy(qi->data, msgs[k].data, msgs[k].size);
+        qi->tracking = msgs[k].tracking;
+        msgs[k].cookie = i;
+
+        nxt_app_nncq_enqueue(&q->queue, i);
+    }
+
+    res = (k != 0) ? nxt_atomic_cmp_set(&q->notified, 0, 1) : 0;
+
+    if (notify != NULL) {
+        *notify = res;
+    }
+
+    return k;
+}
+
+
 nxt_inline void
 nxt_app_queue_notification_received(nxt_app_queue_t volatile *q)
 {
@@ -122,4 +179,55 @@ nxt_app_queue_recv(nxt_app_queue_t volatile *q, void *p, uint32_t *cookie)
 }
 
 
+/*
+ * Dequeues up to "n" messages, at most NXT_APP_QUEUE_BATCH.  Each message
+ * is claimed as by nxt_app_queue_cancel() before its item is returned to
+ * the free list; messages cancelled by the sender are skipped.  Returns
+ * the number of messages stored in "msgs", 0 if the queue is empty.
+ */
+
+nxt_inline nxt_uint_t
+nxt_app_queue_recv_batch(nxt_app_queue_t volatile *q,
+    nxt_app_queue_msg_t *msgs, nxt_uint_t n)
+{
+    uint32_t               tracking;
+    nxt_uint_t             j, k, m;
+    nxt_app_queue_item_t   *qi;
+    nxt_app_nncq_atomic_t  i, idx[NXT_APP_QUEUE_BATCH];
+
+    n = nxt_min(n, NXT_APP_QUEUE_BATCH);
+
+    do {
+        m = nxt_app_nncq_dequeue_batch(&q->queue, idx, n);
+
+        k = 0;
+
+        for (j = 0; j < m; j++) {
+            i = idx[j];
+            qi = (nxt_app_queue_item_t *) &q->items[i];
+
+            tracking = qi->tracking;
+
+            if (tracking == 0
+                || !nxt_atomic_cmp_set(&qi->tracking, tracking, 0))
+            {
+                continue;
+            }
+
+            msgs[k].size = qi->size;
+            nxt_memcpy(msgs[k].data, qi->data, qi->size);
+            msgs[k].tracking = tracking;
+            msgs[k].cookie = i;
+
+            k++;
+        }
+
+        nxt_app_nncq_enqueue_batch(&q->free_items, idx, m);
+
+    } while (k == 0 && m != 0);
+
+    return k;
+}
+
+
 #endif /* _NXT_APP_QUEUE_H_INCLUDED_ */
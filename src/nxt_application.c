@@ -15,6 +15,9 @@
 #include <nxt_unit.h>
 #include <nxt_port_memory_int.h>
 #include <nxt_isolation.h>
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+#include <nxt_affinity.h>
+#endif
 
 #include <glob.h>
 
@@ -52,6 +55,10 @@ static nxt_app_module_t *nxt_app_module_load(nxt_task_t *task,
     const char *name);
 static nxt_int_t nxt_proto_setup(nxt_task_t *task, nxt_process_t *process);
 static nxt_int_t nxt_proto_start(nxt_task_t *task, nxt_process_data_t *data);
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+static nxt_int_t nxt_proto_affinity(nxt_task_t *task, nxt_process_t *process,
+    nxt_common_app_conf_t *app_conf);
+#endif
 static nxt_int_t nxt_app_setup(nxt_task_t *task, nxt_process_t *process);
 static nxt_int_t nxt_app_set_environment(nxt_conf_value_t *environment);
 static void nxt_proto_start_process_handler(nxt_task_t *task,
@@ -59,7 +66,7 @@ static void nxt_proto_start_process_handler(nxt_task_t *task,
 static void nxt_proto_quit_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
 static void nxt_proto_process_created_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
-static void nxt_proto_quit_children(nxt_task_t *task);
+static void nxt_proto_quit_children(nxt_task_t *task, uint8_t param);
 static nxt_process_t *nxt_proto_process_find(nxt_task_t *task, nxt_pid_t pid);
 static void nxt_proto_process_add(nxt_task_t *task, nxt_process_t *process);
 static nxt_process_t *nxt_proto_process_remove(nxt_task_t *task, nxt_pid_t pid);
@@ -549,6 +556,13 @@ nxt_proto_setup(nxt_task_t *task, nxt_process_t *process)
         return NXT_ERROR;
     }
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    ret = nxt_proto_affinity(task, process, app_conf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return ret;
+    }
+#endif
+
     if (nxt_app->setup != NULL) {
         ret = nxt_app->setup(task, process, app_conf);
         if (nxt_slow_path(ret != NXT_OK)) {
@@ -591,6 +605,52 @@ nxt_proto_setup(nxt_task_t *task, nxt_process_t *process)
 }
 
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+
+/*
+ * Application processes inherit the CPU affinity and the memory policy
+ * of the prototype, so their memory, including port mmaps, is allocated
+ * on the NUMA node.
+ */
+
+static nxt_int_t
+nxt_proto_affinity(nxt_task_t *task, nxt_process_t *process,
+    nxt_common_app_conf_t *app_conf)
+{
+    nxt_array_t  *cpus;
+
+    cpus = NULL;
+
+    if (app_conf->cpus.length != 0) {
+        cpus = nxt_cpus_parse(process->mem_pool, &app_conf->cpus);
+        if (nxt_slow_path(cpus == NULL)) {
+            nxt_alert(task, "invalid \"cpus\" list \"%V\"", &app_conf->cpus);
+            return NXT_ERROR;
+        }
+    }
+
+    if (app_conf->numa_node >= 0) {
+        if (cpus == NULL) {
+            cpus = nxt_numa_node_cpus(task, process->mem_pool,
+                                      app_conf->numa_node);
+            if (nxt_slow_path(cpus == NULL)) {
+                return NXT_ERROR;
+            }
+        }
+
+        nxt_numa_bind(task, app_conf->numa_node);
+    }
+
+    if (cpus == NULL) {
+        return NXT_OK;
+    }
+
+    return nxt_cpus_bind(task, cpus);
+}
+
+#endif
+
+
 static nxt_int_t
 nxt_proto_start(nxt_task_t *task, nxt_process_data_t *data)
 {
@@ -680,9 +740,19 @@ nxt_proto_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 static void
 nxt_proto_quit_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 {
-    nxt_debug(task, "prototype quit handler");
+    uint8_t  param;
+
+    if (msg->size == sizeof(param)) {
+        param = *msg->buf->mem.pos;
+
+    } else {
+        param = NXT_QUIT_NORMAL;
+    }
+
+    nxt_debug(task, "prototype %squit handler",
+              (param == NXT_QUIT_GRACEFUL) ? "graceful " : "");
 
-    nxt_proto_quit_children(task);
+    nxt_proto_quit_children(task, param);
 
     nxt_proto_exiting = 1;
 
@@ -693,7 +763,7 @@ nxt_proto_quit_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
 
 static void
-nxt_proto_quit_children(nxt_task_t *task)
+nxt_proto_quit_children(nxt_task_t *task, uint8_t param)
 {
     nxt_port_t     *port;
     nxt_process_t  *process;
@@ -701,8 +771,7 @@ nxt_proto_quit_children(nxt_task_t *task)
     nxt_queue_each(process, &nxt_proto_children, nxt_process_t, link) {
         port = nxt_process_port_first(process);
 
-        (void) nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT,
-                                     -1, 0, 0, NULL);
+        (void) nxt_port_quit(task, port, param);
     }
     nxt_queue_loop;
 }
@@ -759,7 +828,7 @@ nxt_proto_sigterm_handler(nxt_task_t *task, void *obj, void *data)
     nxt_trace(task, "signal signo:%d (%s) received",
               (int) (uintptr_t) obj, data);
 
-    nxt_proto_quit_children(task);
+    nxt_proto_quit_children(task, NXT_QUIT_NORMAL);
 
     nxt_proto_exiting = 1;
 
@@ -1170,6 +1239,9 @@ nxt_unit_default_init(nxt_task_t *task, nxt_unit_init_t *init,
 
     init->shm_limit = conf->shm_limit;
     init->request_limit = conf->request_limit;
+    init->shm_segment_size = conf->shm_segment_size;
+    init->shm_huge_pages = conf->shm_huge_pages;
+    init->spin_wait = conf->spin_wait;
 
     return NXT_OK;
 }
@@ -131,6 +131,14 @@ struct nxt_common_app_conf_s {
     size_t                     shm_limit;
     uint32_t                   request_limit;
 
+    size_t                     shm_segment_size;
+    uint8_t                    shm_huge_pages;
+
+    uint32_t                   spin_wait;
+
+    nxt_str_t                  cpus;
+    int32_t                    numa_node;
+
     nxt_fd_t                   shared_port_fd;
     nxt_fd_t                   shared_queue_fd;
 
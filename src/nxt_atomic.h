@@ -54,6 +54,12 @@ typedef volatile nxt_atomic_uint_t  nxt_atomic_t;
     __sync_and_and_fetch(ptr, val)
 
 
+/* A load without a barrier of a value changed by other threads. */
+
+#define nxt_atomic_load(ptr)                                                  \
+    __atomic_load_n(ptr, __ATOMIC_RELAXED)
+
+
 #if (__i386__ || __i386 || __amd64__ || __amd64)
 #define nxt_cpu_pause()                                                       \
     __asm__ ("pause")
@@ -71,8 +71,16 @@ nxt_brotli_compress(nxt_http_comp_compressor_ctx_t *ctx, const uint8_t *in_buf,
 }
 
 
+static void
+nxt_brotli_free(nxt_http_comp_compressor_ctx_t *ctx)
+{
+    BrotliEncoderDestroyInstance(ctx->brotli_ctx);
+}
+
+
 const nxt_http_comp_operations_t  nxt_http_comp_brotli_ops = {
     .init               = nxt_brotli_init,
     .bound              = nxt_brotli_bound,
     .deflate            = nxt_brotli_compress,
+    .free               = nxt_brotli_free,
 };
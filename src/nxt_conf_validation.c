@@ -15,6 +15,10 @@
 #include <nxt_http_route_addr.h>
 #include <nxt_http_compression.h>
 #include <nxt_regex.h>
+#include <nxt_port_memory_int.h>
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+#include <nxt_affinity.h>
+#endif
 
 
 typedef enum {
@@ -106,6 +110,10 @@ static nxt_int_t nxt_conf_vldt_tls_cache_size(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_tls_timeout(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_conf_vldt_ocsp_responder(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#endif
 #if (NXT_HAVE_OPENSSL_TLSEXT)
 static nxt_int_t nxt_conf_vldt_ticket_key(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
@@ -137,6 +145,32 @@ static nxt_int_t nxt_conf_vldt_python_prefix(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_listen_threads(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+static nxt_int_t nxt_conf_vldt_cpus(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_numa_node(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#endif
+static nxt_int_t nxt_conf_vldt_shm_segment_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_warm_restart_timeout(
+    nxt_conf_validation_t *vldt, nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_spin_wait(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_warm_restart_address(
+    nxt_conf_validation_t *vldt, nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_warmup_uri(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value);
+static nxt_int_t nxt_conf_vldt_int32_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_max_entries(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_limit(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_limit_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_limit_status(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_threads(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_thread_stack_size(nxt_conf_validation_t *vldt,
@@ -191,6 +225,8 @@ static nxt_int_t nxt_conf_vldt_app(nxt_conf_validation_t *vldt,
     nxt_str_t *name, nxt_conf_value_t *value);
 static nxt_int_t nxt_conf_vldt_object(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_scaling(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_processes(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_object_iterator(nxt_conf_validation_t *vldt,
@@ -221,6 +257,12 @@ static nxt_int_t nxt_conf_vldt_server(nxt_conf_validation_t *vldt,
     nxt_str_t *name, nxt_conf_value_t *value);
 static nxt_int_t nxt_conf_vldt_server_weight(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_upstream_balancer(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_upstream_timeout(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_health_check_uri(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_access_log(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_access_log_format(nxt_conf_validation_t *vldt,
@@ -269,7 +311,11 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_http_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_otel_members[];
 #endif
 static nxt_conf_vldt_object_t  nxt_conf_vldt_websocket_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_keepalive_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_static_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_open_file_cache_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_action_cache_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_action_limit_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_compression_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_compressor_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_forwarded_members[];
@@ -277,6 +323,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_client_ip_members[];
 #if (NXT_TLS)
 static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_session_members[];
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_conf_vldt_object_t  nxt_conf_vldt_ocsp_members[];
+#endif
 #endif
 static nxt_conf_vldt_object_t  nxt_conf_vldt_match_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_python_target_members[];
@@ -287,6 +336,8 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_wasm_access_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_common_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_scaling_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_warm_restart_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_isolation_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_namespaces_members[];
 #if (NXT_HAVE_CGROUP)
@@ -295,6 +346,7 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_cgroup_members[];
 #if (NXT_HAVE_ISOLATION_ROOTFS)
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_automount_members[];
 #endif
+static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_health_check_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_access_log_members[];
 
 
@@ -338,6 +390,13 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_members[] = {
         .name       = nxt_string("listen_threads"),
         .type       = NXT_CONF_VLDT_INTEGER,
         .validator  = nxt_conf_vldt_listen_threads,
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    }, {
+        .name       = nxt_string("listen_cpus"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_cpus,
+        .u.string   = "listen_cpus",
+#endif
     }, {
         .name       = nxt_string("http"),
         .type       = NXT_CONF_VLDT_OBJECT,
@@ -398,6 +457,11 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_http_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_websocket_members,
+    }, {
+        .name       = nxt_string("proxy_keepalive"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_proxy_keepalive_members,
     }, {
         .name       = nxt_string("static"),
         .type       = NXT_CONF_VLDT_OBJECT,
@@ -412,6 +476,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_http_members[] = {
     }, {
         .name       = nxt_string("chunked_transform"),
         .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("body_stream"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     }, {
         .name       = nxt_string("compression"),
         .type       = NXT_CONF_VLDT_OBJECT,
@@ -468,11 +535,61 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_websocket_members[] = {
 };
 
 
+static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_keepalive_members[] = {
+    {
+        .name       = nxt_string("max_idle"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "max_idle",
+    }, {
+        .name       = nxt_string("max_requests"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "max_requests",
+    }, {
+        .name       = nxt_string("idle_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_static_members[] = {
     {
         .name       = nxt_string("mime_types"),
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_mtypes,
+    }, {
+        .name       = nxt_string("open_file_cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_open_file_cache_members,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_open_file_cache_members[] = {
+    {
+        .name       = nxt_string("max_entries"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "max_entries",
+    }, {
+        .name       = nxt_string("valid"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "valid",
+    }, {
+        .name       = nxt_string("min_uses"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "min_uses",
+    }, {
+        .name       = nxt_string("errors"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
     NXT_CONF_VLDT_END
@@ -488,6 +605,18 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_compression_members[] = {
         .name       = nxt_string("compressors"),
         .type       = NXT_CONF_VLDT_OBJECT | NXT_CONF_VLDT_ARRAY,
         .validator  = nxt_conf_vldt_compressors,
+    }, {
+        .name       = nxt_string("cache_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_cache_size,
+    }, {
+        .name       = nxt_string("cache_files"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "cache_files",
+    }, {
+        .name       = nxt_string("precompressed"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
     NXT_CONF_VLDT_END
@@ -535,6 +664,12 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_listener_members[] = {
         .name       = nxt_string("backlog"),
         .type       = NXT_CONF_VLDT_NUMBER,
         .validator  = nxt_conf_vldt_listen_backlog,
+    }, {
+        .name       = nxt_string("http2"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("reuseport"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
 #if (NXT_TLS)
@@ -612,11 +747,46 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_session_members,
+    }, {
+        .name       = nxt_string("ktls"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+#if !(NXT_HAVE_OPENSSL_KTLS)
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ktls",
+#endif
+    }, {
+        .name       = nxt_string("ocsp"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+#if (NXT_HAVE_OPENSSL_OCSP)
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_ocsp_members,
+#else
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ocsp",
+#endif
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_ocsp_members[] = {
+    {
+        .name       = nxt_string("stapling"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("responder"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_ocsp_responder,
     },
 
     NXT_CONF_VLDT_END
 };
 
+#endif
+
 
 static nxt_conf_vldt_object_t  nxt_conf_vldt_session_members[] = {
     {
@@ -677,6 +847,29 @@ nxt_conf_vldt_tls_timeout(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     return NXT_OK;
 }
 
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_int_t
+nxt_conf_vldt_ocsp_responder(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  responder;
+
+    nxt_conf_get_string(value, &responder);
+
+    if (responder.length <= nxt_length("http://")
+        || !nxt_str_start(&responder, "http://", nxt_length("http://")))
+    {
+        return nxt_conf_vldt_error(vldt, "The \"responder\" value must be "
+                                         "an \"http://\" URL.");
+    }
+
+    return NXT_OK;
+}
+
+#endif
+
 #endif
 
 #if (NXT_HAVE_OPENSSL_TLSEXT)
@@ -816,6 +1009,10 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_action_common_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object_iterator,
         .u.object   = nxt_conf_vldt_response_header,
+    }, {
+        .name       = nxt_string("limit"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_limit,
     },
 
     NXT_CONF_VLDT_END
@@ -828,6 +1025,11 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_pass_action_members[] = {
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_pass,
         .flags      = NXT_CONF_VLDT_TSTR,
+    }, {
+        .name       = nxt_string("cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_action_cache_members,
     },
 
     NXT_CONF_VLDT_NEXT(nxt_conf_vldt_action_common_members)
@@ -898,12 +1100,90 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_proxy_action_members[] = {
         .name       = nxt_string("proxy"),
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_proxy,
+    }, {
+        .name       = nxt_string("cache"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_action_cache_members,
     },
 
     NXT_CONF_VLDT_NEXT(nxt_conf_vldt_action_common_members)
 };
 
 
+static nxt_conf_vldt_object_t  nxt_conf_vldt_action_cache_members[] = {
+    {
+        .name       = nxt_string("path"),
+        .type       = NXT_CONF_VLDT_STRING,
+    }, {
+        .name       = nxt_string("key"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .flags      = NXT_CONF_VLDT_TSTR,
+    }, {
+        .name       = nxt_string("valid"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "valid",
+    }, {
+        .name       = nxt_string("max_entries"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_max_entries,
+    }, {
+        .name       = nxt_string("max_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "max_size",
+    }, {
+        .name       = nxt_string("lock_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "lock_timeout",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_action_limit_members[] = {
+    {
+        .name       = nxt_string("zone"),
+        .type       = NXT_CONF_VLDT_STRING,
+    }, {
+        .name       = nxt_string("key"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .flags      = NXT_CONF_VLDT_TSTR | NXT_CONF_VLDT_REQUIRED,
+    }, {
+        .name       = nxt_string("rate"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_limit_number,
+        .u.string   = "rate",
+    }, {
+        .name       = nxt_string("burst"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "burst",
+    }, {
+        .name       = nxt_string("delay"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("connections"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_limit_number,
+        .u.string   = "connections",
+    }, {
+        .name       = nxt_string("status"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_limit_status,
+    }, {
+        .name       = nxt_string("max_entries"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_max_entries,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_external_members[] = {
     {
         .name       = nxt_string("executable"),
@@ -1289,6 +1569,33 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_common_members[] = {
     }, {
         .name       = nxt_string("stderr"),
         .type       = NXT_CONF_VLDT_STRING,
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    }, {
+        .name       = nxt_string("cpus"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_cpus,
+        .u.string   = "cpus",
+    }, {
+        .name       = nxt_string("numa_node"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_numa_node,
+#endif
+    }, {
+        .name       = nxt_string("shm_segment_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_shm_segment_size,
+    }, {
+        .name       = nxt_string("shm_huge_pages"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+    }, {
+        .name       = nxt_string("warm_restart"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_app_warm_restart_members,
+    }, {
+        .name       = nxt_string("spin_wait"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_spin_wait,
     },
 
     NXT_CONF_VLDT_END
@@ -1321,6 +1628,55 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[] = {
     }, {
         .name       = nxt_string("idle_timeout"),
         .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("scaling"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_scaling,
+        .u.members  = nxt_conf_vldt_app_scaling_members,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_scaling_members[] = {
+    {
+        .name       = nxt_string("queue_wait"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("backlog"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("step"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("cooldown"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "cooldown",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_warm_restart_members[] = {
+    {
+        .name       = nxt_string("warmup"),
+        .type       = NXT_CONF_VLDT_ARRAY,
+        .validator  = nxt_conf_vldt_array_iterator,
+        .u.array    = nxt_conf_vldt_warmup_uri,
+    }, {
+        .name       = nxt_string("timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_warm_restart_timeout,
+    }, {
+        .name       = nxt_string("host"),
+        .type       = NXT_CONF_VLDT_STRING,
+    }, {
+        .name       = nxt_string("address"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_warm_restart_address,
     },
 
     NXT_CONF_VLDT_END
@@ -1494,6 +1850,15 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object_iterator,
         .u.object   = nxt_conf_vldt_server,
+    }, {
+        .name       = nxt_string("health_check"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_upstream_health_check_members,
+    }, {
+        .name       = nxt_string("balancer"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_upstream_balancer,
     },
 
     NXT_CONF_VLDT_END
@@ -1505,6 +1870,37 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_server_members[] = {
         .name       = nxt_string("weight"),
         .type       = NXT_CONF_VLDT_NUMBER,
         .validator  = nxt_conf_vldt_server_weight,
+    }, {
+        .name       = nxt_string("max_fails"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "max_fails",
+    }, {
+        .name       = nxt_string("fail_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_timeout,
+        .u.string   = "fail_timeout",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_upstream_health_check_members[] = {
+    {
+        .name       = nxt_string("interval"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_timeout,
+        .u.string   = "interval",
+    }, {
+        .name       = nxt_string("timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_upstream_timeout,
+        .u.string   = "timeout",
+    }, {
+        .name       = nxt_string("uri"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_health_check_uri,
     },
 
     NXT_CONF_VLDT_END
@@ -1523,6 +1919,19 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_access_log_members[] = {
         .name       = nxt_string("if"),
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_if,
+    }, {
+        .name       = nxt_string("buffer"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "buffer",
+    }, {
+        .name       = nxt_string("flush"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_int32_number,
+        .u.string   = "flush",
+    }, {
+        .name       = nxt_string("offload"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
     NXT_CONF_VLDT_END
@@ -2270,6 +2679,245 @@ nxt_conf_vldt_listen_threads(nxt_conf_validation_t *vldt,
 }
 
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+
+static nxt_int_t
+nxt_conf_vldt_cpus(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    nxt_str_t  list;
+
+    nxt_conf_get_string(value, &list);
+
+    if (nxt_cpus_parse(vldt->pool, &list) == NULL) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" value must be a list "
+                                   "of CPU numbers and ranges below %d, "
+                                   "like \"0-3,8\".", data, NXT_CPUS_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_numa_node(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    int64_t  node;
+
+    node = nxt_conf_get_number(value);
+
+    if (node < 0 || node >= NXT_NUMA_NODES_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"numa_node\" number must be "
+                                   "between 0 and %d.",
+                                   NXT_NUMA_NODES_MAX - 1);
+    }
+
+    return NXT_OK;
+}
+
+#endif
+
+
+static nxt_int_t
+nxt_conf_vldt_shm_segment_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  size, min;
+
+    size = nxt_conf_get_number(value);
+    min = nxt_min(1024 * 1024, PORT_MMAP_SIZE);
+
+    if (size < min || size > PORT_MMAP_SIZE) {
+        return nxt_conf_vldt_error(vldt, "The \"shm_segment_size\" value "
+                                   "must be between %L and %L.",
+                                   min, (int64_t) PORT_MMAP_SIZE);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_spin_wait(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    int64_t  spin_wait;
+
+    spin_wait = nxt_conf_get_number(value);
+
+    if (spin_wait < 0 || spin_wait > 10000) {
+        return nxt_conf_vldt_error(vldt, "The \"spin_wait\" value must be "
+                                   "between 0 and 10000.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_warm_restart_timeout(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  timeout;
+
+    timeout = nxt_conf_get_number(value);
+
+    if (timeout < 1 || timeout > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"timeout\" number of "
+                                   "\"warm_restart\" must be between 1 "
+                                   "and %d.", NXT_INT32_T_MAX / 1000);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_warm_restart_address(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t       addr, *ret;
+    nxt_sockaddr_t  *sa;
+
+    ret = nxt_conf_get_string_dup(value, vldt->pool, &addr);
+    if (nxt_slow_path(ret == NULL)) {
+        return NXT_ERROR;
+    }
+
+    sa = nxt_sockaddr_parse(vldt->pool, &addr);
+    if (sa == NULL) {
+        return nxt_conf_vldt_error(vldt, "The \"address\" of "
+                                   "\"warm_restart\" is not valid "
+                                   "socket address.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_warmup_uri(nxt_conf_validation_t *vldt, nxt_conf_value_t *value)
+{
+    nxt_str_t  uri;
+
+    if (nxt_conf_type(value) != NXT_CONF_STRING) {
+        return nxt_conf_vldt_error(vldt, "The \"warmup\" array must "
+                                   "contain only string values.");
+    }
+
+    nxt_conf_get_string(value, &uri);
+
+    if (uri.length == 0 || uri.start[0] != '/') {
+        return nxt_conf_vldt_error(vldt, "The \"warmup\" URIs must start "
+                                   "with \"/\".");
+    }
+
+    if (memchr(uri.start, ' ', uri.length) != NULL
+        || memchr(uri.start, '\r', uri.length) != NULL
+        || memchr(uri.start, '\n', uri.length) != NULL)
+    {
+        return nxt_conf_vldt_error(vldt, "The \"warmup\" URIs must not "
+                                   "contain spaces or line breaks.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_int32_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  number;
+
+    number = nxt_conf_get_number(value);
+
+    if (number < 0 || number > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "0 and %d.", data, NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_max_entries(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  max_entries;
+
+    max_entries = nxt_conf_get_number(value);
+
+    if (max_entries < 1 || max_entries > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"max_entries\" number must be "
+                                   "between 1 and %d.", NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_limit(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    nxt_int_t  ret;
+
+    static const nxt_str_t  rate_str = nxt_string("rate");
+    static const nxt_str_t  connections_str = nxt_string("connections");
+
+    ret = nxt_conf_vldt_object(vldt, value, nxt_conf_vldt_action_limit_members);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    if (nxt_conf_get_object_member(value, &rate_str, NULL) == NULL
+        && nxt_conf_get_object_member(value, &connections_str, NULL) == NULL)
+    {
+        return nxt_conf_vldt_error(vldt, "The \"limit\" object must contain "
+                                   "the \"rate\" or \"connections\" option.");
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_limit_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  number;
+
+    number = nxt_conf_get_number(value);
+
+    if (number < 1 || number > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "1 and %d.", data, NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_limit_status(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  status;
+
+    status = nxt_conf_get_number(value);
+
+    if (status < NXT_HTTP_BAD_REQUEST || status > 599) {
+        return nxt_conf_vldt_error(vldt, "The \"status\" value must be "
+                                   "between 400 and 599.");
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_conf_vldt_threads(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     void *data)
@@ -2328,8 +2976,7 @@ nxt_conf_vldt_compressors(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
 
     /* NXT_CONF_OBJECT */
 
-    return nxt_conf_vldt_object_iterator(vldt, value,
-                                         &nxt_conf_vldt_compressor_members);
+    return nxt_conf_vldt_object(vldt, value, nxt_conf_vldt_compressor_members);
 }
 
 
@@ -3106,6 +3753,34 @@ typedef struct {
 } nxt_conf_vldt_processes_conf_t;
 
 
+typedef struct {
+    int64_t  queue_wait;
+    int64_t  backlog;
+    int64_t  step;
+} nxt_conf_vldt_scaling_conf_t;
+
+
+static nxt_conf_map_t  nxt_conf_vldt_scaling_conf_map[] = {
+    {
+        nxt_string("queue_wait"),
+        NXT_CONF_MAP_INT64,
+        offsetof(nxt_conf_vldt_scaling_conf_t, queue_wait),
+    },
+
+    {
+        nxt_string("backlog"),
+        NXT_CONF_MAP_INT64,
+        offsetof(nxt_conf_vldt_scaling_conf_t, backlog),
+    },
+
+    {
+        nxt_string("step"),
+        NXT_CONF_MAP_INT64,
+        offsetof(nxt_conf_vldt_scaling_conf_t, step),
+    },
+};
+
+
 static nxt_conf_map_t  nxt_conf_vldt_processes_conf_map[] = {
     {
         nxt_string("spare"),
@@ -3207,6 +3882,52 @@ nxt_conf_vldt_processes(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
 }
 
 
+static nxt_int_t
+nxt_conf_vldt_scaling(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    nxt_int_t                     ret;
+    nxt_conf_vldt_scaling_conf_t  scaling;
+
+    ret = nxt_conf_vldt_object(vldt, value, data);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    scaling.queue_wait = 50;
+    scaling.backlog = 2;
+    scaling.step = 1;
+
+    ret = nxt_conf_map_object(vldt->pool, value,
+                              nxt_conf_vldt_scaling_conf_map,
+                              nxt_nitems(nxt_conf_vldt_scaling_conf_map),
+                              &scaling);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    if (scaling.queue_wait < 1
+        || scaling.queue_wait > NXT_INT32_T_MAX / 1000)
+    {
+        return nxt_conf_vldt_error(vldt, "The \"queue_wait\" number must be "
+                                   "between 1 and %d.",
+                                   NXT_INT32_T_MAX / 1000);
+    }
+
+    if (scaling.backlog < 1 || scaling.backlog > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"backlog\" number must be "
+                                   "between 1 and %d.", NXT_INT32_T_MAX);
+    }
+
+    if (scaling.step < 1 || scaling.step > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"step\" number must be "
+                                   "between 1 and %d.", NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_conf_vldt_object_iterator(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data)
@@ -3620,6 +4341,73 @@ nxt_conf_vldt_server_weight(nxt_conf_validation_t *vldt,
 }
 
 
+static nxt_int_t
+nxt_conf_vldt_upstream_balancer(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  balancer;
+
+    static const nxt_str_t  round_robin = nxt_string("round_robin");
+    static const nxt_str_t  least_conn = nxt_string("least_conn");
+    static const nxt_str_t  peak_ewma = nxt_string("peak_ewma");
+
+    nxt_conf_get_string(value, &balancer);
+
+    if (nxt_strstr_eq(&balancer, &round_robin)
+        || nxt_strstr_eq(&balancer, &least_conn)
+        || nxt_strstr_eq(&balancer, &peak_ewma))
+    {
+        return NXT_OK;
+    }
+
+    return nxt_conf_vldt_error(vldt, "The \"balancer\" can either be "
+                               "\"round_robin\", \"least_conn\", or "
+                               "\"peak_ewma\".");
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_upstream_timeout(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  timeout;
+
+    timeout = nxt_conf_get_number(value);
+
+    if (timeout < 1 || timeout > NXT_INT32_T_MAX / 1000) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                   "1 and %d.", data, NXT_INT32_T_MAX / 1000);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_health_check_uri(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    nxt_str_t  uri;
+
+    nxt_conf_get_string(value, &uri);
+
+    if (uri.length == 0 || uri.start[0] != '/') {
+        return nxt_conf_vldt_error(vldt, "The \"uri\" value must start "
+                                   "with \"/\".");
+    }
+
+    if (memchr(uri.start, ' ', uri.length) != NULL
+        || memchr(uri.start, '\r', uri.length) != NULL
+        || memchr(uri.start, '\n', uri.length) != NULL)
+    {
+        return nxt_conf_vldt_error(vldt, "The \"uri\" value must not "
+                                   "contain spaces or line breaks.");
+    }
+
+    return NXT_OK;
+}
+
+
 #if (NXT_HAVE_NJS)
 
 static nxt_int_t
@@ -237,6 +237,8 @@ void nxt_conn_connect_error(nxt_task_t *task, void *obj, void *data);
 
 NXT_EXPORT nxt_listen_event_t *nxt_listen_event(nxt_task_t *task,
     nxt_listen_socket_t *ls);
+NXT_EXPORT nxt_listen_event_t *nxt_listen_event_socket(nxt_task_t *task,
+    nxt_listen_socket_t *ls, nxt_socket_t s);
 void nxt_conn_io_accept(nxt_task_t *task, void *obj, void *data);
 NXT_EXPORT void nxt_conn_accept(nxt_task_t *task, nxt_listen_event_t *lev,
     nxt_conn_t *c);
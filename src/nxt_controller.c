@@ -38,6 +38,10 @@ typedef struct {
     ssize_t           offset;
     nxt_uint_t        line;
     nxt_uint_t        column;
+
+    /* A non-JSON response body and its type. */
+    nxt_str_t         body;
+    nxt_str_t         type;
 } nxt_controller_response_t;
 
 
@@ -119,6 +123,8 @@ static void nxt_controller_conf_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static void nxt_controller_conf_store(nxt_task_t *task,
     nxt_conf_value_t *conf);
+static nxt_buf_t *nxt_controller_json_body(nxt_mp_t *mp,
+    nxt_controller_response_t *resp);
 static void nxt_controller_response(nxt_task_t *task,
     nxt_controller_request_t *req, nxt_controller_response_t *resp);
 static u_char *nxt_controller_date(u_char *buf, nxt_realtime_t *now,
@@ -138,6 +144,7 @@ static nxt_controller_conf_t   nxt_controller_conf;
 static nxt_queue_t             nxt_controller_waiting_requests;
 static nxt_bool_t              nxt_controller_waiting_init_conf;
 static nxt_conf_value_t        *nxt_controller_status;
+static nxt_str_t               nxt_controller_metrics;
 
 
 static const nxt_event_conn_state_t  nxt_controller_conn_read_state;
@@ -614,7 +621,7 @@ nxt_controller_conf_send(nxt_task_t *task, nxt_mp_t *mp, nxt_conf_value_t *conf,
         return NXT_ERROR;
     }
 
-    fd = nxt_shm_open(task, size);
+    fd = nxt_shm_open(task, size, 0);
     if (nxt_slow_path(fd == -1)) {
         return NXT_ERROR;
     }
@@ -943,16 +950,15 @@ static const nxt_event_conn_state_t  nxt_controller_conn_write_state
 static void
 nxt_controller_conn_write(nxt_task_t *task, void *obj, void *data)
 {
-    nxt_buf_t   *b;
     nxt_conn_t  *c;
 
     c = obj;
 
     nxt_debug(task, "controller conn write");
 
-    b = c->write;
+    /* A large response body may remain after the header is sent. */
 
-    if (b->mem.pos != b->mem.free) {
+    if (nxt_buf_chain_length(c->write) != 0) {
         nxt_conn_write(task->thread->engine, c);
         return;
     }
@@ -1624,7 +1630,12 @@ static void
 nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
+    u_char                     *p;
+    size_t                     size;
+    nxt_buf_t                  *b;
+    nxt_int_t                  ret;
     nxt_conf_value_t           *status;
+    nxt_status_report_t        *report;
     nxt_controller_request_t   *req;
     nxt_controller_response_t  resp;
 
@@ -1632,11 +1643,52 @@ nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
     req = data;
 
+    status = NULL;
+
     if (msg->port_msg.type == NXT_PORT_MSG_RPC_READY) {
-        status = nxt_status_get((nxt_status_report_t *) msg->buf->mem.pos,
-                                req->conn->mem_pool);
-    } else {
-        status = NULL;
+        b = msg->buf;
+        size = nxt_buf_chain_length(b);
+
+        /*
+         * A large report is received in several fragments,
+         * so it is copied to one buffer to use the offsets.
+         */
+
+        if (b->next == NULL) {
+            report = (nxt_status_report_t *) b->mem.pos;
+
+        } else {
+            report = nxt_malloc(size);
+
+            if (report != NULL) {
+                p = (u_char *) report;
+
+                do {
+                    if (!nxt_buf_is_sync(b)) {
+                        p = nxt_cpymem(p, b->mem.pos,
+                                       b->mem.free - b->mem.pos);
+                    }
+
+                    b = b->next;
+                } while (b != NULL);
+            }
+        }
+
+        if (report != NULL && size >= sizeof(nxt_status_report_t)) {
+            status = nxt_status_get(report, req->conn->mem_pool);
+
+            if (status != NULL) {
+                ret = nxt_status_metrics(report, req->conn->mem_pool,
+                                         &nxt_controller_metrics);
+                if (nxt_slow_path(ret != NXT_OK)) {
+                    status = NULL;
+                }
+            }
+        }
+
+        if (msg->buf->next != NULL) {
+            nxt_free(report);
+        }
     }
 
     if (status == NULL) {
@@ -1656,6 +1708,7 @@ nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     nxt_controller_flush_requests(task);
 
     nxt_controller_status = NULL;
+    nxt_str_null(&nxt_controller_metrics);
 }
 
 
@@ -1666,10 +1719,20 @@ nxt_controller_status_response(nxt_task_t *task, nxt_controller_request_t *req,
     nxt_conf_value_t           *status;
     nxt_controller_response_t  resp;
 
-    status = nxt_conf_get_path(nxt_controller_status, path);
-
     nxt_memzero(&resp, sizeof(nxt_controller_response_t));
 
+    if (nxt_str_eq(path, "/metrics", 8)) {
+        resp.status = 200;
+        resp.body = nxt_controller_metrics;
+        nxt_str_set(&resp.type, "application/openmetrics-text; "
+                                "version=1.0.0; charset=utf-8");
+
+        nxt_controller_response(task, req, &resp);
+        return;
+    }
+
+    status = nxt_conf_get_path(nxt_controller_status, path);
+
     if (status == NULL) {
         resp.status = 404;
         resp.title = (u_char *) "Invalid path.";
@@ -2456,7 +2519,7 @@ nxt_controller_conf_store(nxt_task_t *task, nxt_conf_value_t *conf)
 
     size = nxt_conf_json_length(conf, NULL);
 
-    fd = nxt_shm_open(task, size);
+    fd = nxt_shm_open(task, size, 0);
     if (nxt_slow_path(fd == -1)) {
         return;
     }
@@ -2496,20 +2559,9 @@ nxt_controller_response(nxt_task_t *task, nxt_controller_request_t *req,
     nxt_controller_response_t *resp)
 {
     size_t                  size;
-    nxt_str_t               status_line, str;
+    nxt_str_t               status_line, type, str;
     nxt_buf_t               *b, *body;
     nxt_conn_t              *c;
-    nxt_uint_t              n;
-    nxt_conf_value_t        *value, *location;
-    nxt_conf_json_pretty_t  pretty;
-
-    static const nxt_str_t  success_str = nxt_string("success");
-    static const nxt_str_t  error_str = nxt_string("error");
-    static const nxt_str_t  detail_str = nxt_string("detail");
-    static const nxt_str_t  location_str = nxt_string("location");
-    static const nxt_str_t  offset_str = nxt_string("offset");
-    static const nxt_str_t  line_str = nxt_string("line");
-    static const nxt_str_t  column_str = nxt_string("column");
 
     static nxt_time_string_t  date_cache = {
         (nxt_atomic_uint_t) -1,
@@ -2544,78 +2596,32 @@ nxt_controller_response(nxt_task_t *task, nxt_controller_request_t *req,
     }
 
     c = req->conn;
-    value = resp->conf;
-
-    if (value == NULL) {
-        n = 1
-            + (resp->detail.length != 0)
-            + (resp->status >= 400 && resp->offset != -1);
-
-        value = nxt_conf_create_object(c->mem_pool, n);
-
-        if (nxt_slow_path(value == NULL)) {
-            nxt_controller_conn_close(task, c, req);
-            return;
-        }
-
-        str.length = nxt_strlen(resp->title);
-        str.start = resp->title;
-
-        if (resp->status < 400) {
-            nxt_conf_set_member_string(value, &success_str, &str, 0);
-
-        } else {
-            nxt_conf_set_member_string(value, &error_str, &str, 0);
-        }
-
-        n = 0;
 
-        if (resp->detail.length != 0) {
-            n++;
+    if (resp->body.start != NULL) {
+        body = nxt_buf_mem_alloc(c->mem_pool, resp->body.length, 0);
 
-            nxt_conf_set_member_string(value, &detail_str, &resp->detail, n);
+        if (nxt_fast_path(body != NULL)) {
+            body->mem.free = nxt_cpymem(body->mem.free, resp->body.start,
+                                        resp->body.length);
         }
 
-        if (resp->status >= 400 && resp->offset != -1) {
-            n++;
-
-            location = nxt_conf_create_object(c->mem_pool,
-                                              resp->line != 0 ? 3 : 1);
-
-            nxt_conf_set_member(value, &location_str, location, n);
-
-            nxt_conf_set_member_integer(location, &offset_str, resp->offset, 0);
+        type = resp->type;
 
-            if (resp->line != 0) {
-                nxt_conf_set_member_integer(location, &line_str,
-                                            resp->line, 1);
+    } else {
+        body = nxt_controller_json_body(c->mem_pool, resp);
 
-                nxt_conf_set_member_integer(location, &column_str,
-                                            resp->column, 2);
-            }
-        }
+        nxt_str_set(&type, "application/json");
     }
 
-    nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
-
-    size = nxt_conf_json_length(value, &pretty) + 2;
-
-    body = nxt_buf_mem_alloc(c->mem_pool, size, 0);
     if (nxt_slow_path(body == NULL)) {
         nxt_controller_conn_close(task, c, req);
         return;
     }
 
-    nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
-
-    body->mem.free = nxt_conf_json_print(body->mem.free, value, &pretty);
-
-    body->mem.free = nxt_cpymem(body->mem.free, "\r\n", 2);
-
     size = nxt_length("HTTP/1.1 " "\r\n") + status_line.length
            + nxt_length("Server: " NXT_SERVER "\r\n")
            + nxt_length("Date: Wed, 31 Dec 1986 16:40:00 GMT\r\n")
-           + nxt_length("Content-Type: application/json\r\n")
+           + nxt_length("Content-Type: \r\n") + type.length
            + nxt_length("Content-Length: " "\r\n") + NXT_SIZE_T_LEN
            + nxt_length("Connection: close\r\n")
            + nxt_length("\r\n");
@@ -2644,7 +2650,12 @@ nxt_controller_response(nxt_task_t *task, nxt_controller_request_t *req,
                                          b->mem.free);
 
     nxt_str_set(&str, "\r\n"
-                      "Content-Type: application/json\r\n"
+                      "Content-Type: ");
+
+    b->mem.free = nxt_cpymem(b->mem.free, str.start, str.length);
+    b->mem.free = nxt_cpymem(b->mem.free, type.start, type.length);
+
+    nxt_str_set(&str, "\r\n"
                       "Content-Length: ");
 
     b->mem.free = nxt_cpymem(b->mem.free, str.start, str.length);
@@ -2665,6 +2676,93 @@ nxt_controller_response(nxt_task_t *task, nxt_controller_request_t *req,
 }
 
 
+static nxt_buf_t *
+nxt_controller_json_body(nxt_mp_t *mp, nxt_controller_response_t *resp)
+{
+    size_t                  size;
+    nxt_str_t               str;
+    nxt_buf_t               *body;
+    nxt_uint_t              n;
+    nxt_conf_value_t        *value, *location;
+    nxt_conf_json_pretty_t  pretty;
+
+    static const nxt_str_t  success_str = nxt_string("success");
+    static const nxt_str_t  error_str = nxt_string("error");
+    static const nxt_str_t  detail_str = nxt_string("detail");
+    static const nxt_str_t  location_str = nxt_string("location");
+    static const nxt_str_t  offset_str = nxt_string("offset");
+    static const nxt_str_t  line_str = nxt_string("line");
+    static const nxt_str_t  column_str = nxt_string("column");
+
+    value = resp->conf;
+
+    if (value == NULL) {
+        n = 1
+            + (resp->detail.length != 0)
+            + (resp->status >= 400 && resp->offset != -1);
+
+        value = nxt_conf_create_object(mp, n);
+
+        if (nxt_slow_path(value == NULL)) {
+            return NULL;
+        }
+
+        str.length = nxt_strlen(resp->title);
+        str.start = resp->title;
+
+        if (resp->status < 400) {
+            nxt_conf_set_member_string(value, &success_str, &str, 0);
+
+        } else {
+            nxt_conf_set_member_string(value, &error_str, &str, 0);
+        }
+
+        n = 0;
+
+        if (resp->detail.length != 0) {
+            n++;
+
+            nxt_conf_set_member_string(value, &detail_str, &resp->detail, n);
+        }
+
+        if (resp->status >= 400 && resp->offset != -1) {
+            n++;
+
+            location = nxt_conf_create_object(mp, resp->line != 0 ? 3 : 1);
+
+            nxt_conf_set_member(value, &location_str, location, n);
+
+            nxt_conf_set_member_integer(location, &offset_str, resp->offset, 0);
+
+            if (resp->line != 0) {
+                nxt_conf_set_member_integer(location, &line_str,
+                                            resp->line, 1);
+
+                nxt_conf_set_member_integer(location, &column_str,
+                                            resp->column, 2);
+            }
+        }
+    }
+
+    nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
+
+    size = nxt_conf_json_length(value, &pretty) + 2;
+
+    body = nxt_buf_mem_alloc(mp, size, 0);
+    if (nxt_slow_path(body == NULL)) {
+        return NULL;
+    }
+
+    nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
+
+    body->mem.free = nxt_conf_json_print(body->mem.free, value, &pretty);
+
+    body->mem.free = nxt_cpymem(body->mem.free, "\r\n", 2);
+
+    return body;
+}
+
+
 static u_char *
 nxt_controller_date(u_char *buf, nxt_realtime_t *now, struct tm *tm,
     size_t size, const char *format)
@@ -225,6 +225,90 @@ extern const nxt_event_interface_t  nxt_epoll_level_engine;
 #endif
 
 
+#if (NXT_HAVE_IO_URING)
+
+typedef struct nxt_io_uring_send_s  nxt_io_uring_send_t;
+
+typedef struct {
+    nxt_fd_event_t                *event;
+    uint32_t                      seq;
+    uint8_t                       accept;        /* 1 bit */
+
+    uint8_t                       recv_pending;  /* 1 bit */
+    uint8_t                       recv_data;     /* 1 bit */
+    uint8_t                       recv_eof;      /* 1 bit */
+    uint16_t                      recv_buf;
+    uint32_t                      recv_pos;
+    uint32_t                      recv_size;
+    nxt_err_t                     recv_error;
+
+    /* The connection socket using provided buffers and batched sends. */
+    nxt_fd_event_t                *conn;
+    uint32_t                      conn_seq;
+
+    nxt_io_uring_send_t           *send;
+} nxt_io_uring_fd_t;
+
+
+typedef struct {
+    int                           fd;
+    int                           epoll;
+    uint32_t                      mode;
+    nxt_uint_t                    nchanges;
+    nxt_uint_t                    mchanges;
+    int                           mevents;
+
+    uint8_t                       error;        /* 1 bit */
+    uint8_t                       polling;      /* 1 bit */
+    uint8_t                       ready;        /* 1 bit */
+    uint8_t                       epoll_ctl;    /* 1 bit */
+    uint8_t                       accept;       /* 1 bit */
+    uint8_t                       skip_success; /* 1 bit */
+    uint8_t                       send;         /* 1 bit */
+
+    nxt_epoll_change_t            *changes;
+    struct epoll_event            *events;
+
+    nxt_io_uring_fd_t             *fds;
+    uint32_t                      nfds;
+
+    void                          *ring;
+    size_t                        ring_size;
+    struct io_uring_sqe           *sqes;
+    size_t                        sqes_size;
+    struct epoll_event            *sq_events;
+
+    uint32_t                      *sq_head;
+    uint32_t                      *sq_tail;
+    uint32_t                      sq_mask;
+    uint32_t                      sq_entries;
+    uint32_t                      sq_next;
+
+    uint32_t                      *cq_head;
+    uint32_t                      *cq_tail;
+    uint32_t                      cq_mask;
+    struct io_uring_cqe           *cqes;
+
+    struct io_uring_buf_ring      *buf_ring;
+    u_char                        *bufs;
+    size_t                        bufs_size;
+    uint16_t                      buf_tail;
+
+    nxt_work_handler_t            post_handler;
+    nxt_fd_event_t                eventfd;
+    uint32_t                      neventfd;
+
+    nxt_fd_event_t                signalfd;
+} nxt_io_uring_engine_t;
+
+
+extern const nxt_event_interface_t  nxt_io_uring_engine;
+
+nxt_int_t nxt_io_uring_test(nxt_task_t *task);
+
+#endif
+
+
 #if (NXT_HAVE_EVENTPORT)
 
 typedef struct {
@@ -429,6 +513,9 @@ struct nxt_event_engine_s {
 #if (NXT_HAVE_EPOLL)
         nxt_epoll_engine_t     epoll;
 #endif
+#if (NXT_HAVE_IO_URING)
+        nxt_io_uring_engine_t  io_uring;
+#endif
 #if (NXT_HAVE_EVENTPORT)
         nxt_eventport_engine_t eventport;
 #endif
@@ -481,6 +568,18 @@ struct nxt_event_engine_s {
     nxt_queue_t                joints;
     nxt_queue_t                listen_connections;
     nxt_queue_t                idle_connections;
+    /* Idle keep-alive connections to upstream servers, by address. */
+    nxt_lvlhsh_t               peer_pools;
+    /* Requests waiting for an acknowledgement from an application. */
+    nxt_queue_t                app_requests;
+    /* Application ports known to the engine, by pid and port id. */
+    nxt_lvlhsh_t               app_ports;
+    /* Buffered access log records of the router. */
+    struct nxt_router_access_log_buffer_s  *access_log_buffer;
+    /* Request metrics of the router. */
+    struct nxt_router_metric_s  *metrics;
+    nxt_lvlhsh_t               metrics_hash;
+    uint32_t                   metrics_count;
     nxt_array_t                *mem_cache;
 
     nxt_atomic_uint_t          accepted_conns_cnt;
@@ -124,14 +124,17 @@ nxt_external_start(nxt_task_t *task, nxt_process_data_t *data)
                     "%PI,%ud,%d;"
                     "%PI,%ud,%d,%d;"
                     "%d,%d;"
-                    "%d,%z,%uD,%Z",
+                    "%d,%z,%uD;"
+                    "%z,%d,%uD,%Z",
                     NXT_VERSION, my_port->process->stream,
                     proto_port->pid, proto_port->id, proto_port->pair[1],
                     router_port->pid, router_port->id, router_port->pair[1],
                     my_port->pid, my_port->id, my_port->pair[0],
                                                my_port->pair[1],
                     conf->shared_port_fd, conf->shared_queue_fd,
-                    2, conf->shm_limit, conf->request_limit);
+                    2, conf->shm_limit, conf->request_limit,
+                    conf->shm_segment_size, (int) conf->shm_huge_pages,
+                    conf->spin_wait);
 
     if (nxt_slow_path(p == end)) {
         nxt_alert(task, "internal error: buffer too small for NXT_UNIT_INIT");
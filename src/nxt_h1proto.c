@@ -8,6 +8,7 @@
 #include <nxt_http.h>
 #include <nxt_upstream.h>
 #include <nxt_h1proto.h>
+#include <nxt_h2proto.h>
 #include <nxt_websocket.h>
 #include <nxt_websocket_header.h>
 
@@ -18,6 +19,21 @@
  * nxt_h1p_request_ prefix is used for HTTP/1 protocol request methods.
  */
 
+
+/* The nxt_h1proto_t.peer_retry values. */
+#define NXT_H1P_PEER_RETRY_SEND  1
+#define NXT_H1P_PEER_RETRY_READ  2
+
+
+/* Idle keep-alive connections to an upstream server. */
+struct nxt_h1p_peer_pool_s {
+    nxt_queue_t               connections;
+    nxt_uint_t                nidle;
+    /* The struct sockaddr of the server. */
+    nxt_str_t                 key;
+};
+
+
 #if (NXT_TLS)
 static ssize_t nxt_http_idle_io_read_handler(nxt_task_t *task, nxt_conn_t *c);
 static void nxt_http_conn_test(nxt_task_t *task, void *obj, void *data);
@@ -42,6 +58,10 @@ static nxt_int_t nxt_h1p_websocket_version(void *ctx, nxt_http_field_t *field,
 static nxt_int_t nxt_h1p_transfer_encoding(void *ctx, nxt_http_field_t *field,
     uintptr_t data);
 static void nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r);
+static void nxt_h1p_request_body_stream(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_work_handler_t handler);
+static void nxt_h1p_request_body_part(nxt_task_t *task, nxt_h1proto_t *h1p,
+    nxt_http_request_t *r, nxt_buf_t *b);
 static void nxt_h1p_conn_request_body_read(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_h1p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r);
@@ -51,6 +71,8 @@ static void nxt_h1p_request_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *out);
 static nxt_buf_t *nxt_h1p_chunk_create(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *out);
+static nxt_bool_t nxt_h1p_request_sendfile(nxt_task_t *task,
+    nxt_http_request_t *r);
 static nxt_off_t nxt_h1p_request_body_bytes_sent(nxt_task_t *task,
     nxt_http_proto_t proto);
 static void nxt_h1p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
@@ -87,6 +109,15 @@ static void nxt_h1p_conn_closing(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_conn_free(nxt_task_t *task, void *obj, void *data);
 
 static void nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer);
+static void nxt_h1p_peer_open(nxt_task_t *task, nxt_http_peer_t *peer,
+    nxt_uint_t retry);
+static nxt_conn_t *nxt_h1p_peer_idle_get(nxt_event_engine_t *engine,
+    nxt_sockaddr_t *sa);
+static nxt_h1p_peer_pool_t *nxt_h1p_peer_pool_get(nxt_event_engine_t *engine,
+    nxt_sockaddr_t *sa, nxt_bool_t create);
+static nxt_int_t nxt_h1p_peer_pool_test(nxt_lvlhsh_query_t *lhq, void *data);
+static void nxt_h1p_peer_idle_remove(nxt_event_engine_t *engine,
+    nxt_conn_t *c);
 static void nxt_h1p_peer_connected(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_peer_refused(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_peer_header_send(nxt_task_t *task, nxt_http_peer_t *peer);
@@ -107,8 +138,19 @@ static void nxt_h1p_peer_error(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_peer_send_timeout(nxt_task_t *task, void *obj, void *data);
 static void nxt_h1p_peer_read_timeout(nxt_task_t *task, void *obj, void *data);
 static nxt_msec_t nxt_h1p_peer_timer_value(nxt_conn_t *c, uintptr_t data);
+static nxt_bool_t nxt_h1p_peer_retry(nxt_task_t *task, nxt_http_peer_t *peer);
 static void nxt_h1p_peer_close(nxt_task_t *task, nxt_http_peer_t *peer);
+static nxt_int_t nxt_h1p_peer_idle_put(nxt_task_t *task,
+    nxt_http_peer_t *peer);
+static void nxt_h1p_peer_idle_close_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_h1p_peer_idle_timeout(nxt_task_t *task, void *obj, void *data);
+static nxt_msec_t nxt_h1p_peer_idle_timer_value(nxt_conn_t *c, uintptr_t data);
+static void nxt_h1p_peer_idle_close(nxt_event_engine_t *engine, nxt_conn_t *c);
+static void nxt_h1p_peer_conn_close(nxt_task_t *task, nxt_conn_t *c);
 static void nxt_h1p_peer_free(nxt_task_t *task, void *obj, void *data);
+static nxt_int_t nxt_h1p_peer_connection(void *ctx, nxt_http_field_t *field,
+    uintptr_t data);
 static nxt_int_t nxt_h1p_peer_transfer_encoding(void *ctx,
     nxt_http_field_t *field, uintptr_t data);
 
@@ -129,16 +171,27 @@ static const nxt_conn_state_t  nxt_h1p_peer_header_body_send_state;
 static const nxt_conn_state_t  nxt_h1p_peer_header_read_state;
 static const nxt_conn_state_t  nxt_h1p_peer_header_read_timer_state;
 static const nxt_conn_state_t  nxt_h1p_peer_read_state;
+static const nxt_conn_state_t  nxt_h1p_peer_idle_state;
 static const nxt_conn_state_t  nxt_h1p_peer_close_state;
 
 
+static const nxt_lvlhsh_proto_t  nxt_h1p_peer_pool_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_h1p_peer_pool_test,
+    nxt_mp_lvlhsh_alloc,
+    nxt_mp_lvlhsh_free,
+};
+
+
 const nxt_http_proto_table_t  nxt_http_proto[3] = {
     /* NXT_HTTP_PROTO_H1 */
     {
         .body_read        = nxt_h1p_request_body_read,
+        .body_stream      = nxt_h1p_request_body_stream,
         .local_addr       = nxt_h1p_request_local_addr,
         .header_send      = nxt_h1p_request_header_send,
         .send             = nxt_h1p_request_send,
+        .sendfile         = nxt_h1p_request_sendfile,
         .body_bytes_sent  = nxt_h1p_request_body_bytes_sent,
         .discard          = nxt_h1p_request_discard,
         .close            = nxt_h1p_request_close,
@@ -151,7 +204,22 @@ const nxt_http_proto_table_t  nxt_http_proto[3] = {
 
         .ws_frame_start   = nxt_h1p_websocket_frame_start,
     },
-    /* NXT_HTTP_PROTO_H2      */
+    /* NXT_HTTP_PROTO_H2 */
+    {
+        .body_read        = nxt_h2p_request_body_read,
+        .local_addr       = nxt_h2p_request_local_addr,
+        .header_send      = nxt_h2p_request_header_send,
+        .send             = nxt_h2p_request_send,
+        .body_bytes_sent  = nxt_h2p_request_body_bytes_sent,
+        .discard          = nxt_h2p_request_discard,
+        .close            = nxt_h2p_request_close,
+
+        .peer_connect     = nxt_h1p_peer_connect,
+        .peer_header_send = nxt_h1p_peer_header_send,
+        .peer_header_read = nxt_h1p_peer_header_read,
+        .peer_read        = nxt_h1p_peer_read,
+        .peer_close       = nxt_h1p_peer_close,
+    },
     /* NXT_HTTP_PROTO_DEVNULL */
 };
 
@@ -188,7 +256,7 @@ static nxt_http_field_proc_t           nxt_h1p_fields[] = {
 static nxt_lvlhsh_t                    nxt_h1p_peer_fields_hash;
 
 static nxt_http_field_proc_t           nxt_h1p_peer_fields[] = {
-    { nxt_string("Connection"),        &nxt_http_proxy_skip, 0 },
+    { nxt_string("Connection"),        &nxt_h1p_peer_connection, 0 },
     { nxt_string("Transfer-Encoding"), &nxt_h1p_peer_transfer_encoding, 0 },
     { nxt_string("Server"),            &nxt_http_proxy_skip, 0 },
     { nxt_string("Date"),              &nxt_http_proxy_date, 0 },
@@ -456,6 +524,20 @@ nxt_h1p_conn_proto_init(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "h1p conn proto init");
 
+    switch (nxt_h2p_preface_test(c)) {
+
+    case NXT_OK:
+        nxt_h2p_conn_init(task, c);
+        return;
+
+    case NXT_AGAIN:
+        nxt_conn_read(task->thread->engine, c);
+        return;
+
+    default:
+        break;
+    }
+
     h1p = nxt_mp_zget(c->mem_pool, sizeof(nxt_h1proto_t));
     if (nxt_slow_path(h1p == NULL)) {
         nxt_h1p_closing(task, c);
@@ -920,6 +1002,17 @@ nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
     if (body_length > body_buffer_size) {
         nxt_str_t  *tmp_path, tmp_name;
 
+        if (skcf->body_stream && !r->chunked && !h1p->body_deferred) {
+            /*
+             * The body is read after routing: it is streamed to
+             * an application or saved as usual for other actions.
+             */
+            h1p->body_deferred = 1;
+            r->body_stream = 1;
+
+            goto ready;
+        }
+
         tmp_path = &skcf->body_temp_path;
 
         tmp_name.length = tmp_path->length + tmp_name_pattern.length;
@@ -1072,6 +1165,94 @@ nxt_h1p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
 }
 
 
+static void
+nxt_h1p_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t handler)
+{
+    size_t         size;
+    nxt_buf_t      *in, *b;
+    nxt_conn_t     *c;
+    nxt_h1proto_t  *h1p;
+
+    h1p = r->proto.h1;
+    c = h1p->conn;
+
+    h1p->body_handler = handler;
+
+    b = r->body;
+
+    if (b == NULL) {
+        in = c->read;
+
+        size = nxt_buf_mem_used_size(&in->mem);
+        size = nxt_min(size, (size_t) r->content_length_n);
+
+        b = nxt_buf_mem_alloc(r->mem_pool,
+                              nxt_max(size, r->conf->socket_conf
+                                            ->body_buffer_size),
+                              0);
+        if (nxt_slow_path(b == NULL)) {
+            h1p->keepalive = 0;
+
+            nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+            return;
+        }
+
+        r->body = b;
+        h1p->body_rest = r->content_length_n;
+
+        b->mem.free = nxt_cpymem(b->mem.free, in->mem.pos, size);
+        in->mem.pos += size;
+
+        if (h1p->body_rest != (nxt_off_t) size) {
+            in->next = h1p->buffers;
+            h1p->buffers = in;
+            h1p->nbuffers++;
+
+            c->read = b;
+        }
+
+        nxt_debug(task, "h1p body stream preread: %uz", size);
+
+        if (size != 0) {
+            nxt_h1p_request_body_part(task, h1p, r, b);
+            return;
+        }
+
+    } else {
+        b->mem.pos = b->mem.start;
+        b->mem.free = b->mem.start;
+    }
+
+    if (h1p->body_rest < nxt_buf_mem_free_size(&b->mem)) {
+        /* This required to avoid reading next request. */
+        b->mem.pos = b->mem.end - h1p->body_rest;
+        b->mem.free = b->mem.pos;
+    }
+
+    c->read = b;
+    c->read_state = &nxt_h1p_read_body_state;
+
+    nxt_conn_read(task->thread->engine, c);
+}
+
+
+static void
+nxt_h1p_request_body_part(nxt_task_t *task, nxt_h1proto_t *h1p,
+    nxt_http_request_t *r, nxt_buf_t *b)
+{
+    h1p->body_rest -= nxt_buf_mem_used_size(&b->mem);
+
+    nxt_debug(task, "h1p body stream rest: %O", h1p->body_rest);
+
+    if (h1p->body_rest == 0) {
+        r->body_stream = 0;
+    }
+
+    h1p->body_handler(task, r, b);
+}
+
+
 static const nxt_conn_state_t  nxt_h1p_read_body_state
     nxt_aligned(64) =
 {
@@ -1110,6 +1291,15 @@ nxt_h1p_conn_request_body_read(nxt_task_t *task, void *obj, void *data)
 
     b = c->read;
 
+    if (r->body_stream) {
+        if (h1p->body_rest == (nxt_off_t) nxt_buf_mem_used_size(&b->mem)) {
+            c->read = NULL;
+        }
+
+        nxt_h1p_request_body_part(task, h1p, r, b);
+        return;
+    }
+
     if (nxt_buf_is_file(b)) {
 
         if (r->chunked) {
@@ -1657,6 +1847,18 @@ nxt_h1p_chunk_create(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
 }
 
 
+/*
+ * TLS connections can send file buffers only if the kernel TLS offload
+ * is enabled, plain connections always can.
+ */
+
+static nxt_bool_t
+nxt_h1p_request_sendfile(nxt_task_t *task, nxt_http_request_t *r)
+{
+    return r->proto.h1->conn->sendfile != NXT_CONN_SENDFILE_OFF;
+}
+
+
 static nxt_off_t
 nxt_h1p_request_body_bytes_sent(nxt_task_t *task, nxt_http_proto_t proto)
 {
@@ -1713,6 +1915,10 @@ nxt_h1p_conn_request_error(nxt_task_t *task, void *obj, void *data)
         return;
     }
 
+    if (r->body_stream && h1p->body_handler != NULL) {
+        h1p->body_handler(task, r, NULL);
+    }
+
     if (r->fields == NULL) {
         (void) nxt_h1p_header_process(task, h1p, r);
     }
@@ -1749,6 +1955,10 @@ nxt_h1p_conn_request_timeout(nxt_task_t *task, void *obj, void *data)
     h1p->keepalive = 0;
     r = h1p->request;
 
+    if (r->body_stream && h1p->body_handler != NULL) {
+        h1p->body_handler(task, r, NULL);
+    }
+
     if (r->fields == NULL) {
         (void) nxt_h1p_header_process(task, h1p, r);
     }
@@ -1808,6 +2018,10 @@ nxt_h1p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
 
     h1p = proto.h1;
     h1p->keepalive &= !h1p->request->inconsistent;
+
+    /* The rest of a streamed body is not read. */
+    h1p->keepalive &= !h1p->request->body_stream;
+
     h1p->request = NULL;
 
     nxt_router_conf_release(task, joint);
@@ -2243,6 +2457,13 @@ nxt_h1p_conn_free(nxt_task_t *task, void *obj, void *data)
 
 static void
 nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
+{
+    nxt_h1p_peer_open(task, peer, 0);
+}
+
+
+static void
+nxt_h1p_peer_open(nxt_task_t *task, nxt_http_peer_t *peer, nxt_uint_t retry)
 {
     nxt_mp_t            *mp;
     nxt_int_t           ret;
@@ -2250,50 +2471,79 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
     nxt_h1proto_t       *h1p;
     nxt_fd_event_t      *socket;
     nxt_work_queue_t    *wq;
+    nxt_event_engine_t  *engine;
     nxt_http_request_t  *r;
 
     nxt_debug(task, "h1p peer connect");
 
     peer->status = NXT_HTTP_UNSET;
     r = peer->request;
+    engine = task->thread->engine;
 
-    mp = nxt_mp_create(1024, 128, 256, 32);
+    c = NULL;
 
-    if (nxt_slow_path(mp == NULL)) {
-        goto fail;
+    if (r->conf->socket_conf->proxy_keepalive_conf.max_idle != 0) {
+        c = nxt_h1p_peer_idle_get(engine, peer->server->sockaddr);
     }
 
-    h1p = nxt_mp_zalloc(mp, sizeof(nxt_h1proto_t));
-    if (nxt_slow_path(h1p == NULL)) {
-        goto fail;
-    }
+    if (c != NULL) {
+        h1p = c->socket.data;
+        nxt_memzero(h1p, offsetof(nxt_h1proto_t, conn));
 
-    ret = nxt_http_parse_request_init(&h1p->parser, r->mem_pool);
-    if (nxt_slow_path(ret != NXT_OK)) {
-        goto fail;
-    }
+        peer->proto.h1 = h1p;
+        c->socket.data = peer;
 
-    c = nxt_conn_create(mp, task);
-    if (nxt_slow_path(c == NULL)) {
-        goto fail;
-    }
+    } else {
+        mp = nxt_mp_create(1024, 128, 256, 32);
 
-    c->mem_pool = mp;
-    h1p->conn = c;
+        if (nxt_slow_path(mp == NULL)) {
+            goto fail;
+        }
 
-    peer->proto.h1 = h1p;
-    h1p->request = r;
+        h1p = nxt_mp_zalloc(mp, sizeof(nxt_h1proto_t));
+        if (nxt_slow_path(h1p == NULL)) {
+            nxt_mp_destroy(mp);
+            goto fail;
+        }
 
-    c->socket.data = peer;
-    c->remote = peer->server->sockaddr;
+        c = nxt_conn_create(mp, task);
+        if (nxt_slow_path(c == NULL)) {
+            nxt_mp_destroy(mp);
+            goto fail;
+        }
+
+        c->mem_pool = mp;
+        h1p->conn = c;
+
+        peer->proto.h1 = h1p;
+        c->socket.data = peer;
+
+        /*
+         * The connection may outlive the configuration
+         * while it is kept in the idle connection pool.
+         */
+        c->remote = nxt_sockaddr_copy(mp, peer->server->sockaddr);
+        if (nxt_slow_path(c->remote == NULL)) {
+            goto fail;
+        }
+
+        c->socket.write_ready = 1;
+        c->write_state = &nxt_h1p_peer_connect_state;
+    }
+
+    h1p->request = r;
+    h1p->peer_retry = retry;
 
-    c->socket.write_ready = 1;
-    c->write_state = &nxt_h1p_peer_connect_state;
+    ret = nxt_http_parse_request_init(&h1p->parser, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto fail;
+    }
 
     /*
      * TODO: queues should be implemented via client proto interface.
      */
-    client = r->proto.h1->conn;
+    client = (r->protocol == NXT_HTTP_PROTO_H2) ? r->proto.h2->h2p->conn
+                                                : r->proto.h1->conn;
 
     socket = &client->socket;
     wq = socket->read_work_queue;
@@ -2307,7 +2557,13 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
     c->write_timer.work_queue = wq;
     /* TODO END */
 
-    nxt_conn_connect(task->thread->engine, c);
+    if (h1p->peer_requests != 0) {
+        nxt_work_queue_add(&engine->fast_work_queue, nxt_h1p_peer_connected,
+                           task, c, peer);
+        return;
+    }
+
+    nxt_conn_connect(engine, c);
 
     return;
 
@@ -2319,6 +2575,140 @@ nxt_h1p_peer_connect(nxt_task_t *task, nxt_http_peer_t *peer)
 }
 
 
+static nxt_conn_t *
+nxt_h1p_peer_idle_get(nxt_event_engine_t *engine, nxt_sockaddr_t *sa)
+{
+    nxt_conn_t           *c;
+    nxt_queue_link_t     *link;
+    nxt_h1p_peer_pool_t  *pool;
+
+    pool = nxt_h1p_peer_pool_get(engine, sa, 0);
+
+    while (pool != NULL) {
+        /* The most recently used connection is reused first. */
+        link = nxt_queue_first(&pool->connections);
+        c = nxt_queue_link_data(link, nxt_conn_t, link);
+
+        if (pool->nidle == 1) {
+            /* The pool is freed along with its last connection. */
+            pool = NULL;
+        }
+
+        nxt_h1p_peer_idle_remove(engine, c);
+
+        if (c->socket.read_ready) {
+            /* The upstream has closed the idle connection or sent data. */
+            nxt_h1p_peer_idle_close(engine, c);
+            continue;
+        }
+
+        nxt_debug(c->socket.task, "h1p peer idle reuse fd:%d", c->socket.fd);
+
+        nxt_timer_disable(engine, &c->read_timer);
+        nxt_fd_event_block_read(engine, &c->socket);
+
+        c->read_state = &nxt_h1p_peer_header_read_state;
+
+        return c;
+    }
+
+    return NULL;
+}
+
+
+static nxt_h1p_peer_pool_t *
+nxt_h1p_peer_pool_get(nxt_event_engine_t *engine, nxt_sockaddr_t *sa,
+    nxt_bool_t create)
+{
+    nxt_int_t            ret;
+    nxt_h1p_peer_pool_t  *pool;
+    nxt_lvlhsh_query_t   lhq;
+
+    /*
+     * The upstream addresses are parsed from the configuration, so
+     * the whole struct sockaddr can be compared unlike accepted ones.
+     */
+    lhq.key.length = sa->socklen;
+    lhq.key.start = (u_char *) &sa->u.sockaddr;
+    lhq.key_hash = nxt_djb_hash(lhq.key.start, lhq.key.length);
+    lhq.proto = &nxt_h1p_peer_pool_proto;
+
+    if (nxt_lvlhsh_find(&engine->peer_pools, &lhq) == NXT_OK) {
+        return lhq.value;
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    pool = nxt_mp_alloc(engine->mem_pool,
+                        sizeof(nxt_h1p_peer_pool_t) + lhq.key.length);
+    if (nxt_slow_path(pool == NULL)) {
+        return NULL;
+    }
+
+    nxt_queue_init(&pool->connections);
+    pool->nidle = 0;
+
+    pool->key.length = lhq.key.length;
+    pool->key.start = (u_char *) pool + sizeof(nxt_h1p_peer_pool_t);
+    nxt_memcpy(pool->key.start, lhq.key.start, lhq.key.length);
+
+    lhq.key = pool->key;
+    lhq.replace = 0;
+    lhq.value = pool;
+    lhq.pool = engine->mem_pool;
+
+    ret = nxt_lvlhsh_insert(&engine->peer_pools, &lhq);
+
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_mp_free(engine->mem_pool, pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+
+static nxt_int_t
+nxt_h1p_peer_pool_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_h1p_peer_pool_t  *pool;
+
+    pool = data;
+
+    return nxt_strstr_eq(&lhq->key, &pool->key) ? NXT_OK : NXT_DECLINED;
+}
+
+
+static void
+nxt_h1p_peer_idle_remove(nxt_event_engine_t *engine, nxt_conn_t *c)
+{
+    nxt_h1proto_t        *h1p;
+    nxt_h1p_peer_pool_t  *pool;
+    nxt_lvlhsh_query_t   lhq;
+
+    h1p = c->socket.data;
+    pool = h1p->peer_pool;
+    h1p->peer_pool = NULL;
+
+    nxt_queue_remove(&c->link);
+
+    if (--pool->nidle != 0) {
+        return;
+    }
+
+    lhq.key = pool->key;
+    lhq.key_hash = nxt_djb_hash(lhq.key.start, lhq.key.length);
+    lhq.proto = &nxt_h1p_peer_pool_proto;
+    lhq.pool = engine->mem_pool;
+
+    (void) nxt_lvlhsh_delete(&engine->peer_pools, &lhq);
+
+    nxt_mp_free(engine->mem_pool, pool);
+}
+
+
 static const nxt_conn_state_t  nxt_h1p_peer_connect_state
     nxt_aligned(64) =
 {
@@ -2342,6 +2732,11 @@ nxt_h1p_peer_connected(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "h1p peer connected");
 
+    if (peer->proto.h1->peer_retry != 0) {
+        nxt_h1p_peer_header_send(task, peer);
+        return;
+    }
+
     r = peer->request;
     r->state->ready_handler(task, r, peer);
 }
@@ -2373,6 +2768,7 @@ nxt_h1p_peer_header_send(nxt_task_t *task, nxt_http_peer_t *peer)
     nxt_int_t           ret;
     nxt_str_t           target;
     nxt_buf_t           *header, *body;
+    nxt_bool_t          keepalive;
     nxt_conn_t          *c;
     nxt_http_field_t    *field;
     nxt_http_request_t  *r;
@@ -2386,6 +2782,8 @@ nxt_h1p_peer_header_send(nxt_task_t *task, nxt_http_peer_t *peer)
         goto fail;
     }
 
+    keepalive = (r->conf->socket_conf->proxy_keepalive_conf.max_idle != 0);
+
     size = r->method->length + sizeof(" ") + target.length
            + sizeof(" HTTP/1.1\r\n")
            + sizeof("Connection: close\r\n")
@@ -2411,7 +2809,10 @@ nxt_h1p_peer_header_send(nxt_task_t *task, nxt_http_peer_t *peer)
     *p++ = ' ';
     p = nxt_cpymem(p, target.start, target.length);
     p = nxt_cpymem(p, " HTTP/1.1\r\n", 11);
-    p = nxt_cpymem(p, "Connection: close\r\n", 19);
+
+    if (!keepalive) {
+        p = nxt_cpymem(p, "Connection: close\r\n", 19);
+    }
 
     nxt_list_each(field, r->fields) {
 
@@ -2552,6 +2953,7 @@ static void
 nxt_h1p_peer_header_sent(nxt_task_t *task, void *obj, void *data)
 {
     nxt_conn_t          *c;
+    nxt_h1proto_t       *h1p;
     nxt_http_peer_t     *peer;
     nxt_http_request_t  *r;
     nxt_event_engine_t  *engine;
@@ -2570,6 +2972,15 @@ nxt_h1p_peer_header_sent(nxt_task_t *task, void *obj, void *data)
         return;
     }
 
+    h1p = peer->proto.h1;
+    h1p->peer_header_sent = 1;
+
+    if (h1p->peer_retry == NXT_H1P_PEER_RETRY_READ) {
+        /* The request state has already passed the header sending. */
+        nxt_h1p_peer_header_read(task, peer);
+        return;
+    }
+
     r = peer->request;
     r->state->ready_handler(task, r, peer);
 }
@@ -2648,6 +3059,7 @@ nxt_h1p_peer_io_read_handler(nxt_task_t *task, nxt_conn_t *c)
             c->socket.error = NXT_ENOMEM;
             return NXT_ERROR;
         }
+
     }
 
     n = c->io->recvbuf(c, b);
@@ -2722,6 +3134,38 @@ nxt_h1p_peer_header_read_done(nxt_task_t *task, void *obj, void *data)
 
         } else if (r->resp.content_length_n > 0) {
             h1p->remainder = r->resp.content_length_n;
+
+        } else if (r->resp.content_length == NULL) {
+            /* The response body is delimited by the connection close. */
+            h1p->keepalive = 0;
+        }
+
+        if (peer->status == NXT_HTTP_NO_CONTENT
+            || peer->status == NXT_HTTP_NOT_MODIFIED
+            || nxt_str_eq(r->method, "HEAD", 4)
+            || (!h1p->chunked && r->resp.content_length_n == 0))
+        {
+            h1p->chunked = 0;
+            h1p->remainder = 0;
+
+            if (nxt_buf_mem_used_size(&b->mem) != 0) {
+                h1p->keepalive = 0;
+            }
+
+            /*
+             * The response has no body, a connection which
+             * is not kept alive is read until it is closed.
+             */
+
+            if (h1p->keepalive) {
+                nxt_http_proxy_buf_mem_free(task, r, b);
+
+                peer->body = nxt_http_buf_last(r);
+                peer->closed = 1;
+
+                r->state->ready_handler(task, r, peer);
+                return;
+            }
         }
 
         if (nxt_buf_mem_used_size(&b->mem) != 0) {
@@ -2783,6 +3227,9 @@ nxt_h1p_peer_header_parse(nxt_http_peer_t *peer, nxt_buf_mem_t *bm)
             return NXT_ERROR;
         }
 
+        /* HTTP/1.1 connections are persistent by default. */
+        peer->proto.h1->keepalive = (p[7] == '1');
+
         p += 12;
         length -= 12;
 
@@ -2903,6 +3350,8 @@ nxt_h1p_peer_closed(nxt_task_t *task, void *obj, void *data)
 
     r = peer->request;
 
+    peer->proto.h1->keepalive = 0;
+
     if (peer->header_received) {
         peer->body = nxt_http_buf_last(r);
         peer->closed = 1;
@@ -2911,6 +3360,10 @@ nxt_h1p_peer_closed(nxt_task_t *task, void *obj, void *data)
         r->state->ready_handler(task, r, peer);
 
     } else {
+        if (nxt_h1p_peer_retry(task, peer)) {
+            return;
+        }
+
         peer->status = NXT_HTTP_BAD_GATEWAY;
 
         r->state->error_handler(task, r, peer);
@@ -2928,6 +3381,12 @@ nxt_h1p_peer_error(nxt_task_t *task, void *obj, void *data)
 
     nxt_debug(task, "h1p peer error");
 
+    peer->proto.h1->keepalive = 0;
+
+    if (nxt_h1p_peer_retry(task, peer)) {
+        return;
+    }
+
     peer->status = NXT_HTTP_BAD_GATEWAY;
 
     r = peer->request;
@@ -2994,21 +3453,280 @@ nxt_h1p_peer_timer_value(nxt_conn_t *c, uintptr_t data)
 }
 
 
+/*
+ * A request sent over a connection taken from the idle pool is retried
+ * once over another connection if the upstream closes the connection
+ * without a response, unless a non-idempotent request has been sent.
+ */
+
+static nxt_bool_t
+nxt_h1p_peer_retry(nxt_task_t *task, nxt_http_peer_t *peer)
+{
+    nxt_uint_t          retry;
+    nxt_conn_t          *c;
+    nxt_h1proto_t       *h1p;
+    nxt_http_request_t  *r;
+
+    h1p = peer->proto.h1;
+    c = h1p->conn;
+    r = peer->request;
+
+    if (h1p->peer_requests == 0
+        || peer->header_received
+        || peer->status != NXT_HTTP_UNSET
+        || c->read != NULL)
+    {
+        return 0;
+    }
+
+    if (h1p->peer_header_sent
+        && (nxt_str_eq(r->method, "POST", 4)
+            || nxt_str_eq(r->method, "PATCH", 5)
+            || nxt_str_eq(r->method, "LOCK", 4)))
+    {
+        return 0;
+    }
+
+    nxt_debug(task, "h1p peer retry");
+
+    retry = h1p->peer_header_sent ? NXT_H1P_PEER_RETRY_READ
+                                  : NXT_H1P_PEER_RETRY_SEND;
+
+    c->socket.task = &c->task;
+    c->read_timer.task = &c->task;
+    c->write_timer.task = &c->task;
+
+    nxt_h1p_peer_conn_close(&c->task, c);
+    peer->proto.h1 = NULL;
+
+    nxt_h1p_peer_open(task, peer, retry);
+
+    return 1;
+}
+
+
 static void
 nxt_h1p_peer_close(nxt_task_t *task, nxt_http_peer_t *peer)
 {
+    nxt_bool_t  done;
     nxt_conn_t  *c;
 
     nxt_debug(task, "h1p peer close");
 
+    /* The peer is marked as closed once the whole response is read. */
+    done = peer->closed;
     peer->closed = 1;
 
+    if (nxt_slow_path(peer->proto.h1 == NULL)) {
+        return;
+    }
+
     c = peer->proto.h1->conn;
     task = &c->task;
     c->socket.task = task;
     c->read_timer.task = task;
     c->write_timer.task = task;
 
+    if (done && nxt_h1p_peer_idle_put(task, peer) == NXT_OK) {
+        return;
+    }
+
+    nxt_h1p_peer_conn_close(task, c);
+}
+
+
+static nxt_int_t
+nxt_h1p_peer_idle_put(nxt_task_t *task, nxt_http_peer_t *peer)
+{
+    u_char                      ch;
+    ssize_t                     n;
+    nxt_conn_t                  *c, *last;
+    nxt_h1proto_t               *h1p;
+    nxt_queue_link_t            *link;
+    nxt_event_engine_t          *engine;
+    nxt_h1p_peer_pool_t         *pool;
+    nxt_proxy_keepalive_conf_t  *kcf;
+
+    h1p = peer->proto.h1;
+    c = h1p->conn;
+    engine = task->thread->engine;
+    kcf = &peer->request->conf->socket_conf->proxy_keepalive_conf;
+
+    h1p->peer_requests++;
+
+    if (!h1p->keepalive
+        || kcf->max_idle == 0
+        || (kcf->max_requests != 0 && h1p->peer_requests >= kcf->max_requests)
+        || engine->shutdown
+        || c->socket.fd == -1
+        || c->socket.error != 0
+        || c->socket.closed
+        || c->block_read
+        || c->block_write
+        || c->read != NULL
+        || c->write != NULL)
+    {
+        return NXT_DECLINED;
+    }
+
+    if (c->socket.read_ready) {
+        n = c->io->recv(c, &ch, 1, MSG_PEEK);
+
+        if (n != NXT_AGAIN) {
+            /* Unexpected data after the response or the connection close. */
+            return NXT_DECLINED;
+        }
+    }
+
+    pool = nxt_h1p_peer_pool_get(engine, c->remote, 1);
+    if (nxt_slow_path(pool == NULL)) {
+        return NXT_DECLINED;
+    }
+
+    if (pool->nidle >= kcf->max_idle) {
+        /* The least recently used connection is closed. */
+        link = nxt_queue_last(&pool->connections);
+        last = nxt_queue_link_data(link, nxt_conn_t, link);
+
+        /* The pool is kept by the new connection. */
+        nxt_queue_remove(link);
+        pool->nidle--;
+
+        ((nxt_h1proto_t *) last->socket.data)->peer_pool = NULL;
+
+        nxt_h1p_peer_idle_close(engine, last);
+    }
+
+    nxt_debug(task, "h1p peer idle fd:%d requests:%uD",
+              c->socket.fd, h1p->peer_requests);
+
+    nxt_timer_disable(engine, &c->read_timer);
+    nxt_timer_disable(engine, &c->write_timer);
+
+    h1p->request = NULL;
+    h1p->peer_idle_timeout = kcf->idle_timeout;
+
+    c->socket.data = h1p;
+    c->read_state = &nxt_h1p_peer_idle_state;
+    c->write_state = &nxt_h1p_peer_close_state;
+
+    h1p->peer_pool = pool;
+    pool->nidle++;
+
+    nxt_queue_insert_head(&pool->connections, &c->link);
+
+    nxt_conn_wait(c);
+
+    return NXT_OK;
+}
+
+
+static const nxt_conn_state_t  nxt_h1p_peer_idle_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h1p_peer_idle_close_handler,
+    .close_handler = nxt_h1p_peer_idle_close_handler,
+    .error_handler = nxt_h1p_peer_idle_close_handler,
+
+    .timer_handler = nxt_h1p_peer_idle_timeout,
+    .timer_value = nxt_h1p_peer_idle_timer_value,
+};
+
+
+static void
+nxt_h1p_peer_idle_close_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    nxt_debug(task, "h1p peer idle close handler");
+
+    /* The handler may be queued before the connection has been reused. */
+    if (c->read_state != &nxt_h1p_peer_idle_state) {
+        return;
+    }
+
+    nxt_h1p_peer_idle_remove(task->thread->engine, c);
+
+    nxt_h1p_peer_idle_close(task->thread->engine, c);
+}
+
+
+static void
+nxt_h1p_peer_idle_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "h1p peer idle timeout");
+
+    c = nxt_read_timer_conn(timer);
+
+    if (c->read_state != &nxt_h1p_peer_idle_state) {
+        return;
+    }
+
+    nxt_h1p_peer_idle_remove(task->thread->engine, c);
+
+    nxt_h1p_peer_idle_close(task->thread->engine, c);
+}
+
+
+static nxt_msec_t
+nxt_h1p_peer_idle_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_h1proto_t  *h1p;
+
+    h1p = c->socket.data;
+
+    return h1p->peer_idle_timeout;
+}
+
+
+void
+nxt_h1p_peer_idle_close_all(nxt_event_engine_t *engine)
+{
+    nxt_conn_t           *c;
+    nxt_queue_link_t     *link;
+    nxt_h1p_peer_pool_t  *pool;
+
+    for ( ;; ) {
+        pool = nxt_lvlhsh_peek(&engine->peer_pools, &nxt_h1p_peer_pool_proto);
+
+        if (pool == NULL) {
+            break;
+        }
+
+        /* The pool is deleted along with its last connection. */
+        link = nxt_queue_first(&pool->connections);
+        c = nxt_queue_link_data(link, nxt_conn_t, link);
+
+        nxt_h1p_peer_idle_remove(engine, c);
+        nxt_h1p_peer_idle_close(engine, c);
+    }
+}
+
+
+static void
+nxt_h1p_peer_idle_close(nxt_event_engine_t *engine, nxt_conn_t *c)
+{
+    nxt_debug(c->socket.task, "h1p peer idle close fd:%d", c->socket.fd);
+
+    c->read_state = &nxt_h1p_peer_close_state;
+    c->write_state = &nxt_h1p_peer_close_state;
+
+    nxt_timer_disable(engine, &c->read_timer);
+
+    nxt_conn_close(engine, c);
+}
+
+
+static void
+nxt_h1p_peer_conn_close(nxt_task_t *task, nxt_conn_t *c)
+{
     if (c->socket.fd != -1) {
         c->write_state = &nxt_h1p_peer_close_state;
 
@@ -3040,6 +3758,36 @@ nxt_h1p_peer_free(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static nxt_int_t
+nxt_h1p_peer_connection(void *ctx, nxt_http_field_t *field, uintptr_t data)
+{
+    const u_char        *end;
+    nxt_h1proto_t       *h1p;
+    nxt_http_request_t  *r;
+
+    r = ctx;
+    field->skip = 1;
+
+    end = field->value + field->value_length;
+
+    h1p = r->peer->proto.h1;
+
+    /* "close" wins over "keep-alive" in any order and any header line. */
+
+    if (nxt_memcasestrn(field->value, end, "close", 5) != NULL) {
+        h1p->peer_close = 1;
+        h1p->keepalive = 0;
+
+    } else if (nxt_memcasestrn(field->value, end, "keep-alive", 10) != NULL
+               && !h1p->peer_close)
+    {
+        h1p->keepalive = 1;
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_h1p_peer_transfer_encoding(void *ctx, nxt_http_field_t *field,
     uintptr_t data)
@@ -14,6 +14,7 @@
 
 
 typedef struct nxt_h1p_websocket_timer_s nxt_h1p_websocket_timer_t;
+typedef struct nxt_h1p_peer_pool_s nxt_h1p_peer_pool_t;
 
 
 struct nxt_h1proto_s {
@@ -35,8 +36,18 @@ struct nxt_h1proto_s {
     uint8_t                   websocket_cont_expected;  /* 1 bit */
     uint8_t                   websocket_closed;         /* 1 bit */
 
+    uint8_t                   peer_header_sent;     /* 1 bit  */
+    uint8_t                   peer_close;           /* 1 bit  */
+    uint8_t                   peer_retry;           /* 2 bits */
+
+    uint8_t                   body_deferred;        /* 1 bit  */
+
     uint32_t                  header_size;
 
+    /* The rest and the consumer of a streamed request body. */
+    nxt_off_t                 body_rest;
+    nxt_work_handler_t        body_handler;
+
     nxt_http_field_t          *websocket_key;
     nxt_h1p_websocket_timer_t *websocket_timer;
 
@@ -49,6 +60,11 @@ struct nxt_h1proto_s {
      * be zeroed in a keep-alive connection.
      */
     nxt_conn_t                *conn;
+
+    /* An upstream connection state kept while it is idle. */
+    uint32_t                  peer_requests;
+    nxt_msec_t                peer_idle_timeout;
+    nxt_h1p_peer_pool_t       *peer_pool;
 };
 
 #define nxt_h1p_is_http11(h1p)                                              \
@@ -0,0 +1,2855 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_h2proto.h>
+
+
+/*
+ * nxt_h2p_conn_ prefix is used for connection handlers.
+ * nxt_h2p_frame_ prefix is used for received frame handlers.
+ * nxt_h2p_stream_ prefix is used for stream operations.
+ * nxt_h2p_request_ prefix is used for HTTP/2 protocol request methods.
+ */
+
+
+typedef struct {
+    u_char                    *payload;
+    uint32_t                  length;
+    uint32_t                  stream_id;
+    uint8_t                   type;
+    uint8_t                   flags;
+} nxt_h2p_frame_t;
+
+
+typedef nxt_h2_error_t (*nxt_h2p_frame_handler_t)(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+
+
+static void nxt_h2p_conn_read(nxt_task_t *task, void *obj, void *data);
+static nxt_h2_error_t nxt_h2p_frame_data(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_headers(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_priority(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_rst_stream(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_settings(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_push_promise(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_ping(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_goaway(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_window_update(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_frame_continuation(nxt_task_t *task,
+    nxt_h2proto_t *h2p, nxt_h2p_frame_t *frame);
+static nxt_h2_error_t nxt_h2p_header_block(nxt_task_t *task,
+    nxt_h2proto_t *h2p, u_char *pos, u_char *end);
+static nxt_h2_error_t nxt_h2p_header_block_skip(nxt_h2proto_t *h2p,
+    u_char *pos, u_char *end);
+static nxt_h2_error_t nxt_h2p_stream_create(nxt_task_t *task,
+    nxt_h2proto_t *h2p, u_char *pos, u_char *end);
+static nxt_int_t nxt_h2p_request_header_parse(nxt_task_t *task,
+    nxt_h2stream_t *st, u_char *pos, u_char *end);
+static void nxt_h2p_request_header_process(nxt_h2stream_t *st,
+    nxt_http_request_t *r);
+static nxt_bool_t nxt_h2p_field_hopbyhop(u_char *name, size_t length);
+static void nxt_h2p_stream_body(nxt_task_t *task, nxt_h2stream_t *st,
+    u_char *pos, size_t size);
+static nxt_buf_t *nxt_h2p_body_file(nxt_task_t *task, nxt_http_request_t *r);
+static void nxt_h2p_stream_body_end(nxt_task_t *task, nxt_h2stream_t *st);
+static void nxt_h2p_request_body_ready(nxt_task_t *task, nxt_h2stream_t *st);
+static nxt_h2stream_t *nxt_h2p_stream_find(nxt_h2proto_t *h2p, uint32_t id);
+static void nxt_h2p_stream_send(nxt_task_t *task, nxt_h2stream_t *st);
+static nxt_buf_t *nxt_h2p_buf_slice(nxt_mp_t *mp, nxt_buf_t *b, size_t size);
+static void nxt_h2p_stream_drain(nxt_task_t *task, nxt_h2stream_t *st);
+static void nxt_h2p_stream_unblock(nxt_h2stream_t *st);
+static void nxt_h2p_streams_resume(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_stream_reset(nxt_task_t *task, nxt_h2stream_t *st,
+    nxt_h2_error_t error);
+static void nxt_h2p_stream_abort(nxt_h2stream_t *st);
+static nxt_int_t nxt_h2p_settings_send(nxt_task_t *task, nxt_h2proto_t *h2p);
+static nxt_int_t nxt_h2p_window_update_send(nxt_task_t *task,
+    nxt_h2proto_t *h2p, uint32_t id, uint32_t increment);
+static nxt_int_t nxt_h2p_rst_stream_send(nxt_task_t *task, nxt_h2proto_t *h2p,
+    uint32_t id, nxt_h2_error_t error);
+static nxt_int_t nxt_h2p_goaway_send(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2_error_t error);
+static nxt_int_t nxt_h2p_frame_send(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_uint_t type, nxt_uint_t flags, uint32_t id, const u_char *payload,
+    size_t length);
+static u_char *nxt_h2p_frame_header(u_char *p, size_t length, nxt_uint_t type,
+    nxt_uint_t flags, uint32_t id);
+static nxt_buf_t *nxt_h2p_buf_alloc(nxt_mp_t *mp, size_t size);
+static void nxt_h2p_buf_completion(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_frame_completion(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_buf_drain(nxt_task_t *task, nxt_buf_t *b);
+static void nxt_h2p_conn_output(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_buf_t *out);
+static void nxt_h2p_conn_sent(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_fail(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_error(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2_error_t error);
+static void nxt_h2p_conn_read_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_h2p_conn_send_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_msec_t nxt_h2p_conn_read_timer_value(nxt_conn_t *c,
+    uintptr_t data);
+static nxt_msec_t nxt_h2p_conn_send_timer_value(nxt_conn_t *c,
+    uintptr_t data);
+static void nxt_h2p_streams_abort(nxt_h2proto_t *h2p);
+static void nxt_h2p_close_test(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_conn_close(nxt_task_t *task, nxt_h2proto_t *h2p);
+static void nxt_h2p_closing(nxt_task_t *task, nxt_conn_t *c);
+static void nxt_h2p_conn_closing(nxt_task_t *task, void *obj, void *data);
+static void nxt_h2p_conn_free(nxt_task_t *task, void *obj, void *data);
+
+
+#define nxt_h2p_get_uint32(p)                                                 \
+    (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16)                    \
+     | ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+
+#define nxt_h2p_set_uint32(p, n)                                              \
+    do {                                                                      \
+        (p)[0] = (u_char) ((n) >> 24);                                        \
+        (p)[1] = (u_char) ((n) >> 16);                                        \
+        (p)[2] = (u_char) ((n) >> 8);                                         \
+        (p)[3] = (u_char) (n);                                                \
+    } while (0)
+
+
+static const nxt_conn_state_t  nxt_h2p_read_state;
+static const nxt_conn_state_t  nxt_h2p_send_state;
+static const nxt_conn_state_t  nxt_h2p_shutdown_state;
+static const nxt_conn_state_t  nxt_h2p_close_state;
+
+
+static const nxt_h2p_frame_handler_t  nxt_h2p_frame_handlers[] = {
+    nxt_h2p_frame_data,
+    nxt_h2p_frame_headers,
+    nxt_h2p_frame_priority,
+    nxt_h2p_frame_rst_stream,
+    nxt_h2p_frame_settings,
+    nxt_h2p_frame_push_promise,
+    nxt_h2p_frame_ping,
+    nxt_h2p_frame_goaway,
+    nxt_h2p_frame_window_update,
+    nxt_h2p_frame_continuation,
+};
+
+
+static nxt_lvlhsh_t                    nxt_h2p_fields_hash;
+
+static nxt_http_field_proc_t           nxt_h2p_fields[] = {
+    { nxt_string("Host"),              &nxt_http_request_host, 0 },
+    { nxt_string("Cookie"),            &nxt_http_request_field,
+        offsetof(nxt_http_request_t, cookie) },
+    { nxt_string("Referer"),           &nxt_http_request_field,
+        offsetof(nxt_http_request_t, referer) },
+    { nxt_string("User-Agent"),        &nxt_http_request_field,
+        offsetof(nxt_http_request_t, user_agent) },
+    { nxt_string("Content-Type"),      &nxt_http_request_field,
+        offsetof(nxt_http_request_t, content_type) },
+    { nxt_string("Content-Length"),    &nxt_http_request_content_length, 0 },
+    { nxt_string("Authorization"),     &nxt_http_request_field,
+        offsetof(nxt_http_request_t, authorization) },
+#if (NXT_HAVE_OTEL)
+    { nxt_string("Traceparent"),       &nxt_otel_parse_traceparent, 0 },
+    { nxt_string("Tracestate"),        &nxt_otel_parse_tracestate,  0 },
+#endif
+};
+
+
+typedef struct {
+    nxt_str_t                 name;
+    nxt_str_t                 value;
+} nxt_h2p_field_t;
+
+
+nxt_int_t
+nxt_h2p_init(nxt_task_t *task)
+{
+    nxt_int_t  ret;
+
+    ret = nxt_http_fields_hash(&nxt_h2p_fields_hash,
+                               nxt_h2p_fields, nxt_nitems(nxt_h2p_fields));
+
+    if (nxt_fast_path(ret == NXT_OK)) {
+        ret = nxt_hpack_init();
+    }
+
+    return ret;
+}
+
+
+nxt_int_t
+nxt_h2p_preface_test(nxt_conn_t *c)
+{
+    size_t                   size;
+    nxt_buf_t                *b;
+    nxt_socket_conf_t        *skcf;
+    nxt_socket_conf_joint_t  *joint;
+
+    joint = c->listen->socket.data;
+
+    if (joint == NULL || !joint->socket_conf->http2) {
+        return NXT_DECLINED;
+    }
+
+    skcf = joint->socket_conf;
+
+#if (NXT_TLS)
+    if ((c->u.tls != NULL) != (skcf->tls != NULL)) {
+        return NXT_DECLINED;
+    }
+#endif
+
+    b = c->read;
+
+    size = nxt_buf_mem_used_size(&b->mem);
+    size = nxt_min(size, nxt_length(NXT_H2_PREFACE));
+
+    if (memcmp(b->mem.pos, NXT_H2_PREFACE, size) != 0) {
+        return NXT_DECLINED;
+    }
+
+    if (size < nxt_length(NXT_H2_PREFACE)
+        && nxt_buf_mem_free_size(&b->mem) != 0)
+    {
+        return NXT_AGAIN;
+    }
+
+    return (size == nxt_length(NXT_H2_PREFACE)) ? NXT_OK : NXT_DECLINED;
+}
+
+
+void
+nxt_h2p_conn_init(nxt_task_t *task, nxt_conn_t *c)
+{
+    size_t              size;
+    nxt_buf_t           *in, *b;
+    nxt_h2proto_t       *h2p;
+    nxt_event_engine_t  *engine;
+
+    nxt_debug(task, "h2p conn init");
+
+    engine = task->thread->engine;
+
+    in = c->read;
+    c->read = NULL;
+
+    size = nxt_buf_mem_used_size(&in->mem) - nxt_length(NXT_H2_PREFACE);
+
+    h2p = nxt_mp_zget(c->mem_pool, sizeof(nxt_h2proto_t));
+    if (nxt_slow_path(h2p == NULL)) {
+        goto fail;
+    }
+
+    b = nxt_buf_mem_alloc(c->mem_pool,
+                          nxt_max(size, NXT_H2_READ_BUFFER_SIZE), 0);
+    if (nxt_slow_path(b == NULL)) {
+        goto fail;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.pos,
+                             in->mem.pos + nxt_length(NXT_H2_PREFACE), size);
+
+    nxt_event_engine_buf_mem_free(engine, in);
+
+    c->read = b;
+    c->socket.data = h2p;
+
+    h2p->conn = c;
+    h2p->conn_write_tail = &c->write;
+
+    nxt_hpack_table_init(&h2p->hpack, c->mem_pool, NXT_HPACK_TABLE_SIZE);
+
+    nxt_queue_init(&h2p->streams);
+    nxt_queue_init(&h2p->blocked);
+
+    h2p->send_window = NXT_H2_DEFAULT_WINDOW;
+    h2p->recv_window = NXT_H2_DEFAULT_WINDOW;
+    h2p->initial_window = NXT_H2_DEFAULT_WINDOW;
+    h2p->max_frame_size = NXT_H2_DEFAULT_FRAME_SIZE;
+
+    /* The connection was added to the idle connections on accept. */
+    h2p->idle = 1;
+
+    if (!c->tcp_nodelay) {
+        nxt_conn_tcp_nodelay_on(task, c);
+    }
+
+    c->read_state = &nxt_h2p_read_state;
+    c->write_state = &nxt_h2p_send_state;
+
+    if (nxt_slow_path(nxt_h2p_settings_send(task, h2p) != NXT_OK)) {
+        nxt_h2p_conn_fail(task, c, h2p);
+        return;
+    }
+
+    nxt_h2p_conn_read(task, c, h2p);
+
+    return;
+
+fail:
+
+    nxt_event_engine_buf_mem_free(engine, in);
+
+    nxt_conn_active(engine, c);
+
+    nxt_h2p_closing(task, c);
+}
+
+
+static const nxt_conn_state_t  nxt_h2p_read_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_read,
+    .close_handler = nxt_h2p_conn_fail,
+    .error_handler = nxt_h2p_conn_fail,
+
+    .timer_handler = nxt_h2p_conn_read_timeout,
+    .timer_value = nxt_h2p_conn_read_timer_value,
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h2p_conn_read(nxt_task_t *task, void *obj, void *data)
+{
+    u_char          *p;
+    size_t          size;
+    uint32_t        length;
+    nxt_buf_t       *b;
+    nxt_conn_t      *c;
+    nxt_h2proto_t   *h2p;
+    nxt_h2_error_t  error;
+    nxt_h2p_frame_t frame;
+
+    c = obj;
+    h2p = c->socket.data;
+
+    nxt_debug(task, "h2p conn read");
+
+    if (h2p == NULL || h2p->closing || h2p->closed) {
+        return;
+    }
+
+    b = c->read;
+
+    for ( ;; ) {
+        size = nxt_buf_mem_used_size(&b->mem);
+
+        if (size < NXT_H2_FRAME_HEADER_SIZE) {
+            break;
+        }
+
+        p = b->mem.pos;
+
+        length = ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | p[2];
+
+        if (nxt_slow_path(length > NXT_H2_DEFAULT_FRAME_SIZE)) {
+            nxt_h2p_conn_error(task, h2p, NXT_H2_FRAME_SIZE_ERROR);
+            return;
+        }
+
+        if (size < NXT_H2_FRAME_HEADER_SIZE + length) {
+            break;
+        }
+
+        frame.length = length;
+        frame.type = p[3];
+        frame.flags = p[4];
+        frame.stream_id = nxt_h2p_get_uint32(&p[5]) & 0x7fffffff;
+        frame.payload = p + NXT_H2_FRAME_HEADER_SIZE;
+
+        b->mem.pos += NXT_H2_FRAME_HEADER_SIZE + length;
+
+        nxt_debug(task, "h2p frame type:%d flags:%02Xd stream:%uD length:%uD",
+                  frame.type, frame.flags, frame.stream_id, frame.length);
+
+        if (nxt_slow_path(!h2p->settings_received
+                          && frame.type != NXT_H2_SETTINGS))
+        {
+            nxt_h2p_conn_error(task, h2p, NXT_H2_PROTOCOL_ERROR);
+            return;
+        }
+
+        if (nxt_slow_path(h2p->header_block != NULL
+                          && (frame.type != NXT_H2_CONTINUATION
+                              || frame.stream_id != h2p->header_stream_id)))
+        {
+            nxt_h2p_conn_error(task, h2p, NXT_H2_PROTOCOL_ERROR);
+            return;
+        }
+
+        if (frame.type >= nxt_nitems(nxt_h2p_frame_handlers)) {
+            /* Unknown frame types must be ignored. */
+            continue;
+        }
+
+        error = nxt_h2p_frame_handlers[frame.type](task, h2p, &frame);
+
+        if (nxt_slow_path(error != NXT_H2_NO_ERROR)) {
+            nxt_h2p_conn_error(task, h2p, error);
+            return;
+        }
+
+        if (h2p->closing || h2p->closed) {
+            return;
+        }
+
+        if (nxt_slow_path(h2p->queued_frames > NXT_H2_MAX_QUEUED_FRAMES)) {
+            nxt_h2p_conn_error(task, h2p, NXT_H2_ENHANCE_YOUR_CALM);
+            return;
+        }
+    }
+
+    if (b->mem.pos != b->mem.start) {
+        size = nxt_buf_mem_used_size(&b->mem);
+
+        nxt_memmove(b->mem.start, b->mem.pos, size);
+
+        b->mem.pos = b->mem.start;
+        b->mem.free = b->mem.start + size;
+    }
+
+    if (h2p->queued_frames >= NXT_H2_READ_QUEUED_FRAMES) {
+        nxt_debug(task, "h2p read blocked: %ui frames queued",
+                  h2p->queued_frames);
+
+        /* Reading is resumed by nxt_h2p_frame_completion(). */
+        h2p->read_blocked = 1;
+        return;
+    }
+
+    nxt_conn_read(task->thread->engine, c);
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_data(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    u_char          *p, *end;
+    uint32_t        length;
+    nxt_uint_t      end_stream;
+    nxt_h2stream_t  *st;
+
+    if (nxt_slow_path(frame->stream_id == 0)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    length = frame->length;
+
+    /* The entire frame payload including padding is flow controlled. */
+
+    if (nxt_slow_path(length > (uint32_t) h2p->recv_window)) {
+        return NXT_H2_FLOW_CONTROL_ERROR;
+    }
+
+    h2p->recv_window -= length;
+    h2p->recv_unacked += length;
+
+    if (h2p->recv_unacked >= NXT_H2_DEFAULT_WINDOW / 2) {
+        if (nxt_slow_path(nxt_h2p_window_update_send(task, h2p, 0,
+                                                     h2p->recv_unacked)
+                          != NXT_OK))
+        {
+            return NXT_H2_INTERNAL_ERROR;
+        }
+
+        h2p->recv_window += h2p->recv_unacked;
+        h2p->recv_unacked = 0;
+    }
+
+    p = frame->payload;
+    end = p + length;
+
+    if (frame->flags & NXT_H2_PADDED) {
+        if (nxt_slow_path(length == 0 || *p >= length)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        end -= *p++;
+    }
+
+    st = nxt_h2p_stream_find(h2p, frame->stream_id);
+
+    if (st == NULL) {
+        if (nxt_slow_path(frame->stream_id > h2p->last_stream_id)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        /* A closed stream. */
+        return NXT_H2_NO_ERROR;
+    }
+
+    if (st->end_stream_received || st->reset) {
+        nxt_h2p_stream_reset(task, st, NXT_H2_STREAM_CLOSED);
+        return NXT_H2_NO_ERROR;
+    }
+
+    if (nxt_slow_path(length > (uint32_t) st->recv_window)) {
+        nxt_h2p_stream_reset(task, st, NXT_H2_FLOW_CONTROL_ERROR);
+        return NXT_H2_NO_ERROR;
+    }
+
+    st->recv_window -= length;
+
+    end_stream = frame->flags & NXT_H2_END_STREAM;
+
+    if (end_stream) {
+        st->end_stream_received = 1;
+
+    } else {
+        st->recv_unacked += length;
+
+        if (st->recv_unacked >= NXT_H2_DEFAULT_WINDOW / 2) {
+            if (nxt_slow_path(nxt_h2p_window_update_send(task, h2p,
+                                                         st->id,
+                                                         st->recv_unacked)
+                              != NXT_OK))
+            {
+                return NXT_H2_INTERNAL_ERROR;
+            }
+
+            st->recv_window += st->recv_unacked;
+            st->recv_unacked = 0;
+        }
+    }
+
+    nxt_h2p_stream_body(task, st, p, end - p);
+
+    if (end_stream) {
+        nxt_h2p_stream_body_end(task, st);
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_headers(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    u_char                   *p, *end;
+    size_t                   size;
+    nxt_buf_t                *b;
+    nxt_socket_conf_t        *skcf;
+    nxt_socket_conf_joint_t  *joint;
+
+    if (nxt_slow_path(frame->stream_id == 0
+                      || (frame->stream_id & 1) == 0))
+    {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    p = frame->payload;
+    end = p + frame->length;
+
+    if (frame->flags & NXT_H2_PADDED) {
+        if (nxt_slow_path(p == end || *p >= end - p)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        end -= *p++;
+    }
+
+    if (frame->flags & NXT_H2_PRIORITY_FLAG) {
+        if (nxt_slow_path(end - p < 5)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        /* Stream priorities are not supported. */
+        p += 5;
+    }
+
+    h2p->header_stream_id = frame->stream_id;
+    h2p->header_end_stream = ((frame->flags & NXT_H2_END_STREAM) != 0);
+
+    if (frame->flags & NXT_H2_END_HEADERS) {
+        return nxt_h2p_header_block(task, h2p, p, end);
+    }
+
+    /* The header block continues in CONTINUATION frames. */
+
+    joint = h2p->conn->listen->socket.data;
+
+    if (nxt_fast_path(joint != NULL)) {
+        skcf = joint->socket_conf;
+        size = skcf->large_header_buffer_size * skcf->large_header_buffers;
+
+    } else {
+        size = 2 * NXT_H2_DEFAULT_FRAME_SIZE;
+    }
+
+    size = nxt_max(size, (size_t) (end - p));
+
+    b = nxt_buf_mem_alloc(h2p->conn->mem_pool, size, 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_H2_INTERNAL_ERROR;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, p, end - p);
+
+    h2p->header_block = b;
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_continuation(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    nxt_buf_t       *b;
+    nxt_h2_error_t  error;
+
+    b = h2p->header_block;
+
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(frame->length > nxt_buf_mem_free_size(&b->mem))) {
+        nxt_log(task, NXT_LOG_INFO, "h2p header block is too large");
+
+        return NXT_H2_ENHANCE_YOUR_CALM;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, frame->payload, frame->length);
+
+    if ((frame->flags & NXT_H2_END_HEADERS) == 0) {
+        return NXT_H2_NO_ERROR;
+    }
+
+    h2p->header_block = NULL;
+
+    error = nxt_h2p_header_block(task, h2p, b->mem.pos, b->mem.free);
+
+    nxt_mp_free(h2p->conn->mem_pool, b);
+
+    return error;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_header_block(nxt_task_t *task, nxt_h2proto_t *h2p, u_char *pos,
+    u_char *end)
+{
+    uint32_t                 id;
+    nxt_h2_error_t           error;
+    nxt_h2stream_t           *st;
+    nxt_socket_conf_joint_t  *joint;
+
+    id = h2p->header_stream_id;
+
+    if (id <= h2p->last_stream_id) {
+        error = nxt_h2p_header_block_skip(h2p, pos, end);
+        if (nxt_slow_path(error != NXT_H2_NO_ERROR)) {
+            return error;
+        }
+
+        st = nxt_h2p_stream_find(h2p, id);
+
+        if (st == NULL) {
+            return NXT_H2_STREAM_CLOSED;
+        }
+
+        if (st->end_stream_received || !h2p->header_end_stream) {
+            nxt_h2p_stream_reset(task, st, NXT_H2_PROTOCOL_ERROR);
+            return NXT_H2_NO_ERROR;
+        }
+
+        /* Trailer fields are ignored. */
+
+        st->end_stream_received = 1;
+
+        nxt_h2p_stream_body_end(task, st);
+
+        return NXT_H2_NO_ERROR;
+    }
+
+    h2p->last_stream_id = id;
+
+    joint = h2p->conn->listen->socket.data;
+
+    if (h2p->goaway || h2p->nstreams >= NXT_H2_MAX_STREAMS || joint == NULL) {
+        error = nxt_h2p_header_block_skip(h2p, pos, end);
+        if (nxt_slow_path(error != NXT_H2_NO_ERROR)) {
+            return error;
+        }
+
+        if (nxt_slow_path(nxt_h2p_rst_stream_send(task, h2p, id,
+                                                  NXT_H2_REFUSED_STREAM)
+                          != NXT_OK))
+        {
+            return NXT_H2_INTERNAL_ERROR;
+        }
+
+        return NXT_H2_NO_ERROR;
+    }
+
+    return nxt_h2p_stream_create(task, h2p, pos, end);
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_header_block_skip(nxt_h2proto_t *h2p, u_char *pos, u_char *end)
+{
+    nxt_mp_t   *mp;
+    nxt_int_t  ret;
+    nxt_str_t  name, value;
+
+    /* The block must be decoded to keep the HPACK dynamic table in sync. */
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return NXT_H2_INTERNAL_ERROR;
+    }
+
+    do {
+        ret = nxt_hpack_decode(&h2p->hpack, &pos, end, mp, &name, &value);
+    } while (ret == NXT_OK);
+
+    nxt_mp_destroy(mp);
+
+    return (ret == NXT_DONE) ? NXT_H2_NO_ERROR : NXT_H2_COMPRESSION_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_stream_create(nxt_task_t *task, nxt_h2proto_t *h2p, u_char *pos,
+    u_char *end)
+{
+    nxt_int_t                ret;
+    nxt_conn_t               *c;
+    nxt_h2_error_t           error;
+    nxt_h2stream_t           *st;
+    nxt_socket_conf_t        *skcf;
+    nxt_http_request_t       *r;
+    nxt_socket_conf_joint_t  *joint;
+
+    c = h2p->conn;
+
+    nxt_debug(task, "h2p stream create %uD", h2p->header_stream_id);
+
+    r = nxt_http_request_create(task);
+    if (nxt_slow_path(r == NULL)) {
+        goto fail;
+    }
+
+    st = nxt_mp_zget(r->mem_pool, sizeof(nxt_h2stream_t));
+    if (nxt_slow_path(st == NULL)) {
+        goto fail_release;
+    }
+
+    ret = nxt_http_parse_request_init(&st->parser, r->mem_pool);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto fail_release;
+    }
+
+    st->id = h2p->header_stream_id;
+    st->h2p = h2p;
+    st->request = r;
+    st->send_window = h2p->initial_window;
+    st->recv_window = NXT_H2_DEFAULT_WINDOW;
+
+    r->proto.h2 = st;
+    r->protocol = NXT_HTTP_PROTO_H2;
+    r->remote = c->remote;
+
+#if (NXT_TLS)
+    r->tls = (c->u.tls != NULL);
+#endif
+
+    r->task = c->task;
+    task = &r->task;
+
+    joint = c->listen->socket.data;
+    joint->count++;
+
+    r->conf = joint;
+    skcf = joint->socket_conf;
+    r->log_route = skcf->log_route;
+
+    if (c->local == NULL) {
+        c->local = skcf->sockaddr;
+    }
+
+    st->parser.discard_unsafe_fields = skcf->discard_unsafe_fields;
+
+    nxt_queue_insert_tail(&h2p->streams, &st->link);
+    h2p->nstreams++;
+
+    if (h2p->idle) {
+        h2p->idle = 0;
+        nxt_conn_active(task->thread->engine, c);
+    }
+
+    if (h2p->header_end_stream) {
+        st->end_stream_received = 1;
+    }
+
+    ret = nxt_h2p_request_header_parse(task, st, pos, end);
+
+    if (nxt_slow_path(ret == NXT_ERROR)) {
+        /* The stream is closed by the connection error. */
+        return NXT_H2_COMPRESSION_ERROR;
+    }
+
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_http_request_error(task, r, ret);
+        return NXT_H2_NO_ERROR;
+    }
+
+    r->state->ready_handler(task, r, NULL);
+
+    return NXT_H2_NO_ERROR;
+
+fail_release:
+
+    nxt_mp_release(r->mem_pool);
+
+fail:
+
+    error = nxt_h2p_header_block_skip(h2p, pos, end);
+    if (error != NXT_H2_NO_ERROR) {
+        return error;
+    }
+
+    if (nxt_h2p_rst_stream_send(task, h2p, h2p->header_stream_id,
+                                NXT_H2_INTERNAL_ERROR)
+        != NXT_OK)
+    {
+        return NXT_H2_INTERNAL_ERROR;
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+/*
+ * The decoded header list is converted to an HTTP/1.1 request header
+ * which is processed by the regular request parser.  This way HTTP/2
+ * requests get exactly the same target normalization and field checks.
+ */
+
+static nxt_int_t
+nxt_h2p_request_header_parse(nxt_task_t *task, nxt_h2stream_t *st,
+    u_char *pos, u_char *end)
+{
+    u_char              *p, *start, ch;
+    size_t              size, cookie;
+    nxt_int_t           ret, status;
+    nxt_str_t           name, value, *pseudo;
+    nxt_uint_t          i, fields_started, host;
+    nxt_array_t         *fields;
+    nxt_buf_mem_t       bm;
+    nxt_h2proto_t       *h2p;
+    nxt_h2p_field_t     *field;
+    nxt_http_request_t  *r;
+    nxt_str_t           method, scheme, authority, path;
+
+    h2p = st->h2p;
+    r = st->request;
+
+    nxt_str_null(&method);
+    nxt_str_null(&scheme);
+    nxt_str_null(&authority);
+    nxt_str_null(&path);
+
+    status = NXT_OK;
+    fields_started = 0;
+    host = 0;
+    cookie = 0;
+    size = 0;
+
+    fields = nxt_array_create(r->mem_pool, 8, sizeof(nxt_h2p_field_t));
+
+    if (nxt_slow_path(fields == NULL)) {
+        status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    for ( ;; ) {
+        ret = nxt_hpack_decode(&h2p->hpack, &pos, end, r->mem_pool,
+                               &name, &value);
+
+        if (ret == NXT_DONE) {
+            break;
+        }
+
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_log(task, NXT_LOG_INFO, "h2p header block decoding failed");
+
+            return NXT_ERROR;
+        }
+
+        if (status != NXT_OK) {
+            /* Decoding continues to keep the dynamic table in sync. */
+            continue;
+        }
+
+        if (name.length != 0 && name.start[0] == ':') {
+            pseudo = NULL;
+
+            if (nxt_str_eq(&name, ":method", 7)) {
+                pseudo = &method;
+
+            } else if (nxt_str_eq(&name, ":scheme", 7)) {
+                pseudo = &scheme;
+
+            } else if (nxt_str_eq(&name, ":authority", 10)) {
+                pseudo = &authority;
+
+            } else if (nxt_str_eq(&name, ":path", 5)) {
+                pseudo = &path;
+            }
+
+            if (nxt_slow_path(pseudo == NULL
+                              || pseudo->start != NULL
+                              || fields_started))
+            {
+                nxt_log(task, NXT_LOG_INFO,
+                        "h2p invalid pseudo-header \"%V\"", &name);
+
+                status = NXT_HTTP_BAD_REQUEST;
+                continue;
+            }
+
+            *pseudo = value;
+
+            if (pseudo->start == NULL) {
+                pseudo->start = (u_char *) "";
+            }
+
+            for (i = 0; i < value.length; i++) {
+                ch = value.start[i];
+
+                if (nxt_slow_path(ch <= ' ' || ch == 0x7f)) {
+                    status = NXT_HTTP_BAD_REQUEST;
+                    break;
+                }
+            }
+
+            continue;
+        }
+
+        fields_started = 1;
+
+        if (nxt_slow_path(name.length == 0)) {
+            status = NXT_HTTP_BAD_REQUEST;
+            continue;
+        }
+
+        if (nxt_slow_path(name.length > 255)) {
+            status = NXT_HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE;
+            continue;
+        }
+
+        for (i = 0; i < name.length; i++) {
+            ch = name.start[i];
+
+            if (nxt_slow_path(ch <= ' ' || ch >= 0x7f || ch == ':'
+                              || (ch >= 'A' && ch <= 'Z')))
+            {
+                status = NXT_HTTP_BAD_REQUEST;
+                break;
+            }
+        }
+
+        for (i = 0; i < value.length; i++) {
+            ch = value.start[i];
+
+            if (nxt_slow_path(ch == '\0' || ch == '\r' || ch == '\n')) {
+                status = NXT_HTTP_BAD_REQUEST;
+                break;
+            }
+        }
+
+        if (nxt_slow_path(status != NXT_OK)) {
+            nxt_log(task, NXT_LOG_INFO, "h2p invalid header field \"%V\"",
+                    &name);
+            continue;
+        }
+
+        if (nxt_h2p_field_hopbyhop(name.start, name.length)) {
+            if (!(nxt_str_eq(&name, "te", 2)
+                  && nxt_str_eq(&value, "trailers", 8)))
+            {
+                nxt_log(task, NXT_LOG_INFO,
+                        "h2p connection-specific header field \"%V\"", &name);
+
+                status = NXT_HTTP_BAD_REQUEST;
+                continue;
+            }
+        }
+
+        if (nxt_str_eq(&name, "cookie", 6)) {
+            /* Cookie crumbs are joined into a single field. */
+            cookie += value.length + nxt_length("; ");
+
+        } else if (nxt_str_eq(&name, "host", 4)) {
+            host = 1;
+        }
+
+        field = nxt_array_add(fields);
+        if (nxt_slow_path(field == NULL)) {
+            status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            continue;
+        }
+
+        field->name = name;
+        field->value = value;
+
+        size += name.length + value.length + nxt_length(": \r\n");
+    }
+
+    if (status == NXT_OK
+        && (method.length == 0 || path.length == 0 || scheme.length == 0))
+    {
+        nxt_log(task, NXT_LOG_INFO, "h2p mandatory pseudo-header is absent");
+
+        status = NXT_HTTP_BAD_REQUEST;
+    }
+
+    if (nxt_slow_path(status != NXT_OK)) {
+        nxt_h2p_request_header_process(st, r);
+        return status;
+    }
+
+    size += method.length + path.length + nxt_length("  HTTP/1.1\r\n\r\n");
+
+    if (!host && authority.length != 0) {
+        size += authority.length + nxt_length("host: \r\n");
+    }
+
+    if (cookie != 0) {
+        size += cookie + nxt_length("cookie: \r\n");
+    }
+
+    start = nxt_mp_nget(r->mem_pool, size);
+    if (nxt_slow_path(start == NULL)) {
+        nxt_h2p_request_header_process(st, r);
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    p = nxt_cpymem(start, method.start, method.length);
+    *p++ = ' ';
+    p = nxt_cpymem(p, path.start, path.length);
+    p = nxt_cpymem(p, " HTTP/1.1\r\n", 11);
+
+    if (!host && authority.length != 0) {
+        p = nxt_cpymem(p, "host: ", 6);
+        p = nxt_cpymem(p, authority.start, authority.length);
+        *p++ = '\r'; *p++ = '\n';
+    }
+
+    field = fields->elts;
+
+    for (i = 0; i < fields->nelts; i++) {
+        if (nxt_str_eq(&field[i].name, "cookie", 6)) {
+            continue;
+        }
+
+        p = nxt_cpymem(p, field[i].name.start, field[i].name.length);
+        *p++ = ':'; *p++ = ' ';
+        p = nxt_cpymem(p, field[i].value.start, field[i].value.length);
+        *p++ = '\r'; *p++ = '\n';
+    }
+
+    if (cookie != 0) {
+        p = nxt_cpymem(p, "cookie: ", 8);
+
+        for (i = 0; i < fields->nelts; i++) {
+            if (!nxt_str_eq(&field[i].name, "cookie", 6)) {
+                continue;
+            }
+
+            if (p[-1] != ' ') {
+                *p++ = ';'; *p++ = ' ';
+            }
+
+            p = nxt_cpymem(p, field[i].value.start, field[i].value.length);
+        }
+
+        *p++ = '\r'; *p++ = '\n';
+    }
+
+    *p++ = '\r'; *p++ = '\n';
+
+    bm.start = start;
+    bm.pos = start;
+    bm.free = p;
+    bm.end = p;
+
+    ret = nxt_http_parse_request(&st->parser, &bm);
+
+    switch (ret) {
+
+    case NXT_DONE:
+        break;
+
+    case NXT_AGAIN:
+    case NXT_HTTP_PARSE_INVALID:
+    case NXT_HTTP_PARSE_UNSUPPORTED_VERSION:
+        nxt_h2p_request_header_process(st, r);
+        return NXT_HTTP_BAD_REQUEST;
+
+    case NXT_HTTP_PARSE_TOO_LARGE_FIELD:
+        nxt_h2p_request_header_process(st, r);
+        return NXT_HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE;
+
+    default:
+        nxt_h2p_request_header_process(st, r);
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    /* The request line ends with the protocol version. */
+    nxt_memcpy(st->parser.request_line_end - 8, "HTTP/2.0", 8);
+    nxt_memcpy(st->parser.version.str, "HTTP/2.0", 8);
+
+    r->request_line.start = st->parser.method.start;
+    r->request_line.length = st->parser.request_line_end
+                             - r->request_line.start;
+
+    if (nxt_slow_path(r->log_route)) {
+        nxt_log(task, NXT_LOG_NOTICE, "http request line \"%V\"",
+                &r->request_line);
+    }
+
+    nxt_h2p_request_header_process(st, r);
+
+    return nxt_http_fields_process(r->fields, &nxt_h2p_fields_hash, r);
+}
+
+
+static void
+nxt_h2p_request_header_process(nxt_h2stream_t *st, nxt_http_request_t *r)
+{
+    r->target.start = st->parser.target_start;
+    r->target.length = st->parser.target_end - st->parser.target_start;
+
+    r->quoted_target = st->parser.quoted_target;
+
+    if (st->parser.version.ui64 != 0) {
+        r->version.start = st->parser.version.str;
+        r->version.length = sizeof(st->parser.version.str);
+    }
+
+    r->method = &st->parser.method;
+    r->path = &st->parser.path;
+    r->args = &st->parser.args;
+
+    r->fields = st->parser.fields;
+}
+
+
+static nxt_bool_t
+nxt_h2p_field_hopbyhop(u_char *name, size_t length)
+{
+    nxt_uint_t  i;
+
+    static const nxt_str_t  hopbyhop[] = {
+        nxt_string("connection"),
+        nxt_string("keep-alive"),
+        nxt_string("proxy-connection"),
+        nxt_string("transfer-encoding"),
+        nxt_string("upgrade"),
+        nxt_string("te"),
+    };
+
+    for (i = 0; i < nxt_nitems(hopbyhop); i++) {
+        if (length == hopbyhop[i].length
+            && nxt_memcasecmp(name, hopbyhop[i].start, length) == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void
+nxt_h2p_stream_body(nxt_task_t *task, nxt_h2stream_t *st, u_char *pos,
+    size_t size)
+{
+    size_t              used;
+    ssize_t             n;
+    nxt_buf_t           *b, *file;
+    nxt_socket_conf_t   *skcf;
+    nxt_http_request_t  *r;
+
+    r = st->request;
+
+    if (size == 0 || st->body_status != 0) {
+        return;
+    }
+
+    if (r->header_sent && !st->body_requested) {
+        /* The response has been sent without reading the body. */
+        return;
+    }
+
+    skcf = r->conf->socket_conf;
+
+    st->body_received += size;
+
+    if (r->content_length_n >= 0 && st->body_received > r->content_length_n) {
+        st->body_status = NXT_HTTP_BAD_REQUEST;
+        goto error;
+    }
+
+    if ((size_t) st->body_received > skcf->max_body_size) {
+        st->body_status = NXT_HTTP_PAYLOAD_TOO_LARGE;
+        goto error;
+    }
+
+    b = r->body;
+
+    if (b == NULL) {
+        if (r->content_length_n > (nxt_off_t) skcf->body_buffer_size) {
+            b = nxt_h2p_body_file(task, r);
+
+        } else {
+            b = nxt_buf_mem_alloc(r->mem_pool,
+                                  (r->content_length_n >= 0)
+                                  ? (size_t) r->content_length_n
+                                  : skcf->body_buffer_size, 0);
+        }
+
+        if (nxt_slow_path(b == NULL)) {
+            st->body_status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto error;
+        }
+
+        r->body = b;
+    }
+
+    if (!nxt_buf_is_file(b)) {
+        if (size <= (size_t) nxt_buf_mem_free_size(&b->mem)) {
+            b->mem.free = nxt_cpymem(b->mem.free, pos, size);
+            return;
+        }
+
+        /* The body does not fit in memory and is moved to a file. */
+
+        file = nxt_h2p_body_file(task, r);
+        if (nxt_slow_path(file == NULL)) {
+            st->body_status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto error;
+        }
+
+        used = nxt_buf_mem_used_size(&b->mem);
+
+        n = nxt_fd_write(file->file->fd, b->mem.pos, used);
+        if (nxt_slow_path(n < (ssize_t) used)) {
+            nxt_fd_close(file->file->fd);
+
+            st->body_status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto error;
+        }
+
+        file->file_end = used;
+
+        nxt_mp_free(r->mem_pool, b);
+
+        b = file;
+        r->body = b;
+    }
+
+    n = nxt_fd_write(b->file->fd, pos, size);
+    if (nxt_slow_path(n < (ssize_t) size)) {
+        st->body_status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+        goto error;
+    }
+
+    b->file_end += size;
+
+    return;
+
+error:
+
+    if (st->body_wait) {
+        nxt_h2p_request_body_ready(task, st);
+    }
+}
+
+
+static nxt_buf_t *
+nxt_h2p_body_file(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_buf_t  *b;
+    nxt_str_t  *tmp_path, tmp_name;
+
+    static const nxt_str_t tmp_name_pattern = nxt_string("/req-XXXXXXXX");
+
+    tmp_path = &r->conf->socket_conf->body_temp_path;
+
+    tmp_name.length = tmp_path->length + tmp_name_pattern.length;
+
+    b = nxt_buf_file_alloc(r->mem_pool,
+                           sizeof(nxt_file_t) + tmp_name.length + 1, 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NULL;
+    }
+
+    tmp_name.start = nxt_pointer_to(b->mem.start, sizeof(nxt_file_t));
+
+    memcpy(tmp_name.start, tmp_path->start, tmp_path->length);
+    memcpy(tmp_name.start + tmp_path->length, tmp_name_pattern.start,
+           tmp_name_pattern.length);
+    tmp_name.start[tmp_name.length] = '\0';
+
+    b->file = (nxt_file_t *) b->mem.start;
+    nxt_memzero(b->file, sizeof(nxt_file_t));
+
+    b->mem.start = NULL;
+    b->mem.end = NULL;
+    b->mem.pos = NULL;
+    b->mem.free = NULL;
+
+    b->file->fd = mkstemp((char *) tmp_name.start);
+    if (nxt_slow_path(b->file->fd == -1)) {
+        nxt_alert(task, "mkstemp(%s) failed %E", tmp_name.start, nxt_errno);
+
+        nxt_mp_free(r->mem_pool, b);
+        return NULL;
+    }
+
+    nxt_debug(task, "create body tmp file \"%V\", %d",
+              &tmp_name, b->file->fd);
+
+    unlink((char *) tmp_name.start);
+
+    return b;
+}
+
+
+static void
+nxt_h2p_stream_body_end(nxt_task_t *task, nxt_h2stream_t *st)
+{
+    if (st->body_wait) {
+        nxt_h2p_request_body_ready(task, st);
+    }
+}
+
+
+void
+nxt_h2p_request_body_read(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_conn_t      *c;
+    nxt_h2stream_t  *st;
+
+    st = r->proto.h2;
+
+    nxt_debug(task, "h2p request body read %O", r->content_length_n);
+
+    st->body_requested = 1;
+
+    if (st->end_stream_received || st->body_status != 0) {
+        nxt_h2p_request_body_ready(task, st);
+        return;
+    }
+
+    st->body_wait = 1;
+
+    c = st->h2p->conn;
+
+    nxt_conn_timer(task->thread->engine, c, c->read_state, &c->read_timer);
+}
+
+
+static void
+nxt_h2p_request_body_ready(nxt_task_t *task, nxt_h2stream_t *st)
+{
+    u_char              *p, *end;
+    nxt_buf_t           *b;
+    nxt_http_field_t    *f;
+    nxt_http_status_t   status;
+    nxt_http_request_t  *r;
+
+    r = st->request;
+    task = &r->task;
+
+    st->body_wait = 0;
+
+    status = st->body_status;
+
+    if (status == 0
+        && r->content_length_n >= 0
+        && st->body_received != r->content_length_n)
+    {
+        status = NXT_HTTP_BAD_REQUEST;
+    }
+
+    if (nxt_slow_path(status != 0)) {
+        goto error;
+    }
+
+    b = r->body;
+
+    if (b != NULL && nxt_buf_is_file(b)) {
+        b->file->size = b->file_end;
+    }
+
+    if (r->content_length == NULL && st->body_received != 0) {
+        f = nxt_list_zero_add(r->fields);
+        if (nxt_slow_path(f == NULL)) {
+            status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto error;
+        }
+
+        nxt_http_field_name_set(f, "Content-Length");
+
+        p = nxt_mp_nget(r->mem_pool, NXT_OFF_T_LEN);
+        if (nxt_slow_path(p == NULL)) {
+            status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+            goto error;
+        }
+
+        f->value = p;
+        end = nxt_sprintf(p, p + NXT_OFF_T_LEN, "%O", st->body_received);
+        f->value_length = end - p;
+
+        r->content_length = f;
+        r->content_length_n = st->body_received;
+    }
+
+    r->state->ready_handler(task, r, NULL);
+
+    return;
+
+error:
+
+    nxt_http_request_error(task, r, status);
+}
+
+
+void
+nxt_h2p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r)
+{
+    r->local = nxt_conn_local_addr(task, r->proto.h2->h2p->conn);
+}
+
+
+void
+nxt_h2p_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t body_handler, void *data)
+{
+    u_char            *p, *pos, *block;
+    size_t            size, length, n;
+    nxt_buf_t         *b;
+    nxt_uint_t        status, type, flags, nframes;
+    nxt_h2proto_t     *h2p;
+    nxt_h2stream_t    *st;
+    nxt_http_field_t  *field;
+
+    nxt_debug(task, "h2p request header send");
+
+    r->header_sent = 1;
+
+    st = r->proto.h2;
+    h2p = st->h2p;
+
+    status = r->status;
+
+    if (status == NXT_HTTP_TO_HTTPS) {
+        status = NXT_HTTP_BAD_REQUEST;
+
+    } else if (status < NXT_HTTP_OK || status > NXT_HTTP_STATUS_MAX) {
+        status = NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    size = NXT_HPACK_FIELD_OVERHEAD + nxt_length("999");
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (!field->skip
+            && !nxt_h2p_field_hopbyhop(field->name, field->name_length))
+        {
+            size += NXT_HPACK_FIELD_OVERHEAD
+                    + field->name_length + field->value_length;
+        }
+
+    } nxt_list_loop;
+
+    block = nxt_mp_alloc(r->mem_pool, size);
+    if (nxt_slow_path(block == NULL)) {
+        goto fail;
+    }
+
+    p = nxt_hpack_encode_status(block, status);
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (!field->skip
+            && !nxt_h2p_field_hopbyhop(field->name, field->name_length))
+        {
+            p = nxt_hpack_encode_field(p, field->name, field->name_length,
+                                       field->value, field->value_length);
+        }
+
+    } nxt_list_loop;
+
+    length = p - block;
+
+    nframes = (length + h2p->max_frame_size - 1) / h2p->max_frame_size;
+
+    b = nxt_h2p_buf_alloc(r->mem_pool,
+                          length + nframes * NXT_H2_FRAME_HEADER_SIZE);
+    if (nxt_slow_path(b == NULL)) {
+        nxt_mp_free(r->mem_pool, block);
+        goto fail;
+    }
+
+    type = NXT_H2_HEADERS;
+    flags = (body_handler == NULL) ? NXT_H2_END_STREAM : 0;
+    pos = block;
+
+    do {
+        n = nxt_min(length, h2p->max_frame_size);
+        length -= n;
+
+        if (length == 0) {
+            flags |= NXT_H2_END_HEADERS;
+        }
+
+        b->mem.free = nxt_h2p_frame_header(b->mem.free, n, type, flags,
+                                           st->id);
+        b->mem.free = nxt_cpymem(b->mem.free, pos, n);
+
+        pos += n;
+        type = NXT_H2_CONTINUATION;
+        flags = 0;
+
+    } while (length != 0);
+
+    nxt_mp_free(r->mem_pool, block);
+
+    if (body_handler == NULL) {
+        st->end_stream_sent = 1;
+        b->next = nxt_http_buf_last(r);
+
+    } else {
+        nxt_work_queue_add(&task->thread->engine->fast_work_queue,
+                           body_handler, task, r, data);
+    }
+
+    if (st->reset || h2p->closing || h2p->closed) {
+        nxt_h2p_buf_drain(task, b);
+        return;
+    }
+
+    nxt_h2p_conn_output(task, h2p, b);
+
+    return;
+
+fail:
+
+    r->state->error_handler(task, r, st);
+}
+
+
+void
+nxt_h2p_request_send(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
+{
+    nxt_h2stream_t  *st;
+
+    nxt_debug(task, "h2p request send");
+
+    st = r->proto.h2;
+
+    nxt_buf_chain_add(&st->out, out);
+
+    nxt_h2p_stream_send(task, st);
+}
+
+
+static void
+nxt_h2p_stream_send(nxt_task_t *task, nxt_h2stream_t *st)
+{
+    size_t              size, n;
+    int32_t             window;
+    nxt_buf_t           *b, *hdr, *slice, *out, **tail;
+    nxt_uint_t          flags;
+    nxt_h2proto_t       *h2p;
+    nxt_http_request_t  *r;
+
+    h2p = st->h2p;
+    r = st->request;
+
+    if (st->reset || h2p->closing || h2p->closed) {
+        nxt_h2p_stream_drain(task, st);
+        return;
+    }
+
+    out = NULL;
+    tail = &out;
+
+    while (st->out != NULL) {
+        b = st->out;
+
+        if (nxt_buf_is_sync(b) || nxt_buf_used_size(b) == 0) {
+
+            if (nxt_buf_is_sync(b) && nxt_buf_is_last(b)
+                && !st->end_stream_sent)
+            {
+                hdr = nxt_h2p_buf_alloc(r->mem_pool, NXT_H2_FRAME_HEADER_SIZE);
+                if (nxt_slow_path(hdr == NULL)) {
+                    goto fail;
+                }
+
+                hdr->mem.free = nxt_h2p_frame_header(hdr->mem.free, 0,
+                                                     NXT_H2_DATA,
+                                                     NXT_H2_END_STREAM,
+                                                     st->id);
+                *tail = hdr;
+                tail = &hdr->next;
+
+                st->end_stream_sent = 1;
+            }
+
+            st->out = b->next;
+            b->next = NULL;
+
+            *tail = b;
+            tail = &b->next;
+
+            continue;
+        }
+
+        window = nxt_min(st->send_window, h2p->send_window);
+
+        if (window <= 0) {
+            if (h2p->send_window <= 0 && !st->blocked) {
+                nxt_queue_insert_tail(&h2p->blocked, &st->blocked_link);
+                st->blocked = 1;
+            }
+
+            break;
+        }
+
+        size = nxt_buf_used_size(b);
+
+        n = nxt_min(size, (size_t) window);
+        n = nxt_min(n, h2p->max_frame_size);
+
+        flags = 0;
+
+        if (n == size
+            && b->next != NULL
+            && nxt_buf_is_sync(b->next)
+            && nxt_buf_is_last(b->next))
+        {
+            flags = NXT_H2_END_STREAM;
+        }
+
+        hdr = nxt_h2p_buf_alloc(r->mem_pool, NXT_H2_FRAME_HEADER_SIZE);
+        if (nxt_slow_path(hdr == NULL)) {
+            goto fail;
+        }
+
+        hdr->mem.free = nxt_h2p_frame_header(hdr->mem.free, n, NXT_H2_DATA,
+                                             flags, st->id);
+
+        if (n == size && !st->out_held) {
+            st->out = b->next;
+            b->next = NULL;
+
+            hdr->next = b;
+
+        } else {
+            /*
+             * The buffer is sent in several frames, its parts are
+             * referenced by slices and the buffer is held until
+             * the last slice has been created.
+             */
+
+            slice = nxt_h2p_buf_slice(r->mem_pool, b, n);
+            if (nxt_slow_path(slice == NULL)) {
+                nxt_h2p_buf_drain(task, hdr);
+                goto fail;
+            }
+
+            if (!st->out_held) {
+                st->out_held = 1;
+                b->retain++;
+            }
+
+            if (n == size) {
+                st->out = b->next;
+                b->next = NULL;
+
+                st->out_held = 0;
+                b->retain--;
+            }
+
+            hdr->next = slice;
+        }
+
+        *tail = hdr;
+        tail = &hdr->next->next;
+
+        if (flags != 0) {
+            st->end_stream_sent = 1;
+        }
+
+        st->send_window -= n;
+        h2p->send_window -= n;
+        st->body_sent += n;
+    }
+
+    if (out != NULL) {
+        nxt_h2p_conn_output(task, h2p, out);
+    }
+
+    return;
+
+fail:
+
+    if (out != NULL) {
+        nxt_h2p_conn_output(task, h2p, out);
+    }
+
+    nxt_h2p_stream_reset(task, st, NXT_H2_INTERNAL_ERROR);
+}
+
+
+static nxt_buf_t *
+nxt_h2p_buf_slice(nxt_mp_t *mp, nxt_buf_t *b, size_t size)
+{
+    nxt_buf_t  *slice;
+
+    if (nxt_buf_is_file(b)) {
+        slice = nxt_buf_file_alloc(mp, 0, 0);
+        if (nxt_slow_path(slice == NULL)) {
+            return NULL;
+        }
+
+        slice->file = b->file;
+        slice->file_pos = b->file_pos;
+        slice->file_end = b->file_pos + size;
+
+        b->file_pos += size;
+
+    } else {
+        slice = nxt_buf_mem_alloc(mp, 0, 0);
+        if (nxt_slow_path(slice == NULL)) {
+            return NULL;
+        }
+
+        slice->mem.start = b->mem.pos;
+        slice->mem.pos = b->mem.pos;
+        slice->mem.free = b->mem.pos + size;
+        slice->mem.end = slice->mem.free;
+
+        b->mem.pos += size;
+    }
+
+    slice->completion_handler = nxt_h2p_buf_completion;
+    slice->parent = b;
+    b->retain++;
+
+    nxt_mp_retain(mp);
+
+    return slice;
+}
+
+
+static void
+nxt_h2p_stream_drain(nxt_task_t *task, nxt_h2stream_t *st)
+{
+    nxt_buf_t  *b, *next;
+
+    b = st->out;
+    st->out = NULL;
+
+    nxt_h2p_stream_unblock(st);
+
+    if (b != NULL && st->out_held) {
+        st->out_held = 0;
+
+        next = b->next;
+        b->next = NULL;
+
+        nxt_buf_parent_completion(task, b);
+
+        b = next;
+    }
+
+    nxt_h2p_buf_drain(task, b);
+}
+
+
+static void
+nxt_h2p_stream_unblock(nxt_h2stream_t *st)
+{
+    if (st->blocked) {
+        st->blocked = 0;
+        nxt_queue_remove(&st->blocked_link);
+    }
+}
+
+
+static void
+nxt_h2p_streams_resume(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_queue_link_t  *link;
+    nxt_h2stream_t    *st;
+
+    while (h2p->send_window > 0 && !nxt_queue_is_empty(&h2p->blocked)) {
+        link = nxt_queue_first(&h2p->blocked);
+        st = nxt_queue_link_data(link, nxt_h2stream_t, blocked_link);
+
+        nxt_h2p_stream_unblock(st);
+
+        nxt_h2p_stream_send(task, st);
+    }
+}
+
+
+nxt_off_t
+nxt_h2p_request_body_bytes_sent(nxt_task_t *task, nxt_http_proto_t proto)
+{
+    return proto.h2->body_sent;
+}
+
+
+void
+nxt_h2p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *last)
+{
+    nxt_h2proto_t   *h2p;
+    nxt_h2stream_t  *st;
+
+    nxt_debug(task, "h2p request discard");
+
+    st = r->proto.h2;
+    h2p = st->h2p;
+
+    nxt_h2p_stream_drain(task, st);
+
+    if (!st->end_stream_sent && !st->reset && !h2p->closing && !h2p->closed) {
+        st->reset = 1;
+        (void) nxt_h2p_rst_stream_send(task, h2p, st->id,
+                                       NXT_H2_INTERNAL_ERROR);
+    }
+
+    st->end_stream_sent = 1;
+
+    if (last == NULL) {
+        return;
+    }
+
+    if (h2p->closed) {
+        nxt_h2p_buf_drain(task, last);
+        return;
+    }
+
+    nxt_h2p_conn_output(task, h2p, last);
+}
+
+
+void
+nxt_h2p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
+    nxt_socket_conf_joint_t *joint)
+{
+    nxt_conn_t          *c;
+    nxt_h2proto_t       *h2p;
+    nxt_h2stream_t      *st;
+    nxt_event_engine_t  *engine;
+
+    st = proto.h2;
+    h2p = st->h2p;
+    c = h2p->conn;
+
+    nxt_debug(task, "h2p request close %uD", st->id);
+
+    nxt_router_conf_release(task, joint);
+
+    if (!st->end_stream_received && !st->reset
+        && !h2p->closing && !h2p->closed)
+    {
+        /* The client must stop sending the request body. */
+        (void) nxt_h2p_rst_stream_send(task, h2p, st->id, NXT_H2_NO_ERROR);
+    }
+
+    nxt_h2p_stream_drain(task, st);
+
+    nxt_queue_remove(&st->link);
+    h2p->nstreams--;
+
+    task = &c->task;
+
+    if (h2p->nstreams == 0
+        && !h2p->goaway && !h2p->closing && !h2p->closed)
+    {
+        engine = task->thread->engine;
+
+        h2p->idle = 1;
+        nxt_conn_idle(engine, c);
+
+        nxt_conn_timer(engine, c, c->read_state, &c->read_timer);
+    }
+
+    nxt_h2p_close_test(task, h2p);
+}
+
+
+static nxt_h2stream_t *
+nxt_h2p_stream_find(nxt_h2proto_t *h2p, uint32_t id)
+{
+    nxt_h2stream_t  *st;
+
+    nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+        if (st->id == id) {
+            return st;
+        }
+
+    } nxt_queue_loop;
+
+    return NULL;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_priority(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    if (nxt_slow_path(frame->stream_id == 0)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(frame->length != 5)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_rst_stream(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    nxt_msec_t      now;
+    nxt_h2stream_t  *st;
+
+    if (nxt_slow_path(frame->length != 4)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    if (nxt_slow_path(frame->stream_id == 0
+                      || frame->stream_id > h2p->last_stream_id))
+    {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    nxt_debug(task, "h2p stream %uD reset: %uD", frame->stream_id,
+              nxt_h2p_get_uint32(frame->payload));
+
+    st = nxt_h2p_stream_find(h2p, frame->stream_id);
+
+    if (st == NULL) {
+        return NXT_H2_NO_ERROR;
+    }
+
+    /*
+     * A client opening and resetting streams at once makes requests
+     * start and abort without ever counting against the stream limit.
+     */
+
+    now = task->thread->engine->timers.now;
+
+    if (nxt_msec_diff(now, h2p->resets_start) >= NXT_H2_RESETS_PERIOD) {
+        h2p->resets_start = now;
+        h2p->resets = 0;
+    }
+
+    if (nxt_slow_path(++h2p->resets > NXT_H2_MAX_RESETS)) {
+        return NXT_H2_ENHANCE_YOUR_CALM;
+    }
+
+    st->reset = 1;
+    nxt_h2p_stream_abort(st);
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_settings(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    u_char          *p, *end;
+    int64_t         window;
+    uint32_t        value;
+    nxt_uint_t      id, resume;
+    nxt_h2stream_t  *st;
+
+    if (nxt_slow_path(frame->stream_id != 0)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    if (frame->flags & NXT_H2_ACK) {
+        return (frame->length == 0) ? NXT_H2_NO_ERROR
+                                    : NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    if (nxt_slow_path(frame->length % 6 != 0)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    resume = 0;
+
+    p = frame->payload;
+    end = p + frame->length;
+
+    while (p < end) {
+        id = ((nxt_uint_t) p[0] << 8) | p[1];
+        value = nxt_h2p_get_uint32(&p[2]);
+        p += 6;
+
+        nxt_debug(task, "h2p setting %ui: %uD", id, value);
+
+        switch (id) {
+
+        case NXT_H2_ENABLE_PUSH:
+            if (nxt_slow_path(value > 1)) {
+                return NXT_H2_PROTOCOL_ERROR;
+            }
+
+            break;
+
+        case NXT_H2_INITIAL_WINDOW_SIZE:
+            if (nxt_slow_path(value > NXT_H2_MAX_WINDOW)) {
+                return NXT_H2_FLOW_CONTROL_ERROR;
+            }
+
+            window = (int64_t) value - h2p->initial_window;
+
+            nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+                if (nxt_slow_path(st->send_window + window
+                                  > NXT_H2_MAX_WINDOW))
+                {
+                    return NXT_H2_FLOW_CONTROL_ERROR;
+                }
+
+                st->send_window += window;
+
+            } nxt_queue_loop;
+
+            resume = (window > 0);
+            h2p->initial_window = value;
+
+            break;
+
+        case NXT_H2_MAX_FRAME_SIZE_SETTING:
+            if (nxt_slow_path(value < NXT_H2_DEFAULT_FRAME_SIZE
+                              || value > NXT_H2_MAX_FRAME_SIZE))
+            {
+                return NXT_H2_PROTOCOL_ERROR;
+            }
+
+            h2p->max_frame_size = value;
+
+            break;
+
+        default:
+            /*
+             * The header table size is not used because
+             * the encoder does not use the dynamic table.
+             */
+            break;
+        }
+    }
+
+    h2p->settings_received = 1;
+
+    if (nxt_slow_path(nxt_h2p_frame_send(task, h2p, NXT_H2_SETTINGS,
+                                         NXT_H2_ACK, 0, NULL, 0)
+                      != NXT_OK))
+    {
+        return NXT_H2_INTERNAL_ERROR;
+    }
+
+    if (resume) {
+        nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+            if (st->out != NULL && !st->blocked) {
+                nxt_h2p_stream_send(task, st);
+            }
+
+        } nxt_queue_loop;
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_push_promise(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    /* Clients cannot push. */
+
+    return NXT_H2_PROTOCOL_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_ping(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    if (nxt_slow_path(frame->stream_id != 0)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(frame->length != 8)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    if (frame->flags & NXT_H2_ACK) {
+        return NXT_H2_NO_ERROR;
+    }
+
+    if (nxt_slow_path(nxt_h2p_frame_send(task, h2p, NXT_H2_PING, NXT_H2_ACK,
+                                         0, frame->payload, 8)
+                      != NXT_OK))
+    {
+        return NXT_H2_INTERNAL_ERROR;
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_goaway(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    if (nxt_slow_path(frame->stream_id != 0)) {
+        return NXT_H2_PROTOCOL_ERROR;
+    }
+
+    if (nxt_slow_path(frame->length < 8)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    nxt_debug(task, "h2p goaway last stream:%uD error:%uD",
+              nxt_h2p_get_uint32(frame->payload) & 0x7fffffff,
+              nxt_h2p_get_uint32(frame->payload + 4));
+
+    h2p->goaway = 1;
+
+    if (h2p->idle) {
+        h2p->idle = 0;
+        nxt_conn_active(task->thread->engine, h2p->conn);
+    }
+
+    nxt_h2p_close_test(task, h2p);
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static nxt_h2_error_t
+nxt_h2p_frame_window_update(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2p_frame_t *frame)
+{
+    uint32_t        increment;
+    nxt_h2stream_t  *st;
+
+    if (nxt_slow_path(frame->length != 4)) {
+        return NXT_H2_FRAME_SIZE_ERROR;
+    }
+
+    increment = nxt_h2p_get_uint32(frame->payload) & 0x7fffffff;
+
+    if (frame->stream_id == 0) {
+        if (nxt_slow_path(increment == 0)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        if (nxt_slow_path((int64_t) h2p->send_window + increment
+                          > NXT_H2_MAX_WINDOW))
+        {
+            return NXT_H2_FLOW_CONTROL_ERROR;
+        }
+
+        h2p->send_window += increment;
+
+        nxt_h2p_streams_resume(task, h2p);
+
+        return NXT_H2_NO_ERROR;
+    }
+
+    st = nxt_h2p_stream_find(h2p, frame->stream_id);
+
+    if (st == NULL) {
+        if (nxt_slow_path(frame->stream_id > h2p->last_stream_id)) {
+            return NXT_H2_PROTOCOL_ERROR;
+        }
+
+        return NXT_H2_NO_ERROR;
+    }
+
+    if (nxt_slow_path(increment == 0)) {
+        nxt_h2p_stream_reset(task, st, NXT_H2_PROTOCOL_ERROR);
+        return NXT_H2_NO_ERROR;
+    }
+
+    if (nxt_slow_path((int64_t) st->send_window + increment
+                      > NXT_H2_MAX_WINDOW))
+    {
+        nxt_h2p_stream_reset(task, st, NXT_H2_FLOW_CONTROL_ERROR);
+        return NXT_H2_NO_ERROR;
+    }
+
+    st->send_window += increment;
+
+    if (st->out != NULL && !st->blocked) {
+        nxt_h2p_stream_send(task, st);
+    }
+
+    return NXT_H2_NO_ERROR;
+}
+
+
+static void
+nxt_h2p_stream_reset(nxt_task_t *task, nxt_h2stream_t *st,
+    nxt_h2_error_t error)
+{
+    nxt_h2proto_t  *h2p;
+
+    h2p = st->h2p;
+
+    if (!st->reset && !h2p->closing && !h2p->closed) {
+        (void) nxt_h2p_rst_stream_send(task, h2p, st->id, error);
+    }
+
+    st->reset = 1;
+
+    nxt_h2p_stream_abort(st);
+}
+
+
+static void
+nxt_h2p_stream_abort(nxt_h2stream_t *st)
+{
+    nxt_http_request_t  *r;
+
+    if (st->aborted) {
+        return;
+    }
+
+    st->aborted = 1;
+    st->body_wait = 0;
+
+    r = st->request;
+
+    if (r->status == 0) {
+        r->status = NXT_HTTP_BAD_REQUEST;
+    }
+
+    r->state->error_handler(&r->task, r, st);
+}
+
+
+static nxt_int_t
+nxt_h2p_settings_send(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    u_char  payload[6];
+
+    payload[0] = 0;
+    payload[1] = NXT_H2_MAX_CONCURRENT_STREAMS;
+    nxt_h2p_set_uint32(&payload[2], NXT_H2_MAX_STREAMS);
+
+    return nxt_h2p_frame_send(task, h2p, NXT_H2_SETTINGS, 0, 0,
+                              payload, sizeof(payload));
+}
+
+
+static nxt_int_t
+nxt_h2p_window_update_send(nxt_task_t *task, nxt_h2proto_t *h2p, uint32_t id,
+    uint32_t increment)
+{
+    u_char  payload[4];
+
+    nxt_h2p_set_uint32(payload, increment);
+
+    return nxt_h2p_frame_send(task, h2p, NXT_H2_WINDOW_UPDATE, 0, id,
+                              payload, sizeof(payload));
+}
+
+
+static nxt_int_t
+nxt_h2p_rst_stream_send(nxt_task_t *task, nxt_h2proto_t *h2p, uint32_t id,
+    nxt_h2_error_t error)
+{
+    u_char  payload[4];
+
+    nxt_h2p_set_uint32(payload, error);
+
+    return nxt_h2p_frame_send(task, h2p, NXT_H2_RST_STREAM, 0, id,
+                              payload, sizeof(payload));
+}
+
+
+static nxt_int_t
+nxt_h2p_goaway_send(nxt_task_t *task, nxt_h2proto_t *h2p,
+    nxt_h2_error_t error)
+{
+    u_char  payload[8];
+
+    nxt_h2p_set_uint32(&payload[0], h2p->last_stream_id);
+    nxt_h2p_set_uint32(&payload[4], error);
+
+    return nxt_h2p_frame_send(task, h2p, NXT_H2_GOAWAY, 0, 0,
+                              payload, sizeof(payload));
+}
+
+
+static nxt_int_t
+nxt_h2p_frame_send(nxt_task_t *task, nxt_h2proto_t *h2p, nxt_uint_t type,
+    nxt_uint_t flags, uint32_t id, const u_char *payload, size_t length)
+{
+    u_char     *p;
+    nxt_buf_t  *b;
+
+    b = nxt_h2p_buf_alloc(h2p->conn->mem_pool,
+                          NXT_H2_FRAME_HEADER_SIZE + length);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_h2p_frame_header(b->mem.free, length, type, flags, id);
+
+    if (length != 0) {
+        p = nxt_cpymem(p, payload, length);
+    }
+
+    b->mem.free = p;
+
+    b->completion_handler = nxt_h2p_frame_completion;
+    b->parent = h2p;
+
+    h2p->queued_frames++;
+
+    nxt_h2p_conn_output(task, h2p, b);
+
+    return NXT_OK;
+}
+
+
+static u_char *
+nxt_h2p_frame_header(u_char *p, size_t length, nxt_uint_t type,
+    nxt_uint_t flags, uint32_t id)
+{
+    *p++ = (u_char) (length >> 16);
+    *p++ = (u_char) (length >> 8);
+    *p++ = (u_char) length;
+    *p++ = (u_char) type;
+    *p++ = (u_char) flags;
+
+    nxt_h2p_set_uint32(p, id);
+
+    return p + 4;
+}
+
+
+static nxt_buf_t *
+nxt_h2p_buf_alloc(nxt_mp_t *mp, size_t size)
+{
+    nxt_buf_t  *b;
+
+    b = nxt_buf_mem_alloc(mp, size, 0);
+
+    if (nxt_fast_path(b != NULL)) {
+        b->completion_handler = nxt_h2p_buf_completion;
+        nxt_mp_retain(mp);
+    }
+
+    return b;
+}
+
+
+static void
+nxt_h2p_buf_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_mp_t   *mp;
+    nxt_buf_t  *b, *parent;
+
+    b = obj;
+    parent = data;
+    mp = b->data;
+
+    nxt_mp_free(mp, b);
+
+    nxt_buf_parent_completion(task, parent);
+
+    nxt_mp_release(mp);
+}
+
+
+static void
+nxt_h2p_frame_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_mp_t       *mp;
+    nxt_buf_t      *b;
+    nxt_h2proto_t  *h2p;
+
+    b = obj;
+    h2p = data;
+    mp = b->data;
+
+    nxt_mp_free(mp, b);
+
+    h2p->queued_frames--;
+
+    if (h2p->read_blocked && h2p->queued_frames == 0) {
+        h2p->read_blocked = 0;
+
+        nxt_h2p_conn_read(task, h2p->conn, h2p);
+    }
+
+    nxt_mp_release(mp);
+}
+
+
+static void
+nxt_h2p_buf_drain(nxt_task_t *task, nxt_buf_t *b)
+{
+    nxt_buf_t         *next;
+    nxt_work_queue_t  *wq;
+
+    wq = &task->thread->engine->fast_work_queue;
+
+    while (b != NULL) {
+        next = b->next;
+        b->next = NULL;
+
+        nxt_work_queue_add(wq, b->completion_handler, task, b, b->parent);
+
+        b = next;
+    }
+}
+
+
+static void
+nxt_h2p_conn_output(nxt_task_t *task, nxt_h2proto_t *h2p, nxt_buf_t *out)
+{
+    nxt_conn_t  *c;
+    nxt_bool_t  write;
+
+    if (h2p->closed) {
+        nxt_h2p_buf_drain(task, out);
+        return;
+    }
+
+    c = h2p->conn;
+
+    write = (c->write == NULL);
+
+    *h2p->conn_write_tail = out;
+
+    while (out->next != NULL) {
+        out = out->next;
+    }
+
+    h2p->conn_write_tail = &out->next;
+
+    if (write) {
+        nxt_conn_write(task->thread->engine, c);
+    }
+}
+
+
+static const nxt_conn_state_t  nxt_h2p_send_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_sent,
+    .error_handler = nxt_h2p_conn_fail,
+
+    .timer_handler = nxt_h2p_conn_send_timeout,
+    .timer_value = nxt_h2p_conn_send_timer_value,
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_h2p_conn_sent(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_conn_t          *c;
+    nxt_h2proto_t       *h2p;
+    nxt_work_queue_t    *wq;
+    nxt_event_engine_t  *engine;
+
+    c = obj;
+    h2p = c->socket.data;
+
+    nxt_debug(task, "h2p conn sent");
+
+    if (h2p == NULL || h2p->closed) {
+        return;
+    }
+
+    engine = task->thread->engine;
+    wq = &engine->fast_work_queue;
+
+    /*
+     * The buffers are completed one by one because the completion
+     * handlers of buffers from different requests may differ.
+     */
+
+    b = c->write;
+
+    while (b != NULL) {
+        if (!nxt_buf_is_sync(b) && nxt_buf_used_size(b) != 0) {
+            break;
+        }
+
+        next = b->next;
+        b->next = NULL;
+
+        nxt_work_queue_add(wq, b->completion_handler, task, b, b->parent);
+
+        b = next;
+    }
+
+    c->write = b;
+
+    if (b == NULL) {
+        h2p->conn_write_tail = &c->write;
+
+    } else {
+        nxt_conn_write(engine, c);
+    }
+
+    nxt_h2p_close_test(task, h2p);
+}
+
+
+static void
+nxt_h2p_conn_fail(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t      *b;
+    nxt_conn_t     *c;
+    nxt_h2proto_t  *h2p;
+
+    c = obj;
+    h2p = c->socket.data;
+
+    nxt_debug(task, "h2p conn fail");
+
+    if (h2p == NULL || h2p->closed) {
+        return;
+    }
+
+    h2p->closed = 1;
+
+    nxt_timer_disable(task->thread->engine, &c->read_timer);
+    nxt_timer_disable(task->thread->engine, &c->write_timer);
+
+    b = c->write;
+    c->write = NULL;
+    h2p->conn_write_tail = &c->write;
+
+    nxt_h2p_buf_drain(task, b);
+
+    nxt_h2p_streams_abort(h2p);
+
+    nxt_h2p_close_test(task, h2p);
+}
+
+
+static void
+nxt_h2p_conn_error(nxt_task_t *task, nxt_h2proto_t *h2p, nxt_h2_error_t error)
+{
+    if (h2p->closing || h2p->closed) {
+        return;
+    }
+
+    if (error != NXT_H2_NO_ERROR) {
+        nxt_log(task, NXT_LOG_INFO, "h2p connection error %d", error);
+    }
+
+    if (nxt_slow_path(nxt_h2p_goaway_send(task, h2p, error) != NXT_OK)) {
+        nxt_h2p_conn_fail(task, h2p->conn, h2p);
+        return;
+    }
+
+    h2p->closing = 1;
+
+    if (h2p->idle) {
+        h2p->idle = 0;
+        nxt_conn_active(task->thread->engine, h2p->conn);
+    }
+
+    nxt_h2p_streams_abort(h2p);
+
+    nxt_h2p_close_test(task, h2p);
+}
+
+
+static void
+nxt_h2p_conn_read_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t      *c;
+    nxt_timer_t     *timer;
+    nxt_h2proto_t   *h2p;
+    nxt_h2stream_t  *st;
+
+    timer = obj;
+
+    nxt_debug(task, "h2p conn read timeout");
+
+    c = nxt_read_timer_conn(timer);
+    h2p = c->socket.data;
+
+    if (h2p->nstreams == 0) {
+        nxt_h2p_conn_error(task, h2p, NXT_H2_NO_ERROR);
+        return;
+    }
+
+    nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+        if (st->body_wait) {
+            st->body_status = NXT_HTTP_REQUEST_TIMEOUT;
+
+            nxt_h2p_request_body_ready(task, st);
+        }
+
+    } nxt_queue_loop;
+}
+
+
+static void
+nxt_h2p_conn_send_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "h2p conn send timeout");
+
+    c = nxt_write_timer_conn(timer);
+    c->block_write = 1;
+
+    nxt_h2p_conn_fail(task, c, c->socket.data);
+}
+
+
+static nxt_msec_t
+nxt_h2p_conn_read_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_h2proto_t            *h2p;
+    nxt_h2stream_t           *st;
+    nxt_socket_conf_joint_t  *joint;
+
+    h2p = c->socket.data;
+
+    if (h2p->nstreams == 0) {
+        joint = c->listen->socket.data;
+
+        if (nxt_fast_path(joint != NULL)) {
+            return joint->socket_conf->idle_timeout;
+        }
+
+        /*
+         * Listening socket had been closed while
+         * connection was in keep-alive state.
+         */
+        return 1;
+    }
+
+    nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+        if (st->body_wait) {
+            return st->request->conf->socket_conf->body_read_timeout;
+        }
+
+    } nxt_queue_loop;
+
+    return 0;
+}
+
+
+static nxt_msec_t
+nxt_h2p_conn_send_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_queue_link_t         *link;
+    nxt_h2proto_t            *h2p;
+    nxt_h2stream_t           *st;
+    nxt_socket_conf_joint_t  *joint;
+
+    h2p = c->socket.data;
+
+    if (h2p->nstreams != 0) {
+        link = nxt_queue_first(&h2p->streams);
+        st = nxt_queue_link_data(link, nxt_h2stream_t, link);
+
+        return st->request->conf->socket_conf->send_timeout;
+    }
+
+    joint = c->listen->socket.data;
+
+    if (nxt_fast_path(joint != NULL)) {
+        return joint->socket_conf->send_timeout;
+    }
+
+    return 10 * 1000;
+}
+
+
+static void
+nxt_h2p_streams_abort(nxt_h2proto_t *h2p)
+{
+    nxt_h2stream_t  *st;
+
+    nxt_queue_each(st, &h2p->streams, nxt_h2stream_t, link) {
+
+        nxt_h2p_stream_abort(st);
+
+    } nxt_queue_loop;
+}
+
+
+static void
+nxt_h2p_close_test(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    if (h2p->shutdown || h2p->nstreams != 0) {
+        return;
+    }
+
+    if (h2p->closed
+        || ((h2p->closing || h2p->goaway) && h2p->conn->write == NULL))
+    {
+        nxt_h2p_conn_close(task, h2p);
+    }
+}
+
+
+static void
+nxt_h2p_conn_close(nxt_task_t *task, nxt_h2proto_t *h2p)
+{
+    nxt_buf_t   *b;
+    nxt_conn_t  *c;
+
+    c = h2p->conn;
+
+    nxt_debug(task, "h2p conn close");
+
+    h2p->shutdown = 1;
+    h2p->closed = 1;
+
+    if (h2p->idle) {
+        h2p->idle = 0;
+        nxt_conn_active(task->thread->engine, c);
+    }
+
+    nxt_timer_disable(task->thread->engine, &c->read_timer);
+    nxt_timer_disable(task->thread->engine, &c->write_timer);
+
+    b = c->write;
+    c->write = NULL;
+
+    nxt_h2p_buf_drain(task, b);
+
+    nxt_h2p_closing(task, c);
+}
+
+
+static void
+nxt_h2p_closing(nxt_task_t *task, nxt_conn_t *c)
+{
+    nxt_debug(task, "h2p closing");
+
+    c->socket.data = NULL;
+
+#if (NXT_TLS)
+
+    if (c->u.tls != NULL) {
+        c->write_state = &nxt_h2p_shutdown_state;
+
+        c->io->shutdown(task, c, NULL);
+        return;
+    }
+
+#endif
+
+    nxt_h2p_conn_closing(task, c, NULL);
+}
+
+
+#if (NXT_TLS)
+
+static const nxt_conn_state_t  nxt_h2p_shutdown_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_closing,
+    .close_handler = nxt_h2p_conn_closing,
+    .error_handler = nxt_h2p_conn_closing,
+};
+
+#endif
+
+
+static void
+nxt_h2p_conn_closing(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    nxt_debug(task, "h2p conn closing");
+
+    c->write_state = &nxt_h2p_close_state;
+
+    nxt_conn_close(task->thread->engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_h2p_close_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_h2p_conn_free,
+};
+
+
+static void
+nxt_h2p_conn_free(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t          *c;
+    nxt_listen_event_t  *lev;
+    nxt_event_engine_t  *engine;
+
+    c = obj;
+
+    nxt_debug(task, "h2p conn free");
+
+    engine = task->thread->engine;
+
+    nxt_sockaddr_cache_free(engine, c);
+
+    lev = c->listen;
+
+    nxt_conn_free(task, c);
+
+    nxt_router_listen_event_release(&engine->task, lev, NULL);
+}
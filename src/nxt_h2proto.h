@@ -0,0 +1,182 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#ifndef _NXT_H2PROTO_H_INCLUDED_
+#define _NXT_H2PROTO_H_INCLUDED_
+
+
+#include <nxt_main.h>
+#include <nxt_http_parse.h>
+#include <nxt_http.h>
+#include <nxt_router.h>
+#include <nxt_hpack.h>
+
+
+#define NXT_H2_PREFACE              "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+#define NXT_H2_FRAME_HEADER_SIZE    9
+#define NXT_H2_DEFAULT_FRAME_SIZE   16384
+#define NXT_H2_MAX_FRAME_SIZE       ((1 << 24) - 1)
+#define NXT_H2_DEFAULT_WINDOW       65535
+#define NXT_H2_MAX_WINDOW           NXT_INT32_T_MAX
+#define NXT_H2_MAX_STREAMS          128
+
+/*
+ * Frames queued in reply to the client, such as PING and SETTINGS ACKs,
+ * WINDOW_UPDATE and RST_STREAM: reading stops when the first limit is
+ * reached until they are sent, and the connection is closed with
+ * ENHANCE_YOUR_CALM beyond the second one.
+ */
+#define NXT_H2_READ_QUEUED_FRAMES   128
+#define NXT_H2_MAX_QUEUED_FRAMES    1024
+
+/* Streams the client may reset in a period before being told to calm. */
+#define NXT_H2_MAX_RESETS           256
+#define NXT_H2_RESETS_PERIOD        1000
+
+/* The largest frame the client may send and the whole preface fit. */
+#define NXT_H2_READ_BUFFER_SIZE                                              \
+    (NXT_H2_FRAME_HEADER_SIZE + NXT_H2_DEFAULT_FRAME_SIZE + 1024)
+
+
+typedef enum {
+    NXT_H2_DATA = 0,
+    NXT_H2_HEADERS,
+    NXT_H2_PRIORITY,
+    NXT_H2_RST_STREAM,
+    NXT_H2_SETTINGS,
+    NXT_H2_PUSH_PROMISE,
+    NXT_H2_PING,
+    NXT_H2_GOAWAY,
+    NXT_H2_WINDOW_UPDATE,
+    NXT_H2_CONTINUATION,
+} nxt_h2_frame_type_t;
+
+
+#define NXT_H2_END_STREAM           0x01
+#define NXT_H2_ACK                  0x01
+#define NXT_H2_END_HEADERS          0x04
+#define NXT_H2_PADDED               0x08
+#define NXT_H2_PRIORITY_FLAG        0x20
+
+
+typedef enum {
+    NXT_H2_HEADER_TABLE_SIZE = 1,
+    NXT_H2_ENABLE_PUSH,
+    NXT_H2_MAX_CONCURRENT_STREAMS,
+    NXT_H2_INITIAL_WINDOW_SIZE,
+    NXT_H2_MAX_FRAME_SIZE_SETTING,
+    NXT_H2_MAX_HEADER_LIST_SIZE,
+} nxt_h2_setting_t;
+
+
+typedef enum {
+    NXT_H2_NO_ERROR = 0,
+    NXT_H2_PROTOCOL_ERROR,
+    NXT_H2_INTERNAL_ERROR,
+    NXT_H2_FLOW_CONTROL_ERROR,
+    NXT_H2_SETTINGS_TIMEOUT,
+    NXT_H2_STREAM_CLOSED,
+    NXT_H2_FRAME_SIZE_ERROR,
+    NXT_H2_REFUSED_STREAM,
+    NXT_H2_CANCEL,
+    NXT_H2_COMPRESSION_ERROR,
+    NXT_H2_CONNECT_ERROR,
+    NXT_H2_ENHANCE_YOUR_CALM,
+    NXT_H2_INADEQUATE_SECURITY,
+    NXT_H2_HTTP_1_1_REQUIRED,
+} nxt_h2_error_t;
+
+
+typedef struct nxt_h2proto_s  nxt_h2proto_t;
+
+
+struct nxt_h2stream_s {
+    uint32_t                  id;
+
+    int32_t                   send_window;
+    int32_t                   recv_window;
+    uint32_t                  recv_unacked;
+
+    nxt_h2proto_t             *h2p;
+    nxt_http_request_t        *request;
+    nxt_http_request_parse_t  parser;
+
+    /* Response buffers waiting for flow control windows. */
+    nxt_buf_t                 *out;
+
+    nxt_off_t                 body_received;
+    nxt_off_t                 body_sent;
+    nxt_http_status_t         body_status;
+
+    nxt_queue_link_t          link;          /* nxt_h2proto_t.streams */
+    nxt_queue_link_t          blocked_link;  /* nxt_h2proto_t.blocked */
+
+    uint8_t                   end_stream_received;  /* 1 bit */
+    uint8_t                   end_stream_sent;      /* 1 bit */
+    uint8_t                   body_wait;            /* 1 bit */
+    uint8_t                   body_requested;       /* 1 bit */
+    uint8_t                   out_held;             /* 1 bit */
+    uint8_t                   blocked;              /* 1 bit */
+    uint8_t                   reset;                /* 1 bit */
+    uint8_t                   aborted;              /* 1 bit */
+};
+
+
+struct nxt_h2proto_s {
+    nxt_conn_t                *conn;
+    nxt_buf_t                 **conn_write_tail;
+
+    nxt_hpack_t               hpack;
+
+    nxt_queue_t               streams;
+    nxt_queue_t               blocked;
+    nxt_uint_t                nstreams;
+
+    /* A header block being received in HEADERS and CONTINUATION frames. */
+    nxt_buf_t                 *header_block;
+    uint32_t                  header_stream_id;
+    uint8_t                   header_end_stream;    /* 1 bit */
+
+    int32_t                   send_window;
+    int32_t                   recv_window;
+    uint32_t                  recv_unacked;
+
+    int32_t                   initial_window;
+    uint32_t                  max_frame_size;
+    uint32_t                  last_stream_id;
+
+    nxt_uint_t                queued_frames;
+    nxt_uint_t                resets;
+    nxt_msec_t                resets_start;
+
+    uint8_t                   settings_received;    /* 1 bit */
+    uint8_t                   goaway;               /* 1 bit */
+    uint8_t                   closing;              /* 1 bit */
+    uint8_t                   closed;               /* 1 bit */
+    uint8_t                   shutdown;             /* 1 bit */
+    uint8_t                   idle;                 /* 1 bit */
+    uint8_t                   read_blocked;         /* 1 bit */
+};
+
+
+nxt_int_t nxt_h2p_preface_test(nxt_conn_t *c);
+void nxt_h2p_conn_init(nxt_task_t *task, nxt_conn_t *c);
+
+void nxt_h2p_request_body_read(nxt_task_t *task, nxt_http_request_t *r);
+void nxt_h2p_request_local_addr(nxt_task_t *task, nxt_http_request_t *r);
+void nxt_h2p_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t body_handler, void *data);
+void nxt_h2p_request_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *out);
+nxt_off_t nxt_h2p_request_body_bytes_sent(nxt_task_t *task,
+    nxt_http_proto_t proto);
+void nxt_h2p_request_discard(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *last);
+void nxt_h2p_request_close(nxt_task_t *task, nxt_http_proto_t proto,
+    nxt_socket_conf_joint_t *joint);
+
+
+#endif /* _NXT_H2PROTO_H_INCLUDED_ */
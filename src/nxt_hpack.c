@@ -0,0 +1,833 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_hpack.h>
+
+
+/*
+ * HPACK header compression for HTTP/2 (RFC 7541).
+ *
+ * The decoder supports the full format including the dynamic table and
+ * Huffman coded strings.  The encoder emits literal fields without indexing
+ * and without Huffman coding, so it keeps no state per connection.
+ */
+
+
+typedef struct {
+    uint32_t                 code;
+    uint32_t                 length;
+} nxt_hpack_huff_code_t;
+
+
+typedef struct {
+    uint8_t                  next;
+    uint8_t                  sym;
+    uint8_t                  flags;
+} nxt_hpack_huff_state_t;
+
+
+#define NXT_HPACK_HUFF_EMIT      0x01
+#define NXT_HPACK_HUFF_ACCEPT    0x02
+#define NXT_HPACK_HUFF_FAIL      0x04
+
+#define NXT_HPACK_HUFF_EOS       256
+#define NXT_HPACK_HUFF_NODES     256
+
+#define NXT_HPACK_STATIC_ENTRIES 61
+
+#define NXT_HPACK_MAX_INT        NXT_INT32_T_MAX
+
+
+static nxt_int_t nxt_hpack_decode_int(u_char **pos, const u_char *end,
+    nxt_uint_t prefix, uint32_t *value);
+static nxt_int_t nxt_hpack_decode_string(u_char **pos, const u_char *end,
+    nxt_mp_t *mp, nxt_str_t *str);
+static u_char *nxt_hpack_huff_decode(u_char *dst, const u_char *src,
+    size_t length);
+static nxt_int_t nxt_hpack_table_get(nxt_hpack_t *hp, uint32_t index,
+    nxt_mp_t *mp, nxt_str_t *name, nxt_str_t *value, nxt_bool_t name_only);
+static nxt_int_t nxt_hpack_copy(nxt_mp_t *mp, nxt_str_t *dst, u_char *src,
+    size_t length);
+static nxt_int_t nxt_hpack_table_add(nxt_hpack_t *hp, nxt_str_t *name,
+    nxt_str_t *value);
+static void nxt_hpack_table_evict(nxt_hpack_t *hp, size_t size);
+
+
+static const nxt_hpack_huff_code_t  nxt_hpack_huff_codes[257] = {
+    { 0x00001ff8, 13 }, { 0x007fffd8, 23 }, { 0x0fffffe2, 28 },
+    { 0x0fffffe3, 28 }, { 0x0fffffe4, 28 }, { 0x0fffffe5, 28 },
+    { 0x0fffffe6, 28 }, { 0x0fffffe7, 28 }, { 0x0fffffe8, 28 },
+    { 0x00ffffea, 24 }, { 0x3ffffffc, 30 }, { 0x0fffffe9, 28 },
+    { 0x0fffffea, 28 }, { 0x3ffffffd, 30 }, { 0x0fffffeb, 28 },
+    { 0x0fffffec, 28 }, { 0x0fffffed, 28 }, { 0x0fffffee, 28 },
+    { 0x0fffffef, 28 }, { 0x0ffffff0, 28 }, { 0x0ffffff1, 28 },
+    { 0x0ffffff2, 28 }, { 0x3ffffffe, 30 }, { 0x0ffffff3, 28 },
+    { 0x0ffffff4, 28 }, { 0x0ffffff5, 28 }, { 0x0ffffff6, 28 },
+    { 0x0ffffff7, 28 }, { 0x0ffffff8, 28 }, { 0x0ffffff9, 28 },
+    { 0x0ffffffa, 28 }, { 0x0ffffffb, 28 }, { 0x00000014,  6 },
+    { 0x000003f8, 10 }, { 0x000003f9, 10 }, { 0x00000ffa, 12 },
+    { 0x00001ff9, 13 }, { 0x00000015,  6 }, { 0x000000f8,  8 },
+    { 0x000007fa, 11 }, { 0x000003fa, 10 }, { 0x000003fb, 10 },
+    { 0x000000f9,  8 }, { 0x000007fb, 11 }, { 0x000000fa,  8 },
+    { 0x00000016,  6 }, { 0x00000017,  6 }, { 0x00000018,  6 },
+    { 0x00000000,  5 }, { 0x00000001,  5 }, { 0x00000002,  5 },
+    { 0x00000019,  6 }, { 0x0000001a,  6 }, { 0x0000001b,  6 },
+    { 0x0000001c,  6 }, { 0x0000001d,  6 }, { 0x0000001e,  6 },
+    { 0x0000001f,  6 }, { 0x0000005c,  7 }, { 0x000000fb,  8 },
+    { 0x00007ffc, 15 }, { 0x00000020,  6 }, { 0x00000ffb, 12 },
+    { 0x000003fc, 10 }, { 0x00001ffa, 13 }, { 0x00000021,  6 },
+    { 0x0000005d,  7 }, { 0x0000005e,  7 }, { 0x0000005f,  7 },
+    { 0x00000060,  7 }, { 0x00000061,  7 }, { 0x00000062,  7 },
+    { 0x00000063,  7 }, { 0x00000064,  7 }, { 0x00000065,  7 },
+    { 0x00000066,  7 }, { 0x00000067,  7 }, { 0x00000068,  7 },
+    { 0x00000069,  7 }, { 0x0000006a,  7 }, { 0x0000006b,  7 },
+    { 0x0000006c,  7 }, { 0x0000006d,  7 }, { 0x0000006e,  7 },
+    { 0x0000006f,  7 }, { 0x00000070,  7 }, { 0x00000071,  7 },
+    { 0x00000072,  7 }, { 0x000000fc,  8 }, { 0x00000073,  7 },
+    { 0x000000fd,  8 }, { 0x00001ffb, 13 }, { 0x0007fff0, 19 },
+    { 0x00001ffc, 13 }, { 0x00003ffc, 14 }, { 0x00000022,  6 },
+    { 0x00007ffd, 15 }, { 0x00000003,  5 }, { 0x00000023,  6 },
+    { 0x00000004,  5 }, { 0x00000024,  6 }, { 0x00000005,  5 },
+    { 0x00000025,  6 }, { 0x00000026,  6 }, { 0x00000027,  6 },
+    { 0x00000006,  5 }, { 0x00000074,  7 }, { 0x00000075,  7 },
+    { 0x00000028,  6 }, { 0x00000029,  6 }, { 0x0000002a,  6 },
+    { 0x00000007,  5 }, { 0x0000002b,  6 }, { 0x00000076,  7 },
+    { 0x0000002c,  6 }, { 0x00000008,  5 }, { 0x00000009,  5 },
+    { 0x0000002d,  6 }, { 0x00000077,  7 }, { 0x00000078,  7 },
+    { 0x00000079,  7 }, { 0x0000007a,  7 }, { 0x0000007b,  7 },
+    { 0x00007ffe, 15 }, { 0x000007fc, 11 }, { 0x00003ffd, 14 },
+    { 0x00001ffd, 13 }, { 0x0ffffffc, 28 }, { 0x000fffe6, 20 },
+    { 0x003fffd2, 22 }, { 0x000fffe7, 20 }, { 0x000fffe8, 20 },
+    { 0x003fffd3, 22 }, { 0x003fffd4, 22 }, { 0x003fffd5, 22 },
+    { 0x007fffd9, 23 }, { 0x003fffd6, 22 }, { 0x007fffda, 23 },
+    { 0x007fffdb, 23 }, { 0x007fffdc, 23 }, { 0x007fffdd, 23 },
+    { 0x007fffde, 23 }, { 0x00ffffeb, 24 }, { 0x007fffdf, 23 },
+    { 0x00ffffec, 24 }, { 0x00ffffed, 24 }, { 0x003fffd7, 22 },
+    { 0x007fffe0, 23 }, { 0x00ffffee, 24 }, { 0x007fffe1, 23 },
+    { 0x007fffe2, 23 }, { 0x007fffe3, 23 }, { 0x007fffe4, 23 },
+    { 0x001fffdc, 21 }, { 0x003fffd8, 22 }, { 0x007fffe5, 23 },
+    { 0x003fffd9, 22 }, { 0x007fffe6, 23 }, { 0x007fffe7, 23 },
+    { 0x00ffffef, 24 }, { 0x003fffda, 22 }, { 0x001fffdd, 21 },
+    { 0x000fffe9, 20 }, { 0x003fffdb, 22 }, { 0x003fffdc, 22 },
+    { 0x007fffe8, 23 }, { 0x007fffe9, 23 }, { 0x001fffde, 21 },
+    { 0x007fffea, 23 }, { 0x003fffdd, 22 }, { 0x003fffde, 22 },
+    { 0x00fffff0, 24 }, { 0x001fffdf, 21 }, { 0x003fffdf, 22 },
+    { 0x007fffeb, 23 }, { 0x007fffec, 23 }, { 0x001fffe0, 21 },
+    { 0x001fffe1, 21 }, { 0x003fffe0, 22 }, { 0x001fffe2, 21 },
+    { 0x007fffed, 23 }, { 0x003fffe1, 22 }, { 0x007fffee, 23 },
+    { 0x007fffef, 23 }, { 0x000fffea, 20 }, { 0x003fffe2, 22 },
+    { 0x003fffe3, 22 }, { 0x003fffe4, 22 }, { 0x007ffff0, 23 },
+    { 0x003fffe5, 22 }, { 0x003fffe6, 22 }, { 0x007ffff1, 23 },
+    { 0x03ffffe0, 26 }, { 0x03ffffe1, 26 }, { 0x000fffeb, 20 },
+    { 0x0007fff1, 19 }, { 0x003fffe7, 22 }, { 0x007ffff2, 23 },
+    { 0x003fffe8, 22 }, { 0x01ffffec, 25 }, { 0x03ffffe2, 26 },
+    { 0x03ffffe3, 26 }, { 0x03ffffe4, 26 }, { 0x07ffffde, 27 },
+    { 0x07ffffdf, 27 }, { 0x03ffffe5, 26 }, { 0x00fffff1, 24 },
+    { 0x01ffffed, 25 }, { 0x0007fff2, 19 }, { 0x001fffe3, 21 },
+    { 0x03ffffe6, 26 }, { 0x07ffffe0, 27 }, { 0x07ffffe1, 27 },
+    { 0x03ffffe7, 26 }, { 0x07ffffe2, 27 }, { 0x00fffff2, 24 },
+    { 0x001fffe4, 21 }, { 0x001fffe5, 21 }, { 0x03ffffe8, 26 },
+    { 0x03ffffe9, 26 }, { 0x0ffffffd, 28 }, { 0x07ffffe3, 27 },
+    { 0x07ffffe4, 27 }, { 0x07ffffe5, 27 }, { 0x000fffec, 20 },
+    { 0x00fffff3, 24 }, { 0x000fffed, 20 }, { 0x001fffe6, 21 },
+    { 0x003fffe9, 22 }, { 0x001fffe7, 21 }, { 0x001fffe8, 21 },
+    { 0x007ffff3, 23 }, { 0x003fffea, 22 }, { 0x003fffeb, 22 },
+    { 0x01ffffee, 25 }, { 0x01ffffef, 25 }, { 0x00fffff4, 24 },
+    { 0x00fffff5, 24 }, { 0x03ffffea, 26 }, { 0x007ffff4, 23 },
+    { 0x03ffffeb, 26 }, { 0x07ffffe6, 27 }, { 0x03ffffec, 26 },
+    { 0x03ffffed, 26 }, { 0x07ffffe7, 27 }, { 0x07ffffe8, 27 },
+    { 0x07ffffe9, 27 }, { 0x07ffffea, 27 }, { 0x07ffffeb, 27 },
+    { 0x0ffffffe, 28 }, { 0x07ffffec, 27 }, { 0x07ffffed, 27 },
+    { 0x07ffffee, 27 }, { 0x07ffffef, 27 }, { 0x07fffff0, 27 },
+    { 0x03ffffee, 26 }, { 0x3fffffff, 30 }
+};
+
+
+/*
+ * The Huffman decoder is a state machine consuming 4 bits at once.
+ * The states are internal nodes of the Huffman code tree.  Since the
+ * shortest code is 5 bits long, at most one symbol is emitted per step.
+ */
+static nxt_hpack_huff_state_t  nxt_hpack_huff_states[NXT_HPACK_HUFF_NODES][16];
+
+
+static const struct {
+    nxt_str_t                name;
+    nxt_str_t                value;
+} nxt_hpack_static_table[NXT_HPACK_STATIC_ENTRIES] = {
+    { nxt_string(":authority"),                  nxt_null_string },
+    { nxt_string(":method"),                     nxt_string("GET") },
+    { nxt_string(":method"),                     nxt_string("POST") },
+    { nxt_string(":path"),                       nxt_string("/") },
+    { nxt_string(":path"),                       nxt_string("/index.html") },
+    { nxt_string(":scheme"),                     nxt_string("http") },
+    { nxt_string(":scheme"),                     nxt_string("https") },
+    { nxt_string(":status"),                     nxt_string("200") },
+    { nxt_string(":status"),                     nxt_string("204") },
+    { nxt_string(":status"),                     nxt_string("206") },
+    { nxt_string(":status"),                     nxt_string("304") },
+    { nxt_string(":status"),                     nxt_string("400") },
+    { nxt_string(":status"),                     nxt_string("404") },
+    { nxt_string(":status"),                     nxt_string("500") },
+    { nxt_string("accept-charset"),              nxt_null_string },
+    { nxt_string("accept-encoding"),             nxt_string("gzip, deflate") },
+    { nxt_string("accept-language"),             nxt_null_string },
+    { nxt_string("accept-ranges"),               nxt_null_string },
+    { nxt_string("accept"),                      nxt_null_string },
+    { nxt_string("access-control-allow-origin"), nxt_null_string },
+    { nxt_string("age"),                         nxt_null_string },
+    { nxt_string("allow"),                       nxt_null_string },
+    { nxt_string("authorization"),               nxt_null_string },
+    { nxt_string("cache-control"),               nxt_null_string },
+    { nxt_string("content-disposition"),         nxt_null_string },
+    { nxt_string("content-encoding"),            nxt_null_string },
+    { nxt_string("content-language"),            nxt_null_string },
+    { nxt_string("content-length"),              nxt_null_string },
+    { nxt_string("content-location"),            nxt_null_string },
+    { nxt_string("content-range"),               nxt_null_string },
+    { nxt_string("content-type"),                nxt_null_string },
+    { nxt_string("cookie"),                      nxt_null_string },
+    { nxt_string("date"),                        nxt_null_string },
+    { nxt_string("etag"),                        nxt_null_string },
+    { nxt_string("expect"),                      nxt_null_string },
+    { nxt_string("expires"),                     nxt_null_string },
+    { nxt_string("from"),                        nxt_null_string },
+    { nxt_string("host"),                        nxt_null_string },
+    { nxt_string("if-match"),                    nxt_null_string },
+    { nxt_string("if-modified-since"),           nxt_null_string },
+    { nxt_string("if-none-match"),               nxt_null_string },
+    { nxt_string("if-range"),                    nxt_null_string },
+    { nxt_string("if-unmodified-since"),         nxt_null_string },
+    { nxt_string("last-modified"),               nxt_null_string },
+    { nxt_string("link"),                        nxt_null_string },
+    { nxt_string("location"),                    nxt_null_string },
+    { nxt_string("max-forwards"),                nxt_null_string },
+    { nxt_string("proxy-authenticate"),          nxt_null_string },
+    { nxt_string("proxy-authorization"),         nxt_null_string },
+    { nxt_string("range"),                       nxt_null_string },
+    { nxt_string("referer"),                     nxt_null_string },
+    { nxt_string("refresh"),                     nxt_null_string },
+    { nxt_string("retry-after"),                 nxt_null_string },
+    { nxt_string("server"),                      nxt_null_string },
+    { nxt_string("set-cookie"),                  nxt_null_string },
+    { nxt_string("strict-transport-security"),   nxt_null_string },
+    { nxt_string("transfer-encoding"),           nxt_null_string },
+    { nxt_string("user-agent"),                  nxt_null_string },
+    { nxt_string("vary"),                        nxt_null_string },
+    { nxt_string("via"),                         nxt_null_string },
+    { nxt_string("www-authenticate"),            nxt_null_string },
+};
+
+
+nxt_int_t
+nxt_hpack_init(void)
+{
+    int16_t     n;
+    uint8_t     flags, sym;
+    uint32_t    code;
+    nxt_uint_t  i, s, b, nodes, bit, length;
+
+    static int16_t     tree[NXT_HPACK_HUFF_NODES][2];
+    static uint8_t     accept[NXT_HPACK_HUFF_NODES];
+    static nxt_bool_t  done;
+
+    if (done) {
+        return NXT_OK;
+    }
+
+    /*
+     * Tree children are either internal node numbers, or symbols
+     * encoded as -(sym + 1).  Zero means an absent child since the
+     * root node is never a child.
+     */
+
+    nodes = 1;
+
+    for (i = 0; i < nxt_nitems(nxt_hpack_huff_codes); i++) {
+        code = nxt_hpack_huff_codes[i].code;
+        length = nxt_hpack_huff_codes[i].length;
+
+        n = 0;
+
+        while (--length != 0) {
+            bit = (code >> length) & 1;
+
+            if (tree[n][bit] == 0) {
+                if (nxt_slow_path(nodes == NXT_HPACK_HUFF_NODES)) {
+                    return NXT_ERROR;
+                }
+
+                tree[n][bit] = nodes++;
+
+            } else if (nxt_slow_path(tree[n][bit] < 0)) {
+                return NXT_ERROR;
+            }
+
+            n = tree[n][bit];
+        }
+
+        tree[n][code & 1] = -(int16_t) (i + 1);
+    }
+
+    /*
+     * A string may end with a padding of up to 7 bits that corresponds
+     * to the most significant bits of the EOS code, i.e. all ones.
+     */
+
+    n = 0;
+
+    for (i = 0; i < 8 && n >= 0; i++) {
+        accept[n] = 1;
+        n = tree[n][1];
+    }
+
+    for (s = 0; s < NXT_HPACK_HUFF_NODES; s++) {
+
+        for (i = 0; i < 16; i++) {
+            n = s;
+            sym = 0;
+            flags = 0;
+
+            for (b = 4; b != 0; b--) {
+                n = tree[n][(i >> (b - 1)) & 1];
+
+                if (n < 0) {
+                    if (-n - 1 == NXT_HPACK_HUFF_EOS) {
+                        flags = NXT_HPACK_HUFF_FAIL;
+                        break;
+                    }
+
+                    flags = NXT_HPACK_HUFF_EMIT;
+                    sym = -n - 1;
+                    n = 0;
+                }
+            }
+
+            if (flags != NXT_HPACK_HUFF_FAIL) {
+                nxt_hpack_huff_states[s][i].next = n;
+
+                if (accept[n]) {
+                    flags |= NXT_HPACK_HUFF_ACCEPT;
+                }
+            }
+
+            nxt_hpack_huff_states[s][i].sym = sym;
+            nxt_hpack_huff_states[s][i].flags = flags;
+        }
+    }
+
+    done = 1;
+
+    return NXT_OK;
+}
+
+
+void
+nxt_hpack_table_init(nxt_hpack_t *hp, nxt_mp_t *mp, size_t limit)
+{
+    nxt_memzero(hp, sizeof(nxt_hpack_t));
+
+    hp->mem_pool = mp;
+    hp->limit = nxt_min(limit, NXT_HPACK_TABLE_SIZE);
+    hp->max_size = hp->limit;
+}
+
+
+void
+nxt_hpack_table_free(nxt_hpack_t *hp)
+{
+    nxt_hpack_table_evict(hp, hp->size);
+}
+
+
+/*
+ * Decodes the next field of a header block.  The returned strings are
+ * allocated from the "mp" pool unless they refer to the static table.
+ */
+
+nxt_int_t
+nxt_hpack_decode(nxt_hpack_t *hp, u_char **pos, const u_char *end,
+    nxt_mp_t *mp, nxt_str_t *name, nxt_str_t *value)
+{
+    u_char      ch;
+    uint32_t    index;
+    nxt_int_t   ret;
+    nxt_uint_t  prefix;
+    nxt_bool_t  indexing;
+
+    for ( ;; ) {
+        if (*pos == end) {
+            return NXT_DONE;
+        }
+
+        ch = **pos;
+
+        if (ch & 0x80) {
+            /* An indexed field. */
+
+            if (nxt_slow_path(nxt_hpack_decode_int(pos, end, 7, &index)
+                              != NXT_OK))
+            {
+                return NXT_ERROR;
+            }
+
+            return nxt_hpack_table_get(hp, index, mp, name, value, 0);
+        }
+
+        if ((ch & 0xe0) != 0x20) {
+            break;
+        }
+
+        /* A dynamic table size update. */
+
+        if (nxt_slow_path(nxt_hpack_decode_int(pos, end, 5, &index)
+                          != NXT_OK
+                          || index > hp->limit))
+        {
+            return NXT_ERROR;
+        }
+
+        hp->max_size = index;
+
+        if (hp->size > hp->max_size) {
+            nxt_hpack_table_evict(hp, hp->size - hp->max_size);
+        }
+    }
+
+    if (ch & 0x40) {
+        /* A literal field with incremental indexing. */
+        indexing = 1;
+        prefix = 6;
+
+    } else {
+        /* A literal field without indexing or never indexed. */
+        indexing = 0;
+        prefix = 4;
+    }
+
+    if (nxt_slow_path(nxt_hpack_decode_int(pos, end, prefix, &index)
+                      != NXT_OK))
+    {
+        return NXT_ERROR;
+    }
+
+    if (index != 0) {
+        ret = nxt_hpack_table_get(hp, index, mp, name, NULL, 1);
+
+    } else {
+        ret = nxt_hpack_decode_string(pos, end, mp, name);
+    }
+
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_hpack_decode_string(pos, end, mp, value);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    if (indexing) {
+        return nxt_hpack_table_add(hp, name, value);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_decode_int(u_char **pos, const u_char *end, nxt_uint_t prefix,
+    uint32_t *value)
+{
+    u_char      *p, ch;
+    uint32_t    v, mask;
+    nxt_uint_t  shift;
+
+    p = *pos;
+    mask = (1 << prefix) - 1;
+
+    v = *p++ & mask;
+
+    if (v == mask) {
+        shift = 0;
+
+        do {
+            if (nxt_slow_path(p == end || shift > 28)) {
+                return NXT_ERROR;
+            }
+
+            ch = *p++;
+
+            /* The bits above 31 would be lost in the shift. */
+            if (nxt_slow_path(shift == 28 && (ch & 0x7f) > 0x7)) {
+                return NXT_ERROR;
+            }
+
+            v += (uint32_t) (ch & 0x7f) << shift;
+            shift += 7;
+
+            if (nxt_slow_path(v > NXT_HPACK_MAX_INT)) {
+                return NXT_ERROR;
+            }
+
+        } while (ch & 0x80);
+    }
+
+    *pos = p;
+    *value = v;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_decode_string(u_char **pos, const u_char *end, nxt_mp_t *mp,
+    nxt_str_t *str)
+{
+    u_char      *p, *start, *last;
+    uint32_t    length;
+    nxt_bool_t  huffman;
+
+    if (nxt_slow_path(*pos == end)) {
+        return NXT_ERROR;
+    }
+
+    huffman = ((**pos & 0x80) != 0);
+
+    if (nxt_slow_path(nxt_hpack_decode_int(pos, end, 7, &length) != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    p = *pos;
+
+    if (nxt_slow_path((size_t) (end - p) < length)) {
+        return NXT_ERROR;
+    }
+
+    *pos = p + length;
+
+    if (length == 0) {
+        str->length = 0;
+        str->start = (u_char *) "";
+        return NXT_OK;
+    }
+
+    if (!huffman) {
+        return nxt_hpack_copy(mp, str, p, length);
+    }
+
+    /* The shortest code is 5 bits long. */
+
+    start = nxt_mp_nget(mp, length * 8 / 5);
+    if (nxt_slow_path(start == NULL)) {
+        return NXT_ERROR;
+    }
+
+    last = nxt_hpack_huff_decode(start, p, length);
+    if (nxt_slow_path(last == NULL)) {
+        return NXT_ERROR;
+    }
+
+    str->start = start;
+    str->length = last - start;
+
+    return NXT_OK;
+}
+
+
+static u_char *
+nxt_hpack_huff_decode(u_char *dst, const u_char *src, size_t length)
+{
+    uint8_t                 flags;
+    nxt_uint_t              state;
+    const u_char            *end;
+    nxt_hpack_huff_state_t  *st;
+
+    state = 0;
+    flags = NXT_HPACK_HUFF_ACCEPT;
+    end = src + length;
+
+    while (src < end) {
+        st = &nxt_hpack_huff_states[state][*src >> 4];
+
+        if (nxt_slow_path(st->flags & NXT_HPACK_HUFF_FAIL)) {
+            return NULL;
+        }
+
+        if (st->flags & NXT_HPACK_HUFF_EMIT) {
+            *dst++ = st->sym;
+        }
+
+        st = &nxt_hpack_huff_states[st->next][*src++ & 0x0f];
+
+        if (nxt_slow_path(st->flags & NXT_HPACK_HUFF_FAIL)) {
+            return NULL;
+        }
+
+        if (st->flags & NXT_HPACK_HUFF_EMIT) {
+            *dst++ = st->sym;
+        }
+
+        state = st->next;
+        flags = st->flags;
+    }
+
+    if (nxt_slow_path((flags & NXT_HPACK_HUFF_ACCEPT) == 0)) {
+        return NULL;
+    }
+
+    return dst;
+}
+
+
+static nxt_int_t
+nxt_hpack_table_get(nxt_hpack_t *hp, uint32_t index, nxt_mp_t *mp,
+    nxt_str_t *name, nxt_str_t *value, nxt_bool_t name_only)
+{
+    nxt_hpack_entry_t  *e;
+
+    if (nxt_slow_path(index == 0)) {
+        return NXT_ERROR;
+    }
+
+    if (index <= NXT_HPACK_STATIC_ENTRIES) {
+        *name = nxt_hpack_static_table[index - 1].name;
+
+        if (!name_only) {
+            *value = nxt_hpack_static_table[index - 1].value;
+
+            if (value->start == NULL) {
+                value->start = (u_char *) "";
+            }
+        }
+
+        return NXT_OK;
+    }
+
+    index -= NXT_HPACK_STATIC_ENTRIES + 1;
+
+    if (nxt_slow_path(index >= hp->count)) {
+        return NXT_ERROR;
+    }
+
+    e = hp->entries[(hp->next - 1 - index) & (NXT_HPACK_ENTRIES - 1)];
+
+    /*
+     * The entry can be evicted by subsequent fields of the same header
+     * block, so the strings are copied.
+     */
+
+    if (nxt_slow_path(nxt_hpack_copy(mp, name, e->name, e->name_length)
+                      != NXT_OK))
+    {
+        return NXT_ERROR;
+    }
+
+    if (!name_only) {
+        return nxt_hpack_copy(mp, value, e->value, e->value_length);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_copy(nxt_mp_t *mp, nxt_str_t *dst, u_char *src, size_t length)
+{
+    dst->length = length;
+
+    if (length == 0) {
+        dst->start = (u_char *) "";
+        return NXT_OK;
+    }
+
+    dst->start = nxt_mp_nget(mp, length);
+    if (nxt_slow_path(dst->start == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_memcpy(dst->start, src, length);
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_table_add(nxt_hpack_t *hp, nxt_str_t *name, nxt_str_t *value)
+{
+    size_t             size;
+    nxt_hpack_entry_t  *e;
+
+    size = name->length + value->length + NXT_HPACK_ENTRY_OVERHEAD;
+
+    if (size > hp->max_size) {
+        /* RFC 7541, 4.4: an entry larger than the table empties it. */
+        nxt_hpack_table_evict(hp, hp->size);
+        return NXT_OK;
+    }
+
+    if (hp->size + size > hp->max_size) {
+        nxt_hpack_table_evict(hp, hp->size + size - hp->max_size);
+    }
+
+    e = nxt_mp_alloc(hp->mem_pool, sizeof(nxt_hpack_entry_t)
+                                   + name->length + value->length);
+    if (nxt_slow_path(e == NULL)) {
+        return NXT_ERROR;
+    }
+
+    e->size = size;
+    e->name_length = name->length;
+    e->value_length = value->length;
+    e->name = (u_char *) e + sizeof(nxt_hpack_entry_t);
+    e->value = nxt_cpymem(e->name, name->start, name->length);
+
+    nxt_memcpy(e->value, value->start, value->length);
+
+    hp->entries[hp->next] = e;
+    hp->next = (hp->next + 1) & (NXT_HPACK_ENTRIES - 1);
+    hp->count++;
+    hp->size += size;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_hpack_table_evict(nxt_hpack_t *hp, size_t size)
+{
+    size_t             evicted;
+    nxt_uint_t         oldest;
+    nxt_hpack_entry_t  *e;
+
+    evicted = 0;
+
+    while (evicted < size && hp->count != 0) {
+        oldest = (hp->next - hp->count) & (NXT_HPACK_ENTRIES - 1);
+
+        e = hp->entries[oldest];
+        hp->entries[oldest] = NULL;
+
+        evicted += e->size;
+        hp->size -= e->size;
+        hp->count--;
+
+        nxt_mp_free(hp->mem_pool, e);
+    }
+}
+
+
+u_char *
+nxt_hpack_encode_int(u_char *p, u_char flags, nxt_uint_t prefix, size_t value)
+{
+    size_t  mask;
+
+    mask = (1 << prefix) - 1;
+
+    if (value < mask) {
+        *p++ = flags | value;
+        return p;
+    }
+
+    *p++ = flags | mask;
+    value -= mask;
+
+    while (value >= 0x80) {
+        *p++ = (u_char) (value | 0x80);
+        value >>= 7;
+    }
+
+    *p++ = (u_char) value;
+
+    return p;
+}
+
+
+u_char *
+nxt_hpack_encode_status(u_char *p, nxt_uint_t status)
+{
+    switch (status) {
+
+    case 200:
+        *p++ = 0x80 | 8;
+        return p;
+
+    case 204:
+        *p++ = 0x80 | 9;
+        return p;
+
+    case 206:
+        *p++ = 0x80 | 10;
+        return p;
+
+    case 304:
+        *p++ = 0x80 | 11;
+        return p;
+
+    case 400:
+        *p++ = 0x80 | 12;
+        return p;
+
+    case 404:
+        *p++ = 0x80 | 13;
+        return p;
+
+    case 500:
+        *p++ = 0x80 | 14;
+        return p;
+    }
+
+    /* A literal field without indexing, the ":status" name index is 8. */
+
+    *p++ = 0x08;
+    *p++ = 3;
+
+    *p++ = '0' + (status / 100) % 10;
+    *p++ = '0' + (status / 10) % 10;
+    *p++ = '0' + status % 10;
+
+    return p;
+}
+
+
+/*
+ * Encodes a field as a literal without indexing.  The name is converted
+ * to lowercase as required by HTTP/2.
+ */
+
+u_char *
+nxt_hpack_encode_field(u_char *p, u_char *name, size_t name_length,
+    u_char *value, size_t value_length)
+{
+    nxt_uint_t       i;
+    const nxt_str_t  *s;
+
+    /* The response fields start from "accept-charset". */
+
+    for (i = 14; i < NXT_HPACK_STATIC_ENTRIES; i++) {
+        s = &nxt_hpack_static_table[i].name;
+
+        if (s->length == name_length
+            && nxt_memcasecmp(s->start, name, name_length) == 0)
+        {
+            p = nxt_hpack_encode_int(p, 0x00, 4, i + 1);
+            goto value;
+        }
+    }
+
+    *p++ = 0x00;
+    p = nxt_hpack_encode_int(p, 0x00, 7, name_length);
+
+    for (i = 0; i < name_length; i++) {
+        *p++ = nxt_lowcase(name[i]);
+    }
+
+value:
+
+    p = nxt_hpack_encode_int(p, 0x00, 7, value_length);
+
+    return nxt_cpymem(p, value, value_length);
+}
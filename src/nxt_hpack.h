@@ -0,0 +1,59 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#ifndef _NXT_HPACK_H_INCLUDED_
+#define _NXT_HPACK_H_INCLUDED_
+
+
+#define NXT_HPACK_TABLE_SIZE     4096
+#define NXT_HPACK_ENTRY_OVERHEAD 32
+#define NXT_HPACK_ENTRIES        (NXT_HPACK_TABLE_SIZE / NXT_HPACK_ENTRY_OVERHEAD)
+
+/*
+ * The upper bound of the encoded field size excluding name and value:
+ * a representation byte with up to 2 bytes of index and up to 5 bytes
+ * for each of the name and value lengths.
+ */
+#define NXT_HPACK_FIELD_OVERHEAD 12
+
+
+typedef struct {
+    uint32_t                 size;
+    uint32_t                 name_length;
+    uint32_t                 value_length;
+    u_char                   *name;
+    u_char                   *value;
+} nxt_hpack_entry_t;
+
+
+typedef struct {
+    nxt_mp_t                 *mem_pool;
+
+    size_t                   size;
+    size_t                   max_size;
+    size_t                   limit;
+
+    nxt_uint_t               next;
+    nxt_uint_t               count;
+
+    nxt_hpack_entry_t        *entries[NXT_HPACK_ENTRIES];
+} nxt_hpack_t;
+
+
+nxt_int_t nxt_hpack_init(void);
+void nxt_hpack_table_init(nxt_hpack_t *hp, nxt_mp_t *mp, size_t limit);
+void nxt_hpack_table_free(nxt_hpack_t *hp);
+
+nxt_int_t nxt_hpack_decode(nxt_hpack_t *hp, u_char **pos, const u_char *end,
+    nxt_mp_t *mp, nxt_str_t *name, nxt_str_t *value);
+
+u_char *nxt_hpack_encode_int(u_char *p, u_char flags, nxt_uint_t prefix,
+    size_t value);
+u_char *nxt_hpack_encode_status(u_char *p, nxt_uint_t status);
+u_char *nxt_hpack_encode_field(u_char *p, u_char *name, size_t name_length,
+    u_char *value, size_t value_length);
+
+
+#endif /* _NXT_HPACK_H_INCLUDED_ */
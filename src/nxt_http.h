@@ -69,6 +69,20 @@ typedef enum {
 } nxt_http_protocol_t;
 
 
+typedef enum {
+    NXT_HTTP_CACHE_NONE = 0,
+    NXT_HTTP_CACHE_BYPASS,
+    NXT_HTTP_CACHE_MISS,
+    NXT_HTTP_CACHE_EXPIRED,
+    NXT_HTTP_CACHE_UPDATING,
+    NXT_HTTP_CACHE_HIT,
+} nxt_http_cache_status_t;
+
+
+typedef struct nxt_http_cache_ctx_s  nxt_http_cache_ctx_t;
+typedef struct nxt_http_limit_ctx_s  nxt_http_limit_ctx_t;
+
+
 typedef struct {
     nxt_work_handler_t              ready_handler;
     nxt_work_handler_t              error_handler;
@@ -76,6 +90,7 @@ typedef struct {
 
 
 typedef struct nxt_h1proto_s        nxt_h1proto_t;
+typedef struct nxt_h2stream_s       nxt_h2stream_t;
 
 struct nxt_h1p_websocket_timer_s {
     nxt_timer_t                     timer;
@@ -87,6 +102,7 @@ struct nxt_h1p_websocket_timer_s {
 typedef union {
     void                            *any;
     nxt_h1proto_t                   *h1;
+    nxt_h2stream_t                  *h2;
 } nxt_http_proto_t;
 
 
@@ -178,8 +194,12 @@ struct nxt_http_request_s {
     nxt_tstr_cache_t                tstr_cache;
 
     nxt_http_action_t               *action;
+    nxt_http_action_t               *body_action;
     void                            *req_rpc_data;
 
+    nxt_http_cache_ctx_t            *cache;
+    nxt_http_limit_ctx_t            *limit;
+
 #if (NXT_HAVE_REGEX)
     nxt_regex_match_t               *regex_match;
 #endif
@@ -187,7 +207,11 @@ struct nxt_http_request_s {
     nxt_http_peer_t                 *peer;
     nxt_buf_t                       *last;
 
-    nxt_queue_link_t                app_link;   /* nxt_app_t.ack_waiting_req */
+    /* The route step and the application or upstream of the request. */
+    struct nxt_router_metric_s      *route_metric;
+    struct nxt_router_metric_s      *target_metric;
+
+    nxt_queue_link_t                app_link;   /* engine app_requests */
     nxt_event_engine_t              *engine;
     nxt_work_t                      err_work;
 
@@ -213,6 +237,8 @@ struct nxt_http_request_s {
     uint8_t                         error;        /* 1 bit  */
     uint8_t                         websocket_handshake;  /* 1 bit */
     uint8_t                         chunked;  /* 1 bit */
+    uint8_t                         body_stream;  /* 1 bit */
+    uint8_t                         cache_status;  /* 3 bits */
 };
 
 
@@ -235,6 +261,8 @@ typedef enum {
 typedef struct nxt_http_route_s            nxt_http_route_t;
 typedef struct nxt_http_route_rule_s       nxt_http_route_rule_t;
 typedef struct nxt_http_route_addr_rule_s  nxt_http_route_addr_rule_t;
+typedef struct nxt_http_cache_conf_s       nxt_http_cache_conf_t;
+typedef struct nxt_http_limit_conf_s       nxt_http_limit_conf_t;
 
 
 typedef struct {
@@ -251,6 +279,8 @@ typedef struct {
     nxt_conf_value_t                *traverse_mounts;
     nxt_conf_value_t                *types;
     nxt_conf_value_t                *fallback;
+    nxt_conf_value_t                *cache;
+    nxt_conf_value_t                *limit;
 } nxt_http_action_conf_t;
 
 
@@ -270,15 +300,20 @@ struct nxt_http_action_s {
     nxt_tstr_t                      *rewrite;
     nxt_array_t                     *set_headers;  /* of nxt_http_field_t */
     nxt_http_action_t               *fallback;
+    nxt_http_cache_conf_t           *cache;
+    nxt_http_limit_conf_t           *limit;
 };
 
 
 typedef struct {
     void (*body_read)(nxt_task_t *task, nxt_http_request_t *r);
+    void (*body_stream)(nxt_task_t *task, nxt_http_request_t *r,
+        nxt_work_handler_t handler);
     void (*local_addr)(nxt_task_t *task, nxt_http_request_t *r);
     void (*header_send)(nxt_task_t *task, nxt_http_request_t *r,
         nxt_work_handler_t body_handler, void *data);
     void (*send)(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out);
+    nxt_bool_t (*sendfile)(nxt_task_t *task, nxt_http_request_t *r);
     nxt_off_t (*body_bytes_sent)(nxt_task_t *task, nxt_http_proto_t proto);
     void (*discard)(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *last);
     void (*close)(nxt_task_t *task, nxt_http_proto_t proto,
@@ -331,6 +366,8 @@ nxt_http_date(u_char *buf, struct tm *tm)
 
 nxt_int_t nxt_http_init(nxt_task_t *task);
 nxt_int_t nxt_h1p_init(nxt_task_t *task);
+void nxt_h1p_peer_idle_close_all(nxt_event_engine_t *engine);
+nxt_int_t nxt_h2p_init(nxt_task_t *task);
 nxt_int_t nxt_http_response_hash_init(nxt_task_t *task);
 
 void nxt_http_conn_init(nxt_task_t *task, void *obj, void *data);
@@ -338,12 +375,15 @@ nxt_http_request_t *nxt_http_request_create(nxt_task_t *task);
 void nxt_http_request_error(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_status_t status);
 void nxt_http_request_read_body(nxt_task_t *task, nxt_http_request_t *r);
+void nxt_http_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t handler);
 void nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t body_handler, void *data);
 void nxt_http_request_ws_frame_start(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *ws_frame);
 void nxt_http_request_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_buf_t *out);
+nxt_bool_t nxt_http_request_sendfile(nxt_task_t *task, nxt_http_request_t *r);
 nxt_buf_t *nxt_http_buf_mem(nxt_task_t *task, nxt_http_request_t *r,
     size_t size);
 nxt_buf_t *nxt_http_buf_last(nxt_http_request_t *r);
@@ -368,8 +408,13 @@ int64_t nxt_http_cookie_hash(nxt_mp_t *mp, nxt_str_t *name);
 
 nxt_http_routes_t *nxt_http_routes_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *routes_conf);
+nxt_http_action_t *nxt_http_routes_match(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_routes_t *routes, nxt_uint_t n,
+    uint32_t *step);
 nxt_http_action_t *nxt_http_action_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_str_t *pass);
+nxt_http_action_t *nxt_http_route_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_action_t *start);
 nxt_int_t nxt_http_routes_resolve(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf);
 nxt_int_t nxt_http_pass_segments(nxt_mp_t *mp, nxt_str_t *pass,
@@ -394,6 +439,9 @@ nxt_int_t nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *conf);
 nxt_int_t nxt_upstreams_joint_create(nxt_router_temp_conf_t *tmcf,
     nxt_upstream_t ***upstream_joint);
+void nxt_upstreams_health_start(nxt_task_t *task, nxt_upstreams_health_t *uh);
+void nxt_upstreams_health_use(nxt_upstreams_health_t *uh);
+void nxt_upstreams_health_release(nxt_upstreams_health_t *uh);
 
 nxt_int_t nxt_http_rewrite_init(nxt_router_conf_t *rtcf,
     nxt_http_action_t *action, nxt_http_action_conf_t *acf);
@@ -413,6 +461,30 @@ nxt_int_t nxt_http_static_mtypes_hash_add(nxt_mp_t *mp, nxt_lvlhsh_t *hash,
     const nxt_str_t *exten, nxt_str_t *type);
 nxt_str_t *nxt_http_static_mtype_get(nxt_lvlhsh_t *hash,
     const nxt_str_t *exten);
+void nxt_http_static_cache_release(nxt_task_t *task,
+    nxt_http_static_cache_t *cache);
+void nxt_http_static_body_handler(nxt_task_t *task, void *obj, void *data);
+void nxt_http_static_sendfile_handler(nxt_task_t *task, void *obj,
+    void *data);
+
+nxt_int_t nxt_http_cache_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf);
+void nxt_http_caches_release(nxt_task_t *task, nxt_router_conf_t *rtcf);
+nxt_http_action_t *nxt_http_cache_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_action_t *action);
+void nxt_http_cache_header_filter(nxt_task_t *task, nxt_http_request_t *r);
+void nxt_http_cache_body_filter(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *out);
+void nxt_http_cache_close(nxt_task_t *task, nxt_http_request_t *r);
+
+nxt_int_t nxt_http_limit_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf);
+nxt_int_t nxt_http_limit_zones_init(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_http_action_t *action, nxt_str_t *name);
+void nxt_http_limits_release(nxt_task_t *task, nxt_router_conf_t *rtcf);
+nxt_http_action_t *nxt_http_limit_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_action_t *action);
+void nxt_http_limit_close(nxt_task_t *task, nxt_http_request_t *r);
 
 nxt_http_action_t *nxt_http_application_handler(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_action_t *action);
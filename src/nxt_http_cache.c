@@ -0,0 +1,2171 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+
+
+typedef struct {
+    uint16_t                    hash;
+    uint16_t                    name_length;
+    uint32_t                    value_length;
+} nxt_http_cache_field_t;
+
+
+typedef struct nxt_http_cache_node_s  nxt_http_cache_node_t;
+
+
+typedef struct {
+    nxt_http_cache_node_t       *node;      /* NULL if not in the cache. */
+    nxt_queue_link_t            node_link;  /* nxt_http_cache_node_t.entries */
+    nxt_queue_link_t            link;       /* LRU, valid entries only. */
+
+    nxt_fd_t                    fd;
+    nxt_off_t                   size;
+
+    nxt_time_t                  date;
+    nxt_time_t                  expires;
+    nxt_time_t                  stale;
+
+    nxt_str_t                   vary;
+    nxt_str_t                   variant;
+
+    nxt_queue_t                 waiters;    /* of nxt_http_cache_ctx_t */
+
+    nxt_http_cache_field_t      *fields;
+    u_char                      *data;
+    uint32_t                    nfields;
+    uint32_t                    data_size;
+
+    uint32_t                    refs;       /* Under the cache lock. */
+
+    nxt_http_status_t           status:16;
+    uint8_t                     valid;      /* 1 bit */
+    uint8_t                     updating;   /* 1 bit */
+} nxt_http_cache_entry_t;
+
+
+/*
+ * A key node holds the variants of a response which differ by the
+ * request header values listed in "Vary", and placeholders of the
+ * variants being filled.  A placeholder takes "Vary" of a stored
+ * variant, so only requests of the same variant wait for the fill.
+ */
+
+struct nxt_http_cache_node_s {
+    nxt_str_t                   key;
+    nxt_queue_t                 entries;    /* of nxt_http_cache_entry_t */
+};
+
+
+/*
+ * A cache index is shared by all router threads and by all router
+ * configurations which use the same cache path, so it is protected by
+ * a spinlock.  Response bodies are stored in unlinked temporary files,
+ * and a hit sends a duplicate of the entry descriptor, so an entry can
+ * be replaced or evicted while its body is being sent.  A hit holds an
+ * entry reference only while the response header is restored, so the
+ * lock is never held during memory allocations or system calls.
+ */
+
+struct nxt_http_cache_s {
+    nxt_queue_link_t            link;       /* nxt_router_t.caches */
+    uint32_t                    count;
+
+    nxt_thread_spinlock_t       lock;
+    nxt_lvlhsh_t                hash;
+    nxt_queue_t                 lru;
+    uint32_t                    entries;
+    uint32_t                    max_entries;
+
+    nxt_str_t                   path;
+};
+
+
+struct nxt_http_cache_conf_s {
+    nxt_http_cache_t            *cache;
+    nxt_tstr_t                  *key;
+    nxt_time_t                  valid;
+    nxt_off_t                   max_size;
+    nxt_msec_t                  lock_timeout;
+};
+
+
+/*
+ * A response body is written to the cache file by the router thread pool.
+ * A store is referenced by the request and by each pending write, and the
+ * last reference publishes the entry or discards it if a write has failed
+ * or the response has not been completed.
+ */
+
+typedef struct {
+    nxt_router_t                *router;
+    nxt_http_cache_t            *cache;     /* Referenced. */
+    nxt_http_cache_entry_t      *entry;
+    nxt_http_cache_entry_t      *fill;
+
+    nxt_str_t                   key;
+    uint32_t                    key_hash;
+
+    nxt_atomic_t                count;
+    nxt_atomic_t                backlog;
+
+    uint8_t                     complete;   /* 1 bit */
+    uint8_t                     failed;     /* 1 bit */
+} nxt_http_cache_store_t;
+
+
+typedef struct {
+    nxt_work_t                  work;
+    nxt_task_t                  task;
+    nxt_http_cache_store_t      *store;
+    nxt_off_t                   offset;
+    size_t                      size;
+} nxt_http_cache_write_t;
+
+
+typedef enum {
+    NXT_HTTP_CACHE_DONE = 0,
+    NXT_HTTP_CACHE_WAIT,
+    NXT_HTTP_CACHE_FILL,
+    NXT_HTTP_CACHE_STORE,
+} nxt_http_cache_state_t;
+
+
+struct nxt_http_cache_ctx_s {
+    nxt_http_cache_conf_t       *conf;
+    nxt_http_action_t           *action;
+    nxt_http_cache_entry_t      *fill;      /* Being replaced. */
+    nxt_http_cache_store_t      *store;
+
+    nxt_str_t                   key;
+    uint32_t                    key_hash;
+
+    nxt_queue_link_t            link;       /* nxt_http_cache_entry_t */
+    nxt_http_request_t          *request;
+    nxt_event_engine_t          *engine;
+    nxt_work_t                  work;
+    nxt_timer_t                 timer;
+    nxt_msec_t                  wait_start;
+
+    nxt_http_cache_state_t      state;
+    uint8_t                     waiting;    /* 1 bit, under the lock */
+};
+
+
+typedef struct {
+    nxt_str_t                   path;
+    nxt_str_t                   key;
+    int32_t                     valid;
+    uint32_t                    max_entries;
+    nxt_off_t                   max_size;
+    nxt_msec_t                  lock_timeout;
+} nxt_http_cache_action_conf_t;
+
+
+typedef struct {
+    nxt_int_t                   max_age;
+    nxt_int_t                   s_maxage;
+    nxt_int_t                   stale_while_revalidate;
+    uint8_t                     no_store;   /* 1 bit */
+    uint8_t                     public;     /* 1 bit */
+} nxt_http_cache_control_t;
+
+
+#define NXT_HTTP_CACHE_MAX_ENTRIES     1024
+#define NXT_HTTP_CACHE_MAX_SIZE        (10 * 1024 * 1024)
+#define NXT_HTTP_CACHE_LOCK_TIMEOUT    (5 * 1000)
+#define NXT_HTTP_CACHE_WRITE_BACKLOG   (1024 * 1024)
+
+
+#define nxt_http_cache_name_is(_name, _length, _str)                          \
+    ((_length) == nxt_length(_str)                                            \
+     && nxt_memcasecmp(_name, _str, nxt_length(_str)) == 0)
+
+
+static nxt_http_cache_t *nxt_http_cache_get(nxt_router_t *router,
+    nxt_http_cache_action_conf_t *cacf);
+static void nxt_http_cache_release(nxt_task_t *task, nxt_router_t *router,
+    nxt_http_cache_t *cache);
+static void nxt_http_cache_free(nxt_http_cache_t *cache);
+static nxt_http_action_t *nxt_http_cache_lookup(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_cache_ctx_t *ctx);
+static nxt_http_cache_node_t *nxt_http_cache_node_find(nxt_http_cache_t *cache,
+    nxt_str_t *key, uint32_t key_hash);
+static nxt_http_cache_node_t *nxt_http_cache_node_add(nxt_http_cache_t *cache,
+    nxt_str_t *key, uint32_t key_hash);
+static nxt_http_cache_entry_t *nxt_http_cache_placeholder(
+    nxt_http_request_t *r, nxt_str_t *vary);
+static void nxt_http_cache_wait(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_ctx_t *ctx);
+static void nxt_http_cache_wake_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_wait_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_resume(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_bool_t timeout);
+static void nxt_http_cache_wait_done(nxt_task_t *task, nxt_http_request_t *r);
+static void nxt_http_cache_wait_release(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_pass(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_action_t *action);
+static nxt_int_t nxt_http_cache_restore(nxt_http_request_t *r,
+    nxt_http_cache_entry_t *entry, nxt_time_t now);
+static void nxt_http_cache_send(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_fd_t fd, nxt_off_t size);
+static nxt_int_t nxt_http_cache_store_start(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_cache_ctx_t *ctx);
+static nxt_bool_t nxt_http_cache_field_stored(nxt_http_field_t *field);
+static void nxt_http_cache_control_parse(nxt_http_cache_control_t *cc,
+    u_char *p, size_t length);
+static u_char *nxt_http_cache_vary_next(u_char *p, u_char *end,
+    nxt_str_t *name);
+static nxt_http_field_t *nxt_http_cache_request_field(nxt_http_request_t *r,
+    nxt_str_t *name);
+static size_t nxt_http_cache_variant_size(nxt_http_request_t *r,
+    nxt_str_t *vary);
+static u_char *nxt_http_cache_variant_copy(nxt_http_request_t *r,
+    nxt_str_t *vary, u_char *p);
+static nxt_bool_t nxt_http_cache_variant_match(nxt_http_request_t *r,
+    nxt_http_cache_entry_t *entry);
+static nxt_int_t nxt_http_cache_write(nxt_task_t *task,
+    nxt_http_cache_store_t *store, u_char *data, size_t size);
+static void nxt_http_cache_write_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_cache_store_release(nxt_task_t *task,
+    nxt_http_cache_store_t *store);
+static void nxt_http_cache_publish(nxt_task_t *task,
+    nxt_http_cache_store_t *store);
+static void nxt_http_cache_abort(nxt_task_t *task, nxt_http_cache_ctx_t *ctx);
+static void nxt_http_cache_fill_abort(nxt_task_t *task,
+    nxt_http_cache_t *cache, nxt_http_cache_entry_t *fill);
+static void nxt_http_cache_unlink(nxt_http_cache_t *cache,
+    nxt_http_cache_entry_t *entry, nxt_queue_t *release, nxt_queue_t *wake);
+static void nxt_http_cache_entries_release(nxt_http_cache_t *cache,
+    nxt_queue_t *release);
+static void nxt_http_cache_waiters_move(nxt_http_cache_entry_t *entry,
+    nxt_queue_t *wake);
+static void nxt_http_cache_wake(nxt_queue_t *wake);
+static void nxt_http_cache_entry_release(nxt_http_cache_t *cache,
+    nxt_http_cache_entry_t *entry);
+static void nxt_http_cache_entry_free(nxt_http_cache_entry_t *entry);
+static nxt_int_t nxt_http_cache_test(nxt_lvlhsh_query_t *lhq, void *data);
+
+
+static const nxt_lvlhsh_proto_t  nxt_http_cache_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_cache_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
+
+
+static const nxt_http_request_state_t  nxt_http_cache_wait_state
+    nxt_aligned(64) =
+{
+    .error_handler = nxt_http_request_error_handler,
+};
+
+
+static const nxt_http_request_state_t  nxt_http_cache_send_state
+    nxt_aligned(64) =
+{
+    .error_handler = nxt_http_request_error_handler,
+};
+
+
+static nxt_conf_map_t  nxt_http_cache_action_conf[] = {
+    {
+        nxt_string("path"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_http_cache_action_conf_t, path),
+    },
+
+    {
+        nxt_string("key"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_http_cache_action_conf_t, key),
+    },
+
+    {
+        nxt_string("valid"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_cache_action_conf_t, valid),
+    },
+
+    {
+        nxt_string("max_entries"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_cache_action_conf_t, max_entries),
+    },
+
+    {
+        nxt_string("max_size"),
+        NXT_CONF_MAP_OFF,
+        offsetof(nxt_http_cache_action_conf_t, max_size),
+    },
+
+    {
+        nxt_string("lock_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_http_cache_action_conf_t, lock_timeout),
+    },
+};
+
+
+nxt_int_t
+nxt_http_cache_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf)
+{
+    nxt_int_t                     ret;
+    nxt_router_conf_t             *rtcf;
+    nxt_http_cache_t              *cache, **cachep;
+    nxt_http_cache_conf_t         *conf;
+    nxt_http_cache_action_conf_t  cacf;
+
+    rtcf = tmcf->router_conf;
+
+    nxt_memzero(&cacf, sizeof(nxt_http_cache_action_conf_t));
+
+    nxt_str_set(&cacf.key, "$host$request_uri");
+    cacf.max_entries = NXT_HTTP_CACHE_MAX_ENTRIES;
+    cacf.max_size = NXT_HTTP_CACHE_MAX_SIZE;
+    cacf.lock_timeout = NXT_HTTP_CACHE_LOCK_TIMEOUT;
+
+    ret = nxt_conf_map_object(tmcf->mem_pool, acf->cache,
+                              nxt_http_cache_action_conf,
+                              nxt_nitems(nxt_http_cache_action_conf), &cacf);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    if (cacf.path.length == 0) {
+        cacf.path.start = (u_char *) task->thread->runtime->tmp;
+        cacf.path.length = nxt_strlen(cacf.path.start);
+    }
+
+    conf = nxt_mp_zalloc(rtcf->mem_pool, sizeof(nxt_http_cache_conf_t));
+    if (nxt_slow_path(conf == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->key = nxt_tstr_compile(rtcf->tstr_state, &cacf.key, 0);
+    if (nxt_slow_path(conf->key == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->valid = cacf.valid;
+    conf->max_size = cacf.max_size;
+    conf->lock_timeout = cacf.lock_timeout;
+
+    if (rtcf->caches == NULL) {
+        rtcf->caches = nxt_array_create(rtcf->mem_pool, 2,
+                                        sizeof(nxt_http_cache_t *));
+        if (nxt_slow_path(rtcf->caches == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    cachep = nxt_array_add(rtcf->caches);
+    if (nxt_slow_path(cachep == NULL)) {
+        return NXT_ERROR;
+    }
+
+    cache = nxt_http_cache_get(rtcf->router, &cacf);
+    if (nxt_slow_path(cache == NULL)) {
+        rtcf->caches->nelts--;
+        return NXT_ERROR;
+    }
+
+    *cachep = cache;
+
+    conf->cache = cache;
+    action->cache = conf;
+
+    return NXT_OK;
+}
+
+
+static nxt_http_cache_t *
+nxt_http_cache_get(nxt_router_t *router, nxt_http_cache_action_conf_t *cacf)
+{
+    nxt_http_cache_t  *cache, *found;
+
+    found = NULL;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    nxt_queue_each(cache, &router->caches, nxt_http_cache_t, link) {
+
+        if (nxt_strstr_eq(&cache->path, &cacf->path)) {
+            cache->count++;
+            found = cache;
+            break;
+        }
+
+    } nxt_queue_loop;
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    if (found != NULL) {
+        nxt_thread_spin_lock(&found->lock);
+
+        found->max_entries = cacf->max_entries;
+
+        nxt_thread_spin_unlock(&found->lock);
+
+        return found;
+    }
+
+    cache = nxt_zalloc(sizeof(nxt_http_cache_t) + cacf->path.length);
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
+    }
+
+    cache->count = 1;
+    cache->max_entries = cacf->max_entries;
+
+    nxt_queue_init(&cache->lru);
+
+    cache->path.length = cacf->path.length;
+    cache->path.start = nxt_pointer_to(cache, sizeof(nxt_http_cache_t));
+    nxt_memcpy(cache->path.start, cacf->path.start, cacf->path.length);
+
+    nxt_thread_spin_lock(&router->lock);
+
+    nxt_queue_insert_tail(&router->caches, &cache->link);
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    return cache;
+}
+
+
+void
+nxt_http_caches_release(nxt_task_t *task, nxt_router_conf_t *rtcf)
+{
+    nxt_uint_t        i;
+    nxt_router_t      *router;
+    nxt_http_cache_t  **caches;
+
+    if (rtcf->caches == NULL) {
+        return;
+    }
+
+    router = rtcf->router;
+    caches = rtcf->caches->elts;
+
+    for (i = 0; i < rtcf->caches->nelts; i++) {
+        nxt_http_cache_release(task, router, caches[i]);
+    }
+
+    rtcf->caches = NULL;
+}
+
+
+static void
+nxt_http_cache_release(nxt_task_t *task, nxt_router_t *router,
+    nxt_http_cache_t *cache)
+{
+    nxt_thread_spin_lock(&router->lock);
+
+    if (--cache->count == 0) {
+        nxt_queue_remove(&cache->link);
+
+    } else {
+        cache = NULL;
+    }
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    if (cache != NULL) {
+        nxt_debug(task, "http cache \"%V\" is destroyed", &cache->path);
+
+        nxt_http_cache_free(cache);
+    }
+}
+
+
+static void
+nxt_http_cache_free(nxt_http_cache_t *cache)
+{
+    nxt_http_cache_node_t   *node;
+    nxt_http_cache_entry_t  *entry;
+
+    for ( ;; ) {
+        node = nxt_lvlhsh_retrieve(&cache->hash, &nxt_http_cache_proto, NULL);
+
+        if (node == NULL) {
+            break;
+        }
+
+        nxt_queue_each(entry, &node->entries, nxt_http_cache_entry_t,
+                       node_link)
+        {
+            nxt_http_cache_entry_free(entry);
+
+        } nxt_queue_loop;
+
+        nxt_free(node);
+    }
+
+    nxt_free(cache);
+}
+
+
+nxt_http_action_t *
+nxt_http_cache_handler(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_action_t *action)
+{
+    nxt_int_t              ret;
+    nxt_str_t              key;
+    nxt_router_conf_t      *rtcf;
+    nxt_http_cache_ctx_t   *ctx;
+    nxt_http_cache_conf_t  *conf;
+
+    if (r->cache != NULL) {
+        /* Only the first cache on the way of a request is used. */
+        return action;
+    }
+
+    if ((!nxt_str_eq(r->method, "GET", 3)
+         && !nxt_str_eq(r->method, "HEAD", 4))
+        || r->websocket_handshake)
+    {
+        r->cache_status = NXT_HTTP_CACHE_BYPASS;
+        return action;
+    }
+
+    conf = action->cache;
+
+    if (nxt_tstr_is_const(conf->key)) {
+        nxt_tstr_str(conf->key, &key);
+
+    } else {
+        rtcf = r->conf->socket_conf->router_conf;
+
+        ret = nxt_tstr_query_init(&r->tstr_query, rtcf->tstr_state,
+                                  &r->tstr_cache, r, r->mem_pool);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
+
+        ret = nxt_tstr_query(task, r->tstr_query, conf->key, &key);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
+    }
+
+    ctx = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_cache_ctx_t));
+    if (nxt_slow_path(ctx == NULL)) {
+        goto fail;
+    }
+
+    ctx->conf = conf;
+    ctx->action = action;
+    ctx->key = key;
+    ctx->key_hash = nxt_djb_hash(key.start, key.length);
+
+    r->cache = ctx;
+
+    return nxt_http_cache_lookup(task, r, ctx);
+
+fail:
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+
+    return NULL;
+}
+
+
+static nxt_http_action_t *
+nxt_http_cache_lookup(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_ctx_t *ctx)
+{
+    nxt_fd_t                fd;
+    nxt_int_t               ret;
+    nxt_off_t               size;
+    nxt_str_t               vary;
+    nxt_bool_t              fill;
+    nxt_time_t              now;
+    nxt_http_cache_t        *cache;
+    nxt_http_cache_node_t   *node;
+    nxt_http_cache_entry_t  *entry, *e;
+
+    cache = ctx->conf->cache;
+    now = nxt_thread_time(task->thread);
+
+    /* A HEAD request is served from the cache but never fills it. */
+    fill = nxt_str_eq(r->method, "GET", 3);
+
+    entry = NULL;
+    nxt_str_null(&vary);
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    node = nxt_http_cache_node_find(cache, &ctx->key, ctx->key_hash);
+
+    if (node != NULL) {
+        nxt_queue_each(e, &node->entries, nxt_http_cache_entry_t,
+                       node_link)
+        {
+
+            if (nxt_http_cache_variant_match(r, e)) {
+                entry = e;
+                break;
+            }
+
+            if (e->valid) {
+                vary = e->vary;
+            }
+
+        } nxt_queue_loop;
+    }
+
+    if (entry == NULL) {
+
+        if (fill) {
+            entry = nxt_http_cache_placeholder(r, &vary);
+            if (nxt_slow_path(entry == NULL)) {
+                goto bypass;
+            }
+
+            if (node == NULL) {
+                node = nxt_http_cache_node_add(cache, &ctx->key,
+                                               ctx->key_hash);
+                if (nxt_slow_path(node == NULL)) {
+                    nxt_free(entry);
+                    goto bypass;
+                }
+            }
+
+            entry->node = node;
+            nxt_queue_insert_tail(&node->entries, &entry->node_link);
+
+            ctx->fill = entry;
+            ctx->state = NXT_HTTP_CACHE_FILL;
+        }
+
+        nxt_thread_spin_unlock(&cache->lock);
+
+        r->cache_status = NXT_HTTP_CACHE_MISS;
+
+        return ctx->action;
+    }
+
+    if (!entry->valid) {
+        /* Another request is filling the variant. */
+        goto wait;
+    }
+
+    if (now < entry->expires) {
+        r->cache_status = NXT_HTTP_CACHE_HIT;
+        goto hit;
+    }
+
+    if (now < entry->stale && (entry->updating || !fill)) {
+        r->cache_status = NXT_HTTP_CACHE_UPDATING;
+        goto hit;
+    }
+
+    if (entry->updating) {
+        goto wait;
+    }
+
+    if (fill) {
+        entry->refs++;
+        entry->updating = 1;
+
+        ctx->fill = entry;
+        ctx->state = NXT_HTTP_CACHE_FILL;
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    r->cache_status = NXT_HTTP_CACHE_EXPIRED;
+
+    return ctx->action;
+
+hit:
+
+    nxt_queue_remove(&entry->link);
+    nxt_queue_insert_head(&cache->lru, &entry->link);
+
+    entry->refs++;
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    size = entry->size;
+
+    ret = nxt_http_cache_restore(r, entry, now);
+
+    fd = (ret == NXT_OK) ? dup(entry->fd) : -1;
+
+    nxt_http_cache_entry_release(cache, entry);
+
+    if (nxt_slow_path(fd == -1)) {
+        nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+        return NULL;
+    }
+
+    nxt_debug(task, "http cache hit: \"%V\"", &ctx->key);
+
+    ctx->state = NXT_HTTP_CACHE_DONE;
+
+    nxt_http_cache_send(task, r, fd, size);
+
+    return NULL;
+
+wait:
+
+    if (ctx->state == NXT_HTTP_CACHE_WAIT
+        && nxt_msec_diff(task->thread->engine->timers.now, ctx->wait_start)
+           >= (nxt_msec_int_t) ctx->conf->lock_timeout)
+    {
+        nxt_thread_spin_unlock(&cache->lock);
+
+        ctx->state = NXT_HTTP_CACHE_DONE;
+
+        r->cache_status = NXT_HTTP_CACHE_BYPASS;
+
+        return ctx->action;
+    }
+
+    nxt_queue_insert_tail(&entry->waiters, &ctx->link);
+    ctx->waiting = 1;
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    nxt_http_cache_wait(task, r, ctx);
+
+    return NULL;
+
+bypass:
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    r->cache_status = NXT_HTTP_CACHE_BYPASS;
+
+    return ctx->action;
+}
+
+
+static nxt_http_cache_node_t *
+nxt_http_cache_node_find(nxt_http_cache_t *cache, nxt_str_t *key,
+    uint32_t key_hash)
+{
+    nxt_lvlhsh_query_t  lhq;
+
+    lhq.key = *key;
+    lhq.key_hash = key_hash;
+    lhq.proto = &nxt_http_cache_proto;
+    lhq.pool = NULL;
+
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) != NXT_OK) {
+        return NULL;
+    }
+
+    return lhq.value;
+}
+
+
+static nxt_http_cache_node_t *
+nxt_http_cache_node_add(nxt_http_cache_t *cache, nxt_str_t *key,
+    uint32_t key_hash)
+{
+    nxt_lvlhsh_query_t     lhq;
+    nxt_http_cache_node_t  *node;
+
+    node = nxt_malloc(sizeof(nxt_http_cache_node_t) + key->length);
+    if (nxt_slow_path(node == NULL)) {
+        return NULL;
+    }
+
+    node->key.length = key->length;
+    node->key.start = nxt_pointer_to(node, sizeof(nxt_http_cache_node_t));
+    nxt_memcpy(node->key.start, key->start, key->length);
+
+    nxt_queue_init(&node->entries);
+
+    lhq.key = node->key;
+    lhq.key_hash = key_hash;
+    lhq.replace = 0;
+    lhq.value = node;
+    lhq.proto = &nxt_http_cache_proto;
+    lhq.pool = NULL;
+
+    if (nxt_slow_path(nxt_lvlhsh_insert(&cache->hash, &lhq) != NXT_OK)) {
+        nxt_free(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+
+static nxt_http_cache_entry_t *
+nxt_http_cache_placeholder(nxt_http_request_t *r, nxt_str_t *vary)
+{
+    u_char                  *p;
+    size_t                  variant_size;
+    nxt_http_cache_entry_t  *entry;
+
+    variant_size = nxt_http_cache_variant_size(r, vary);
+
+    entry = nxt_zalloc(sizeof(nxt_http_cache_entry_t) + vary->length
+                       + variant_size);
+    if (nxt_slow_path(entry == NULL)) {
+        return NULL;
+    }
+
+    entry->fd = -1;
+    entry->refs = 2;  /* The cache and the fill. */
+    entry->updating = 1;
+
+    nxt_queue_init(&entry->waiters);
+
+    p = nxt_pointer_to(entry, sizeof(nxt_http_cache_entry_t));
+
+    entry->vary.start = p;
+    entry->vary.length = vary->length;
+    p = nxt_cpymem(p, vary->start, vary->length);
+
+    entry->variant.start = p;
+    entry->variant.length = variant_size;
+    (void) nxt_http_cache_variant_copy(r, &entry->vary, p);
+
+    return entry;
+}
+
+
+/*
+ * A request waiting for a fill is linked to the entry being filled and
+ * is woken up by a work posted to its engine when the fill completes.
+ * The waiting is limited by "lock_timeout".
+ */
+
+static void
+nxt_http_cache_wait(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_ctx_t *ctx)
+{
+    nxt_msec_t          now;
+    nxt_event_engine_t  *engine;
+
+    engine = task->thread->engine;
+    now = engine->timers.now;
+
+    if (ctx->state != NXT_HTTP_CACHE_WAIT) {
+        ctx->state = NXT_HTTP_CACHE_WAIT;
+        ctx->wait_start = now;
+        ctx->request = r;
+        ctx->engine = engine;
+
+        /* The pool is released by nxt_http_cache_wait_done(). */
+        nxt_mp_retain(r->mem_pool);
+
+        r->state = &nxt_http_cache_wait_state;
+
+        nxt_work_set(&ctx->work, nxt_http_cache_wake_handler, &engine->task,
+                     r, NULL);
+
+        ctx->timer.task = &engine->task;
+        ctx->timer.work_queue = &engine->fast_work_queue;
+        ctx->timer.log = engine->task.log;
+        ctx->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+        ctx->timer.handler = nxt_http_cache_wait_timeout;
+    }
+
+    nxt_timer_add(engine, &ctx->timer, ctx->conf->lock_timeout
+                                       - nxt_msec_diff(now, ctx->wait_start));
+}
+
+
+static void
+nxt_http_cache_wake_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_cache_resume(task, obj, 0);
+}
+
+
+static void
+nxt_http_cache_wait_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_bool_t            waiting;
+    nxt_timer_t           *timer;
+    nxt_http_cache_t      *cache;
+    nxt_http_request_t    *r;
+    nxt_http_cache_ctx_t  *ctx;
+
+    timer = obj;
+
+    ctx = nxt_timer_data(timer, nxt_http_cache_ctx_t, timer);
+    r = ctx->request;
+
+    if (r->proto.any == NULL) {
+        /* The request has been closed, a wake up work is posted. */
+        return;
+    }
+
+    cache = ctx->conf->cache;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    waiting = ctx->waiting;
+
+    if (waiting) {
+        nxt_queue_remove(&ctx->link);
+        ctx->waiting = 0;
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    if (waiting) {
+        nxt_http_cache_resume(task, r, 1);
+    }
+
+    /* Otherwise a wake up work has been already posted. */
+}
+
+
+static void
+nxt_http_cache_resume(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_bool_t timeout)
+{
+    nxt_http_action_t     *action;
+    nxt_http_cache_ctx_t  *ctx;
+
+    ctx = r->cache;
+
+    if (nxt_slow_path(r->proto.any == NULL || r->error)) {
+        ctx->state = NXT_HTTP_CACHE_DONE;
+
+    } else if (timeout) {
+        ctx->state = NXT_HTTP_CACHE_DONE;
+
+        r->cache_status = NXT_HTTP_CACHE_BYPASS;
+
+        nxt_http_cache_pass(task, r, ctx->action);
+
+    } else {
+        action = nxt_http_cache_lookup(task, r, ctx);
+
+        if (action != NULL) {
+            nxt_http_cache_pass(task, r, action);
+        }
+    }
+
+    if (ctx->state != NXT_HTTP_CACHE_WAIT) {
+        nxt_http_cache_wait_done(task, r);
+    }
+}
+
+
+static void
+nxt_http_cache_wait_done(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_event_engine_t    *engine;
+    nxt_http_cache_ctx_t  *ctx;
+
+    ctx = r->cache;
+    engine = task->thread->engine;
+
+    /* The timer may still be referenced by the engine timer changes. */
+
+    if (nxt_timer_delete(engine, &ctx->timer)) {
+        ctx->timer.handler = nxt_http_cache_wait_release;
+        nxt_timer_add(engine, &ctx->timer, 0);
+
+    } else {
+        nxt_mp_release(r->mem_pool);
+    }
+}
+
+
+static void
+nxt_http_cache_wait_release(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_cache_ctx_t  *ctx;
+
+    ctx = nxt_timer_data(obj, nxt_http_cache_ctx_t, timer);
+
+    nxt_mp_release(ctx->request->mem_pool);
+}
+
+
+static void
+nxt_http_cache_pass(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_action_t *action)
+{
+    action = action->handler(task, r, action);
+
+    if (action == NULL) {
+        return;
+    }
+
+    if (action == NXT_HTTP_ACTION_ERROR) {
+        nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    nxt_http_request_action(task, r, action);
+}
+
+
+static nxt_int_t
+nxt_http_cache_restore(nxt_http_request_t *r, nxt_http_cache_entry_t *entry,
+    nxt_time_t now)
+{
+    u_char                  *p, *end;
+    uint32_t                i;
+    nxt_http_field_t        *field;
+    nxt_http_cache_field_t  *f;
+
+    p = nxt_mp_nget(r->mem_pool, entry->data_size);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_memcpy(p, entry->data, entry->data_size);
+
+    for (i = 0; i < entry->nfields; i++) {
+        f = &entry->fields[i];
+
+        field = nxt_list_zero_add(r->resp.fields);
+        if (nxt_slow_path(field == NULL)) {
+            return NXT_ERROR;
+        }
+
+        field->hash = f->hash;
+        field->name_length = f->name_length;
+        field->value_length = f->value_length;
+
+        field->name = p;
+        p += f->name_length;
+
+        field->value = p;
+        p += f->value_length;
+    }
+
+    field = nxt_list_zero_add(r->resp.fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_http_field_name_set(field, "Age");
+
+    p = nxt_mp_nget(r->mem_pool, NXT_TIME_T_LEN);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    end = nxt_sprintf(p, p + NXT_TIME_T_LEN, "%T",
+                      nxt_max(now - entry->date, 0));
+
+    field->value = p;
+    field->value_length = end - p;
+
+    r->status = entry->status;
+    r->resp.content_length_n = entry->size;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_cache_send(nxt_task_t *task, nxt_http_request_t *r, nxt_fd_t fd,
+    nxt_off_t size)
+{
+    nxt_buf_t           *fb;
+    nxt_file_t          *file;
+    nxt_work_handler_t  body_handler;
+
+    r->state = &nxt_http_cache_send_state;
+
+    if (size == 0 || nxt_str_eq(r->method, "HEAD", 4)) {
+        nxt_fd_close(fd);
+
+        nxt_http_request_header_send(task, r, NULL, NULL);
+        return;
+    }
+
+    file = nxt_mp_zget(r->mem_pool, sizeof(nxt_file_t));
+    if (nxt_slow_path(file == NULL)) {
+        goto fail;
+    }
+
+    fb = nxt_buf_file_alloc(r->mem_pool, 0, 0);
+    if (nxt_slow_path(fb == NULL)) {
+        goto fail;
+    }
+
+    file->fd = fd;
+    file->name = (nxt_file_name_t *) "http cache";
+    file->size = size;
+
+    fb->file = file;
+    fb->file_end = size;
+
+    r->out = fb;
+
+    if (nxt_http_request_sendfile(task, r)) {
+        body_handler = nxt_http_static_sendfile_handler;
+
+    } else {
+        body_handler = nxt_http_static_body_handler;
+    }
+
+    nxt_http_request_header_send(task, r, body_handler, NULL);
+
+    return;
+
+fail:
+
+    nxt_fd_close(fd);
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+void
+nxt_http_cache_header_filter(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_int_t             ret;
+    nxt_http_cache_ctx_t  *ctx;
+
+    ctx = r->cache;
+
+    if (ctx->state != NXT_HTTP_CACHE_FILL) {
+        return;
+    }
+
+    ret = nxt_http_cache_store_start(task, r, ctx);
+
+    if (ret != NXT_OK) {
+        nxt_http_cache_abort(task, ctx);
+    }
+}
+
+
+static nxt_int_t
+nxt_http_cache_store_start(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_cache_ctx_t *ctx)
+{
+    u_char                    *p, *tmp;
+    size_t                    size, data_size, variant_size;
+    uint32_t                  nfields;
+    nxt_str_t                 vary, name;
+    nxt_off_t                 length;
+    nxt_time_t                now, valid, expires, swr;
+    nxt_bool_t                encoded;
+    nxt_http_field_t          *field, *f;
+    nxt_http_cache_conf_t     *conf;
+    nxt_runtime_t             *rt;
+    nxt_http_cache_store_t    *store;
+    nxt_http_cache_entry_t    *entry;
+    nxt_http_cache_field_t    *cf;
+    nxt_http_cache_control_t  cc;
+
+    switch (r->status) {
+
+    case NXT_HTTP_OK:
+    case NXT_HTTP_MULTIPLE_CHOICES:
+    case NXT_HTTP_MOVED_PERMANENTLY:
+    case NXT_HTTP_PERMANENT_REDIRECT:
+    case NXT_HTTP_NOT_FOUND:
+        break;
+
+    default:
+        return NXT_DECLINED;
+    }
+
+    rt = task->thread->runtime;
+
+    if (rt->thread_pools == NULL || rt->thread_pools->nelts == 0) {
+        return NXT_DECLINED;
+    }
+
+    conf = ctx->conf;
+    now = nxt_thread_time(task->thread);
+
+    cc.max_age = -1;
+    cc.s_maxage = -1;
+    cc.stale_while_revalidate = -1;
+    cc.no_store = 0;
+    cc.public = 0;
+
+    expires = -1;
+    encoded = 0;
+    nxt_str_null(&vary);
+
+    nfields = 0;
+    data_size = 0;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (field->skip) {
+            continue;
+        }
+
+        if (nxt_http_cache_name_is(field->name, field->name_length,
+                                   "Cache-Control"))
+        {
+            nxt_http_cache_control_parse(&cc, field->value,
+                                         field->value_length);
+
+        } else if (nxt_http_cache_name_is(field->name, field->name_length,
+                                          "Expires"))
+        {
+            expires = nxt_time_parse(field->value, field->value_length);
+
+            if (expires == -1) {
+                /* An invalid date means "already expired". */
+                expires = 0;
+            }
+
+        } else if (nxt_http_cache_name_is(field->name, field->name_length,
+                                          "Vary"))
+        {
+            if (vary.start != NULL) {
+                return NXT_DECLINED;
+            }
+
+            vary.start = field->value;
+            vary.length = field->value_length;
+
+        } else if (nxt_http_cache_name_is(field->name, field->name_length,
+                                          "Set-Cookie"))
+        {
+            return NXT_DECLINED;
+
+        } else if (nxt_http_cache_name_is(field->name, field->name_length,
+                                          "Content-Encoding"))
+        {
+            encoded = 1;
+        }
+
+        if (nxt_http_cache_field_stored(field)) {
+            nfields++;
+            data_size += field->name_length + field->value_length;
+        }
+
+    } nxt_list_loop;
+
+    if (cc.no_store) {
+        return NXT_DECLINED;
+    }
+
+    if (r->authorization != NULL && !cc.public && cc.s_maxage < 0) {
+        return NXT_DECLINED;
+    }
+
+    if (cc.s_maxage >= 0) {
+        valid = cc.s_maxage;
+
+    } else if (cc.max_age >= 0) {
+        valid = cc.max_age;
+
+    } else if (expires != -1) {
+        valid = expires - now;
+
+    } else {
+        valid = conf->valid;
+    }
+
+    swr = nxt_max(cc.stale_while_revalidate, 0);
+
+    if (valid <= 0 && swr == 0) {
+        return NXT_DECLINED;
+    }
+
+    if (r->resp.content_length_n != -1) {
+        length = r->resp.content_length_n;
+
+    } else if (r->resp.content_length != NULL) {
+        length = nxt_off_t_parse(r->resp.content_length->value,
+                                 r->resp.content_length->value_length);
+    } else {
+        length = 0;
+    }
+
+    if (length > conf->max_size) {
+        return NXT_DECLINED;
+    }
+
+    /*
+     * The request header values listed in "Vary" are stored with the
+     * entry, each terminated by a line feed.  A response encoded by an
+     * application or by the router compression is stored only if it
+     * varies by "Accept-Encoding".
+     */
+
+    variant_size = 0;
+    p = vary.start;
+
+    for ( ;; ) {
+        p = nxt_http_cache_vary_next(p, vary.start + vary.length, &name);
+
+        if (name.length == 0) {
+            break;
+        }
+
+        if (nxt_str_eq(&name, "*", 1)) {
+            return NXT_DECLINED;
+        }
+
+        if (nxt_http_cache_name_is(name.start, name.length,
+                                   "Accept-Encoding"))
+        {
+            encoded = 0;
+        }
+
+        f = nxt_http_cache_request_field(r, &name);
+
+        variant_size += ((f != NULL) ? f->value_length : 0) + 1;
+    }
+
+    if (encoded) {
+        return NXT_DECLINED;
+    }
+
+    size = sizeof(nxt_http_cache_entry_t)
+           + nfields * sizeof(nxt_http_cache_field_t)
+           + data_size + vary.length + variant_size;
+
+    entry = nxt_zalloc(size);
+    if (nxt_slow_path(entry == NULL)) {
+        return NXT_ERROR;
+    }
+
+    entry->fd = -1;
+    entry->refs = 1;
+    entry->status = r->status;
+
+    nxt_queue_init(&entry->waiters);
+    entry->date = now;
+    entry->expires = now + valid;
+    entry->stale = entry->expires + swr;
+
+    cf = nxt_pointer_to(entry, sizeof(nxt_http_cache_entry_t));
+    entry->fields = cf;
+    entry->nfields = nfields;
+
+    p = (u_char *) (cf + nfields);
+
+    entry->data = p;
+    entry->data_size = data_size;
+
+    nxt_list_each(field, r->resp.fields) {
+
+        if (!field->skip && nxt_http_cache_field_stored(field)) {
+            cf->hash = field->hash;
+            cf->name_length = field->name_length;
+            cf->value_length = field->value_length;
+            cf++;
+
+            p = nxt_cpymem(p, field->name, field->name_length);
+            p = nxt_cpymem(p, field->value, field->value_length);
+        }
+
+    } nxt_list_loop;
+
+    entry->vary.start = p;
+    entry->vary.length = vary.length;
+    p = nxt_cpymem(p, vary.start, vary.length);
+
+    entry->variant.start = p;
+    entry->variant.length = variant_size;
+    (void) nxt_http_cache_variant_copy(r, &entry->vary, p);
+
+    store = nxt_zalloc(sizeof(nxt_http_cache_store_t) + ctx->key.length);
+    if (nxt_slow_path(store == NULL)) {
+        nxt_http_cache_entry_free(entry);
+        return NXT_ERROR;
+    }
+
+    store->entry = entry;
+
+    store->key.length = ctx->key.length;
+    store->key.start = nxt_pointer_to(store, sizeof(nxt_http_cache_store_t));
+    nxt_memcpy(store->key.start, ctx->key.start, ctx->key.length);
+    store->key_hash = ctx->key_hash;
+
+    store->count = 1;
+
+    store->router = r->conf->socket_conf->router_conf->router;
+    store->cache = conf->cache;
+
+    nxt_thread_spin_lock(&store->router->lock);
+    store->cache->count++;
+    nxt_thread_spin_unlock(&store->router->lock);
+
+    store->fill = ctx->fill;
+    ctx->fill = NULL;
+
+    ctx->store = store;
+
+    tmp = nxt_mp_nget(r->mem_pool, conf->cache->path.length
+                                   + nxt_length("/unit-cache.XXXXXX") + 1);
+    if (nxt_slow_path(tmp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_sprintf(tmp, tmp + conf->cache->path.length
+                         + nxt_length("/unit-cache.XXXXXX") + 1,
+                    "%V/unit-cache.XXXXXX%Z", &conf->cache->path);
+
+    entry->fd = mkstemp((char *) tmp);
+    if (nxt_slow_path(entry->fd == -1)) {
+        nxt_alert(task, "mkstemp(%s) failed %E", tmp, nxt_errno);
+        return NXT_ERROR;
+    }
+
+    (void) nxt_file_delete(tmp);
+
+    nxt_debug(task, "http cache store: \"%V\", %T s, fd %d",
+              &ctx->key, valid, entry->fd);
+
+    ctx->state = NXT_HTTP_CACHE_STORE;
+
+    return NXT_OK;
+}
+
+
+static nxt_bool_t
+nxt_http_cache_field_stored(nxt_http_field_t *field)
+{
+    nxt_uint_t  i;
+
+    static const nxt_str_t  skip[] = {
+        nxt_string("Content-Length"),
+        nxt_string("Transfer-Encoding"),
+        nxt_string("Connection"),
+        nxt_string("Keep-Alive"),
+        nxt_string("Date"),
+        nxt_string("Server"),
+        nxt_string("Age"),
+    };
+
+    for (i = 0; i < nxt_nitems(skip); i++) {
+        if (field->name_length == skip[i].length
+            && nxt_memcasecmp(field->name, skip[i].start, skip[i].length) == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+static void
+nxt_http_cache_control_parse(nxt_http_cache_control_t *cc, u_char *p,
+    size_t length)
+{
+    u_char  *end, *name, *name_end, *value, *value_end;
+
+    end = p + length;
+
+    while (p < end) {
+
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+
+        name = p;
+
+        while (p < end && *p != ',' && *p != '=') {
+            p++;
+        }
+
+        name_end = p;
+
+        while (name_end > name
+               && (name_end[-1] == ' ' || name_end[-1] == '\t'))
+        {
+            name_end--;
+        }
+
+        value = NULL;
+        value_end = NULL;
+
+        if (p < end && *p == '=') {
+            p++;
+
+            if (p < end && *p == '"') {
+                value = ++p;
+
+                while (p < end && *p != '"') {
+                    p++;
+                }
+
+                value_end = p;
+
+            } else {
+                value = p;
+
+                while (p < end && *p != ',' && *p != ' ' && *p != '\t') {
+                    p++;
+                }
+
+                value_end = p;
+            }
+        }
+
+        while (p < end && *p != ',') {
+            p++;
+        }
+
+        length = name_end - name;
+
+        if (nxt_http_cache_name_is(name, length, "no-store")
+            || nxt_http_cache_name_is(name, length, "no-cache")
+            || nxt_http_cache_name_is(name, length, "private"))
+        {
+            cc->no_store = 1;
+
+        } else if (nxt_http_cache_name_is(name, length, "public")) {
+            cc->public = 1;
+
+        } else if (value == NULL) {
+            continue;
+
+        } else if (nxt_http_cache_name_is(name, length, "max-age")) {
+            cc->max_age = nxt_int_parse(value, value_end - value);
+
+        } else if (nxt_http_cache_name_is(name, length, "s-maxage")) {
+            cc->s_maxage = nxt_int_parse(value, value_end - value);
+
+        } else if (nxt_http_cache_name_is(name, length,
+                                          "stale-while-revalidate"))
+        {
+            cc->stale_while_revalidate = nxt_int_parse(value,
+                                                       value_end - value);
+        }
+    }
+}
+
+
+static u_char *
+nxt_http_cache_vary_next(u_char *p, u_char *end, nxt_str_t *name)
+{
+    u_char  *start;
+
+    for ( ;; ) {
+
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+
+        start = p;
+
+        while (p < end && *p != ',' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+
+        if (p == start && p < end) {
+            continue;
+        }
+
+        name->start = start;
+        name->length = p - start;
+
+        return p;
+    }
+}
+
+
+static nxt_http_field_t *
+nxt_http_cache_request_field(nxt_http_request_t *r, nxt_str_t *name)
+{
+    nxt_http_field_t  *field;
+
+    nxt_list_each(field, r->fields) {
+
+        if (field->name_length == name->length
+            && nxt_memcasecmp(field->name, name->start, name->length) == 0)
+        {
+            return field;
+        }
+
+    } nxt_list_loop;
+
+    return NULL;
+}
+
+
+static size_t
+nxt_http_cache_variant_size(nxt_http_request_t *r, nxt_str_t *vary)
+{
+    u_char            *p;
+    size_t            size;
+    nxt_str_t         name;
+    nxt_http_field_t  *field;
+
+    size = 0;
+    p = vary->start;
+
+    for ( ;; ) {
+        p = nxt_http_cache_vary_next(p, vary->start + vary->length, &name);
+
+        if (name.length == 0) {
+            return size;
+        }
+
+        field = nxt_http_cache_request_field(r, &name);
+
+        size += ((field != NULL) ? field->value_length : 0) + 1;
+    }
+}
+
+
+static u_char *
+nxt_http_cache_variant_copy(nxt_http_request_t *r, nxt_str_t *vary, u_char *p)
+{
+    u_char            *v;
+    nxt_str_t         name;
+    nxt_http_field_t  *field;
+
+    v = vary->start;
+
+    for ( ;; ) {
+        v = nxt_http_cache_vary_next(v, vary->start + vary->length, &name);
+
+        if (name.length == 0) {
+            return p;
+        }
+
+        field = nxt_http_cache_request_field(r, &name);
+
+        if (field != NULL) {
+            p = nxt_cpymem(p, field->value, field->value_length);
+        }
+
+        *p++ = '\n';
+    }
+}
+
+
+static nxt_bool_t
+nxt_http_cache_variant_match(nxt_http_request_t *r,
+    nxt_http_cache_entry_t *entry)
+{
+    u_char            *p, *end, *v, *v_end;
+    size_t            length;
+    nxt_str_t         name;
+    nxt_http_field_t  *field;
+
+    p = entry->vary.start;
+    end = p + entry->vary.length;
+
+    v = entry->variant.start;
+    v_end = v + entry->variant.length;
+
+    for ( ;; ) {
+        p = nxt_http_cache_vary_next(p, end, &name);
+
+        if (name.length == 0) {
+            return 1;
+        }
+
+        field = nxt_http_cache_request_field(r, &name);
+        length = (field != NULL) ? field->value_length : 0;
+
+        if ((size_t) (v_end - v) < length + 1
+            || v[length] != '\n'
+            || (length != 0 && memcmp(v, field->value, length) != 0))
+        {
+            return 0;
+        }
+
+        v += length + 1;
+    }
+}
+
+
+void
+nxt_http_cache_body_filter(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_buf_t *out)
+{
+    size_t                  size;
+    nxt_buf_t               *b;
+    nxt_http_cache_ctx_t    *ctx;
+    nxt_http_cache_store_t  *store;
+
+    ctx = r->cache;
+
+    if (ctx->state != NXT_HTTP_CACHE_STORE) {
+        return;
+    }
+
+    store = ctx->store;
+
+    for (b = out; b != NULL; b = b->next) {
+
+        if (nxt_buf_is_file(b)) {
+            goto fail;
+        }
+
+        if (nxt_buf_is_mem(b)) {
+            size = nxt_buf_mem_used_size(&b->mem);
+
+            if (size != 0) {
+                if (store->entry->size + (nxt_off_t) size
+                    > ctx->conf->max_size)
+                {
+                    goto fail;
+                }
+
+                if (nxt_http_cache_write(task, store, b->mem.pos, size)
+                    != NXT_OK)
+                {
+                    goto fail;
+                }
+            }
+        }
+
+        if (nxt_buf_is_last(b)) {
+            ctx->store = NULL;
+            ctx->state = NXT_HTTP_CACHE_DONE;
+
+            store->complete = 1;
+
+            nxt_http_cache_store_release(task, store);
+            return;
+        }
+    }
+
+    return;
+
+fail:
+
+    nxt_http_cache_abort(task, ctx);
+}
+
+
+static nxt_int_t
+nxt_http_cache_write(nxt_task_t *task, nxt_http_cache_store_t *store,
+    u_char *data, size_t size)
+{
+    nxt_runtime_t           *rt;
+    nxt_thread_pool_t       **tp;
+    nxt_http_cache_write_t  *w;
+
+    /* The response is not stored if the disk does not keep up with it. */
+
+    if (store->backlog + size > NXT_HTTP_CACHE_WRITE_BACKLOG) {
+        nxt_debug(task, "http cache write backlog %uz", store->backlog);
+        return NXT_DECLINED;
+    }
+
+    w = nxt_malloc(sizeof(nxt_http_cache_write_t) + size);
+    if (nxt_slow_path(w == NULL)) {
+        return NXT_ERROR;
+    }
+
+    w->store = store;
+    w->offset = store->entry->size;
+    w->size = size;
+
+    nxt_memcpy(nxt_pointer_to(w, sizeof(nxt_http_cache_write_t)), data, size);
+
+    /* A thread pool sets its own thread in the task. */
+    w->task = task->thread->engine->task;
+
+    w->work.next = NULL;
+
+    nxt_work_set(&w->work, nxt_http_cache_write_handler, &w->task, w, NULL);
+
+    (void) nxt_atomic_fetch_add(&store->count, 1);
+    (void) nxt_atomic_fetch_add(&store->backlog, size);
+
+    rt = task->thread->runtime;
+    tp = rt->thread_pools->elts;
+
+    if (nxt_slow_path(nxt_thread_pool_post(tp[rt->thread_pools->nelts - 1],
+                                           &w->work)
+                      != NXT_OK))
+    {
+        /* The request reference is still held. */
+        (void) nxt_atomic_fetch_add(&store->count, -1);
+        (void) nxt_atomic_fetch_add(&store->backlog, -(nxt_atomic_int_t) size);
+
+        nxt_free(w);
+
+        return NXT_ERROR;
+    }
+
+    store->entry->size += size;
+
+    return NXT_OK;
+}
+
+
+/* The handler runs in a thread pool thread. */
+
+static void
+nxt_http_cache_write_handler(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                  *p;
+    ssize_t                 n;
+    nxt_file_t              file;
+    nxt_http_cache_write_t  *w;
+    nxt_http_cache_store_t  *store;
+
+    w = obj;
+    store = w->store;
+
+    p = nxt_pointer_to(w, sizeof(nxt_http_cache_write_t));
+
+    nxt_memzero(&file, sizeof(nxt_file_t));
+
+    file.fd = store->entry->fd;
+    file.name = (nxt_file_name_t *) "http cache";
+
+    n = nxt_file_write(&file, p, w->size, w->offset);
+
+    if (nxt_slow_path(n != (ssize_t) w->size)) {
+        store->failed = 1;
+    }
+
+    (void) nxt_atomic_fetch_add(&store->backlog,
+                                -(nxt_atomic_int_t) w->size);
+
+    nxt_http_cache_store_release(task, store);
+
+    nxt_free(w);
+}
+
+
+static void
+nxt_http_cache_store_release(nxt_task_t *task, nxt_http_cache_store_t *store)
+{
+    if (nxt_atomic_fetch_add(&store->count, -1) != 1) {
+        return;
+    }
+
+    if (store->complete && !store->failed) {
+        nxt_http_cache_publish(task, store);
+
+    } else {
+        nxt_debug(task, "http cache abort: \"%V\"", &store->key);
+
+        nxt_http_cache_entry_free(store->entry);
+        nxt_http_cache_fill_abort(task, store->cache, store->fill);
+    }
+
+    nxt_http_cache_release(task, store->router, store->cache);
+
+    nxt_free(store);
+}
+
+
+static void
+nxt_http_cache_publish(nxt_task_t *task, nxt_http_cache_store_t *store)
+{
+    nxt_queue_t             release, wake;
+    nxt_queue_link_t        *lnk;
+    nxt_http_cache_t        *cache;
+    nxt_http_cache_node_t   *node;
+    nxt_http_cache_entry_t  *entry, *fill, *e;
+
+    entry = store->entry;
+    fill = store->fill;
+    cache = store->cache;
+
+    entry->valid = 1;
+
+    nxt_queue_init(&release);
+    nxt_queue_init(&wake);
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    node = nxt_http_cache_node_find(cache, &store->key, store->key_hash);
+
+    if (node == NULL) {
+        node = nxt_http_cache_node_add(cache, &store->key, store->key_hash);
+
+        if (nxt_slow_path(node == NULL)) {
+            nxt_http_cache_unlink(cache, fill, &release, &wake);
+            nxt_queue_insert_tail(&release, &entry->node_link);
+            goto done;
+        }
+    }
+
+    entry->node = node;
+    nxt_queue_insert_head(&node->entries, &entry->node_link);
+
+    /* The replaced entry and stale copies of the same variant. */
+
+    nxt_http_cache_unlink(cache, fill, &release, &wake);
+
+    nxt_queue_each(e, &node->entries, nxt_http_cache_entry_t, node_link) {
+
+        if (e != entry
+            && e->valid
+            && nxt_strstr_eq(&e->vary, &entry->vary)
+            && nxt_strstr_eq(&e->variant, &entry->variant))
+        {
+            nxt_http_cache_unlink(cache, e, &release, &wake);
+        }
+
+    } nxt_queue_loop;
+
+    if (cache->entries >= cache->max_entries
+        && !nxt_queue_is_empty(&cache->lru))
+    {
+        lnk = nxt_queue_last(&cache->lru);
+        e = nxt_queue_link_data(lnk, nxt_http_cache_entry_t, link);
+
+        nxt_http_cache_unlink(cache, e, &release, &wake);
+    }
+
+    nxt_queue_insert_head(&cache->lru, &entry->link);
+    cache->entries++;
+
+done:
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    nxt_debug(task, "http cache publish: \"%V\", %O bytes",
+              &store->key, entry->size);
+
+    nxt_http_cache_wake(&wake);
+
+    nxt_http_cache_entries_release(cache, &release);
+
+    nxt_http_cache_entry_release(cache, fill);
+}
+
+
+static void
+nxt_http_cache_abort(nxt_task_t *task, nxt_http_cache_ctx_t *ctx)
+{
+    nxt_http_cache_store_t  *store;
+
+    ctx->state = NXT_HTTP_CACHE_DONE;
+
+    store = ctx->store;
+
+    if (store != NULL) {
+        ctx->store = NULL;
+
+        store->failed = 1;
+
+        nxt_http_cache_store_release(task, store);
+        return;
+    }
+
+    nxt_debug(task, "http cache abort: \"%V\"", &ctx->key);
+
+    nxt_http_cache_fill_abort(task, ctx->conf->cache, ctx->fill);
+
+    ctx->fill = NULL;
+}
+
+
+static void
+nxt_http_cache_fill_abort(nxt_task_t *task, nxt_http_cache_t *cache,
+    nxt_http_cache_entry_t *fill)
+{
+    nxt_queue_t  release, wake;
+
+    nxt_queue_init(&release);
+    nxt_queue_init(&wake);
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    if (fill->valid) {
+        fill->updating = 0;
+        nxt_http_cache_waiters_move(fill, &wake);
+
+    } else {
+        nxt_http_cache_unlink(cache, fill, &release, &wake);
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    nxt_http_cache_wake(&wake);
+
+    nxt_http_cache_entries_release(cache, &release);
+
+    nxt_http_cache_entry_release(cache, fill);
+}
+
+
+/*
+ * The function is called with the cache lock held.  It removes the entry
+ * from its key node and the LRU list, moves the cache reference to the
+ * "release" queue and the requests waiting for the entry to the "wake"
+ * queue.
+ */
+
+static void
+nxt_http_cache_unlink(nxt_http_cache_t *cache, nxt_http_cache_entry_t *entry,
+    nxt_queue_t *release, nxt_queue_t *wake)
+{
+    nxt_lvlhsh_query_t     lhq;
+    nxt_http_cache_node_t  *node;
+
+    node = entry->node;
+
+    if (node == NULL) {
+        /* The entry has been already evicted. */
+        return;
+    }
+
+    entry->node = NULL;
+    nxt_queue_remove(&entry->node_link);
+
+    if (entry->valid) {
+        nxt_queue_remove(&entry->link);
+        cache->entries--;
+    }
+
+    nxt_queue_insert_tail(release, &entry->node_link);
+
+    nxt_http_cache_waiters_move(entry, wake);
+
+    if (!nxt_queue_is_empty(&node->entries)) {
+        return;
+    }
+
+    lhq.key = node->key;
+    lhq.key_hash = nxt_djb_hash(node->key.start, node->key.length);
+    lhq.proto = &nxt_http_cache_proto;
+    lhq.pool = NULL;
+
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
+
+    nxt_free(node);
+}
+
+
+static void
+nxt_http_cache_entries_release(nxt_http_cache_t *cache, nxt_queue_t *release)
+{
+    nxt_http_cache_entry_t  *entry;
+
+    nxt_queue_each(entry, release, nxt_http_cache_entry_t, node_link) {
+
+        nxt_queue_remove(&entry->node_link);
+
+        nxt_http_cache_entry_release(cache, entry);
+
+    } nxt_queue_loop;
+}
+
+
+static void
+nxt_http_cache_waiters_move(nxt_http_cache_entry_t *entry, nxt_queue_t *wake)
+{
+    nxt_http_cache_ctx_t  *ctx;
+
+    nxt_queue_each(ctx, &entry->waiters, nxt_http_cache_ctx_t, link) {
+
+        nxt_queue_remove(&ctx->link);
+        nxt_queue_insert_tail(wake, &ctx->link);
+
+        ctx->waiting = 0;
+
+    } nxt_queue_loop;
+}
+
+
+static void
+nxt_http_cache_wake(nxt_queue_t *wake)
+{
+    nxt_http_cache_ctx_t  *ctx;
+
+    nxt_queue_each(ctx, wake, nxt_http_cache_ctx_t, link) {
+
+        nxt_queue_remove(&ctx->link);
+
+        ctx->work.next = NULL;
+
+        nxt_event_engine_post(ctx->engine, &ctx->work);
+
+    } nxt_queue_loop;
+}
+
+
+void
+nxt_http_cache_close(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_bool_t            waiting;
+    nxt_http_cache_t      *cache;
+    nxt_http_cache_ctx_t  *ctx;
+
+    ctx = r->cache;
+
+    if (ctx->state == NXT_HTTP_CACHE_WAIT) {
+        cache = ctx->conf->cache;
+
+        nxt_thread_spin_lock(&cache->lock);
+
+        waiting = ctx->waiting;
+
+        if (waiting) {
+            nxt_queue_remove(&ctx->link);
+            ctx->waiting = 0;
+        }
+
+        nxt_thread_spin_unlock(&cache->lock);
+
+        if (waiting) {
+            ctx->state = NXT_HTTP_CACHE_DONE;
+            nxt_http_cache_wait_done(task, r);
+        }
+
+        /* Otherwise the pool is released by the wake up work. */
+
+        return;
+    }
+
+    if (ctx->state == NXT_HTTP_CACHE_FILL
+        || ctx->state == NXT_HTTP_CACHE_STORE)
+    {
+        nxt_http_cache_abort(task, ctx);
+    }
+}
+
+
+static void
+nxt_http_cache_entry_release(nxt_http_cache_t *cache,
+    nxt_http_cache_entry_t *entry)
+{
+    uint32_t  refs;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    refs = --entry->refs;
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    if (refs == 0) {
+        nxt_http_cache_entry_free(entry);
+    }
+}
+
+
+static void
+nxt_http_cache_entry_free(nxt_http_cache_entry_t *entry)
+{
+    if (entry->fd != -1) {
+        nxt_fd_close(entry->fd);
+    }
+
+    nxt_free(entry);
+}
+
+
+static nxt_int_t
+nxt_http_cache_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_cache_node_t  *node;
+
+    node = data;
+
+    return nxt_strstr_eq(&lhq->key, &node->key) ? NXT_OK : NXT_DECLINED;
+}
@@ -18,12 +18,19 @@
 
 #define NXT_COMP_LEVEL_UNSET               INT8_MIN
 
+#define NXT_HTTP_COMP_CACHE_SIZE           (32 * 1024 * 1024)
+#define NXT_HTTP_COMP_CACHE_FILES          256
+
 
 typedef enum nxt_http_comp_scheme_e        nxt_http_comp_scheme_t;
 typedef struct nxt_http_comp_type_s        nxt_http_comp_type_t;
 typedef struct nxt_http_comp_opts_s        nxt_http_comp_opts_t;
 typedef struct nxt_http_comp_compressor_s  nxt_http_comp_compressor_t;
 typedef struct nxt_http_comp_ctx_s         nxt_http_comp_ctx_t;
+typedef struct nxt_http_comp_static_opts_s nxt_http_comp_static_opts_t;
+typedef struct nxt_http_comp_cache_key_s   nxt_http_comp_cache_key_t;
+typedef struct nxt_http_comp_cache_entry_s nxt_http_comp_cache_entry_t;
+typedef struct nxt_http_comp_cache_s       nxt_http_comp_cache_t;
 
 enum nxt_http_comp_scheme_e {
     NXT_HTTP_COMP_SCHEME_IDENTITY = 0,
@@ -45,6 +52,7 @@ enum nxt_http_comp_scheme_e {
 
 struct nxt_http_comp_type_s {
     nxt_str_t                         token;
+    nxt_str_t                         ext;
     nxt_http_comp_scheme_t            scheme;
     int8_t                            def_compr;
     int8_t                            comp_min;
@@ -72,11 +80,56 @@ struct nxt_http_comp_ctx_s {
     nxt_http_comp_compressor_ctx_t  ctx;
 };
 
+struct nxt_http_comp_static_opts_s {
+    nxt_off_t                   cache_size;
+    int32_t                     cache_files;
+    uint8_t                     precompressed;
+};
+
+/*
+ * Compressed static responses are kept in unlinked temporary files,
+ * keyed by the source file identity and the compressor settings.
+ * Hits get a dup()ed descriptor, so they can be sent with sendfile()
+ * while the entry is evicted.
+ */
+
+struct nxt_http_comp_cache_key_s {
+    dev_t                       dev;
+    ino_t                       ino;
+    nxt_time_t                  mtime;
+    nxt_off_t                   size;
+    int32_t                     scheme;
+    int32_t                     level;
+};
+
+struct nxt_http_comp_cache_entry_s {
+    nxt_http_comp_cache_key_t   key;
+    nxt_fd_t                    fd;
+    nxt_off_t                   size;
+    nxt_queue_link_t            link;
+};
+
+struct nxt_http_comp_cache_s {
+    nxt_thread_spinlock_t       lock;
+    nxt_lvlhsh_t                hash;
+    nxt_queue_t                 lru;
+    nxt_off_t                   size;
+    nxt_uint_t                  files;
+};
+
 
 static nxt_tstr_t                  *nxt_http_comp_accept_encoding_query;
 static nxt_http_route_rule_t       *nxt_http_comp_mime_types_rule;
 static nxt_http_comp_compressor_t  *nxt_http_comp_enabled_compressors;
 static nxt_uint_t                  nxt_http_comp_nr_enabled_compressors;
+static nxt_http_comp_static_opts_t nxt_http_comp_static_opts = {
+    .cache_size     = NXT_HTTP_COMP_CACHE_SIZE,
+    .cache_files    = NXT_HTTP_COMP_CACHE_FILES,
+};
+static nxt_http_comp_cache_t       nxt_http_comp_cache = {
+    .lru.head       = { &nxt_http_comp_cache.lru.head,
+                        &nxt_http_comp_cache.lru.head },
+};
 
 static nxt_thread_declare_data(nxt_http_comp_ctx_t,
                                nxt_http_comp_compressor_ctx);
@@ -95,6 +148,34 @@ static const nxt_conf_map_t  nxt_http_comp_compressors_opts_map[] = {
     },
 };
 
+static const nxt_conf_map_t  nxt_http_comp_static_opts_map[] = {
+    {
+        nxt_string("cache_size"),
+        NXT_CONF_MAP_OFF,
+        offsetof(nxt_http_comp_static_opts_t, cache_size),
+    }, {
+        nxt_string("cache_files"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_comp_static_opts_t, cache_files),
+    }, {
+        nxt_string("precompressed"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_http_comp_static_opts_t, precompressed),
+    },
+};
+
+static nxt_int_t nxt_http_comp_cache_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
+
+static const nxt_lvlhsh_proto_t  nxt_http_comp_cache_proto
+    nxt_aligned(64) =
+{
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_comp_cache_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
+
 static const nxt_http_comp_type_t  nxt_http_comp_compressors[] = {
     /* Keep this first */
     {
@@ -110,6 +191,7 @@ static const nxt_http_comp_type_t  nxt_http_comp_compressors[] = {
         .cops       = &nxt_http_comp_deflate_ops,
     }, {
         .token      = nxt_string("gzip"),
+        .ext        = nxt_string(".gz"),
         .scheme     = NXT_HTTP_COMP_SCHEME_GZIP,
         .def_compr  = NXT_HTTP_COMP_ZLIB_DEFAULT_LEVEL,
         .comp_min   = NXT_HTTP_COMP_ZLIB_COMP_MIN,
@@ -119,6 +201,7 @@ static const nxt_http_comp_type_t  nxt_http_comp_compressors[] = {
 #if NXT_HAVE_ZSTD
     }, {
         .token      = nxt_string("zstd"),
+        .ext        = nxt_string(".zst"),
         .scheme     = NXT_HTTP_COMP_SCHEME_ZSTD,
         .def_compr  = NXT_HTTP_COMP_ZSTD_DEFAULT_LEVEL,
         .comp_min   = NXT_HTTP_COMP_ZSTD_COMP_MIN,
@@ -128,6 +211,7 @@ static const nxt_http_comp_type_t  nxt_http_comp_compressors[] = {
 #if NXT_HAVE_BROTLI
     }, {
         .token      = nxt_string("br"),
+        .ext        = nxt_string(".br"),
         .scheme     = NXT_HTTP_COMP_SCHEME_BROTLI,
         .def_compr  = NXT_HTTP_COMP_BROTLI_DEFAULT_LEVEL,
         .comp_min   = NXT_HTTP_COMP_BROTLI_COMP_MIN,
@@ -167,6 +251,191 @@ nxt_http_comp_bound(size_t size)
 }
 
 
+/* Releases the compressor state when no data is going to be compressed. */
+static void
+nxt_http_comp_free(void)
+{
+    nxt_http_comp_ctx_t               *ctx = nxt_http_comp_ctx();
+    nxt_http_comp_compressor_t        *compressor;
+    const nxt_http_comp_operations_t  *cops;
+
+    compressor = &nxt_http_comp_enabled_compressors[ctx->idx];
+    cops = compressor->type->cops;
+
+    cops->free(&ctx->ctx);
+}
+
+
+static void
+nxt_http_comp_cache_key_init(nxt_http_comp_cache_key_t *key,
+                             const nxt_file_info_t *fi)
+{
+    nxt_http_comp_ctx_t         *ctx = nxt_http_comp_ctx();
+    nxt_http_comp_compressor_t  *compressor;
+
+    compressor = &nxt_http_comp_enabled_compressors[ctx->idx];
+
+    /* The key is hashed and compared as bytes, including the padding. */
+    nxt_memzero(key, sizeof(nxt_http_comp_cache_key_t));
+
+    key->dev = fi->st_dev;
+    key->ino = fi->st_ino;
+    key->mtime = nxt_file_mtime(fi);
+    key->size = nxt_file_size(fi);
+    key->scheme = compressor->type->scheme;
+    key->level = compressor->opts.level;
+}
+
+
+static nxt_int_t
+nxt_http_comp_cache_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_comp_cache_entry_t  *entry = data;
+
+    if (memcmp(lhq->key.start, &entry->key, lhq->key.length) == 0) {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+static void
+nxt_http_comp_cache_query_init(nxt_lvlhsh_query_t *lhq,
+                               nxt_http_comp_cache_key_t *key)
+{
+    lhq->key.start = (u_char *)key;
+    lhq->key.length = sizeof(nxt_http_comp_cache_key_t);
+    lhq->key_hash = nxt_murmur_hash2(lhq->key.start, lhq->key.length);
+    lhq->replace = 0;
+    lhq->proto = &nxt_http_comp_cache_proto;
+    lhq->pool = NULL;
+}
+
+
+/*
+ * Returns a duplicate of the cached file descriptor, or -1
+ * if the variant is not cached.
+ */
+static nxt_fd_t
+nxt_http_comp_cache_find(nxt_http_comp_cache_key_t *key, nxt_off_t *size)
+{
+    nxt_fd_t                     fd;
+    nxt_int_t                    ret;
+    nxt_lvlhsh_query_t           lhq;
+    nxt_http_comp_cache_t        *cache = &nxt_http_comp_cache;
+    nxt_http_comp_cache_entry_t  *entry;
+
+    nxt_http_comp_cache_query_init(&lhq, key);
+
+    fd = -1;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    ret = nxt_lvlhsh_find(&cache->hash, &lhq);
+
+    if (ret == NXT_OK) {
+        entry = lhq.value;
+
+        fd = dup(entry->fd);
+
+        if (fd != -1) {
+            *size = entry->size;
+
+            nxt_queue_remove(&entry->link);
+            nxt_queue_insert_head(&cache->lru, &entry->link);
+        }
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    return fd;
+}
+
+
+static void
+nxt_http_comp_cache_add(nxt_task_t *task, nxt_http_comp_cache_key_t *key,
+                        nxt_fd_t fd, nxt_off_t size)
+{
+    nxt_int_t                    ret;
+    nxt_queue_t                  evicted;
+    nxt_queue_link_t             *lnk;
+    nxt_lvlhsh_query_t           lhq;
+    nxt_http_comp_cache_t        *cache = &nxt_http_comp_cache;
+    nxt_http_comp_cache_entry_t  *entry, *old;
+
+    if (size > nxt_http_comp_static_opts.cache_size
+        || nxt_http_comp_static_opts.cache_files == 0)
+    {
+        return;
+    }
+
+    entry = nxt_malloc(sizeof(nxt_http_comp_cache_entry_t));
+    if (nxt_slow_path(entry == NULL)) {
+        return;
+    }
+
+    entry->fd = dup(fd);
+    if (nxt_slow_path(entry->fd == -1)) {
+        nxt_alert(task, "dup(%d) failed %E", fd, nxt_errno);
+        nxt_free(entry);
+        return;
+    }
+
+    entry->key = *key;
+    entry->size = size;
+
+    nxt_http_comp_cache_query_init(&lhq, &entry->key);
+    lhq.value = entry;
+
+    nxt_queue_init(&evicted);
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    ret = nxt_lvlhsh_insert(&cache->hash, &lhq);
+
+    if (ret == NXT_OK) {
+        nxt_queue_insert_head(&cache->lru, &entry->link);
+        cache->size += size;
+        cache->files++;
+
+        while (cache->size > nxt_http_comp_static_opts.cache_size
+               || cache->files
+                  > (nxt_uint_t)nxt_http_comp_static_opts.cache_files)
+        {
+            lnk = nxt_queue_last(&cache->lru);
+            old = nxt_queue_link_data(lnk, nxt_http_comp_cache_entry_t, link);
+
+            nxt_http_comp_cache_query_init(&lhq, &old->key);
+            nxt_lvlhsh_delete(&cache->hash, &lhq);
+
+            nxt_queue_remove(lnk);
+            nxt_queue_insert_tail(&evicted, lnk);
+
+            cache->size -= old->size;
+            cache->files--;
+        }
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    if (ret != NXT_OK) {
+        /* Another thread has cached the same variant. */
+        nxt_queue_insert_tail(&evicted, &entry->link);
+    }
+
+    while (!nxt_queue_is_empty(&evicted)) {
+        lnk = nxt_queue_first(&evicted);
+        nxt_queue_remove(lnk);
+
+        old = nxt_queue_link_data(lnk, nxt_http_comp_cache_entry_t, link);
+
+        nxt_fd_close(old->fd);
+        nxt_free(old);
+    }
+}
+
+
 nxt_int_t
 nxt_http_comp_compress_app_response(nxt_task_t *task, nxt_http_request_t *r,
                                     nxt_buf_t **b)
@@ -241,14 +510,33 @@ nxt_http_comp_compress_static_response(nxt_task_t *task, nxt_file_t **f,
     size_t         in_size, out_size, rest;
     u_char         *p;
     uint8_t        *in, *out;
-    nxt_int_t      ret;
-    nxt_file_t     tfile;
-    nxt_runtime_t  *rt = task->thread->runtime;
+    nxt_fd_t                   fd;
+    nxt_int_t                  ret;
+    nxt_off_t                  size;
+    nxt_file_t                 tfile;
+    nxt_runtime_t              *rt = task->thread->runtime;
+    nxt_http_comp_cache_key_t  key;
 
     static const char  *template = "unit-compr-XXXXXX";
 
     *out_total = 0;
 
+    nxt_http_comp_cache_key_init(&key, fi);
+
+    fd = nxt_http_comp_cache_find(&key, &size);
+    if (fd != -1) {
+        nxt_debug(task, "compressed response cache hit");
+
+        nxt_http_comp_free();
+
+        nxt_file_close(task, *f);
+        (*f)->fd = fd;
+
+        *out_total = size;
+
+        return NXT_OK;
+    }
+
     if (nxt_slow_path(strlen(rt->tmp) + 1 + strlen(template) + 1
                       > NXT_MAX_PATH_LEN))
     {
@@ -322,6 +610,8 @@ nxt_http_comp_compress_static_response(nxt_task_t *task, nxt_file_t **f,
         return NXT_ERROR;
     }
 
+    nxt_http_comp_cache_add(task, &key, tfile.fd, *out_total);
+
     nxt_file_close(task, *f);
 
     **f = tfile;
@@ -330,6 +620,117 @@ nxt_http_comp_compress_static_response(nxt_task_t *task, nxt_file_t **f,
 }
 
 
+/*
+ * The cached variants are dropped with the configuration, as
+ * the compressor settings and the served files may change.
+ */
+static void
+nxt_http_comp_cache_cleanup(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_queue_t                  flushed;
+    nxt_queue_link_t             *lnk;
+    nxt_lvlhsh_query_t           lhq;
+    nxt_http_comp_cache_t        *cache = &nxt_http_comp_cache;
+    nxt_http_comp_cache_entry_t  *entry;
+
+    nxt_queue_init(&flushed);
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    while (!nxt_queue_is_empty(&cache->lru)) {
+        lnk = nxt_queue_first(&cache->lru);
+        entry = nxt_queue_link_data(lnk, nxt_http_comp_cache_entry_t, link);
+
+        nxt_http_comp_cache_query_init(&lhq, &entry->key);
+        nxt_lvlhsh_delete(&cache->hash, &lhq);
+
+        nxt_queue_remove(lnk);
+        nxt_queue_insert_tail(&flushed, lnk);
+    }
+
+    cache->size = 0;
+    cache->files = 0;
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    while (!nxt_queue_is_empty(&flushed)) {
+        lnk = nxt_queue_first(&flushed);
+        nxt_queue_remove(lnk);
+
+        entry = nxt_queue_link_data(lnk, nxt_http_comp_cache_entry_t, link);
+
+        nxt_fd_close(entry->fd);
+        nxt_free(entry);
+    }
+}
+
+
+/*
+ * Opens a pre-compressed sidecar file, e.g. "style.css.gz", for the
+ * negotiated encoding.  The sidecar is used only if it is a regular file
+ * not older than the original one.
+ */
+nxt_int_t
+nxt_http_comp_static_precompressed(nxt_task_t *task, const u_char *fname,
+                                   nxt_file_t **f, nxt_file_info_t *fi)
+{
+    char                        path[NXT_MAX_PATH_LEN];
+    size_t                      len;
+    u_char                      *p;
+    nxt_int_t                   ret;
+    nxt_file_t                  sfile;
+    nxt_file_info_t             sfi;
+    const nxt_str_t             *ext;
+    nxt_http_comp_ctx_t         *ctx = nxt_http_comp_ctx();
+    nxt_http_comp_compressor_t  *compressor;
+
+    if (!nxt_http_comp_static_opts.precompressed) {
+        return NXT_DECLINED;
+    }
+
+    compressor = &nxt_http_comp_enabled_compressors[ctx->idx];
+    ext = &compressor->type->ext;
+
+    len = strlen((const char *)fname);
+
+    if (ext->length == 0 || len + ext->length + 1 > NXT_MAX_PATH_LEN) {
+        return NXT_DECLINED;
+    }
+
+    p = nxt_cpymem(path, fname, len);
+    p = nxt_cpymem(p, ext->start, ext->length);
+    *p = '\0';
+
+    sfile = (nxt_file_t){ .name = (nxt_file_name_t *)path };
+
+    ret = nxt_file_open(task, &sfile, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+    if (ret != NXT_OK) {
+        return NXT_DECLINED;
+    }
+
+    ret = nxt_file_info(&sfile, &sfi);
+
+    if (ret != NXT_OK
+        || !nxt_is_file(&sfi)
+        || nxt_file_mtime(&sfi) < nxt_file_mtime(fi))
+    {
+        nxt_file_close(task, &sfile);
+        return NXT_DECLINED;
+    }
+
+    nxt_debug(task, "pre-compressed \"%s\" found", path);
+
+    nxt_http_comp_free();
+
+    nxt_file_close(task, *f);
+    (*f)->fd = sfile.fd;
+
+    *fi = sfi;
+
+    return NXT_OK;
+}
+
+
 bool
 nxt_http_comp_wants_compression(void)
 {
@@ -687,6 +1088,18 @@ nxt_http_comp_set_compressor(nxt_task_t *task, nxt_router_conf_t *rtcf,
 }
 
 
+/*
+ * The compressors are allocated from the configuration memory pool,
+ * so a configuration without "compression" must not see the old ones.
+ */
+void
+nxt_http_comp_compression_reset(void)
+{
+    nxt_http_comp_nr_enabled_compressors = 0;
+    nxt_http_comp_mime_types_rule = NULL;
+}
+
+
 nxt_int_t
 nxt_http_comp_compression_init(nxt_task_t *task, nxt_router_conf_t *rtcf,
                                const nxt_conf_value_t *comp_conf)
@@ -700,6 +1113,25 @@ nxt_http_comp_compression_init(nxt_task_t *task, nxt_router_conf_t *rtcf,
     static const nxt_str_t  comps_str = nxt_string("compressors");
     static const nxt_str_t  mimes_str = nxt_string("types");
 
+    nxt_http_comp_static_opts = (nxt_http_comp_static_opts_t){
+        .cache_size     = NXT_HTTP_COMP_CACHE_SIZE,
+        .cache_files    = NXT_HTTP_COMP_CACHE_FILES,
+    };
+
+    ret = nxt_conf_map_object(rtcf->mem_pool, comp_conf,
+                              nxt_http_comp_static_opts_map,
+                              nxt_nitems(nxt_http_comp_static_opts_map),
+                              &nxt_http_comp_static_opts);
+    if (nxt_slow_path(ret == NXT_ERROR)) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_mp_cleanup(rtcf->mem_pool, nxt_http_comp_cache_cleanup, task,
+                         NULL, NULL);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
     mimes = nxt_conf_get_object_member(comp_conf, &mimes_str, NULL);
     if (mimes != NULL) {
         nxt_http_comp_mime_types_rule =
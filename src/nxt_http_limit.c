@@ -0,0 +1,820 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+
+
+/*
+ * Request rate is limited with a leaky bucket per key: "excess" is the
+ * number of requests above the rate, in thousandths of a request, and
+ * leaks with the "rate" speed.  A request that would raise "excess"
+ * above "burst" is rejected.  With "delay" enabled, a request within the
+ * burst is delayed until its excess leaks out.
+ */
+
+typedef struct {
+    nxt_queue_link_t            link;       /* LRU or busy. */
+    nxt_str_t                   key;
+    uint32_t                    key_hash;
+
+    nxt_msec_t                  last;
+    nxt_uint_t                  excess;
+    uint32_t                    conns;
+} nxt_http_limit_bucket_t;
+
+
+/*
+ * The buckets are split into shards by key hash, so engine threads
+ * limiting different clients rarely contend for the same lock.  Buckets
+ * with concurrent requests are kept out of the LRU list, so only idle
+ * buckets are evicted.  If all buckets of a full shard are busy, a request
+ * with a new key is rejected.
+ */
+
+typedef struct {
+    nxt_thread_spinlock_t       lock nxt_aligned(64);
+    nxt_lvlhsh_t                hash;
+    nxt_queue_t                 lru;
+    nxt_queue_t                 busy;
+    uint32_t                    entries;
+    uint32_t                    max_entries;
+} nxt_http_limit_shard_t;
+
+
+#define NXT_HTTP_LIMIT_SHARDS       16
+#define NXT_HTTP_LIMIT_MAX_ENTRIES  65536
+
+
+/*
+ * Zones are shared by all router configurations and are found by name,
+ * so reconfiguration keeps the counters.  Actions share a zone only by
+ * its explicit name.  A zone without explicit name is private to its
+ * action and is named after the route step, the key, and the limits.
+ */
+
+struct nxt_http_limit_zone_s {
+    nxt_http_limit_shard_t      shards[NXT_HTTP_LIMIT_SHARDS];
+
+    nxt_queue_link_t            link;       /* nxt_router_t.limits */
+    uint32_t                    count;
+    uint32_t                    max_entries;
+    nxt_str_t                   name;
+    uint8_t                     implicit;   /* 1 bit */
+};
+
+
+struct nxt_http_limit_conf_s {
+    nxt_http_limit_zone_t       *zone;
+    nxt_str_t                   limits;     /* Of a zone without name. */
+    nxt_tstr_t                  *key;
+    nxt_uint_t                  rate;
+    nxt_uint_t                  burst;
+    uint32_t                    connections;
+    uint32_t                    max_entries;
+    nxt_http_status_t           status;
+    uint8_t                     delay;  /* 1 bit */
+};
+
+
+typedef struct nxt_http_limit_conn_s  nxt_http_limit_conn_t;
+
+struct nxt_http_limit_conn_s {
+    nxt_http_limit_conn_t       *next;
+    nxt_http_limit_shard_t      *shard;
+    nxt_http_limit_bucket_t     *bucket;
+};
+
+
+struct nxt_http_limit_ctx_s {
+    nxt_http_action_t           *delayed;
+    nxt_http_limit_conn_t       *conns;
+};
+
+
+typedef struct {
+    nxt_str_t                   zone;
+    nxt_str_t                   key;
+    uint32_t                    rate;
+    uint32_t                    burst;
+    uint8_t                     delay;
+    uint32_t                    connections;
+    uint32_t                    status;
+    uint32_t                    max_entries;
+} nxt_http_limit_action_conf_t;
+
+
+static nxt_int_t nxt_http_limit_zone_add(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_http_limit_conf_t *conf, nxt_str_t *name,
+    nxt_bool_t implicit);
+static nxt_http_limit_zone_t *nxt_http_limit_zone_get(nxt_task_t *task,
+    nxt_router_t *router, nxt_str_t *name, nxt_bool_t implicit,
+    uint32_t max_entries);
+static void nxt_http_limit_zone_release(nxt_task_t *task, nxt_router_t *router,
+    nxt_http_limit_zone_t *zone);
+static nxt_int_t nxt_http_limit_check(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_limit_conf_t *conf, nxt_str_t *key, nxt_msec_t *delay);
+static nxt_http_limit_bucket_t *nxt_http_limit_bucket(
+    nxt_http_limit_shard_t *shard, nxt_str_t *key, uint32_t hash,
+    nxt_msec_t now, nxt_bool_t *created);
+static nxt_int_t nxt_http_limit_ctx(nxt_http_request_t *r);
+static void nxt_http_limit_delay_handler(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_int_t nxt_http_limit_test(nxt_lvlhsh_query_t *lhq, void *data);
+
+
+static const nxt_lvlhsh_proto_t  nxt_http_limit_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_limit_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
+
+
+static const nxt_http_request_state_t  nxt_http_limit_delay_state
+    nxt_aligned(64) =
+{
+    .error_handler = nxt_http_request_error_handler,
+};
+
+
+static nxt_conf_map_t  nxt_http_limit_action_conf[] = {
+    {
+        nxt_string("zone"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_http_limit_action_conf_t, zone),
+    },
+
+    {
+        nxt_string("key"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_http_limit_action_conf_t, key),
+    },
+
+    {
+        nxt_string("rate"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_limit_action_conf_t, rate),
+    },
+
+    {
+        nxt_string("burst"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_limit_action_conf_t, burst),
+    },
+
+    {
+        nxt_string("delay"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_http_limit_action_conf_t, delay),
+    },
+
+    {
+        nxt_string("connections"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_limit_action_conf_t, connections),
+    },
+
+    {
+        nxt_string("status"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_limit_action_conf_t, status),
+    },
+
+    {
+        nxt_string("max_entries"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_limit_action_conf_t, max_entries),
+    },
+};
+
+
+nxt_int_t
+nxt_http_limit_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
+    nxt_http_action_t *action, nxt_http_action_conf_t *acf)
+{
+    u_char                        *p;
+    size_t                        size;
+    nxt_int_t                     ret;
+    nxt_router_conf_t             *rtcf;
+    nxt_http_limit_conf_t         *conf;
+    nxt_http_limit_action_conf_t  lacf;
+
+    rtcf = tmcf->router_conf;
+
+    nxt_memzero(&lacf, sizeof(nxt_http_limit_action_conf_t));
+
+    lacf.status = NXT_HTTP_SERVICE_UNAVAILABLE;
+    lacf.max_entries = NXT_HTTP_LIMIT_MAX_ENTRIES;
+
+    ret = nxt_conf_map_object(tmcf->mem_pool, acf->limit,
+                              nxt_http_limit_action_conf,
+                              nxt_nitems(nxt_http_limit_action_conf), &lacf);
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
+    conf = nxt_mp_zalloc(rtcf->mem_pool, sizeof(nxt_http_limit_conf_t));
+    if (nxt_slow_path(conf == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->key = nxt_tstr_compile(rtcf->tstr_state, &lacf.key, 0);
+    if (nxt_slow_path(conf->key == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->rate = lacf.rate;
+    conf->burst = (nxt_uint_t) lacf.burst * 1000;
+    conf->delay = lacf.delay;
+    conf->connections = lacf.connections;
+    conf->max_entries = lacf.max_entries;
+    conf->status = lacf.status;
+
+    action->limit = conf;
+
+    if (lacf.zone.length != 0) {
+        return nxt_http_limit_zone_add(task, rtcf, conf, &lacf.zone, 0);
+    }
+
+    /* The zone is added with the route step names. */
+
+    size = lacf.key.length + 3 * (NXT_INT32_T_LEN + 1) + 1;
+
+    p = nxt_mp_nget(rtcf->mem_pool, size);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    conf->limits.start = p;
+
+    p = nxt_sprintf(p, p + size, " %V %uD/%uD/%uD", &lacf.key, lacf.rate,
+                    lacf.burst, lacf.connections);
+
+    conf->limits.length = p - conf->limits.start;
+
+    return NXT_OK;
+}
+
+
+/*
+ * The private zones of the action of a route step and its fallbacks
+ * are named "routes/main/0 $remote_addr 1/0/0",
+ * "routes/main/0/fallback $remote_addr 1/0/0", and so on.
+ */
+
+nxt_int_t
+nxt_http_limit_zones_init(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_http_action_t *action, nxt_str_t *name)
+{
+    u_char                 *p;
+    size_t                 depth;
+    nxt_int_t              ret;
+    nxt_str_t              zone;
+    nxt_http_limit_conf_t  *conf;
+
+    static const nxt_str_t  fallback = nxt_string("/fallback");
+
+    for (depth = 0; action != NULL; depth++, action = action->fallback) {
+        conf = action->limit;
+
+        if (conf == NULL || conf->zone != NULL) {
+            continue;
+        }
+
+        zone.length = name->length + depth * fallback.length
+                      + conf->limits.length;
+
+        zone.start = nxt_mp_nget(rtcf->mem_pool, zone.length);
+        if (nxt_slow_path(zone.start == NULL)) {
+            return NXT_ERROR;
+        }
+
+        p = nxt_cpymem(zone.start, name->start, name->length);
+
+        while (p < zone.start + name->length + depth * fallback.length) {
+            p = nxt_cpymem(p, fallback.start, fallback.length);
+        }
+
+        nxt_memcpy(p, conf->limits.start, conf->limits.length);
+
+        ret = nxt_http_limit_zone_add(task, rtcf, conf, &zone, 1);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_limit_zone_add(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_http_limit_conf_t *conf, nxt_str_t *name, nxt_bool_t implicit)
+{
+    nxt_uint_t             i;
+    nxt_http_limit_zone_t  *zone, **zonep;
+
+    if (rtcf->limits == NULL) {
+        rtcf->limits = nxt_array_create(rtcf->mem_pool, 2,
+                                        sizeof(nxt_http_limit_zone_t *));
+        if (nxt_slow_path(rtcf->limits == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    zonep = rtcf->limits->elts;
+
+    for (i = 0; i < rtcf->limits->nelts; i++) {
+        zone = zonep[i];
+
+        if (zone->implicit == implicit
+            && nxt_strstr_eq(&zone->name, name)
+            && zone->max_entries != conf->max_entries)
+        {
+            nxt_alert(task, "limit zone \"%V\" is configured with different "
+                      "\"max_entries\" values", name);
+            return NXT_ERROR;
+        }
+    }
+
+    zonep = nxt_array_add(rtcf->limits);
+    if (nxt_slow_path(zonep == NULL)) {
+        return NXT_ERROR;
+    }
+
+    zone = nxt_http_limit_zone_get(task, rtcf->router, name, implicit,
+                                   conf->max_entries);
+    if (nxt_slow_path(zone == NULL)) {
+        rtcf->limits->nelts--;
+        return NXT_ERROR;
+    }
+
+    *zonep = zone;
+
+    conf->zone = zone;
+
+    return NXT_OK;
+}
+
+
+static nxt_http_limit_zone_t *
+nxt_http_limit_zone_get(nxt_task_t *task, nxt_router_t *router,
+    nxt_str_t *name, nxt_bool_t implicit, uint32_t max_entries)
+{
+    nxt_uint_t              i;
+    nxt_http_limit_zone_t   *zone, *found;
+    nxt_http_limit_shard_t  *shard;
+
+    found = NULL;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    nxt_queue_each(zone, &router->limits, nxt_http_limit_zone_t, link) {
+
+        if (zone->implicit == implicit && nxt_strstr_eq(&zone->name, name)) {
+            zone->count++;
+            found = zone;
+            break;
+        }
+
+    } nxt_queue_loop;
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    zone = found;
+
+    if (zone == NULL) {
+        zone = nxt_memalign(64, sizeof(nxt_http_limit_zone_t) + name->length);
+        if (nxt_slow_path(zone == NULL)) {
+            return NULL;
+        }
+
+        nxt_memzero(zone, sizeof(nxt_http_limit_zone_t));
+
+        for (i = 0; i < NXT_HTTP_LIMIT_SHARDS; i++) {
+            nxt_queue_init(&zone->shards[i].lru);
+            nxt_queue_init(&zone->shards[i].busy);
+        }
+
+        zone->count = 1;
+        zone->implicit = implicit;
+
+        zone->name.length = name->length;
+        zone->name.start = nxt_pointer_to(zone, sizeof(nxt_http_limit_zone_t));
+        nxt_memcpy(zone->name.start, name->start, name->length);
+
+        nxt_thread_spin_lock(&router->lock);
+
+        nxt_queue_insert_tail(&router->limits, &zone->link);
+
+        nxt_thread_spin_unlock(&router->lock);
+    }
+
+    zone->max_entries = max_entries;
+
+    max_entries = nxt_max(max_entries / NXT_HTTP_LIMIT_SHARDS, 1);
+
+    for (i = 0; i < NXT_HTTP_LIMIT_SHARDS; i++) {
+        shard = &zone->shards[i];
+
+        nxt_thread_spin_lock(&shard->lock);
+        shard->max_entries = max_entries;
+        nxt_thread_spin_unlock(&shard->lock);
+    }
+
+    return zone;
+}
+
+
+void
+nxt_http_limits_release(nxt_task_t *task, nxt_router_conf_t *rtcf)
+{
+    nxt_uint_t             i;
+    nxt_http_limit_zone_t  **zones;
+
+    if (rtcf->limits == NULL) {
+        return;
+    }
+
+    zones = rtcf->limits->elts;
+
+    for (i = 0; i < rtcf->limits->nelts; i++) {
+        nxt_http_limit_zone_release(task, rtcf->router, zones[i]);
+    }
+
+    rtcf->limits = NULL;
+}
+
+
+static void
+nxt_http_limit_zone_release(nxt_task_t *task, nxt_router_t *router,
+    nxt_http_limit_zone_t *zone)
+{
+    nxt_uint_t               n;
+    nxt_http_limit_bucket_t  *bucket;
+
+    nxt_thread_spin_lock(&router->lock);
+
+    if (--zone->count != 0) {
+        nxt_thread_spin_unlock(&router->lock);
+        return;
+    }
+
+    nxt_queue_remove(&zone->link);
+
+    nxt_thread_spin_unlock(&router->lock);
+
+    nxt_debug(task, "http limit zone \"%V\" is destroyed", &zone->name);
+
+    for (n = 0; n < NXT_HTTP_LIMIT_SHARDS; n++) {
+
+        for ( ;; ) {
+            bucket = nxt_lvlhsh_retrieve(&zone->shards[n].hash,
+                                         &nxt_http_limit_proto, NULL);
+            if (bucket == NULL) {
+                break;
+            }
+
+            nxt_free(bucket);
+        }
+    }
+
+    nxt_free(zone);
+}
+
+
+nxt_http_action_t *
+nxt_http_limit_handler(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_action_t *action)
+{
+    nxt_int_t              ret;
+    nxt_str_t              key;
+    nxt_msec_t             delay;
+    nxt_router_conf_t      *rtcf;
+    nxt_event_engine_t     *engine;
+    nxt_http_limit_conf_t  *conf;
+
+    if (r->limit != NULL && r->limit->delayed == action) {
+        r->limit->delayed = NULL;
+        return action;
+    }
+
+    conf = action->limit;
+
+    if (nxt_tstr_is_const(conf->key)) {
+        nxt_tstr_str(conf->key, &key);
+
+    } else {
+        rtcf = r->conf->socket_conf->router_conf;
+
+        ret = nxt_tstr_query_init(&r->tstr_query, rtcf->tstr_state,
+                                  &r->tstr_cache, r, r->mem_pool);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
+
+        ret = nxt_tstr_query(task, r->tstr_query, conf->key, &key);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
+    }
+
+    delay = 0;
+
+    ret = nxt_http_limit_check(task, r, conf, &key, &delay);
+
+    if (ret == NXT_DECLINED) {
+        nxt_log(task, NXT_LOG_INFO, "limiting requests by key \"%V\"", &key);
+
+        nxt_http_request_error(task, r, conf->status);
+        return NULL;
+    }
+
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto fail;
+    }
+
+    if (delay == 0) {
+        return action;
+    }
+
+    nxt_debug(task, "http limit delay: \"%V\", %M ms", &key, delay);
+
+    if (r->limit == NULL && nxt_http_limit_ctx(r) != NXT_OK) {
+        goto fail;
+    }
+
+    r->limit->delayed = action;
+
+    /* The pool is released by nxt_http_limit_delay_handler(). */
+    nxt_mp_retain(r->mem_pool);
+
+    r->state = &nxt_http_limit_delay_state;
+
+    engine = task->thread->engine;
+
+    r->timer.task = &engine->task;
+    r->timer.work_queue = &engine->fast_work_queue;
+    r->timer.log = engine->task.log;
+    r->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+    r->timer.handler = nxt_http_limit_delay_handler;
+
+    nxt_timer_add(engine, &r->timer, delay);
+
+    return NULL;
+
+fail:
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+
+    return NULL;
+}
+
+
+static nxt_int_t
+nxt_http_limit_check(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_limit_conf_t *conf, nxt_str_t *key, nxt_msec_t *delay)
+{
+    uint32_t                 hash;
+    nxt_int_t                ret;
+    nxt_bool_t               created;
+    nxt_msec_t               now;
+    nxt_msec_int_t           elapsed;
+    nxt_uint_t               excess, leaked;
+    nxt_http_limit_conn_t    *conn;
+    nxt_http_limit_shard_t   *shard;
+    nxt_http_limit_bucket_t  *bucket;
+
+    if (conf->connections != 0) {
+        if (r->limit == NULL && nxt_http_limit_ctx(r) != NXT_OK) {
+            return NXT_ERROR;
+        }
+
+        conn = nxt_mp_get(r->mem_pool, sizeof(nxt_http_limit_conn_t));
+        if (nxt_slow_path(conn == NULL)) {
+            return NXT_ERROR;
+        }
+
+    } else {
+        conn = NULL;
+    }
+
+    hash = nxt_djb_hash(key->start, key->length);
+    shard = &conf->zone->shards[hash % NXT_HTTP_LIMIT_SHARDS];
+
+    now = task->thread->engine->timers.now;
+
+    ret = NXT_OK;
+
+    nxt_thread_spin_lock(&shard->lock);
+
+    bucket = nxt_http_limit_bucket(shard, key, hash, now, &created);
+
+    if (nxt_slow_path(bucket == NULL)) {
+        /* A full table must not disable the limit. */
+        ret = NXT_DECLINED;
+        goto done;
+    }
+
+    if (conn != NULL && bucket->conns >= conf->connections) {
+        ret = NXT_DECLINED;
+        goto done;
+    }
+
+    if (conf->rate != 0 && !created) {
+        elapsed = nxt_msec_diff(now, bucket->last);
+        leaked = (elapsed > 0) ? conf->rate * (nxt_uint_t) elapsed : 0;
+
+        excess = bucket->excess + 1000;
+        excess = (excess > leaked) ? excess - leaked : 0;
+
+        if (excess > conf->burst) {
+            ret = NXT_DECLINED;
+            goto done;
+        }
+
+        bucket->excess = excess;
+
+        if (elapsed > 0) {
+            bucket->last = now;
+        }
+
+        if (conf->delay) {
+            *delay = excess / conf->rate;
+        }
+    }
+
+    if (conn != NULL) {
+        if (bucket->conns++ == 0) {
+            nxt_queue_remove(&bucket->link);
+            nxt_queue_insert_head(&shard->busy, &bucket->link);
+        }
+
+        conn->shard = shard;
+        conn->bucket = bucket;
+        conn->next = r->limit->conns;
+        r->limit->conns = conn;
+    }
+
+done:
+
+    nxt_thread_spin_unlock(&shard->lock);
+
+    return ret;
+}
+
+
+static nxt_http_limit_bucket_t *
+nxt_http_limit_bucket(nxt_http_limit_shard_t *shard, nxt_str_t *key,
+    uint32_t hash, nxt_msec_t now, nxt_bool_t *created)
+{
+    nxt_queue_link_t         *lnk;
+    nxt_lvlhsh_query_t       lhq;
+    nxt_http_limit_bucket_t  *bucket;
+
+    lhq.key = *key;
+    lhq.key_hash = hash;
+    lhq.proto = &nxt_http_limit_proto;
+    lhq.pool = NULL;
+
+    if (nxt_lvlhsh_find(&shard->hash, &lhq) == NXT_OK) {
+        bucket = lhq.value;
+
+        if (bucket->conns == 0) {
+            nxt_queue_remove(&bucket->link);
+            nxt_queue_insert_head(&shard->lru, &bucket->link);
+        }
+
+        *created = 0;
+
+        return bucket;
+    }
+
+    bucket = NULL;
+
+    if (shard->entries >= shard->max_entries) {
+
+        if (nxt_queue_is_empty(&shard->lru)) {
+            /* All buckets are busy. */
+            return NULL;
+        }
+
+        lnk = nxt_queue_last(&shard->lru);
+        bucket = nxt_queue_link_data(lnk, nxt_http_limit_bucket_t, link);
+
+        nxt_queue_remove(&bucket->link);
+        shard->entries--;
+
+        lhq.key = bucket->key;
+        lhq.key_hash = bucket->key_hash;
+
+        (void) nxt_lvlhsh_delete(&shard->hash, &lhq);
+
+        if (bucket->key.length < key->length) {
+            nxt_free(bucket);
+            bucket = NULL;
+        }
+    }
+
+    if (bucket == NULL) {
+        bucket = nxt_malloc(sizeof(nxt_http_limit_bucket_t) + key->length);
+        if (nxt_slow_path(bucket == NULL)) {
+            return NULL;
+        }
+    }
+
+    bucket->key.start = nxt_pointer_to(bucket, sizeof(nxt_http_limit_bucket_t));
+    bucket->key.length = key->length;
+    nxt_memcpy(bucket->key.start, key->start, key->length);
+
+    bucket->key_hash = hash;
+    bucket->last = now;
+    bucket->excess = 0;
+    bucket->conns = 0;
+
+    lhq.key = bucket->key;
+    lhq.key_hash = hash;
+    lhq.replace = 0;
+    lhq.value = bucket;
+
+    if (nxt_slow_path(nxt_lvlhsh_insert(&shard->hash, &lhq) != NXT_OK)) {
+        nxt_free(bucket);
+        return NULL;
+    }
+
+    nxt_queue_insert_head(&shard->lru, &bucket->link);
+    shard->entries++;
+
+    *created = 1;
+
+    return bucket;
+}
+
+
+static nxt_int_t
+nxt_http_limit_ctx(nxt_http_request_t *r)
+{
+    r->limit = nxt_mp_zget(r->mem_pool, sizeof(nxt_http_limit_ctx_t));
+    if (nxt_slow_path(r->limit == NULL)) {
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_limit_delay_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t         *timer;
+    nxt_http_request_t  *r;
+
+    timer = obj;
+
+    r = nxt_timer_data(timer, nxt_http_request_t, timer);
+
+    if (nxt_fast_path(r->proto.any != NULL && !r->error)) {
+        nxt_http_request_action(task, r, r->limit->delayed);
+    }
+
+    nxt_mp_release(r->mem_pool);
+}
+
+
+void
+nxt_http_limit_close(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_http_limit_conn_t    *conn;
+    nxt_http_limit_shard_t   *shard;
+    nxt_http_limit_bucket_t  *bucket;
+
+    for (conn = r->limit->conns; conn != NULL; conn = conn->next) {
+        shard = conn->shard;
+        bucket = conn->bucket;
+
+        nxt_thread_spin_lock(&shard->lock);
+
+        if (--bucket->conns == 0) {
+            nxt_queue_remove(&bucket->link);
+            nxt_queue_insert_head(&shard->lru, &bucket->link);
+        }
+
+        nxt_thread_spin_unlock(&shard->lock);
+    }
+
+    r->limit->conns = NULL;
+}
+
+
+static nxt_int_t
+nxt_http_limit_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_limit_bucket_t  *bucket;
+
+    bucket = data;
+
+    return nxt_strstr_eq(&lhq->key, &bucket->key) ? NXT_OK : NXT_DECLINED;
+}
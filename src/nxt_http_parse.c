@@ -6,6 +6,16 @@
 
 #include <nxt_main.h>
 
+#if (NXT_HAVE_AVX2)
+#include <immintrin.h>
+#elif (NXT_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if (NXT_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 
 static nxt_int_t nxt_http_parse_unusual_target(nxt_http_request_parse_t *rp,
     u_char **pos, const u_char *end);
@@ -16,6 +26,17 @@ static nxt_int_t nxt_http_parse_field_name(nxt_http_request_parse_t *rp,
 static nxt_int_t nxt_http_parse_field_value(nxt_http_request_parse_t *rp,
     u_char **pos, const u_char *end);
 static u_char *nxt_http_lookup_field_end(u_char *p, const u_char *end);
+static u_char *nxt_http_lookup_field_end_scalar(u_char *p, const u_char *end);
+#if (NXT_HAVE_SSE2)
+static u_char *nxt_http_lookup_field_end_sse2(u_char *p, const u_char *end);
+#endif
+#if (NXT_HAVE_AVX2)
+static u_char *nxt_http_lookup_field_end_avx2(u_char *p, const u_char *end)
+    __attribute__ ((target("avx2")));
+#endif
+#if (NXT_HAVE_NEON)
+static u_char *nxt_http_lookup_field_end_neon(u_char *p, const u_char *end);
+#endif
 static nxt_int_t nxt_http_parse_field_end(nxt_http_request_parse_t *rp,
     u_char **pos, const u_char *end);
 
@@ -696,8 +717,127 @@ nxt_http_parse_field_value(nxt_http_request_parse_t *rp, u_char **pos,
 }
 
 
+/*
+ * Field values may be long, so the first control character is looked up
+ * with the widest vector instructions supported by the CPU.  The bytes
+ * are compared as unsigned, since octets above 0x7F are allowed.
+ */
+
 static u_char *
 nxt_http_lookup_field_end(u_char *p, const u_char *end)
+{
+#if (NXT_HAVE_AVX2)
+    if (nxt_fast_path(nxt_cpu_features & NXT_CPU_AVX2)) {
+        return nxt_http_lookup_field_end_avx2(p, end);
+    }
+#endif
+
+#if (NXT_HAVE_SSE2)
+    if (nxt_fast_path(nxt_cpu_features & NXT_CPU_SSE2)) {
+        return nxt_http_lookup_field_end_sse2(p, end);
+    }
+#endif
+
+#if (NXT_HAVE_NEON)
+    if (nxt_fast_path(nxt_cpu_features & NXT_CPU_NEON)) {
+        return nxt_http_lookup_field_end_neon(p, end);
+    }
+#endif
+
+    return nxt_http_lookup_field_end_scalar(p, end);
+}
+
+
+#if (NXT_HAVE_AVX2)
+
+static u_char *
+nxt_http_lookup_field_end_avx2(u_char *p, const u_char *end)
+{
+    uint32_t  mask;
+    __m256i   v, ctl;
+
+    ctl = _mm256_set1_epi8(0x1F);
+
+    while (nxt_fast_path(end - p >= 32)) {
+        v = _mm256_loadu_si256((const __m256i *) p);
+        v = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v);
+
+        mask = _mm256_movemask_epi8(v);
+
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+
+        p += 32;
+    }
+
+#if (NXT_HAVE_SSE2)
+    return nxt_http_lookup_field_end_sse2(p, end);
+#else
+    return nxt_http_lookup_field_end_scalar(p, end);
+#endif
+}
+
+#endif
+
+
+#if (NXT_HAVE_SSE2)
+
+static u_char *
+nxt_http_lookup_field_end_sse2(u_char *p, const u_char *end)
+{
+    uint32_t  mask;
+    __m128i   v, ctl;
+
+    ctl = _mm_set1_epi8(0x1F);
+
+    while (nxt_fast_path(end - p >= 16)) {
+        v = _mm_loadu_si128((const __m128i *) p);
+        v = _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v);
+
+        mask = _mm_movemask_epi8(v);
+
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+
+        p += 16;
+    }
+
+    return nxt_http_lookup_field_end_scalar(p, end);
+}
+
+#endif
+
+
+#if (NXT_HAVE_NEON)
+
+static u_char *
+nxt_http_lookup_field_end_neon(u_char *p, const u_char *end)
+{
+    uint8x16_t  v, ctl;
+
+    ctl = vdupq_n_u8(0x20);
+
+    while (nxt_fast_path(end - p >= 16)) {
+        v = vcltq_u8(vld1q_u8(p), ctl);
+
+        if (vmaxvq_u8(v) != 0) {
+            /* The scalar lookup finds the byte within the block. */
+            break;
+        }
+
+        p += 16;
+    }
+
+    return nxt_http_lookup_field_end_scalar(p, end);
+}
+
+#endif
+
+
+static u_char *
+nxt_http_lookup_field_end_scalar(u_char *p, const u_char *end)
 {
     while (nxt_fast_path(end - p >= 16)) {
 
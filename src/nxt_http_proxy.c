@@ -30,6 +30,8 @@ static void nxt_http_proxy_send_body(nxt_task_t *task, void *obj, void *data);
 static void nxt_http_proxy_buf_mem_completion(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_proxy_server_free(nxt_task_t *task, nxt_http_peer_t *peer,
+    nxt_bool_t failed);
 
 
 static const nxt_http_request_state_t  nxt_http_proxy_header_send_state;
@@ -143,6 +145,8 @@ nxt_upstream_proxy_handler(nxt_task_t *task, nxt_http_request_t *r,
     peer->server = us;
 
     us->upstream = upstream;
+    us->start = nxt_thread_monotonic_time(task->thread);
+
     upstream->proto->get(task, us);
 
     return NULL;
@@ -255,6 +259,8 @@ nxt_http_proxy_header_read(nxt_task_t *task, void *obj, void *data)
 
     r->status = peer->status;
 
+    peer->server->header_time = nxt_thread_monotonic_time(task->thread);
+
     nxt_debug(task, "http proxy status: %d", peer->status);
 
     nxt_list_each(field, peer->fields) {
@@ -309,6 +315,8 @@ nxt_http_proxy_send_body(nxt_task_t *task, void *obj, void *data)
         nxt_http_proto[peer->protocol].peer_read(task, peer);
 
     } else {
+        nxt_http_proxy_server_free(task, peer, 0);
+
         nxt_http_proto[peer->protocol].peer_close(task, peer);
 
         nxt_mp_release(r->mem_pool);
@@ -375,6 +383,7 @@ nxt_http_proxy_buf_mem_free(nxt_task_t *task, nxt_http_request_t *r,
 static void
 nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data)
 {
+    nxt_bool_t          failed;
     nxt_http_peer_t     *peer;
     nxt_http_request_t  *r;
 
@@ -382,6 +391,13 @@ nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data)
     peer = r->peer;
 
     if (!peer->closed) {
+        /* The server has not responded or has not responded in time. */
+        failed = !peer->header_received
+                 && (peer->status == NXT_HTTP_BAD_GATEWAY
+                     || peer->status == NXT_HTTP_GATEWAY_TIMEOUT);
+
+        nxt_http_proxy_server_free(task, peer, failed);
+
         nxt_http_proto[peer->protocol].peer_close(task, peer);
         nxt_mp_release(r->mem_pool);
     }
@@ -390,6 +406,20 @@ nxt_http_proxy_error(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_http_proxy_server_free(nxt_task_t *task, nxt_http_peer_t *peer,
+    nxt_bool_t failed)
+{
+    nxt_upstream_server_t  *us;
+
+    us = peer->server;
+
+    if (us->upstream->proto->free != NULL) {
+        us->upstream->proto->free(task, us, failed);
+    }
+}
+
+
 nxt_int_t
 nxt_http_proxy_date(void *ctx, nxt_http_field_t *field, uintptr_t data)
 {
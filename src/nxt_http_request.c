@@ -20,6 +20,8 @@ static nxt_sockaddr_t *nxt_http_request_client_ip_sockaddr(
 static void nxt_http_request_forward_protocol(nxt_http_request_t *r,
     nxt_http_field_t *field);
 static void nxt_http_request_ready(nxt_task_t *task, void *obj, void *data);
+static void nxt_http_request_action_body_ready(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_http_request_proto_info(nxt_task_t *task,
     nxt_http_request_t *r);
 static void nxt_http_request_mem_buf_completion(nxt_task_t *task, void *obj,
@@ -51,6 +53,7 @@ static nxt_http_name_value_t *nxt_http_cookie(nxt_array_t *array, u_char *name,
 
 static const nxt_http_request_state_t  nxt_http_request_init_state;
 static const nxt_http_request_state_t  nxt_http_request_body_state;
+static const nxt_http_request_state_t  nxt_http_request_action_body_state;
 
 
 nxt_time_string_t  nxt_http_date_cache = {
@@ -74,6 +77,12 @@ nxt_http_init(nxt_task_t *task)
         return ret;
     }
 
+    ret = nxt_h2p_init(task);
+
+    if (ret != NXT_OK) {
+        return ret;
+    }
+
     return nxt_http_response_hash_init(task);
 }
 
@@ -618,11 +627,41 @@ nxt_http_request_action(nxt_task_t *task, nxt_http_request_t *r,
     if (nxt_fast_path(action != NULL)) {
 
         do {
+            if (action->limit != NULL) {
+                action = nxt_http_limit_handler(task, r, action);
+
+                if (action == NULL) {
+                    return;
+                }
+            }
+
             ret = nxt_http_rewrite(task, r);
             if (nxt_slow_path(ret != NXT_OK)) {
                 break;
             }
 
+            if (action->cache != NULL) {
+                action = nxt_http_cache_handler(task, r, action);
+
+                if (action == NULL) {
+                    return;
+                }
+            }
+
+            if (nxt_slow_path(r->body_stream)
+                && action->handler != nxt_http_route_handler
+                && action->handler != nxt_http_application_handler)
+            {
+                /* Only applications accept a streamed request body. */
+
+                r->body_stream = 0;
+                r->body_action = action;
+                r->state = &nxt_http_request_action_body_state;
+
+                nxt_http_request_read_body(task, r);
+                return;
+            }
+
             action = action->handler(task, r, action);
 
             if (action == NULL) {
@@ -640,6 +679,42 @@ nxt_http_request_action(nxt_task_t *task, nxt_http_request_t *r,
 }
 
 
+static const nxt_http_request_state_t  nxt_http_request_action_body_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_http_request_action_body_ready,
+    .error_handler = nxt_http_request_close_handler,
+};
+
+
+static void
+nxt_http_request_action_body_ready(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_http_action_t   *action;
+    nxt_http_request_t  *r;
+
+    r = obj;
+
+    action = r->body_action;
+    r->body_action = NULL;
+
+    r->state = &nxt_http_request_body_state;
+
+    action = action->handler(task, r, action);
+
+    if (action == NULL) {
+        return;
+    }
+
+    if (action == NXT_HTTP_ACTION_ERROR) {
+        nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    nxt_http_request_action(task, r, action);
+}
+
+
 nxt_http_action_t *
 nxt_http_application_handler(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *action)
@@ -683,6 +758,23 @@ nxt_http_request_read_body(nxt_task_t *task, nxt_http_request_t *r)
 }
 
 
+/*
+ * Reads the next part of a request body deferred by the protocol and
+ * passes it to the handler.  The body_stream flag is cleared before
+ * the last part is passed.  A NULL part means the connection has failed
+ * and the rest of the body will not arrive.
+ */
+
+void
+nxt_http_request_body_stream(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_work_handler_t handler)
+{
+    if (nxt_fast_path(r->proto.any != NULL)) {
+        nxt_http_proto[r->protocol].body_stream(task, r, handler);
+    }
+}
+
+
 void
 nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t body_handler, void *data)
@@ -692,6 +784,10 @@ nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_field_t   *server, *date, *content_length;
     nxt_socket_conf_t  *skcf;
 
+    if (r->cache != NULL) {
+        nxt_http_cache_header_filter(task, r);
+    }
+
     ret = nxt_http_set_headers(r);
     if (nxt_slow_path(ret != NXT_OK)) {
         goto fail;
@@ -782,12 +878,27 @@ nxt_http_request_ws_frame_start(nxt_task_t *task, nxt_http_request_t *r,
 void
 nxt_http_request_send(nxt_task_t *task, nxt_http_request_t *r, nxt_buf_t *out)
 {
+    if (r->cache != NULL) {
+        nxt_http_cache_body_filter(task, r, out);
+    }
+
     if (nxt_fast_path(r->proto.any != NULL)) {
         nxt_http_proto[r->protocol].send(task, r, out);
     }
 }
 
 
+nxt_bool_t
+nxt_http_request_sendfile(nxt_task_t *task, nxt_http_request_t *r)
+{
+    if (r->proto.any == NULL || nxt_http_proto[r->protocol].sendfile == NULL) {
+        return 0;
+    }
+
+    return nxt_http_proto[r->protocol].sendfile(task, r);
+}
+
+
 nxt_buf_t *
 nxt_http_buf_mem(nxt_task_t *task, nxt_http_request_t *r, size_t size)
 {
@@ -890,6 +1001,8 @@ nxt_http_request_close_handler(nxt_task_t *task, void *obj, void *data)
     if (!r->logged) {
         r->logged = 1;
 
+        nxt_router_metrics_request(task, r);
+
         if (rtcf->access_log != NULL) {
             access_log = rtcf->access_log;
 
@@ -916,6 +1029,14 @@ nxt_http_request_close_handler(nxt_task_t *task, void *obj, void *data)
         nxt_tstr_query_release(r->tstr_query);
     }
 
+    if (r->cache != NULL) {
+        nxt_http_cache_close(task, r);
+    }
+
+    if (r->limit != NULL) {
+        nxt_http_limit_close(task, r);
+    }
+
     if (nxt_fast_path(proto.any != NULL)) {
         protocol = r->protocol;
 
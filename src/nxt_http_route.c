@@ -6,6 +6,7 @@
 
 #include <nxt_router.h>
 #include <nxt_http.h>
+#include <nxt_status.h>
 #include <nxt_sockaddr.h>
 #include <nxt_http_route_addr.h>
 #include <nxt_regex.h>
@@ -141,12 +142,69 @@ typedef struct {
     uint32_t                       items;
     nxt_tstr_cond_t                condition;
     nxt_http_action_t              action;
+    nxt_str_t                      name;
     nxt_http_route_test_t          test[];
 } nxt_http_route_match_t;
 
 
+/*
+ * A route with many steps has an index that selects the steps which
+ * may match a request by its host, URI, and method.  The candidate steps
+ * are then tested in order as usual, so the first matching step wins.
+ *
+ * Steps with exact "host" patterns are found in a hash by the request
+ * host.  Other steps are stored in a trie by the literal prefixes of
+ * their "uri" patterns, or in the trie root if there are none.  Steps
+ * found by host are additionally filtered by their URI prefixes; all
+ * steps are filtered by a bitmap of their exact "method" patterns.
+ */
+
+#define NXT_HTTP_ROUTE_INDEX_MIN       8
+#define NXT_HTTP_ROUTE_INDEX_LISTS     16
+
+#define NXT_HTTP_ROUTE_METHOD_OTHER    0x0200
+#define NXT_HTTP_ROUTE_METHOD_NONE     0x0400
+#define NXT_HTTP_ROUTE_METHOD_ANY      0xffffffff
+
+
+typedef struct nxt_http_route_node_s  nxt_http_route_node_t;
+
+
+typedef struct {
+    u_char                         byte;
+    nxt_http_route_node_t          *node;
+} nxt_http_route_child_t;
+
+
+struct nxt_http_route_node_s {
+    nxt_array_t                    *children;  /* of nxt_http_route_child_t */
+    nxt_array_t                    *steps;     /* of uint32_t */
+};
+
+
+typedef struct {
+    nxt_str_t                      host;
+    nxt_array_t                    *steps;     /* of uint32_t */
+} nxt_http_route_host_t;
+
+
+typedef struct {
+    uint32_t                       methods;
+    uint32_t                       prefixes;
+    nxt_str_t                      *prefix;
+} nxt_http_route_filter_t;
+
+
+typedef struct {
+    nxt_lvlhsh_t                   hosts;
+    nxt_http_route_node_t          uri;
+    nxt_http_route_filter_t        filter[];
+} nxt_http_route_index_t;
+
+
 struct nxt_http_route_s {
     nxt_str_t                      name;
+    nxt_http_route_index_t         *index;
     uint32_t                       items;
     nxt_http_route_match_t         *match[];
 };
@@ -162,6 +220,25 @@ static nxt_http_route_t *nxt_http_route_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *cv);
 static nxt_http_route_match_t *nxt_http_route_match_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *cv);
+static nxt_int_t nxt_http_route_names(nxt_task_t *task,
+    nxt_router_conf_t *rtcf, nxt_http_route_t *route);
+static nxt_int_t nxt_http_route_index_create(nxt_mp_t *mp,
+    nxt_http_route_t *route);
+static nxt_http_route_rule_t *nxt_http_route_index_rule(
+    nxt_http_route_match_t *match, nxt_http_route_object_t object,
+    size_t offset);
+static nxt_bool_t nxt_http_route_index_patterns(nxt_http_route_rule_t *rule,
+    nxt_bool_t exact);
+static nxt_int_t nxt_http_route_index_host(nxt_mp_t *mp,
+    nxt_http_route_index_t *index, nxt_str_t *host, uint32_t step);
+static nxt_http_route_node_t *nxt_http_route_index_node(nxt_mp_t *mp,
+    nxt_http_route_node_t *node, nxt_str_t *prefix);
+static nxt_int_t nxt_http_route_index_step(nxt_mp_t *mp, nxt_array_t **steps,
+    uint32_t step);
+static nxt_int_t nxt_http_route_host_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
+static void *nxt_http_route_host_alloc(void *data, size_t size);
+static void nxt_http_route_host_free(void *data, void *p);
 static nxt_http_route_table_t *nxt_http_route_table_create(nxt_task_t *task,
     nxt_mp_t *mp, nxt_conf_value_t *table_cv, nxt_http_route_object_t object,
     nxt_bool_t case_sensitive, nxt_http_uri_encoding_t encoding);
@@ -202,10 +279,18 @@ static nxt_int_t nxt_http_pass_find(nxt_mp_t *mp, nxt_router_conf_t *rtcf,
 static nxt_int_t nxt_http_route_find(nxt_http_routes_t *routes, nxt_str_t *name,
     nxt_http_action_t *action);
 
-static nxt_http_action_t *nxt_http_route_handler(nxt_task_t *task,
-    nxt_http_request_t *r, nxt_http_action_t *start);
 static nxt_http_action_t *nxt_http_route_match(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_route_match_t *match);
+static nxt_http_action_t *nxt_http_route_lookup(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_route_t *route, uint32_t *step);
+static nxt_int_t nxt_http_route_index_find(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_route_t *route, nxt_http_action_t **action,
+    uint32_t *step);
+static uint32_t nxt_http_route_method(nxt_str_t *method);
+static nxt_bool_t nxt_http_route_prefix(nxt_http_route_filter_t *filter,
+    nxt_str_t *path);
+static nxt_http_route_node_t *nxt_http_route_node_child(
+    nxt_http_route_node_t *node, u_char byte);
 static nxt_int_t nxt_http_route_table(nxt_http_request_t *r,
     nxt_http_route_table_t *table);
 static nxt_int_t nxt_http_route_ruleset(nxt_http_request_t *r,
@@ -239,6 +324,7 @@ nxt_http_routes_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     size_t             size;
     uint32_t           i, n, next;
     nxt_mp_t           *mp;
+    nxt_int_t          ret;
     nxt_str_t          name, *string;
     nxt_bool_t         object;
     nxt_conf_value_t   *route_conf;
@@ -289,10 +375,442 @@ nxt_http_routes_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         route->name.start = NULL;
     }
 
+    for (i = 0; i < n; i++) {
+        route = routes->route[i];
+
+        ret = nxt_http_route_names(task, tmcf->router_conf, route);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NULL;
+        }
+
+        if (nxt_slow_path(nxt_http_route_index_create(mp, route) != NXT_OK)) {
+            return NULL;
+        }
+    }
+
     return routes;
 }
 
 
+/* The step names are used for status metrics and private limit zones. */
+
+static nxt_int_t
+nxt_http_route_names(nxt_task_t *task, nxt_router_conf_t *rtcf,
+    nxt_http_route_t *route)
+{
+    u_char                  *p;
+    size_t                  size;
+    uint32_t                i;
+    nxt_int_t               ret;
+    nxt_http_route_match_t  *match;
+
+    size = nxt_length("routes//") + route->name.length + NXT_INT32_T_LEN;
+
+    for (i = 0; i < route->items; i++) {
+        match = route->match[i];
+
+        p = nxt_mp_nget(rtcf->mem_pool, size);
+        if (nxt_slow_path(p == NULL)) {
+            return NXT_ERROR;
+        }
+
+        match->name.start = p;
+
+        if (route->name.length == 0) {
+            p = nxt_sprintf(p, p + size, "routes/%uD", i);
+
+        } else {
+            p = nxt_sprintf(p, p + size, "routes/%V/%uD", &route->name, i);
+        }
+
+        match->name.length = p - match->name.start;
+
+        ret = nxt_router_metric_conf(rtcf, NXT_STATUS_METRIC_ROUTE,
+                                     &match->name);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        ret = nxt_http_limit_zones_init(task, rtcf, &match->action,
+                                        &match->name);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return NXT_OK;
+}
+
+
+static const nxt_str_t  nxt_http_route_methods[] = {
+    nxt_string("GET"),
+    nxt_string("HEAD"),
+    nxt_string("POST"),
+    nxt_string("PUT"),
+    nxt_string("DELETE"),
+    nxt_string("PATCH"),
+    nxt_string("OPTIONS"),
+    nxt_string("CONNECT"),
+    nxt_string("TRACE"),
+};
+
+
+static const nxt_lvlhsh_proto_t  nxt_http_route_hosts_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_route_host_test,
+    nxt_http_route_host_alloc,
+    nxt_http_route_host_free,
+};
+
+
+static nxt_int_t
+nxt_http_route_index_create(nxt_mp_t *mp, nxt_http_route_t *route)
+{
+    uint32_t                  i, j;
+    nxt_int_t                 ret;
+    nxt_str_t                 prefix;
+    nxt_array_t               *slices;
+    nxt_http_route_rule_t     *host, *uri, *method;
+    nxt_http_route_node_t     *node;
+    nxt_http_route_index_t    *index;
+    nxt_http_route_filter_t   *filter;
+    nxt_http_route_match_t    *match;
+    nxt_http_route_pattern_t  *pattern;
+    nxt_http_route_pattern_slice_t  *slice;
+
+    if (route->items < NXT_HTTP_ROUTE_INDEX_MIN) {
+        return NXT_OK;
+    }
+
+    index = nxt_mp_zget(mp, sizeof(nxt_http_route_index_t)
+                            + route->items * sizeof(nxt_http_route_filter_t));
+    if (nxt_slow_path(index == NULL)) {
+        return NXT_ERROR;
+    }
+
+    for (i = 0; i < route->items; i++) {
+        match = route->match[i];
+        filter = &index->filter[i];
+
+        host = nxt_http_route_index_rule(match, NXT_HTTP_ROUTE_STRING,
+                                         offsetof(nxt_http_request_t, host));
+        uri = nxt_http_route_index_rule(match, NXT_HTTP_ROUTE_STRING_PTR,
+                                        offsetof(nxt_http_request_t, path));
+        method = nxt_http_route_index_rule(match, NXT_HTTP_ROUTE_STRING_PTR,
+                                        offsetof(nxt_http_request_t, method));
+
+        filter->methods = NXT_HTTP_ROUTE_METHOD_ANY;
+
+        if (method != NULL && nxt_http_route_index_patterns(method, 1)) {
+            filter->methods = 0;
+
+            for (j = 0; j < method->items; j++) {
+                slices = method->pattern[j].u.pattern_slices;
+                slice = slices->elts;
+
+                prefix.start = slice->start;
+                prefix.length = slice->length;
+
+                filter->methods |= nxt_http_route_method(&prefix);
+            }
+        }
+
+        if (uri != NULL && !nxt_http_route_index_patterns(uri, 0)) {
+            uri = NULL;
+        }
+
+        if (host != NULL && nxt_http_route_index_patterns(host, 1)) {
+
+            for (j = 0; j < host->items; j++) {
+                slices = host->pattern[j].u.pattern_slices;
+                slice = slices->elts;
+
+                prefix.start = slice->start;
+                prefix.length = slice->length;
+
+                ret = nxt_http_route_index_host(mp, index, &prefix, i);
+                if (nxt_slow_path(ret != NXT_OK)) {
+                    return NXT_ERROR;
+                }
+            }
+
+            if (uri == NULL) {
+                continue;
+            }
+
+            filter->prefixes = uri->items;
+            filter->prefix = nxt_mp_get(mp, uri->items * sizeof(nxt_str_t));
+            if (nxt_slow_path(filter->prefix == NULL)) {
+                return NXT_ERROR;
+            }
+
+            for (j = 0; j < uri->items; j++) {
+                slices = uri->pattern[j].u.pattern_slices;
+                slice = slices->elts;
+
+                filter->prefix[j].start = slice->start;
+                filter->prefix[j].length = slice->length;
+            }
+
+            continue;
+        }
+
+        if (uri == NULL) {
+            ret = nxt_http_route_index_step(mp, &index->uri.steps, i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+
+            continue;
+        }
+
+        for (j = 0; j < uri->items; j++) {
+            pattern = &uri->pattern[j];
+            slice = pattern->u.pattern_slices->elts;
+
+            prefix.start = slice->start;
+            prefix.length = slice->length;
+
+            node = nxt_http_route_index_node(mp, &index->uri, &prefix);
+            if (nxt_slow_path(node == NULL)) {
+                return NXT_ERROR;
+            }
+
+            ret = nxt_http_route_index_step(mp, &node->steps, i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+        }
+    }
+
+    route->index = index;
+
+    return NXT_OK;
+}
+
+
+static nxt_http_route_rule_t *
+nxt_http_route_index_rule(nxt_http_route_match_t *match,
+    nxt_http_route_object_t object, size_t offset)
+{
+    uint32_t               i;
+    nxt_http_route_rule_t  *rule;
+
+    for (i = 0; i < match->items; i++) {
+        rule = match->test[i].rule;
+
+        if (rule->object == object && rule->u.offset == offset) {
+            return rule;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Tests if a rule has only positive exact or, unless "exact" is set,
+ * prefix patterns, so it can only match a string that starts with the
+ * first slice of one of them.
+ */
+
+static nxt_bool_t
+nxt_http_route_index_patterns(nxt_http_route_rule_t *rule, nxt_bool_t exact)
+{
+    uint32_t                        i;
+    nxt_http_route_pattern_t        *pattern;
+    nxt_http_route_pattern_slice_t  *slice;
+
+    /* An empty array of patterns matches anything. */
+
+    if (rule->items == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < rule->items; i++) {
+        pattern = &rule->pattern[i];
+
+#if (NXT_HAVE_REGEX)
+        if (pattern->regex) {
+            return 0;
+        }
+#endif
+
+        if (pattern->negative || !pattern->case_sensitive) {
+            return 0;
+        }
+
+        slice = pattern->u.pattern_slices->elts;
+
+        if (slice->length == 0) {
+            return 0;
+        }
+
+        if (slice->type != NXT_HTTP_ROUTE_PATTERN_EXACT
+            && (exact || slice->type != NXT_HTTP_ROUTE_PATTERN_BEGIN))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+static nxt_int_t
+nxt_http_route_index_host(nxt_mp_t *mp, nxt_http_route_index_t *index,
+    nxt_str_t *host, uint32_t step)
+{
+    nxt_int_t              ret;
+    nxt_lvlhsh_query_t     lhq;
+    nxt_http_route_host_t  *entry;
+
+    lhq.key_hash = nxt_djb_hash(host->start, host->length);
+    lhq.key = *host;
+    lhq.proto = &nxt_http_route_hosts_proto;
+    lhq.pool = mp;
+
+    if (nxt_lvlhsh_find(&index->hosts, &lhq) == NXT_OK) {
+        entry = lhq.value;
+
+    } else {
+        entry = nxt_mp_zget(mp, sizeof(nxt_http_route_host_t));
+        if (nxt_slow_path(entry == NULL)) {
+            return NXT_ERROR;
+        }
+
+        entry->host = *host;
+
+        lhq.replace = 0;
+        lhq.value = entry;
+
+        ret = nxt_lvlhsh_insert(&index->hosts, &lhq);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return nxt_http_route_index_step(mp, &entry->steps, step);
+}
+
+
+static nxt_http_route_node_t *
+nxt_http_route_index_node(nxt_mp_t *mp, nxt_http_route_node_t *node,
+    nxt_str_t *prefix)
+{
+    u_char                  *p, *end;
+    nxt_uint_t              i, n;
+    nxt_http_route_node_t   *next;
+    nxt_http_route_child_t  *child;
+
+    end = prefix->start + prefix->length;
+
+    for (p = prefix->start; p < end; p++) {
+        next = nxt_http_route_node_child(node, *p);
+
+        if (next != NULL) {
+            node = next;
+            continue;
+        }
+
+        if (node->children == NULL) {
+            node->children = nxt_array_create(mp, 1,
+                                              sizeof(nxt_http_route_child_t));
+            if (nxt_slow_path(node->children == NULL)) {
+                return NULL;
+            }
+        }
+
+        next = nxt_mp_zget(mp, sizeof(nxt_http_route_node_t));
+        if (nxt_slow_path(next == NULL)) {
+            return NULL;
+        }
+
+        child = nxt_array_add(node->children);
+        if (nxt_slow_path(child == NULL)) {
+            return NULL;
+        }
+
+        /* The children are kept sorted for the binary search. */
+
+        child = node->children->elts;
+        n = node->children->nelts - 1;
+
+        for (i = n; i > 0 && child[i - 1].byte > *p; i--) {
+            child[i] = child[i - 1];
+        }
+
+        child[i].byte = *p;
+        child[i].node = next;
+
+        node = next;
+    }
+
+    return node;
+}
+
+
+static nxt_int_t
+nxt_http_route_index_step(nxt_mp_t *mp, nxt_array_t **steps, uint32_t step)
+{
+    uint32_t  *p;
+
+    if (*steps == NULL) {
+        *steps = nxt_array_create(mp, 4, sizeof(uint32_t));
+        if (nxt_slow_path(*steps == NULL)) {
+            return NXT_ERROR;
+        }
+
+    } else {
+        /* The same step with several equal patterns. */
+
+        p = (*steps)->elts;
+
+        if (p[(*steps)->nelts - 1] == step) {
+            return NXT_OK;
+        }
+    }
+
+    p = nxt_array_add(*steps);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    *p = step;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_route_host_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_route_host_t  *entry;
+
+    entry = data;
+
+    if (nxt_strstr_eq(&lhq->key, &entry->host)) {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+static void *
+nxt_http_route_host_alloc(void *data, size_t size)
+{
+    return nxt_mp_align(data, size, size);
+}
+
+
+static void
+nxt_http_route_host_free(void *data, void *p)
+{
+    nxt_mp_free(data, p);
+}
+
+
 static nxt_conf_map_t  nxt_http_route_match_conf[] = {
     {
         nxt_string("scheme"),
@@ -380,6 +898,7 @@ nxt_http_route_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     }
 
     route->items = n;
+    route->index = NULL;
     m = &route->match[0];
 
     for (i = 0; i < n; i++) {
@@ -675,6 +1194,16 @@ static nxt_conf_map_t  nxt_http_route_action_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_http_action_conf_t, fallback)
     },
+    {
+        nxt_string("cache"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, cache)
+    },
+    {
+        nxt_string("limit"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, limit)
+    },
 };
 
 
@@ -715,6 +1244,20 @@ nxt_http_action_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         }
     }
 
+    if (acf.cache != NULL) {
+        ret = nxt_http_cache_init(task, tmcf, action, &acf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
+    if (acf.limit != NULL) {
+        ret = nxt_http_limit_init(task, tmcf, action, &acf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
     if (acf.ret != NULL) {
         return nxt_http_return_init(rtcf, action, &acf);
     }
@@ -1581,16 +2124,67 @@ nxt_http_pass_application(nxt_task_t *task, nxt_router_conf_t *rtcf,
 }
 
 
-static nxt_http_action_t *
+nxt_http_action_t *
 nxt_http_route_handler(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *start)
 {
-    size_t                  i;
-    nxt_http_route_t        *route;
-    nxt_http_action_t       *action;
+    uint32_t           step;
+    nxt_http_route_t   *route;
+    nxt_http_action_t  *action;
 
     route = start->u.route;
 
+    action = nxt_http_route_lookup(task, r, route, &step);
+
+    if (action == NULL) {
+        nxt_http_request_error(task, r, NXT_HTTP_NOT_FOUND);
+        return NULL;
+    }
+
+    if (action != NXT_HTTP_ACTION_ERROR) {
+        r->action = action;
+
+        nxt_router_metric_release(r->route_metric);
+
+        r->route_metric = nxt_router_metric(task->thread->engine,
+                                            NXT_STATUS_METRIC_ROUTE,
+                                            &route->match[step]->name);
+    }
+
+    return action;
+}
+
+
+nxt_http_action_t *
+nxt_http_routes_match(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_routes_t *routes, nxt_uint_t n, uint32_t *step)
+{
+    if (n >= routes->items) {
+        return NULL;
+    }
+
+    return nxt_http_route_lookup(task, r, routes->route[n], step);
+}
+
+
+static nxt_http_action_t *
+nxt_http_route_lookup(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_route_t *route, uint32_t *step)
+{
+    uint32_t           i;
+    nxt_int_t          ret;
+    nxt_http_action_t  *action;
+
+    /* The linear search is used to log every tested step. */
+
+    if (route->index != NULL && nxt_fast_path(!r->log_route)) {
+        ret = nxt_http_route_index_find(task, r, route, &action, step);
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            return action;
+        }
+    }
+
     for (i = 0; i < route->items; i++) {
         action = nxt_http_route_match(task, r, route->match[i]);
 
@@ -1599,23 +2193,206 @@ nxt_http_route_handler(nxt_task_t *task, nxt_http_request_t *r,
             const char  *sel = (action == NULL) ? "discarded" : "selected";
 
             if (route->name.length == 0) {
-                nxt_log(task, lvl, "\"routes/%z\" %s", i, sel);
+                nxt_log(task, lvl, "\"routes/%uD\" %s", i, sel);
             } else {
-                nxt_log(task, lvl, "\"routes/%V/%z\" %s", &route->name, i, sel);
+                nxt_log(task, lvl, "\"routes/%V/%uD\" %s", &route->name, i,
+                        sel);
             }
         }
 
         if (action != NULL) {
+            *step = i;
+            return action;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Merges the ascending step lists of the request host and of the trie
+ * nodes along the request path, and tests the candidate steps in order.
+ * NXT_DECLINED is returned if the path passes too many nodes with steps.
+ */
+
+static nxt_int_t
+nxt_http_route_index_find(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_route_t *route, nxt_http_action_t **action, uint32_t *step)
+{
+    u_char                   *p, *end;
+    uint32_t                 min, methods, *steps;
+    nxt_uint_t               i, n;
+    nxt_array_t              *lists[NXT_HTTP_ROUTE_INDEX_LISTS];
+    nxt_lvlhsh_query_t       lhq;
+    nxt_http_action_t        *act;
+    nxt_http_route_node_t    *node;
+    nxt_http_route_host_t    *entry;
+    nxt_http_route_index_t   *index;
+    nxt_http_route_filter_t  *filter;
+    uint32_t                 pos[NXT_HTTP_ROUTE_INDEX_LISTS];
+
+    index = route->index;
+    n = 0;
+
+    if (r->host.length != 0) {
+        lhq.key_hash = nxt_djb_hash(r->host.start, r->host.length);
+        lhq.key = r->host;
+        lhq.proto = &nxt_http_route_hosts_proto;
+
+        if (nxt_lvlhsh_find(&index->hosts, &lhq) == NXT_OK) {
+            entry = lhq.value;
+            lists[n++] = entry->steps;
+        }
+    }
+
+    node = &index->uri;
+
+    if (node->steps != NULL) {
+        lists[n++] = node->steps;
+    }
 
-            if (action != NXT_HTTP_ACTION_ERROR) {
-                r->action = action;
+    if (r->path != NULL) {
+        p = r->path->start;
+        end = p + r->path->length;
+
+        while (p < end) {
+            node = nxt_http_route_node_child(node, *p++);
+            if (node == NULL) {
+                break;
             }
 
-            return action;
+            if (node->steps != NULL) {
+                if (nxt_slow_path(n == NXT_HTTP_ROUTE_INDEX_LISTS)) {
+                    return NXT_DECLINED;
+                }
+
+                lists[n++] = node->steps;
+            }
+        }
+    }
+
+    methods = (r->method != NULL) ? nxt_http_route_method(r->method)
+                                  : NXT_HTTP_ROUTE_METHOD_NONE;
+
+    nxt_memzero(pos, n * sizeof(uint32_t));
+
+    for ( ;; ) {
+        min = route->items;
+
+        for (i = 0; i < n; i++) {
+            if (pos[i] < lists[i]->nelts) {
+                steps = lists[i]->elts;
+                min = nxt_min(min, steps[pos[i]]);
+            }
+        }
+
+        if (min == route->items) {
+            break;
+        }
+
+        /* A step may be found in several lists. */
+
+        for (i = 0; i < n; i++) {
+            steps = lists[i]->elts;
+
+            if (pos[i] < lists[i]->nelts && steps[pos[i]] == min) {
+                pos[i]++;
+            }
+        }
+
+        filter = &index->filter[min];
+
+        if ((filter->methods & methods) == 0) {
+            continue;
+        }
+
+        if (filter->prefixes != 0 && !nxt_http_route_prefix(filter, r->path)) {
+            continue;
+        }
+
+        act = nxt_http_route_match(task, r, route->match[min]);
+
+        if (act != NULL) {
+            *action = act;
+            *step = min;
+            return NXT_OK;
+        }
+    }
+
+    *action = NULL;
+
+    return NXT_OK;
+}
+
+
+static uint32_t
+nxt_http_route_method(nxt_str_t *method)
+{
+    nxt_uint_t  i;
+
+    for (i = 0; i < nxt_nitems(nxt_http_route_methods); i++) {
+        if (nxt_strstr_eq(method, &nxt_http_route_methods[i])) {
+            return 1 << i;
+        }
+    }
+
+    return NXT_HTTP_ROUTE_METHOD_OTHER;
+}
+
+
+static nxt_bool_t
+nxt_http_route_prefix(nxt_http_route_filter_t *filter, nxt_str_t *path)
+{
+    nxt_str_t   *prefix;
+    nxt_uint_t  i;
+
+    if (path == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < filter->prefixes; i++) {
+        prefix = &filter->prefix[i];
+
+        if (path->length >= prefix->length
+            && memcmp(path->start, prefix->start, prefix->length) == 0)
+        {
+            return 1;
         }
     }
 
-    nxt_http_request_error(task, r, NXT_HTTP_NOT_FOUND);
+    return 0;
+}
+
+
+static nxt_http_route_node_t *
+nxt_http_route_node_child(nxt_http_route_node_t *node, u_char byte)
+{
+    nxt_uint_t              lo, hi, mid;
+    nxt_http_route_child_t  *child;
+
+    if (node->children == NULL) {
+        return NULL;
+    }
+
+    child = node->children->elts;
+    lo = 0;
+    hi = node->children->nelts;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+
+        if (child[mid].byte == byte) {
+            return child[mid].node;
+        }
+
+        if (child[mid].byte < byte) {
+            lo = mid + 1;
+
+        } else {
+            hi = mid;
+        }
+    }
 
     return NULL;
 }
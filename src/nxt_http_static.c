@@ -40,6 +40,40 @@ typedef struct {
 } nxt_http_static_ctx_t;
 
 
+typedef struct {
+    nxt_str_t                   key;
+    nxt_queue_link_t            link;
+
+    nxt_msec_t                  expires;
+    uint32_t                    uses;
+
+    nxt_fd_t                    fd;
+    nxt_err_t                   error;
+    nxt_file_info_t             fi;
+
+    nxt_str_t                   *mtype;
+    uint8_t                     etag_length;
+    uint8_t                     cached;     /* 1 bit */
+
+    u_char                      last_modified[NXT_HTTP_DATE_LEN];
+    u_char                      etag[NXT_TIME_T_HEXLEN + NXT_OFF_T_HEXLEN + 3];
+} nxt_http_static_cache_entry_t;
+
+
+/*
+ * The open file cache belongs to a listener joint, so it is used only
+ * by the joint engine and does not need locking.  Cached descriptors
+ * are dup()ed for requests, so entries can be evicted at any time.
+ */
+
+struct nxt_http_static_cache_s {
+    nxt_mp_t                    *mem_pool;
+    nxt_lvlhsh_t                hash;
+    nxt_queue_t                 lru;
+    uint32_t                    entries;
+};
+
+
 #define NXT_HTTP_STATIC_BUF_COUNT  2
 #define NXT_HTTP_STATIC_BUF_SIZE   (128 * 1024)
 
@@ -50,6 +84,20 @@ static void nxt_http_static_iterate(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_static_ctx_t *ctx);
 static void nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_static_ctx_t *ctx);
+static nxt_int_t nxt_http_static_open(nxt_task_t *task,
+    nxt_http_static_ctx_t *ctx, nxt_file_t *file, u_char **fname);
+static nxt_http_static_cache_entry_t *nxt_http_static_cache_lookup(
+    nxt_task_t *task, nxt_http_request_t *r, nxt_http_static_ctx_t *ctx,
+    u_char *fname);
+static nxt_int_t nxt_http_static_cache_open(nxt_http_static_cache_entry_t *entry,
+    nxt_file_t *file);
+static void nxt_http_static_cache_store(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_static_cache_entry_t *entry, nxt_file_t *file,
+    nxt_file_info_t *fi, nxt_str_t *mtype);
+static void nxt_http_static_cache_entry_free(nxt_task_t *task,
+    nxt_http_static_cache_t *cache, nxt_http_static_cache_entry_t *entry);
+static nxt_int_t nxt_http_static_cache_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
 static void nxt_http_static_next(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_static_ctx_t *ctx, nxt_http_status_t status);
 #if (NXT_HAVE_OPENAT2)
@@ -57,10 +105,10 @@ static u_char *nxt_http_static_chroot_match(u_char *chr, u_char *shr);
 #endif
 static void nxt_http_static_extract_extension(nxt_str_t *path,
     nxt_str_t *exten);
-static void nxt_http_static_body_handler(nxt_task_t *task, void *obj,
-    void *data);
 static void nxt_http_static_buf_completion(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_http_static_sendfile_completion(nxt_task_t *task, void *obj,
+    void *data);
 
 static nxt_int_t nxt_http_static_mtypes_hash_test(nxt_lvlhsh_query_t *lhq,
     void *data);
@@ -71,6 +119,16 @@ static void nxt_http_static_mtypes_hash_free(void *data, void *p);
 static const nxt_http_request_state_t  nxt_http_static_send_state;
 
 
+static const nxt_lvlhsh_proto_t  nxt_http_static_cache_proto
+    nxt_aligned(64) =
+{
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_static_cache_test,
+    nxt_http_static_mtypes_hash_alloc,
+    nxt_http_static_mtypes_hash_free,
+};
+
+
 nxt_int_t
 nxt_http_static_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_http_action_t *action, nxt_http_action_conf_t *acf)
@@ -327,6 +385,8 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t      body_handler;
     nxt_http_static_conf_t  *conf;
 
+    nxt_http_static_cache_entry_t  *entry;
+
     action = ctx->action;
     conf = action->u.conf;
     rtcf = r->conf->socket_conf->router_conf;
@@ -379,67 +439,15 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
 
     file.name = fname;
 
-#if (NXT_HAVE_OPENAT2)
-    if (conf->resolve != 0 || ctx->chroot.length > 0) {
-        nxt_str_t                *chr;
-        nxt_uint_t               resolve;
-        nxt_http_static_share_t  *share;
-
-        share = &conf->shares[ctx->share_idx];
-
-        resolve = conf->resolve;
-        chr = &ctx->chroot;
-
-        if (chr->length > 0) {
-            resolve |= RESOLVE_IN_ROOT;
-
-            fname = share->is_const
-                    ? share->fname
-                    : nxt_http_static_chroot_match(chr->start, file.name);
-
-            if (fname != NULL) {
-                file.name = chr->start;
-                ret = nxt_file_open(task, &file, NXT_FILE_SEARCH, NXT_FILE_OPEN,
-                                    0);
-
-            } else {
-                file.error = NXT_EACCES;
-                ret = NXT_ERROR;
-            }
-
-        } else if (fname[0] == '/') {
-            file.name = (u_char *) "/";
-            ret = nxt_file_open(task, &file, NXT_FILE_SEARCH, NXT_FILE_OPEN, 0);
-
-        } else {
-            file.name = (u_char *) ".";
-            file.fd = AT_FDCWD;
-            ret = NXT_OK;
-        }
-
-        if (nxt_fast_path(ret == NXT_OK)) {
-            nxt_file_t  af;
-
-            af = file;
-            nxt_memzero(&file, sizeof(nxt_file_t));
-            file.name = fname;
-
-            ret = nxt_file_openat2(task, &file, NXT_FILE_RDONLY,
-                                   NXT_FILE_OPEN, 0, af.fd, resolve);
+    entry = nxt_http_static_cache_lookup(task, r, ctx, fname);
 
-            if (af.fd != AT_FDCWD) {
-                nxt_file_close(task, &af);
-            }
-        }
+    if (entry != NULL && entry->cached) {
+        ret = nxt_http_static_cache_open(entry, &file);
 
     } else {
-        ret = nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+        ret = nxt_http_static_open(task, ctx, &file, &fname);
     }
 
-#else
-    ret = nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
-#endif
-
     if (nxt_slow_path(ret != NXT_OK)) {
 
         switch (file.error) {
@@ -496,6 +504,10 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
         }
 
         if (level == NXT_LOG_ERR) {
+            if (entry != NULL && status == NXT_HTTP_NOT_FOUND) {
+                nxt_http_static_cache_store(task, r, entry, &file, NULL, NULL);
+            }
+
             nxt_http_static_next(task, r, ctx, status);
             return;
         }
@@ -511,9 +523,14 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
 
     *f = file;
 
-    ret = nxt_file_info(f, &fi);
-    if (nxt_slow_path(ret != NXT_OK)) {
-        goto fail;
+    if (entry != NULL && entry->cached) {
+        fi = entry->fi;
+
+    } else {
+        ret = nxt_file_info(f, &fi);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            goto fail;
+        }
     }
 
     if (nxt_fast_path(nxt_is_file(&fi))) {
@@ -532,10 +549,16 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
             goto fail;
         }
 
-        nxt_localtime(nxt_file_mtime(&fi), &tm);
-
         field->value = p;
-        field->value_length = nxt_http_date(p, &tm) - p;
+
+        if (entry != NULL && entry->cached) {
+            field->value_length = NXT_HTTP_DATE_LEN;
+            nxt_memcpy(p, entry->last_modified, NXT_HTTP_DATE_LEN);
+
+        } else {
+            nxt_localtime(nxt_file_mtime(&fi), &tm);
+            field->value_length = nxt_http_date(p, &tm) - p;
+        }
 
         field = nxt_list_zero_add(r->resp.fields);
         if (nxt_slow_path(field == NULL)) {
@@ -552,10 +575,21 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
         }
 
         field->value = p;
-        field->value_length = nxt_sprintf(p, p + length, "\"%xT-%xO\"",
-                                          nxt_file_mtime(&fi),
-                                          nxt_file_size(&fi))
-                              - p;
+
+        if (entry != NULL && entry->cached) {
+            field->value_length = entry->etag_length;
+            nxt_memcpy(p, entry->etag, entry->etag_length);
+
+            if (mtype == NULL) {
+                mtype = entry->mtype;
+            }
+
+        } else {
+            field->value_length = nxt_sprintf(p, p + length, "\"%xT-%xO\"",
+                                              nxt_file_mtime(&fi),
+                                              nxt_file_size(&fi))
+                                  - p;
+        }
 
         if (exten.start == NULL) {
             nxt_http_static_extract_extension(shr, &exten);
@@ -565,6 +599,10 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
             mtype = nxt_http_static_mtype_get(&rtcf->mtypes_hash, &exten);
         }
 
+        if (entry != NULL && !entry->cached) {
+            nxt_http_static_cache_store(task, r, entry, f, &fi, mtype);
+        }
+
         if (mtype->length != 0) {
             field = nxt_list_zero_add(r->resp.fields);
             if (nxt_slow_path(field == NULL)) {
@@ -592,23 +630,39 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
                 size_t     out_total;
                 nxt_int_t  ret;
 
-                ret = nxt_http_comp_compress_static_response(
+                ret = NXT_DECLINED;
+
+#if (NXT_HAVE_OPENAT2)
+                /* Sidecars are not looked up with "chroot" restrictions. */
+                if (conf->resolve == 0 && ctx->chroot.length == 0)
+#endif
+                {
+                    ret = nxt_http_comp_static_precompressed(task, fname,
+                                                             &f, &fi);
+                }
+
+                if (ret == NXT_OK) {
+                    r->resp.content_length_n = nxt_file_size(&fi);
+
+                } else {
+                    ret = nxt_http_comp_compress_static_response(
                                                     task, &f, &fi,
                                                     NXT_HTTP_STATIC_BUF_SIZE,
                                                     &out_total);
-                if (ret == NXT_ERROR) {
-                    goto fail;
-                }
+                    if (ret == NXT_ERROR) {
+                        goto fail;
+                    }
 
-                ret = nxt_file_info(f, &fi);
-                if (nxt_slow_path(ret != NXT_OK)) {
-                    goto fail;
-                }
+                    ret = nxt_file_info(f, &fi);
+                    if (nxt_slow_path(ret != NXT_OK)) {
+                        goto fail;
+                    }
 
-                r->resp.content_length_n = out_total;
+                    r->resp.content_length_n = out_total;
+                }
             }
 
-            fb = nxt_mp_zget(r->mem_pool, NXT_BUF_FILE_SIZE);
+            fb = nxt_buf_file_alloc(r->mem_pool, 0, 0);
             if (nxt_slow_path(fb == NULL)) {
                 goto fail;
             }
@@ -618,7 +672,12 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
 
             r->out = fb;
 
-            body_handler = &nxt_http_static_body_handler;
+            if (nxt_http_request_sendfile(task, r)) {
+                body_handler = &nxt_http_static_sendfile_handler;
+
+            } else {
+                body_handler = &nxt_http_static_body_handler;
+            }
 
         } else {
             nxt_file_close(task, f);
@@ -698,6 +757,338 @@ nxt_http_static_send(nxt_task_t *task, nxt_http_request_t *r,
 }
 
 
+static nxt_int_t
+nxt_http_static_open(nxt_task_t *task, nxt_http_static_ctx_t *ctx,
+    nxt_file_t *file, u_char **fname)
+{
+    nxt_int_t  ret;
+
+#if (NXT_HAVE_OPENAT2)
+    nxt_http_static_conf_t  *conf;
+
+    conf = ctx->action->u.conf;
+
+    if (conf->resolve != 0 || ctx->chroot.length > 0) {
+        nxt_str_t                *chr;
+        nxt_uint_t               resolve;
+        nxt_http_static_share_t  *share;
+
+        share = &conf->shares[ctx->share_idx];
+
+        resolve = conf->resolve;
+        chr = &ctx->chroot;
+
+        if (chr->length > 0) {
+            resolve |= RESOLVE_IN_ROOT;
+
+            *fname = share->is_const
+                    ? share->fname
+                    : nxt_http_static_chroot_match(chr->start, file->name);
+
+            if (*fname != NULL) {
+                file->name = chr->start;
+                ret = nxt_file_open(task, file, NXT_FILE_SEARCH, NXT_FILE_OPEN,
+                                    0);
+
+            } else {
+                file->error = NXT_EACCES;
+                ret = NXT_ERROR;
+            }
+
+        } else if ((*fname)[0] == '/') {
+            file->name = (u_char *) "/";
+            ret = nxt_file_open(task, file, NXT_FILE_SEARCH, NXT_FILE_OPEN, 0);
+
+        } else {
+            file->name = (u_char *) ".";
+            file->fd = AT_FDCWD;
+            ret = NXT_OK;
+        }
+
+        if (nxt_fast_path(ret == NXT_OK)) {
+            nxt_file_t  af;
+
+            af = *file;
+            nxt_memzero(file, sizeof(nxt_file_t));
+            file->name = *fname;
+
+            ret = nxt_file_openat2(task, file, NXT_FILE_RDONLY,
+                                   NXT_FILE_OPEN, 0, af.fd, resolve);
+
+            if (af.fd != AT_FDCWD) {
+                nxt_file_close(task, &af);
+            }
+        }
+
+    } else {
+        ret = nxt_file_open(task, file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+    }
+
+#else
+    ret = nxt_file_open(task, file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0);
+#endif
+
+    return ret;
+}
+
+
+static nxt_http_static_cache_entry_t *
+nxt_http_static_cache_lookup(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_static_ctx_t *ctx, u_char *fname)
+{
+    u_char                             *p;
+    size_t                             length;
+    nxt_msec_t                         now;
+    nxt_queue_link_t                   *lnk;
+    nxt_lvlhsh_query_t                 lhq;
+    nxt_router_conf_t                  *rtcf;
+    nxt_http_static_cache_t            *cache;
+    nxt_socket_conf_joint_t            *joint;
+    nxt_http_static_cache_conf_t       *ofc;
+    nxt_http_static_cache_entry_t      *entry;
+
+    joint = r->conf;
+    rtcf = joint->socket_conf->router_conf;
+    ofc = &rtcf->open_file_cache;
+
+    if (ofc->max_entries == 0) {
+        return NULL;
+    }
+
+    cache = joint->static_cache;
+
+    if (cache == NULL) {
+        cache = nxt_zalloc(sizeof(nxt_http_static_cache_t));
+        if (nxt_slow_path(cache == NULL)) {
+            return NULL;
+        }
+
+        cache->mem_pool = nxt_mp_create(1024, 128, 256, 32);
+        if (nxt_slow_path(cache->mem_pool == NULL)) {
+            nxt_free(cache);
+            return NULL;
+        }
+
+        nxt_queue_init(&cache->lru);
+
+        joint->static_cache = cache;
+    }
+
+    /*
+     * The key includes the "chroot" and the resolve flags, so the same
+     * file name opened under different restrictions has separate entries.
+     */
+
+    length = 1 + ctx->chroot.length + 1 + nxt_strlen(fname);
+
+    p = nxt_mp_nget(r->mem_pool, length);
+    if (nxt_slow_path(p == NULL)) {
+        return NULL;
+    }
+
+    lhq.key.start = p;
+    lhq.key.length = length;
+
+#if (NXT_HAVE_OPENAT2)
+    *p++ = ((nxt_http_static_conf_t *) ctx->action->u.conf)->resolve;
+#else
+    *p++ = 0;
+#endif
+    p = nxt_cpymem(p, ctx->chroot.start, ctx->chroot.length);
+    *p++ = '\0';
+    nxt_memcpy(p, fname, nxt_strlen(fname));
+
+    lhq.key_hash = nxt_djb_hash(lhq.key.start, lhq.key.length);
+    lhq.proto = &nxt_http_static_cache_proto;
+    lhq.pool = cache->mem_pool;
+
+    now = task->thread->engine->timers.now;
+
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) == NXT_OK) {
+        entry = lhq.value;
+
+        nxt_queue_remove(&entry->link);
+        nxt_queue_insert_head(&cache->lru, &entry->link);
+
+        if (nxt_msec_diff(now, entry->expires) >= 0) {
+            if (entry->fd != NXT_FILE_INVALID) {
+                nxt_fd_close(entry->fd);
+                entry->fd = NXT_FILE_INVALID;
+            }
+
+            entry->cached = 0;
+            entry->uses = 0;
+            entry->expires = now + ofc->valid;
+        }
+
+        entry->uses++;
+
+        return entry;
+    }
+
+    if (cache->entries >= ofc->max_entries) {
+        lnk = nxt_queue_last(&cache->lru);
+        entry = nxt_queue_link_data(lnk, nxt_http_static_cache_entry_t, link);
+
+        nxt_http_static_cache_entry_free(task, cache, entry);
+    }
+
+    entry = nxt_mp_zalloc(cache->mem_pool,
+                          sizeof(nxt_http_static_cache_entry_t) + length);
+    if (nxt_slow_path(entry == NULL)) {
+        return NULL;
+    }
+
+    entry->key.start = nxt_pointer_to(entry,
+                                      sizeof(nxt_http_static_cache_entry_t));
+    entry->key.length = length;
+    nxt_memcpy(entry->key.start, lhq.key.start, length);
+
+    entry->fd = NXT_FILE_INVALID;
+    entry->expires = now + ofc->valid;
+    entry->uses = 1;
+
+    lhq.key = entry->key;
+    lhq.replace = 0;
+    lhq.value = entry;
+
+    if (nxt_slow_path(nxt_lvlhsh_insert(&cache->hash, &lhq) != NXT_OK)) {
+        nxt_mp_free(cache->mem_pool, entry);
+        return NULL;
+    }
+
+    nxt_queue_insert_head(&cache->lru, &entry->link);
+    cache->entries++;
+
+    return entry;
+}
+
+
+static nxt_int_t
+nxt_http_static_cache_open(nxt_http_static_cache_entry_t *entry,
+    nxt_file_t *file)
+{
+    if (entry->fd == NXT_FILE_INVALID) {
+        file->error = entry->error;
+        return NXT_ERROR;
+    }
+
+    file->fd = dup(entry->fd);
+
+    if (nxt_slow_path(file->fd == -1)) {
+        file->error = nxt_errno;
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_http_static_cache_store(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_static_cache_entry_t *entry, nxt_file_t *file,
+    nxt_file_info_t *fi, nxt_str_t *mtype)
+{
+    u_char                        *p;
+    struct tm                     tm;
+    nxt_router_conf_t             *rtcf;
+    nxt_http_static_cache_conf_t  *ofc;
+
+    rtcf = r->conf->socket_conf->router_conf;
+    ofc = &rtcf->open_file_cache;
+
+    if (entry->uses < ofc->min_uses) {
+        return;
+    }
+
+    if (fi == NULL) {
+        if (ofc->errors) {
+            entry->error = file->error;
+            entry->cached = 1;
+        }
+
+        return;
+    }
+
+    entry->fd = dup(file->fd);
+
+    if (nxt_slow_path(entry->fd == -1)) {
+        nxt_alert(task, "dup(%FD) failed %E", file->fd, nxt_errno);
+        entry->fd = NXT_FILE_INVALID;
+        return;
+    }
+
+    entry->fi = *fi;
+    entry->mtype = mtype;
+
+    nxt_localtime(nxt_file_mtime(fi), &tm);
+    (void) nxt_http_date(entry->last_modified, &tm);
+
+    p = nxt_sprintf(entry->etag, entry->etag + sizeof(entry->etag),
+                    "\"%xT-%xO\"", nxt_file_mtime(fi), nxt_file_size(fi));
+    entry->etag_length = p - entry->etag;
+
+    entry->cached = 1;
+}
+
+
+static void
+nxt_http_static_cache_entry_free(nxt_task_t *task,
+    nxt_http_static_cache_t *cache, nxt_http_static_cache_entry_t *entry)
+{
+    nxt_lvlhsh_query_t  lhq;
+
+    lhq.key = entry->key;
+    lhq.key_hash = nxt_djb_hash(lhq.key.start, lhq.key.length);
+    lhq.proto = &nxt_http_static_cache_proto;
+    lhq.pool = cache->mem_pool;
+
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
+
+    nxt_queue_remove(&entry->link);
+    cache->entries--;
+
+    if (entry->fd != NXT_FILE_INVALID) {
+        nxt_fd_close(entry->fd);
+    }
+
+    nxt_mp_free(cache->mem_pool, entry);
+}
+
+
+static nxt_int_t
+nxt_http_static_cache_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_static_cache_entry_t  *entry;
+
+    entry = data;
+
+    if (nxt_strstr_eq(&lhq->key, &entry->key)) {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+void
+nxt_http_static_cache_release(nxt_task_t *task, nxt_http_static_cache_t *cache)
+{
+    nxt_http_static_cache_entry_t  *entry;
+
+    nxt_queue_each(entry, &cache->lru, nxt_http_static_cache_entry_t, link) {
+
+        if (entry->fd != NXT_FILE_INVALID) {
+            nxt_fd_close(entry->fd);
+        }
+
+    } nxt_queue_loop;
+
+    nxt_mp_destroy(cache->mem_pool);
+    nxt_free(cache);
+}
+
+
 static void
 nxt_http_static_next(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_static_ctx_t *ctx, nxt_http_status_t status)
@@ -814,7 +1205,7 @@ nxt_http_static_extract_extension(nxt_str_t *path, nxt_str_t *exten)
 }
 
 
-static void
+void
 nxt_http_static_body_handler(nxt_task_t *task, void *obj, void *data)
 {
     size_t              alloc;
@@ -869,6 +1260,55 @@ nxt_http_static_body_handler(nxt_task_t *task, void *obj, void *data)
 }
 
 
+/*
+ * The file buffer is passed to the connection as is, so its content is
+ * sent with sendfile(2), or with SSL_sendfile() if kernel TLS is active.
+ */
+
+void
+nxt_http_static_sendfile_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *fb;
+    nxt_http_request_t  *r;
+
+    r = obj;
+
+    fb = r->out;
+    r->out = NULL;
+
+    fb->completion_handler = nxt_http_static_sendfile_completion;
+    fb->parent = r;
+
+    nxt_mp_retain(r->mem_pool);
+
+    fb->next = nxt_http_buf_last(r);
+
+    nxt_http_request_send(task, r, fb);
+}
+
+
+static void
+nxt_http_static_sendfile_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b, *next;
+    nxt_http_request_t  *r;
+
+    b = obj;
+    r = data;
+
+    do {
+        next = b->next;
+
+        nxt_file_close(task, b->file);
+
+        nxt_mp_free(r->mem_pool, b);
+        nxt_mp_release(r->mem_pool);
+
+        b = next;
+    } while (b != NULL);
+}
+
+
 static const nxt_http_request_state_t  nxt_http_static_send_state
     nxt_aligned(64) =
 {
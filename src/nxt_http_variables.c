@@ -32,6 +32,8 @@ static nxt_int_t nxt_http_var_request_id(nxt_task_t *task, nxt_str_t *str,
     void *ctx, void *data);
 static nxt_int_t nxt_http_var_status(nxt_task_t *task, nxt_str_t *str,
     void *ctx, void *data);
+static nxt_int_t nxt_http_var_cache_status(nxt_task_t *task, nxt_str_t *str,
+    void *ctx, void *data);
 static nxt_int_t nxt_http_var_body_bytes_sent(nxt_task_t *task, nxt_str_t *str,
     void *ctx, void *data);
 static nxt_int_t nxt_http_var_referer(nxt_task_t *task, nxt_str_t *str,
@@ -99,6 +101,10 @@ static nxt_var_decl_t  nxt_http_vars[] = {
         .name = nxt_string("status"),
         .handler = nxt_http_var_status,
         .cacheable = 1,
+    }, {
+        .name = nxt_string("cache_status"),
+        .handler = nxt_http_var_cache_status,
+        .cacheable = 0,
     }, {
         .name = nxt_string("body_bytes_sent"),
         .handler = nxt_http_var_body_bytes_sent,
@@ -472,6 +478,29 @@ nxt_http_var_status(nxt_task_t *task, nxt_str_t *str, void *ctx, void *data)
 }
 
 
+static nxt_int_t
+nxt_http_var_cache_status(nxt_task_t *task, nxt_str_t *str, void *ctx,
+    void *data)
+{
+    nxt_http_request_t  *r;
+
+    static const nxt_str_t  cache_status[] = {
+        nxt_null_string,
+        nxt_string("BYPASS"),
+        nxt_string("MISS"),
+        nxt_string("EXPIRED"),
+        nxt_string("UPDATING"),
+        nxt_string("HIT"),
+    };
+
+    r = ctx;
+
+    *str = cache_status[r->cache_status];
+
+    return NXT_OK;
+}
+
+
 static nxt_int_t
 nxt_http_var_referer(nxt_task_t *task, nxt_str_t *str, void *ctx, void *data)
 {
@@ -526,6 +555,12 @@ nxt_http_var_response_connection(nxt_task_t *task, nxt_str_t *str, void *ctx,
     };
 
     r = ctx;
+
+    if (r->protocol != NXT_HTTP_PROTO_H1) {
+        nxt_str_null(str);
+        return NXT_OK;
+    }
+
     h1p = r->proto.h1;
 
     conn = -1;
@@ -596,7 +631,7 @@ nxt_http_var_response_transfer_encoding(nxt_task_t *task, nxt_str_t *str,
 
     r = ctx;
 
-    if (r->proto.h1->chunked) {
+    if (r->protocol == NXT_HTTP_PROTO_H1 && r->proto.h1->chunked) {
         nxt_str_set(str, "chunked");
 
     } else {
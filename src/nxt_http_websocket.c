@@ -65,7 +65,8 @@ nxt_http_websocket_client(nxt_task_t *task, void *obj, void *data)
 
         while (copy_size > 0) {
             if (buf == NULL || buf_free_size == 0) {
-                buf_free_size = nxt_min(frame_size, PORT_MMAP_DATA_SIZE);
+                buf_free_size = nxt_min(frame_size, nxt_port_mmap_data_size(
+                                          &req_rpc_data->app->outgoing));
 
                 buf = nxt_port_mmap_get_buf(task, &req_rpc_data->app->outgoing,
                                             buf_free_size);
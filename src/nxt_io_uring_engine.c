@@ -0,0 +1,2556 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <linux/io_uring.h>
+
+
+/*
+ * The io_uring engine keeps the readiness model of the connection layer,
+ * so sockets are still registered in an epoll set in edge-triggered mode,
+ * but the event set maintenance and waiting are moved to io_uring(7):
+ *
+ *   1) epoll changes are batched as IORING_OP_EPOLL_CTL requests and are
+ *      submitted by the same io_uring_enter() that waits for events;
+ *   2) listen sockets use multishot IORING_OP_ACCEPT requests, so a new
+ *      connection costs neither accept() nor the trailing EAGAIN accept();
+ *   3) the epoll descriptor is polled by IORING_OP_POLL_ADD and events
+ *      are harvested by a non-blocking epoll_wait() only if it is ready;
+ *   4) the engine timeout is passed to io_uring_enter() with
+ *      IORING_ENTER_EXT_ARG, so no timerfd or timeout requests are used.
+ *
+ * Connection sockets of the engine connection interface are read and
+ * written by requests as well:
+ *
+ *   5) a connection waiting for data has an IORING_OP_RECV request which
+ *      selects a buffer from the engine provided buffer ring only when
+ *      data arrive, so idle connections hold no buffers; the data are
+ *      copied to the connection buffers by nxt_io_uring_conn_io_recvbuf();
+ *   6) memory buffers are sent by IORING_OP_SENDMSG requests and file
+ *      buffers are spliced by linked IORING_OP_SPLICE requests through
+ *      a connection pipe; the requests of all connections are submitted
+ *      by the next io_uring_enter() and a write completion is processed
+ *      as nxt_conn_io_write() processes a sent size; the requests do not
+ *      wait for a full socket, which is then polled by IORING_OP_POLL_ADD
+ *      under the connection write timer.
+ *
+ * Sockets are not polled by io_uring directly because a pending poll
+ * request holds a file reference and a socket closed without deleting
+ * its event would not be released, while epoll drops closed descriptors
+ * automatically.  Receive and send requests are canceled on the socket
+ * close, which reports them as pending events, so the connection layer
+ * closes the socket and frees the buffers after the next poll.
+ *
+ * IORING_OP_SENDMSG        Linux 5.3.
+ * IORING_OP_EPOLL_CTL      Linux 5.6.
+ * IORING_OP_RECV           Linux 5.6.
+ * IORING_OP_SPLICE         Linux 5.7.
+ * IORING_FEAT_EXT_ARG      Linux 5.11.
+ * IORING_FEAT_CQE_SKIP     Linux 5.17.
+ * IORING_ACCEPT_MULTISHOT  Linux 5.19.
+ * IORING_REGISTER_PBUF_RING, IORING_RECVSEND_POLL_FIRST  Linux 5.19.
+ *
+ * If multishot accept is not supported, listen sockets are added to
+ * the epoll set as in the epoll engine.  If IORING_OP_EPOLL_CTL is not
+ * supported, the epoll changes are committed with epoll_ctl().  If the
+ * receive or send requests are not supported, connection sockets are
+ * read or written directly on their epoll events.
+ */
+
+
+#define NXT_IO_URING_FEATURES                                                 \
+    (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)
+
+/*
+ * A request user data contains a request type, a sequence number of
+ * the file descriptor slot, and the file descriptor.
+ */
+#define NXT_IO_URING_IGNORE    0
+#define NXT_IO_URING_CTL       1
+#define NXT_IO_URING_ACCEPT    2
+#define NXT_IO_URING_EPOLL     3
+#define NXT_IO_URING_RECV      4
+#define NXT_IO_URING_SEND      5
+#define NXT_IO_URING_SPLICE    6
+
+#define NXT_IO_URING_SEQ_MASK  0x1FFFFFFF
+
+#define nxt_io_uring_data(type, seq, fd)                                      \
+    (((uint64_t) (type) << 61) | ((uint64_t) (seq) << 32) | (uint32_t) (fd))
+
+#define nxt_io_uring_data_type(data)  ((data) >> 61)
+#define nxt_io_uring_data_seq(data)                                           \
+    ((uint32_t) ((data) >> 32) & NXT_IO_URING_SEQ_MASK)
+#define nxt_io_uring_data_fd(data)    ((nxt_fd_t) (uint32_t) (data))
+
+/* An operation is supported by the kernel. */
+#define nxt_io_uring_op(probe, op)                                            \
+    ((probe)->ops_len > (op)                                                  \
+     && ((probe)->ops[op].flags & IO_URING_OP_SUPPORTED) != 0)
+
+
+/* An engine internal change operation, epoll operations start from 1. */
+#define NXT_IO_URING_ACCEPT_OP  0
+
+/* The provided buffer ring of receive requests, the number is 2^n. */
+#define NXT_IO_URING_BUFS      64
+#define NXT_IO_URING_BUF_SIZE  16384
+
+/* The maximum size of a file buffer part spliced at once. */
+#define NXT_IO_URING_SPLICE_SIZE  65536
+
+/* Received data, EOF, or an error have not been read yet. */
+#define nxt_io_uring_recv_ready(slot)                                         \
+    ((slot)->recv_data || (slot)->recv_eof || (slot)->recv_error != 0)
+
+
+struct nxt_io_uring_send_s {
+    nxt_conn_t                    *conn;
+    nxt_fd_t                      pipe[2];
+    size_t                        piped;
+    size_t                        sent;
+    nxt_err_t                     error;
+
+    uint8_t                       pending;  /* 2 bits */
+    uint8_t                       splice;   /* 1 bit */
+    uint8_t                       again;    /* 1 bit */
+    uint8_t                       poll;     /* 1 bit */
+
+    struct msghdr                 msg;
+    struct iovec                  iov[NXT_IOBUF_MAX];
+};
+
+
+static nxt_int_t nxt_io_uring_create(nxt_event_engine_t *engine,
+    nxt_uint_t mchanges, nxt_uint_t mevents);
+static void nxt_io_uring_probe(nxt_event_engine_t *engine);
+static void nxt_io_uring_bufs_init(nxt_event_engine_t *engine);
+static void nxt_io_uring_free(nxt_event_engine_t *engine);
+static void nxt_io_uring_enable(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_delete(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static nxt_bool_t nxt_io_uring_close(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_enable_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_enable_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_block_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_block_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_oneshot_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_oneshot_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_enable_accept(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_change(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev, int op, uint32_t events);
+static void nxt_io_uring_commit_changes(nxt_event_engine_t *engine);
+static nxt_io_uring_fd_t *nxt_io_uring_fd(nxt_event_engine_t *engine,
+    nxt_fd_t fd);
+static struct io_uring_sqe *nxt_io_uring_sqe(nxt_event_engine_t *engine);
+static void nxt_io_uring_cancel(nxt_event_engine_t *engine, uint64_t data);
+static int nxt_io_uring_enter(nxt_event_engine_t *engine,
+    uint32_t min_complete, uint32_t flags, struct io_uring_getevents_arg *arg);
+static void nxt_io_uring_error_handler(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_int_t nxt_io_uring_add_signal(nxt_event_engine_t *engine);
+static void nxt_io_uring_signalfd_handler(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_int_t nxt_io_uring_enable_post(nxt_event_engine_t *engine,
+    nxt_work_handler_t handler);
+static void nxt_io_uring_eventfd_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_io_uring_signal(nxt_event_engine_t *engine, nxt_uint_t signo);
+static void nxt_io_uring_poll(nxt_event_engine_t *engine, nxt_msec_t timeout);
+static void nxt_io_uring_completion(nxt_event_engine_t *engine,
+    struct io_uring_cqe *cqe);
+static void nxt_io_uring_accepted(nxt_event_engine_t *engine,
+    struct io_uring_cqe *cqe);
+static void nxt_io_uring_received(nxt_event_engine_t *engine,
+    struct io_uring_cqe *cqe);
+static void nxt_io_uring_sent(nxt_event_engine_t *engine,
+    struct io_uring_cqe *cqe);
+static void nxt_io_uring_epoll_events(nxt_event_engine_t *engine);
+static void nxt_io_uring_accept_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_io_uring_conn_io_accept4(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_io_uring_fd_t *nxt_io_uring_conn(nxt_conn_t *c);
+static nxt_bool_t nxt_io_uring_conn_reset(nxt_event_engine_t *engine,
+    nxt_io_uring_fd_t *slot, nxt_fd_t fd);
+static void nxt_io_uring_recv(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_read_ready(nxt_fd_event_t *ev);
+static void nxt_io_uring_buf_free(nxt_io_uring_engine_t *uring,
+    uint16_t bid);
+static void nxt_io_uring_conn_io_read(nxt_task_t *task, void *obj,
+    void *data);
+static ssize_t nxt_io_uring_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b);
+static ssize_t nxt_io_uring_conn_io_recv(nxt_conn_t *c, void *buf,
+    size_t size, nxt_uint_t flags);
+static ssize_t nxt_io_uring_conn_io_received(nxt_conn_t *c,
+    nxt_io_uring_fd_t *slot, void *buf, size_t size, nxt_uint_t flags);
+static void nxt_io_uring_conn_io_write(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_int_t nxt_io_uring_sendmsg(nxt_event_engine_t *engine,
+    nxt_conn_t *c, nxt_io_uring_fd_t *slot, nxt_uint_t niov);
+static nxt_int_t nxt_io_uring_splice(nxt_event_engine_t *engine,
+    nxt_conn_t *c, nxt_io_uring_fd_t *slot, nxt_buf_t *b);
+static void nxt_io_uring_conn_io_sent(nxt_event_engine_t *engine,
+    nxt_io_uring_send_t *send);
+
+
+static nxt_conn_io_t  nxt_io_uring_conn_io = {
+    .connect = nxt_conn_io_connect,
+    .accept = nxt_io_uring_conn_io_accept4,
+
+    .read = nxt_io_uring_conn_io_read,
+    .recvbuf = nxt_io_uring_conn_io_recvbuf,
+    .recv = nxt_io_uring_conn_io_recv,
+
+    .write = nxt_io_uring_conn_io_write,
+    .sendbuf = nxt_conn_io_sendbuf,
+
+#if (NXT_HAVE_LINUX_SENDFILE)
+    .old_sendbuf = nxt_linux_event_conn_io_sendfile,
+#else
+    .old_sendbuf = nxt_event_conn_io_sendbuf,
+#endif
+
+    .writev = nxt_event_conn_io_writev,
+    .send = nxt_event_conn_io_send,
+};
+
+
+const nxt_event_interface_t  nxt_io_uring_engine = {
+    "io_uring",
+    nxt_io_uring_create,
+    nxt_io_uring_free,
+    nxt_io_uring_enable,
+    nxt_io_uring_disable,
+    nxt_io_uring_delete,
+    nxt_io_uring_close,
+    nxt_io_uring_enable_read,
+    nxt_io_uring_enable_write,
+    nxt_io_uring_disable_read,
+    nxt_io_uring_disable_write,
+    nxt_io_uring_block_read,
+    nxt_io_uring_block_write,
+    nxt_io_uring_oneshot_read,
+    nxt_io_uring_oneshot_write,
+    nxt_io_uring_enable_accept,
+    NULL,
+    NULL,
+    nxt_io_uring_enable_post,
+    nxt_io_uring_signal,
+    nxt_io_uring_poll,
+
+    &nxt_io_uring_conn_io,
+
+    NXT_NO_FILE_EVENTS,
+    NXT_SIGNAL_EVENTS,
+};
+
+
+nxt_inline int
+nxt_io_uring_setup(uint32_t entries, struct io_uring_params *p)
+{
+    return syscall(SYS_io_uring_setup, entries, p);
+}
+
+
+nxt_int_t
+nxt_io_uring_test(nxt_task_t *task)
+{
+    int                     fd;
+    struct io_uring_params  p;
+
+    nxt_memzero(&p, sizeof(struct io_uring_params));
+
+    fd = nxt_io_uring_setup(1, &p);
+
+    if (fd == -1) {
+        nxt_log(task, NXT_LOG_WARN, "io_uring_setup() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_fd_close(fd);
+
+    if ((p.features & NXT_IO_URING_FEATURES) != NXT_IO_URING_FEATURES) {
+        nxt_log(task, NXT_LOG_WARN, "io_uring features %XD are not supported",
+                (uint32_t) (NXT_IO_URING_FEATURES & ~p.features));
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_io_uring_create(nxt_event_engine_t *engine, nxt_uint_t mchanges,
+    nxt_uint_t mevents)
+{
+    u_char                  *ring;
+    size_t                  size;
+    uint32_t                i, *array;
+    nxt_io_uring_engine_t   *uring;
+    struct io_uring_params  p;
+
+    uring = &engine->u.io_uring;
+
+    uring->fd = -1;
+    uring->epoll = -1;
+    uring->mode = EPOLLET | EPOLLRDHUP;
+    uring->mchanges = mchanges;
+    uring->mevents = mevents;
+    uring->signalfd.fd = -1;
+    uring->eventfd.fd = -1;
+
+    uring->changes = nxt_malloc(sizeof(nxt_epoll_change_t) * mchanges);
+    if (uring->changes == NULL) {
+        goto fail;
+    }
+
+    uring->events = nxt_malloc(sizeof(struct epoll_event) * mevents);
+    if (uring->events == NULL) {
+        goto fail;
+    }
+
+    uring->epoll = epoll_create(1);
+    if (uring->epoll == -1) {
+        nxt_alert(&engine->task, "epoll_create() failed %E", nxt_errno);
+        goto fail;
+    }
+
+    /*
+     * A completion queue is larger than a submission queue to hold
+     * bursts of multishot accept completions without overflowing.
+     */
+
+    nxt_memzero(&p, sizeof(struct io_uring_params));
+
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = 8 * mchanges;
+
+    uring->fd = nxt_io_uring_setup(mchanges, &p);
+    if (uring->fd == -1) {
+        nxt_alert(&engine->task, "io_uring_setup(%ui) failed %E",
+                  mchanges, nxt_errno);
+        goto fail;
+    }
+
+    nxt_debug(&engine->task, "io_uring_setup(): %d sq:%uD cq:%uD epoll:%d",
+              uring->fd, p.sq_entries, p.cq_entries, uring->epoll);
+
+    if ((p.features & NXT_IO_URING_FEATURES) != NXT_IO_URING_FEATURES) {
+        nxt_alert(&engine->task, "io_uring features %XD are not supported",
+                  (uint32_t) (NXT_IO_URING_FEATURES & ~p.features));
+        goto fail;
+    }
+
+    uring->skip_success = ((p.features & IORING_FEAT_CQE_SKIP) != 0);
+
+    size = nxt_max(p.sq_off.array + p.sq_entries * sizeof(uint32_t),
+                   p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe));
+
+    ring = nxt_mem_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, uring->fd,
+                        IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+        goto fail;
+    }
+
+    uring->ring = ring;
+    uring->ring_size = size;
+
+    size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    uring->sqes = nxt_mem_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, uring->fd,
+                               IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED) {
+        uring->sqes = NULL;
+        goto fail;
+    }
+
+    uring->sqes_size = size;
+
+    /* Epoll events of IORING_OP_EPOLL_CTL requests by submission entry. */
+
+    uring->sq_events = nxt_malloc(sizeof(struct epoll_event) * p.sq_entries);
+    if (uring->sq_events == NULL) {
+        goto fail;
+    }
+
+    uring->sq_head = (uint32_t *) (ring + p.sq_off.head);
+    uring->sq_tail = (uint32_t *) (ring + p.sq_off.tail);
+    uring->sq_mask = *(uint32_t *) (ring + p.sq_off.ring_mask);
+    uring->sq_entries = p.sq_entries;
+    uring->sq_next = *uring->sq_tail;
+
+    /* Submission entries are always used in order. */
+
+    array = (uint32_t *) (ring + p.sq_off.array);
+
+    for (i = 0; i < p.sq_entries; i++) {
+        array[i] = i;
+    }
+
+    uring->cq_head = (uint32_t *) (ring + p.cq_off.head);
+    uring->cq_tail = (uint32_t *) (ring + p.cq_off.tail);
+    uring->cq_mask = *(uint32_t *) (ring + p.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+
+    nxt_io_uring_probe(engine);
+
+    uring->accept = 1;
+
+    if (engine->signals != NULL) {
+        if (nxt_io_uring_add_signal(engine) != NXT_OK) {
+            goto fail;
+        }
+    }
+
+    return NXT_OK;
+
+fail:
+
+    nxt_io_uring_free(engine);
+
+    return NXT_ERROR;
+}
+
+
+static void
+nxt_io_uring_probe(nxt_event_engine_t *engine)
+{
+    int                    ret;
+    size_t                 size;
+    struct io_uring_probe  *probe;
+
+    size = sizeof(struct io_uring_probe)
+           + 256 * sizeof(struct io_uring_probe_op);
+
+    probe = nxt_zalloc(size);
+    if (probe == NULL) {
+        return;
+    }
+
+    ret = syscall(SYS_io_uring_register, engine->u.io_uring.fd,
+                  IORING_REGISTER_PROBE, probe, 256);
+
+    if (ret != 0) {
+        probe->ops_len = 0;
+    }
+
+    if (nxt_io_uring_op(probe, IORING_OP_EPOLL_CTL)) {
+        engine->u.io_uring.epoll_ctl = 1;
+
+    } else {
+        nxt_log(&engine->task, NXT_LOG_INFO,
+                "io_uring epoll_ctl operation is not supported");
+    }
+
+    if (nxt_io_uring_op(probe, IORING_OP_RECV)) {
+        nxt_io_uring_bufs_init(engine);
+
+    } else {
+        nxt_log(&engine->task, NXT_LOG_INFO,
+                "io_uring recv operation is not supported");
+    }
+
+    if (nxt_io_uring_op(probe, IORING_OP_SENDMSG)
+        && nxt_io_uring_op(probe, IORING_OP_SPLICE))
+    {
+        engine->u.io_uring.send = 1;
+
+    } else {
+        nxt_log(&engine->task, NXT_LOG_INFO,
+                "io_uring sendmsg or splice operations are not supported");
+    }
+
+    nxt_free(probe);
+}
+
+
+static void
+nxt_io_uring_bufs_init(nxt_event_engine_t *engine)
+{
+    int                      ret;
+    u_char                   *p;
+    size_t                   size, ring_size;
+    uint16_t                 bid;
+    nxt_io_uring_engine_t    *uring;
+    struct io_uring_buf_reg  reg;
+
+    uring = &engine->u.io_uring;
+
+    ring_size = nxt_align_size(NXT_IO_URING_BUFS * sizeof(struct io_uring_buf),
+                               nxt_pagesize);
+
+    size = ring_size + NXT_IO_URING_BUFS * NXT_IO_URING_BUF_SIZE;
+
+    p = nxt_mem_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        nxt_alert(&engine->task, "mmap(%uz) failed %E", size, nxt_errno);
+        return;
+    }
+
+    nxt_memzero(&reg, sizeof(struct io_uring_buf_reg));
+
+    reg.ring_addr = (uintptr_t) p;
+    reg.ring_entries = NXT_IO_URING_BUFS;
+    reg.bgid = 0;
+
+    ret = syscall(SYS_io_uring_register, uring->fd,
+                  IORING_REGISTER_PBUF_RING, &reg, 1);
+
+    if (ret != 0) {
+        nxt_log(&engine->task, NXT_LOG_INFO,
+                "io_uring provided buffers are not supported %E", nxt_errno);
+
+        nxt_mem_munmap(p, size);
+        return;
+    }
+
+    uring->buf_ring = (struct io_uring_buf_ring *) p;
+    uring->bufs = p + ring_size;
+    uring->bufs_size = size;
+
+    for (bid = 0; bid < NXT_IO_URING_BUFS; bid++) {
+        nxt_io_uring_buf_free(uring, bid);
+    }
+}
+
+
+static void
+nxt_io_uring_free(nxt_event_engine_t *engine)
+{
+    int                    fd;
+    uint32_t               i;
+    nxt_io_uring_send_t    *send;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    nxt_debug(&engine->task, "io_uring %d free", uring->fd);
+
+    fd = uring->signalfd.fd;
+
+    if (fd != -1 && close(fd) != 0) {
+        nxt_alert(&engine->task, "signalfd close(%d) failed %E", fd, nxt_errno);
+    }
+
+    fd = uring->eventfd.fd;
+
+    if (fd != -1 && close(fd) != 0) {
+        nxt_alert(&engine->task, "eventfd close(%d) failed %E", fd, nxt_errno);
+    }
+
+    /* Pending requests are canceled on io_uring descriptor close. */
+
+    fd = uring->fd;
+
+    if (fd != -1 && close(fd) != 0) {
+        nxt_alert(&engine->task, "io_uring close(%d) failed %E", fd, nxt_errno);
+    }
+
+    fd = uring->epoll;
+
+    if (fd != -1 && close(fd) != 0) {
+        nxt_alert(&engine->task, "epoll close(%d) failed %E", fd, nxt_errno);
+    }
+
+    if (uring->sqes != NULL) {
+        nxt_mem_munmap(uring->sqes, uring->sqes_size);
+    }
+
+    if (uring->ring != NULL) {
+        nxt_mem_munmap(uring->ring, uring->ring_size);
+    }
+
+    /* The provided buffer ring is unregistered on io_uring close. */
+
+    if (uring->buf_ring != NULL) {
+        nxt_mem_munmap(uring->buf_ring, uring->bufs_size);
+    }
+
+    for (i = 0; i < uring->nfds; i++) {
+        send = uring->fds[i].send;
+
+        if (send != NULL) {
+            if (send->pipe[0] != -1) {
+                nxt_fd_close(send->pipe[0]);
+                nxt_fd_close(send->pipe[1]);
+            }
+
+            nxt_free(send);
+        }
+    }
+
+    nxt_free(uring->sq_events);
+    nxt_free(uring->fds);
+    nxt_free(uring->events);
+    nxt_free(uring->changes);
+
+    nxt_memzero(uring, sizeof(nxt_io_uring_engine_t));
+}
+
+
+static void
+nxt_io_uring_enable(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    ev->read = NXT_EVENT_ACTIVE;
+    ev->write = NXT_EVENT_ACTIVE;
+
+    nxt_io_uring_change(engine, ev, EPOLL_CTL_ADD,
+                        EPOLLIN | EPOLLOUT | engine->u.io_uring.mode);
+}
+
+
+static void
+nxt_io_uring_disable(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->read > NXT_EVENT_DISABLED || ev->write > NXT_EVENT_DISABLED) {
+
+        ev->read = NXT_EVENT_INACTIVE;
+        ev->write = NXT_EVENT_INACTIVE;
+
+        nxt_io_uring_change(engine, ev, EPOLL_CTL_DEL, 0);
+    }
+}
+
+
+static void
+nxt_io_uring_delete(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->read != NXT_EVENT_INACTIVE || ev->write != NXT_EVENT_INACTIVE) {
+
+        ev->read = NXT_EVENT_INACTIVE;
+        ev->write = NXT_EVENT_INACTIVE;
+
+        nxt_io_uring_change(engine, ev, EPOLL_CTL_DEL, 0);
+    }
+}
+
+
+/*
+ * The receive and send requests of a connection socket are canceled,
+ * the socket and the buffers of the requests are released by the
+ * connection layer after the next poll if they are reported pending.
+ */
+
+static nxt_bool_t
+nxt_io_uring_close(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_bool_t             pending;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    nxt_io_uring_delete(engine, ev);
+
+    pending = 0;
+
+    if ((uint32_t) ev->fd < uring->nfds) {
+        slot = &uring->fds[ev->fd];
+
+        if (slot->conn == ev) {
+            pending = nxt_io_uring_conn_reset(engine, slot, ev->fd);
+        }
+    }
+
+    return ev->changing || pending;
+}
+
+
+static void
+nxt_io_uring_enable_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int       op;
+    uint32_t  events;
+
+    if (ev->read != NXT_EVENT_BLOCKED) {
+
+        op = EPOLL_CTL_MOD;
+        events = EPOLLIN | engine->u.io_uring.mode;
+
+        if (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) {
+            op = EPOLL_CTL_ADD;
+
+        } else if (ev->write >= NXT_EVENT_BLOCKED) {
+            events |= EPOLLOUT;
+        }
+
+        nxt_io_uring_change(engine, ev, op, events);
+    }
+
+    ev->read = NXT_EVENT_ACTIVE;
+
+    nxt_io_uring_recv(engine, ev);
+}
+
+
+static void
+nxt_io_uring_enable_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int       op;
+    uint32_t  events;
+
+    if (ev->write != NXT_EVENT_BLOCKED) {
+
+        op = EPOLL_CTL_MOD;
+        events = EPOLLOUT | engine->u.io_uring.mode;
+
+        if (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) {
+            op = EPOLL_CTL_ADD;
+
+        } else if (ev->read >= NXT_EVENT_BLOCKED) {
+            events |= EPOLLIN;
+        }
+
+        nxt_io_uring_change(engine, ev, op, events);
+    }
+
+    ev->write = NXT_EVENT_ACTIVE;
+}
+
+
+static void
+nxt_io_uring_disable_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int       op;
+    uint32_t  events;
+
+    ev->read = NXT_EVENT_INACTIVE;
+
+    if (ev->write <= NXT_EVENT_DISABLED) {
+        ev->write = NXT_EVENT_INACTIVE;
+        op = EPOLL_CTL_DEL;
+        events = 0;
+
+    } else {
+        op = EPOLL_CTL_MOD;
+        events = EPOLLOUT | engine->u.io_uring.mode;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_disable_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int       op;
+    uint32_t  events;
+
+    ev->write = NXT_EVENT_INACTIVE;
+
+    if (ev->read <= NXT_EVENT_DISABLED) {
+        ev->read = NXT_EVENT_INACTIVE;
+        op = EPOLL_CTL_DEL;
+        events = 0;
+
+    } else {
+        op = EPOLL_CTL_MOD;
+        events = EPOLLIN | engine->u.io_uring.mode;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_block_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->read != NXT_EVENT_INACTIVE) {
+        ev->read = NXT_EVENT_BLOCKED;
+    }
+}
+
+
+static void
+nxt_io_uring_block_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->write != NXT_EVENT_INACTIVE) {
+        ev->write = NXT_EVENT_BLOCKED;
+    }
+}
+
+
+static void
+nxt_io_uring_oneshot_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int  op;
+
+    op = (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) ?
+             EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+
+    ev->read = NXT_EVENT_ONESHOT;
+    ev->write = NXT_EVENT_INACTIVE;
+
+    nxt_io_uring_change(engine, ev, op, EPOLLIN | EPOLLONESHOT);
+
+    nxt_io_uring_recv(engine, ev);
+}
+
+
+static void
+nxt_io_uring_oneshot_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    int  op;
+
+    op = (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) ?
+             EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+
+    ev->read = NXT_EVENT_INACTIVE;
+    ev->write = NXT_EVENT_ONESHOT;
+
+    nxt_io_uring_change(engine, ev, op, EPOLLOUT | EPOLLONESHOT);
+}
+
+
+/*
+ * A multishot accept request is queued as a change to keep its order
+ * with a following deletion of the listen socket event.  The events are
+ * used if the listen socket falls back to the epoll set.
+ */
+
+static void
+nxt_io_uring_enable_accept(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    uint32_t  events;
+
+    ev->read = NXT_EVENT_ACTIVE;
+
+    events = EPOLLIN;
+
+#ifdef EPOLLEXCLUSIVE
+    events |= EPOLLEXCLUSIVE;
+#endif
+
+    nxt_io_uring_change(engine, ev, NXT_IO_URING_ACCEPT_OP, events);
+}
+
+
+static void
+nxt_io_uring_change(nxt_event_engine_t *engine, nxt_fd_event_t *ev, int op,
+    uint32_t events)
+{
+    nxt_epoll_change_t  *change;
+
+    nxt_debug(ev->task, "io_uring %d set event: fd:%d op:%d ev:%XD",
+              engine->u.io_uring.fd, ev->fd, op, events);
+
+    if (engine->u.io_uring.nchanges >= engine->u.io_uring.mchanges) {
+        nxt_io_uring_commit_changes(engine);
+    }
+
+    ev->changing = 1;
+
+    change = &engine->u.io_uring.changes[engine->u.io_uring.nchanges++];
+    change->op = op;
+    change->event.events = events;
+    change->event.data.ptr = ev;
+}
+
+
+static void
+nxt_io_uring_commit_changes(nxt_event_engine_t *engine)
+{
+    int                    ret;
+    nxt_uint_t             accept;
+    nxt_fd_event_t         *ev;
+    nxt_io_uring_fd_t      *slot;
+    nxt_epoll_change_t     *change, *end;
+    struct epoll_event     *event;
+    struct io_uring_sqe    *sqe;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    nxt_debug(&engine->task, "io_uring %d changes:%ui",
+              uring->fd, uring->nchanges);
+
+    change = uring->changes;
+    end = change + uring->nchanges;
+
+    do {
+        ev = change->event.data.ptr;
+        ev->changing = 0;
+
+        slot = nxt_io_uring_fd(engine, ev->fd);
+        if (nxt_slow_path(slot == NULL)) {
+            goto error;
+        }
+
+        /*
+         * The sequence number invalidates completions of requests
+         * submitted for the previous event of the descriptor.
+         */
+        slot->seq = (slot->seq + 1) & NXT_IO_URING_SEQ_MASK;
+        slot->event = (change->op != EPOLL_CTL_DEL) ? ev : NULL;
+
+        accept = slot->accept;
+
+        if (accept) {
+            slot->accept = 0;
+
+            nxt_io_uring_cancel(engine,
+                                nxt_io_uring_data(NXT_IO_URING_ACCEPT,
+                                                  (slot->seq - 1)
+                                                  & NXT_IO_URING_SEQ_MASK,
+                                                  ev->fd));
+        }
+
+        if (change->op == NXT_IO_URING_ACCEPT_OP) {
+
+            if (uring->accept) {
+                nxt_debug(ev->task, "io_uring accept(%d)", ev->fd);
+
+                sqe = nxt_io_uring_sqe(engine);
+                if (nxt_slow_path(sqe == NULL)) {
+                    goto error;
+                }
+
+                sqe->opcode = IORING_OP_ACCEPT;
+                sqe->fd = ev->fd;
+                sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+                sqe->accept_flags = SOCK_NONBLOCK;
+                sqe->user_data = nxt_io_uring_data(NXT_IO_URING_ACCEPT,
+                                                   slot->seq, ev->fd);
+                slot->accept = 1;
+
+                goto next;
+            }
+
+            change->op = EPOLL_CTL_ADD;
+        }
+
+        if (accept && change->op == EPOLL_CTL_DEL) {
+            /* The listen socket is not in the epoll set. */
+            goto next;
+        }
+
+        nxt_debug(ev->task, "epoll_ctl(%d): fd:%d op:%d ev:%XD",
+                  uring->epoll, ev->fd, change->op, change->event.events);
+
+        if (uring->epoll_ctl) {
+            sqe = nxt_io_uring_sqe(engine);
+            if (nxt_slow_path(sqe == NULL)) {
+                goto error;
+            }
+
+            /*
+             * The event is copied by the kernel on submission, before
+             * the submission entry and its event can be reused.
+             */
+            event = &uring->sq_events[sqe - uring->sqes];
+            *event = change->event;
+
+            sqe->opcode = IORING_OP_EPOLL_CTL;
+            sqe->fd = uring->epoll;
+            sqe->len = change->op;
+            sqe->off = ev->fd;
+            sqe->addr = (uintptr_t) event;
+            sqe->user_data = nxt_io_uring_data(NXT_IO_URING_CTL,
+                                               slot->seq, ev->fd);
+
+            if (uring->skip_success) {
+                sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+            }
+
+            goto next;
+        }
+
+        ret = epoll_ctl(uring->epoll, change->op, ev->fd, &change->event);
+
+        if (nxt_fast_path(ret == 0)) {
+            goto next;
+        }
+
+        nxt_alert(ev->task, "epoll_ctl(%d, %d, %d) failed %E",
+                  uring->epoll, change->op, ev->fd, nxt_errno);
+
+    error:
+
+        nxt_work_queue_add(&engine->fast_work_queue,
+                           nxt_io_uring_error_handler, ev->task, ev, ev->data);
+
+        uring->error = 1;
+
+    next:
+
+        change++;
+
+    } while (change < end);
+
+    uring->nchanges = 0;
+}
+
+
+static nxt_io_uring_fd_t *
+nxt_io_uring_fd(nxt_event_engine_t *engine, nxt_fd_t fd)
+{
+    uint32_t               n;
+    nxt_io_uring_fd_t      *fds;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    if (nxt_fast_path((uint32_t) fd < uring->nfds)) {
+        return &uring->fds[fd];
+    }
+
+    if (nxt_slow_path(fd < 0)) {
+        nxt_alert(&engine->task, "io_uring invalid descriptor %d", fd);
+        return NULL;
+    }
+
+    n = nxt_max(2 * uring->nfds, (uint32_t) fd + 1);
+    n = nxt_max(n, 1024);
+
+    fds = nxt_realloc(uring->fds, n * sizeof(nxt_io_uring_fd_t));
+    if (nxt_slow_path(fds == NULL)) {
+        return NULL;
+    }
+
+    nxt_memzero(&fds[uring->nfds], (n - uring->nfds) * sizeof(nxt_io_uring_fd_t));
+
+    uring->fds = fds;
+    uring->nfds = n;
+
+    return &fds[fd];
+}
+
+
+static struct io_uring_sqe *
+nxt_io_uring_sqe(nxt_event_engine_t *engine)
+{
+    uint32_t               head;
+    struct io_uring_sqe    *sqe;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+
+    if (uring->sq_next - head >= uring->sq_entries) {
+        (void) nxt_io_uring_enter(engine, 0, 0, NULL);
+
+        head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+
+        if (uring->sq_next - head >= uring->sq_entries) {
+            nxt_alert(&engine->task, "io_uring %d submission queue is full",
+                      uring->fd);
+            return NULL;
+        }
+    }
+
+    sqe = &uring->sqes[uring->sq_next & uring->sq_mask];
+    uring->sq_next++;
+
+    nxt_memzero(sqe, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+
+static void
+nxt_io_uring_cancel(nxt_event_engine_t *engine, uint64_t data)
+{
+    struct io_uring_sqe  *sqe;
+
+    sqe = nxt_io_uring_sqe(engine);
+
+    if (nxt_fast_path(sqe != NULL)) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = data;
+        sqe->user_data = nxt_io_uring_data(NXT_IO_URING_IGNORE, 0, 0);
+    }
+}
+
+
+/*
+ * The prepared submission entries are published to the kernel and
+ * submitted along with waiting for completions in one io_uring_enter().
+ */
+
+static int
+nxt_io_uring_enter(nxt_event_engine_t *engine, uint32_t min_complete,
+    uint32_t flags, struct io_uring_getevents_arg *arg)
+{
+    int                    n;
+    uint32_t               submit;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    submit = uring->sq_next - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(uring->sq_tail, uring->sq_next, __ATOMIC_RELEASE);
+
+    n = syscall(SYS_io_uring_enter, uring->fd, submit, min_complete, flags,
+                arg, (arg != NULL) ? sizeof(struct io_uring_getevents_arg) : 0);
+
+    if (nxt_slow_path(n == -1 && submit != 0 && min_complete == 0)) {
+        nxt_alert(&engine->task, "io_uring_enter(%d, %uD) failed %E",
+                  uring->fd, submit, nxt_errno);
+    }
+
+    return n;
+}
+
+
+static void
+nxt_io_uring_error_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_fd_event_t  *ev;
+
+    ev = obj;
+
+    ev->read = NXT_EVENT_INACTIVE;
+    ev->write = NXT_EVENT_INACTIVE;
+
+    ev->error_handler(ev->task, ev, data);
+}
+
+
+static nxt_int_t
+nxt_io_uring_add_signal(nxt_event_engine_t *engine)
+{
+    int                    fd;
+    struct epoll_event     ee;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    if (sigprocmask(SIG_BLOCK, &engine->signals->sigmask, NULL) != 0) {
+        nxt_alert(&engine->task, "sigprocmask(SIG_BLOCK) failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    fd = signalfd(-1, &engine->signals->sigmask, SFD_NONBLOCK);
+
+    if (fd == -1) {
+        nxt_alert(&engine->task, "signalfd() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    uring->signalfd.fd = fd;
+
+    nxt_debug(&engine->task, "signalfd(): %d", fd);
+
+    uring->signalfd.data = engine->signals->handler;
+    uring->signalfd.read_work_queue = &engine->fast_work_queue;
+    uring->signalfd.read_handler = nxt_io_uring_signalfd_handler;
+    uring->signalfd.log = engine->task.log;
+    uring->signalfd.task = &engine->task;
+
+    ee.events = EPOLLIN;
+    ee.data.ptr = &uring->signalfd;
+
+    if (epoll_ctl(uring->epoll, EPOLL_CTL_ADD, fd, &ee) != 0) {
+        nxt_alert(&engine->task, "epoll_ctl(%d, %d, %d) failed %E",
+                  uring->epoll, EPOLL_CTL_ADD, fd, nxt_errno);
+
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_io_uring_signalfd_handler(nxt_task_t *task, void *obj, void *data)
+{
+    int                      n;
+    nxt_fd_event_t           *ev;
+    nxt_work_handler_t       handler;
+    struct signalfd_siginfo  sfd;
+
+    ev = obj;
+    handler = data;
+
+    nxt_debug(task, "signalfd handler");
+
+    n = read(ev->fd, &sfd, sizeof(struct signalfd_siginfo));
+
+    nxt_debug(task, "read signalfd(%d): %d", ev->fd, n);
+
+    if (n != sizeof(struct signalfd_siginfo)) {
+        nxt_alert(task, "read signalfd(%d) failed %E", ev->fd, nxt_errno);
+        return;
+    }
+
+    nxt_debug(task, "signalfd(%d) signo:%d", ev->fd, sfd.ssi_signo);
+
+    handler(task, (void *) (uintptr_t) sfd.ssi_signo, NULL);
+}
+
+
+static nxt_int_t
+nxt_io_uring_enable_post(nxt_event_engine_t *engine,
+    nxt_work_handler_t handler)
+{
+    struct epoll_event     ee;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    uring->post_handler = handler;
+
+    uring->eventfd.fd = eventfd(0, EFD_NONBLOCK);
+
+    if (uring->eventfd.fd == -1) {
+        nxt_alert(&engine->task, "eventfd() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_debug(&engine->task, "eventfd(): %d", uring->eventfd.fd);
+
+    uring->eventfd.read_work_queue = &engine->fast_work_queue;
+    uring->eventfd.read_handler = nxt_io_uring_eventfd_handler;
+    uring->eventfd.data = engine;
+    uring->eventfd.log = engine->task.log;
+    uring->eventfd.task = &engine->task;
+
+    ee.events = EPOLLIN | EPOLLET;
+    ee.data.ptr = &uring->eventfd;
+
+    if (epoll_ctl(uring->epoll, EPOLL_CTL_ADD, uring->eventfd.fd, &ee) != 0) {
+        nxt_alert(&engine->task, "epoll_ctl(%d, %d, %d) failed %E",
+                  uring->epoll, EPOLL_CTL_ADD, uring->eventfd.fd, nxt_errno);
+
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_io_uring_eventfd_handler(nxt_task_t *task, void *obj, void *data)
+{
+    int                 n;
+    uint64_t            events;
+    nxt_event_engine_t  *engine;
+
+    engine = data;
+
+    nxt_debug(task, "eventfd handler, times:%ui", engine->u.io_uring.neventfd);
+
+    /* See the comment in nxt_epoll_eventfd_handler(). */
+
+    if (engine->u.io_uring.neventfd++ >= 0xFFFFFFFE) {
+        engine->u.io_uring.neventfd = 0;
+
+        n = read(engine->u.io_uring.eventfd.fd, &events, sizeof(uint64_t));
+
+        nxt_debug(task, "read(%d): %d events:%uL",
+                  engine->u.io_uring.eventfd.fd, n, events);
+
+        if (n != sizeof(uint64_t)) {
+            nxt_alert(task, "read eventfd(%d) failed %E",
+                      engine->u.io_uring.eventfd.fd, nxt_errno);
+        }
+    }
+
+    engine->u.io_uring.post_handler(task, NULL, NULL);
+}
+
+
+static void
+nxt_io_uring_signal(nxt_event_engine_t *engine, nxt_uint_t signo)
+{
+    size_t    ret;
+    uint64_t  event;
+
+    event = 1;
+
+    ret = write(engine->u.io_uring.eventfd.fd, &event, sizeof(uint64_t));
+
+    if (nxt_slow_path(ret != sizeof(uint64_t))) {
+        nxt_alert(&engine->task, "write(%d) to eventfd failed %E",
+                  engine->u.io_uring.eventfd.fd, nxt_errno);
+    }
+}
+
+
+static void
+nxt_io_uring_poll(nxt_event_engine_t *engine, nxt_msec_t timeout)
+{
+    int                            n;
+    uint32_t                       head, tail;
+    nxt_err_t                      err;
+    nxt_uint_t                     level;
+    struct io_uring_sqe            *sqe;
+    nxt_io_uring_engine_t          *uring;
+    struct __kernel_timespec       ts;
+    struct io_uring_getevents_arg  arg;
+
+    uring = &engine->u.io_uring;
+
+    if (uring->nchanges != 0) {
+        nxt_io_uring_commit_changes(engine);
+    }
+
+    if (!uring->polling) {
+        sqe = nxt_io_uring_sqe(engine);
+
+        if (nxt_fast_path(sqe != NULL)) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = uring->epoll;
+            sqe->poll32_events = EPOLLIN;
+            sqe->user_data = nxt_io_uring_data(NXT_IO_URING_EPOLL, 0,
+                                               uring->epoll);
+            uring->polling = 1;
+        }
+    }
+
+    if (uring->error) {
+        uring->error = 0;
+        /* Error handlers have been enqueued on failure. */
+        timeout = 0;
+    }
+
+    nxt_memzero(&arg, sizeof(struct io_uring_getevents_arg));
+
+    if (timeout != NXT_INFINITE_MSEC) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+        arg.ts = (uintptr_t) &ts;
+    }
+
+    nxt_debug(&engine->task, "io_uring_enter(%d) timeout:%M",
+              uring->fd, timeout);
+
+    n = nxt_io_uring_enter(engine, 1,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                           &arg);
+
+    err = (n == -1) ? nxt_errno : 0;
+
+    nxt_thread_time_update(engine->task.thread);
+
+    nxt_debug(&engine->task, "io_uring_enter(%d): %d", uring->fd, n);
+
+    if (n == -1 && err != NXT_ETIME) {
+        level = (err == NXT_EINTR || err == NXT_EBUSY) ? NXT_LOG_INFO
+                                                       : NXT_LOG_ALERT;
+
+        nxt_log(&engine->task, level, "io_uring_enter(%d) failed %E",
+                uring->fd, err);
+    }
+
+    head = *uring->cq_head;
+    tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        nxt_io_uring_completion(engine, &uring->cqes[head & uring->cq_mask]);
+        head++;
+    }
+
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (uring->ready) {
+        uring->ready = 0;
+        nxt_io_uring_epoll_events(engine);
+    }
+}
+
+
+static void
+nxt_io_uring_completion(nxt_event_engine_t *engine, struct io_uring_cqe *cqe)
+{
+    int                    res;
+    uint64_t               data;
+    nxt_fd_t               fd;
+    nxt_fd_event_t         *ev;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    data = cqe->user_data;
+    res = cqe->res;
+
+    nxt_debug(&engine->task, "io_uring: data:%XL res:%d flags:%XD",
+              data, res, cqe->flags);
+
+    switch (nxt_io_uring_data_type(data)) {
+
+    case NXT_IO_URING_EPOLL:
+        uring->polling = 0;
+        uring->ready = 1;
+
+        if (nxt_slow_path(res < 0)) {
+            nxt_alert(&engine->task, "io_uring poll(%d) failed %E",
+                      uring->epoll, -res);
+        }
+
+        return;
+
+    case NXT_IO_URING_CTL:
+        if (res == 0) {
+            return;
+        }
+
+        fd = nxt_io_uring_data_fd(data);
+        slot = ((uint32_t) fd < uring->nfds) ? &uring->fds[fd] : NULL;
+
+        if (slot == NULL
+            || slot->seq != nxt_io_uring_data_seq(data)
+            || slot->event == NULL)
+        {
+            /* A deleted descriptor might be already closed. */
+            nxt_debug(&engine->task, "epoll_ctl(%d, %d) failed %E",
+                      uring->epoll, fd, -res);
+            return;
+        }
+
+        ev = slot->event;
+
+        nxt_alert(ev->task, "epoll_ctl(%d, %d) failed %E",
+                  uring->epoll, fd, -res);
+
+        nxt_work_queue_add(&engine->fast_work_queue,
+                           nxt_io_uring_error_handler, ev->task, ev, ev->data);
+
+        uring->error = 1;
+
+        return;
+
+    case NXT_IO_URING_ACCEPT:
+        nxt_io_uring_accepted(engine, cqe);
+        return;
+
+    case NXT_IO_URING_RECV:
+        nxt_io_uring_received(engine, cqe);
+        return;
+
+    case NXT_IO_URING_SEND:
+    case NXT_IO_URING_SPLICE:
+        nxt_io_uring_sent(engine, cqe);
+        return;
+
+    default: /* NXT_IO_URING_IGNORE */
+        return;
+    }
+}
+
+
+static void
+nxt_io_uring_accepted(nxt_event_engine_t *engine, struct io_uring_cqe *cqe)
+{
+    int                    res;
+    uint64_t               data;
+    nxt_fd_t               fd;
+    nxt_fd_event_t         *ev;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    data = cqe->user_data;
+    res = cqe->res;
+    fd = nxt_io_uring_data_fd(data);
+
+    slot = ((uint32_t) fd < uring->nfds) ? &uring->fds[fd] : NULL;
+
+    if (slot == NULL
+        || !slot->accept
+        || slot->seq != nxt_io_uring_data_seq(data))
+    {
+        /* The listen socket event has been deleted. */
+
+        if (res >= 0) {
+            nxt_socket_close(&engine->task, res);
+        }
+
+        return;
+    }
+
+    ev = slot->event;
+
+    if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+        /* A multishot accept request is terminated on any error. */
+        slot->accept = 0;
+
+        switch (res) {
+
+        case -EINVAL:
+            nxt_log(ev->task, NXT_LOG_INFO,
+                    "io_uring multishot accept is not supported");
+
+            /* The listen socket falls back to the epoll set. */
+            uring->accept = 0;
+            nxt_io_uring_enable_accept(engine, ev);
+            return;
+
+        case -EBADF:
+        case -ENOTSOCK:
+        case -EOPNOTSUPP:
+            break;
+
+        default:
+            nxt_io_uring_enable_accept(engine, ev);
+            break;
+        }
+    }
+
+    nxt_work_queue_add(ev->read_work_queue, nxt_io_uring_accept_handler,
+                       ev->task, ev, (void *) (intptr_t) res);
+}
+
+
+static void
+nxt_io_uring_epoll_events(nxt_event_engine_t *engine)
+{
+    int                    nevents;
+    uint32_t               events;
+    nxt_int_t              i;
+    nxt_bool_t             error;
+    nxt_fd_event_t         *ev;
+    struct epoll_event     *event;
+    nxt_fd_event_state_t   read;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    nevents = epoll_wait(uring->epoll, uring->events, uring->mevents, 0);
+
+    nxt_debug(&engine->task, "epoll_wait(%d): %d", uring->epoll, nevents);
+
+    if (nevents == -1) {
+        nxt_alert(&engine->task, "epoll_wait(%d) failed %E",
+                  uring->epoll, nxt_errno);
+        return;
+    }
+
+    for (i = 0; i < nevents; i++) {
+
+        event = &uring->events[i];
+        events = event->events;
+        ev = event->data.ptr;
+
+        nxt_debug(ev->task, "epoll: fd:%d ev:%04XD d:%p rd:%d wr:%d",
+                  ev->fd, events, ev, ev->read, ev->write);
+
+        /* See the comment in nxt_epoll_poll(). */
+
+        error = ((events & (EPOLLERR | EPOLLHUP)) != 0);
+        ev->epoll_error = error;
+
+        read = ev->read;
+
+        if (uring->bufs != NULL
+            && (uint32_t) ev->fd < uring->nfds
+            && uring->fds[ev->fd].conn == ev)
+        {
+            /*
+             * The socket is read by receive requests, which also
+             * complete with the end of file or the socket error.
+             */
+            events &= ~(EPOLLIN | EPOLLRDHUP);
+            read = NXT_EVENT_BLOCKED;
+        }
+
+        if (error
+            && read <= NXT_EVENT_BLOCKED
+            && ev->write <= NXT_EVENT_BLOCKED)
+        {
+            error = 0;
+        }
+
+        ev->epoll_eof = ((events & EPOLLRDHUP) != 0);
+
+        if ((events & EPOLLIN) != 0) {
+            ev->read_ready = 1;
+
+            if (ev->read != NXT_EVENT_BLOCKED) {
+
+                if (ev->read == NXT_EVENT_ONESHOT) {
+                    ev->read = NXT_EVENT_DISABLED;
+                }
+
+                nxt_work_queue_add(ev->read_work_queue, ev->read_handler,
+                                   ev->task, ev, ev->data);
+
+                error = 0;
+            }
+        }
+
+        if ((events & EPOLLOUT) != 0) {
+            ev->write_ready = 1;
+
+            if (ev->write != NXT_EVENT_BLOCKED) {
+
+                if (ev->write == NXT_EVENT_ONESHOT) {
+                    ev->write = NXT_EVENT_DISABLED;
+                }
+
+                nxt_work_queue_add(ev->write_work_queue, ev->write_handler,
+                                   ev->task, ev, ev->data);
+
+                error = 0;
+            }
+        }
+
+        if (!error) {
+            continue;
+        }
+
+        ev->read_ready = 1;
+        ev->write_ready = 1;
+
+        if (ev->read == NXT_EVENT_BLOCKED && ev->write == NXT_EVENT_BLOCKED) {
+            continue;
+        }
+
+        nxt_work_queue_add(&engine->fast_work_queue,
+                           nxt_io_uring_error_handler, ev->task, ev, ev->data);
+    }
+}
+
+
+/*
+ * nxt_io_uring_accept_handler() processes a socket accepted by
+ * a multishot accept request.  The listen socket read readiness is
+ * not set, so nxt_conn_accept() does not call accept4() after it.
+ */
+
+static void
+nxt_io_uring_accept_handler(nxt_task_t *task, void *obj, void *data)
+{
+    socklen_t           socklen;
+    nxt_conn_t          *c;
+    nxt_socket_t        s;
+    struct sockaddr     *sa;
+    nxt_listen_event_t  *lev;
+
+    lev = obj;
+    s = (nxt_socket_t) (intptr_t) data;
+
+    if (s < 0) {
+        nxt_conn_accept_error(task, lev, "accept", -s);
+        return;
+    }
+
+    nxt_debug(task, "io_uring accept(%d): %d", lev->socket.fd, s);
+
+    c = lev->next;
+
+    if (c == NULL) {
+        /* New connections are not accepted now, see nxt_conn_accept(). */
+        nxt_socket_close(task, s);
+        return;
+    }
+
+    lev->socket.read_ready = 0;
+
+    sa = &c->remote->u.sockaddr;
+    socklen = c->remote->socklen;
+
+    /* The returned socklen is ignored, see comment in nxt_conn_io_accept(). */
+
+    if (nxt_slow_path(getpeername(s, sa, &socklen) != 0)) {
+        nxt_debug(task, "getpeername(%d) failed %E", s, nxt_socket_errno);
+        nxt_socket_close(task, s);
+        return;
+    }
+
+    c->socket.fd = s;
+
+    nxt_conn_accept(task, lev, c);
+}
+
+
+/*
+ * nxt_io_uring_conn_io_accept4() is used by listen sockets in the epoll
+ * set and by nxt_conn_accept() after the listen socket timer.
+ */
+
+static void
+nxt_io_uring_conn_io_accept4(nxt_task_t *task, void *obj, void *data)
+{
+    socklen_t           socklen;
+    nxt_conn_t          *c;
+    nxt_socket_t        s;
+    struct sockaddr     *sa;
+    nxt_listen_event_t  *lev;
+
+    lev = obj;
+    c = lev->next;
+
+    lev->ready--;
+    lev->socket.read_ready = (lev->ready != 0);
+
+    sa = &c->remote->u.sockaddr;
+    socklen = c->remote->socklen;
+
+    s = accept4(lev->socket.fd, sa, &socklen, SOCK_NONBLOCK);
+
+    if (s != -1) {
+        c->socket.fd = s;
+
+        nxt_debug(task, "accept4(%d): %d", lev->socket.fd, s);
+
+        nxt_conn_accept(task, lev, c);
+        return;
+    }
+
+    nxt_conn_accept_error(task, lev, "accept4", nxt_errno);
+}
+
+
+/*
+ * nxt_io_uring_conn() returns the descriptor slot of a connection socket
+ * which is read or written by requests.  The slot state left by another
+ * connection of the same descriptor is reset.
+ */
+
+static nxt_io_uring_fd_t *
+nxt_io_uring_conn(nxt_conn_t *c)
+{
+    nxt_io_uring_fd_t   *slot;
+    nxt_event_engine_t  *engine;
+
+    engine = c->socket.task->thread->engine;
+
+    slot = nxt_io_uring_fd(engine, c->socket.fd);
+    if (nxt_slow_path(slot == NULL)) {
+        return NULL;
+    }
+
+    if (slot->conn != &c->socket) {
+        (void) nxt_io_uring_conn_reset(engine, slot, c->socket.fd);
+
+        slot->conn = &c->socket;
+
+        if (nxt_fd_event_is_active(c->socket.read) && !c->socket.read_ready) {
+            /* Read events of the socket are not reported by epoll now. */
+            nxt_io_uring_recv(engine, &c->socket);
+        }
+    }
+
+    return slot;
+}
+
+
+static nxt_bool_t
+nxt_io_uring_conn_reset(nxt_event_engine_t *engine, nxt_io_uring_fd_t *slot,
+    nxt_fd_t fd)
+{
+    nxt_bool_t             pending;
+    nxt_io_uring_send_t    *send;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    pending = 0;
+
+    if (slot->recv_pending) {
+        nxt_io_uring_cancel(engine,
+                            nxt_io_uring_data(NXT_IO_URING_RECV,
+                                              slot->conn_seq, fd));
+        pending = 1;
+    }
+
+    if (slot->recv_data) {
+        nxt_io_uring_buf_free(uring, slot->recv_buf);
+    }
+
+    send = slot->send;
+
+    if (send != NULL) {
+
+        if (send->pending) {
+            if (send->pending > 1) {
+                nxt_io_uring_cancel(engine,
+                                    nxt_io_uring_data(NXT_IO_URING_SPLICE,
+                                                      slot->conn_seq, fd));
+            }
+
+            nxt_io_uring_cancel(engine,
+                                nxt_io_uring_data(NXT_IO_URING_SEND,
+                                                  slot->conn_seq, fd));
+            pending = 1;
+        }
+
+        if (send->pipe[0] != -1) {
+            nxt_pipe_close(&engine->task, send->pipe);
+
+            send->pipe[0] = -1;
+            send->pipe[1] = -1;
+        }
+
+        send->conn = NULL;
+        send->piped = 0;
+        send->sent = 0;
+        send->error = 0;
+        send->pending = 0;
+        send->splice = 0;
+        send->poll = 0;
+    }
+
+    slot->recv_pending = 0;
+    slot->recv_data = 0;
+    slot->recv_eof = 0;
+    slot->recv_error = 0;
+
+    slot->conn = NULL;
+    slot->conn_seq = (slot->conn_seq + 1) & NXT_IO_URING_SEQ_MASK;
+
+    return pending;
+}
+
+
+/*
+ * A receive request is polled before the first receive attempt, so
+ * a provided buffer is selected only when data arrive.  The end of file
+ * is reported once like edge-triggered epoll does, and a read after it
+ * returns 0.
+ */
+
+static void
+nxt_io_uring_recv(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_io_uring_fd_t      *slot;
+    struct io_uring_sqe    *sqe;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    if (uring->bufs == NULL || (uint32_t) ev->fd >= uring->nfds) {
+        return;
+    }
+
+    slot = &uring->fds[ev->fd];
+
+    if (slot->conn != ev || slot->recv_pending || ev->closed) {
+        return;
+    }
+
+    if (nxt_io_uring_recv_ready(slot)) {
+        /* The received data have not been read yet. */
+        nxt_io_uring_read_ready(ev);
+        return;
+    }
+
+    nxt_debug(ev->task, "io_uring recv(%d)", ev->fd);
+
+    sqe = nxt_io_uring_sqe(engine);
+
+    if (nxt_slow_path(sqe == NULL)) {
+        /* The socket is read directly. */
+        nxt_io_uring_read_ready(ev);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECVSEND_POLL_FIRST;
+    sqe->fd = ev->fd;
+    sqe->len = NXT_IO_URING_BUF_SIZE;
+    sqe->buf_group = 0;
+    sqe->user_data = nxt_io_uring_data(NXT_IO_URING_RECV, slot->conn_seq,
+                                       ev->fd);
+
+    slot->recv_pending = 1;
+}
+
+
+static void
+nxt_io_uring_received(nxt_event_engine_t *engine, struct io_uring_cqe *cqe)
+{
+    int                    res;
+    uint16_t               bid;
+    uint64_t               data;
+    nxt_fd_t               fd;
+    nxt_bool_t             buffer;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    data = cqe->user_data;
+    res = cqe->res;
+    fd = nxt_io_uring_data_fd(data);
+
+    buffer = ((cqe->flags & IORING_CQE_F_BUFFER) != 0);
+    bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+    slot = ((uint32_t) fd < uring->nfds) ? &uring->fds[fd] : NULL;
+
+    if (slot == NULL
+        || !slot->recv_pending
+        || slot->conn_seq != nxt_io_uring_data_seq(data))
+    {
+        /* The connection has been closed. */
+
+        if (buffer) {
+            nxt_io_uring_buf_free(uring, bid);
+        }
+
+        return;
+    }
+
+    slot->recv_pending = 0;
+
+    if (res > 0 && buffer) {
+        slot->recv_data = 1;
+        slot->recv_buf = bid;
+        slot->recv_pos = 0;
+        slot->recv_size = res;
+
+    } else {
+        if (buffer) {
+            nxt_io_uring_buf_free(uring, bid);
+        }
+
+        if (res == 0) {
+            slot->recv_eof = 1;
+
+        } else if (res != -ENOBUFS) {
+            slot->recv_error = (res < 0) ? -res : NXT_EINVAL;
+        }
+
+        /*
+         * If all provided buffers are used by other connections,
+         * the socket is read directly.
+         */
+    }
+
+    nxt_io_uring_read_ready(slot->conn);
+}
+
+
+static void
+nxt_io_uring_read_ready(nxt_fd_event_t *ev)
+{
+    ev->read_ready = 1;
+
+    if (nxt_fd_event_is_active(ev->read)) {
+
+        if (ev->read == NXT_EVENT_ONESHOT) {
+            ev->read = NXT_EVENT_DISABLED;
+        }
+
+        nxt_work_queue_add(ev->read_work_queue, ev->read_handler,
+                           ev->task, ev, ev->data);
+    }
+}
+
+
+static void
+nxt_io_uring_buf_free(nxt_io_uring_engine_t *uring, uint16_t bid)
+{
+    struct io_uring_buf  *buf;
+
+    buf = &uring->buf_ring->bufs[uring->buf_tail & (NXT_IO_URING_BUFS - 1)];
+
+    buf->addr = (uintptr_t) (uring->bufs + bid * NXT_IO_URING_BUF_SIZE);
+    buf->len = NXT_IO_URING_BUF_SIZE;
+    buf->bid = bid;
+
+    uring->buf_tail++;
+
+    __atomic_store_n(&uring->buf_ring->tail, uring->buf_tail,
+                     __ATOMIC_RELEASE);
+}
+
+
+/*
+ * nxt_io_uring_conn_io_read() ignores a read into a full buffer.  A read
+ * queued by a receive completion may run after a read requested by the
+ * connection owner has filled the buffer, and the data left received are
+ * read after the ready handler of the first read has processed the buffer.
+ */
+
+static void
+nxt_io_uring_conn_io_read(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t   *b;
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    if (c->read != NULL) {
+
+        for (b = c->read; b != NULL; b = b->next) {
+            if (nxt_buf_mem_free_size(&b->mem) != 0) {
+                break;
+            }
+        }
+
+        if (b == NULL) {
+            nxt_debug(task, "io_uring conn read fd:%d buffer is full",
+                      c->socket.fd);
+            return;
+        }
+    }
+
+    nxt_conn_io_read(task, obj, data);
+}
+
+
+/*
+ * nxt_io_uring_conn_io_recvbuf() copies data received by a receive
+ * request.  The socket is read directly on the first read, and if
+ * the provided buffers are not available.
+ */
+
+static ssize_t
+nxt_io_uring_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b)
+{
+    ssize_t                 n;
+    nxt_uint_t              i, niov;
+    nxt_io_uring_fd_t       *slot;
+    struct iovec            iov[NXT_IOBUF_MAX];
+    nxt_event_engine_t      *engine;
+    nxt_recvbuf_coalesce_t  rb;
+
+    engine = c->socket.task->thread->engine;
+
+    slot = (engine->u.io_uring.bufs != NULL) ? nxt_io_uring_conn(c) : NULL;
+
+    if (slot == NULL || !nxt_io_uring_recv_ready(slot)) {
+
+        if (slot != NULL && slot->recv_pending) {
+            c->socket.read_ready = 0;
+            return NXT_AGAIN;
+        }
+
+        n = nxt_conn_io_recvbuf(c, b);
+
+        /* See the comment in nxt_epoll_edge_conn_io_recvbuf(). */
+
+        if (n > 0 && c->socket.epoll_eof) {
+            c->socket.read_ready = 1;
+        }
+
+        if (n == NXT_AGAIN
+            && slot != NULL
+            && nxt_fd_event_is_active(c->socket.read))
+        {
+            /* nxt_conn_io_read() does not enable an active read event. */
+            nxt_io_uring_recv(engine, &c->socket);
+        }
+
+        return n;
+    }
+
+    if (!slot->recv_data) {
+        return nxt_io_uring_conn_io_received(c, slot, NULL, 0, 0);
+    }
+
+    rb.buf = b;
+    rb.iobuf = iov;
+    rb.nmax = NXT_IOBUF_MAX;
+    rb.size = 0;
+
+    niov = nxt_recvbuf_mem_coalesce(&rb);
+
+    n = 0;
+
+    for (i = 0; i < niov && slot->recv_data; i++) {
+        n += nxt_io_uring_conn_io_received(c, slot, iov[i].iov_base,
+                                           iov[i].iov_len, 0);
+    }
+
+    return n;
+}
+
+
+static ssize_t
+nxt_io_uring_conn_io_recv(nxt_conn_t *c, void *buf, size_t size,
+    nxt_uint_t flags)
+{
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &c->socket.task->thread->engine->u.io_uring;
+
+    if ((uint32_t) c->socket.fd < uring->nfds) {
+        slot = &uring->fds[c->socket.fd];
+
+        if (slot->conn == &c->socket
+            && (slot->recv_pending || nxt_io_uring_recv_ready(slot)))
+        {
+            return nxt_io_uring_conn_io_received(c, slot, buf, size, flags);
+        }
+    }
+
+    return nxt_conn_io_recv(c, buf, size, flags);
+}
+
+
+static ssize_t
+nxt_io_uring_conn_io_received(nxt_conn_t *c, nxt_io_uring_fd_t *slot,
+    void *buf, size_t size, nxt_uint_t flags)
+{
+    u_char                 *p;
+    nxt_err_t              err;
+    nxt_io_uring_engine_t  *uring;
+
+    if (slot->recv_data) {
+        uring = &c->socket.task->thread->engine->u.io_uring;
+
+        p = uring->bufs + slot->recv_buf * NXT_IO_URING_BUF_SIZE
+            + slot->recv_pos;
+
+        size = nxt_min(size, slot->recv_size - slot->recv_pos);
+
+        nxt_memcpy(buf, p, size);
+
+        nxt_debug(c->socket.task, "io_uring recv(%d, %p, %uz, 0x%ui)",
+                  c->socket.fd, buf, size, flags);
+
+        if ((flags & MSG_PEEK) == 0) {
+            slot->recv_pos += size;
+
+            if (slot->recv_pos == slot->recv_size) {
+                slot->recv_data = 0;
+                nxt_io_uring_buf_free(uring, slot->recv_buf);
+
+                c->socket.read_ready = 0;
+            }
+        }
+
+        return size;
+    }
+
+    if (slot->recv_eof) {
+        c->socket.closed = 1;
+
+        if ((flags & MSG_PEEK) == 0) {
+            c->socket.read_ready = 0;
+        }
+
+        return 0;
+    }
+
+    err = slot->recv_error;
+
+    if (err != 0) {
+        c->socket.error = err;
+        nxt_log(c->socket.task, nxt_socket_error_level(err),
+                "recv(%d) failed %E", c->socket.fd, err);
+
+        return NXT_ERROR;
+    }
+
+    /* A receive request is pending. */
+
+    c->socket.read_ready = 0;
+
+    return NXT_AGAIN;
+}
+
+
+/*
+ * nxt_io_uring_conn_io_write() submits a send request for memory buffers
+ * or linked splice requests for a file buffer, their completion is
+ * processed by nxt_io_uring_conn_io_sent() as nxt_conn_io_write() does
+ * after a sendbuf call.  Other buffers are written by nxt_conn_io_write().
+ */
+
+static void
+nxt_io_uring_conn_io_write(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_int_t            ret;
+    nxt_uint_t           niov;
+    nxt_conn_t           *c;
+    nxt_sendbuf_t        sb;
+    nxt_io_uring_fd_t    *slot;
+    nxt_io_uring_send_t  *send;
+    nxt_event_engine_t   *engine;
+
+    c = obj;
+
+    nxt_debug(task, "io_uring conn write fd:%d er:%d bl:%d",
+              c->socket.fd, c->socket.error, c->block_write);
+
+    engine = task->thread->engine;
+
+    if (!engine->u.io_uring.send) {
+        nxt_conn_io_write(task, c, data);
+        return;
+    }
+
+    slot = nxt_io_uring_conn(c);
+    if (nxt_slow_path(slot == NULL)) {
+        goto write;
+    }
+
+    send = slot->send;
+
+    if (send == NULL) {
+        send = nxt_zalloc(sizeof(nxt_io_uring_send_t));
+        if (nxt_slow_path(send == NULL)) {
+            goto write;
+        }
+
+        send->pipe[0] = -1;
+        send->pipe[1] = -1;
+
+        slot->send = send;
+    }
+
+    if (send->pending) {
+        /* The write is continued after the request completion. */
+        return;
+    }
+
+    if (c->socket.error != 0
+        || c->block_write
+        || !c->socket.write_ready
+        || c->write == NULL)
+    {
+        goto write;
+    }
+
+    if (send->piped != 0) {
+        ret = nxt_io_uring_splice(engine, c, slot, NULL);
+
+    } else {
+        sb.buf = c->write;
+        sb.size = 0;
+        sb.limit = 10 * 1024 * 1024;
+        sb.sync = 0;
+        sb.last = 0;
+
+        niov = nxt_sendbuf_mem_coalesce0(task, &sb, send->iov, NXT_IOBUF_MAX);
+
+        if (niov != 0) {
+            ret = nxt_io_uring_sendmsg(engine, c, slot, niov);
+
+        } else if (!sb.sync && sb.buf != NULL && nxt_buf_is_file(sb.buf)) {
+            ret = nxt_io_uring_splice(engine, c, slot, sb.buf);
+
+        } else {
+            ret = NXT_DECLINED;
+        }
+    }
+
+    if (ret == NXT_OK) {
+        c->socket.write_handler = nxt_io_uring_conn_io_write;
+        c->socket.error_handler = c->write_state->error_handler;
+
+        send->conn = c;
+        return;
+    }
+
+write:
+
+    nxt_conn_io_write(task, c, data);
+
+    if (c->socket.write_handler == nxt_conn_io_write) {
+        c->socket.write_handler = nxt_io_uring_conn_io_write;
+    }
+}
+
+
+static nxt_int_t
+nxt_io_uring_sendmsg(nxt_event_engine_t *engine, nxt_conn_t *c,
+    nxt_io_uring_fd_t *slot, nxt_uint_t niov)
+{
+    nxt_io_uring_send_t  *send;
+    struct io_uring_sqe  *sqe;
+
+    send = slot->send;
+
+    sqe = nxt_io_uring_sqe(engine);
+    if (nxt_slow_path(sqe == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_debug(c->socket.task, "io_uring sendmsg(%d, %ui)",
+              c->socket.fd, niov);
+
+    nxt_memzero(&send->msg, sizeof(struct msghdr));
+
+    send->msg.msg_iov = send->iov;
+    send->msg.msg_iovlen = niov;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = c->socket.fd;
+    sqe->addr = (uintptr_t) &send->msg;
+    sqe->len = 1;
+    /* A full socket is polled under the write timer. */
+    sqe->msg_flags = MSG_DONTWAIT;
+    sqe->user_data = nxt_io_uring_data(NXT_IO_URING_SEND, slot->conn_seq,
+                                       c->socket.fd);
+
+    send->pending = 1;
+    send->splice = 0;
+
+    return NXT_OK;
+}
+
+
+/*
+ * A file buffer part is spliced to the connection pipe and then from
+ * the pipe to the socket by a linked request.  If the first splice is
+ * short, the link is broken and the piped part is sent by the next
+ * splice request without a file buffer.
+ */
+
+static nxt_int_t
+nxt_io_uring_splice(nxt_event_engine_t *engine, nxt_conn_t *c,
+    nxt_io_uring_fd_t *slot, nxt_buf_t *b)
+{
+    size_t               size;
+    nxt_io_uring_send_t  *send;
+    struct io_uring_sqe  *sqe;
+
+    send = slot->send;
+    size = send->piped;
+
+    if (b != NULL) {
+
+        if (send->pipe[0] == -1
+            && nxt_pipe_create(c->socket.task, send->pipe, 0, 0) != NXT_OK)
+        {
+            return NXT_ERROR;
+        }
+
+        sqe = nxt_io_uring_sqe(engine);
+        if (nxt_slow_path(sqe == NULL)) {
+            return NXT_ERROR;
+        }
+
+        size = nxt_min(b->file_end - b->file_pos, NXT_IO_URING_SPLICE_SIZE);
+
+        nxt_debug(c->socket.task, "io_uring splice(%FD, %FD, @%O, %uz)",
+                  b->file->fd, send->pipe[1], b->file_pos, size);
+
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->fd = send->pipe[1];
+        sqe->off = (uint64_t) -1;
+        sqe->splice_fd_in = b->file->fd;
+        sqe->splice_off_in = b->file_pos;
+        sqe->len = size;
+        sqe->user_data = nxt_io_uring_data(NXT_IO_URING_SPLICE,
+                                           slot->conn_seq, c->socket.fd);
+
+        send->pending = 1;
+    }
+
+    sqe = nxt_io_uring_sqe(engine);
+    if (nxt_slow_path(sqe == NULL)) {
+        /* The file part is sent after the first splice completion. */
+        return (b != NULL) ? NXT_OK : NXT_ERROR;
+    }
+
+    nxt_debug(c->socket.task, "io_uring splice(%FD, %d, %uz)",
+              send->pipe[0], c->socket.fd, size);
+
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->fd = c->socket.fd;
+    sqe->off = (uint64_t) -1;
+    sqe->splice_fd_in = send->pipe[0];
+    sqe->splice_off_in = (uint64_t) -1;
+    sqe->splice_flags = SPLICE_F_NONBLOCK;
+    sqe->len = size;
+    sqe->user_data = nxt_io_uring_data(NXT_IO_URING_SEND, slot->conn_seq,
+                                       c->socket.fd);
+
+    send->pending++;
+    send->splice = 1;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_io_uring_sent(nxt_event_engine_t *engine, struct io_uring_cqe *cqe)
+{
+    int                    res;
+    uint64_t               data;
+    nxt_fd_t               fd;
+    nxt_task_t             *task;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_send_t    *send;
+    nxt_io_uring_engine_t  *uring;
+
+    uring = &engine->u.io_uring;
+
+    data = cqe->user_data;
+    res = cqe->res;
+    fd = nxt_io_uring_data_fd(data);
+
+    slot = ((uint32_t) fd < uring->nfds) ? &uring->fds[fd] : NULL;
+    send = (slot != NULL) ? slot->send : NULL;
+
+    if (send == NULL
+        || send->pending == 0
+        || slot->conn_seq != nxt_io_uring_data_seq(data))
+    {
+        /* The connection has been closed. */
+        return;
+    }
+
+    task = send->conn->socket.task;
+
+    nxt_debug(task, "io_uring %s(%d): %d",
+              nxt_io_uring_data_type(data) == NXT_IO_URING_SPLICE
+              ? "file splice" : "send", fd, res);
+
+    if (nxt_io_uring_data_type(data) == NXT_IO_URING_SPLICE) {
+
+        if (res > 0) {
+            send->piped += res;
+
+        } else if (res == 0) {
+            nxt_alert(task, "splice(%d) reported that file was truncated",
+                      fd);
+            send->error = NXT_EINVAL;
+
+        } else {
+            send->error = -res;
+            nxt_log(task, nxt_socket_error_level(-res),
+                    "splice(%d) failed %E", fd, -res);
+        }
+
+    } else if (send->poll) {
+        send->poll = 0;
+
+        if (res < 0) {
+            send->error = -res;
+            nxt_log(task, nxt_socket_error_level(-res),
+                    "poll(%d) failed %E", fd, -res);
+        }
+
+    } else if (res > 0) {
+        send->sent = res;
+
+        if (send->splice) {
+            send->piped -= res;
+        }
+
+    } else if (res == -NXT_EAGAIN) {
+        send->again = 1;
+
+    } else if (res < 0 && res != -NXT_ECANCELED) {
+        send->error = -res;
+        nxt_log(task, nxt_socket_error_level(-res),
+                "%s(%d) failed %E", send->splice ? "splice" : "sendmsg",
+                fd, -res);
+    }
+
+    /* -NXT_ECANCELED: the link has been broken by a short file splice. */
+
+    if (--send->pending == 0) {
+        nxt_io_uring_conn_io_sent(engine, send);
+    }
+}
+
+
+static void
+nxt_io_uring_conn_io_sent(nxt_event_engine_t *engine,
+    nxt_io_uring_send_t *send)
+{
+    size_t               sent;
+    nxt_buf_t            *b;
+    nxt_err_t            err;
+    nxt_bool_t           again;
+    nxt_conn_t           *c;
+    struct io_uring_sqe  *sqe;
+
+    c = send->conn;
+
+    sent = send->sent;
+    err = send->error;
+    again = send->again;
+
+    send->sent = 0;
+    send->error = 0;
+    send->again = 0;
+
+    nxt_debug(c->socket.task, "io_uring conn sent fd:%d %uz er:%d",
+              c->socket.fd, sent, err);
+
+    if (c->write == NULL) {
+        /* See the comment in nxt_conn_close(). */
+        return;
+    }
+
+    if (sent != 0) {
+        /* An error is handled on the next nxt_conn_write() call. */
+        c->socket.error = err;
+        c->sent += sent;
+
+        if (c->write_state->timer_autoreset) {
+            nxt_timer_disable(engine, &c->write_timer);
+        }
+
+        b = nxt_sendbuf_update(c->write, sent);
+
+        if (b == NULL) {
+            nxt_fd_event_block_write(engine, &c->socket);
+        }
+
+        nxt_work_queue_add(c->write_work_queue, c->write_state->ready_handler,
+                           c->socket.task, c, c->socket.data);
+        return;
+    }
+
+    if (err != 0) {
+        c->socket.error = err;
+
+        nxt_fd_event_block_write(engine, &c->socket);
+
+        nxt_work_queue_add(c->write_work_queue, c->write_state->error_handler,
+                           c->socket.task, c, c->socket.data);
+        return;
+    }
+
+    if (again) {
+        nxt_conn_timer(engine, c, c->write_state, &c->write_timer);
+
+        sqe = nxt_io_uring_sqe(engine);
+
+        if (nxt_fast_path(sqe != NULL)) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = c->socket.fd;
+            sqe->poll32_events = POLLOUT;
+            sqe->user_data = nxt_io_uring_data(NXT_IO_URING_SEND,
+                      engine->u.io_uring.fds[c->socket.fd].conn_seq,
+                      c->socket.fd);
+
+            send->pending = 1;
+            send->poll = 1;
+            return;
+        }
+
+        c->socket.write_ready = 0;
+
+        if (nxt_fd_event_is_disabled(c->socket.write)) {
+            nxt_fd_event_enable_write(engine, &c->socket);
+        }
+
+        return;
+    }
+
+    /* The piped file part or the rest of buffers are sent now. */
+
+    nxt_work_queue_add(c->write_work_queue, nxt_io_uring_conn_io_write,
+                       c->socket.task, c, c->socket.data);
+}
@@ -8,6 +8,7 @@
 
 
 nxt_uint_t    nxt_ncpu = 1;
+nxt_uint_t    nxt_cpu_features;
 nxt_uint_t    nxt_pagesize;
 nxt_task_t    nxt_main_task;
 nxt_atomic_t  nxt_task_ident;
@@ -121,6 +122,24 @@ nxt_lib_start(const char *app, char **argv, char ***envp)
         nxt_ncpu = n;
     }
 
+#if (NXT_HAVE_SSE2)
+    nxt_cpu_features |= NXT_CPU_SSE2;
+#endif
+
+#if (NXT_HAVE_AVX2)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        nxt_cpu_features |= NXT_CPU_AVX2;
+    }
+#endif
+
+#if (NXT_HAVE_NEON)
+    nxt_cpu_features |= NXT_CPU_NEON;
+#endif
+
+    nxt_debug(&nxt_main_task, "cpu features: 0x%04uxi", nxt_cpu_features);
+
     nxt_thread_spin_init(nxt_ncpu, 0);
 
     nxt_random_init(&thread->random);
@@ -18,6 +18,10 @@ typedef struct {
 
     nxt_sockaddr_t            *sockaddr;
 
+    /* SO_REUSEPORT sockets, one per router engine. */
+    nxt_socket_t              *sockets;
+    uint32_t                  nsockets;
+
     uint32_t                  count;
 
     uint8_t                   flags;
@@ -163,7 +163,14 @@ NXT_EXPORT nxt_int_t nxt_lib_start(const char *app, char **argv, char ***envp);
 NXT_EXPORT void nxt_lib_stop(void);
 
 
+/* The nxt_cpu_features bits. */
+#define NXT_CPU_SSE2    0x0001
+#define NXT_CPU_AVX2    0x0002
+#define NXT_CPU_NEON    0x0004
+
+
 NXT_EXPORT extern nxt_uint_t    nxt_ncpu;
+NXT_EXPORT extern nxt_uint_t    nxt_cpu_features;
 NXT_EXPORT extern nxt_uint_t    nxt_pagesize;
 NXT_EXPORT extern nxt_task_t    nxt_main_task;
 NXT_EXPORT extern nxt_atomic_t  nxt_task_ident;
@@ -26,6 +26,7 @@ typedef struct {
     nxt_socket_error_t  error;
     u_char              *start;
     u_char              *end;
+    uint8_t             reuseport;  /* 1 bit */
 } nxt_listening_socket_t;
 
 
@@ -159,6 +160,36 @@ static nxt_conf_map_t  nxt_common_app_conf[] = {
         offsetof(nxt_common_app_conf_t, limits),
     },
 
+    {
+        nxt_string("cpus"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_common_app_conf_t, cpus),
+    },
+
+    {
+        nxt_string("numa_node"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_common_app_conf_t, numa_node),
+    },
+
+    {
+        nxt_string("shm_segment_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_common_app_conf_t, shm_segment_size),
+    },
+
+    {
+        nxt_string("shm_huge_pages"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_common_app_conf_t, shm_huge_pages),
+    },
+
+    {
+        nxt_string("spin_wait"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_common_app_conf_t, spin_wait),
+    },
+
 };
 
 
@@ -522,6 +553,7 @@ nxt_main_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
     app_conf->shm_limit = 100 * 1024 * 1024;
     app_conf->request_limit = 0;
+    app_conf->numa_node = -1;
 
     start += app_conf->name.length + 1;
 
@@ -1141,6 +1173,12 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     ls.start = message;
     ls.end = message + sizeof(message);
 
+    /* A router appends the SO_REUSEPORT flag to the socket address. */
+
+    size = nxt_sockaddr_size(sa);
+    ls.reuseport = ((size_t) nxt_buf_mem_used_size(&b->mem) > size
+                    && b->mem.pos[size] != 0);
+
     nxt_debug(task, "listening socket \"%*s\"",
               (size_t) sa->length, nxt_sockaddr_start(sa));
 
@@ -1212,6 +1250,20 @@ nxt_main_listening_socket(nxt_sockaddr_t *sa, nxt_listening_socket_t *ls)
         goto fail;
     }
 
+#ifdef SO_REUSEPORT
+
+    if (ls->reuseport
+        && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &enable, length) != 0)
+    {
+        ls->end = nxt_sprintf(ls->start, ls->end,
+                              "setsockopt(\\\"%*s\\\", SO_REUSEPORT) failed %E",
+                              (size_t) sa->length, nxt_sockaddr_start(sa),
+                              nxt_errno);
+        goto fail;
+    }
+
+#endif
+
 #if (NXT_INET6)
 
     if (sa->u.sockaddr.sa_family == AF_INET6) {
@@ -16,6 +16,9 @@
 #include <openssl/x509v3.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
+#if (NXT_HAVE_OPENSSL_OCSP)
+#include <openssl/ocsp.h>
+#endif
 
 
 typedef struct {
@@ -45,6 +48,81 @@ struct nxt_tls_tickets_s {
 };
 
 
+/*
+ * The session cache is kept outside of SSL_CTX per listener, so all router
+ * threads share it and it outlives SSL_CTX recreated on reconfiguration.
+ */
+
+typedef struct {
+    nxt_queue_link_t       link;
+    nxt_str_t              name;
+    uint32_t               count;
+
+    nxt_thread_spinlock_t  lock;
+    nxt_lvlhsh_t           hash;
+    nxt_queue_t            lru;
+    uint32_t               entries;
+    uint32_t               max_entries;
+    nxt_time_t             timeout;
+
+    /* Random session ticket keys for the "tickets": true option. */
+    nxt_tls_tickets_t      *tickets;
+} nxt_openssl_session_cache_t;
+
+
+typedef struct {
+    nxt_queue_link_t       link;
+    nxt_time_t             expire;
+    uint32_t               key_hash;
+    nxt_str_t              id;
+    size_t                 size;
+    u_char                 data[];
+} nxt_openssl_session_t;
+
+
+#define NXT_OPENSSL_SESSION_MAX_SIZE  4096
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+/*
+ * An OCSP response is shared by all SSL_CTX with the same certificate.
+ * It is fetched from the responder in a thread pool and refreshed
+ * in background before it expires.
+ */
+
+typedef struct {
+    nxt_queue_link_t       link;
+    uint32_t               count;
+
+    u_char                 digest[EVP_MAX_MD_SIZE];
+    unsigned int           digest_size;
+
+    X509                   *cert;
+    X509                   *issuer;
+    OCSP_CERTID            *id;
+
+    nxt_thread_spinlock_t  lock;
+    char                   *responder;
+    u_char                 *response;
+    size_t                 size;
+    nxt_time_t             valid;
+    nxt_time_t             refresh;
+    uint8_t                fetching;  /* 1 bit */
+
+    nxt_task_t             task;
+    nxt_work_t             work;
+} nxt_openssl_staple_t;
+
+
+#define NXT_OPENSSL_OCSP_TIMEOUT   10
+#define NXT_OPENSSL_OCSP_MAX_SIZE  16384
+#define NXT_OPENSSL_OCSP_RETRY     300
+#define NXT_OPENSSL_OCSP_REFRESH   3600
+
+#endif
+
+
 typedef enum {
     NXT_OPENSSL_HANDSHAKE = 0,
     NXT_OPENSSL_READ,
@@ -75,8 +153,43 @@ static nxt_int_t nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx,
 static int nxt_tls_ticket_key_callback(SSL *s, unsigned char *name,
     unsigned char *iv, EVP_CIPHER_CTX *ectx, HMAC_CTX *hctx, int enc);
 #endif
-static void nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size,
-    time_t timeout);
+static nxt_int_t nxt_ssl_session_cache(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_init_t *tls_init);
+static nxt_openssl_session_cache_t *nxt_openssl_session_cache_get(
+    nxt_tls_init_t *tls_init);
+static void nxt_openssl_session_cache_release(
+    nxt_openssl_session_cache_t *cache);
+static nxt_tls_tickets_t *nxt_openssl_session_tickets(nxt_task_t *task,
+    nxt_openssl_session_cache_t *cache);
+static int nxt_openssl_session_new(SSL *s, SSL_SESSION *sess);
+static SSL_SESSION *nxt_openssl_session_get(SSL *s,
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+    const
+#endif
+    u_char *id, int len, int *copy);
+static void nxt_openssl_session_remove(SSL_CTX *ctx, SSL_SESSION *sess);
+static void nxt_openssl_session_delete(nxt_openssl_session_cache_t *cache,
+    nxt_openssl_session_t *session);
+static nxt_int_t nxt_openssl_session_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_openssl_stapling(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_init_t *tls_init);
+static nxt_openssl_staple_t *nxt_openssl_staple_get(nxt_task_t *task,
+    X509 *cert, X509 *issuer, nxt_str_t *responder);
+static void nxt_openssl_staple_release(nxt_openssl_staple_t *staple);
+static int nxt_openssl_staple_callback(SSL *s, void *arg);
+static void nxt_openssl_staple_update(nxt_task_t *task,
+    nxt_openssl_staple_t *staple);
+static void nxt_openssl_staple_fetch(nxt_task_t *task, void *obj, void *data);
+static OCSP_RESPONSE *nxt_openssl_ocsp_request(nxt_task_t *task,
+    nxt_openssl_staple_t *staple, char *url);
+static nxt_socket_t nxt_openssl_ocsp_connect(nxt_task_t *task, char *host,
+    char *port);
+static nxt_int_t nxt_openssl_ocsp_verify(nxt_task_t *task,
+    nxt_openssl_staple_t *staple, OCSP_RESPONSE *resp, nxt_time_t *valid);
+#endif
+static void nxt_openssl_ctx_free(SSL_CTX *ctx);
 static nxt_uint_t nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert,
     nxt_tls_conf_t *conf, nxt_mp_t *mp);
 static nxt_int_t nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq,
@@ -84,6 +197,11 @@ static nxt_int_t nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq,
 static nxt_int_t nxt_openssl_bundle_hash_insert(nxt_task_t *task,
     nxt_lvlhsh_t *lvlhsh, nxt_tls_bundle_hash_item_t *item, nxt_mp_t * mp);
 static nxt_int_t nxt_openssl_servername(SSL *s, int *ad, void *arg);
+#if (NXT_HAVE_OPENSSL_ALPN)
+static int nxt_openssl_alpn_select(SSL *s, const unsigned char **out,
+    unsigned char *outlen, const unsigned char *in, unsigned int inlen,
+    void *arg);
+#endif
 static nxt_tls_bundle_conf_t *nxt_openssl_find_ctx(nxt_tls_conf_t *conf,
     nxt_str_t *sn);
 static void nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf);
@@ -94,6 +212,10 @@ static ssize_t nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b);
 static ssize_t nxt_openssl_conn_io_sendbuf(nxt_task_t *task, nxt_sendbuf_t *sb);
 static ssize_t nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb,
     void *buf, size_t size);
+#if (NXT_HAVE_OPENSSL_KTLS)
+static ssize_t nxt_openssl_conn_io_sendfile(nxt_task_t *task,
+    nxt_sendbuf_t *sb);
+#endif
 static void nxt_openssl_conn_io_shutdown(nxt_task_t *task, void *obj,
     void *data);
 static nxt_int_t nxt_openssl_conn_test_error(nxt_task_t *task, nxt_conn_t *c,
@@ -127,6 +249,25 @@ static nxt_conn_io_t  nxt_openssl_conn_io = {
 
 static long  nxt_openssl_version;
 static int   nxt_openssl_connection_index;
+static int   nxt_openssl_session_cache_index;
+#if (NXT_HAVE_OPENSSL_OCSP)
+static int   nxt_openssl_staple_index;
+#endif
+
+/* Protects the lists below and reference counts of their items. */
+static nxt_thread_spinlock_t  nxt_openssl_shared_lock;
+static nxt_queue_t            nxt_openssl_session_caches;
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_queue_t            nxt_openssl_staples;
+#endif
+
+
+static const nxt_lvlhsh_proto_t  nxt_openssl_session_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_openssl_session_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
 
 
 static nxt_int_t
@@ -198,6 +339,34 @@ nxt_openssl_library_init(nxt_task_t *task)
 
     nxt_openssl_connection_index = index;
 
+    index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+    if (index == -1) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_get_ex_new_index() failed");
+        return NXT_ERROR;
+    }
+
+    nxt_openssl_session_cache_index = index;
+
+    nxt_queue_init(&nxt_openssl_session_caches);
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+    index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+    if (index == -1) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_get_ex_new_index() failed");
+        return NXT_ERROR;
+    }
+
+    nxt_openssl_staple_index = index;
+
+    nxt_queue_init(&nxt_openssl_staples);
+
+#endif
+
     return NXT_OK;
 }
 
@@ -331,6 +500,16 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
 #endif
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+    if (tls_init->ktls) {
+        /*
+         * OpenSSL silently keeps encrypting in userspace if the kernel
+         * does not support TLS offload for the negotiated cipher.
+         */
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
 #ifdef SSL_MODE_RELEASE_BUFFERS
 
     if (nxt_openssl_version >= 10001078) {
@@ -378,7 +557,16 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     }
 #endif
 
-    nxt_ssl_session_cache(ctx, tls_init->cache_size, tls_init->timeout);
+    if (nxt_ssl_session_cache(task, ctx, tls_init) != NXT_OK) {
+        goto fail;
+    }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (tls_init->stapling && nxt_openssl_stapling(task, ctx, tls_init) != NXT_OK)
+    {
+        goto fail;
+    }
+#endif
 
 #if (NXT_HAVE_OPENSSL_TLSEXT)
     if (nxt_tls_ticket_keys(task, ctx, tls_init, mp) != NXT_OK) {
@@ -388,6 +576,12 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
     SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
 
+#if (NXT_HAVE_OPENSSL_ALPN)
+    if (conf->http2) {
+        SSL_CTX_set_alpn_select_cb(ctx, nxt_openssl_alpn_select, NULL);
+    }
+#endif
+
     if (conf->ca_certificate != NULL) {
 
         /* TODO: verify callback */
@@ -435,7 +629,7 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
 fail:
 
-    SSL_CTX_free(ctx);
+    nxt_openssl_ctx_free(ctx);
 
 #if (OPENSSL_VERSION_NUMBER >= 0x1010100fL \
      && OPENSSL_VERSION_NUMBER < 0x1010101fL)
@@ -638,6 +832,8 @@ nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init,
     nxt_tls_tickets_t  *tickets;
     u_char             buf[80];
 
+    nxt_openssl_session_cache_t  *cache;
+
     tickets_conf = tls_init->tickets_conf;
 
     if (tickets_conf == NULL) {
@@ -649,6 +845,23 @@ nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init,
             goto no_ticket;
         }
 
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
+
+        cache = SSL_CTX_get_ex_data(ctx, nxt_openssl_session_cache_index);
+
+        if (cache != NULL) {
+            tickets = nxt_openssl_session_tickets(task, cache);
+            if (nxt_slow_path(tickets == NULL)) {
+                return NXT_ERROR;
+            }
+
+            tls_init->conf->tickets = tickets;
+
+            goto callback;
+        }
+
+#endif
+
         return NXT_OK;
     }
 
@@ -699,6 +912,8 @@ nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init,
 
     } while (i < count);
 
+callback:
+
     if (SSL_CTX_set_tlsext_ticket_key_cb(ctx, nxt_tls_ticket_key_callback)
         == 0)
     {
@@ -829,182 +1044,1296 @@ nxt_tls_ticket_key_callback(SSL *s, unsigned char *name, unsigned char *iv,
 #endif /* NXT_HAVE_OPENSSL_TLSEXT */
 
 
-static void
-nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size, time_t timeout)
+static nxt_int_t
+nxt_ssl_session_cache(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init)
 {
-    if (cache_size == 0) {
+    nxt_bool_t                   tickets;
+    nxt_conf_value_t             *value;
+    nxt_openssl_session_cache_t  *cache;
+
+    value = tls_init->tickets_conf;
+
+    tickets = (value != NULL && nxt_conf_type(value) == NXT_CONF_BOOLEAN
+               && nxt_conf_get_boolean(value));
+
+    if (tls_init->cache_size == 0 && !tickets) {
         SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
-        return;
+        return NXT_OK;
     }
 
-    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
-
-    SSL_CTX_sess_set_cache_size(ctx, cache_size);
+    cache = nxt_openssl_session_cache_get(tls_init);
+    if (nxt_slow_path(cache == NULL)) {
+        return NXT_ERROR;
+    }
 
-    SSL_CTX_set_timeout(ctx, (long) timeout);
-}
+    if (SSL_CTX_set_ex_data(ctx, nxt_openssl_session_cache_index, cache) == 0)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_set_ex_data() failed");
 
+        nxt_openssl_session_cache_release(cache);
 
-static nxt_uint_t
-nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert, nxt_tls_conf_t *conf,
-    nxt_mp_t *mp)
-{
-    int                         len;
-    nxt_str_t                   domain, str;
-    X509_NAME                   *x509_name;
-    nxt_uint_t                  i, n;
-    GENERAL_NAME                *name;
-    nxt_tls_bundle_conf_t       *bundle;
-    STACK_OF(GENERAL_NAME)      *alt_names;
-    nxt_tls_bundle_hash_item_t  *item;
+        return NXT_ERROR;
+    }
 
-    bundle = conf->bundle;
+    if (SSL_CTX_set_session_id_context(ctx, tls_init->name.start,
+                                       nxt_min(tls_init->name.length,
+                                               SSL_MAX_SID_CTX_LENGTH))
+        == 0)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_set_session_id_context() failed");
+        return NXT_ERROR;
+    }
 
-    alt_names = X509_get_ext_d2i(cert, NID_subject_alt_name, NULL, NULL);
+    if (tls_init->cache_size == 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        return NXT_OK;
+    }
 
-    if (alt_names != NULL) {
-        n = sk_GENERAL_NAME_num(alt_names);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER
+                                        | SSL_SESS_CACHE_NO_INTERNAL);
 
-        for (i = 0; i != n; i++) {
-            name = sk_GENERAL_NAME_value(alt_names, i);
+    SSL_CTX_set_timeout(ctx, (long) tls_init->timeout);
 
-            if (name->type != GEN_DNS) {
-                continue;
-            }
+    SSL_CTX_sess_set_new_cb(ctx, nxt_openssl_session_new);
+    SSL_CTX_sess_set_get_cb(ctx, nxt_openssl_session_get);
+    SSL_CTX_sess_set_remove_cb(ctx, nxt_openssl_session_remove);
 
-            str.length = ASN1_STRING_length(name->d.dNSName);
-#if OPENSSL_VERSION_NUMBER > 0x10100000L
-            str.start = (u_char *) ASN1_STRING_get0_data(name->d.dNSName);
-#else
-            str.start = ASN1_STRING_data(name->d.dNSName);
-#endif
+    return NXT_OK;
+}
 
-            domain.start = nxt_mp_nget(mp, str.length);
-            if (nxt_slow_path(domain.start == NULL)) {
-                goto fail;
-            }
 
-            domain.length = str.length;
-            nxt_memcpy_lowcase(domain.start, str.start, str.length);
+static nxt_openssl_session_cache_t *
+nxt_openssl_session_cache_get(nxt_tls_init_t *tls_init)
+{
+    nxt_queue_link_t             *lnk;
+    nxt_openssl_session_cache_t  *cache;
 
-            item = nxt_mp_get(mp, sizeof(nxt_tls_bundle_hash_item_t));
-            if (nxt_slow_path(item == NULL)) {
-                goto fail;
-            }
+    nxt_thread_spin_lock(&nxt_openssl_shared_lock);
 
-            item->name = domain;
-            item->bundle = bundle;
+    for (lnk = nxt_queue_first(&nxt_openssl_session_caches);
+         lnk != nxt_queue_tail(&nxt_openssl_session_caches);
+         lnk = nxt_queue_next(lnk))
+    {
+        cache = nxt_queue_link_data(lnk, nxt_openssl_session_cache_t, link);
 
-            if (nxt_openssl_bundle_hash_insert(task, &conf->bundle_hash,
-                                               item, mp)
-                == NXT_ERROR)
-            {
-                goto fail;
-            }
+        if (nxt_strstr_eq(&cache->name, &tls_init->name)) {
+            goto found;
         }
+    }
 
-        sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
+    cache = nxt_zalloc(sizeof(nxt_openssl_session_cache_t)
+                       + tls_init->name.length);
+    if (nxt_slow_path(cache == NULL)) {
+        nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+        return NULL;
+    }
 
-    } else {
-        x509_name = X509_get_subject_name(cert);
-        len = X509_NAME_get_text_by_NID(x509_name, NID_commonName,
-                                        NULL, 0);
-        if (len <= 0) {
-            nxt_log(task, NXT_LOG_WARN, "certificate \"%V\" has neither "
-                    "Subject Alternative Name nor Common Name", &bundle->name);
-            return NXT_OK;
-        }
+    cache->name.length = tls_init->name.length;
+    cache->name.start = nxt_pointer_to(cache,
+                                       sizeof(nxt_openssl_session_cache_t));
+    nxt_memcpy(cache->name.start, tls_init->name.start, cache->name.length);
 
-        domain.start = nxt_mp_nget(mp, len + 1);
-        if (nxt_slow_path(domain.start == NULL)) {
-            return NXT_ERROR;
-        }
+    nxt_queue_init(&cache->lru);
 
-        domain.length = X509_NAME_get_text_by_NID(x509_name, NID_commonName,
-                                                  (char *) domain.start,
-                                                  len + 1);
-        nxt_memcpy_lowcase(domain.start, domain.start, domain.length);
+    nxt_queue_insert_tail(&nxt_openssl_session_caches, &cache->link);
 
-        item = nxt_mp_get(mp, sizeof(nxt_tls_bundle_hash_item_t));
-        if (nxt_slow_path(item == NULL)) {
-            return NXT_ERROR;
-        }
+found:
 
-        item->name = domain;
-        item->bundle = bundle;
+    cache->count++;
 
-        if (nxt_openssl_bundle_hash_insert(task, &conf->bundle_hash, item,
-                                           mp)
-            == NXT_ERROR)
-        {
-            return NXT_ERROR;
-        }
-    }
+    nxt_thread_spin_lock(&cache->lock);
 
-    return NXT_OK;
+    cache->max_entries = tls_init->cache_size;
+    cache->timeout = tls_init->timeout;
 
-fail:
+    nxt_thread_spin_unlock(&cache->lock);
 
-    sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
 
-    return NXT_ERROR;
+    return cache;
 }
 
 
-static const nxt_lvlhsh_proto_t  nxt_openssl_bundle_hash_proto
-    nxt_aligned(64) =
+static void
+nxt_openssl_session_cache_release(nxt_openssl_session_cache_t *cache)
 {
-    NXT_LVLHSH_DEFAULT,
-    nxt_openssl_bundle_hash_test,
-    nxt_mp_lvlhsh_alloc,
-    nxt_mp_lvlhsh_free,
-};
+    nxt_queue_link_t       *lnk;
+    nxt_openssl_session_t  *session;
 
+    nxt_thread_spin_lock(&nxt_openssl_shared_lock);
 
-static nxt_int_t
-nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq, void *data)
-{
-    nxt_tls_bundle_hash_item_t  *item;
+    if (--cache->count != 0) {
+        nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+        return;
+    }
 
-    item = data;
+    nxt_queue_remove(&cache->link);
 
-    return nxt_strstr_eq(&lhq->key, &item->name) ? NXT_OK : NXT_DECLINED;
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+
+    while (!nxt_queue_is_empty(&cache->lru)) {
+        lnk = nxt_queue_first(&cache->lru);
+        session = nxt_queue_link_data(lnk, nxt_openssl_session_t, link);
+
+        nxt_openssl_session_delete(cache, session);
+    }
+
+    if (cache->tickets != NULL) {
+        nxt_memzero(cache->tickets->tickets, sizeof(nxt_tls_ticket_t));
+        nxt_free(cache->tickets);
+    }
+
+    nxt_free(cache);
 }
 
 
-static nxt_int_t
-nxt_openssl_bundle_hash_insert(nxt_task_t *task, nxt_lvlhsh_t *lvlhsh,
-    nxt_tls_bundle_hash_item_t *item, nxt_mp_t *mp)
+static nxt_tls_tickets_t *
+nxt_openssl_session_tickets(nxt_task_t *task,
+    nxt_openssl_session_cache_t *cache)
 {
-    nxt_str_t                   str;
-    nxt_int_t                   ret;
-    nxt_lvlhsh_query_t          lhq;
-    nxt_tls_bundle_hash_item_t  *old;
+    nxt_tls_ticket_t   *ticket;
+    nxt_tls_tickets_t  *tickets;
 
-    str = item->name;
+    if (cache->tickets != NULL) {
+        return cache->tickets;
+    }
 
-    if (item->name.start[0] == '*') {
-        item->name.start++;
-        item->name.length--;
+    tickets = nxt_malloc(sizeof(nxt_tls_tickets_t) + sizeof(nxt_tls_ticket_t));
+    if (nxt_slow_path(tickets == NULL)) {
+        return NULL;
+    }
 
-        if (item->name.length == 0 || item->name.start[0] != '.') {
-            nxt_log(task, NXT_LOG_WARN, "ignored invalid name \"%V\" "
-                    "in certificate \"%V\": missing \".\" "
-                    "after wildcard symbol", &str, &item->bundle->name);
-            return NXT_OK;
-        }
+    tickets->count = 1;
+    ticket = &tickets->tickets[0];
+
+    if (RAND_bytes(ticket->name, 16) != 1
+        || RAND_bytes(ticket->hmac_key, 32) != 1
+        || RAND_bytes(ticket->aes_key, 32) != 1)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "RAND_bytes() failed");
+        nxt_free(tickets);
+        return NULL;
     }
 
-    lhq.pool = mp;
-    lhq.key = item->name;
-    lhq.value = item;
-    lhq.proto = &nxt_openssl_bundle_hash_proto;
-    lhq.replace = 0;
-    lhq.key_hash = nxt_murmur_hash2(item->name.start, item->name.length);
+    ticket->size = 32;
 
-    ret = nxt_lvlhsh_insert(lvlhsh, &lhq);
-    if (nxt_fast_path(ret == NXT_OK)) {
-        nxt_debug(task, "name \"%V\" for certificate \"%V\" is inserted",
+    /* Listener configurations are created in the router main thread. */
+    cache->tickets = tickets;
+
+    return tickets;
+}
+
+
+static int
+nxt_openssl_session_new(SSL *s, SSL_SESSION *sess)
+{
+    int                          size;
+    u_char                       *p;
+    nxt_time_t                   now;
+    unsigned int                 len;
+    nxt_queue_link_t             *lnk;
+    nxt_lvlhsh_query_t           lhq;
+    const unsigned char          *id;
+    nxt_openssl_session_t        *session;
+    nxt_openssl_session_cache_t  *cache;
+
+    cache = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(s),
+                                nxt_openssl_session_cache_index);
+    if (cache == NULL) {
+        return 0;
+    }
+
+    size = i2d_SSL_SESSION(sess, NULL);
+
+    if (size <= 0 || size > NXT_OPENSSL_SESSION_MAX_SIZE) {
+        return 0;
+    }
+
+    id = SSL_SESSION_get_id(sess, &len);
+
+    session = nxt_malloc(sizeof(nxt_openssl_session_t) + len + size);
+    if (nxt_slow_path(session == NULL)) {
+        return 0;
+    }
+
+    session->id.length = len;
+    session->id.start = session->data;
+    nxt_memcpy(session->id.start, id, len);
+
+    session->key_hash = nxt_murmur_hash2(id, len);
+    session->size = size;
+
+    p = session->data + len;
+    (void) i2d_SSL_SESSION(sess, &p);
+
+    now = nxt_thread_time(nxt_thread());
+
+    lhq.key = session->id;
+    lhq.key_hash = session->key_hash;
+    lhq.proto = &nxt_openssl_session_proto;
+    lhq.pool = NULL;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    if (cache->max_entries == 0) {
+        goto fail;
+    }
+
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) == NXT_OK) {
+        nxt_openssl_session_delete(cache, lhq.value);
+    }
+
+    while (cache->entries >= cache->max_entries) {
+        lnk = nxt_queue_last(&cache->lru);
+
+        nxt_openssl_session_delete(cache,
+                      nxt_queue_link_data(lnk, nxt_openssl_session_t, link));
+    }
+
+    session->expire = now + cache->timeout;
+
+    lhq.replace = 0;
+    lhq.value = session;
+
+    if (nxt_slow_path(nxt_lvlhsh_insert(&cache->hash, &lhq) != NXT_OK)) {
+        goto fail;
+    }
+
+    nxt_queue_insert_head(&cache->lru, &session->link);
+    cache->entries++;
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    return 0;
+
+fail:
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    nxt_free(session);
+
+    return 0;
+}
+
+
+static SSL_SESSION *
+nxt_openssl_session_get(SSL *s,
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+    const
+#endif
+    u_char *id, int len, int *copy)
+{
+    size_t                       size;
+    nxt_time_t                   now;
+    const u_char                 *p;
+    nxt_lvlhsh_query_t           lhq;
+    nxt_openssl_session_t        *session;
+    nxt_openssl_session_cache_t  *cache;
+    u_char                       buf[NXT_OPENSSL_SESSION_MAX_SIZE];
+
+    *copy = 0;
+
+    cache = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(s),
+                                nxt_openssl_session_cache_index);
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    lhq.key.length = len;
+    lhq.key.start = (u_char *) id;
+    lhq.key_hash = nxt_murmur_hash2(id, len);
+    lhq.proto = &nxt_openssl_session_proto;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) != NXT_OK) {
+        nxt_thread_spin_unlock(&cache->lock);
+        return NULL;
+    }
+
+    session = lhq.value;
+
+    if (session->expire <= now) {
+        nxt_openssl_session_delete(cache, session);
+
+        nxt_thread_spin_unlock(&cache->lock);
+        return NULL;
+    }
+
+    nxt_queue_remove(&session->link);
+    nxt_queue_insert_head(&cache->lru, &session->link);
+
+    size = session->size;
+    nxt_memcpy(buf, session->data + session->id.length, size);
+
+    nxt_thread_spin_unlock(&cache->lock);
+
+    p = buf;
+
+    return d2i_SSL_SESSION(NULL, &p, size);
+}
+
+
+static void
+nxt_openssl_session_remove(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    unsigned int                 len;
+    nxt_lvlhsh_query_t           lhq;
+    const unsigned char          *id;
+    nxt_openssl_session_cache_t  *cache;
+
+    cache = SSL_CTX_get_ex_data(ctx, nxt_openssl_session_cache_index);
+    if (cache == NULL) {
+        return;
+    }
+
+    id = SSL_SESSION_get_id(sess, &len);
+
+    lhq.key.length = len;
+    lhq.key.start = (u_char *) id;
+    lhq.key_hash = nxt_murmur_hash2(id, len);
+    lhq.proto = &nxt_openssl_session_proto;
+
+    nxt_thread_spin_lock(&cache->lock);
+
+    if (nxt_lvlhsh_find(&cache->hash, &lhq) == NXT_OK) {
+        nxt_openssl_session_delete(cache, lhq.value);
+    }
+
+    nxt_thread_spin_unlock(&cache->lock);
+}
+
+
+static void
+nxt_openssl_session_delete(nxt_openssl_session_cache_t *cache,
+    nxt_openssl_session_t *session)
+{
+    nxt_lvlhsh_query_t  lhq;
+
+    lhq.key = session->id;
+    lhq.key_hash = session->key_hash;
+    lhq.proto = &nxt_openssl_session_proto;
+    lhq.pool = NULL;
+
+    (void) nxt_lvlhsh_delete(&cache->hash, &lhq);
+
+    nxt_queue_remove(&session->link);
+    cache->entries--;
+
+    nxt_free(session);
+}
+
+
+static nxt_int_t
+nxt_openssl_session_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_openssl_session_t  *session;
+
+    session = data;
+
+    return nxt_strstr_eq(&lhq->key, &session->id) ? NXT_OK : NXT_DECLINED;
+}
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_int_t
+nxt_openssl_stapling(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init)
+{
+    int                       i, n;
+    X509                      *cert, *issuer;
+    nxt_str_t                 responder, *name;
+    STACK_OF(X509)            *chain;
+    nxt_openssl_staple_t      *staple;
+    STACK_OF(OPENSSL_STRING)  *aia;
+
+    name = &tls_init->conf->bundle->name;
+
+    cert = SSL_CTX_get0_certificate(ctx);
+    issuer = NULL;
+    chain = NULL;
+
+    (void) SSL_CTX_get0_chain_certs(ctx, &chain);
+
+    n = (chain != NULL) ? sk_X509_num(chain) : 0;
+
+    for (i = 0; i < n; i++) {
+        if (X509_check_issued(sk_X509_value(chain, i), cert) == X509_V_OK) {
+            issuer = sk_X509_value(chain, i);
+            break;
+        }
+    }
+
+    if (issuer == NULL) {
+        nxt_log(task, NXT_LOG_WARN, "OCSP stapling is disabled for \"%V\": "
+                "the bundle has no issuer certificate", name);
+        return NXT_OK;
+    }
+
+    aia = NULL;
+    responder = tls_init->responder;
+
+    if (responder.length == 0) {
+        aia = X509_get1_ocsp(cert);
+
+        if (aia == NULL || sk_OPENSSL_STRING_num(aia) == 0) {
+            nxt_log(task, NXT_LOG_WARN, "OCSP stapling is disabled for "
+                    "\"%V\": the certificate has no OCSP responder URL", name);
+
+            X509_email_free(aia);
+            return NXT_OK;
+        }
+
+        responder.start = (u_char *) sk_OPENSSL_STRING_value(aia, 0);
+        responder.length = nxt_strlen(responder.start);
+    }
+
+    staple = nxt_openssl_staple_get(task, cert, issuer, &responder);
+
+    X509_email_free(aia);
+
+    if (nxt_slow_path(staple == NULL)) {
+        return NXT_ERROR;
+    }
+
+    if (SSL_CTX_set_ex_data(ctx, nxt_openssl_staple_index, staple) == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_set_ex_data() failed");
+
+        nxt_openssl_staple_release(staple);
+
+        return NXT_ERROR;
+    }
+
+    SSL_CTX_set_tlsext_status_cb(ctx, nxt_openssl_staple_callback);
+
+    nxt_openssl_staple_update(task, staple);
+
+    return NXT_OK;
+}
+
+
+static nxt_openssl_staple_t *
+nxt_openssl_staple_get(nxt_task_t *task, X509 *cert, X509 *issuer,
+    nxt_str_t *responder)
+{
+    char                  *url, *old;
+    u_char                digest[EVP_MAX_MD_SIZE];
+    unsigned int          size;
+    nxt_queue_link_t      *lnk;
+    nxt_openssl_staple_t  *staple;
+
+    if (X509_digest(cert, EVP_sha256(), digest, &size) == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "X509_digest() failed");
+        return NULL;
+    }
+
+    url = nxt_malloc(responder->length + 1);
+    if (nxt_slow_path(url == NULL)) {
+        return NULL;
+    }
+
+    nxt_memcpy(url, responder->start, responder->length);
+    url[responder->length] = '\0';
+
+    nxt_thread_spin_lock(&nxt_openssl_shared_lock);
+
+    for (lnk = nxt_queue_first(&nxt_openssl_staples);
+         lnk != nxt_queue_tail(&nxt_openssl_staples);
+         lnk = nxt_queue_next(lnk))
+    {
+        staple = nxt_queue_link_data(lnk, nxt_openssl_staple_t, link);
+
+        if (staple->digest_size == size
+            && memcmp(staple->digest, digest, size) == 0)
+        {
+            goto found;
+        }
+    }
+
+    staple = nxt_zalloc(sizeof(nxt_openssl_staple_t));
+    if (nxt_slow_path(staple == NULL)) {
+        goto fail;
+    }
+
+    staple->id = OCSP_cert_to_id(NULL, cert, issuer);
+    if (nxt_slow_path(staple->id == NULL)) {
+        nxt_free(staple);
+        goto fail;
+    }
+
+    X509_up_ref(cert);
+    staple->cert = cert;
+
+    X509_up_ref(issuer);
+    staple->issuer = issuer;
+
+    nxt_memcpy(staple->digest, digest, size);
+    staple->digest_size = size;
+
+    nxt_queue_insert_tail(&nxt_openssl_staples, &staple->link);
+
+found:
+
+    staple->count++;
+
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+
+    nxt_thread_spin_lock(&staple->lock);
+
+    if (staple->responder == NULL || nxt_strcmp(staple->responder, url) != 0) {
+        old = staple->responder;
+        staple->responder = url;
+        url = old;
+
+        staple->refresh = 0;
+    }
+
+    nxt_thread_spin_unlock(&staple->lock);
+
+    if (url != NULL) {
+        nxt_free(url);
+    }
+
+    return staple;
+
+fail:
+
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+
+    nxt_openssl_log_error(task, NXT_LOG_ALERT, "OCSP_cert_to_id() failed");
+
+    nxt_free(url);
+
+    return NULL;
+}
+
+
+static void
+nxt_openssl_staple_release(nxt_openssl_staple_t *staple)
+{
+    nxt_thread_spin_lock(&nxt_openssl_shared_lock);
+
+    if (--staple->count != 0) {
+        nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+        return;
+    }
+
+    nxt_queue_remove(&staple->link);
+
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+
+    OCSP_CERTID_free(staple->id);
+    X509_free(staple->cert);
+    X509_free(staple->issuer);
+
+    if (staple->response != NULL) {
+        nxt_free(staple->response);
+    }
+
+    nxt_free(staple->responder);
+    nxt_free(staple);
+}
+
+
+static int
+nxt_openssl_staple_callback(SSL *s, void *arg)
+{
+    u_char                *p;
+    size_t                size;
+    nxt_conn_t            *c;
+    nxt_time_t            now;
+    nxt_openssl_staple_t  *staple;
+
+    c = SSL_get_ex_data(s, nxt_openssl_connection_index);
+
+    if (nxt_slow_path(c == NULL)) {
+        nxt_thread_log_alert("SSL_get_ex_data() failed");
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    staple = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(s), nxt_openssl_staple_index);
+    if (staple == NULL) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    now = nxt_thread_time(c->socket.task->thread);
+
+    p = NULL;
+    size = 0;
+
+    nxt_thread_spin_lock(&staple->lock);
+
+    if (staple->response != NULL && staple->valid > now) {
+        size = staple->size;
+
+        p = OPENSSL_malloc(size);
+        if (nxt_fast_path(p != NULL)) {
+            nxt_memcpy(p, staple->response, size);
+        }
+    }
+
+    nxt_thread_spin_unlock(&staple->lock);
+
+    nxt_openssl_staple_update(c->socket.task, staple);
+
+    if (p == NULL) {
+        nxt_debug(c->socket.task, "no OCSP response to staple");
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    nxt_debug(c->socket.task, "OCSP response stapled");
+
+    SSL_set_tlsext_status_ocsp_resp(s, p, size);
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+
+static void
+nxt_openssl_staple_update(nxt_task_t *task, nxt_openssl_staple_t *staple)
+{
+    nxt_time_t         now;
+    nxt_runtime_t      *rt;
+    nxt_thread_pool_t  **tp;
+
+    rt = task->thread->runtime;
+
+    if (rt->thread_pools == NULL || rt->thread_pools->nelts == 0) {
+        return;
+    }
+
+    now = nxt_thread_time(task->thread);
+
+    nxt_thread_spin_lock(&staple->lock);
+
+    if (staple->fetching || now < staple->refresh) {
+        nxt_thread_spin_unlock(&staple->lock);
+        return;
+    }
+
+    staple->fetching = 1;
+
+    nxt_thread_spin_unlock(&staple->lock);
+
+    nxt_thread_spin_lock(&nxt_openssl_shared_lock);
+    staple->count++;
+    nxt_thread_spin_unlock(&nxt_openssl_shared_lock);
+
+    /* A thread pool sets its own thread in the task. */
+    staple->task = task->thread->engine->task;
+
+    staple->work.next = NULL;
+
+    nxt_work_set(&staple->work, nxt_openssl_staple_fetch, &staple->task,
+                 staple, NULL);
+
+    tp = rt->thread_pools->elts;
+
+    if (nxt_slow_path(nxt_thread_pool_post(tp[rt->thread_pools->nelts - 1],
+                                           &staple->work)
+                      != NXT_OK))
+    {
+        nxt_thread_spin_lock(&staple->lock);
+        staple->fetching = 0;
+        nxt_thread_spin_unlock(&staple->lock);
+
+        nxt_openssl_staple_release(staple);
+    }
+}
+
+
+/* The handler runs in a thread pool thread. */
+
+static void
+nxt_openssl_staple_fetch(nxt_task_t *task, void *obj, void *data)
+{
+    int                   size;
+    char                  *url;
+    u_char                *p, *response, *old;
+    size_t                len;
+    nxt_time_t            now, valid;
+    OCSP_RESPONSE         *resp;
+    nxt_openssl_staple_t  *staple;
+
+    staple = obj;
+
+    size = 0;
+    valid = 0;
+    response = NULL;
+
+    nxt_thread_spin_lock(&staple->lock);
+
+    len = nxt_strlen(staple->responder) + 1;
+
+    url = nxt_malloc(len);
+    if (nxt_fast_path(url != NULL)) {
+        nxt_memcpy(url, staple->responder, len);
+    }
+
+    nxt_thread_spin_unlock(&staple->lock);
+
+    if (nxt_fast_path(url != NULL)) {
+        nxt_debug(task, "OCSP request to \"%s\"", url);
+
+        resp = nxt_openssl_ocsp_request(task, staple, url);
+
+        if (resp != NULL) {
+            if (nxt_openssl_ocsp_verify(task, staple, resp, &valid) == NXT_OK)
+            {
+                size = i2d_OCSP_RESPONSE(resp, NULL);
+
+                if (size > 0) {
+                    response = nxt_malloc(size);
+
+                    if (nxt_fast_path(response != NULL)) {
+                        p = response;
+                        (void) i2d_OCSP_RESPONSE(resp, &p);
+                    }
+                }
+            }
+
+            OCSP_RESPONSE_free(resp);
+        }
+
+        nxt_free(url);
+    }
+
+    now = nxt_thread_time(task->thread);
+
+    nxt_thread_spin_lock(&staple->lock);
+
+    if (response != NULL) {
+        old = staple->response;
+        staple->response = response;
+        response = old;
+
+        staple->size = size;
+        staple->valid = valid;
+
+        staple->refresh = nxt_min(valid - NXT_OPENSSL_OCSP_RETRY,
+                                  now + NXT_OPENSSL_OCSP_REFRESH);
+        staple->refresh = nxt_max(staple->refresh,
+                                  now + NXT_OPENSSL_OCSP_RETRY);
+
+    } else {
+        staple->refresh = now + NXT_OPENSSL_OCSP_RETRY;
+    }
+
+    staple->fetching = 0;
+
+    nxt_thread_spin_unlock(&staple->lock);
+
+    if (response != NULL) {
+        nxt_free(response);
+    }
+
+    nxt_openssl_staple_release(staple);
+}
+
+
+static OCSP_RESPONSE *
+nxt_openssl_ocsp_request(nxt_task_t *task, nxt_openssl_staple_t *staple,
+    char *url)
+{
+    int            use_ssl, len;
+    char           *host, *port, *path;
+    u_char         *der, *buf, *p, *end, *body;
+    ssize_t        n;
+    nxt_socket_t   s;
+    OCSP_CERTID    *id;
+    OCSP_REQUEST   *req;
+    OCSP_RESPONSE  *resp;
+    const u_char   *pos;
+
+    if (OCSP_parse_url(url, &host, &port, &path, &use_ssl) == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "OCSP_parse_url(\"%s\") failed", url);
+        return NULL;
+    }
+
+    s = -1;
+    der = NULL;
+    buf = NULL;
+    resp = NULL;
+
+    req = OCSP_REQUEST_new();
+    if (nxt_slow_path(req == NULL)) {
+        goto done;
+    }
+
+    if (use_ssl) {
+        nxt_log(task, NXT_LOG_ERR, "OCSP responder \"%s\" is not supported, "
+                "only \"http://\" URLs are", url);
+        goto done;
+    }
+
+    id = OCSP_CERTID_dup(staple->id);
+
+    if (id == NULL || OCSP_request_add0_id(req, id) == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "OCSP_request_add0_id() failed");
+        OCSP_CERTID_free(id);
+        goto done;
+    }
+
+    len = i2d_OCSP_REQUEST(req, &der);
+    if (nxt_slow_path(len <= 0)) {
+        goto done;
+    }
+
+    buf = nxt_malloc(NXT_OPENSSL_OCSP_MAX_SIZE);
+    if (nxt_slow_path(buf == NULL)) {
+        goto done;
+    }
+
+    end = buf + NXT_OPENSSL_OCSP_MAX_SIZE;
+
+    p = nxt_sprintf(buf, end, "POST %s HTTP/1.0\r\n"
+                              "Host: %s:%s\r\n"
+                              "Content-Type: application/ocsp-request\r\n"
+                              "Content-Length: %d\r\n\r\n",
+                    path, host, port, len);
+
+    if (nxt_slow_path(end - p < len)) {
+        goto done;
+    }
+
+    p = nxt_cpymem(p, der, len);
+
+    s = nxt_openssl_ocsp_connect(task, host, port);
+    if (s == -1) {
+        goto done;
+    }
+
+    body = buf;
+
+    while (body < p) {
+        n = send(s, body, p - body, 0);
+
+        if (n <= 0) {
+            nxt_log(task, NXT_LOG_ERR, "send() to OCSP responder \"%s\" "
+                    "failed %E", url, nxt_socket_errno);
+            goto done;
+        }
+
+        body += n;
+    }
+
+    p = buf;
+
+    for ( ;; ) {
+        n = recv(s, p, end - p, 0);
+
+        if (n == 0) {
+            break;
+        }
+
+        if (n < 0) {
+            nxt_log(task, NXT_LOG_ERR, "recv() from OCSP responder \"%s\" "
+                    "failed %E", url, nxt_socket_errno);
+            goto done;
+        }
+
+        p += n;
+
+        if (p == end) {
+            nxt_log(task, NXT_LOG_ERR, "OCSP responder \"%s\" sent "
+                    "too large response", url);
+            goto done;
+        }
+    }
+
+    body = nxt_memstrn(buf, p, "\r\n\r\n", 4);
+
+    if (p - buf < 12
+        || memcmp(buf, "HTTP/1.", 7) != 0
+        || memcmp(buf + 8, " 200", 4) != 0
+        || body == NULL)
+    {
+        nxt_log(task, NXT_LOG_ERR, "OCSP responder \"%s\" sent "
+                "invalid response", url);
+        goto done;
+    }
+
+    pos = body + 4;
+
+    resp = d2i_OCSP_RESPONSE(NULL, &pos, p - pos);
+
+    if (resp == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "d2i_OCSP_RESPONSE() failed");
+    }
+
+done:
+
+    if (s != -1) {
+        nxt_socket_close(task, s);
+    }
+
+    if (buf != NULL) {
+        nxt_free(buf);
+    }
+
+    OPENSSL_free(der);
+    OCSP_REQUEST_free(req);
+
+    OPENSSL_free(host);
+    OPENSSL_free(port);
+    OPENSSL_free(path);
+
+    return resp;
+}
+
+
+static nxt_socket_t
+nxt_openssl_ocsp_connect(nxt_task_t *task, char *host, char *port)
+{
+    int              err;
+    nxt_socket_t     s;
+    struct timeval   tv;
+    struct addrinfo  hints, *res, *ai;
+
+    nxt_memzero(&hints, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    err = getaddrinfo(host, port, &hints, &res);
+
+    if (err != 0) {
+        nxt_log(task, NXT_LOG_ERR, "getaddrinfo(\"%s:%s\") failed (%d: %s)",
+                host, port, err, gai_strerror(err));
+        return -1;
+    }
+
+    tv.tv_sec = NXT_OPENSSL_OCSP_TIMEOUT;
+    tv.tv_usec = 0;
+
+    s = -1;
+
+    for (ai = res; ai != NULL; ai = ai->ai_next) {
+        s = nxt_socket_create(task, ai->ai_family, SOCK_STREAM, 0, 0);
+        if (s == -1) {
+            continue;
+        }
+
+        /* The send timeout limits connect() as well. */
+
+        if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0
+            && setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == 0
+            && connect(s, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            break;
+        }
+
+        nxt_log(task, NXT_LOG_ERR, "connect() to OCSP responder \"%s:%s\" "
+                "failed %E", host, port, nxt_socket_errno);
+
+        nxt_socket_close(task, s);
+        s = -1;
+    }
+
+    freeaddrinfo(res);
+
+    return s;
+}
+
+
+static nxt_int_t
+nxt_openssl_ocsp_verify(nxt_task_t *task, nxt_openssl_staple_t *staple,
+    OCSP_RESPONSE *resp, nxt_time_t *valid)
+{
+    int                   n, days, secs;
+    nxt_int_t             ret;
+    X509_STORE            *store;
+    STACK_OF(X509)        *chain;
+    OCSP_BASICRESP        *basic;
+    ASN1_GENERALIZEDTIME  *thisupdate, *nextupdate;
+
+    n = OCSP_response_status(resp);
+
+    if (n != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        nxt_log(task, NXT_LOG_ERR, "OCSP response is not successful (%d: %s)",
+                n, OCSP_response_status_str(n));
+        return NXT_ERROR;
+    }
+
+    basic = OCSP_response_get1_basic(resp);
+    if (basic == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "OCSP_response_get1_basic() failed");
+        return NXT_ERROR;
+    }
+
+    ret = NXT_ERROR;
+
+    store = X509_STORE_new();
+    chain = sk_X509_new_null();
+
+    if (store == NULL
+        || chain == NULL
+        || X509_STORE_add_cert(store, staple->issuer) != 1
+        || sk_X509_push(chain, staple->issuer) == 0)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "OCSP verification store setup failed");
+        goto done;
+    }
+
+    /* The issuer may sign responses itself or delegate it to a responder. */
+
+    if (OCSP_basic_verify(basic, chain, store, OCSP_TRUSTOTHER) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "OCSP_basic_verify() failed");
+        goto done;
+    }
+
+    if (OCSP_resp_find_status(basic, staple->id, &n, NULL, NULL,
+                              &thisupdate, &nextupdate)
+        != 1)
+    {
+        nxt_log(task, NXT_LOG_ERR, "certificate status is not found "
+                "in the OCSP response");
+        goto done;
+    }
+
+    if (n != V_OCSP_CERTSTATUS_GOOD) {
+        nxt_log(task, NXT_LOG_ERR, "certificate status \"%s\" "
+                "in the OCSP response", OCSP_cert_status_str(n));
+        goto done;
+    }
+
+    if (OCSP_check_validity(thisupdate, nextupdate, 300, -1) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ERR,
+                              "OCSP_check_validity() failed");
+        goto done;
+    }
+
+    if (nextupdate == NULL) {
+        *valid = NXT_TIME_T_MAX;
+
+    } else {
+        if (ASN1_TIME_diff(&days, &secs, NULL, nextupdate) != 1) {
+            nxt_openssl_log_error(task, NXT_LOG_ERR, "ASN1_TIME_diff() failed");
+            goto done;
+        }
+
+        *valid = nxt_thread_time(task->thread)
+                 + (nxt_time_t) days * 86400 + secs;
+    }
+
+    ret = NXT_OK;
+
+done:
+
+    if (chain != NULL) {
+        sk_X509_free(chain);
+    }
+
+    if (store != NULL) {
+        X509_STORE_free(store);
+    }
+
+    OCSP_BASICRESP_free(basic);
+
+    return ret;
+}
+
+#endif
+
+
+static void
+nxt_openssl_ctx_free(SSL_CTX *ctx)
+{
+    nxt_openssl_session_cache_t  *cache;
+#if (NXT_HAVE_OPENSSL_OCSP)
+    nxt_openssl_staple_t         *staple;
+
+    staple = SSL_CTX_get_ex_data(ctx, nxt_openssl_staple_index);
+#endif
+
+    cache = SSL_CTX_get_ex_data(ctx, nxt_openssl_session_cache_index);
+
+    /* SSL_CTX callbacks may use the shared data until it is freed. */
+
+    SSL_CTX_free(ctx);
+
+    if (cache != NULL) {
+        nxt_openssl_session_cache_release(cache);
+    }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (staple != NULL) {
+        nxt_openssl_staple_release(staple);
+    }
+#endif
+}
+
+
+static nxt_uint_t
+nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert, nxt_tls_conf_t *conf,
+    nxt_mp_t *mp)
+{
+    int                         len;
+    nxt_str_t                   domain, str;
+    X509_NAME                   *x509_name;
+    nxt_uint_t                  i, n;
+    GENERAL_NAME                *name;
+    nxt_tls_bundle_conf_t       *bundle;
+    STACK_OF(GENERAL_NAME)      *alt_names;
+    nxt_tls_bundle_hash_item_t  *item;
+
+    bundle = conf->bundle;
+
+    alt_names = X509_get_ext_d2i(cert, NID_subject_alt_name, NULL, NULL);
+
+    if (alt_names != NULL) {
+        n = sk_GENERAL_NAME_num(alt_names);
+
+        for (i = 0; i != n; i++) {
+            name = sk_GENERAL_NAME_value(alt_names, i);
+
+            if (name->type != GEN_DNS) {
+                continue;
+            }
+
+            str.length = ASN1_STRING_length(name->d.dNSName);
+#if OPENSSL_VERSION_NUMBER > 0x10100000L
+            str.start = (u_char *) ASN1_STRING_get0_data(name->d.dNSName);
+#else
+            str.start = ASN1_STRING_data(name->d.dNSName);
+#endif
+
+            domain.start = nxt_mp_nget(mp, str.length);
+            if (nxt_slow_path(domain.start == NULL)) {
+                goto fail;
+            }
+
+            domain.length = str.length;
+            nxt_memcpy_lowcase(domain.start, str.start, str.length);
+
+            item = nxt_mp_get(mp, sizeof(nxt_tls_bundle_hash_item_t));
+            if (nxt_slow_path(item == NULL)) {
+                goto fail;
+            }
+
+            item->name = domain;
+            item->bundle = bundle;
+
+            if (nxt_openssl_bundle_hash_insert(task, &conf->bundle_hash,
+                                               item, mp)
+                == NXT_ERROR)
+            {
+                goto fail;
+            }
+        }
+
+        sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
+
+    } else {
+        x509_name = X509_get_subject_name(cert);
+        len = X509_NAME_get_text_by_NID(x509_name, NID_commonName,
+                                        NULL, 0);
+        if (len <= 0) {
+            nxt_log(task, NXT_LOG_WARN, "certificate \"%V\" has neither "
+                    "Subject Alternative Name nor Common Name", &bundle->name);
+            return NXT_OK;
+        }
+
+        domain.start = nxt_mp_nget(mp, len + 1);
+        if (nxt_slow_path(domain.start == NULL)) {
+            return NXT_ERROR;
+        }
+
+        domain.length = X509_NAME_get_text_by_NID(x509_name, NID_commonName,
+                                                  (char *) domain.start,
+                                                  len + 1);
+        nxt_memcpy_lowcase(domain.start, domain.start, domain.length);
+
+        item = nxt_mp_get(mp, sizeof(nxt_tls_bundle_hash_item_t));
+        if (nxt_slow_path(item == NULL)) {
+            return NXT_ERROR;
+        }
+
+        item->name = domain;
+        item->bundle = bundle;
+
+        if (nxt_openssl_bundle_hash_insert(task, &conf->bundle_hash, item,
+                                           mp)
+            == NXT_ERROR)
+        {
+            return NXT_ERROR;
+        }
+    }
+
+    return NXT_OK;
+
+fail:
+
+    sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
+
+    return NXT_ERROR;
+}
+
+
+static const nxt_lvlhsh_proto_t  nxt_openssl_bundle_hash_proto
+    nxt_aligned(64) =
+{
+    NXT_LVLHSH_DEFAULT,
+    nxt_openssl_bundle_hash_test,
+    nxt_mp_lvlhsh_alloc,
+    nxt_mp_lvlhsh_free,
+};
+
+
+static nxt_int_t
+nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_tls_bundle_hash_item_t  *item;
+
+    item = data;
+
+    return nxt_strstr_eq(&lhq->key, &item->name) ? NXT_OK : NXT_DECLINED;
+}
+
+
+static nxt_int_t
+nxt_openssl_bundle_hash_insert(nxt_task_t *task, nxt_lvlhsh_t *lvlhsh,
+    nxt_tls_bundle_hash_item_t *item, nxt_mp_t *mp)
+{
+    nxt_str_t                   str;
+    nxt_int_t                   ret;
+    nxt_lvlhsh_query_t          lhq;
+    nxt_tls_bundle_hash_item_t  *old;
+
+    str = item->name;
+
+    if (item->name.start[0] == '*') {
+        item->name.start++;
+        item->name.length--;
+
+        if (item->name.length == 0 || item->name.start[0] != '.') {
+            nxt_log(task, NXT_LOG_WARN, "ignored invalid name \"%V\" "
+                    "in certificate \"%V\": missing \".\" "
+                    "after wildcard symbol", &str, &item->bundle->name);
+            return NXT_OK;
+        }
+    }
+
+    lhq.pool = mp;
+    lhq.key = item->name;
+    lhq.value = item;
+    lhq.proto = &nxt_openssl_bundle_hash_proto;
+    lhq.replace = 0;
+    lhq.key_hash = nxt_murmur_hash2(item->name.start, item->name.length);
+
+    ret = nxt_lvlhsh_insert(lvlhsh, &lhq);
+    if (nxt_fast_path(ret == NXT_OK)) {
+        nxt_debug(task, "name \"%V\" for certificate \"%V\" is inserted",
                   &str, &item->bundle->name);
         return NXT_OK;
     }
@@ -1110,6 +2439,30 @@ nxt_openssl_servername(SSL *s, int *ad, void *arg)
 }
 
 
+#if (NXT_HAVE_OPENSSL_ALPN)
+
+static int
+nxt_openssl_alpn_select(SSL *s, const unsigned char **out,
+    unsigned char *outlen, const unsigned char *in, unsigned int inlen,
+    void *arg)
+{
+    int  ret;
+
+    static const unsigned char  protos[] = "\x02h2\x08http/1.1";
+
+    ret = SSL_select_next_proto((unsigned char **) out, outlen,
+                                protos, sizeof(protos) - 1, in, inlen);
+
+    if (ret != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    return SSL_TLSEXT_ERR_OK;
+}
+
+#endif
+
+
 static nxt_tls_bundle_conf_t *
 nxt_openssl_find_ctx(nxt_tls_conf_t *conf, nxt_str_t *sn)
 {
@@ -1135,17 +2488,24 @@ nxt_openssl_find_ctx(nxt_tls_conf_t *conf, nxt_str_t *sn)
 static void
 nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf)
 {
-    nxt_tls_bundle_conf_t  *bundle;
+    nxt_bool_t                   shared;
+    nxt_tls_bundle_conf_t        *bundle;
+    nxt_openssl_session_cache_t  *cache;
 
     bundle = conf->bundle;
     nxt_assert(bundle != NULL);
 
+    cache = SSL_CTX_get_ex_data(bundle->ctx, nxt_openssl_session_cache_index);
+
+    /* Random ticket keys stay in the cache for the next configuration. */
+    shared = (cache != NULL && conf->tickets == cache->tickets);
+
     do {
-        SSL_CTX_free(bundle->ctx);
+        nxt_openssl_ctx_free(bundle->ctx);
         bundle = bundle->next;
     } while (bundle != NULL);
 
-    if (conf->tickets) {
+    if (conf->tickets && !shared) {
         nxt_memzero(conf->tickets->tickets,
                     conf->tickets->count * sizeof(nxt_tls_ticket_t));
     }
@@ -1278,6 +2638,14 @@ nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data)
         /* ret == 1, the handshake was successfully completed. */
         tls->handshake = 1;
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+        if (BIO_get_ktls_send(SSL_get_wbio(tls->session))) {
+            nxt_debug(task, "openssl conn kTLS send is enabled");
+
+            c->sendfile = NXT_CONN_SENDFILE_ON;
+        }
+#endif
+
         if (c->read_state != NULL) {
             if (state->io_read_handler != NULL || c->read != NULL) {
                 nxt_conn_read(task->thread->engine, c);
@@ -1375,10 +2743,74 @@ nxt_openssl_conn_io_sendbuf(nxt_task_t *task, nxt_sendbuf_t *sb)
         return 0;
     }
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+    if (niov == 0 && sb->buf != NULL && nxt_buf_is_file(sb->buf)) {
+        return nxt_openssl_conn_io_sendfile(task, sb);
+    }
+#endif
+
     return nxt_openssl_conn_io_send(task, sb, iov.iov_base, iov.iov_len);
 }
 
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+
+/*
+ * File buffers are queued on TLS connections only if the kernel TLS
+ * offload is enabled for sending, see nxt_openssl_conn_handshake().
+ */
+
+static ssize_t
+nxt_openssl_conn_io_sendfile(nxt_task_t *task, nxt_sendbuf_t *sb)
+{
+    size_t              size;
+    ossl_ssize_t        ret;
+    nxt_err_t           err;
+    nxt_int_t           n;
+    nxt_buf_t           *b;
+    nxt_conn_t          *c;
+    nxt_openssl_conn_t  *tls;
+
+    tls = sb->tls;
+    b = sb->buf;
+
+    size = nxt_min(b->file_end - b->file_pos, (nxt_off_t) sb->limit);
+
+    ret = SSL_sendfile(tls->session, b->file->fd, b->file_pos, size, 0);
+
+    err = (ret <= 0) ? nxt_socket_errno : 0;
+
+    nxt_debug(task, "SSL_sendfile(%d, %FD, @%O, %uz): %z err:%d",
+              sb->socket, b->file->fd, b->file_pos, size, ret, err);
+
+    if (ret > 0) {
+        if (ret < (ossl_ssize_t) size) {
+            sb->ready = 0;
+        }
+
+        return ret;
+    }
+
+    c = tls->conn;
+    c->socket.write_ready = sb->ready;
+
+    n = nxt_openssl_conn_test_error(task, c, ret, err, NXT_OPENSSL_WRITE);
+
+    sb->ready = c->socket.write_ready;
+
+    if (n == NXT_ERROR) {
+        sb->error = c->socket.error;
+        nxt_openssl_conn_error(task, err,
+                               "SSL_sendfile(%d, %FD, @%O, %uz) failed",
+                               sb->socket, b->file->fd, b->file_pos, size);
+    }
+
+    return n;
+}
+
+#endif
+
+
 static ssize_t
 nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb, void *buf,
     size_t size)
@@ -191,6 +191,27 @@ nxt_port_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 }
 
 
+nxt_int_t
+nxt_port_quit(nxt_task_t *task, nxt_port_t *port, uint8_t param)
+{
+    nxt_buf_t  *b;
+
+    if (param == NXT_QUIT_NORMAL) {
+        return nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT,
+                                     -1, 0, 0, NULL);
+    }
+
+    b = nxt_buf_mem_alloc(task->thread->engine->mem_pool, sizeof(param), 0);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_ERROR;
+    }
+
+    *b->mem.free++ = param;
+
+    return nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT, -1, 0, 0, b);
+}
+
+
 void
 nxt_port_quit_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 {
@@ -167,6 +167,13 @@ typedef enum {
 } nxt_port_msg_type_t;
 
 
+/* The optional QUIT message parameter. */
+enum {
+    NXT_QUIT_NORMAL   = 0,
+    NXT_QUIT_GRACEFUL = 1,
+};
+
+
 /* Passed as a first iov chunk. */
 typedef struct {
     uint32_t             stream;
@@ -254,8 +261,8 @@ struct nxt_port_s {
     /* Maximum interleave of message parts. */
     uint32_t            max_share;
 
-    uint32_t            active_websockets;
-    uint32_t            active_requests;
+    nxt_atomic_t        active_websockets;
+    nxt_atomic_t        active_requests;
 
     nxt_port_handler_t  handler;
     nxt_port_handler_t  *data;
@@ -354,6 +361,7 @@ void nxt_port_change_log_file(nxt_task_t *task, nxt_runtime_t *rt,
     nxt_uint_t slot, nxt_fd_t fd);
 void nxt_port_remove_notify_others(nxt_task_t *task, nxt_process_t *process);
 
+nxt_int_t nxt_port_quit(nxt_task_t *task, nxt_port_t *port, uint8_t param);
 void nxt_port_quit_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
 void nxt_port_new_port_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
 void nxt_port_process_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg);
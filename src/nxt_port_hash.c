@@ -48,6 +48,13 @@ nxt_port_hash_retrieve(nxt_lvlhsh_t *port_hash)
 }
 
 
+void
+nxt_port_hash_each_init(nxt_lvlhsh_each_t *lhe)
+{
+    nxt_lvlhsh_each_init(lhe, &lvlhsh_ports_proto);
+}
+
+
 nxt_inline void
 nxt_port_hash_lhq(nxt_lvlhsh_query_t *lhq, nxt_pid_port_id_t *pid_port)
 {
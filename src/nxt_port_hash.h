@@ -20,5 +20,7 @@ nxt_port_t *nxt_port_hash_find(nxt_lvlhsh_t *port_hash, nxt_pid_t pid,
 
 nxt_port_t *nxt_port_hash_retrieve(nxt_lvlhsh_t *port_hash);
 
+void nxt_port_hash_each_init(nxt_lvlhsh_each_t *lhe);
+
 
 #endif /* _NXT_PORT_HASH_H_INCLIDED_ */
@@ -16,6 +16,10 @@
 
 #include <nxt_port_memory_int.h>
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+#include <nxt_affinity.h>
+#endif
+
 
 static void nxt_port_broadcast_shm_ack(nxt_task_t *task, nxt_port_t *port,
     void *data);
@@ -30,7 +34,7 @@ nxt_port_mmap_handler_use(nxt_port_mmap_handler_t *mmap_handler, int i)
 
     if (i < 0 && c == -i) {
         if (mmap_handler->hdr != NULL) {
-            nxt_mem_munmap(mmap_handler->hdr, PORT_MMAP_SIZE);
+            nxt_mem_munmap(mmap_handler->hdr, mmap_handler->size);
             mmap_handler->hdr = NULL;
         }
 
@@ -239,7 +243,7 @@ nxt_port_incoming_port_mmap(nxt_task_t *task, nxt_process_t *process,
                 "%PI != %PI or %PI != %PI", hdr->src_pid, process->pid,
                 hdr->dst_pid, nxt_pid);
 
-        nxt_mem_munmap(mem, PORT_MMAP_SIZE);
+        nxt_mem_munmap(mem, mmap_stat.st_size);
 
         return NULL;
     }
@@ -248,13 +252,14 @@ nxt_port_incoming_port_mmap(nxt_task_t *task, nxt_process_t *process,
     if (nxt_slow_path(mmap_handler == NULL)) {
         nxt_log(task, NXT_LOG_WARN, "failed to allocate mmap_handler");
 
-        nxt_mem_munmap(mem, PORT_MMAP_SIZE);
+        nxt_mem_munmap(mem, mmap_stat.st_size);
 
         return NULL;
     }
 
     mmap_handler->hdr = hdr;
     mmap_handler->fd = -1;
+    mmap_handler->size = mmap_stat.st_size;
 
     nxt_thread_mutex_lock(&process->incoming.mutex);
 
@@ -262,7 +267,7 @@ nxt_port_incoming_port_mmap(nxt_task_t *task, nxt_process_t *process,
     if (nxt_slow_path(port_mmap == NULL)) {
         nxt_log(task, NXT_LOG_WARN, "failed to add mmap to incoming array");
 
-        nxt_mem_munmap(mem, PORT_MMAP_SIZE);
+        nxt_mem_munmap(mem, mmap_stat.st_size);
 
         nxt_free(mmap_handler);
         mmap_handler = NULL;
@@ -288,6 +293,8 @@ nxt_port_new_port_mmap(nxt_task_t *task, nxt_port_mmaps_t *mmaps,
     nxt_bool_t tracking, nxt_int_t n)
 {
     void                     *mem;
+    size_t                   size;
+    uint32_t                 chunks;
     nxt_fd_t                 fd;
     nxt_int_t                i;
     nxt_free_map_t           *free_map;
@@ -310,21 +317,62 @@ nxt_port_new_port_mmap(nxt_task_t *task, nxt_port_mmaps_t *mmaps,
         return NULL;
     }
 
-    fd = nxt_shm_open(task, PORT_MMAP_SIZE);
-    if (nxt_slow_path(fd == -1)) {
-        goto remove_fail;
+    chunks = (mmaps->chunks != 0) ? mmaps->chunks : PORT_MMAP_CHUNK_COUNT;
+
+    fd = -1;
+    mem = MAP_FAILED;
+
+    if (mmaps->huge_pages) {
+        size = nxt_port_mmap_size(chunks, 1);
+
+        fd = nxt_shm_open(task, size, 1);
+
+        if (fd != -1) {
+            /* Huge pages are reserved here, so a failure is expected. */
+            mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (mem == MAP_FAILED) {
+                nxt_fd_close(fd);
+                fd = -1;
+            }
+        }
+
+        if (fd == -1) {
+            nxt_log(task, NXT_LOG_WARN, "huge pages are not available, "
+                    "shared memory falls back to regular pages");
+
+            mmaps->huge_pages = 0;
+        }
     }
 
-    mem = nxt_mem_mmap(NULL, PORT_MMAP_SIZE, PROT_READ | PROT_WRITE,
-                       MAP_SHARED, fd, 0);
+    if (fd == -1) {
+        size = nxt_port_mmap_size(chunks, 0);
 
-    if (nxt_slow_path(mem == MAP_FAILED)) {
-        nxt_fd_close(fd);
-        goto remove_fail;
+        fd = nxt_shm_open(task, size, 0);
+        if (nxt_slow_path(fd == -1)) {
+            goto remove_fail;
+        }
+
+        mem = nxt_mem_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0);
+
+        if (nxt_slow_path(mem == MAP_FAILED)) {
+            nxt_fd_close(fd);
+            goto remove_fail;
+        }
+    }
+
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    /* The pages are not touched yet, so they are placed on the node. */
+
+    if (mmaps->numa) {
+        nxt_numa_mem_bind(task, mem, size, mmaps->numa_node);
     }
+#endif
 
     mmap_handler->hdr = mem;
     mmap_handler->fd = fd;
+    mmap_handler->size = size;
     port_mmap->mmap_handler = mmap_handler;
     nxt_port_mmap_handler_use(mmap_handler, 1);
 
@@ -345,12 +393,11 @@ nxt_port_new_port_mmap(nxt_task_t *task, nxt_port_mmaps_t *mmaps,
         nxt_port_mmap_set_chunk_busy(free_map, i);
     }
 
-    /* Mark as busy chunk followed the last available chunk. */
-    nxt_port_mmap_set_chunk_busy(hdr->free_map, PORT_MMAP_CHUNK_COUNT);
-    nxt_port_mmap_set_chunk_busy(hdr->free_tracking_map, PORT_MMAP_CHUNK_COUNT);
+    /* Mark as busy chunks followed the last available chunk. */
+    nxt_port_mmap_reserve_chunks(hdr, chunks);
 
-    nxt_log(task, NXT_LOG_DEBUG, "new mmap #%D created for %PI -> ...",
-            hdr->id, nxt_pid);
+    nxt_log(task, NXT_LOG_DEBUG, "new mmap #%D created for %PI -> ..., "
+            "%uz bytes", hdr->id, nxt_pid, size);
 
     return mmap_handler;
 
@@ -365,10 +412,20 @@ nxt_port_new_port_mmap(nxt_task_t *task, nxt_port_mmaps_t *mmaps,
 
 
 nxt_int_t
-nxt_shm_open(nxt_task_t *task, size_t size)
+nxt_shm_open(nxt_task_t *task, size_t size, nxt_bool_t huge)
 {
     nxt_fd_t  fd;
 
+#if (NXT_HAVE_MEMFD_CREATE && defined MFD_HUGETLB)
+    unsigned  flags;
+#else
+
+    if (huge) {
+        return -1;
+    }
+
+#endif
+
 #if (NXT_HAVE_MEMFD_CREATE || NXT_HAVE_SHM_OPEN)
 
     u_char    *p, name[64];
@@ -381,10 +438,17 @@ nxt_shm_open(nxt_task_t *task, size_t size)
 
 #if (NXT_HAVE_MEMFD_CREATE)
 
+#if (defined MFD_HUGETLB)
+    flags = huge ? MFD_CLOEXEC | MFD_HUGETLB : MFD_CLOEXEC;
+
+    fd = syscall(SYS_memfd_create, name, flags);
+#else
     fd = syscall(SYS_memfd_create, name, MFD_CLOEXEC);
+#endif
 
     if (nxt_slow_path(fd == -1)) {
-        nxt_alert(task, "memfd_create(%s) failed %E", name, nxt_errno);
+        nxt_log(task, huge ? NXT_LOG_INFO : NXT_LOG_ALERT,
+                "memfd_create(%s) failed %E", name, nxt_errno);
 
         return -1;
     }
@@ -428,7 +492,8 @@ nxt_shm_open(nxt_task_t *task, size_t size)
 #endif
 
     if (nxt_slow_path(ftruncate(fd, size) == -1)) {
-        nxt_alert(task, "ftruncate() failed %E", nxt_errno);
+        nxt_log(task, huge ? NXT_LOG_INFO : NXT_LOG_ALERT,
+                "ftruncate() failed %E", nxt_errno);
 
         nxt_fd_close(fd);
 
@@ -557,7 +622,9 @@ nxt_port_mmap_get_buf(nxt_task_t *task, nxt_port_mmaps_t *mmaps, size_t size)
 
     nchunks = (size + PORT_MMAP_CHUNK_SIZE - 1) / PORT_MMAP_CHUNK_SIZE;
 
-    if (nxt_slow_path(nchunks > PORT_MMAP_CHUNK_COUNT)) {
+    if (nxt_slow_path((size_t) nchunks * PORT_MMAP_CHUNK_SIZE
+                      > nxt_port_mmap_data_size(mmaps)))
+    {
         nxt_alert(task, "requested buffer (%z) too big", size);
 
         return NULL;
@@ -664,6 +731,52 @@ nxt_port_mmap_increase_buf(nxt_task_t *task, nxt_buf_t *b, size_t size,
 }
 
 
+size_t
+nxt_port_mmap_data_size(nxt_port_mmaps_t *mmaps)
+{
+    uint32_t  chunks;
+
+    chunks = (mmaps->chunks != 0) ? mmaps->chunks : PORT_MMAP_CHUNK_COUNT;
+
+    return (size_t) chunks * PORT_MMAP_CHUNK_SIZE;
+}
+
+
+void
+nxt_port_mmaps_usage(nxt_port_mmaps_t *mmaps, uint32_t *segments,
+    uint64_t *size, uint64_t *used)
+{
+    uint32_t                 chunks, free;
+    nxt_port_mmap_t          *port_mmap, *end;
+    nxt_port_mmap_header_t   *hdr;
+    nxt_port_mmap_handler_t  *mmap_handler;
+
+    nxt_thread_mutex_lock(&mmaps->mutex);
+
+    end = mmaps->elts + mmaps->size;
+
+    for (port_mmap = mmaps->elts; port_mmap < end; port_mmap++) {
+        mmap_handler = port_mmap->mmap_handler;
+
+        if (mmap_handler == NULL || mmap_handler->hdr == NULL) {
+            continue;
+        }
+
+        hdr = mmap_handler->hdr;
+
+        /* The chunks beyond the mapped size are always busy. */
+        chunks = nxt_port_mmap_chunks(mmap_handler->size, 0);
+        free = nxt_min(nxt_port_mmap_free_chunks(hdr), chunks);
+
+        *segments += 1;
+        *size += mmap_handler->size;
+        *used += (uint64_t) (chunks - free) * PORT_MMAP_CHUNK_SIZE;
+    }
+
+    nxt_thread_mutex_unlock(&mmaps->mutex);
+}
+
+
 static nxt_buf_t *
 nxt_port_mmap_get_incoming_buf(nxt_task_t *task, nxt_port_t *port,
     nxt_pid_t spid, nxt_port_mmap_msg_t *mmap_msg)
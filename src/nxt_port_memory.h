@@ -26,6 +26,10 @@ nxt_port_mmap_get_buf(nxt_task_t *task, nxt_port_mmaps_t *mmaps, size_t size);
 nxt_int_t nxt_port_mmap_increase_buf(nxt_task_t *task, nxt_buf_t *b,
     size_t size, size_t min_size);
 
+size_t nxt_port_mmap_data_size(nxt_port_mmaps_t *mmaps);
+void nxt_port_mmaps_usage(nxt_port_mmaps_t *mmaps, uint32_t *segments,
+    uint64_t *size, uint64_t *used);
+
 nxt_port_mmap_handler_t *
 nxt_port_incoming_port_mmap(nxt_task_t *task, nxt_process_t *process,
     nxt_fd_t fd);
@@ -48,7 +52,7 @@ typedef enum nxt_port_method_e nxt_port_method_t;
 nxt_port_method_t
 nxt_port_mmap_get_method(nxt_task_t *task, nxt_port_t *port, nxt_buf_t *b);
 
-nxt_int_t nxt_shm_open(nxt_task_t *task, size_t size);
+nxt_int_t nxt_shm_open(nxt_task_t *task, size_t size, nxt_bool_t huge);
 
 void nxt_process_broadcast_shm_ack(nxt_task_t *task, nxt_process_t *process);
 
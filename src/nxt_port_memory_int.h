@@ -30,6 +30,8 @@
 #define PORT_MMAP_SIZE          (PORT_MMAP_HEADER_SIZE + PORT_MMAP_DATA_SIZE)
 #define PORT_MMAP_CHUNK_COUNT   (PORT_MMAP_DATA_SIZE / PORT_MMAP_CHUNK_SIZE)
 
+#define PORT_MMAP_HUGE_PAGE_SIZE  (1024 * 1024 * 2)
+
 
 typedef uint32_t  nxt_chunk_id_t;
 
@@ -64,6 +66,7 @@ struct nxt_port_mmap_handler_s {
     nxt_port_mmap_header_t  *hdr;
     nxt_atomic_t            use_count;
     nxt_fd_t                fd;
+    size_t                  size;
 };
 
 /*
@@ -193,4 +196,85 @@ nxt_port_mmap_set_chunk_free(nxt_free_map_t *m, nxt_chunk_id_t c)
 }
 
 
+/*
+ * A segment may provide fewer chunks than PORT_MMAP_CHUNK_COUNT.  Segments
+ * backed by huge pages are mapped in whole huge pages, so their size is
+ * rounded up and the rounding is used for chunks too.
+ */
+
+nxt_inline uint32_t
+nxt_port_mmap_chunks(size_t size, int huge)
+{
+    size_t  n;
+
+    if (size == 0 || size > PORT_MMAP_SIZE) {
+        size = PORT_MMAP_SIZE;
+    }
+
+    if (huge) {
+        size = (size + PORT_MMAP_HUGE_PAGE_SIZE - 1)
+               & ~((size_t) PORT_MMAP_HUGE_PAGE_SIZE - 1);
+    }
+
+    if (size <= PORT_MMAP_HEADER_SIZE) {
+        return PORT_MMAP_CHUNK_COUNT;
+    }
+
+    n = (size - PORT_MMAP_HEADER_SIZE) / PORT_MMAP_CHUNK_SIZE;
+
+    if (n == 0 || n > PORT_MMAP_CHUNK_COUNT) {
+        n = PORT_MMAP_CHUNK_COUNT;
+    }
+
+    return n;
+}
+
+
+nxt_inline size_t
+nxt_port_mmap_size(uint32_t chunks, int huge)
+{
+    size_t  size;
+
+    size = PORT_MMAP_HEADER_SIZE + (size_t) chunks * PORT_MMAP_CHUNK_SIZE;
+
+    if (huge) {
+        size = (size + PORT_MMAP_HUGE_PAGE_SIZE - 1)
+               & ~((size_t) PORT_MMAP_HUGE_PAGE_SIZE - 1);
+    }
+
+    return size;
+}
+
+
+/* Marks busy the chunks beyond the segment, including the guard chunk. */
+
+nxt_inline void
+nxt_port_mmap_reserve_chunks(nxt_port_mmap_header_t *hdr, uint32_t chunks)
+{
+    nxt_chunk_id_t  c;
+
+    for (c = chunks; c <= PORT_MMAP_CHUNK_COUNT; c++) {
+        nxt_port_mmap_set_chunk_busy(hdr->free_map, c);
+        nxt_port_mmap_set_chunk_busy(hdr->free_tracking_map, c);
+    }
+}
+
+
+nxt_inline uint32_t
+nxt_port_mmap_free_chunks(nxt_port_mmap_header_t *hdr)
+{
+    size_t    i;
+    uint32_t  n;
+
+    n = 0;
+
+    for (i = 0; i < MAX_FREE_IDX; i++) {
+        n += __builtin_popcountll(hdr->free_map[i]
+                                  & hdr->free_tracking_map[i]);
+    }
+
+    return n;
+}
+
+
 #endif /* _NXT_PORT_MEMORY_INT_H_INCLUDED_ */
@@ -473,6 +473,11 @@ nxt_port_write_handler(nxt_task_t *task, void *obj, void *data)
                 if (msg->share >= port->max_share) {
                     msg->share = 0;
 
+                    /* The rest is sent by the write event handler. */
+                    if (nxt_fd_event_is_disabled(port->socket.write)) {
+                        enable_write = 1;
+                    }
+
                     if (msg->link.next != NULL) {
                         nxt_thread_mutex_lock(&port->write_mutex);
 
@@ -64,6 +64,14 @@ typedef struct {
     uint32_t            size;
     uint32_t            cap;
     nxt_port_mmap_t     *elts;
+
+    /* The NUMA node of the receiving processes. */
+    uint32_t            numa_node;
+    uint8_t             numa;       /* 1 bit */
+
+    /* Chunks per new segment, 0 means PORT_MMAP_CHUNK_COUNT. */
+    uint32_t            chunks;
+    uint8_t             huge_pages; /* 1 bit */
 } nxt_port_mmaps_t;
 
 
@@ -15,6 +15,7 @@
 #include <nxt_script.h>
 #endif
 #include <nxt_http.h>
+#include <nxt_upstream.h>
 #include <nxt_port_memory_int.h>
 #include <nxt_unit_request.h>
 #include <nxt_unit_response.h>
@@ -22,9 +23,15 @@
 #include <nxt_app_queue.h>
 #include <nxt_port_queue.h>
 #include <nxt_http_compression.h>
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+#include <nxt_affinity.h>
+#endif
 
 #define NXT_SHARED_PORT_ID  0xFFFFu
 
+/* Queue wait samples older than this are not taken into account. */
+#define NXT_APP_SCALING_SAMPLE_TTL  1000
+
 #if (NXT_HAVE_OTEL)
 #define NXT_OTEL_BATCH_DEFAULT     128
 #define NXT_OTEL_SAMPLING_DEFAULT  1
@@ -37,16 +44,40 @@ typedef struct {
     uint32_t          spare_processes;
     nxt_msec_t        timeout;
     nxt_msec_t        idle_timeout;
+    int32_t           numa_node;
+    size_t            shm_segment_size;
+    uint8_t           shm_huge_pages;
+    uint32_t          spin_wait;
     nxt_conf_value_t  *limits_value;
     nxt_conf_value_t  *processes_value;
+    nxt_conf_value_t  *scaling_value;
     nxt_conf_value_t  *targets_value;
+    nxt_conf_value_t  *warm_restart_value;
 } nxt_router_app_conf_t;
 
 
+typedef struct {
+    uint32_t          queue_wait;
+    uint32_t          backlog;
+    uint32_t          step;
+    uint32_t          cooldown;
+} nxt_router_scaling_conf_t;
+
+
+typedef struct {
+    nxt_conf_value_t  *warmup;
+    nxt_msec_t        timeout;
+    nxt_str_t         host;
+    nxt_str_t         address;
+} nxt_router_warm_conf_t;
+
+
 typedef struct {
     nxt_str_t         pass;
     nxt_str_t         application;
     int               backlog;
+    uint8_t           http2;
+    uint8_t           reuseport;
 } nxt_router_listener_conf_t;
 
 
@@ -81,6 +112,7 @@ typedef struct {
     nxt_socket_conf_t       *socket_conf;
     nxt_router_temp_conf_t  *temp_conf;
     nxt_bool_t              last;
+    uint32_t                index;
 } nxt_socket_rpc_t;
 
 
@@ -95,9 +127,53 @@ typedef struct {
     nxt_app_joint_t         *app_joint;
     uint32_t                generation;
     uint8_t                 proto;  /* 1 bit */
+    uint8_t                 warm;   /* 1 bit */
 } nxt_app_joint_rpc_t;
 
 
+typedef struct {
+    nxt_port_t              *port;
+    nxt_atomic_t            count;
+} nxt_router_port_retire_t;
+
+
+typedef struct {
+    nxt_app_t               *app;
+    nxt_uint_t              pending;
+    nxt_uint_t              failed;
+    nxt_uint_t              nports;
+    nxt_port_t              *ports[];
+} nxt_app_warmup_t;
+
+
+typedef struct {
+    nxt_app_warmup_t        *warmup;
+} nxt_app_warmup_rpc_t;
+
+
+/*
+ * A warm restart starts the next generation of application processes
+ * next to the current one, optionally warms it up, and only then makes
+ * it serve requests and gracefully stops the previous generation.
+ */
+
+struct nxt_app_restart_s {
+    nxt_app_t               *app;
+    nxt_port_t              *shared_port;
+    nxt_port_t              *proto_port;
+    nxt_port_t              *reply_port;
+    nxt_app_warmup_t        *warmup;
+    nxt_timer_t             timer;
+
+    uint32_t                stream;
+    uint32_t                generation;
+    uint32_t                processes;
+    uint32_t                pending;
+    uint32_t                nports;
+    nxt_port_t              *ports[];
+};
+
+
 static nxt_int_t nxt_router_prefork(nxt_task_t *task, nxt_process_t *process,
     nxt_mp_t *mp);
 static nxt_int_t nxt_router_start(nxt_task_t *task, nxt_process_data_t *data);
@@ -105,6 +181,9 @@ static void nxt_router_greet_controller(nxt_task_t *task,
     nxt_port_t *controller_port);
 
 static nxt_int_t nxt_router_start_app_process(nxt_task_t *task, nxt_app_t *app);
+static nxt_int_t nxt_router_app_start_send(nxt_task_t *task, nxt_port_t *port,
+    nxt_app_t *app, nxt_port_t *dport, nxt_port_t *shared_port,
+    uint32_t generation, nxt_bool_t warm);
 
 static void nxt_router_new_port_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
@@ -114,6 +193,8 @@ static void nxt_router_app_restart_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 static void nxt_router_status_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
+static void nxt_router_app_shm_usage(nxt_app_t *app,
+    nxt_status_app_t *app_stat);
 static void nxt_router_remove_pid_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 
@@ -149,6 +230,8 @@ static nxt_int_t nxt_router_port_queue_map(nxt_task_t *task,
     nxt_port_t *port, nxt_fd_t fd);
 static void nxt_router_listen_socket_rpc_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf);
+static nxt_int_t nxt_router_listen_socket_rpc_send(nxt_task_t *task,
+    nxt_socket_rpc_t *rpc);
 static void nxt_router_listen_socket_ready(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static void nxt_router_listen_socket_error(nxt_task_t *task,
@@ -173,9 +256,10 @@ static void nxt_router_app_prefork_ready(nxt_task_t *task,
 static void nxt_router_app_prefork_error(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static nxt_socket_conf_t *nxt_router_socket_conf(nxt_task_t *task,
-    nxt_router_temp_conf_t *tmcf, nxt_str_t *name, int backlog);
+    nxt_router_temp_conf_t *tmcf, nxt_str_t *name, int backlog,
+    nxt_bool_t reuseport);
 static nxt_int_t nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
-    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa);
+    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa, uint32_t nsockets);
 
 static nxt_int_t nxt_router_engines_create(nxt_task_t *task,
     nxt_router_t *router, nxt_router_temp_conf_t *tmcf,
@@ -189,8 +273,14 @@ static nxt_int_t nxt_router_engine_conf_delete(nxt_router_temp_conf_t *tmcf,
 static nxt_int_t nxt_router_engine_joints_create(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf, nxt_queue_t *sockets,
     nxt_work_handler_t handler);
+static nxt_int_t nxt_router_engine_cleanup(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf);
 static nxt_int_t nxt_router_engine_quit(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf);
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+static nxt_int_t nxt_router_engine_pin(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf);
+#endif
 static nxt_int_t nxt_router_engine_joints_delete(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf, nxt_queue_t *sockets);
 
@@ -215,22 +305,85 @@ static void nxt_router_listen_socket_update(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_listen_socket_delete(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_router_worker_thread_cleanup(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_router_worker_thread_quit(nxt_task_t *task, void *obj,
     void *data);
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+static void nxt_router_worker_thread_pin(nxt_task_t *task, void *obj,
+    void *data);
+#endif
+static void nxt_router_listen_socket_steer(nxt_task_t *task,
+    nxt_socket_conf_joint_t *joint, nxt_socket_t s);
 static void nxt_router_listen_socket_close(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_thread_exit_handler(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_req_headers_ack_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, nxt_request_rpc_data_t *req_rpc_data);
+static void nxt_router_app_body_ack(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, nxt_request_rpc_data_t *req_rpc_data);
+static void nxt_router_app_body_stream(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_router_listen_socket_release(nxt_task_t *task,
     nxt_socket_conf_t *skcf);
+static void nxt_router_listen_sockets_close(nxt_task_t *task,
+    nxt_listen_socket_t *ls);
 
 static void nxt_router_app_port_ready(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static void nxt_router_app_port_error(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 
+static void nxt_router_app_requests_cancel(nxt_task_t *task, nxt_app_t *app);
+static void nxt_router_app_requests_cancel_handler(nxt_task_t *task,
+    nxt_port_t *port, void *data);
+static nxt_port_t *nxt_router_app_shared_port_create(nxt_task_t *task);
+static nxt_int_t nxt_router_app_warm_restart(nxt_task_t *task, nxt_app_t *app,
+    nxt_port_t *reply_port, uint32_t stream);
+static void nxt_router_app_restart_port_ready(nxt_task_t *task,
+    nxt_app_restart_t *restart, nxt_port_t *port, nxt_bool_t proto);
+static void nxt_router_app_restart_port_error(nxt_task_t *task,
+    nxt_app_restart_t *restart, nxt_bool_t proto);
+static void nxt_router_app_restart_port_close(nxt_task_t *task,
+    nxt_app_t *app, nxt_port_t *port);
+static void nxt_router_app_restart_check(nxt_task_t *task,
+    nxt_app_restart_t *restart);
+static void nxt_router_app_restart_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_app_restart_commit(nxt_task_t *task,
+    nxt_app_restart_t *restart);
+static void nxt_router_app_restart_abort(nxt_task_t *task,
+    nxt_app_restart_t *restart);
+static void nxt_router_app_restart_free(nxt_task_t *task,
+    nxt_app_restart_t *restart);
+static void nxt_router_app_restart_release_handler(nxt_task_t *task,
+    void *obj, void *data);
+static nxt_int_t nxt_router_app_warmup_start(nxt_task_t *task,
+    nxt_app_restart_t *restart);
+static void nxt_router_app_warmup_handler(nxt_task_t *task, nxt_port_t *port,
+    void *data);
+static nxt_int_t nxt_router_app_warmup_send(nxt_task_t *task,
+    nxt_app_warmup_t *warmup, nxt_mp_t *mp, nxt_port_t *port,
+    nxt_str_t *uri);
+static void nxt_router_app_warmup_ready(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, void *data);
+static void nxt_router_app_warmup_error(nxt_task_t *task,
+    nxt_port_recv_msg_t *msg, void *data);
+static void nxt_router_app_warmup_done(nxt_task_t *task,
+    nxt_app_warmup_t *warmup);
+static void nxt_router_app_warmup_done_handler(nxt_task_t *task,
+    nxt_port_t *port, void *data);
+static void nxt_router_shared_port_retire(nxt_task_t *task, nxt_port_t *port);
+static void nxt_router_shared_port_retire_handler(nxt_task_t *task,
+    nxt_port_t *port, void *data);
+static void nxt_router_shared_port_release(nxt_task_t *task,
+    nxt_router_port_retire_t *retire);
+static nxt_port_t *nxt_router_app_port_find(nxt_task_t *task, nxt_app_t *app,
+    nxt_pid_t pid, nxt_port_id_t id);
+static void nxt_router_engine_app_ports_remove(nxt_task_t *task,
+    nxt_event_engine_t *engine, nxt_pid_t pid);
+
 static void nxt_router_app_use(nxt_task_t *task, nxt_app_t *app, int i);
 static void nxt_router_app_unlink(nxt_task_t *task, nxt_app_t *app);
 
@@ -251,6 +404,11 @@ static nxt_buf_t *nxt_router_prepare_msg(nxt_task_t *task,
 static void nxt_router_app_timeout(nxt_task_t *task, void *obj, void *data);
 static void nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj,
     void *data);
+static nxt_uint_t nxt_router_app_queue_wait(nxt_app_t *app, nxt_msec_t now);
+static nxt_uint_t nxt_router_app_scale_up(nxt_task_t *task, nxt_app_t *app,
+    nxt_msec_t now, nxt_uint_t n);
+static void nxt_router_app_queue_sample(nxt_task_t *task, nxt_app_t *app,
+    nxt_request_rpc_data_t *req_rpc_data);
 static void nxt_router_app_idle_timeout(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj,
@@ -376,6 +534,8 @@ nxt_router_start(nxt_task_t *task, nxt_process_data_t *data)
     nxt_queue_init(&router->engines);
     nxt_queue_init(&router->sockets);
     nxt_queue_init(&router->apps);
+    nxt_queue_init(&router->caches);
+    nxt_queue_init(&router->limits);
 
     nxt_router = router;
 
@@ -400,15 +560,9 @@ static void
 nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
     void *data)
 {
-    size_t               size;
-    uint32_t             stream;
-    nxt_fd_t             port_fd, queue_fd;
-    nxt_int_t            ret;
-    nxt_app_t            *app;
-    nxt_buf_t            *b;
-    nxt_port_t           *dport;
-    nxt_runtime_t        *rt;
-    nxt_app_joint_rpc_t  *app_joint_rpc;
+    nxt_int_t   ret;
+    nxt_app_t   *app;
+    nxt_port_t  *dport;
 
     app = data;
 
@@ -418,6 +572,46 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
 
     nxt_thread_mutex_unlock(&app->mutex);
 
+    if (dport == NULL && app->proto_port_requests > 0) {
+        nxt_debug(task, "app '%V' %p wait for prototype process",
+                  &app->name, app);
+
+        app->proto_port_requests++;
+
+        goto skip;
+    }
+
+    ret = nxt_router_app_start_send(task, port, app, dport, app->shared_port,
+                                    app->generation, 0);
+
+    if (ret == NXT_OK && dport == NULL) {
+        app->proto_port_requests++;
+    }
+
+skip:
+
+    nxt_router_app_use(task, app, -1);
+}
+
+
+/*
+ * Starts an application process from the "dport" prototype or,
+ * if "dport" is NULL, the prototype itself for the "shared_port".
+ */
+
+static nxt_int_t
+nxt_router_app_start_send(nxt_task_t *task, nxt_port_t *port, nxt_app_t *app,
+    nxt_port_t *dport, nxt_port_t *shared_port, uint32_t generation,
+    nxt_bool_t warm)
+{
+    size_t               size;
+    uint32_t             stream;
+    nxt_fd_t             port_fd, queue_fd;
+    nxt_int_t            ret;
+    nxt_buf_t            *b;
+    nxt_runtime_t        *rt;
+    nxt_app_joint_rpc_t  *app_joint_rpc;
+
     if (dport != NULL) {
         nxt_debug(task, "app '%V' %p start process", &app->name, app);
 
@@ -426,15 +620,6 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
         queue_fd = -1;
 
     } else {
-        if (app->proto_port_requests > 0) {
-            nxt_debug(task, "app '%V' %p wait for prototype process",
-                      &app->name, app);
-
-            app->proto_port_requests++;
-
-            goto skip;
-        }
-
         nxt_debug(task, "app '%V' %p start prototype process", &app->name, app);
 
         rt = task->thread->runtime;
@@ -444,15 +629,15 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
 
         b = nxt_buf_mem_alloc(task->thread->engine->mem_pool, size, 0);
         if (nxt_slow_path(b == NULL)) {
-            goto failed;
+            return NXT_ERROR;
         }
 
         nxt_buf_cpystr(b, &app->name);
         *b->mem.free++ = '\0';
         nxt_buf_cpystr(b, &app->conf);
 
-        port_fd = app->shared_port->pair[0];
-        queue_fd = app->shared_port->queue_fd;
+        port_fd = shared_port->pair[0];
+        queue_fd = shared_port->queue_fd;
     }
 
     app_joint_rpc = nxt_port_rpc_register_handler_ex(task, port,
@@ -474,26 +659,21 @@ nxt_router_start_app_process_handler(nxt_task_t *task, nxt_port_t *port,
     }
 
     app_joint_rpc->app_joint = app->joint;
-    app_joint_rpc->generation = app->generation;
+    app_joint_rpc->generation = generation;
     app_joint_rpc->proto = (b != NULL);
-
-    if (b != NULL) {
-        app->proto_port_requests++;
-
-        b = NULL;
-    }
+    app_joint_rpc->warm = warm;
 
     nxt_router_app_joint_use(task, app->joint, 1);
 
+    return NXT_OK;
+
 failed:
 
     if (b != NULL) {
         nxt_mp_free(b->data, b);
     }
 
-skip:
-
-    nxt_router_app_use(task, app, -1);
+    return NXT_ERROR;
 }
 
 
@@ -610,22 +790,34 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
     nxt_request_rpc_data_t *req_rpc_data)
 {
     nxt_app_t           *app;
-    nxt_bool_t          unlinked;
     nxt_http_request_t  *r;
 
     nxt_router_msg_cancel(task, req_rpc_data);
 
     app = req_rpc_data->app;
+    r = req_rpc_data->request;
 
     if (req_rpc_data->app_port != NULL) {
+
+        if (r != NULL
+            && r->body_stream
+            && req_rpc_data->app_port->id != NXT_SHARED_PORT_ID)
+        {
+            /* Tells the application that the body is incomplete. */
+            (void) nxt_port_socket_write(task, req_rpc_data->app_port,
+                                         NXT_PORT_MSG_REQ_BODY
+                                         | NXT_PORT_MSG_LAST,
+                                         -1, req_rpc_data->stream,
+                                         task->thread->engine->port->id,
+                                         NULL);
+        }
+
         nxt_router_app_port_release(task, app, req_rpc_data->app_port,
                                     req_rpc_data->apr_action);
 
         req_rpc_data->app_port = NULL;
     }
 
-    r = req_rpc_data->request;
-
     if (r != NULL) {
         r->timer_data = NULL;
 
@@ -634,23 +826,8 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
         r->req_rpc_data = NULL;
         req_rpc_data->request = NULL;
 
-        if (app != NULL) {
-            unlinked = 0;
-
-            nxt_thread_mutex_lock(&app->mutex);
-
-            if (r->app_link.next != NULL) {
-                nxt_queue_remove(&r->app_link);
-                r->app_link.next = NULL;
-
-                unlinked = 1;
-            }
-
-            nxt_thread_mutex_unlock(&app->mutex);
-
-            if (unlinked) {
-                nxt_mp_release(r->mem_pool);
-            }
+        if (app != NULL && nxt_queue_chk_remove(&r->app_link)) {
+            nxt_mp_release(r->mem_pool);
         }
     }
 
@@ -880,28 +1057,32 @@ nxt_router_app_restart_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     app = nxt_router_app_find(&nxt_router->apps, &app_name);
 
     if (nxt_fast_path(app != NULL)) {
-        shared_port = nxt_port_new(task, NXT_SHARED_PORT_ID, nxt_pid,
-                                   NXT_PROCESS_APP);
-        if (nxt_slow_path(shared_port == NULL)) {
+
+        if (app->restart != NULL) {
+            nxt_log(task, NXT_LOG_WARN, "app '%V' restart is in progress",
+                    &app->name);
             goto fail;
         }
 
-        ret = nxt_port_socket_init(task, shared_port, 0);
-        if (nxt_slow_path(ret != NXT_OK)) {
-            nxt_port_use(task, shared_port, -1);
-            goto fail;
+        if (app->warm_restart) {
+            ret = nxt_router_app_warm_restart(task, app, reply_port,
+                                              msg->port_msg.stream);
+            if (ret == NXT_OK) {
+                return;
+            }
+
+            if (nxt_slow_path(ret == NXT_ERROR)) {
+                goto fail;
+            }
+
+            /* No processes to replace, fall back to a plain restart. */
         }
 
-        ret = nxt_router_app_queue_init(task, shared_port);
-        if (nxt_slow_path(ret != NXT_OK)) {
-            nxt_port_write_close(shared_port);
-            nxt_port_read_close(shared_port);
-            nxt_port_use(task, shared_port, -1);
+        shared_port = nxt_router_app_shared_port_create(task);
+        if (nxt_slow_path(shared_port == NULL)) {
             goto fail;
         }
 
-        nxt_port_write_enable(task, shared_port);
-
         nxt_thread_mutex_lock(&app->mutex);
 
         proto_port = app->proto_port;
@@ -914,7 +1095,7 @@ nxt_router_app_restart_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
             proto_port->app = NULL;
         }
 
-        app->generation++;
+        app->generation = ++app->last_generation;
 
         shared_port->app = app;
 
@@ -925,8 +1106,7 @@ nxt_router_app_restart_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
         nxt_thread_mutex_unlock(&app->mutex);
 
-        nxt_port_close(task, old_shared_port);
-        nxt_port_use(task, old_shared_port, -1);
+        nxt_router_shared_port_retire(task, old_shared_port);
 
         if (proto_port != NULL) {
             (void) nxt_port_socket_write(task, proto_port, NXT_PORT_MSG_QUIT,
@@ -951,126 +1131,1068 @@ nxt_router_app_restart_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 }
 
 
-static void
-nxt_router_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+static nxt_port_t *
+nxt_router_app_shared_port_create(nxt_task_t *task)
 {
-    u_char               *p;
-    size_t               alloc;
-    nxt_app_t            *app;
-    nxt_buf_t            *b;
-    nxt_uint_t           type;
-    nxt_port_t           *port;
-    nxt_status_app_t     *app_stat;
-    nxt_event_engine_t   *engine;
-    nxt_status_report_t  *report;
+    nxt_int_t   ret;
+    nxt_port_t  *port;
 
-    port = nxt_runtime_port_find(task->thread->runtime,
-                                 msg->port_msg.pid,
-                                 msg->port_msg.reply_port);
+    port = nxt_port_new(task, NXT_SHARED_PORT_ID, nxt_pid, NXT_PROCESS_APP);
     if (nxt_slow_path(port == NULL)) {
-        nxt_alert(task, "nxt_router_status_handler(): reply port not found");
-        return;
+        return NULL;
     }
 
-    alloc = sizeof(nxt_status_report_t);
+    ret = nxt_port_socket_init(task, port, 0);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_port_use(task, port, -1);
+        return NULL;
+    }
 
-    nxt_queue_each(app, &nxt_router->apps, nxt_app_t, link) {
+    ret = nxt_router_app_queue_init(task, port);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_port_write_close(port);
+        nxt_port_read_close(port);
+        nxt_port_use(task, port, -1);
+        return NULL;
+    }
 
-        alloc += sizeof(nxt_status_app_t) + app->name.length;
+    nxt_port_write_enable(task, port);
 
-    } nxt_queue_loop;
+    return port;
+}
 
-    b = nxt_buf_mem_alloc(port->mem_pool, alloc, 0);
-    if (nxt_slow_path(b == NULL)) {
-        type = NXT_PORT_MSG_RPC_ERROR;
-        goto fail;
-    }
 
-    report = (nxt_status_report_t *) b->mem.free;
-    b->mem.free = b->mem.end;
+static nxt_int_t
+nxt_router_app_warm_restart(nxt_task_t *task, nxt_app_t *app,
+    nxt_port_t *reply_port, uint32_t stream)
+{
+    uint32_t            n, generation;
+    nxt_int_t           ret;
+    nxt_port_t          *shared_port, *router_port;
+    nxt_runtime_t       *rt;
+    nxt_app_restart_t   *restart;
+    nxt_event_engine_t  *engine;
 
-    nxt_memzero(report, sizeof(nxt_status_report_t));
+    /*
+     * The number of processes and the generation are taken together,
+     * as engine threads start and stop processes concurrently.
+     */
 
-    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0) {
+    nxt_thread_mutex_lock(&app->mutex);
 
-        report->accepted_conns += engine->accepted_conns_cnt;
-        report->idle_conns += engine->idle_conns_cnt;
-        report->closed_conns += engine->closed_conns_cnt;
-        report->requests += engine->requests_cnt;
+    n = app->processes + app->pending_processes;
+    n = nxt_max(n, app->spare_processes);
+    n = nxt_min(n, app->max_processes);
 
-    } nxt_queue_loop;
+    if (n == 0) {
+        nxt_thread_mutex_unlock(&app->mutex);
+        return NXT_DECLINED;
+    }
 
-    report->apps_count = 0;
-    app_stat = report->apps;
-    p = b->mem.end;
+    generation = ++app->last_generation;
 
-    nxt_queue_each(app, &nxt_router->apps, nxt_app_t, link) {
-        p -= app->name.length;
+    nxt_thread_mutex_unlock(&app->mutex);
 
-        nxt_memcpy(p, app->name.start, app->name.length);
+    restart = nxt_zalloc(sizeof(nxt_app_restart_t) + n * sizeof(nxt_port_t *));
+    if (nxt_slow_path(restart == NULL)) {
+        return NXT_ERROR;
+    }
 
-        app_stat->name.length = app->name.length;
-        app_stat->name.start = (u_char *) (p - b->mem.pos);
+    shared_port = nxt_router_app_shared_port_create(task);
+    if (nxt_slow_path(shared_port == NULL)) {
+        nxt_free(restart);
+        return NXT_ERROR;
+    }
 
-        app_stat->active_requests = app->active_requests;
-        app_stat->pending_processes = app->pending_processes;
-        app_stat->processes = app->processes;
-        app_stat->idle_processes = app->idle_processes;
+    restart->app = app;
+    restart->shared_port = shared_port;
+    restart->reply_port = reply_port;
+    restart->stream = stream;
+    restart->generation = generation;
+    restart->processes = n;
+    restart->pending = n;
 
-        report->apps_count++;
-        app_stat++;
-    } nxt_queue_loop;
+    engine = task->thread->engine;
 
-    type = NXT_PORT_MSG_RPC_READY_LAST;
+    restart->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+    restart->timer.work_queue = &engine->fast_work_queue;
+    restart->timer.handler = nxt_router_app_restart_timeout;
+    restart->timer.task = &engine->task;
+    restart->timer.log = restart->timer.task->log;
 
-fail:
+    app->restart = restart;
 
-    nxt_port_socket_write(task, port, type, -1, msg->port_msg.stream, 0, b);
-}
+    nxt_router_app_use(task, app, 1);
+    nxt_port_use(task, reply_port, 1);
 
+    nxt_debug(task, "app '%V' warm restart, generation %uD, %uD processes",
+              &app->name, restart->generation, n);
 
-static void
-nxt_router_app_process_remove_pid(nxt_task_t *task, nxt_port_t *port,
-    void *data)
-{
-    union {
-        nxt_pid_t  removed_pid;
-        void       *data;
-    } u;
+    nxt_timer_add(engine, &restart->timer, app->warm_timeout);
 
-    u.data = data;
+    rt = task->thread->runtime;
+    router_port = rt->port_by_type[NXT_PROCESS_ROUTER];
 
-    nxt_port_rpc_remove_peer(task, port, u.removed_pid);
+    ret = nxt_router_app_start_send(task, router_port, app, NULL, shared_port,
+                                    restart->generation, 1);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_router_app_restart_abort(task, restart);
+    }
+
+    return NXT_OK;
 }
 
 
 static void
-nxt_router_remove_pid_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+nxt_router_app_restart_port_ready(nxt_task_t *task,
+    nxt_app_restart_t *restart, nxt_port_t *port, nxt_bool_t proto)
 {
-    nxt_event_engine_t  *engine;
+    uint32_t    i;
+    nxt_int_t   ret;
+    nxt_app_t   *app;
+    nxt_port_t  *router_port;
 
-    nxt_port_remove_pid_handler(task, msg);
+    app = restart->app;
 
-    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0)
-    {
-        if (nxt_fast_path(engine->port != NULL)) {
-            nxt_port_post(task, engine->port, nxt_router_app_process_remove_pid,
-                          msg->u.data);
+    if (proto) {
+        nxt_debug(task, "app '%V' next prototype ready, pid %PI",
+                  &app->name, port->pid);
+
+        restart->proto_port = port;
+        nxt_port_use(task, port, 1);
+
+        router_port = task->thread->runtime->port_by_type[NXT_PROCESS_ROUTER];
+
+        for (i = 0; i < restart->processes; i++) {
+            ret = nxt_router_app_start_send(task, router_port, app, port,
+                                            restart->shared_port,
+                                            restart->generation, 1);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                restart->pending--;
+            }
         }
-    }
-    nxt_queue_loop;
 
-    if (msg->port_msg.stream == 0) {
-        return;
-    }
+    } else {
+        nxt_debug(task, "app '%V' next generation port ready, pid %PI",
+                  &app->name, port->pid);
 
-    msg->port_msg.type = _NXT_PORT_MSG_RPC_ERROR;
+        /*
+         * The port is not published in the application until the
+         * restart is committed, but it needs the application to
+         * resolve shared memory requests.
+         */
+        port->app = app;
 
-    nxt_port_rpc_handler(task, msg);
+        restart->ports[restart->nports++] = port;
+        nxt_port_use(task, port, 1);
+
+        restart->pending--;
+
+        nxt_port_socket_write(task, port, NXT_PORT_MSG_PORT_ACK, -1, 0, 0,
+                              NULL);
+    }
+
+    nxt_router_app_restart_check(task, restart);
 }
 
 
-static nxt_router_temp_conf_t *
+static void
+nxt_router_app_restart_port_error(nxt_task_t *task,
+    nxt_app_restart_t *restart, nxt_bool_t proto)
+{
+    if (proto) {
+        nxt_alert(task, "app '%V' warm restart failed to start prototype",
+                  &restart->app->name);
+
+        nxt_router_app_restart_abort(task, restart);
+
+        return;
+    }
+
+    restart->pending--;
+
+    nxt_router_app_restart_check(task, restart);
+}
+
+
+static void
+nxt_router_app_restart_port_close(nxt_task_t *task, nxt_app_t *app,
+    nxt_port_t *port)
+{
+    uint32_t           i;
+    nxt_app_restart_t  *restart;
+
+    nxt_debug(task, "app '%V' next generation pid %PI closed", &app->name,
+              port->pid);
+
+    port->app = NULL;
+
+    restart = app->restart;
+
+    if (nxt_slow_path(restart == NULL)) {
+        return;
+    }
+
+    for (i = 0; i < restart->nports; i++) {
+
+        if (restart->ports[i] == port) {
+            restart->nports--;
+            restart->ports[i] = restart->ports[restart->nports];
+
+            nxt_port_use(task, port, -1);
+
+            break;
+        }
+    }
+}
+
+
+static void
+nxt_router_app_restart_check(nxt_task_t *task, nxt_app_restart_t *restart)
+{
+    nxt_int_t  ret;
+
+    if (restart->pending != 0 || restart->warmup != NULL) {
+        return;
+    }
+
+    if (restart->nports == 0) {
+        nxt_alert(task, "app '%V' warm restart failed to start processes",
+                  &restart->app->name);
+
+        nxt_router_app_restart_abort(task, restart);
+
+        return;
+    }
+
+    if (restart->app->nwarmup != 0) {
+        ret = nxt_router_app_warmup_start(task, restart);
+        if (ret == NXT_OK) {
+            return;
+        }
+    }
+
+    nxt_router_app_restart_commit(task, restart);
+}
+
+
+static void
+nxt_router_app_restart_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t        *timer;
+    nxt_app_restart_t  *restart;
+
+    timer = obj;
+    restart = nxt_timer_data(timer, nxt_app_restart_t, timer);
+
+    if (restart->nports == 0) {
+        nxt_alert(task, "app '%V' warm restart timed out",
+                  &restart->app->name);
+
+        nxt_router_app_restart_abort(task, restart);
+
+        return;
+    }
+
+    nxt_log(task, NXT_LOG_WARN, "app '%V' warm restart timed out, "
+            "%uD of %uD processes ready%s", &restart->app->name,
+            restart->nports, restart->processes,
+            (restart->warmup != NULL) ? ", warmup incomplete" : "");
+
+    restart->warmup = NULL;
+
+    nxt_router_app_restart_commit(task, restart);
+}
+
+
+static void
+nxt_router_app_restart_commit(nxt_task_t *task, nxt_app_restart_t *restart)
+{
+    uint32_t         i;
+    nxt_app_t        *app;
+    nxt_port_t       *port, *proto_port, *old_shared_port;
+    nxt_app_queue_t  *queue, *old_queue;
+
+    app = restart->app;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    proto_port = app->proto_port;
+
+    if (proto_port != NULL) {
+        proto_port->app = NULL;
+    }
+
+    app->proto_port = restart->proto_port;
+    app->proto_port->app = app;
+
+    app->generation = restart->generation;
+
+    /* Processes still starting are completed as regular ones. */
+    app->pending_processes += restart->pending;
+
+    restart->shared_port->app = app;
+
+    old_shared_port = app->shared_port;
+    old_shared_port->app = NULL;
+
+    app->shared_port = restart->shared_port;
+
+    app->restart = NULL;
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    /* The polling counters continue from the previous shared queue. */
+
+    old_queue = old_shared_port->queue;
+    queue = app->shared_port->queue;
+
+    nxt_atomic_fetch_add(&queue->spins, old_queue->spins);
+    nxt_atomic_fetch_add(&queue->wakeups, old_queue->wakeups);
+
+    nxt_router_shared_port_retire(task, old_shared_port);
+
+    for (i = 0; i < restart->nports; i++) {
+        port = restart->ports[i];
+
+        nxt_thread_mutex_lock(&app->mutex);
+
+        port->main_app_port = port;
+
+        app->processes++;
+        nxt_port_hash_add(&app->port_hash, port);
+        app->port_hash_count++;
+
+        nxt_thread_mutex_unlock(&app->mutex);
+
+        nxt_router_app_port_release(task, app, port, NXT_APR_NEW_PORT);
+
+        nxt_port_use(task, port, -1);
+    }
+
+    nxt_debug(task, "app '%V' warm restart committed, %uD processes",
+              &app->name, restart->nports);
+
+    if (proto_port != NULL) {
+        nxt_debug(task, "send graceful QUIT to prototype '%V' pid %PI",
+                  &app->name, proto_port->pid);
+
+        (void) nxt_port_quit(task, proto_port, NXT_QUIT_GRACEFUL);
+
+        nxt_port_close(task, proto_port);
+
+        nxt_port_use(task, proto_port, -1);
+    }
+
+    nxt_port_socket_write(task, restart->reply_port,
+                          NXT_PORT_MSG_RPC_READY_LAST, -1, restart->stream,
+                          0, NULL);
+
+    nxt_router_app_restart_free(task, restart);
+}
+
+
+static void
+nxt_router_app_restart_abort(nxt_task_t *task, nxt_app_restart_t *restart)
+{
+    uint32_t    i;
+    nxt_app_t   *app;
+    nxt_port_t  *port;
+
+    app = restart->app;
+
+    nxt_debug(task, "app '%V' warm restart aborted", &app->name);
+
+    app->restart = NULL;
+
+    for (i = 0; i < restart->nports; i++) {
+        port = restart->ports[i];
+
+        port->app = NULL;
+
+        nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT, -1, 0, 0, NULL);
+
+        nxt_port_use(task, port, -1);
+    }
+
+    port = restart->proto_port;
+
+    if (port != NULL) {
+        nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT, -1, 0, 0, NULL);
+
+        nxt_port_close(task, port);
+
+        nxt_port_use(task, port, -1);
+    }
+
+    nxt_port_close(task, restart->shared_port);
+    nxt_port_use(task, restart->shared_port, -1);
+
+    nxt_port_socket_write(task, restart->reply_port, NXT_PORT_MSG_RPC_ERROR,
+                          -1, restart->stream, 0, NULL);
+
+    nxt_router_app_restart_free(task, restart);
+}
+
+
+static void
+nxt_router_app_restart_free(nxt_task_t *task, nxt_app_restart_t *restart)
+{
+    nxt_event_engine_t  *engine;
+
+    nxt_port_use(task, restart->reply_port, -1);
+
+    nxt_router_app_use(task, restart->app, -1);
+
+    engine = task->thread->engine;
+
+    if (nxt_timer_delete(engine, &restart->timer)) {
+        restart->timer.handler = nxt_router_app_restart_release_handler;
+        nxt_timer_add(engine, &restart->timer, 0);
+
+    } else {
+        nxt_free(restart);
+    }
+}
+
+
+static void
+nxt_router_app_restart_release_handler(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_free(nxt_timer_data(timer, nxt_app_restart_t, timer));
+}
+
+
+/*
+ * Warmup requests are sent to each process of the next generation
+ * directly, by a worker engine that handles the responses.
+ */
+
+static nxt_int_t
+nxt_router_app_warmup_start(nxt_task_t *task, nxt_app_restart_t *restart)
+{
+    uint32_t            i;
+    nxt_int_t           ret;
+    nxt_port_t          *router_port;
+    nxt_runtime_t       *rt;
+    nxt_app_warmup_t    *warmup;
+    nxt_event_engine_t  *engine;
+
+    rt = task->thread->runtime;
+    router_port = rt->port_by_type[NXT_PROCESS_ROUTER];
+
+    nxt_queue_each(engine, &rt->engines, nxt_event_engine_t, link) {
+
+        if (engine->port != NULL && engine->port != router_port) {
+            goto found;
+        }
+
+    } nxt_queue_loop;
+
+    return NXT_DECLINED;
+
+found:
+
+    warmup = nxt_zalloc(sizeof(nxt_app_warmup_t)
+                        + restart->nports * sizeof(nxt_port_t *));
+    if (nxt_slow_path(warmup == NULL)) {
+        return NXT_ERROR;
+    }
+
+    warmup->app = restart->app;
+    warmup->nports = restart->nports;
+
+    for (i = 0; i < restart->nports; i++) {
+        warmup->ports[i] = restart->ports[i];
+        nxt_port_use(task, warmup->ports[i], 1);
+    }
+
+    nxt_router_app_use(task, warmup->app, 1);
+
+    ret = nxt_port_post(task, engine->port, nxt_router_app_warmup_handler,
+                        warmup);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_router_app_warmup_done_handler(task, router_port, warmup);
+        return NXT_ERROR;
+    }
+
+    restart->warmup = warmup;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_router_app_warmup_handler(nxt_task_t *task, nxt_port_t *port, void *data)
+{
+    nxt_mp_t          *mp;
+    nxt_int_t         ret;
+    nxt_app_t         *app;
+    nxt_uint_t        i, j;
+    nxt_app_warmup_t  *warmup;
+
+    warmup = data;
+    app = warmup->app;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+
+    if (nxt_fast_path(mp != NULL)) {
+
+        for (i = 0; i < warmup->nports; i++) {
+            for (j = 0; j < app->nwarmup; j++) {
+                ret = nxt_router_app_warmup_send(task, warmup, mp,
+                                                 warmup->ports[i],
+                                                 &app->warmup[j]);
+                if (ret == NXT_OK) {
+                    warmup->pending++;
+
+                } else {
+                    warmup->failed++;
+                }
+            }
+        }
+
+        nxt_mp_destroy(mp);
+    }
+
+    nxt_debug(task, "app '%V' %ui warmup requests sent", &app->name,
+              warmup->pending);
+
+    if (warmup->pending == 0) {
+        warmup->pending = 1;
+
+        nxt_router_app_warmup_done(task, warmup);
+    }
+}
+
+
+static nxt_int_t
+nxt_router_app_warmup_send(nxt_task_t *task, nxt_app_warmup_t *warmup,
+    nxt_mp_t *mp, nxt_port_t *port, nxt_str_t *uri)
+{
+    u_char                *p;
+    uint32_t              stream, hash;
+    nxt_int_t             ret;
+    nxt_buf_t             *b, *next;
+    nxt_str_t             *path, *args;
+    nxt_port_t            *reply_port;
+    nxt_http_field_t      *f;
+    nxt_http_request_t    *r;
+    nxt_app_warmup_rpc_t  *rpc;
+
+    static nxt_str_t  get = nxt_string("GET");
+
+    r = nxt_mp_zget(mp, sizeof(nxt_http_request_t));
+    path = nxt_mp_zget(mp, sizeof(nxt_str_t));
+    args = nxt_mp_zget(mp, sizeof(nxt_str_t));
+
+    if (nxt_slow_path(r == NULL || path == NULL || args == NULL)) {
+        return NXT_ERROR;
+    }
+
+    r->remote = warmup->app->warm_address;
+    r->local = r->remote;
+
+    r->fields = nxt_list_create(mp, 1, sizeof(nxt_http_field_t));
+    if (nxt_slow_path(r->fields == NULL)) {
+        return NXT_ERROR;
+    }
+
+    f = nxt_list_add(r->fields);
+    if (nxt_slow_path(f == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_memzero(f, sizeof(nxt_http_field_t));
+    nxt_http_field_name_set(f, "Host");
+
+    f->value = warmup->app->warm_host.start;
+    f->value_length = warmup->app->warm_host.length;
+
+    hash = NXT_HTTP_FIELD_HASH_INIT;
+
+    for (p = f->name; p < f->name + f->name_length; p++) {
+        hash = nxt_http_field_hash_char(hash, nxt_lowcase(*p));
+    }
+
+    f->hash = nxt_http_field_hash_end(hash) & 0xFFFF;
+
+    r->method = &get;
+    nxt_str_set(&r->version, "HTTP/1.1");
+    r->server_name = warmup->app->warm_host;
+
+    r->target = *uri;
+
+    p = memchr(uri->start, '?', uri->length);
+
+    if (p != NULL) {
+        path->start = uri->start;
+        path->length = p - uri->start;
+
+        args->start = p + 1;
+        args->length = uri->start + uri->length - args->start;
+
+    } else {
+        *path = *uri;
+    }
+
+    r->path = path;
+    r->args = args;
+    r->content_length_n = -1;
+
+    b = nxt_router_prepare_msg(task, r, warmup->app,
+                               nxt_app_msg_prefix[warmup->app->type]);
+    if (nxt_slow_path(b == NULL)) {
+        return NXT_ERROR;
+    }
+
+    reply_port = task->thread->engine->port;
+
+    rpc = nxt_port_rpc_register_handler_ex(task, reply_port,
+                                           nxt_router_app_warmup_ready,
+                                           nxt_router_app_warmup_error,
+                                           sizeof(nxt_app_warmup_rpc_t));
+    if (nxt_slow_path(rpc == NULL)) {
+        goto fail;
+    }
+
+    rpc->warmup = warmup;
+
+    stream = nxt_port_rpc_ex_stream(rpc);
+
+    nxt_port_rpc_ex_set_peer(task, reply_port, rpc, port->pid);
+
+    ret = nxt_port_socket_write(task, port, NXT_PORT_MSG_REQ_HEADERS, -1,
+                                stream, reply_port->id, b);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_port_rpc_cancel(task, reply_port, stream);
+        goto fail;
+    }
+
+    nxt_debug(task, "stream #%uD: warmup \"%V\" sent to pid %PI",
+              stream, uri, port->pid);
+
+    return NXT_OK;
+
+fail:
+
+    while (b != NULL) {
+        next = b->next;
+        b->next = NULL;
+        b->completion_handler(task, b, b->parent);
+        b = next;
+    }
+
+    return NXT_ERROR;
+}
+
+
+static void
+nxt_router_app_warmup_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    void *data)
+{
+    nxt_app_warmup_rpc_t  *rpc;
+
+    if (msg->port_msg.last) {
+        rpc = data;
+
+        nxt_router_app_warmup_done(task, rpc->warmup);
+    }
+}
+
+
+static void
+nxt_router_app_warmup_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    void *data)
+{
+    nxt_app_warmup_rpc_t  *rpc;
+
+    rpc = data;
+
+    rpc->warmup->failed++;
+
+    nxt_router_app_warmup_done(task, rpc->warmup);
+}
+
+
+static void
+nxt_router_app_warmup_done(nxt_task_t *task, nxt_app_warmup_t *warmup)
+{
+    nxt_int_t  ret;
+    nxt_port_t  *router_port;
+
+    if (--warmup->pending != 0) {
+        return;
+    }
+
+    router_port = task->thread->runtime->port_by_type[NXT_PROCESS_ROUTER];
+
+    ret = nxt_port_post(task, router_port, nxt_router_app_warmup_done_handler,
+                        warmup);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        nxt_alert(task, "app '%V' failed to complete warmup",
+                  &warmup->app->name);
+    }
+}
+
+
+static void
+nxt_router_app_warmup_done_handler(nxt_task_t *task, nxt_port_t *port,
+    void *data)
+{
+    nxt_app_t          *app;
+    nxt_uint_t         i;
+    nxt_app_warmup_t   *warmup;
+    nxt_app_restart_t  *restart;
+
+    warmup = data;
+    app = warmup->app;
+
+    nxt_debug(task, "app '%V' warmup done, %ui failed", &app->name,
+              warmup->failed);
+
+    restart = app->restart;
+
+    if (restart != NULL && restart->warmup == warmup) {
+        restart->warmup = NULL;
+
+        nxt_router_app_restart_commit(task, restart);
+    }
+
+    for (i = 0; i < warmup->nports; i++) {
+        nxt_port_use(task, warmup->ports[i], -1);
+    }
+
+    nxt_router_app_use(task, app, -1);
+
+    nxt_free(warmup);
+}
+
+
+/*
+ * Engines read the application shared port without the mutex, so
+ * the replaced port is closed only after every engine has processed
+ * a posted work and cannot use the stale pointer anymore.
+ */
+
+static void
+nxt_router_shared_port_retire(nxt_task_t *task, nxt_port_t *port)
+{
+    nxt_runtime_t             *rt;
+    nxt_event_engine_t        *engine;
+    nxt_router_port_retire_t  *retire;
+
+    retire = nxt_zalloc(sizeof(nxt_router_port_retire_t));
+    if (nxt_slow_path(retire == NULL)) {
+        nxt_port_close(task, port);
+        nxt_port_use(task, port, -1);
+        return;
+    }
+
+    retire->port = port;
+    retire->count = 1;
+
+    rt = task->thread->runtime;
+
+    nxt_queue_each(engine, &rt->engines, nxt_event_engine_t, link) {
+
+        if (engine->port == NULL) {
+            continue;
+        }
+
+        nxt_atomic_fetch_add(&retire->count, 1);
+
+        if (nxt_port_post(task, engine->port,
+                          nxt_router_shared_port_retire_handler, retire)
+            != NXT_OK)
+        {
+            nxt_atomic_fetch_add(&retire->count, -1);
+        }
+
+    } nxt_queue_loop;
+
+    nxt_router_shared_port_release(task, retire);
+}
+
+
+static void
+nxt_router_shared_port_retire_handler(nxt_task_t *task, nxt_port_t *port,
+    void *data)
+{
+    nxt_router_shared_port_release(task, data);
+}
+
+
+static void
+nxt_router_shared_port_release(nxt_task_t *task,
+    nxt_router_port_retire_t *retire)
+{
+    nxt_port_t  *port;
+
+    if (nxt_atomic_fetch_add(&retire->count, -1) != 1) {
+        return;
+    }
+
+    port = retire->port;
+
+    nxt_free(retire);
+
+    nxt_debug(task, "shared port %p retired", port);
+
+    nxt_port_close(task, port);
+    nxt_port_use(task, port, -1);
+}
+
+
+static void
+nxt_router_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+    u_char                  *p;
+    size_t                  alloc;
+    nxt_app_t               *app;
+    nxt_buf_t               *b;
+    nxt_uint_t              i, type, nservers;
+    nxt_msec_t              now;
+    nxt_port_t              *port;
+    nxt_app_queue_t         *queue;
+    nxt_status_app_t        *app_stat;
+    nxt_event_engine_t      *engine;
+    nxt_status_server_t     *server_stat;
+    nxt_status_report_t     *report;
+    nxt_upstream_health_t   *h, **health;
+    nxt_upstreams_health_t  *uh;
+
+    port = nxt_runtime_port_find(task->thread->runtime,
+                                 msg->port_msg.pid,
+                                 msg->port_msg.reply_port);
+    if (nxt_slow_path(port == NULL)) {
+        nxt_alert(task, "nxt_router_status_handler(): reply port not found");
+        return;
+    }
+
+    alloc = sizeof(nxt_status_report_t);
+
+    nxt_queue_each(app, &nxt_router->apps, nxt_app_t, link) {
+
+        alloc += sizeof(nxt_status_app_t) + app->name.length;
+
+    } nxt_queue_loop;
+
+    uh = nxt_router->upstreams_health;
+
+    nservers = 0;
+    health = NULL;
+
+    if (uh != NULL) {
+        nservers = uh->servers->nelts;
+        health = uh->servers->elts;
+    }
+
+    for (i = 0; i < nservers; i++) {
+        h = health[i];
+
+        alloc += sizeof(nxt_status_server_t) + h->upstream.length
+                 + h->name.length;
+    }
+
+    alloc += nxt_router_metrics_size();
+
+    b = nxt_buf_mem_alloc(port->mem_pool, alloc, 0);
+    if (nxt_slow_path(b == NULL)) {
+        type = NXT_PORT_MSG_RPC_ERROR;
+        goto fail;
+    }
+
+    report = (nxt_status_report_t *) b->mem.free;
+    b->mem.free = b->mem.end;
+
+    nxt_memzero(report, sizeof(nxt_status_report_t));
+
+    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0) {
+
+        report->accepted_conns += engine->accepted_conns_cnt;
+        report->idle_conns += engine->idle_conns_cnt;
+        report->closed_conns += engine->closed_conns_cnt;
+        report->requests += engine->requests_cnt;
+
+    } nxt_queue_loop;
+
+    report->apps_count = 0;
+    app_stat = report->apps;
+    p = b->mem.end;
+
+    now = task->thread->engine->timers.now;
+
+    nxt_queue_each(app, &nxt_router->apps, nxt_app_t, link) {
+        p -= app->name.length;
+
+        nxt_memcpy(p, app->name.start, app->name.length);
+
+        app_stat->name.length = app->name.length;
+        app_stat->name.start = (u_char *) (p - b->mem.pos);
+
+        app_stat->active_requests = app->active_requests;
+        app_stat->pending_processes = app->pending_processes;
+        app_stat->processes = app->processes;
+        app_stat->idle_processes = app->idle_processes;
+
+        nxt_router_app_shm_usage(app, app_stat);
+
+        app_stat->scaling = app->scaling_enabled;
+
+        if (app->scaling_enabled) {
+            app_stat->queued_requests = app->scaling.queued;
+            app_stat->queue_wait = nxt_router_app_queue_wait(app, now);
+
+            nxt_thread_mutex_lock(&app->mutex);
+
+            app_stat->scaled_up = app->scaling.started;
+            app_stat->scaled_down = app->scaling.retired;
+
+            nxt_thread_mutex_unlock(&app->mutex);
+        }
+
+        app_stat->polling = (app->spin_wait != 0);
+        app_stat->spins = 0;
+        app_stat->wakeups = 0;
+
+        if (app->spin_wait != 0 && app->shared_port != NULL) {
+            queue = app->shared_port->queue;
+
+            app_stat->spins = queue->spins;
+            app_stat->wakeups = queue->wakeups;
+        }
+
+        report->apps_count++;
+        app_stat++;
+    } nxt_queue_loop;
+
+    server_stat = (nxt_status_server_t *) app_stat;
+
+    report->servers_count = nservers;
+    report->servers = (nxt_status_server_t *) ((u_char *) server_stat
+                                               - b->mem.pos);
+
+    for (i = 0; i < nservers; i++) {
+        h = health[i];
+
+        if (i > 0 && nxt_strstr_eq(&h->upstream, &health[i - 1]->upstream)) {
+            server_stat->upstream = server_stat[-1].upstream;
+
+        } else {
+            p -= h->upstream.length;
+            nxt_memcpy(p, h->upstream.start, h->upstream.length);
+
+            server_stat->upstream.length = h->upstream.length;
+            server_stat->upstream.start = (u_char *) (p - b->mem.pos);
+        }
+
+        p -= h->name.length;
+        nxt_memcpy(p, h->name.start, h->name.length);
+
+        server_stat->name.length = h->name.length;
+        server_stat->name.start = (u_char *) (p - b->mem.pos);
+
+        server_stat->fails = h->fails;
+        server_stat->unhealthy = h->unhealthy;
+        server_stat->down = !h->unhealthy
+                            && !nxt_upstream_health_available(h, now);
+
+        server_stat++;
+    }
+
+    (void) nxt_router_metrics_report(report,
+                                     (nxt_status_metric_t *) server_stat, p);
+
+    type = NXT_PORT_MSG_RPC_READY_LAST;
+
+fail:
+
+    nxt_port_socket_write(task, port, type, -1, msg->port_msg.stream, 0, b);
+}
+
+
+/*
+ * Shared memory of an application: the segments the router sends requests
+ * in and the segments its processes send responses in.
+ */
+
+static void
+nxt_router_app_shm_usage(nxt_app_t *app, nxt_status_app_t *app_stat)
+{
+    nxt_port_t  *port;
+
+    app_stat->shm_segments = 0;
+    app_stat->shm_size = 0;
+    app_stat->shm_used = 0;
+
+    nxt_port_mmaps_usage(&app->outgoing, &app_stat->shm_segments,
+                         &app_stat->shm_size, &app_stat->shm_used);
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    nxt_queue_each(port, &app->ports, nxt_port_t, app_link) {
+
+        nxt_port_mmaps_usage(&port->process->incoming,
+                             &app_stat->shm_segments, &app_stat->shm_size,
+                             &app_stat->shm_used);
+
+    } nxt_queue_loop;
+
+    nxt_thread_mutex_unlock(&app->mutex);
+}
+
+
+static void
+nxt_router_app_process_remove_pid(nxt_task_t *task, nxt_port_t *port,
+    void *data)
+{
+    union {
+        nxt_pid_t  removed_pid;
+        void       *data;
+    } u;
+
+    u.data = data;
+
+    nxt_port_rpc_remove_peer(task, port, u.removed_pid);
+
+    nxt_router_engine_app_ports_remove(task, task->thread->engine,
+                                       u.removed_pid);
+}
+
+
+static void
+nxt_router_remove_pid_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
+{
+    nxt_event_engine_t  *engine;
+
+    nxt_port_remove_pid_handler(task, msg);
+
+    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0)
+    {
+        if (nxt_fast_path(engine->port != NULL)) {
+            nxt_port_post(task, engine->port, nxt_router_app_process_remove_pid,
+                          msg->u.data);
+        }
+    }
+    nxt_queue_loop;
+
+    if (msg->port_msg.stream == 0) {
+        return;
+    }
+
+    msg->port_msg.type = _NXT_PORT_MSG_RPC_ERROR;
+
+    nxt_port_rpc_handler(task, msg);
+}
+
+
+static nxt_router_temp_conf_t *
 nxt_router_temp_conf(nxt_task_t *task)
 {
     nxt_mp_t                *mp, *tmp;
@@ -1174,6 +2296,57 @@ nxt_router_app_need_start(nxt_app_t *app)
 }
 
 
+static nxt_uint_t
+nxt_router_app_queue_wait(nxt_app_t *app, nxt_msec_t now)
+{
+    if (nxt_msec_diff(now, app->scaling.last_sample)
+        >= NXT_APP_SCALING_SAMPLE_TTL)
+    {
+        return 0;
+    }
+
+    return app->scaling.wait;
+}
+
+
+/*
+ * Processes are added ahead of the regular one-per-request starts when
+ * either the requests queued for the application exceed the "backlog"
+ * per process, or the average queue wait exceeds "queue_wait".
+ */
+
+nxt_inline nxt_bool_t
+nxt_router_app_need_scale_up(nxt_app_t *app, nxt_msec_t now)
+{
+    if (!app->scaling_enabled
+        || nxt_msec_diff(now, app->scaling.last_scale)
+           < (nxt_msec_int_t) app->scaling.cooldown)
+    {
+        return 0;
+    }
+
+    return app->scaling.queued / nxt_max(app->processes, 1)
+               > app->scaling.backlog
+           || nxt_router_app_queue_wait(app, now)
+               > app->scaling.queue_wait * 1000;
+}
+
+
+/*
+ * Idle processes are retired only when the queue is empty and the
+ * average queue wait is below half of "queue_wait", so the number
+ * of processes does not flap around the threshold.
+ */
+
+nxt_inline nxt_bool_t
+nxt_router_app_can_scale_down(nxt_app_t *app, nxt_msec_t now)
+{
+    return app->scaling.queued == 0
+           && nxt_router_app_queue_wait(app, now)
+              <= app->scaling.queue_wait * 1000 / 2;
+}
+
+
 void
 nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 {
@@ -1185,6 +2358,7 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
     nxt_socket_conf_t            *skcf;
     nxt_router_conf_t            *rtcf;
     nxt_router_temp_conf_t       *tmcf;
+    nxt_upstreams_health_t       *uh;
     const nxt_event_interface_t  *interface;
 #if (NXT_TLS)
     nxt_router_tlssock_t         *tls;
@@ -1259,7 +2433,7 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     rt = task->thread->runtime;
 
-    interface = nxt_service_get(rt->services, "engine", NULL);
+    interface = nxt_service_get(rt->services, "engine", rt->engine);
 
     router = rtcf->router;
 
@@ -1279,6 +2453,19 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     nxt_router_engines_post(router, tmcf);
 
+    uh = (rtcf->upstreams != NULL) ? rtcf->upstreams->health : NULL;
+
+    if (uh != NULL) {
+        nxt_upstreams_health_start(task, uh);
+        nxt_upstreams_health_use(uh);
+    }
+
+    if (router->upstreams_health != NULL) {
+        nxt_upstreams_health_release(router->upstreams_health);
+    }
+
+    router->upstreams_health = uh;
+
     nxt_queue_add(&router->sockets, &updating_sockets);
     nxt_queue_add(&router->sockets, &creating_sockets);
 
@@ -1345,6 +2532,9 @@ nxt_router_conf_ready(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 
         nxt_router_access_log_release(task, lock, rtcf->access_log);
 
+        nxt_http_caches_release(task, rtcf);
+        nxt_http_limits_release(task, rtcf);
+
         nxt_mp_destroy(rtcf->mem_pool);
     }
 
@@ -1356,7 +2546,6 @@ void
 nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 {
     nxt_app_t          *app;
-    nxt_socket_t       s;
     nxt_router_t       *router;
     nxt_queue_link_t   *qlk;
     nxt_socket_conf_t  *skcf;
@@ -1369,11 +2558,8 @@ nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
          qlk = nxt_queue_next(qlk))
     {
         skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
-        s = skcf->listen->socket;
 
-        if (s != -1) {
-            nxt_socket_close(task, s);
-        }
+        nxt_router_listen_sockets_close(task, skcf->listen);
 
         nxt_free(skcf->listen);
     }
@@ -1397,6 +2583,9 @@ nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 
     nxt_router_access_log_release(task, &router->lock, rtcf->access_log);
 
+    nxt_http_caches_release(task, rtcf);
+    nxt_http_limits_release(task, rtcf);
+
     nxt_mp_destroy(rtcf->mem_pool);
 
     nxt_router_conf_send(task, tmcf, NXT_PORT_MSG_RPC_ERROR);
@@ -1456,6 +2645,36 @@ static nxt_conf_map_t  nxt_router_app_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_router_app_conf_t, targets_value),
     },
+
+    {
+        nxt_string("numa_node"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, numa_node),
+    },
+
+    {
+        nxt_string("shm_segment_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_router_app_conf_t, shm_segment_size),
+    },
+
+    {
+        nxt_string("shm_huge_pages"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_app_conf_t, shm_huge_pages),
+    },
+
+    {
+        nxt_string("warm_restart"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_router_app_conf_t, warm_restart_value),
+    },
+
+    {
+        nxt_string("spin_wait"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, spin_wait),
+    },
 };
 
 
@@ -1486,6 +2705,66 @@ static nxt_conf_map_t  nxt_router_app_processes_conf[] = {
         NXT_CONF_MAP_MSEC,
         offsetof(nxt_router_app_conf_t, idle_timeout),
     },
+
+    {
+        nxt_string("scaling"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_router_app_conf_t, scaling_value),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_scaling_conf[] = {
+    {
+        nxt_string("queue_wait"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_scaling_conf_t, queue_wait),
+    },
+
+    {
+        nxt_string("backlog"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_scaling_conf_t, backlog),
+    },
+
+    {
+        nxt_string("step"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_scaling_conf_t, step),
+    },
+
+    {
+        nxt_string("cooldown"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_scaling_conf_t, cooldown),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_warm_conf[] = {
+    {
+        nxt_string("warmup"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_router_warm_conf_t, warmup),
+    },
+
+    {
+        nxt_string("timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_router_warm_conf_t, timeout),
+    },
+
+    {
+        nxt_string("host"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_router_warm_conf_t, host),
+    },
+
+    {
+        nxt_string("address"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_router_warm_conf_t, address),
+    },
 };
 
 
@@ -1507,6 +2786,18 @@ static nxt_conf_map_t  nxt_router_listener_conf[] = {
         NXT_CONF_MAP_INT32,
         offsetof(nxt_router_listener_conf_t, backlog),
     },
+
+    {
+        nxt_string("http2"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_listener_conf_t, http2),
+    },
+
+    {
+        nxt_string("reuseport"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_listener_conf_t, reuseport),
+    },
 };
 
 
@@ -1594,6 +2885,12 @@ static nxt_conf_map_t  nxt_router_http_conf[] = {
         NXT_CONF_MAP_INT8,
         offsetof(nxt_socket_conf_t, chunked_transform),
     },
+
+    {
+        nxt_string("body_stream"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_socket_conf_t, body_stream),
+    },
 };
 
 
@@ -1619,6 +2916,54 @@ static nxt_conf_map_t  nxt_router_websocket_conf[] = {
 };
 
 
+static nxt_conf_map_t  nxt_router_proxy_keepalive_conf[] = {
+    {
+        nxt_string("max_idle"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_proxy_keepalive_conf_t, max_idle),
+    },
+
+    {
+        nxt_string("max_requests"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_proxy_keepalive_conf_t, max_requests),
+    },
+
+    {
+        nxt_string("idle_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_proxy_keepalive_conf_t, idle_timeout),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_open_file_cache_conf[] = {
+    {
+        nxt_string("max_entries"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_static_cache_conf_t, max_entries),
+    },
+
+    {
+        nxt_string("valid"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_http_static_cache_conf_t, valid),
+    },
+
+    {
+        nxt_string("min_uses"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_http_static_cache_conf_t, min_uses),
+    },
+
+    {
+        nxt_string("errors"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_http_static_cache_conf_t, errors),
+    },
+};
+
+
 static nxt_int_t
 nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     u_char *start, u_char *end)
@@ -1649,6 +2994,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                                 *otel_batching, *otel_proto;
 #endif
     nxt_conf_value_t            *root, *conf, *http, *value, *websocket;
+    nxt_conf_value_t            *proxy_keepalive;
     nxt_conf_value_t            *applications, *application, *settings;
     nxt_conf_value_t            *listeners, *listener;
     nxt_socket_conf_t           *skcf;
@@ -1658,8 +3004,14 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_app_lang_module_t       *lang;
     nxt_router_app_conf_t       apcf;
     nxt_router_listener_conf_t  lscf;
+    nxt_router_scaling_conf_t   scf;
+    nxt_router_warm_conf_t      wrcf;
 
     static const nxt_str_t  settings_path = nxt_string("/settings");
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    static const nxt_str_t  listen_cpus_path =
+                                nxt_string("/settings/listen_cpus");
+#endif
     static const nxt_str_t  http_path = nxt_string("/settings/http");
     static const nxt_str_t  applications_path = nxt_string("/applications");
     static const nxt_str_t  listeners_path = nxt_string("/listeners");
@@ -1674,6 +3026,10 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     static const nxt_str_t  conf_timeout_path =
                                 nxt_string("/tls/session/timeout");
     static const nxt_str_t  conf_tickets = nxt_string("/tls/session/tickets");
+    static const nxt_str_t  conf_ktls = nxt_string("/tls/ktls");
+    static const nxt_str_t  conf_stapling = nxt_string("/tls/ocsp/stapling");
+    static const nxt_str_t  conf_responder =
+                                nxt_string("/tls/ocsp/responder");
 #endif
 #if (NXT_HAVE_NJS)
     static const nxt_str_t  js_module_path = nxt_string("/settings/js_module");
@@ -1681,6 +3037,8 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     static const nxt_str_t  static_path = nxt_string("/settings/http/static");
     static const nxt_str_t  websocket_path =
                                 nxt_string("/settings/http/websocket");
+    static const nxt_str_t  proxy_keepalive_path =
+                                nxt_string("/settings/http/proxy_keepalive");
     static const nxt_str_t  compression_path =
                                 nxt_string("/settings/http/compression");
     static const nxt_str_t  forwarded_path = nxt_string("/forwarded");
@@ -1720,6 +3078,19 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         rtcf->threads = nxt_ncpu;
     }
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    value = nxt_conf_get_path(root, &listen_cpus_path);
+    if (value != NULL) {
+        nxt_conf_get_string(value, &name);
+
+        rtcf->cpus = nxt_cpus_parse(mp, &name);
+        if (nxt_slow_path(rtcf->cpus == NULL)) {
+            nxt_alert(task, "invalid \"listen_cpus\" list \"%V\"", &name);
+            return NXT_ERROR;
+        }
+    }
+#endif
+
     conf = nxt_conf_get_path(root, &static_path);
 
     ret = nxt_router_conf_process_static(task, rtcf, conf);
@@ -1791,9 +3162,15 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             apcf.spare_processes = 0;
             apcf.timeout = 0;
             apcf.idle_timeout = 15000;
+            apcf.numa_node = -1;
+            apcf.shm_segment_size = 0;
+            apcf.shm_huge_pages = 0;
+            apcf.spin_wait = 0;
             apcf.limits_value = NULL;
             apcf.processes_value = NULL;
+            apcf.scaling_value = NULL;
             apcf.targets_value = NULL;
+            apcf.warm_restart_value = NULL;
 
             app_joint = nxt_malloc(sizeof(nxt_app_joint_t));
             if (nxt_slow_path(app_joint == NULL)) {
@@ -1888,7 +3265,6 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             nxt_queue_init(&app->ports);
             nxt_queue_init(&app->spare_ports);
             nxt_queue_init(&app->idle_ports);
-            nxt_queue_init(&app->ack_waiting_req);
 
             app->name.length = name.length;
             nxt_memcpy(app->name.start, name.start, name.length);
@@ -1900,11 +3276,89 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                                          ? apcf.spare_processes : 1;
             app->timeout = apcf.timeout;
             app->idle_timeout = apcf.idle_timeout;
+            app->spin_wait = apcf.spin_wait;
 
             app->targets = targets;
 
             engine = task->thread->engine;
 
+            if (apcf.scaling_value != NULL) {
+                scf.queue_wait = 50;
+                scf.backlog = 2;
+                scf.step = 1;
+                scf.cooldown = 1000;
+
+                ret = nxt_conf_map_object(mp, apcf.scaling_value,
+                                        nxt_router_scaling_conf,
+                                        nxt_nitems(nxt_router_scaling_conf),
+                                        &scf);
+                if (ret != NXT_OK) {
+                    nxt_alert(task, "application scaling map error");
+                    goto app_fail;
+                }
+
+                app->scaling_enabled = 1;
+                app->scaling.queue_wait = scf.queue_wait;
+                app->scaling.backlog = scf.backlog;
+                app->scaling.step = scf.step;
+                app->scaling.cooldown = scf.cooldown;
+                app->scaling.last_scale = engine->timers.now - scf.cooldown;
+
+                app->max_pending_processes =
+                              nxt_max(app->max_pending_processes, scf.step);
+            }
+
+            if (apcf.warm_restart_value != NULL) {
+                wrcf.warmup = NULL;
+                wrcf.timeout = 30000;
+                nxt_str_set(&wrcf.host, "localhost");
+                nxt_str_set(&wrcf.address, "127.0.0.1:80");
+
+                ret = nxt_conf_map_object(mp, apcf.warm_restart_value,
+                                          nxt_router_warm_conf,
+                                          nxt_nitems(nxt_router_warm_conf),
+                                          &wrcf);
+                if (ret != NXT_OK) {
+                    nxt_alert(task, "application warm_restart map error");
+                    goto app_fail;
+                }
+
+                if (wrcf.warmup != NULL) {
+                    n = nxt_conf_array_elements_count(wrcf.warmup);
+
+                    app->warmup = nxt_mp_get(app_mp, sizeof(nxt_str_t) * n);
+                    if (nxt_slow_path(app->warmup == NULL)) {
+                        goto app_fail;
+                    }
+
+                    for (i = 0; i < n; i++) {
+                        value = nxt_conf_get_array_element(wrcf.warmup, i);
+                        nxt_conf_get_string(value, &target);
+
+                        s = nxt_str_dup(app_mp, &app->warmup[i], &target);
+                        if (nxt_slow_path(s == NULL)) {
+                            goto app_fail;
+                        }
+                    }
+
+                    app->nwarmup = n;
+                }
+
+                s = nxt_str_dup(app_mp, &app->warm_host, &wrcf.host);
+                if (nxt_slow_path(s == NULL)) {
+                    goto app_fail;
+                }
+
+                app->warm_address = nxt_sockaddr_parse(app_mp,
+                                                       &wrcf.address);
+                if (nxt_slow_path(app->warm_address == NULL)) {
+                    goto app_fail;
+                }
+
+                app->warm_restart = 1;
+                app->warm_timeout = wrcf.timeout;
+            }
+
             app->engine = engine;
 
             app->adjust_idle_work.handler = nxt_router_adjust_idle_timer;
@@ -1961,6 +3415,15 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             app->shared_port = port;
 
             nxt_thread_mutex_create(&app->outgoing.mutex);
+
+            if (apcf.numa_node >= 0) {
+                app->outgoing.numa = 1;
+                app->outgoing.numa_node = apcf.numa_node;
+            }
+
+            app->outgoing.huge_pages = apcf.shm_huge_pages;
+            app->outgoing.chunks = nxt_port_mmap_chunks(apcf.shm_segment_size,
+                                                        apcf.shm_huge_pages);
         }
     }
 
@@ -1979,6 +3442,8 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return ret;
     }
 
+    nxt_http_comp_compression_reset();
+
     http = nxt_conf_get_path(root, &http_path);
 #if 0
     if (http == NULL) {
@@ -1988,6 +3453,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 #endif
 
     websocket = nxt_conf_get_path(root, &websocket_path);
+    proxy_keepalive = nxt_conf_get_path(root, &proxy_keepalive_path);
 
     listeners = nxt_conf_get_path(root, &listeners_path);
 
@@ -2014,7 +3480,8 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
             nxt_debug(task, "application: %V", &lscf.application);
 
-            skcf = nxt_router_socket_conf(task, tmcf, &name, lscf.backlog);
+            skcf = nxt_router_socket_conf(task, tmcf, &name, lscf.backlog,
+                                          lscf.reuseport);
             if (skcf == NULL) {
                 goto fail;
             }
@@ -2039,11 +3506,17 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
             skcf->server_version = 1;
             skcf->chunked_transform = 0;
+            skcf->body_stream = 0;
+            skcf->http2 = lscf.http2;
 
             skcf->websocket_conf.max_frame_size = 1024 * 1024;
             skcf->websocket_conf.read_timeout = 60 * 1000;
             skcf->websocket_conf.keepalive_interval = 30 * 1000;
 
+            skcf->proxy_keepalive_conf.max_idle = 32;
+            skcf->proxy_keepalive_conf.max_requests = 1000;
+            skcf->proxy_keepalive_conf.idle_timeout = 60 * 1000;
+
             nxt_str_null(&skcf->body_temp_path);
 
             if (http != NULL) {
@@ -2074,6 +3547,17 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 }
             }
 
+            if (proxy_keepalive != NULL) {
+                ret = nxt_conf_map_object(mp, proxy_keepalive,
+                                   nxt_router_proxy_keepalive_conf,
+                                   nxt_nitems(nxt_router_proxy_keepalive_conf),
+                                   &skcf->proxy_keepalive_conf);
+                if (ret != NXT_OK) {
+                    nxt_alert(task, "proxy keepalive map error");
+                    goto fail;
+                }
+            }
+
             t = &skcf->body_temp_path;
 
             if (t->length == 0) {
@@ -2108,6 +3592,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                     return NXT_ERROR;
                 }
 
+                tls_init->name = skcf->name;
                 tls_init->cache_size = 0;
                 tls_init->timeout = 300;
 
@@ -2127,6 +3612,21 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 tls_init->tickets_conf = nxt_conf_get_path(listener,
                                                            &conf_tickets);
 
+                value = nxt_conf_get_path(listener, &conf_ktls);
+                tls_init->ktls = (value != NULL)
+                                 && nxt_conf_get_boolean(value);
+
+                value = nxt_conf_get_path(listener, &conf_stapling);
+                tls_init->stapling = (value != NULL)
+                                     && nxt_conf_get_boolean(value);
+
+                nxt_str_null(&tls_init->responder);
+
+                value = nxt_conf_get_path(listener, &conf_responder);
+                if (value != NULL) {
+                    nxt_conf_get_string(value, &tls_init->responder);
+                }
+
                 n = nxt_conf_array_elements_count_or_1(certificate);
 
                 for (i = 0; i < n; i++) {
@@ -2365,9 +3865,10 @@ nxt_router_conf_process_static(nxt_task_t *task, nxt_router_conf_t *rtcf,
     nxt_str_t         *type, exten, str, *s;
     nxt_int_t         ret;
     nxt_uint_t        exts;
-    nxt_conf_value_t  *mtypes_conf, *ext_conf, *value;
+    nxt_conf_value_t  *mtypes_conf, *ext_conf, *value, *cache_conf;
 
     static const nxt_str_t  mtypes_path = nxt_string("/mime_types");
+    static const nxt_str_t  cache_path = nxt_string("/open_file_cache");
 
     mp = rtcf->mem_pool;
 
@@ -2376,10 +3877,28 @@ nxt_router_conf_process_static(nxt_task_t *task, nxt_router_conf_t *rtcf,
         return NXT_ERROR;
     }
 
+    rtcf->open_file_cache.max_entries = 0;
+    rtcf->open_file_cache.min_uses = 1;
+    rtcf->open_file_cache.valid = 60 * 1000;
+    rtcf->open_file_cache.errors = 1;
+
     if (conf == NULL) {
         return NXT_OK;
     }
 
+    cache_conf = nxt_conf_get_path(conf, &cache_path);
+
+    if (cache_conf != NULL) {
+        ret = nxt_conf_map_object(mp, cache_conf,
+                                  nxt_router_open_file_cache_conf,
+                                  nxt_nitems(nxt_router_open_file_cache_conf),
+                                  &rtcf->open_file_cache);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_alert(task, "open_file_cache map error");
+            return NXT_ERROR;
+        }
+    }
+
     mtypes_conf = nxt_conf_get_path(conf, &mtypes_path);
 
     if (mtypes_conf != NULL) {
@@ -2557,7 +4076,7 @@ nxt_router_app_queue_init(nxt_task_t *task, nxt_port_t *port)
     void       *mem;
     nxt_int_t  fd;
 
-    fd = nxt_shm_open(task, sizeof(nxt_app_queue_t));
+    fd = nxt_shm_open(task, sizeof(nxt_app_queue_t), 0);
     if (nxt_slow_path(fd == -1)) {
         return NXT_ERROR;
     }
@@ -2585,7 +4104,7 @@ nxt_router_port_queue_init(nxt_task_t *task, nxt_port_t *port)
     void       *mem;
     nxt_int_t  fd;
 
-    fd = nxt_shm_open(task, sizeof(nxt_port_queue_t));
+    fd = nxt_shm_open(task, sizeof(nxt_port_queue_t), 0);
     if (nxt_slow_path(fd == -1)) {
         return NXT_ERROR;
     }
@@ -2661,7 +4180,8 @@ nxt_router_apps_hash_add(nxt_router_conf_t *rtcf, nxt_app_t *app)
     switch (nxt_lvlhsh_insert(&rtcf->apps_hash, &lhq)) {
 
     case NXT_OK:
-        return NXT_OK;
+        return nxt_router_metric_conf(rtcf, NXT_STATUS_METRIC_APP,
+                                      &app->name);
 
     case NXT_DECLINED:
         nxt_thread_log_alert("router app hash adding failed: "
@@ -2757,10 +4277,12 @@ nxt_router_application_init(nxt_router_conf_t *rtcf, nxt_str_t *name,
 
 static nxt_socket_conf_t *
 nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
-    nxt_str_t *name, int backlog)
+    nxt_str_t *name, int backlog, nxt_bool_t reuseport)
 {
-    size_t               size;
+    size_t               size, sockets_size;
+    uint32_t             i, nsockets;
     nxt_int_t            ret;
+    nxt_str_t            *str;
     nxt_bool_t           wildcard;
     nxt_sockaddr_t       *sa;
     nxt_socket_conf_t    *skcf;
@@ -2782,20 +4304,66 @@ nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return NULL;
     }
 
+    str = nxt_str_dup(tmcf->router_conf->mem_pool, &skcf->name, name);
+    if (nxt_slow_path(str == NULL)) {
+        return NULL;
+    }
+
+    ret = nxt_router_metric_conf(tmcf->router_conf,
+                                 NXT_STATUS_METRIC_LISTENER, &skcf->name);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NULL;
+    }
+
     size = nxt_sockaddr_size(sa);
 
-    ret = nxt_router_listen_socket_find(tmcf, skcf, sa);
+    /*
+     * With "reuseport" each router engine accepts connections from its own
+     * SO_REUSEPORT socket, so the kernel spreads connections among engines.
+     */
+    nsockets = 0;
+
+#ifdef SO_REUSEPORT
+
+    if (reuseport) {
+        nsockets = tmcf->router_conf->threads;
+    }
+
+#endif
+
+#if (NXT_HAVE_UNIX_DOMAIN)
+
+    if (sa->u.sockaddr.sa_family == AF_UNIX) {
+        nsockets = 0;
+    }
+
+#endif
+
+    ret = nxt_router_listen_socket_find(tmcf, skcf, sa, nsockets);
 
     if (ret != NXT_OK) {
 
-        ls = nxt_zalloc(sizeof(nxt_listen_socket_t) + size);
+        sockets_size = nxt_align_size(nsockets * sizeof(nxt_socket_t),
+                                      NXT_ALIGNMENT);
+
+        ls = nxt_zalloc(sizeof(nxt_listen_socket_t) + sockets_size + size);
         if (nxt_slow_path(ls == NULL)) {
             return NULL;
         }
 
         skcf->listen = ls;
 
-        ls->sockaddr = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t));
+        if (nsockets != 0) {
+            ls->sockets = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t));
+            ls->nsockets = nsockets;
+
+            for (i = 0; i < nsockets; i++) {
+                ls->sockets[i] = -1;
+            }
+        }
+
+        ls->sockaddr = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t)
+                                          + sockets_size);
         nxt_memcpy(ls->sockaddr, sa, size);
 
         nxt_listen_socket_remote_size(ls);
@@ -2838,7 +4406,7 @@ nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
 static nxt_int_t
 nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
-    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa)
+    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa, uint32_t nsockets)
 {
     nxt_router_t       *router;
     nxt_queue_link_t   *qlk;
@@ -2852,7 +4420,9 @@ nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
     {
         skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
 
-        if (nxt_sockaddr_cmp(skcf->listen->sockaddr, sa)) {
+        if (nxt_sockaddr_cmp(skcf->listen->sockaddr, sa)
+            && skcf->listen->nsockets == nsockets)
+        {
             nskcf->listen = skcf->listen;
 
             nxt_queue_remove(qlk);
@@ -2874,12 +4444,6 @@ static void
 nxt_router_listen_socket_rpc_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf)
 {
-    size_t            size;
-    uint32_t          stream;
-    nxt_int_t         ret;
-    nxt_buf_t         *b;
-    nxt_port_t        *main_port, *router_port;
-    nxt_runtime_t     *rt;
     nxt_socket_rpc_t  *rpc;
 
     rpc = nxt_mp_alloc(tmcf->mem_pool, sizeof(nxt_socket_rpc_t));
@@ -2889,17 +4453,44 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
 
     rpc->socket_conf = skcf;
     rpc->temp_conf = tmcf;
+    rpc->index = 0;
+
+    if (nxt_router_listen_socket_rpc_send(task, rpc) == NXT_OK) {
+        return;
+    }
+
+fail:
+
+    nxt_router_conf_error(task, tmcf);
+}
+
+
+static nxt_int_t
+nxt_router_listen_socket_rpc_send(nxt_task_t *task, nxt_socket_rpc_t *rpc)
+{
+    size_t               size;
+    uint32_t             stream;
+    nxt_int_t            ret;
+    nxt_buf_t            *b;
+    nxt_port_t           *main_port, *router_port;
+    nxt_runtime_t        *rt;
+    nxt_listen_socket_t  *ls;
 
-    size = nxt_sockaddr_size(skcf->listen->sockaddr);
+    ls = rpc->socket_conf->listen;
+
+    size = nxt_sockaddr_size(ls->sockaddr);
 
-    b = nxt_buf_mem_alloc(tmcf->mem_pool, size, 0);
+    b = nxt_buf_mem_alloc(rpc->temp_conf->mem_pool, size + 1, 0);
     if (b == NULL) {
-        goto fail;
+        return NXT_ERROR;
     }
 
     b->completion_handler = nxt_buf_dummy_completion;
 
-    b->mem.free = nxt_cpymem(b->mem.free, skcf->listen->sockaddr, size);
+    b->mem.free = nxt_cpymem(b->mem.free, ls->sockaddr, size);
+
+    /* The SO_REUSEPORT flag. */
+    *b->mem.free++ = (ls->nsockets != 0);
 
     rt = task->thread->runtime;
     main_port = rt->port_by_type[NXT_PROCESS_MAIN];
@@ -2910,7 +4501,7 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
                                            nxt_router_listen_socket_error,
                                            main_port->pid, rpc);
     if (nxt_slow_path(stream == 0)) {
-        goto fail;
+        return NXT_ERROR;
     }
 
     ret = nxt_port_socket_write(task, main_port, NXT_PORT_MSG_SOCKET, -1,
@@ -2918,14 +4509,10 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
 
     if (nxt_slow_path(ret != NXT_OK)) {
         nxt_port_rpc_cancel(task, router_port, stream);
-        goto fail;
+        return NXT_ERROR;
     }
 
-    return;
-
-fail:
-
-    nxt_router_conf_error(task, tmcf);
+    return NXT_OK;
 }
 
 
@@ -2933,11 +4520,13 @@ static void
 nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
-    nxt_int_t         ret;
-    nxt_socket_t      s;
-    nxt_socket_rpc_t  *rpc;
+    nxt_int_t            ret;
+    nxt_socket_t         s;
+    nxt_socket_rpc_t     *rpc;
+    nxt_listen_socket_t  *ls;
 
     rpc = data;
+    ls = rpc->socket_conf->listen;
 
     s = msg->fd[0];
 
@@ -2946,14 +4535,28 @@ nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         goto fail;
     }
 
-    nxt_socket_defer_accept(task, s, rpc->socket_conf->listen->sockaddr);
+    nxt_socket_defer_accept(task, s, ls->sockaddr);
 
-    ret = nxt_listen_socket(task, s, rpc->socket_conf->listen->backlog);
+    ret = nxt_listen_socket(task, s, ls->backlog);
     if (nxt_slow_path(ret != NXT_OK)) {
         goto fail;
     }
 
-    rpc->socket_conf->listen->socket = s;
+    if (ls->nsockets != 0) {
+        ls->sockets[rpc->index++] = s;
+
+        if (rpc->index < ls->nsockets) {
+            if (nxt_router_listen_socket_rpc_send(task, rpc) != NXT_OK) {
+                nxt_router_conf_error(task, rpc->temp_conf);
+            }
+
+            return;
+        }
+
+        s = ls->sockets[0];
+    }
+
+    ls->socket = s;
 
     nxt_work_queue_add(&task->thread->engine->fast_work_queue,
                        nxt_router_conf_apply, task, rpc->temp_conf, NULL);
@@ -3060,6 +4663,7 @@ nxt_router_tls_rpc_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         }
 
         tlscf->no_wait_shutdown = 1;
+        tlscf->http2 = tls->socket_conf->http2;
         tls->socket_conf->tls = tlscf;
 
     } else {
@@ -3362,6 +4966,10 @@ nxt_router_engine_conf_create(nxt_router_temp_conf_t *tmcf,
         return ret;
     }
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    ret = nxt_router_engine_pin(tmcf, recf);
+#endif
+
     return ret;
 }
 
@@ -3389,7 +4997,14 @@ nxt_router_engine_conf_update(nxt_router_temp_conf_t *tmcf,
         return ret;
     }
 
-    return ret;
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+    ret = nxt_router_engine_pin(tmcf, recf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return ret;
+    }
+#endif
+
+    return nxt_router_engine_cleanup(tmcf, recf);
 }
 
 
@@ -3399,17 +5014,23 @@ nxt_router_engine_conf_delete(nxt_router_temp_conf_t *tmcf,
 {
     nxt_int_t  ret;
 
-    ret = nxt_router_engine_quit(tmcf, recf);
+    ret = nxt_router_engine_joints_delete(tmcf, recf, &updating_sockets);
     if (nxt_slow_path(ret != NXT_OK)) {
         return ret;
     }
 
-    ret = nxt_router_engine_joints_delete(tmcf, recf, &updating_sockets);
+    ret = nxt_router_engine_joints_delete(tmcf, recf, &deleting_sockets);
     if (nxt_slow_path(ret != NXT_OK)) {
         return ret;
     }
 
-    return nxt_router_engine_joints_delete(tmcf, recf, &deleting_sockets);
+    /*
+     * The quit job is not counted in tmcf->count, so it is added last
+     * to be posted first: the temporary configuration cannot be freed
+     * before the engine takes the job while the delete jobs are pending.
+     */
+
+    return nxt_router_engine_quit(tmcf, recf);
 }
 
 
@@ -3457,14 +5078,44 @@ nxt_router_engine_joints_create(nxt_router_temp_conf_t *tmcf,
             return ret;
         }
 
-        joint->count = 1;
+        joint->count = 1;
+        joint->static_cache = NULL;
+        joint->metric = NULL;
+
+        skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
+        skcf->count++;
+        joint->socket_conf = skcf;
+
+        joint->engine = recf->engine;
+        joint->index = recf - (nxt_router_engine_conf_t *) tmcf->engines->elts;
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_router_engine_cleanup(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf)
+{
+    nxt_joint_job_t  *job;
+
+    job = nxt_mp_get(tmcf->mem_pool, sizeof(nxt_joint_job_t));
+    if (nxt_slow_path(job == NULL)) {
+        return NXT_ERROR;
+    }
 
-        skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
-        skcf->count++;
-        joint->socket_conf = skcf;
+    job->work.next = recf->jobs;
+    recf->jobs = &job->work;
 
-        joint->engine = recf->engine;
-    }
+    job->task = tmcf->engine->task;
+    job->work.handler = nxt_router_worker_thread_cleanup;
+    job->work.task = &job->task;
+    job->work.obj = job;
+    job->work.data = NULL;
+    job->tmcf = tmcf;
+
+    tmcf->count++;
 
     return NXT_OK;
 }
@@ -3495,6 +5146,61 @@ nxt_router_engine_quit(nxt_router_temp_conf_t *tmcf,
 }
 
 
+/*
+ * Router threads are pinned round-robin to the "listen_cpus" list,
+ * -1 means that the threads are not pinned.
+ */
+
+nxt_inline nxt_int_t
+nxt_router_engine_cpu(nxt_router_conf_t *rtcf, nxt_uint_t index)
+{
+    uint32_t  *cpus;
+
+    if (rtcf->cpus == NULL) {
+        return -1;
+    }
+
+    cpus = rtcf->cpus->elts;
+
+    return cpus[index % rtcf->cpus->nelts];
+}
+
+
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+
+static nxt_int_t
+nxt_router_engine_pin(nxt_router_temp_conf_t *tmcf,
+    nxt_router_engine_conf_t *recf)
+{
+    nxt_uint_t       index;
+    nxt_joint_job_t  *job;
+
+    job = nxt_mp_get(tmcf->mem_pool, sizeof(nxt_joint_job_t));
+    if (nxt_slow_path(job == NULL)) {
+        return NXT_ERROR;
+    }
+
+    index = recf - (nxt_router_engine_conf_t *) tmcf->engines->elts;
+
+    job->work.next = recf->jobs;
+    recf->jobs = &job->work;
+
+    job->task = tmcf->engine->task;
+    job->work.handler = nxt_router_worker_thread_pin;
+    job->work.task = &job->task;
+    job->work.obj = job;
+    job->work.data = (void *) (intptr_t)
+                         nxt_router_engine_cpu(tmcf->router_conf, index);
+    job->tmcf = tmcf;
+
+    tmcf->count++;
+
+    return NXT_OK;
+}
+
+#endif
+
+
 static nxt_int_t
 nxt_router_engine_joints_delete(nxt_router_temp_conf_t *tmcf,
     nxt_router_engine_conf_t *recf, nxt_queue_t *sockets)
@@ -3652,6 +5358,7 @@ static nxt_port_handlers_t  nxt_router_app_port_handlers = {
     .data            = nxt_port_rpc_handler,
     .oosm            = nxt_router_oosm_handler,
     .req_headers_ack = nxt_port_rpc_handler,
+    .shm_ack         = nxt_port_rpc_handler,
 };
 
 
@@ -3751,6 +5458,7 @@ nxt_router_rt_add_port(nxt_task_t *task, void *obj, void *data)
 static void
 nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
 {
+    nxt_socket_t             s;
     nxt_joint_job_t          *job;
     nxt_socket_conf_t        *skcf;
     nxt_listen_event_t       *lev;
@@ -3766,12 +5474,16 @@ nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
     skcf = joint->socket_conf;
     ls = skcf->listen;
 
-    lev = nxt_listen_event(task, ls);
+    s = (joint->index < ls->nsockets) ? ls->sockets[joint->index] : ls->socket;
+
+    lev = nxt_listen_event_socket(task, ls, s);
     if (nxt_slow_path(lev == NULL)) {
         nxt_router_listen_socket_release(task, skcf);
         return;
     }
 
+    nxt_router_listen_socket_steer(task, joint, s);
+
     lev->socket.data = joint;
 
     lock = &skcf->router_conf->router->lock;
@@ -3791,19 +5503,16 @@ nxt_inline nxt_listen_event_t *
 nxt_router_listen_event(nxt_queue_t *listen_connections,
     nxt_socket_conf_t *skcf)
 {
-    nxt_socket_t        fd;
     nxt_queue_link_t    *qlk;
     nxt_listen_event_t  *lev;
 
-    fd = skcf->listen->socket;
-
     for (qlk = nxt_queue_first(listen_connections);
          qlk != nxt_queue_tail(listen_connections);
          qlk = nxt_queue_next(qlk))
     {
         lev = nxt_queue_link_data(qlk, nxt_listen_event_t, link);
 
-        if (fd == lev->socket.fd) {
+        if (lev->listen == skcf->listen) {
             return lev;
         }
     }
@@ -3812,6 +5521,35 @@ nxt_router_listen_event(nxt_queue_t *listen_connections,
 }
 
 
+static void
+nxt_router_listen_socket_steer(nxt_task_t *task,
+    nxt_socket_conf_joint_t *joint, nxt_socket_t s)
+{
+#ifdef SO_INCOMING_CPU
+    nxt_int_t          cpu;
+    nxt_socket_conf_t  *skcf;
+
+    skcf = joint->socket_conf;
+
+    if (joint->index >= skcf->listen->nsockets) {
+        return;
+    }
+
+    cpu = nxt_router_engine_cpu(skcf->router_conf, joint->index);
+
+    if (cpu < 0) {
+        cpu = joint->index % nxt_ncpu;
+    }
+
+    /*
+     * The kernel prefers a SO_REUSEPORT socket with the CPU
+     * that processes the incoming connection.
+     */
+    (void) nxt_socket_setsockopt(task, s, SOL_SOCKET, SO_INCOMING_CPU, cpu);
+#endif
+}
+
+
 static void
 nxt_router_listen_socket_update(nxt_task_t *task, void *obj, void *data)
 {
@@ -3834,6 +5572,8 @@ nxt_router_listen_socket_update(nxt_task_t *task, void *obj, void *data)
     lev->socket.data = joint;
     lev->listen = joint->socket_conf->listen;
 
+    nxt_router_listen_socket_steer(task, joint, lev->socket.fd);
+
     job->work.next = NULL;
     job->work.handler = nxt_router_conf_wait;
 
@@ -3877,6 +5617,28 @@ nxt_router_listen_socket_delete(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_worker_thread_cleanup(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_joint_job_t  *job;
+
+    job = obj;
+
+    /*
+     * Idle upstream connections are not bound to a configuration,
+     * so they are closed to stop using servers removed from it.
+     */
+    nxt_h1p_peer_idle_close_all(task->thread->engine);
+
+    nxt_router_metrics_prune(task, job->tmcf->router_conf);
+
+    job->work.next = NULL;
+    job->work.handler = nxt_router_conf_wait;
+
+    nxt_event_engine_post(job->tmcf->engine, &job->work);
+}
+
+
 static void
 nxt_router_worker_thread_quit(nxt_task_t *task, void *obj, void *data)
 {
@@ -3894,6 +5656,31 @@ nxt_router_worker_thread_quit(nxt_task_t *task, void *obj, void *data)
 }
 
 
+#if (NXT_HAVE_LINUX_SCHED_GETAFFINITY)
+
+static void
+nxt_router_worker_thread_pin(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_int_t        cpu;
+    nxt_joint_job_t  *job;
+
+    job = obj;
+
+    cpu = (intptr_t) data;
+
+    nxt_debug(task, "router worker thread pin: %i", cpu);
+
+    (void) nxt_cpu_bind(task, cpu);
+
+    job->work.next = NULL;
+    job->work.handler = nxt_router_conf_wait;
+
+    nxt_event_engine_post(job->tmcf->engine, &job->work);
+}
+
+#endif
+
+
 static void
 nxt_router_listen_socket_close(nxt_task_t *task, void *obj, void *data)
 {
@@ -3959,7 +5746,7 @@ nxt_router_listen_socket_release(nxt_task_t *task, nxt_socket_conf_t *skcf)
         return;
     }
 
-    nxt_socket_close(task, ls->socket);
+    nxt_router_listen_sockets_close(task, ls);
 
 #if (NXT_HAVE_UNIX_DOMAIN)
     sa = ls->sockaddr;
@@ -3990,6 +5777,23 @@ nxt_router_listen_socket_release(nxt_task_t *task, nxt_socket_conf_t *skcf)
 }
 
 
+static void
+nxt_router_listen_sockets_close(nxt_task_t *task, nxt_listen_socket_t *ls)
+{
+    uint32_t  i;
+
+    for (i = 0; i < ls->nsockets; i++) {
+        if (ls->sockets[i] != -1 && ls->sockets[i] != ls->socket) {
+            nxt_socket_close(task, ls->sockets[i]);
+        }
+    }
+
+    if (ls->socket != -1) {
+        nxt_socket_close(task, ls->socket);
+    }
+}
+
+
 void
 nxt_router_listen_event_release(nxt_task_t *task, nxt_listen_event_t *lev,
     nxt_socket_conf_joint_t *joint)
@@ -4035,6 +5839,13 @@ nxt_router_conf_release(nxt_task_t *task, nxt_socket_conf_joint_t *joint)
 
     nxt_queue_remove(&joint->link);
 
+    nxt_router_metric_release(joint->metric);
+
+    if (joint->static_cache != NULL) {
+        nxt_http_static_cache_release(task, joint->static_cache);
+        joint->static_cache = NULL;
+    }
+
     /*
      * The joint content can not be safely used after the critical
      * section protected by the spinlock because its memory pool may
@@ -4078,6 +5889,9 @@ nxt_router_conf_release(nxt_task_t *task, nxt_socket_conf_joint_t *joint)
 
         nxt_router_access_log_release(task, lock, rtcf->access_log);
 
+        nxt_http_caches_release(task, rtcf);
+        nxt_http_limits_release(task, rtcf);
+
         nxt_tstr_state_release(rtcf->tstr_state);
 
         nxt_mp_thread_adopt(rtcf->mem_pool);
@@ -4104,6 +5918,15 @@ nxt_router_thread_exit_handler(nxt_task_t *task, void *obj, void *data)
 
     nxt_queue_remove(&engine->link);
 
+    for ( ;; ) {
+        port = nxt_port_hash_retrieve(&engine->app_ports);
+        if (port == NULL) {
+            break;
+        }
+
+        nxt_port_use(task, port, -1);
+    }
+
     port = engine->port;
 
     // TODO notify all apps
@@ -4112,6 +5935,9 @@ nxt_router_thread_exit_handler(nxt_task_t *task, void *obj, void *data)
     nxt_mp_thread_adopt(port->mem_pool);
     nxt_port_use(task, port, -1);
 
+    nxt_router_access_log_buffer_free(task, engine);
+    nxt_router_metrics_free(engine);
+
     nxt_mp_thread_adopt(engine->mem_pool);
     nxt_mp_destroy(engine->mem_pool);
 
@@ -4157,6 +5983,12 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         return;
     }
 
+    if (msg->port_msg.type == _NXT_PORT_MSG_SHM_ACK) {
+        nxt_router_app_body_ack(task, msg, req_rpc_data);
+
+        return;
+    }
+
     b = (msg->size == 0) ? NULL : msg->buf;
 
     if (msg->port_msg.last != 0) {
@@ -4292,11 +6124,8 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
                 goto fail;
             }
 
-            nxt_thread_mutex_lock(&app->mutex);
-
-            app_port->main_app_port->active_websockets++;
-
-            nxt_thread_mutex_unlock(&app->mutex);
+            nxt_atomic_fetch_add(&app_port->main_app_port->active_websockets,
+                                 1);
 
             nxt_router_app_port_release(task, app, app_port, NXT_APR_UPGRADE);
             req_rpc_data->apr_action = NXT_APR_CLOSE;
@@ -4320,6 +6149,142 @@ nxt_router_response_ready_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 }
 
 
+/*
+ * Each engine keeps the application ports it has received acknowledgements
+ * from, so the application port hash is looked up under the mutex only for
+ * the first request of a port on the engine.  The cached ports are removed
+ * when their process exits; closed ports or ports released by the
+ * application are looked up again.
+ */
+
+static nxt_port_t *
+nxt_router_app_port_find(nxt_task_t *task, nxt_app_t *app, nxt_pid_t pid,
+    nxt_port_id_t id)
+{
+    nxt_port_t          *port;
+    nxt_event_engine_t  *engine;
+
+    engine = task->thread->engine;
+
+    port = nxt_port_hash_find(&engine->app_ports, pid, id);
+
+    if (port != NULL) {
+        /*
+         * The port is closed by the main router thread.  A port seen still
+         * open is the same as a port closed right after a lookup under
+         * the mutex: writing to it fails and the request is released.
+         */
+        if (nxt_fast_path(port->app == app
+                          && nxt_atomic_load(&port->pair[1]) != -1))
+        {
+            return port;
+        }
+
+        nxt_port_hash_remove(&engine->app_ports, port);
+        nxt_port_use(task, port, -1);
+    }
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    port = nxt_port_hash_find(&app->port_hash, pid, id);
+
+    if (port != NULL) {
+        nxt_port_inc_use(port);
+    }
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    if (port == NULL) {
+        return NULL;
+    }
+
+    if (nxt_slow_path(nxt_port_hash_add(&engine->app_ports, port) != NXT_OK)) {
+        /* The port is still referenced by the application port hash. */
+        nxt_port_use(task, port, -1);
+    }
+
+    return port;
+}
+
+
+static void
+nxt_router_engine_app_ports_remove(nxt_task_t *task,
+    nxt_event_engine_t *engine, nxt_pid_t pid)
+{
+    nxt_port_t         *port;
+    nxt_lvlhsh_each_t  lhe;
+
+    for ( ;; ) {
+        nxt_port_hash_each_init(&lhe);
+
+        do {
+            port = nxt_lvlhsh_each(&engine->app_ports, &lhe);
+        } while (port != NULL && port->pid != pid);
+
+        if (port == NULL) {
+            return;
+        }
+
+        nxt_port_hash_remove(&engine->app_ports, port);
+        nxt_port_use(task, port, -1);
+    }
+}
+
+
+/*
+ * Moves the process port out of the idle or spare ports queues,
+ * the application mutex must be locked.
+ */
+
+static nxt_bool_t
+nxt_router_app_port_busy(nxt_task_t *task, nxt_app_t *app,
+    nxt_port_t *main_app_port)
+{
+    nxt_port_t        *idle_port;
+    nxt_queue_link_t  *idle_lnk;
+
+    if (!nxt_queue_chk_remove(&main_app_port->idle_link)) {
+        return 0;
+    }
+
+    app->idle_processes--;
+
+    nxt_debug(task, "app '%V' move port %PI:%d out of %s (ack)",
+              &app->name, main_app_port->pid, main_app_port->id,
+              (main_app_port->idle_start ? "idle_ports" : "spare_ports"));
+
+    /* Check port was in 'spare_ports' using idle_start field. */
+    if (main_app_port->idle_start == 0
+        && app->idle_processes >= app->spare_processes)
+    {
+        /*
+         * If there is a vacant space in spare ports,
+         * move the last idle to spare_ports.
+         */
+        nxt_assert(!nxt_queue_is_empty(&app->idle_ports));
+
+        idle_lnk = nxt_queue_last(&app->idle_ports);
+        idle_port = nxt_queue_link_data(idle_lnk, nxt_port_t, idle_link);
+        nxt_queue_remove(idle_lnk);
+
+        nxt_queue_insert_tail(&app->spare_ports, idle_lnk);
+
+        idle_port->idle_start = 0;
+
+        nxt_debug(task, "app '%V' move port %PI:%d from idle_ports "
+                  "to spare_ports",
+                  &app->name, idle_port->pid, idle_port->id);
+    }
+
+    if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
+        app->pending_processes++;
+        return 1;
+    }
+
+    return 0;
+}
+
+
 static void
 nxt_router_req_headers_ack_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, nxt_request_rpc_data_t *req_rpc_data)
@@ -4328,8 +6293,8 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
     nxt_app_t           *app;
     nxt_buf_t           *b;
     nxt_bool_t          start_process, unlinked;
-    nxt_port_t          *app_port, *main_app_port, *idle_port;
-    nxt_queue_link_t    *idle_lnk;
+    nxt_port_t          *app_port, *main_app_port;
+    nxt_atomic_uint_t   active;
     nxt_http_request_t  *r;
 
     nxt_debug(task, "stream #%uD: got ack from %PI:%d",
@@ -4343,22 +6308,12 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
     r = req_rpc_data->request;
 
     start_process = 0;
-    unlinked = 0;
-
-    nxt_thread_mutex_lock(&app->mutex);
 
-    if (r->app_link.next != NULL) {
-        nxt_queue_remove(&r->app_link);
-        r->app_link.next = NULL;
+    unlinked = nxt_queue_chk_remove(&r->app_link);
 
-        unlinked = 1;
-    }
-
-    app_port = nxt_port_hash_find(&app->port_hash, msg->port_msg.pid,
-                                  msg->port_msg.reply_port);
+    app_port = nxt_router_app_port_find(task, app, msg->port_msg.pid,
+                                        msg->port_msg.reply_port);
     if (nxt_slow_path(app_port == NULL)) {
-        nxt_thread_mutex_unlock(&app->mutex);
-
         nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
 
         if (unlinked) {
@@ -4370,48 +6325,23 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
 
     main_app_port = app_port->main_app_port;
 
-    if (nxt_queue_chk_remove(&main_app_port->idle_link)) {
-        app->idle_processes--;
-
-        nxt_debug(task, "app '%V' move port %PI:%d out of %s (ack)",
-                  &app->name, main_app_port->pid, main_app_port->id,
-                  (main_app_port->idle_start ? "idle_ports" : "spare_ports"));
-
-        /* Check port was in 'spare_ports' using idle_start field. */
-        if (main_app_port->idle_start == 0
-            && app->idle_processes >= app->spare_processes)
-        {
-            /*
-             * If there is a vacant space in spare ports,
-             * move the last idle to spare_ports.
-             */
-            nxt_assert(!nxt_queue_is_empty(&app->idle_ports));
+    nxt_port_inc_use(app_port);
 
-            idle_lnk = nxt_queue_last(&app->idle_ports);
-            idle_port = nxt_queue_link_data(idle_lnk, nxt_port_t, idle_link);
-            nxt_queue_remove(idle_lnk);
+    active = nxt_atomic_fetch_add(&main_app_port->active_requests, 1);
 
-            nxt_queue_insert_tail(&app->spare_ports, idle_lnk);
+    /*
+     * Only a process without active requests can be in the idle
+     * or spare ports queues, so the mutex is not needed otherwise.
+     */
 
-            idle_port->idle_start = 0;
+    if (active == 0) {
+        nxt_thread_mutex_lock(&app->mutex);
 
-            nxt_debug(task, "app '%V' move port %PI:%d from idle_ports "
-                      "to spare_ports",
-                      &app->name, idle_port->pid, idle_port->id);
-        }
+        start_process = nxt_router_app_port_busy(task, app, main_app_port);
 
-        if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
-            app->pending_processes++;
-            start_process = 1;
-        }
+        nxt_thread_mutex_unlock(&app->mutex);
     }
 
-    main_app_port->active_requests++;
-
-    nxt_port_inc_use(app_port);
-
-    nxt_thread_mutex_unlock(&app->mutex);
-
     if (unlinked) {
         nxt_mp_release(r->mem_pool);
     }
@@ -4420,6 +6350,10 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
         nxt_router_start_app_process(task, app);
     }
 
+    if (app->scaling_enabled) {
+        nxt_router_app_queue_sample(task, app, req_rpc_data);
+    }
+
     nxt_port_use(task, req_rpc_data->app_port, -1);
 
     req_rpc_data->app_port = app_port;
@@ -4449,6 +6383,20 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
         if (nxt_slow_path(res != NXT_OK)) {
             nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
         }
+
+    } else if (r->body_stream) {
+        if (nxt_slow_path(r->proto.any == NULL)) {
+            /* The client has gone before the body was streamed. */
+            nxt_request_rpc_data_unlink(task, req_rpc_data);
+            return;
+        }
+
+        nxt_debug(task, "stream #%uD: stream body", req_rpc_data->stream);
+
+        nxt_http_request_body_stream(task, r, nxt_router_app_body_stream);
+
+        /* The timeout starts after the last body part is sent. */
+        return;
     }
 
     if (app->timeout != 0) {
@@ -4459,6 +6407,168 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
 }
 
 
+/*
+ * A streamed body is read from the client only while less than this
+ * number of body buffers are not consumed by the application.
+ */
+
+#define NXT_ROUTER_BODY_STREAM_BUFFERS  4
+
+
+nxt_inline size_t
+nxt_router_body_stream_window(nxt_http_request_t *r)
+{
+    return NXT_ROUTER_BODY_STREAM_BUFFERS
+           * r->conf->socket_conf->body_buffer_size;
+}
+
+
+static void
+nxt_router_app_body_stream(nxt_task_t *task, void *obj, void *data)
+{
+    u_char                  *pos;
+    size_t                  size, copy_size;
+    nxt_int_t               res;
+    nxt_buf_t               *in, *b, *out, **tail;
+    nxt_http_request_t      *r;
+    nxt_request_rpc_data_t  *req_rpc_data;
+
+    r = obj;
+    in = data;
+
+    req_rpc_data = r->req_rpc_data;
+
+    if (nxt_slow_path(req_rpc_data == NULL
+                      || req_rpc_data->app_port == NULL))
+    {
+        return;
+    }
+
+    if (in == NULL) {
+        /* The client connection has failed while the body was streamed. */
+        nxt_request_rpc_data_unlink(task, req_rpc_data);
+        return;
+    }
+
+    out = NULL;
+    tail = &out;
+
+    pos = in->mem.pos;
+    size = nxt_buf_mem_used_size(&in->mem);
+
+    nxt_debug(task, "stream #%uD: send body part %uz bytes",
+              req_rpc_data->stream, size);
+
+    while (size != 0) {
+        copy_size = nxt_min(size, nxt_port_mmap_data_size(
+                                      &req_rpc_data->app->outgoing));
+
+        b = nxt_port_mmap_get_buf(task, &req_rpc_data->app->outgoing,
+                                  copy_size);
+        if (nxt_slow_path(b == NULL)) {
+            goto fail;
+        }
+
+        b->mem.free = nxt_cpymem(b->mem.free, pos, copy_size);
+
+        *tail = b;
+        tail = &b->next;
+
+        pos += copy_size;
+        size -= copy_size;
+    }
+
+    size = pos - in->mem.pos;
+    in->mem.pos = pos;
+
+    res = nxt_port_socket_write(task, req_rpc_data->app_port,
+                                NXT_PORT_MSG_REQ_BODY, -1,
+                                req_rpc_data->stream,
+                                task->thread->engine->port->id, out);
+    if (nxt_slow_path(res != NXT_OK)) {
+        out = NULL;
+        goto fail;
+    }
+
+    req_rpc_data->body_unacked += size;
+
+    if (r->body_stream
+        && req_rpc_data->body_unacked < nxt_router_body_stream_window(r))
+    {
+        nxt_http_request_body_stream(task, r, nxt_router_app_body_stream);
+        return;
+    }
+
+    nxt_debug(task, "stream #%uD: body stream %s, %uz bytes unacked",
+              req_rpc_data->stream, r->body_stream ? "paused" : "done",
+              req_rpc_data->body_unacked);
+
+    req_rpc_data->body_paused = r->body_stream;
+
+    /* The application is responsible for the delay from now on. */
+
+    if (req_rpc_data->app->timeout != 0) {
+        r->timer.handler = nxt_router_app_timeout;
+        r->timer_data = req_rpc_data;
+        nxt_timer_add(task->thread->engine, &r->timer,
+                      req_rpc_data->app->timeout);
+    }
+
+    return;
+
+fail:
+
+    while (out != NULL) {
+        b = out->next;
+        out->next = NULL;
+        out->completion_handler(task, out, out->parent);
+        out = b;
+    }
+
+    nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+}
+
+
+/*
+ * The SHM_ACK message of a request stream reports the amount of the
+ * streamed body consumed by the application.
+ */
+
+static void
+nxt_router_app_body_ack(nxt_task_t *task, nxt_port_recv_msg_t *msg,
+    nxt_request_rpc_data_t *req_rpc_data)
+{
+    uint32_t            size;
+    nxt_http_request_t  *r;
+
+    if (nxt_slow_path(msg->size != sizeof(uint32_t))) {
+        nxt_alert(task, "stream #%uD: invalid body ack size %uz",
+                  req_rpc_data->stream, msg->size);
+        return;
+    }
+
+    nxt_memcpy(&size, msg->buf->mem.pos, sizeof(uint32_t));
+
+    size = nxt_min(size, req_rpc_data->body_unacked);
+    req_rpc_data->body_unacked -= size;
+
+    r = req_rpc_data->request;
+
+    nxt_debug(task, "stream #%uD: body ack %uD bytes, %uz bytes unacked",
+              req_rpc_data->stream, size, req_rpc_data->body_unacked);
+
+    if (req_rpc_data->body_paused
+        && req_rpc_data->body_unacked < nxt_router_body_stream_window(r))
+    {
+        req_rpc_data->body_paused = 0;
+
+        nxt_timer_delete(task->thread->engine, &r->timer);
+
+        nxt_http_request_body_stream(task, r, nxt_router_app_body_stream);
+    }
+}
+
+
 static const nxt_http_request_state_t  nxt_http_request_send_state
     nxt_aligned(64) =
 {
@@ -4514,6 +6624,7 @@ nxt_router_app_port_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     nxt_bool_t           start_process, restarted;
     nxt_port_t           *port;
     nxt_app_joint_t      *app_joint;
+    nxt_app_restart_t    *restart;
     nxt_app_joint_rpc_t  *app_joint_rpc;
 
     nxt_assert(data != NULL);
@@ -4538,6 +6649,30 @@ nxt_router_app_port_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         return;
     }
 
+    if (app_joint_rpc->warm) {
+        restart = app->restart;
+
+        if (restart != NULL
+            && restart->generation == app_joint_rpc->generation)
+        {
+            nxt_router_app_restart_port_ready(task, restart, port,
+                                              app_joint_rpc->proto);
+            return;
+        }
+
+        if (app_joint_rpc->proto
+            || app->generation != app_joint_rpc->generation)
+        {
+            nxt_debug(task, "port ready for aborted restart, send QUIT");
+
+            nxt_port_socket_write(task, port, NXT_PORT_MSG_QUIT, -1, 0, 0,
+                                  NULL);
+            return;
+        }
+
+        /* The restart has been committed while the process was starting. */
+    }
+
     nxt_thread_mutex_lock(&app->mutex);
 
     restarted = (app->generation != app_joint_rpc->generation);
@@ -4629,9 +6764,9 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
     nxt_app_t            *app;
+    nxt_bool_t           cancel;
     nxt_app_joint_t      *app_joint;
-    nxt_queue_link_t     *link;
-    nxt_http_request_t   *r;
+    nxt_app_restart_t    *restart;
     nxt_app_joint_rpc_t  *app_joint_rpc;
 
     nxt_assert(data != NULL);
@@ -4653,7 +6788,23 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
     nxt_debug(task, "app '%V' %p start error", &app->name, app);
 
-    link = NULL;
+    if (app_joint_rpc->warm) {
+        restart = app->restart;
+
+        if (restart != NULL
+            && restart->generation == app_joint_rpc->generation)
+        {
+            nxt_router_app_restart_port_error(task, restart,
+                                              app_joint_rpc->proto);
+            return;
+        }
+
+        if (app_joint_rpc->proto
+            || app->generation != app_joint_rpc->generation)
+        {
+            return;
+        }
+    }
 
     nxt_thread_mutex_lock(&app->mutex);
 
@@ -4661,35 +6812,86 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
     app->pending_processes--;
 
-    if (app->processes == 0 && !nxt_queue_is_empty(&app->ack_waiting_req)) {
-        link = nxt_queue_first(&app->ack_waiting_req);
+    cancel = (app->processes == 0 && app->pending_processes == 0);
+
+    nxt_thread_mutex_unlock(&app->mutex);
 
-        nxt_queue_remove(link);
-        link->next = NULL;
+    if (cancel) {
+        nxt_router_app_requests_cancel(task, app);
     }
+}
 
-    nxt_thread_mutex_unlock(&app->mutex);
 
-    while (link != NULL) {
-        r = nxt_container_of(link, nxt_http_request_t, app_link);
+/*
+ * Requests waiting for an acknowledgement are linked in the queues
+ * of their engines, so each engine cancels its own requests.
+ */
 
-        nxt_event_engine_post(r->engine, &r->err_work);
+static void
+nxt_router_app_requests_cancel(nxt_task_t *task, nxt_app_t *app)
+{
+    nxt_runtime_t       *rt;
+    nxt_event_engine_t  *engine;
 
-        link = NULL;
+    rt = task->thread->runtime;
 
-        nxt_thread_mutex_lock(&app->mutex);
+    nxt_queue_each(engine, &rt->engines, nxt_event_engine_t, link) {
 
-        if (app->processes == 0 && app->pending_processes == 0
-            && !nxt_queue_is_empty(&app->ack_waiting_req))
-        {
-            link = nxt_queue_first(&app->ack_waiting_req);
+        if (engine->port == NULL) {
+            continue;
+        }
+
+        nxt_router_app_use(task, app, 1);
 
-            nxt_queue_remove(link);
-            link->next = NULL;
+        if (nxt_port_post(task, engine->port,
+                          nxt_router_app_requests_cancel_handler, app)
+            != NXT_OK)
+        {
+            nxt_router_app_use(task, app, -1);
         }
 
-        nxt_thread_mutex_unlock(&app->mutex);
+    } nxt_queue_loop;
+}
+
+
+static void
+nxt_router_app_requests_cancel_handler(nxt_task_t *task, nxt_port_t *port,
+    void *data)
+{
+    nxt_app_t               *app;
+    nxt_bool_t              cancel;
+    nxt_http_request_t      *r;
+    nxt_event_engine_t      *engine;
+    nxt_request_rpc_data_t  *req_rpc_data;
+
+    app = data;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    /* A process may have been started since the error. */
+    cancel = (app->processes == 0 && app->pending_processes == 0);
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    engine = task->thread->engine;
+
+    if (cancel) {
+        nxt_queue_each(r, &engine->app_requests, nxt_http_request_t,
+                       app_link)
+        {
+            req_rpc_data = r->req_rpc_data;
+
+            if (req_rpc_data != NULL && req_rpc_data->app == app) {
+                nxt_queue_remove(&r->app_link);
+                r->app_link.next = NULL;
+
+                nxt_event_engine_post(engine, &r->err_work);
+            }
+
+        } nxt_queue_loop;
     }
+
+    nxt_router_app_use(task, app, -1);
 }
 
 
@@ -4765,10 +6967,11 @@ static void
 nxt_router_app_port_release(nxt_task_t *task, nxt_app_t *app, nxt_port_t *port,
     nxt_apr_action_t action)
 {
-    int         inc_use;
-    uint32_t    got_response, dec_requests;
-    nxt_bool_t  adjust_idle_timer;
-    nxt_port_t  *main_app_port;
+    int                inc_use;
+    uint32_t           got_response, dec_requests;
+    nxt_bool_t         adjust_idle_timer;
+    nxt_port_t         *main_app_port;
+    nxt_atomic_uint_t  n, active;
 
     nxt_assert(port != NULL);
 
@@ -4799,22 +7002,50 @@ nxt_router_app_port_release(nxt_task_t *task, nxt_app_t *app, nxt_port_t *port,
               port->pid, port->id,
               (int) inc_use, (int) got_response);
 
-    if (port->id == NXT_SHARED_PORT_ID) {
-        nxt_thread_mutex_lock(&app->mutex);
+    n = got_response + dec_requests;
+
+    if (n != 0) {
+        nxt_atomic_fetch_add(&app->active_requests, -n);
+    }
 
-        app->active_requests -= got_response + dec_requests;
+    if (port->id == NXT_SHARED_PORT_ID) {
 
-        nxt_thread_mutex_unlock(&app->mutex);
+        if (app->scaling_enabled && n != 0) {
+            /* The request has left the queue without being picked. */
+            nxt_atomic_fetch_add(&app->scaling.queued, -n);
+        }
 
         goto adjust_use;
     }
 
     main_app_port = port->main_app_port;
 
-    nxt_thread_mutex_lock(&app->mutex);
+    if (n != 0) {
+        active = nxt_atomic_fetch_add(&main_app_port->active_requests, -n)
+                 - n;
+
+    } else {
+        active = main_app_port->active_requests;
+    }
 
-    main_app_port->active_requests -= got_response + dec_requests;
-    app->active_requests -= got_response + dec_requests;
+    /*
+     * The ports queues are changed only when the process has no active
+     * requests left, so a busy process is released without the mutex.
+     * The link is changed under the mutex by other threads: a port seen
+     * unlinked is tested again under the mutex, and a port unlinked after
+     * the test has been removed from the application and must not be
+     * linked again anyway.
+     */
+
+    if (active != 0 && nxt_atomic_load(&main_app_port->app_link.next) != NULL)
+    {
+        nxt_debug(task, "app '%V' %p port %p has %uA active requests",
+                  &app->name, app, main_app_port, active);
+
+        goto adjust_use;
+    }
+
+    nxt_thread_mutex_lock(&app->mutex);
 
     if (main_app_port->pair[1] != -1 && main_app_port->app_link.next == NULL) {
         nxt_queue_insert_tail(&app->ports, &main_app_port->app_link);
@@ -4906,6 +7137,14 @@ nxt_router_app_port_close(nxt_task_t *task, nxt_port_t *port)
         return;
     }
 
+    if (port->main_app_port == NULL) {
+        nxt_thread_mutex_unlock(&app->mutex);
+
+        nxt_router_app_restart_port_close(task, app, port);
+
+        return;
+    }
+
     nxt_port_hash_remove(&app->port_hash, port);
     app->port_hash_count--;
 
@@ -5020,6 +7259,17 @@ nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj, void *data)
             break;
         }
 
+        if (app->scaling_enabled
+            && !nxt_router_app_can_scale_down(app, engine->timers.now))
+        {
+            nxt_debug(task, "app '%V' keep idle processes, %uA queued",
+                      &app->name, app->scaling.queued);
+
+            timeout = threshold + nxt_max(app->scaling.cooldown,
+                                          NXT_APP_SCALING_SAMPLE_TTL);
+            break;
+        }
+
         nxt_queue_remove(lnk);
         lnk->next = NULL;
 
@@ -5035,6 +7285,10 @@ nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj, void *data)
         app->processes--;
         port->app = NULL;
 
+        if (app->scaling_enabled) {
+            app->scaling.retired++;
+        }
+
         nxt_thread_mutex_unlock(&app->mutex);
 
         nxt_debug(task, "app '%V' send QUIT to idle port %PI",
@@ -5123,7 +7377,14 @@ nxt_router_free_app(nxt_task_t *task, void *obj, void *data)
 
         nxt_port_close(task, port);
 
-        nxt_port_use(task, port, -1);
+        /*
+         * Only the process main ports are referenced by the application.
+         * The other ports are added by nxt_router_new_port_handler()
+         * without a reference and are released with their process.
+         */
+        if (port->id == 0) {
+            nxt_port_use(task, port, -1);
+        }
     }
 
     proto_port = app->proto_port;
@@ -5187,36 +7448,59 @@ static void
 nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
     nxt_request_rpc_data_t *req_rpc_data)
 {
-    nxt_bool_t          start_process;
+    nxt_uint_t          start_processes;
+    nxt_msec_t          now;
     nxt_port_t          *port;
     nxt_http_request_t  *r;
 
-    start_process = 0;
-
-    nxt_thread_mutex_lock(&app->mutex);
+    start_processes = 0;
 
+    /*
+     * The shared port is read without the mutex, a replaced port
+     * is released by nxt_router_shared_port_retire() only after all
+     * engines have passed through their work queues.
+     */
     port = app->shared_port;
     nxt_port_inc_use(port);
 
-    app->active_requests++;
+    nxt_atomic_fetch_add(&app->active_requests, 1);
 
-    if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
-        app->pending_processes++;
-        start_process = 1;
+    now = task->thread->engine->timers.now;
+
+    if (app->scaling_enabled) {
+        nxt_atomic_fetch_add(&app->scaling.queued, 1);
+        req_rpc_data->queued = nxt_thread_monotonic_time(task->thread);
+    }
+
+    if (nxt_router_app_can_start(app)
+        && (nxt_router_app_need_start(app)
+            || nxt_router_app_need_scale_up(app, now)))
+    {
+        nxt_thread_mutex_lock(&app->mutex);
+
+        if (nxt_router_app_can_start(app) && nxt_router_app_need_start(app)) {
+            app->pending_processes++;
+            start_processes = 1;
+        }
+
+        if (nxt_router_app_need_scale_up(app, now)) {
+            start_processes = nxt_router_app_scale_up(task, app, now,
+                                                      start_processes);
+        }
+
+        nxt_thread_mutex_unlock(&app->mutex);
     }
 
     r = req_rpc_data->request;
 
     /*
-     * Put request into application-wide list to be able to cancel request
+     * Put request into the engine list to be able to cancel request
      * if something goes wrong with application processes.
      */
-    nxt_queue_insert_tail(&app->ack_waiting_req, &r->app_link);
-
-    nxt_thread_mutex_unlock(&app->mutex);
+    nxt_queue_insert_tail(&task->thread->engine->app_requests, &r->app_link);
 
     /*
-     * Retain request memory pool while request is linked in ack_waiting_req
+     * Retain request memory pool while request is linked in app_requests
      * to guarantee request structure memory is accessble.
      */
     nxt_mp_retain(r->mem_pool);
@@ -5224,9 +7508,65 @@ nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
     req_rpc_data->app_port = port;
     req_rpc_data->apr_action = NXT_APR_REQUEST_FAILED;
 
-    if (start_process) {
+    while (start_processes != 0) {
         nxt_router_start_app_process(task, app);
+        start_processes--;
+    }
+}
+
+
+/*
+ * Starts up to "step" processes at once, including the already
+ * counted ones; the application mutex must be locked.
+ */
+
+static nxt_uint_t
+nxt_router_app_scale_up(nxt_task_t *task, nxt_app_t *app, nxt_msec_t now,
+    nxt_uint_t n)
+{
+    nxt_uint_t  prev;
+
+    prev = n;
+
+    app->scaling.last_scale = now;
+
+    while (n < app->scaling.step && nxt_router_app_can_start(app)) {
+        app->pending_processes++;
+        n++;
     }
+
+    app->scaling.started += n - prev;
+
+    nxt_debug(task, "app '%V' scale up by %ui processes, "
+              "%uA queued, queue wait %uius",
+              &app->name, n - prev, app->scaling.queued,
+              nxt_router_app_queue_wait(app, now));
+
+    return n;
+}
+
+
+/* Accounts the wait of a request picked by a process from the queue. */
+
+static void
+nxt_router_app_queue_sample(nxt_task_t *task, nxt_app_t *app,
+    nxt_request_rpc_data_t *req_rpc_data)
+{
+    nxt_atomic_int_t  sample, wait;
+
+    nxt_atomic_fetch_add(&app->scaling.queued, -1);
+
+    sample = (nxt_thread_monotonic_time(task->thread) - req_rpc_data->queued)
+             / 1000;
+
+    /*
+     * Engines update the average without a lock, a lost update
+     * only drops one sample.
+     */
+
+    wait = app->scaling.wait;
+    app->scaling.wait = wait + (sample - wait) / 8;
+    app->scaling.last_sample = task->thread->engine->timers.now;
 }
 
 
@@ -5243,6 +7583,11 @@ nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
 
     r->app_target = conf->target;
 
+    nxt_router_metric_release(r->target_metric);
+
+    r->target_metric = nxt_router_metric(engine, NXT_STATUS_METRIC_APP,
+                                         &conf->app->name);
+
     req_rpc_data = nxt_port_rpc_register_handler_ex(task, engine->port,
                                           nxt_router_response_ready_handler,
                                           nxt_router_response_error_handler,
@@ -5485,7 +7830,7 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
     void                *target_pos, *query_pos;
     u_char              *pos, *end, *p, c;
     size_t              fields_count, req_size, size, free_size;
-    size_t              copy_size;
+    size_t              copy_size, data_size;
     nxt_off_t           content_length;
     nxt_buf_t           *b, *buf, *out, **tail;
     nxt_http_field_t    *field, *dup;
@@ -5515,15 +7860,20 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
 
     req_size += fields_count * sizeof(nxt_unit_field_t);
 
-    if (nxt_slow_path(req_size > PORT_MMAP_DATA_SIZE)) {
+    data_size = nxt_port_mmap_data_size(&app->outgoing);
+
+    if (nxt_slow_path(req_size > data_size)) {
         nxt_alert(task, "headers to big to fit in shared memory (%d)",
                   (int) req_size);
 
         return NULL;
     }
 
+    /* A streamed body is sent in separate messages. */
+    size = r->body_stream ? 0 : content_length;
+
     out = nxt_port_mmap_get_buf(task, &app->outgoing,
-              nxt_min(req_size + content_length, PORT_MMAP_DATA_SIZE));
+                                 nxt_min(req_size + size, data_size));
     if (nxt_slow_path(out == NULL)) {
         return NULL;
     }
@@ -5568,6 +7918,7 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
 
     req->tls = r->tls;
     req->websocket_handshake = r->websocket_handshake;
+    req->content_stream = r->body_stream;
 
     req->server_name_length = r->server_name.length;
     nxt_unit_sptr_set(&req->server_name, p);
@@ -5712,7 +8063,8 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
 
         while (size > 0) {
             if (buf == NULL) {
-                free_size = nxt_min(size, PORT_MMAP_DATA_SIZE);
+                free_size = nxt_min(size, nxt_port_mmap_data_size(
+                                              &app->outgoing));
 
                 buf = nxt_port_mmap_get_buf(task, &app->outgoing, free_size);
                 if (nxt_slow_path(buf == NULL)) {
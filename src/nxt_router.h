@@ -21,8 +21,14 @@ typedef struct nxt_http_routes_s               nxt_http_routes_t;
 typedef struct nxt_http_forward_s              nxt_http_forward_t;
 typedef struct nxt_upstream_s                  nxt_upstream_t;
 typedef struct nxt_upstreams_s                 nxt_upstreams_t;
+typedef struct nxt_upstreams_health_s          nxt_upstreams_health_t;
 typedef struct nxt_router_access_log_s         nxt_router_access_log_t;
 typedef struct nxt_router_access_log_format_s  nxt_router_access_log_format_t;
+typedef struct nxt_router_access_log_buffer_s  nxt_router_access_log_buffer_t;
+typedef struct nxt_router_metric_s             nxt_router_metric_t;
+typedef struct nxt_http_static_cache_s         nxt_http_static_cache_t;
+typedef struct nxt_http_cache_s                nxt_http_cache_t;
+typedef struct nxt_http_limit_zone_s           nxt_http_limit_zone_t;
 
 
 #define NXT_HTTP_ACTION_ERROR  ((nxt_http_action_t *) -1)
@@ -34,14 +40,26 @@ typedef struct {
 
     nxt_queue_t              sockets;  /* of nxt_socket_conf_t */
     nxt_queue_t              apps;     /* of nxt_app_t */
+    nxt_queue_t              caches;   /* of nxt_http_cache_t */
+    nxt_queue_t              limits;   /* of nxt_http_limit_zone_t */
 
     nxt_router_access_log_t  *access_log;
+    nxt_upstreams_health_t   *upstreams_health;
 } nxt_router_t;
 
 
+typedef struct {
+    uint32_t                 max_entries;
+    uint32_t                 min_uses;
+    nxt_msec_t               valid;
+    uint8_t                  errors;      /* 1 bit */
+} nxt_http_static_cache_conf_t;
+
+
 typedef struct {
     uint32_t                        count;
     uint32_t                        threads;
+    nxt_array_t                     *cpus;  /* of uint32_t */
 
     nxt_mp_t                        *mem_pool;
     nxt_tstr_state_t                *tstr_state;
@@ -52,6 +70,11 @@ typedef struct {
 
     nxt_lvlhsh_t                    mtypes_hash;
     nxt_lvlhsh_t                    apps_hash;
+    nxt_lvlhsh_t                    metric_names;
+
+    nxt_http_static_cache_conf_t    open_file_cache;
+    nxt_array_t                     *caches;  /* of nxt_http_cache_t * */
+    nxt_array_t                     *limits;  /* of nxt_http_limit_zone_t * */
 
     nxt_tstr_cond_t                 log_cond;
     nxt_router_access_log_t         *access_log;
@@ -110,6 +133,25 @@ typedef struct {
 } nxt_app_joint_t;
 
 
+typedef struct nxt_app_restart_s  nxt_app_restart_t;
+
+
+typedef struct {
+    nxt_msec_t             queue_wait;  /* Scale up threshold. */
+    uint32_t               backlog;     /* Queued requests per process. */
+    uint32_t               step;
+    nxt_msec_t             cooldown;
+
+    nxt_atomic_t           queued;
+    nxt_atomic_t           wait;        /* EWMA of queue wait, usec. */
+    nxt_msec_t             last_sample;
+    nxt_msec_t             last_scale;
+
+    uint32_t               started;
+    uint32_t               retired;
+} nxt_app_scaling_t;
+
+
 struct nxt_app_s {
     nxt_thread_mutex_t     mutex;       /* Protects ports queue. */
     nxt_queue_t            ports;       /* of nxt_port_t.app_link */
@@ -124,7 +166,7 @@ struct nxt_app_s {
 
     uint32_t               port_hash_count;
 
-    uint32_t               active_requests;
+    nxt_atomic_t           active_requests;
     uint32_t               pending_processes;
     uint32_t               processes;
     uint32_t               idle_processes;
@@ -134,6 +176,7 @@ struct nxt_app_s {
     uint32_t               max_pending_processes;
 
     uint32_t               generation;
+    uint32_t               last_generation;
     uint32_t               proto_port_requests;
 
     nxt_msec_t             timeout;
@@ -141,7 +184,17 @@ struct nxt_app_s {
 
     nxt_str_t              *targets;
 
+    nxt_str_t              *warmup;
+    uint32_t               nwarmup;
+    nxt_msec_t             warm_timeout;
+    nxt_str_t              warm_host;
+    nxt_sockaddr_t         *warm_address;
+
+    uint32_t               spin_wait;        /* usec */
+
     nxt_app_type_t         type:8;
+    uint8_t                scaling_enabled;  /* 1 bit */
+    uint8_t                warm_restart;     /* 1 bit */
 
     nxt_mp_t               *mem_pool;
     nxt_queue_link_t       link;
@@ -149,13 +202,17 @@ struct nxt_app_s {
     nxt_str_t              conf;
 
     nxt_atomic_t           use_count;
-    nxt_queue_t            ack_waiting_req; /* of nxt_http_request_t.app_link */
 
     nxt_app_joint_t        *joint;
     nxt_port_t             *shared_port;
     nxt_port_t             *proto_port;
 
+    /* Accessed only by the router main thread. */
+    nxt_app_restart_t      *restart;
+
     nxt_port_mmaps_t       outgoing;
+
+    nxt_app_scaling_t      scaling;
 };
 
 
@@ -166,6 +223,13 @@ typedef struct {
 } nxt_websocket_conf_t;
 
 
+typedef struct {
+    uint32_t               max_idle;
+    uint32_t               max_requests;
+    nxt_msec_t             idle_timeout;
+} nxt_proxy_keepalive_conf_t;
+
+
 typedef struct {
     uint32_t               count;
     nxt_queue_link_t       link;
@@ -181,6 +245,7 @@ typedef struct {
     nxt_sockaddr_t         *sockaddr;
 
     nxt_listen_socket_t    *listen;
+    nxt_str_t              name;
 
     size_t                 header_buffer_size;
     size_t                 large_header_buffer_size;
@@ -200,6 +265,7 @@ typedef struct {
     nxt_msec_t             proxy_read_timeout;
 
     nxt_websocket_conf_t   websocket_conf;
+    nxt_proxy_keepalive_conf_t  proxy_keepalive_conf;
 
     nxt_str_t              body_temp_path;
 
@@ -209,6 +275,8 @@ typedef struct {
 
     uint8_t                server_version;         /* 1 bit */
     uint8_t                chunked_transform;      /* 1 bit */
+    uint8_t                body_stream;            /* 1 bit */
+    uint8_t                http2;                  /* 1 bit */
 
     nxt_http_forward_t     *forwarded;
     nxt_http_forward_t     *client_ip;
@@ -223,11 +291,15 @@ typedef struct {
     uint32_t               count;
     nxt_queue_link_t       link;
     nxt_event_engine_t     *engine;
+    /* The engine index selects a SO_REUSEPORT socket. */
+    uint32_t               index;
     nxt_socket_conf_t      *socket_conf;
 
     nxt_joint_job_t        *close_job;
 
     nxt_upstream_t         **upstreams;
+    nxt_http_static_cache_t  *static_cache;
+    nxt_router_metric_t    *metric;
 
     /* Modules configuraitons. */
 } nxt_socket_conf_joint_t;
@@ -240,6 +312,9 @@ struct nxt_router_access_log_s {
     nxt_fd_t               fd;
     nxt_str_t              path;
     uint32_t               count;
+
+    /* Buffered records dropped while the writer fell behind. */
+    nxt_atomic_t           dropped;
 };
 
 
@@ -262,9 +337,20 @@ void nxt_router_access_log_use(nxt_thread_spinlock_t *lock,
     nxt_router_access_log_t *access_log);
 void nxt_router_access_log_release(nxt_task_t *task,
     nxt_thread_spinlock_t *lock, nxt_router_access_log_t *access_log);
+void nxt_router_access_log_buffer_free(nxt_task_t *task,
+    nxt_event_engine_t *engine);
 void nxt_router_access_log_reopen_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg);
 
+nxt_router_metric_t *nxt_router_metric(nxt_event_engine_t *engine,
+    nxt_uint_t type, nxt_str_t *name);
+void nxt_router_metric_release(nxt_router_metric_t *metric);
+void nxt_router_metrics_request(nxt_task_t *task, nxt_http_request_t *r);
+nxt_int_t nxt_router_metric_conf(nxt_router_conf_t *rtcf, nxt_uint_t type,
+    nxt_str_t *name);
+void nxt_router_metrics_prune(nxt_task_t *task, nxt_router_conf_t *rtcf);
+void nxt_router_metrics_free(nxt_event_engine_t *engine);
+
 
 extern nxt_router_t  *nxt_router;
 
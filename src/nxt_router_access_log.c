@@ -14,15 +14,59 @@ typedef struct {
     nxt_str_t                       path;
     nxt_conf_value_t                *format;
     nxt_conf_value_t                *expr;
+    size_t                          buffer;
+    nxt_msec_t                      flush;
+    uint8_t                         offload;
 } nxt_router_access_log_conf_t;
 
 
 typedef struct {
     nxt_str_t                       text;
     nxt_router_access_log_t         *access_log;
+    nxt_router_access_log_format_t  *format;
 } nxt_router_access_log_ctx_t;
 
 
+/*
+ * A block of buffered records.  The header is used when the block
+ * is passed to a thread pool to be written.
+ */
+
+typedef struct {
+    nxt_task_t                      task;
+    nxt_work_t                      work;
+    nxt_router_access_log_t         *access_log;
+    nxt_router_access_log_buffer_t  *buffer;
+    size_t                          length;
+} nxt_router_access_log_block_t;
+
+
+/*
+ * Each engine buffers records of one access log at a time.  The buffer
+ * holds a reference to the access log while it has records, and is
+ * flushed when it is full, when the "flush" time has passed since the
+ * first record, or when a record for another access log arrives.
+ */
+
+struct nxt_router_access_log_buffer_s {
+    nxt_router_access_log_t         *access_log;
+    nxt_router_access_log_block_t   *block;
+
+    u_char                          *start;
+    u_char                          *pos;
+    u_char                          *end;
+
+    nxt_timer_t                     timer;
+    nxt_msec_t                      flush;
+    nxt_uint_t                      dropped;
+
+    /* The engine and a block being written by a thread pool. */
+    nxt_atomic_t                    count;
+
+    uint8_t                         offload;  /* 1 bit */
+};
+
+
 typedef struct {
     nxt_str_t                       name;
     nxt_tstr_t                      *tstr;
@@ -33,6 +77,10 @@ struct nxt_router_access_log_format_s {
     nxt_tstr_t                      *tstr;
     nxt_uint_t                      nmembers;
     nxt_router_access_log_member_t  *member;
+
+    size_t                          buffer;
+    nxt_msec_t                      flush;
+    uint8_t                         offload;  /* 1 bit */
 };
 
 
@@ -48,6 +96,21 @@ static nxt_int_t nxt_router_access_log_json(nxt_task_t *task,
     nxt_router_access_log_format_t *format);
 static void nxt_router_access_log_write(nxt_task_t *task, nxt_http_request_t *r,
     nxt_router_access_log_ctx_t *ctx);
+static void nxt_router_access_log_buffer(nxt_task_t *task,
+    nxt_router_access_log_ctx_t *ctx);
+static nxt_int_t nxt_router_access_log_block_alloc(
+    nxt_router_access_log_buffer_t *lb, size_t size);
+static void nxt_router_access_log_flush_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_flush(nxt_task_t *task,
+    nxt_router_access_log_buffer_t *lb, nxt_bool_t sync);
+static void nxt_router_access_log_wait(nxt_router_access_log_buffer_t *lb);
+static nxt_int_t nxt_router_access_log_offload(nxt_task_t *task,
+    nxt_router_access_log_buffer_t *lb);
+static void nxt_router_access_log_block_write(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_access_log_buffer_release(
+    nxt_router_access_log_buffer_t *lb);
 static void nxt_router_access_log_ready(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static void nxt_router_access_log_error(nxt_task_t *task,
@@ -78,6 +141,24 @@ static nxt_conf_map_t  nxt_router_access_log_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_router_access_log_conf_t, expr),
     },
+
+    {
+        nxt_string("buffer"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_router_access_log_conf_t, buffer),
+    },
+
+    {
+        nxt_string("flush"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_router_access_log_conf_t, flush),
+    },
+
+    {
+        nxt_string("offload"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_access_log_conf_t, offload),
+    },
 };
 
 
@@ -93,6 +174,8 @@ nxt_router_access_log_create(nxt_task_t *task, nxt_router_conf_t *rtcf,
 
     nxt_memzero(&alcf, sizeof(nxt_router_access_log_conf_t));
 
+    alcf.flush = 1000;
+
     if (nxt_conf_type(value) == NXT_CONF_STRING) {
         nxt_conf_get_string(value, &alcf.path);
 
@@ -125,6 +208,7 @@ nxt_router_access_log_create(nxt_task_t *task, nxt_router_conf_t *rtcf,
         access_log->fd = -1;
         access_log->handler = &nxt_router_access_log_writer;
         access_log->count = 1;
+        access_log->dropped = 0;
 
         access_log->path.length = alcf.path.length;
         access_log->path.start = (u_char *) access_log
@@ -141,6 +225,10 @@ nxt_router_access_log_create(nxt_task_t *task, nxt_router_conf_t *rtcf,
         return NXT_ERROR;
     }
 
+    rtcf->log_format->buffer = alcf.buffer;
+    rtcf->log_format->flush = alcf.flush;
+    rtcf->log_format->offload = alcf.offload;
+
     if (alcf.expr != NULL) {
         nxt_conf_get_string(alcf.expr, &str);
 
@@ -273,6 +361,7 @@ nxt_router_access_log_writer(nxt_task_t *task, nxt_http_request_t *r,
     }
 
     ctx->access_log = access_log;
+    ctx->format = format;
 
     if (format->tstr != NULL) {
         ret = nxt_router_access_log_text(task, r, ctx, format->tstr);
@@ -380,12 +469,360 @@ static void
 nxt_router_access_log_write(nxt_task_t *task, nxt_http_request_t *r,
     nxt_router_access_log_ctx_t *ctx)
 {
-    nxt_fd_write(ctx->access_log->fd, ctx->text.start, ctx->text.length);
+    nxt_router_access_log_buffer_t  *lb;
+
+    if (ctx->format->buffer == 0) {
+        lb = task->thread->engine->access_log_buffer;
+
+        if (lb != NULL) {
+            /* Records buffered by a previous configuration go first. */
+            nxt_router_access_log_flush(task, lb, 1);
+        }
+
+        nxt_fd_write(ctx->access_log->fd, ctx->text.start, ctx->text.length);
+
+    } else {
+        nxt_router_access_log_buffer(task, ctx);
+    }
 
     nxt_http_request_close_handler(task, r, r->proto.any);
 }
 
 
+static void
+nxt_router_access_log_buffer(nxt_task_t *task, nxt_router_access_log_ctx_t *ctx)
+{
+    size_t                          size, length;
+    ssize_t                         n;
+    nxt_iobuf_t                     iov[2];
+    nxt_event_engine_t              *engine;
+    nxt_router_access_log_t         *access_log;
+    nxt_router_access_log_buffer_t  *lb;
+
+    engine = task->thread->engine;
+    access_log = ctx->access_log;
+    length = ctx->text.length;
+
+    lb = engine->access_log_buffer;
+
+    if (lb == NULL) {
+        lb = nxt_zalloc(sizeof(nxt_router_access_log_buffer_t));
+        if (nxt_slow_path(lb == NULL)) {
+            nxt_fd_write(access_log->fd, ctx->text.start, length);
+            return;
+        }
+
+        lb->count = 1;
+
+        lb->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+        lb->timer.work_queue = &engine->fast_work_queue;
+        lb->timer.handler = nxt_router_access_log_flush_handler;
+        lb->timer.task = &engine->task;
+        lb->timer.log = engine->task.log;
+
+        engine->access_log_buffer = lb;
+    }
+
+    if (lb->access_log != access_log) {
+        nxt_router_access_log_flush(task, lb, 1);
+
+        nxt_router_access_log_use(&nxt_router->lock, access_log);
+        lb->access_log = access_log;
+    }
+
+    lb->flush = ctx->format->flush;
+    lb->offload = ctx->format->offload;
+
+    size = nxt_max(ctx->format->buffer, length);
+
+    if (lb->pos == lb->start) {
+        /* The buffer is empty, its size may have been changed. */
+
+        if (lb->block == NULL || (size_t) (lb->end - lb->start) != size) {
+            if (nxt_router_access_log_block_alloc(lb, size) != NXT_OK) {
+                nxt_router_access_log_wait(lb);
+                nxt_fd_write(access_log->fd, ctx->text.start, length);
+                return;
+            }
+        }
+
+        nxt_timer_add(engine, &lb->timer, lb->flush);
+
+    } else if ((size_t) (lb->end - lb->pos) < length) {
+
+        if (!lb->offload) {
+            /* The offload may have been turned off by reconfiguration. */
+            nxt_router_access_log_wait(lb);
+
+            nxt_iobuf_set(&iov[0], lb->start, lb->pos - lb->start);
+            nxt_iobuf_set(&iov[1], ctx->text.start, length);
+
+            n = writev(access_log->fd, iov, 2);
+
+            if (nxt_slow_path(n == -1)) {
+                nxt_alert(task, "writev(%FD) failed %E",
+                          access_log->fd, nxt_errno);
+            }
+
+            lb->pos = lb->start;
+            nxt_timer_delete(engine, &lb->timer);
+
+            return;
+        }
+
+        if (lb->count > 1) {
+            /* The previous block is still being written. */
+            lb->dropped++;
+            (void) nxt_atomic_fetch_add(&access_log->dropped, 1);
+
+            return;
+        }
+
+        if (nxt_router_access_log_offload(task, lb) != NXT_OK
+            || nxt_router_access_log_block_alloc(lb, size) != NXT_OK)
+        {
+            nxt_router_access_log_flush(task, lb, 1);
+            nxt_fd_write(access_log->fd, ctx->text.start, length);
+            return;
+        }
+
+        nxt_timer_add(engine, &lb->timer, lb->flush);
+    }
+
+    lb->pos = nxt_cpymem(lb->pos, ctx->text.start, length);
+}
+
+
+static nxt_int_t
+nxt_router_access_log_block_alloc(nxt_router_access_log_buffer_t *lb,
+    size_t size)
+{
+    nxt_router_access_log_block_t  *block;
+
+    block = nxt_malloc(sizeof(nxt_router_access_log_block_t) + size);
+    if (nxt_slow_path(block == NULL)) {
+        return NXT_ERROR;
+    }
+
+    if (lb->block != NULL) {
+        nxt_free(lb->block);
+    }
+
+    lb->block = block;
+    lb->start = nxt_pointer_to(block, sizeof(nxt_router_access_log_block_t));
+    lb->pos = lb->start;
+    lb->end = lb->start + size;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_router_access_log_flush_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t                     *timer;
+    nxt_router_access_log_buffer_t  *lb;
+
+    timer = obj;
+
+    lb = nxt_timer_data(timer, nxt_router_access_log_buffer_t, timer);
+
+    nxt_debug(task, "access log flush");
+
+    nxt_router_access_log_flush(task, lb, 0);
+}
+
+
+static void
+nxt_router_access_log_flush(nxt_task_t *task,
+    nxt_router_access_log_buffer_t *lb, nxt_bool_t sync)
+{
+    nxt_event_engine_t       *engine;
+    nxt_router_access_log_t  *access_log;
+
+    if (sync) {
+        /* The records written by the caller follow the flushed ones. */
+        nxt_router_access_log_wait(lb);
+    }
+
+    access_log = lb->access_log;
+
+    if (access_log == NULL) {
+        return;
+    }
+
+    engine = task->thread->engine;
+
+    if (lb->pos != lb->start) {
+
+        if (lb->offload && !sync) {
+
+            if (lb->count > 1) {
+                nxt_timer_add(engine, &lb->timer, lb->flush);
+                return;
+            }
+
+            if (nxt_router_access_log_offload(task, lb) == NXT_OK) {
+                goto done;
+            }
+        }
+
+        nxt_fd_write(access_log->fd, lb->start, lb->pos - lb->start);
+
+        lb->pos = lb->start;
+    }
+
+done:
+
+    nxt_timer_delete(engine, &lb->timer);
+
+    if (lb->dropped != 0) {
+        nxt_log(task, NXT_LOG_WARN, "%ui records of access log \"%V\" "
+                "were dropped", lb->dropped, &access_log->path);
+
+        lb->dropped = 0;
+    }
+
+    lb->access_log = NULL;
+
+    nxt_router_access_log_release(task, &nxt_router->lock, access_log);
+}
+
+
+/*
+ * Records written by an engine thread itself must not overtake a block
+ * being written by a thread pool.  The wait is as long as one write(2)
+ * and happens only if buffering is interrupted while a block is written.
+ */
+
+static void
+nxt_router_access_log_wait(nxt_router_access_log_buffer_t *lb)
+{
+    while (lb->count > 1) {
+        nxt_thread_yield();
+    }
+}
+
+
+static nxt_int_t
+nxt_router_access_log_offload(nxt_task_t *task,
+    nxt_router_access_log_buffer_t *lb)
+{
+    nxt_runtime_t                  *rt;
+    nxt_thread_pool_t              **tp;
+    nxt_router_access_log_block_t  *block;
+
+    rt = task->thread->runtime;
+
+    if (rt->thread_pools == NULL || rt->thread_pools->nelts == 0) {
+        return NXT_ERROR;
+    }
+
+    tp = rt->thread_pools->elts;
+
+    block = lb->block;
+
+    block->access_log = lb->access_log;
+    block->buffer = lb;
+    block->length = lb->pos - lb->start;
+
+    /* A thread pool sets its own thread in the task. */
+    block->task = task->thread->engine->task;
+
+    block->work.next = NULL;
+
+    nxt_work_set(&block->work, nxt_router_access_log_block_write,
+                 &block->task, block, NULL);
+
+    nxt_router_access_log_use(&nxt_router->lock, block->access_log);
+    (void) nxt_atomic_fetch_add(&lb->count, 1);
+
+    if (nxt_slow_path(nxt_thread_pool_post(tp[rt->thread_pools->nelts - 1],
+                                           &block->work)
+                      != NXT_OK))
+    {
+        (void) nxt_atomic_fetch_add(&lb->count, -1);
+        nxt_router_access_log_release(task, &nxt_router->lock,
+                                      block->access_log);
+        return NXT_ERROR;
+    }
+
+    lb->block = NULL;
+    lb->start = NULL;
+    lb->pos = NULL;
+    lb->end = NULL;
+
+    return NXT_OK;
+}
+
+
+/* The handler runs in a thread pool thread. */
+
+static void
+nxt_router_access_log_block_write(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_router_access_log_block_t   *block;
+    nxt_router_access_log_buffer_t  *lb;
+
+    block = obj;
+
+    nxt_fd_write(block->access_log->fd,
+                 nxt_pointer_to(block, sizeof(nxt_router_access_log_block_t)),
+                 block->length);
+
+    nxt_router_access_log_release(task, &nxt_router->lock, block->access_log);
+
+    lb = block->buffer;
+
+    nxt_free(block);
+
+    nxt_router_access_log_buffer_release(lb);
+}
+
+
+static void
+nxt_router_access_log_buffer_release(nxt_router_access_log_buffer_t *lb)
+{
+    if (nxt_atomic_fetch_add(&lb->count, -1) == 1) {
+        nxt_free(lb);
+    }
+}
+
+
+void
+nxt_router_access_log_buffer_free(nxt_task_t *task, nxt_event_engine_t *engine)
+{
+    nxt_router_access_log_buffer_t  *lb;
+
+    lb = engine->access_log_buffer;
+
+    if (lb == NULL) {
+        return;
+    }
+
+    engine->access_log_buffer = NULL;
+
+    /* The engine thread has exited, so its timer is not deleted. */
+
+    nxt_router_access_log_wait(lb);
+
+    if (lb->access_log != NULL) {
+        if (lb->pos != lb->start) {
+            nxt_fd_write(lb->access_log->fd, lb->start, lb->pos - lb->start);
+        }
+
+        nxt_router_access_log_release(task, &nxt_router->lock,
+                                      lb->access_log);
+    }
+
+    if (lb->block != NULL) {
+        nxt_free(lb->block);
+    }
+
+    nxt_router_access_log_buffer_release(lb);
+}
+
+
 void
 nxt_router_access_log_open(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 {
@@ -0,0 +1,450 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_status.h>
+
+
+/*
+ * Request metrics are kept per engine and are updated by the engine
+ * thread only, so no locks or atomic operations are required on the
+ * request path.  The metrics are keyed by name and survive router
+ * reconfiguration, until a configuration without their names is applied.
+ * New metrics are published to the list with a full barrier, and are
+ * unlinked from it under the router lock which the status handler holds
+ * while it walks the list from the main thread.  The counters read this
+ * way may be slightly inconsistent with each other.
+ *
+ * Requests and listener joints hold references to the metrics, so an
+ * unlinked metric is freed by the engine when the last one is released.
+ */
+
+#define NXT_ROUTER_METRICS_MAX  4096
+
+
+struct nxt_router_metric_s {
+    nxt_router_metric_t    *next;
+    nxt_str_t              name;
+    nxt_uint_t             type;
+    nxt_uint_t             count;
+    uint8_t                retired;  /* 1 bit */
+    nxt_status_counters_t  counters;
+};
+
+
+/* A metric name in a configuration. */
+
+typedef struct {
+    nxt_str_t              name;
+    nxt_uint_t             type;
+} nxt_router_metric_name_t;
+
+
+static nxt_int_t nxt_router_metric_test(nxt_lvlhsh_query_t *lhq, void *data);
+static nxt_int_t nxt_router_metric_name_test(nxt_lvlhsh_query_t *lhq,
+    void *data);
+static void nxt_router_metric_delete(nxt_event_engine_t *engine,
+    nxt_router_metric_t *metric);
+
+
+static const nxt_lvlhsh_proto_t  nxt_router_metrics_proto  nxt_aligned(64) = {
+    NXT_LVLHSH_DEFAULT,
+    nxt_router_metric_test,
+    nxt_lvlhsh_alloc,
+    nxt_lvlhsh_free,
+};
+
+
+static const nxt_lvlhsh_proto_t  nxt_router_metric_names_proto
+    nxt_aligned(64) =
+{
+    NXT_LVLHSH_DEFAULT,
+    nxt_router_metric_name_test,
+    nxt_mp_lvlhsh_alloc,
+    nxt_mp_lvlhsh_free,
+};
+
+
+nxt_router_metric_t *
+nxt_router_metric(nxt_event_engine_t *engine, nxt_uint_t type,
+    nxt_str_t *name)
+{
+    nxt_router_metric_t  *metric;
+    nxt_lvlhsh_query_t   lhq;
+
+    lhq.key_hash = nxt_djb_hash(name->start, name->length) + type;
+    lhq.key = *name;
+    lhq.proto = &nxt_router_metrics_proto;
+    lhq.data = (void *) (uintptr_t) type;
+
+    if (nxt_lvlhsh_find(&engine->metrics_hash, &lhq) == NXT_OK) {
+        metric = lhq.value;
+        metric->count++;
+
+        return metric;
+    }
+
+    if (engine->metrics_count >= NXT_ROUTER_METRICS_MAX) {
+        return NULL;
+    }
+
+    metric = nxt_zalloc(sizeof(nxt_router_metric_t) + name->length);
+    if (nxt_slow_path(metric == NULL)) {
+        return NULL;
+    }
+
+    metric->name.start = nxt_pointer_to(metric, sizeof(nxt_router_metric_t));
+    metric->name.length = name->length;
+    nxt_memcpy(metric->name.start, name->start, name->length);
+
+    metric->type = type;
+    metric->count = 1;
+
+    lhq.key = metric->name;
+    lhq.replace = 0;
+    lhq.value = metric;
+    lhq.pool = NULL;
+
+    if (nxt_slow_path(nxt_lvlhsh_insert(&engine->metrics_hash, &lhq)
+                      != NXT_OK))
+    {
+        nxt_free(metric);
+        return NULL;
+    }
+
+    engine->metrics_count++;
+
+    metric->next = engine->metrics;
+
+    (void) nxt_atomic_cmp_set((nxt_atomic_t *) &engine->metrics,
+                              (nxt_atomic_uint_t) metric->next,
+                              (nxt_atomic_uint_t) metric);
+
+    return metric;
+}
+
+
+void
+nxt_router_metric_release(nxt_router_metric_t *metric)
+{
+    if (metric != NULL && --metric->count == 0 && metric->retired) {
+        nxt_free(metric);
+    }
+}
+
+
+static nxt_int_t
+nxt_router_metric_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_router_metric_t  *metric;
+
+    metric = data;
+
+    if (metric->type == (uintptr_t) lhq->data
+        && nxt_strstr_eq(&lhq->key, &metric->name))
+    {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+void
+nxt_router_metrics_request(nxt_task_t *task, nxt_http_request_t *r)
+{
+    uint64_t                 latency;
+    nxt_off_t                bytes;
+    nxt_uint_t               status;
+    nxt_event_engine_t       *engine;
+    nxt_socket_conf_joint_t  *joint;
+
+    engine = task->thread->engine;
+    joint = r->conf;
+
+    if (joint->metric == NULL) {
+        joint->metric = nxt_router_metric(engine, NXT_STATUS_METRIC_LISTENER,
+                                          &joint->socket_conf->name);
+    }
+
+    latency = (nxt_thread_monotonic_time(task->thread) - r->start_time) / 1000;
+
+    bytes = 0;
+
+    if (r->proto.any != NULL) {
+        bytes = nxt_http_proto[r->protocol].body_bytes_sent(task, r->proto);
+    }
+
+    status = r->status;
+
+    if (joint->metric != NULL) {
+        nxt_status_counters_add(&joint->metric->counters, status, bytes,
+                                latency);
+    }
+
+    if (r->route_metric != NULL) {
+        nxt_status_counters_add(&r->route_metric->counters, status, bytes,
+                                latency);
+    }
+
+    if (r->target_metric != NULL) {
+        nxt_status_counters_add(&r->target_metric->counters, status, bytes,
+                                latency);
+    }
+
+    nxt_router_metric_release(r->route_metric);
+    nxt_router_metric_release(r->target_metric);
+
+    r->route_metric = NULL;
+    r->target_metric = NULL;
+}
+
+
+/*
+ * The names of the listeners, route steps, applications, and upstreams
+ * of a configuration, to delete the metrics of the removed ones.
+ */
+
+nxt_int_t
+nxt_router_metric_conf(nxt_router_conf_t *rtcf, nxt_uint_t type,
+    nxt_str_t *name)
+{
+    nxt_int_t                 ret;
+    nxt_lvlhsh_query_t        lhq;
+    nxt_router_metric_name_t  *mn;
+
+    mn = nxt_mp_get(rtcf->mem_pool, sizeof(nxt_router_metric_name_t));
+    if (nxt_slow_path(mn == NULL)) {
+        return NXT_ERROR;
+    }
+
+    mn->name = *name;
+    mn->type = type;
+
+    lhq.key_hash = nxt_djb_hash(name->start, name->length) + type;
+    lhq.key = *name;
+    lhq.replace = 0;
+    lhq.value = mn;
+    lhq.proto = &nxt_router_metric_names_proto;
+    lhq.pool = rtcf->mem_pool;
+    lhq.data = (void *) (uintptr_t) type;
+
+    ret = nxt_lvlhsh_insert(&rtcf->metric_names, &lhq);
+
+    return (ret == NXT_DECLINED) ? NXT_OK : ret;
+}
+
+
+static nxt_int_t
+nxt_router_metric_name_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_router_metric_name_t  *mn;
+
+    mn = data;
+
+    if (mn->type == (uintptr_t) lhq->data
+        && nxt_strstr_eq(&lhq->key, &mn->name))
+    {
+        return NXT_OK;
+    }
+
+    return NXT_DECLINED;
+}
+
+
+/* The function runs in the engine thread when a configuration is applied. */
+
+void
+nxt_router_metrics_prune(nxt_task_t *task, nxt_router_conf_t *rtcf)
+{
+    nxt_event_engine_t   *engine;
+    nxt_lvlhsh_query_t   lhq;
+    nxt_router_metric_t  *metric, *next, **prev;
+
+    engine = task->thread->engine;
+
+    lhq.proto = &nxt_router_metric_names_proto;
+
+    nxt_thread_spin_lock(&nxt_router->lock);
+
+    prev = &engine->metrics;
+
+    for (metric = engine->metrics; metric != NULL; metric = next) {
+        next = metric->next;
+
+        lhq.key_hash = nxt_djb_hash(metric->name.start, metric->name.length)
+                       + metric->type;
+        lhq.key = metric->name;
+        lhq.data = (void *) (uintptr_t) metric->type;
+
+        if (nxt_lvlhsh_find(&rtcf->metric_names, &lhq) == NXT_OK) {
+            prev = &metric->next;
+            continue;
+        }
+
+        nxt_debug(task, "router metric \"%V\" deleted", &metric->name);
+
+        *prev = next;
+
+        nxt_router_metric_delete(engine, metric);
+    }
+
+    nxt_thread_spin_unlock(&nxt_router->lock);
+}
+
+
+static void
+nxt_router_metric_delete(nxt_event_engine_t *engine,
+    nxt_router_metric_t *metric)
+{
+    nxt_lvlhsh_query_t  lhq;
+
+    lhq.key_hash = nxt_djb_hash(metric->name.start, metric->name.length)
+                   + metric->type;
+    lhq.key = metric->name;
+    lhq.proto = &nxt_router_metrics_proto;
+    lhq.data = (void *) (uintptr_t) metric->type;
+    lhq.pool = NULL;
+
+    (void) nxt_lvlhsh_delete(&engine->metrics_hash, &lhq);
+
+    engine->metrics_count--;
+
+    if (metric->count == 0) {
+        nxt_free(metric);
+
+    } else {
+        metric->retired = 1;
+    }
+}
+
+
+size_t
+nxt_router_metrics_size(void)
+{
+    size_t               size;
+    nxt_event_engine_t   *engine;
+    nxt_router_metric_t  *metric;
+
+    size = 0;
+
+    nxt_thread_spin_lock(&nxt_router->lock);
+
+    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0) {
+
+        for (metric = engine->metrics; metric != NULL; metric = metric->next) {
+            size += sizeof(nxt_status_metric_t) + metric->name.length;
+        }
+
+    } nxt_queue_loop;
+
+    nxt_thread_spin_unlock(&nxt_router->lock);
+
+    return size;
+}
+
+
+/*
+ * Sums the metrics of all engines into the report.  The names are copied
+ * backwards from "end" and are stored as offsets from the report start.
+ */
+
+u_char *
+nxt_router_metrics_report(nxt_status_report_t *report,
+    nxt_status_metric_t *metrics, u_char *end)
+{
+    size_t                 i, n;
+    nxt_uint_t             j;
+    nxt_event_engine_t     *engine;
+    nxt_router_metric_t    *metric;
+    nxt_status_metric_t    *m;
+    nxt_status_counters_t  *dst, *src;
+
+    n = 0;
+
+    nxt_thread_spin_lock(&nxt_router->lock);
+
+    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0) {
+
+        for (metric = engine->metrics; metric != NULL; metric = metric->next) {
+
+            for (i = 0; i < n; i++) {
+                m = &metrics[i];
+
+                if (m->type == metric->type
+                    && m->name.length == metric->name.length
+                    && memcmp(nxt_pointer_to(report, (uintptr_t) m->name.start),
+                              metric->name.start, metric->name.length) == 0)
+                {
+                    break;
+                }
+            }
+
+            m = &metrics[i];
+
+            if (i == n) {
+                /* Metrics created after the report size was calculated. */
+
+                if ((u_char *) (m + 1) > end - metric->name.length) {
+                    continue;
+                }
+
+                end -= metric->name.length;
+                nxt_memcpy(end, metric->name.start, metric->name.length);
+
+                m->name.length = metric->name.length;
+                m->name.start = (u_char *) (end - (u_char *) report);
+                m->type = metric->type;
+
+                nxt_memzero(&m->counters, sizeof(nxt_status_counters_t));
+
+                n++;
+            }
+
+            dst = &m->counters;
+            src = &metric->counters;
+
+            dst->requests += src->requests;
+            dst->bytes_sent += src->bytes_sent;
+            dst->latency_sum += src->latency_sum;
+
+            for (j = 0; j < 5; j++) {
+                dst->responses[j] += src->responses[j];
+            }
+
+            for (j = 0; j < NXT_STATUS_LATENCY_BUCKETS; j++) {
+                dst->latency[j] += src->latency[j];
+            }
+        }
+
+    } nxt_queue_loop;
+
+    nxt_thread_spin_unlock(&nxt_router->lock);
+
+    report->metrics_count = n;
+    report->metrics = (nxt_status_metric_t *) ((u_char *) metrics
+                                               - (u_char *) report);
+
+    return end;
+}
+
+
+void
+nxt_router_metrics_free(nxt_event_engine_t *engine)
+{
+    nxt_router_metric_t  *metric, *next;
+
+    /* The engine thread has exited, so nothing holds the metrics. */
+
+    for (metric = engine->metrics; metric != NULL; metric = next) {
+        next = metric->next;
+
+        metric->count = 0;
+        nxt_router_metric_delete(engine, metric);
+    }
+
+    engine->metrics = NULL;
+}
@@ -34,6 +34,12 @@ typedef struct {
     nxt_msg_info_t          msg_info;
 
     nxt_bool_t              rpc_cancel;
+
+    /* A streamed body sent but not yet consumed by the application. */
+    size_t                  body_unacked;
+    uint8_t                 body_paused;  /* 1 bit */
+
+    nxt_nsec_t              queued;
 } nxt_request_rpc_data_t;
 
 
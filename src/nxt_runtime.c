@@ -10,6 +10,7 @@
 #include <nxt_port.h>
 #include <nxt_main_process.h>
 #include <nxt_router.h>
+#include <nxt_http.h>
 #include <nxt_regex.h>
 
 
@@ -488,6 +489,8 @@ nxt_runtime_close_idle_connections(nxt_event_engine_t *engine)
             nxt_conn_close(engine, c);
         }
     }
+
+    nxt_h1p_peer_idle_close_all(engine);
 }
 
 
@@ -820,6 +823,21 @@ nxt_runtime_conf_init(nxt_task_t *task, nxt_runtime_t *rt)
         return NXT_ERROR;
     }
 
+#if (NXT_HAVE_IO_URING)
+
+    if (interface == &nxt_io_uring_engine && nxt_io_uring_test(task) != NXT_OK)
+    {
+        interface = nxt_service_get(rt->services, "engine", "epoll");
+        if (interface == NULL) {
+            return NXT_ERROR;
+        }
+
+        nxt_log(task, NXT_LOG_WARN, "io_uring engine is not available, "
+                "\"%s\" engine is used", interface->name);
+    }
+
+#endif
+
     rt->engine = interface->name;
 
     ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s%Z", rt->pid);
@@ -969,6 +987,8 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
     static const char  no_state[] =
                        "option \"--statedir\" requires directory\n";
     static const char  no_tmp[] = "option \"--tmpdir\" requires directory\n";
+    static const char  no_engine[] =
+                       "option \"--engine\" requires engine name\n";
 
     static const char  modules_deprecated[] =
            "option \"--modules\" is deprecated; use \"--modulesdir\" instead\n";
@@ -1014,6 +1034,9 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
         "  --state DIR          [deprecated] synonym for --statedir\n"
         "  --tmp DIR            [deprecated] synonym for --tmpdir\n"
         "\n"
+        "  --engine NAME        set event engine, for example \"io_uring\"\n"
+        "                       default: the native engine of the system\n"
+        "\n"
         "  --user USER          set non-privileged processes to run"
                                 " as specified user\n"
         "                       default: \"" NXT_USER "\"\n"
@@ -1196,6 +1219,19 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
             continue;
         }
 
+        if (nxt_strcmp(p, "--engine") == 0) {
+            if (*argv == NULL) {
+                write(STDERR_FILENO, no_engine, nxt_length(no_engine));
+                return NXT_ERROR;
+            }
+
+            p = *argv++;
+
+            rt->engine = p;
+
+            continue;
+        }
+
         if (nxt_strcmp(p, "--no-daemon") == 0) {
             rt->daemon = 0;
             continue;
@@ -23,6 +23,10 @@ static const nxt_service_t  nxt_services[] = {
     { "engine", "epoll_level", &nxt_epoll_level_engine },
 #endif
 
+#if (NXT_HAVE_IO_URING)
+    { "engine", "io_uring", &nxt_io_uring_engine },
+#endif
+
 #if (NXT_HAVE_EVENTPORT)
     { "engine", "eventport", &nxt_eventport_engine },
 #endif
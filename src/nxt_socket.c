@@ -133,6 +133,11 @@ nxt_socket_sockopt_name(nxt_uint_t level, nxt_uint_t sockopt)
         case SO_REUSEADDR:
             return "SO_REUSEADDR";
 
+#ifdef SO_INCOMING_CPU
+        case SO_INCOMING_CPU:
+            return "SO_INCOMING_CPU";
+#endif
+
         case SO_TYPE:
             return "SO_TYPE";
         }
@@ -12,16 +12,19 @@
 nxt_conf_value_t *
 nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
 {
-    size_t                 i, nr_langs;
+    size_t                 i, j, k, n, nr_langs;
     uint16_t               lang_cnts[NXT_APP_UNKNOWN] = { 1 };
     uint32_t               idx = 0;
     nxt_str_t              name;
     nxt_int_t              ret;
+    const nxt_str_t        *state;
     nxt_array_t            *langs;
     nxt_thread_t           *thr;
     nxt_app_type_t         type, prev_type;
     nxt_status_app_t       *app;
     nxt_conf_value_t       *status, *obj, *mods, *apps, *app_obj, *mod_obj;
+    nxt_conf_value_t       *ups, *up_obj, *srvs;
+    nxt_status_server_t    *servers;
     nxt_app_lang_module_t  *modules;
 
     static const nxt_str_t  modules_str = nxt_string("modules");
@@ -38,8 +41,27 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
     static const nxt_str_t  procs_str = nxt_string("processes");
     static const nxt_str_t  run_str = nxt_string("running");
     static const nxt_str_t  start_str = nxt_string("starting");
-
-    status = nxt_conf_create_object(mp, 4);
+    static const nxt_str_t  ups_str = nxt_string("upstreams");
+    static const nxt_str_t  srvs_str = nxt_string("servers");
+    static const nxt_str_t  state_str = nxt_string("state");
+    static const nxt_str_t  fails_str = nxt_string("fails");
+    static const nxt_str_t  up_str = nxt_string("up");
+    static const nxt_str_t  down_str = nxt_string("down");
+    static const nxt_str_t  unhealthy_str = nxt_string("unhealthy");
+    static const nxt_str_t  shm_str = nxt_string("shared_memory");
+    static const nxt_str_t  segments_str = nxt_string("segments");
+    static const nxt_str_t  size_str = nxt_string("size");
+    static const nxt_str_t  used_str = nxt_string("used");
+    static const nxt_str_t  scaling_str = nxt_string("scaling");
+    static const nxt_str_t  queued_str = nxt_string("queued");
+    static const nxt_str_t  wait_str = nxt_string("queue_wait");
+    static const nxt_str_t  started_str = nxt_string("started");
+    static const nxt_str_t  retired_str = nxt_string("retired");
+    static const nxt_str_t  polling_str = nxt_string("polling");
+    static const nxt_str_t  spins_str = nxt_string("spins");
+    static const nxt_str_t  wakeups_str = nxt_string("wakeups");
+
+    status = nxt_conf_create_object(mp, (report->servers_count != 0) ? 5 : 4);
     if (nxt_slow_path(status == NULL)) {
         return NULL;
     }
@@ -158,7 +180,7 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
     for (i = 0; i < report->apps_count; i++) {
         app = &report->apps[i];
 
-        app_obj = nxt_conf_create_object(mp, 2);
+        app_obj = nxt_conf_create_object(mp, 3 + app->scaling + app->polling);
         if (nxt_slow_path(app_obj == NULL)) {
             return NULL;
         }
@@ -190,7 +212,540 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
         nxt_conf_set_member(app_obj, &reqs_str, obj, 1);
 
         nxt_conf_set_member_integer(obj, &active_str, app->active_requests, 0);
+
+        obj = nxt_conf_create_object(mp, 3);
+        if (nxt_slow_path(obj == NULL)) {
+            return NULL;
+        }
+
+        nxt_conf_set_member(app_obj, &shm_str, obj, 2);
+
+        nxt_conf_set_member_integer(obj, &segments_str, app->shm_segments, 0);
+        nxt_conf_set_member_integer(obj, &size_str, app->shm_size, 1);
+        nxt_conf_set_member_integer(obj, &used_str, app->shm_used, 2);
+
+        j = 3;
+
+        if (app->scaling) {
+            obj = nxt_conf_create_object(mp, 4);
+            if (nxt_slow_path(obj == NULL)) {
+                return NULL;
+            }
+
+            nxt_conf_set_member(app_obj, &scaling_str, obj, j++);
+
+            nxt_conf_set_member_integer(obj, &queued_str,
+                                        app->queued_requests, 0);
+            nxt_conf_set_member_integer(obj, &wait_str,
+                                        app->queue_wait / 1000, 1);
+            nxt_conf_set_member_integer(obj, &started_str, app->scaled_up, 2);
+            nxt_conf_set_member_integer(obj, &retired_str,
+                                        app->scaled_down, 3);
+        }
+
+        if (app->polling) {
+            obj = nxt_conf_create_object(mp, 2);
+            if (nxt_slow_path(obj == NULL)) {
+                return NULL;
+            }
+
+            nxt_conf_set_member(app_obj, &polling_str, obj, j);
+
+            nxt_conf_set_member_integer(obj, &spins_str, app->spins, 0);
+            nxt_conf_set_member_integer(obj, &wakeups_str, app->wakeups, 1);
+        }
+    }
+
+    if (report->servers_count == 0) {
+        return status;
+    }
+
+    servers = nxt_pointer_to(report, (uintptr_t) report->servers);
+
+    /* Servers of an upstream are reported successively. */
+
+    n = 1;
+
+    for (i = 1; i < report->servers_count; i++) {
+        if (servers[i].upstream.start != servers[i - 1].upstream.start) {
+            n++;
+        }
+    }
+
+    ups = nxt_conf_create_object(mp, n);
+    if (nxt_slow_path(ups == NULL)) {
+        return NULL;
+    }
+
+    nxt_conf_set_member(status, &ups_str, ups, idx);
+
+    for (i = 0, n = 0; i < report->servers_count; i = j, n++) {
+
+        for (j = i + 1; j < report->servers_count; j++) {
+            if (servers[j].upstream.start != servers[i].upstream.start) {
+                break;
+            }
+        }
+
+        up_obj = nxt_conf_create_object(mp, 1);
+        if (nxt_slow_path(up_obj == NULL)) {
+            return NULL;
+        }
+
+        name.length = servers[i].upstream.length;
+        name.start = nxt_pointer_to(report,
+                                    (uintptr_t) servers[i].upstream.start);
+
+        ret = nxt_conf_set_member_dup(ups, mp, &name, up_obj, n);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NULL;
+        }
+
+        srvs = nxt_conf_create_object(mp, j - i);
+        if (nxt_slow_path(srvs == NULL)) {
+            return NULL;
+        }
+
+        nxt_conf_set_member(up_obj, &srvs_str, srvs, 0);
+
+        for (k = i; k < j; k++) {
+            obj = nxt_conf_create_object(mp, 2);
+            if (nxt_slow_path(obj == NULL)) {
+                return NULL;
+            }
+
+            name.length = servers[k].name.length;
+            name.start = nxt_pointer_to(report,
+                                        (uintptr_t) servers[k].name.start);
+
+            ret = nxt_conf_set_member_dup(srvs, mp, &name, obj, k - i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NULL;
+            }
+
+            if (servers[k].unhealthy) {
+                state = &unhealthy_str;
+
+            } else if (servers[k].down) {
+                state = &down_str;
+
+            } else {
+                state = &up_str;
+            }
+
+            nxt_conf_set_member_string(obj, &state_str, state, 0);
+
+            nxt_conf_set_member_integer(obj, &fails_str, servers[k].fails, 1);
+        }
     }
 
     return status;
 }
+
+
+/* Upper bounds of the latency histogram buckets, in microseconds. */
+
+static const uint32_t  nxt_status_latency_bounds[] = {
+    5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000,
+};
+
+
+void
+nxt_status_counters_add(nxt_status_counters_t *counters, nxt_uint_t status,
+    nxt_off_t bytes, uint64_t latency)
+{
+    nxt_uint_t  i;
+
+    counters->requests++;
+
+    if (status >= 100 && status < 600) {
+        counters->responses[status / 100 - 1]++;
+    }
+
+    if (bytes > 0) {
+        counters->bytes_sent += bytes;
+    }
+
+    counters->latency_sum += latency;
+
+    for (i = 0; i < NXT_STATUS_LATENCY_BUCKETS - 1; i++) {
+        if (latency <= nxt_status_latency_bounds[i]) {
+            break;
+        }
+    }
+
+    counters->latency[i]++;
+}
+
+
+static nxt_int_t
+nxt_status_metric_label(nxt_status_report_t *report, nxt_mp_t *mp,
+    nxt_str_t *name, nxt_str_t *label)
+{
+    u_char  c, *p, *src;
+    size_t  i;
+
+    src = nxt_pointer_to(report, (uintptr_t) name->start);
+
+    p = nxt_mp_nget(mp, name->length * 2);
+    if (nxt_slow_path(p == NULL && name->length != 0)) {
+        return NXT_ERROR;
+    }
+
+    label->start = p;
+
+    for (i = 0; i < name->length; i++) {
+        c = src[i];
+
+        switch (c) {
+        case '\\':
+        case '"':
+            *p++ = '\\';
+            *p++ = c;
+            break;
+
+        case '\n':
+            *p++ = '\\';
+            *p++ = 'n';
+            break;
+
+        default:
+            *p++ = c;
+        }
+    }
+
+    label->length = p - label->start;
+
+    return NXT_OK;
+}
+
+
+nxt_int_t
+nxt_status_metrics(nxt_status_report_t *report, nxt_mp_t *mp,
+    nxt_str_t *text)
+{
+    u_char                 *p, *end;
+    size_t                 size;
+    uint64_t               count;
+    nxt_str_t              *labels;
+    nxt_int_t              ret;
+    nxt_uint_t             i, j, type;
+    const char             *kind;
+    nxt_status_app_t       *app;
+    nxt_status_metric_t    *metrics, *m;
+    nxt_status_counters_t  *cnt;
+
+    static const char * const  kinds[] = {
+        "listener", "route", "application", "upstream",
+    };
+
+    /* Must match nxt_status_latency_bounds[]. */
+
+    static const char * const  le[] = {
+        "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5",
+        "1.0", "2.5", "5.0", "10.0", "+Inf",
+    };
+
+    metrics = nxt_pointer_to(report, (uintptr_t) report->metrics);
+
+    size = nxt_length("# EOF\n") + 2048;
+
+    labels = nxt_mp_nget(mp, (report->apps_count + report->metrics_count)
+                             * sizeof(nxt_str_t) + 1);
+    if (nxt_slow_path(labels == NULL)) {
+        return NXT_ERROR;
+    }
+
+    for (i = 0; i < report->apps_count; i++) {
+        ret = nxt_status_metric_label(report, mp, &report->apps[i].name,
+                                      &labels[i]);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        size += 13 * (128 + labels[i].length);
+    }
+
+    for (i = 0; i < report->metrics_count; i++) {
+        ret = nxt_status_metric_label(report, mp, &metrics[i].name,
+                                      &labels[report->apps_count + i]);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        /*
+         * The requests, five response classes, sent bytes, latency
+         * buckets, count, and sum lines.
+         */
+        size += (9 + NXT_STATUS_LATENCY_BUCKETS)
+                * (128 + labels[report->apps_count + i].length);
+    }
+
+    /* Metric family descriptions. */
+    size += nxt_nitems(kinds) * 4 * 256;
+
+    p = nxt_mp_nget(mp, size);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    text->start = p;
+    end = p + size;
+
+    p = nxt_sprintf(p, end,
+                    "# TYPE unit_connections_accepted counter\n"
+                    "# HELP unit_connections_accepted "
+                    "Total number of accepted connections.\n"
+                    "unit_connections_accepted_total %uL\n"
+                    "# TYPE unit_connections_active gauge\n"
+                    "# HELP unit_connections_active "
+                    "Number of connections processing requests.\n"
+                    "unit_connections_active %uL\n"
+                    "# TYPE unit_connections_idle gauge\n"
+                    "# HELP unit_connections_idle "
+                    "Number of idle keep-alive connections.\n"
+                    "unit_connections_idle %uL\n"
+                    "# TYPE unit_connections_closed counter\n"
+                    "# HELP unit_connections_closed "
+                    "Total number of closed connections.\n"
+                    "unit_connections_closed_total %uL\n"
+                    "# TYPE unit_requests counter\n"
+                    "# HELP unit_requests Total number of requests.\n"
+                    "unit_requests_total %uL\n",
+                    report->accepted_conns,
+                    report->accepted_conns - report->closed_conns
+                    - report->idle_conns,
+                    report->idle_conns, report->closed_conns,
+                    report->requests);
+
+    if (report->apps_count != 0) {
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_processes gauge\n"
+                        "# HELP unit_application_processes "
+                        "Number of application processes.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            app = &report->apps[i];
+
+            p = nxt_sprintf(p, end,
+                    "unit_application_processes"
+                    "{application=\"%V\",state=\"running\"} %uD\n"
+                    "unit_application_processes"
+                    "{application=\"%V\",state=\"starting\"} %uD\n"
+                    "unit_application_processes"
+                    "{application=\"%V\",state=\"idle\"} %uD\n",
+                    &labels[i], app->processes, &labels[i],
+                    app->pending_processes, &labels[i], app->idle_processes);
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_active_requests gauge\n"
+                        "# HELP unit_application_active_requests "
+                        "Number of requests being processed.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            p = nxt_sprintf(p, end,
+                            "unit_application_active_requests"
+                            "{application=\"%V\"} %uD\n",
+                            &labels[i], report->apps[i].active_requests);
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_shm_segments gauge\n"
+                        "# HELP unit_application_shm_segments "
+                        "Number of shared memory segments.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            p = nxt_sprintf(p, end,
+                            "unit_application_shm_segments"
+                            "{application=\"%V\"} %uD\n",
+                            &labels[i], report->apps[i].shm_segments);
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_shm_bytes gauge\n"
+                        "# HELP unit_application_shm_bytes "
+                        "Size of shared memory segments.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            app = &report->apps[i];
+
+            p = nxt_sprintf(p, end,
+                    "unit_application_shm_bytes"
+                    "{application=\"%V\",state=\"mapped\"} %uL\n"
+                    "unit_application_shm_bytes"
+                    "{application=\"%V\",state=\"used\"} %uL\n",
+                    &labels[i], app->shm_size, &labels[i], app->shm_used);
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_queued_requests gauge\n"
+                        "# HELP unit_application_queued_requests "
+                        "Number of requests waiting for a process.\n"
+                        "# TYPE unit_application_queue_wait_seconds gauge\n"
+                        "# HELP unit_application_queue_wait_seconds "
+                        "Average time requests wait for a process.\n"
+                        "# TYPE unit_application_scaled_processes counter\n"
+                        "# HELP unit_application_scaled_processes "
+                        "Total number of processes started or retired "
+                        "by the scaling policy.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            app = &report->apps[i];
+
+            if (!app->scaling) {
+                continue;
+            }
+
+            p = nxt_sprintf(p, end,
+                    "unit_application_queued_requests"
+                    "{application=\"%V\"} %uD\n"
+                    "unit_application_queue_wait_seconds"
+                    "{application=\"%V\"} %uD.%06uD\n"
+                    "unit_application_scaled_processes_total"
+                    "{application=\"%V\",action=\"started\"} %uD\n"
+                    "unit_application_scaled_processes_total"
+                    "{application=\"%V\",action=\"retired\"} %uD\n",
+                    &labels[i], app->queued_requests,
+                    &labels[i], app->queue_wait / 1000000,
+                    app->queue_wait % 1000000,
+                    &labels[i], app->scaled_up,
+                    &labels[i], app->scaled_down);
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_application_queue_receives counter\n"
+                        "# HELP unit_application_queue_receives "
+                        "Total number of requests and messages received "
+                        "while spinning or after waking up.\n");
+
+        for (i = 0; i < report->apps_count; i++) {
+            app = &report->apps[i];
+
+            if (!app->polling) {
+                continue;
+            }
+
+            p = nxt_sprintf(p, end,
+                    "unit_application_queue_receives_total"
+                    "{application=\"%V\",wait=\"spin\"} %uL\n"
+                    "unit_application_queue_receives_total"
+                    "{application=\"%V\",wait=\"wakeup\"} %uL\n",
+                    &labels[i], app->spins, &labels[i], app->wakeups);
+        }
+    }
+
+    labels += report->apps_count;
+
+    for (type = 0; type < nxt_nitems(kinds); type++) {
+        kind = kinds[type];
+
+        for (i = 0; i < report->metrics_count; i++) {
+            if (metrics[i].type == type) {
+                break;
+            }
+        }
+
+        if (i == report->metrics_count) {
+            continue;
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_%s_requests counter\n"
+                        "# HELP unit_%s_requests Total number of requests.\n",
+                        kind, kind);
+
+        for (i = 0; i < report->metrics_count; i++) {
+            m = &metrics[i];
+
+            if (m->type == type) {
+                p = nxt_sprintf(p, end, "unit_%s_requests_total{%s=\"%V\"} "
+                                "%uL\n", kind, kind, &labels[i],
+                                m->counters.requests);
+            }
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_%s_responses counter\n"
+                        "# HELP unit_%s_responses "
+                        "Total number of responses by status class.\n",
+                        kind, kind);
+
+        for (i = 0; i < report->metrics_count; i++) {
+            m = &metrics[i];
+
+            if (m->type != type) {
+                continue;
+            }
+
+            for (j = 0; j < 5; j++) {
+                p = nxt_sprintf(p, end, "unit_%s_responses_total"
+                                "{%s=\"%V\",code=\"%uixx\"} %uL\n",
+                                kind, kind, &labels[i], j + 1,
+                                m->counters.responses[j]);
+            }
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_%s_sent_bytes counter\n"
+                        "# HELP unit_%s_sent_bytes "
+                        "Total number of response body bytes sent.\n",
+                        kind, kind);
+
+        for (i = 0; i < report->metrics_count; i++) {
+            m = &metrics[i];
+
+            if (m->type == type) {
+                p = nxt_sprintf(p, end, "unit_%s_sent_bytes_total{%s=\"%V\"} "
+                                "%uL\n", kind, kind, &labels[i],
+                                m->counters.bytes_sent);
+            }
+        }
+
+        p = nxt_sprintf(p, end,
+                        "# TYPE unit_%s_request_duration_seconds histogram\n"
+                        "# HELP unit_%s_request_duration_seconds "
+                        "Request processing time.\n",
+                        kind, kind);
+
+        for (i = 0; i < report->metrics_count; i++) {
+            m = &metrics[i];
+
+            if (m->type != type) {
+                continue;
+            }
+
+            cnt = &m->counters;
+            count = 0;
+
+            for (j = 0; j < NXT_STATUS_LATENCY_BUCKETS; j++) {
+                count += cnt->latency[j];
+
+                p = nxt_sprintf(p, end,
+                                "unit_%s_request_duration_seconds_bucket"
+                                "{%s=\"%V\",le=\"%s\"} %uL\n",
+                                kind, kind, &labels[i], le[j], count);
+            }
+
+            p = nxt_sprintf(p, end, "unit_%s_request_duration_seconds_count"
+                            "{%s=\"%V\"} %uL\n"
+                            "unit_%s_request_duration_seconds_sum"
+                            "{%s=\"%V\"} %uL.%06uL\n",
+                            kind, kind, &labels[i], count,
+                            kind, kind, &labels[i],
+                            cnt->latency_sum / 1000000,
+                            cnt->latency_sum % 1000000);
+        }
+    }
+
+    if (nxt_slow_path((size_t) (end - p) < nxt_length("# EOF\n"))) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_cpymem(p, "# EOF\n", nxt_length("# EOF\n"));
+
+    text->length = p - text->start;
+
+    return NXT_OK;
+}
@@ -13,21 +13,84 @@ typedef struct {
     uint32_t          pending_processes;
     uint32_t          processes;
     uint32_t          idle_processes;
+    uint32_t          shm_segments;
+    uint64_t          shm_size;
+    uint64_t          shm_used;
+    uint8_t           scaling;    /* 1 bit */
+    uint32_t          queued_requests;
+    uint32_t          queue_wait;  /* usec */
+    uint32_t          scaled_up;
+    uint32_t          scaled_down;
+    uint8_t           polling;    /* 1 bit */
+    uint64_t          spins;
+    uint64_t          wakeups;
 } nxt_status_app_t;
 
 
 typedef struct {
-    uint64_t          accepted_conns;
-    uint64_t          idle_conns;
-    uint64_t          closed_conns;
+    nxt_str_t         upstream;
+    nxt_str_t         name;
+    uint32_t          fails;
+    uint8_t           down;       /* 1 bit */
+    uint8_t           unhealthy;  /* 1 bit */
+} nxt_status_server_t;
+
+
+#define NXT_STATUS_LATENCY_BUCKETS  12
+
+
+typedef enum {
+    NXT_STATUS_METRIC_LISTENER = 0,
+    NXT_STATUS_METRIC_ROUTE,
+    NXT_STATUS_METRIC_APP,
+    NXT_STATUS_METRIC_UPSTREAM,
+} nxt_status_metric_type_t;
+
+
+typedef struct {
     uint64_t          requests;
+    uint64_t          responses[5];  /* 1xx-5xx */
+    uint64_t          bytes_sent;
+    uint64_t          latency_sum;   /* usec */
+
+    /* Per bucket counts, not cumulative; the last bucket is +Inf. */
+    uint64_t          latency[NXT_STATUS_LATENCY_BUCKETS];
+} nxt_status_counters_t;
 
-    size_t            apps_count;
-    nxt_status_app_t  apps[];
+
+typedef struct {
+    nxt_str_t              name;
+    nxt_uint_t             type;
+    nxt_status_counters_t  counters;
+} nxt_status_metric_t;
+
+
+typedef struct {
+    uint64_t             accepted_conns;
+    uint64_t             idle_conns;
+    uint64_t             closed_conns;
+    uint64_t             requests;
+
+    size_t               servers_count;
+    nxt_status_server_t  *servers;
+
+    size_t               metrics_count;
+    nxt_status_metric_t  *metrics;
+
+    size_t               apps_count;
+    nxt_status_app_t     apps[];
 } nxt_status_report_t;
 
 
 nxt_conf_value_t *nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp);
+nxt_int_t nxt_status_metrics(nxt_status_report_t *report, nxt_mp_t *mp,
+    nxt_str_t *text);
+void nxt_status_counters_add(nxt_status_counters_t *counters,
+    nxt_uint_t status, nxt_off_t bytes, uint64_t latency);
+
+size_t nxt_router_metrics_size(void);
+u_char *nxt_router_metrics_report(nxt_status_report_t *report,
+    nxt_status_metric_t *metrics, u_char *end);
 
 
 #endif /* _NXT_STATUS_H_INCLUDED_ */
@@ -79,14 +79,20 @@ struct nxt_tls_conf_s {
     size_t                        buffer_size;
 
     uint8_t                       no_wait_shutdown;  /* 1 bit */
+    uint8_t                       http2;             /* 1 bit */
 };
 
 
 struct nxt_tls_init_s {
+    nxt_str_t                     name;
     size_t                        cache_size;
     nxt_time_t                    timeout;
     nxt_conf_value_t              *conf_cmds;
     nxt_conf_value_t              *tickets_conf;
+    nxt_str_t                     responder;
+
+    uint8_t                       ktls;      /* 1 bit */
+    uint8_t                       stapling;  /* 1 bit */
 
     nxt_tls_conf_t                *conf;
 };
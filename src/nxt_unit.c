@@ -23,11 +23,7 @@
 #define NXT_UNIT_MAX_PLAIN_SIZE  1024
 #define NXT_UNIT_LOCAL_BUF_SIZE  \
     (NXT_UNIT_MAX_PLAIN_SIZE + sizeof(nxt_port_msg_t))
-
-enum {
-    NXT_QUIT_NORMAL   = 0,
-    NXT_QUIT_GRACEFUL = 1,
-};
+#define NXT_UNIT_SPIN_PAUSE_MAX  64
 
 typedef struct nxt_unit_impl_s                  nxt_unit_impl_t;
 typedef struct nxt_unit_mmap_s                  nxt_unit_mmap_t;
@@ -39,6 +35,11 @@ typedef struct nxt_unit_read_buf_s              nxt_unit_read_buf_t;
 typedef struct nxt_unit_ctx_impl_s              nxt_unit_ctx_impl_t;
 typedef struct nxt_unit_port_impl_s             nxt_unit_port_impl_t;
 typedef struct nxt_unit_request_info_impl_s     nxt_unit_request_info_impl_t;
+
+typedef struct {
+    uint64_t    deadline;
+    nxt_uint_t  pause;
+} nxt_unit_spin_t;
 typedef struct nxt_unit_websocket_frame_impl_s  nxt_unit_websocket_frame_impl_t;
 
 static nxt_unit_impl_t *nxt_unit_create(nxt_unit_init_t *init);
@@ -57,7 +58,10 @@ static int nxt_unit_read_env(nxt_unit_port_t *ready_port,
     nxt_unit_port_t *router_port, nxt_unit_port_t *read_port,
     int *shared_port_fd, int *shared_queue_fd,
     int *log_fd, uint32_t *stream, uint32_t *shm_limit,
-    uint32_t *request_limit);
+    uint32_t *request_limit, uint32_t *shm_segment_size, int *shm_huge_pages,
+    uint32_t *spin_wait);
+static void nxt_unit_shm_conf(nxt_unit_impl_t *lib, uint32_t shm_limit,
+    uint32_t shm_segment_size, int shm_huge_pages);
 static int nxt_unit_ready(nxt_unit_ctx_t *ctx, int ready_fd, uint32_t stream,
     int queue_fd);
 static int nxt_unit_process_msg(nxt_unit_ctx_t *ctx, nxt_unit_read_buf_t *rbuf,
@@ -97,6 +101,9 @@ static void nxt_unit_read_buf_release(nxt_unit_ctx_t *ctx,
     nxt_unit_read_buf_t *rbuf);
 static nxt_unit_mmap_buf_t *nxt_unit_request_preread(
     nxt_unit_request_info_t *req, size_t size);
+static int nxt_unit_request_content_stream(nxt_unit_request_info_t *req);
+static int nxt_unit_request_content_wait(nxt_unit_request_info_t *req);
+static int nxt_unit_request_content_release(nxt_unit_request_info_t *req);
 static ssize_t nxt_unit_buf_read(nxt_unit_buf_t **b, uint64_t *len, void *dst,
     size_t size);
 static nxt_port_mmap_header_t *nxt_unit_mmap_get(nxt_unit_ctx_t *ctx,
@@ -106,7 +113,7 @@ static int nxt_unit_wait_shm_ack(nxt_unit_ctx_t *ctx);
 static nxt_unit_mmap_t *nxt_unit_mmap_at(nxt_unit_mmaps_t *mmaps, uint32_t i);
 static nxt_port_mmap_header_t *nxt_unit_new_mmap(nxt_unit_ctx_t *ctx,
     nxt_unit_port_t *port, int n);
-static int nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size);
+static int nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size, int huge);
 static int nxt_unit_send_mmap(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
     int fd);
 static int nxt_unit_get_outgoing_buf(nxt_unit_ctx_t *ctx,
@@ -143,6 +150,8 @@ nxt_inline int nxt_unit_is_read_queue(nxt_unit_read_buf_t *rbuf);
 nxt_inline int nxt_unit_is_read_socket(nxt_unit_read_buf_t *rbuf);
 nxt_inline int nxt_unit_is_shm_ack(nxt_unit_read_buf_t *rbuf);
 nxt_inline int nxt_unit_is_quit(nxt_unit_read_buf_t *rbuf);
+nxt_inline int nxt_unit_is_req_body(nxt_unit_read_buf_t *rbuf,
+    uint32_t stream);
 static int nxt_unit_process_port_msg_impl(nxt_unit_ctx_t *ctx,
     nxt_unit_port_t *port);
 static void nxt_unit_ctx_free(nxt_unit_ctx_impl_t *ctx_impl);
@@ -183,6 +192,18 @@ static int nxt_unit_port_queue_recv(nxt_unit_port_t *port,
     nxt_unit_read_buf_t *rbuf);
 static int nxt_unit_app_queue_recv(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
     nxt_unit_read_buf_t *rbuf);
+static nxt_uint_t nxt_unit_app_queue_recv_batch(nxt_unit_ctx_t *ctx,
+    nxt_unit_port_t *port, nxt_app_queue_msg_t *msgs, nxt_uint_t n);
+static void nxt_unit_request_limit_count(nxt_unit_ctx_t *ctx);
+static int nxt_unit_shared_port_drain(nxt_unit_ctx_t *ctx,
+    nxt_unit_port_t *port);
+static int nxt_unit_read_buf_spin(nxt_unit_ctx_t *ctx,
+    nxt_unit_read_buf_t *rbuf, int shared);
+static int nxt_unit_shared_port_spin(nxt_unit_ctx_t *ctx);
+static void nxt_unit_spin_start(nxt_unit_impl_t *lib, nxt_unit_spin_t *spin);
+static int nxt_unit_spin(nxt_unit_spin_t *spin);
+static void nxt_unit_spin_stat(nxt_unit_impl_t *lib, int woken);
+nxt_inline uint64_t nxt_unit_monotonic_time(void);
 nxt_inline int nxt_unit_close(int fd);
 static int nxt_unit_fd_blocking(int fd);
 
@@ -248,6 +269,9 @@ struct nxt_unit_request_info_impl_s {
 
     uint32_t                 stream;
 
+    /* The rest of a streamed body when its consumption was reported. */
+    uint64_t                 content_acked;
+
     nxt_unit_mmap_buf_t      *outgoing_buf;
     nxt_unit_mmap_buf_t      *incoming_buf;
 
@@ -332,6 +356,7 @@ struct nxt_unit_ctx_impl_s {
 
 struct nxt_unit_mmap_s {
     nxt_port_mmap_header_t   *hdr;
+    size_t                   size;
     pthread_t                src_thread;
 
     /*  of nxt_unit_read_buf_t */
@@ -357,8 +382,13 @@ struct nxt_unit_impl_s {
 
     uint32_t                 request_data_size;
     uint32_t                 shm_mmap_limit;
+    uint32_t                 shm_mmap_chunks;
+    uint8_t                  shm_huge_pages;
     uint32_t                 request_limit;
 
+    /* Time to poll empty queues before sleeping, nsec. */
+    uint32_t                 spin_wait;
+
     pthread_mutex_t          mutex;
 
     nxt_lvlhsh_t             processes;        /* of nxt_unit_process_t */
@@ -420,7 +450,8 @@ typedef struct {
 } nxt_unit_port_hash_id_t;
 
 
-static pid_t  nxt_unit_pid;
+static pid_t     nxt_unit_pid;
+static uint32_t  nxt_unit_mmap_data_size = PORT_MMAP_DATA_SIZE;
 
 
 nxt_unit_ctx_t *
@@ -428,7 +459,9 @@ nxt_unit_init(nxt_unit_init_t *init)
 {
     int              rc, queue_fd, shared_queue_fd;
     void             *mem;
+    int              shm_huge_pages;
     uint32_t         ready_stream, shm_limit, request_limit;
+    uint32_t         shm_segment_size, spin_wait;
     nxt_unit_ctx_t   *ctx;
     nxt_unit_impl_t  *lib;
     nxt_unit_port_t  ready_port, router_port, read_port, shared_port;
@@ -469,14 +502,15 @@ nxt_unit_init(nxt_unit_init_t *init)
         rc = nxt_unit_read_env(&ready_port, &router_port, &read_port,
                                &shared_port.in_fd, &shared_queue_fd,
                                &lib->log_fd, &ready_stream, &shm_limit,
-                               &request_limit);
+                               &request_limit, &shm_segment_size,
+                               &shm_huge_pages, &spin_wait);
         if (nxt_slow_path(rc != NXT_UNIT_OK)) {
             goto fail;
         }
 
-        lib->shm_mmap_limit = (shm_limit + PORT_MMAP_DATA_SIZE - 1)
-                                / PORT_MMAP_DATA_SIZE;
+        nxt_unit_shm_conf(lib, shm_limit, shm_segment_size, shm_huge_pages);
         lib->request_limit = request_limit;
+        lib->spin_wait = spin_wait * 1000;
     }
 
     if (nxt_slow_path(lib->shm_mmap_limit < 1)) {
@@ -500,7 +534,7 @@ nxt_unit_init(nxt_unit_init_t *init)
         goto fail;
     }
 
-    queue_fd = nxt_unit_shm_open(ctx, sizeof(nxt_port_queue_t));
+    queue_fd = nxt_unit_shm_open(ctx, sizeof(nxt_port_queue_t), 0);
     if (nxt_slow_path(queue_fd == -1)) {
         goto fail;
     }
@@ -613,9 +647,10 @@ nxt_unit_create(nxt_unit_init_t *init)
     lib->callbacks = init->callbacks;
 
     lib->request_data_size = init->request_data_size;
-    lib->shm_mmap_limit = (init->shm_limit + PORT_MMAP_DATA_SIZE - 1)
-                            / PORT_MMAP_DATA_SIZE;
+    nxt_unit_shm_conf(lib, init->shm_limit, init->shm_segment_size,
+                      init->shm_huge_pages);
     lib->request_limit = init->request_limit;
+    lib->spin_wait = init->spin_wait * 1000;
 
     lib->processes.slot = NULL;
     lib->ports.slot = NULL;
@@ -844,7 +879,8 @@ static int
 nxt_unit_read_env(nxt_unit_port_t *ready_port, nxt_unit_port_t *router_port,
     nxt_unit_port_t *read_port, int *shared_port_fd, int *shared_queue_fd,
     int *log_fd, uint32_t *stream,
-    uint32_t *shm_limit, uint32_t *request_limit)
+    uint32_t *shm_limit, uint32_t *request_limit, uint32_t *shm_segment_size,
+    int *shm_huge_pages, uint32_t *spin_wait)
 {
     int       rc;
     int       ready_fd, router_fd, read_in_fd, read_out_fd;
@@ -890,13 +926,15 @@ nxt_unit_read_env(nxt_unit_port_t *ready_port, nxt_unit_port_t *router_port,
                 "%"PRId64",%"PRIu32",%d;"
                 "%"PRId64",%"PRIu32",%d,%d;"
                 "%d,%d;"
-                "%d,%"PRIu32",%"PRIu32,
+                "%d,%"PRIu32",%"PRIu32";"
+                "%"PRIu32",%d,%"PRIu32,
                 &ready_stream,
                 &ready_pid, &ready_id, &ready_fd,
                 &router_pid, &router_id, &router_fd,
                 &read_pid, &read_id, &read_in_fd, &read_out_fd,
                 shared_port_fd, shared_queue_fd,
-                log_fd, shm_limit, request_limit);
+                log_fd, shm_limit, request_limit,
+                shm_segment_size, shm_huge_pages, spin_wait);
 
     if (nxt_slow_path(rc == EOF)) {
         nxt_unit_alert(NULL, "sscanf(%s) failed: %s (%d) for %s env",
@@ -905,9 +943,9 @@ nxt_unit_read_env(nxt_unit_port_t *ready_port, nxt_unit_port_t *router_port,
         return NXT_UNIT_ERROR;
     }
 
-    if (nxt_slow_path(rc != 16)) {
+    if (nxt_slow_path(rc != 19)) {
         nxt_unit_alert(NULL, "invalid number of variables in %s env: "
-                       "found %d of %d in %s", NXT_UNIT_INIT_ENV, rc, 16, vars);
+                       "found %d of %d in %s", NXT_UNIT_INIT_ENV, rc, 19, vars);
 
         return NXT_UNIT_ERROR;
     }
@@ -938,6 +976,29 @@ nxt_unit_read_env(nxt_unit_port_t *ready_port, nxt_unit_port_t *router_port,
 }
 
 
+/*
+ * Segments of shm_segment_size bytes are allocated until shm_limit is
+ * reached; 0 means the default PORT_MMAP_SIZE segments.
+ */
+
+static void
+nxt_unit_shm_conf(nxt_unit_impl_t *lib, uint32_t shm_limit,
+    uint32_t shm_segment_size, int shm_huge_pages)
+{
+    uint32_t  data_size;
+
+    lib->shm_huge_pages = (shm_huge_pages != 0);
+    lib->shm_mmap_chunks = nxt_port_mmap_chunks(shm_segment_size,
+                                                lib->shm_huge_pages);
+
+    data_size = lib->shm_mmap_chunks * PORT_MMAP_CHUNK_SIZE;
+
+    lib->shm_mmap_limit = (shm_limit + data_size - 1) / data_size;
+
+    nxt_unit_mmap_data_size = data_size;
+}
+
+
 static int
 nxt_unit_ready(nxt_unit_ctx_t *ctx, int ready_fd, uint32_t stream, int queue_fd)
 {
@@ -1329,6 +1390,7 @@ nxt_unit_process_req_headers(nxt_unit_ctx_t *ctx, nxt_unit_recv_msg_t *recv_msg,
     req->content_buf->free = nxt_unit_sptr_get(&r->preread_content);
 
     req_impl->stream = recv_msg->stream;
+    req_impl->content_acked = r->content_length;
 
     req_impl->outgoing_buf = NULL;
 
@@ -1388,8 +1450,9 @@ nxt_unit_process_req_headers(nxt_unit_ctx_t *ctx, nxt_unit_recv_msg_t *recv_msg,
             /*
              * If application have separate data handler, we may start
              * request processing and process data when it is arrived.
+             * A streamed body is read by the request handler itself.
              */
-            if (lib->callbacks.data_handler == NULL) {
+            if (lib->callbacks.data_handler == NULL && !r->content_stream) {
                 return NXT_UNIT_OK;
             }
         }
@@ -1419,6 +1482,31 @@ nxt_unit_process_req_body(nxt_unit_ctx_t *ctx, nxt_unit_recv_msg_t *recv_msg)
         return NXT_UNIT_OK;
     }
 
+    if (recv_msg->incoming_buf == NULL && recv_msg->size != 0) {
+        /* Small body parts may arrive inline through the port queue. */
+
+        b = nxt_unit_mmap_buf_get(ctx);
+        if (nxt_slow_path(b == NULL)) {
+            return NXT_UNIT_ERROR;
+        }
+
+        b->free_ptr = nxt_unit_malloc(ctx, recv_msg->size);
+        if (nxt_slow_path(b->free_ptr == NULL)) {
+            nxt_unit_mmap_buf_release(b);
+            return NXT_UNIT_ERROR;
+        }
+
+        memcpy(b->free_ptr, recv_msg->start, recv_msg->size);
+
+        b->plain_ptr = b->free_ptr;
+        b->hdr = NULL;
+        b->buf.start = b->free_ptr;
+        b->buf.free = b->buf.start;
+        b->buf.end = b->buf.start + recv_msg->size;
+
+        nxt_unit_mmap_buf_insert(&recv_msg->incoming_buf, b);
+    }
+
     l = req->content_buf->end - req->content_buf->free;
 
     for (b = recv_msg->incoming_buf; b != NULL; b = b->next) {
@@ -1451,6 +1539,10 @@ nxt_unit_process_req_body(nxt_unit_ctx_t *ctx, nxt_unit_recv_msg_t *recv_msg)
         return NXT_UNIT_OK;
     }
 
+    if (req->request->content_stream) {
+        return NXT_UNIT_OK;
+    }
+
     if (req->content_fd != -1 || l == req->content_length) {
         lib->callbacks.request_handler(req);
     }
@@ -2402,7 +2494,7 @@ nxt_unit_response_buf_alloc(nxt_unit_request_info_t *req, uint32_t size)
     nxt_unit_mmap_buf_t           *mmap_buf;
     nxt_unit_request_info_impl_t  *req_impl;
 
-    if (nxt_slow_path(size > PORT_MMAP_DATA_SIZE)) {
+    if (nxt_slow_path(size > nxt_unit_mmap_data_size)) {
         nxt_unit_req_warn(req, "response_buf_alloc: "
                           "requested buffer (%"PRIu32") too big", size);
 
@@ -2855,7 +2947,7 @@ nxt_unit_buf_next(nxt_unit_buf_t *buf)
 uint32_t
 nxt_unit_buf_max(void)
 {
-    return PORT_MMAP_DATA_SIZE;
+    return nxt_unit_mmap_data_size;
 }
 
 
@@ -2926,7 +3018,7 @@ nxt_unit_response_write_nb(nxt_unit_request_info_t *req, const void *start,
     }
 
     while (size > 0) {
-        part_size = nxt_min(size, PORT_MMAP_DATA_SIZE);
+        part_size = nxt_min(size, nxt_unit_mmap_data_size);
         min_part_size = nxt_min(min_size, part_size);
         min_part_size = nxt_min(min_part_size, PORT_MMAP_CHUNK_SIZE);
 
@@ -3027,7 +3119,7 @@ nxt_unit_response_write_cb(nxt_unit_request_info_t *req,
         nxt_unit_req_debug(req, "write_cb, alloc %"PRIu32"",
                            read_info->buf_size);
 
-        buf_size = nxt_min(read_info->buf_size, PORT_MMAP_DATA_SIZE);
+        buf_size = nxt_min(read_info->buf_size, nxt_unit_mmap_data_size);
 
         rc = nxt_unit_get_outgoing_buf(req->ctx, req->response_port,
                                        buf_size, buf_size,
@@ -3071,6 +3163,32 @@ nxt_unit_request_read(nxt_unit_request_info_t *req, void *dst, size_t size)
     buf_res = nxt_unit_buf_read(&req->content_buf, &req->content_length,
                                 dst, size);
 
+    while (buf_res < (ssize_t) size
+           && req->content_length != 0
+           && nxt_unit_request_content_stream(req))
+    {
+        if (nxt_slow_path(nxt_unit_request_content_wait(req) != NXT_UNIT_OK)) {
+            return -1;
+        }
+
+        buf_res += nxt_unit_buf_read(&req->content_buf, &req->content_length,
+                                     nxt_pointer_to(dst, buf_res),
+                                     size - buf_res);
+    }
+
+    if (buf_res < (ssize_t) size
+        && req->content_length != 0
+        && req->request->content_stream)
+    {
+        /* The data handler gets the rest when it arrives. */
+
+        if (nxt_slow_path(nxt_unit_request_content_release(req)
+                          != NXT_UNIT_OK))
+        {
+            return -1;
+        }
+    }
+
     if (buf_res < (ssize_t) size && req->content_fd != -1) {
         res = read(req->content_fd, dst, size);
         if (nxt_slow_path(res < 0)) {
@@ -3131,6 +3249,18 @@ nxt_unit_request_readline_size(nxt_unit_request_info_t *req, size_t max_size)
         }
 
         mmap_buf = nxt_container_of(b, nxt_unit_mmap_buf_t, buf);
+
+        if (mmap_buf->next == NULL
+            && l_size < req->content_length
+            && nxt_unit_request_content_stream(req))
+        {
+            if (nxt_slow_path(nxt_unit_request_content_wait(req)
+                              != NXT_UNIT_OK))
+            {
+                return -1;
+            }
+        }
+
         if (mmap_buf->next == NULL
             && req->content_fd != -1
             && l_size < req->content_length)
@@ -3205,6 +3335,173 @@ nxt_unit_request_preread(nxt_unit_request_info_t *req, size_t size)
 }
 
 
+static int
+nxt_unit_request_content_stream(nxt_unit_request_info_t *req)
+{
+    nxt_unit_impl_t  *lib;
+
+    lib = nxt_container_of(req->unit, nxt_unit_impl_t, unit);
+
+    return req->request->content_stream
+           && lib->callbacks.data_handler == NULL;
+}
+
+
+/*
+ * Waits for the next part of a streamed request body.  The consumed parts
+ * are released first, so the body uses a bounded amount of shared memory.
+ */
+
+static int
+nxt_unit_request_content_wait(nxt_unit_request_info_t *req)
+{
+    int                           res, last;
+    nxt_port_msg_t                *port_msg;
+    nxt_unit_ctx_t                *ctx;
+    nxt_unit_read_buf_t           *rbuf, *r;
+    nxt_unit_ctx_impl_t           *ctx_impl;
+    nxt_unit_request_info_impl_t  *req_impl;
+
+    ctx = req->ctx;
+    ctx_impl = nxt_container_of(ctx, nxt_unit_ctx_impl_t, ctx);
+    req_impl = nxt_container_of(req, nxt_unit_request_info_impl_t, req);
+
+    if (nxt_slow_path(nxt_unit_request_content_release(req) != NXT_UNIT_OK)) {
+        return NXT_UNIT_ERROR;
+    }
+
+    rbuf = NULL;
+
+    pthread_mutex_lock(&ctx_impl->mutex);
+
+    nxt_queue_each(r, &ctx_impl->pending_rbuf, nxt_unit_read_buf_t, link) {
+
+        if (nxt_unit_is_req_body(r, req_impl->stream)) {
+            nxt_queue_remove(&r->link);
+            rbuf = r;
+            break;
+        }
+
+    } nxt_queue_loop;
+
+    pthread_mutex_unlock(&ctx_impl->mutex);
+
+    while (rbuf == NULL) {
+        rbuf = nxt_unit_read_buf_get(ctx);
+        if (nxt_slow_path(rbuf == NULL)) {
+            return NXT_UNIT_ERROR;
+        }
+
+        do {
+            res = nxt_unit_ctx_port_recv(ctx, ctx_impl->read_port, rbuf);
+        } while (res == NXT_UNIT_AGAIN);
+
+        if (res == NXT_UNIT_ERROR) {
+            nxt_unit_read_buf_release(ctx, rbuf);
+
+            return NXT_UNIT_ERROR;
+        }
+
+        if (nxt_unit_is_req_body(rbuf, req_impl->stream)) {
+            break;
+        }
+
+        pthread_mutex_lock(&ctx_impl->mutex);
+
+        nxt_queue_insert_tail(&ctx_impl->pending_rbuf, &rbuf->link);
+
+        pthread_mutex_unlock(&ctx_impl->mutex);
+
+        if (nxt_unit_is_quit(rbuf)) {
+            nxt_unit_req_debug(req, "content wait: quit received");
+
+            return NXT_UNIT_ERROR;
+        }
+
+        rbuf = NULL;
+    }
+
+    port_msg = (nxt_port_msg_t *) rbuf->buf;
+    last = port_msg->last;
+
+    res = nxt_unit_process_msg(ctx, rbuf, NULL);
+    if (nxt_slow_path(res == NXT_UNIT_ERROR)) {
+        return NXT_UNIT_ERROR;
+    }
+
+    if (nxt_slow_path(last)) {
+        nxt_unit_req_warn(req, "request body is incomplete");
+
+        req->content_length = 0;
+
+        return NXT_UNIT_ERROR;
+    }
+
+    return NXT_UNIT_OK;
+}
+
+
+/*
+ * Frees the consumed parts of a streamed request body and reports their
+ * size to the router in a SHM_ACK message of the request stream; the router
+ * stops reading the body from the client while too much of it is unacked.
+ */
+
+static int
+nxt_unit_request_content_release(nxt_unit_request_info_t *req)
+{
+    ssize_t                       res;
+    nxt_unit_impl_t               *lib;
+    nxt_unit_mmap_buf_t           *b, *next;
+    nxt_unit_ctx_impl_t           *ctx_impl;
+    nxt_unit_request_info_impl_t  *req_impl;
+
+    struct {
+        nxt_port_msg_t            msg;
+        uint32_t                  size;
+    } m;
+
+    if (req->content_buf != req->request_buf) {
+        b = nxt_container_of(req->request_buf, nxt_unit_mmap_buf_t, buf);
+
+        for (b = b->next; &b->buf != req->content_buf; b = next) {
+            next = b->next;
+
+            nxt_unit_mmap_buf_free(b);
+        }
+    }
+
+    req_impl = nxt_container_of(req, nxt_unit_request_info_impl_t, req);
+
+    if (req_impl->content_acked == req->content_length) {
+        return NXT_UNIT_OK;
+    }
+
+    lib = nxt_container_of(req->ctx->unit, nxt_unit_impl_t, unit);
+    ctx_impl = nxt_container_of(req->ctx, nxt_unit_ctx_impl_t, ctx);
+
+    memset(&m.msg, 0, sizeof(nxt_port_msg_t));
+
+    m.msg.stream = req_impl->stream;
+    m.msg.pid = lib->pid;
+    m.msg.reply_port = ctx_impl->read_port->id.id;
+    m.msg.type = _NXT_PORT_MSG_SHM_ACK;
+
+    m.size = nxt_min(req_impl->content_acked - req->content_length,
+                     UINT32_MAX);
+
+    req_impl->content_acked -= m.size;
+
+    res = nxt_unit_port_send(req->ctx, req->response_port, &m, sizeof(m),
+                             NULL);
+    if (nxt_slow_path(res != sizeof(m))) {
+        return NXT_UNIT_ERROR;
+    }
+
+    return NXT_UNIT_OK;
+}
+
+
 static ssize_t
 nxt_unit_buf_read(nxt_unit_buf_t **b, uint64_t *len, void *dst, size_t size)
 {
@@ -3339,7 +3636,7 @@ nxt_unit_websocket_sendv(nxt_unit_request_info_t *req, uint8_t opcode,
     }
 
     buf_size = 10 + payload_len;
-    alloc_size = nxt_min(buf_size, PORT_MMAP_DATA_SIZE);
+    alloc_size = nxt_min(buf_size, nxt_unit_mmap_data_size);
 
     rc = nxt_unit_get_outgoing_buf(req->ctx, req->response_port,
                                    alloc_size, alloc_size,
@@ -3382,7 +3679,7 @@ nxt_unit_websocket_sendv(nxt_unit_request_info_t *req, uint8_t opcode,
                     }
                 }
 
-                alloc_size = nxt_min(buf_size, PORT_MMAP_DATA_SIZE);
+                alloc_size = nxt_min(buf_size, nxt_unit_mmap_data_size);
 
                 rc = nxt_unit_get_outgoing_buf(req->ctx, req->response_port,
                                                alloc_size, alloc_size,
@@ -3561,7 +3858,7 @@ nxt_unit_mmap_get(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
         }
 
         if (nxt_slow_path(lib->outgoing.allocated_chunks + min_n
-                          >= lib->shm_mmap_limit * PORT_MMAP_CHUNK_COUNT))
+                          >= lib->shm_mmap_limit * lib->shm_mmap_chunks))
         {
             /* Memory allocated by application, but not send to router. */
             return NULL;
@@ -3744,6 +4041,7 @@ nxt_unit_new_mmap(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port, int n)
 {
     int                     i, fd, rc;
     void                    *mem;
+    size_t                  size;
     nxt_unit_mmap_t         *mm;
     nxt_unit_impl_t         *lib;
     nxt_port_mmap_header_t  *hdr;
@@ -3757,22 +4055,52 @@ nxt_unit_new_mmap(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port, int n)
         return NULL;
     }
 
-    fd = nxt_unit_shm_open(ctx, PORT_MMAP_SIZE);
-    if (nxt_slow_path(fd == -1)) {
-        goto remove_fail;
+    fd = -1;
+    mem = MAP_FAILED;
+
+    if (lib->shm_huge_pages) {
+        size = nxt_port_mmap_size(lib->shm_mmap_chunks, 1);
+
+        fd = nxt_unit_shm_open(ctx, size, 1);
+
+        if (fd != -1) {
+            mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (mem == MAP_FAILED) {
+                nxt_unit_close(fd);
+                fd = -1;
+            }
+        }
+
+        if (fd == -1) {
+            nxt_unit_warn(ctx, "huge pages are not available, "
+                          "shared memory falls back to regular pages");
+
+            lib->shm_huge_pages = 0;
+        }
     }
 
-    mem = mmap(NULL, PORT_MMAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (nxt_slow_path(mem == MAP_FAILED)) {
-        nxt_unit_alert(ctx, "mmap(%d) failed: %s (%d)", fd,
-                       strerror(errno), errno);
+    if (fd == -1) {
+        size = nxt_port_mmap_size(lib->shm_mmap_chunks, 0);
 
-        nxt_unit_close(fd);
+        fd = nxt_unit_shm_open(ctx, size, 0);
+        if (nxt_slow_path(fd == -1)) {
+            goto remove_fail;
+        }
 
-        goto remove_fail;
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (nxt_slow_path(mem == MAP_FAILED)) {
+            nxt_unit_alert(ctx, "mmap(%d) failed: %s (%d)", fd,
+                           strerror(errno), errno);
+
+            nxt_unit_close(fd);
+
+            goto remove_fail;
+        }
     }
 
     mm->hdr = mem;
+    mm->size = size;
     hdr = mem;
 
     memset(hdr->free_map, 0xFFU, sizeof(hdr->free_map));
@@ -3789,15 +4117,14 @@ nxt_unit_new_mmap(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port, int n)
         nxt_port_mmap_set_chunk_busy(hdr->free_map, i);
     }
 
-    /* Mark as busy chunk followed the last available chunk. */
-    nxt_port_mmap_set_chunk_busy(hdr->free_map, PORT_MMAP_CHUNK_COUNT);
-    nxt_port_mmap_set_chunk_busy(hdr->free_tracking_map, PORT_MMAP_CHUNK_COUNT);
+    /* Mark as busy chunks followed the last available chunk. */
+    nxt_port_mmap_reserve_chunks(hdr, lib->shm_mmap_chunks);
 
     pthread_mutex_unlock(&lib->outgoing.mutex);
 
     rc = nxt_unit_send_mmap(ctx, port, fd);
     if (nxt_slow_path(rc != NXT_UNIT_OK)) {
-        munmap(mem, PORT_MMAP_SIZE);
+        munmap(mem, size);
         hdr = NULL;
 
     } else {
@@ -3822,10 +4149,20 @@ nxt_unit_new_mmap(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port, int n)
 
 
 static int
-nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size)
+nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size, int huge)
 {
     int              fd;
 
+#if (NXT_HAVE_MEMFD_CREATE && defined MFD_HUGETLB)
+    unsigned         flags;
+#else
+
+    if (huge) {
+        return -1;
+    }
+
+#endif
+
 #if (NXT_HAVE_MEMFD_CREATE || NXT_HAVE_SHM_OPEN)
     char             name[64];
     nxt_unit_impl_t  *lib;
@@ -3837,8 +4174,20 @@ nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size)
 
 #if (NXT_HAVE_MEMFD_CREATE)
 
+#if (defined MFD_HUGETLB)
+    flags = huge ? MFD_CLOEXEC | MFD_HUGETLB : MFD_CLOEXEC;
+
+    fd = syscall(SYS_memfd_create, name, flags);
+#else
     fd = syscall(SYS_memfd_create, name, MFD_CLOEXEC);
+#endif
     if (nxt_slow_path(fd == -1)) {
+        if (huge) {
+            nxt_unit_debug(ctx, "memfd_create(%s, MFD_HUGETLB) failed: "
+                           "%s (%d)", name, strerror(errno), errno);
+            return -1;
+        }
+
         nxt_unit_alert(ctx, "memfd_create(%s) failed: %s (%d)", name,
                        strerror(errno), errno);
 
@@ -3882,8 +4231,14 @@ nxt_unit_shm_open(nxt_unit_ctx_t *ctx, size_t size)
 #endif
 
     if (nxt_slow_path(ftruncate(fd, size) == -1)) {
-        nxt_unit_alert(ctx, "ftruncate(%d) failed: %s (%d)", fd,
-                       strerror(errno), errno);
+        if (huge) {
+            nxt_unit_debug(ctx, "ftruncate(%d) failed: %s (%d)", fd,
+                           strerror(errno), errno);
+
+        } else {
+            nxt_unit_alert(ctx, "ftruncate(%d) failed: %s (%d)", fd,
+                           strerror(errno), errno);
+        }
 
         nxt_unit_close(fd);
 
@@ -4034,7 +4389,7 @@ nxt_unit_incoming_mmap(nxt_unit_ctx_t *ctx, pid_t pid, int fd)
                        "detected: %d != %d or %d != %d", (int) hdr->src_pid,
                        (int) pid, (int) hdr->dst_pid, (int) lib->pid);
 
-        munmap(mem, PORT_MMAP_SIZE);
+        munmap(mem, mmap_stat.st_size);
 
         return NXT_UNIT_ERROR;
     }
@@ -4047,12 +4402,13 @@ nxt_unit_incoming_mmap(nxt_unit_ctx_t *ctx, pid_t pid, int fd)
     if (nxt_slow_path(mm == NULL)) {
         nxt_unit_alert(ctx, "incoming_mmap: failed to add to incoming array");
 
-        munmap(mem, PORT_MMAP_SIZE);
+        munmap(mem, mmap_stat.st_size);
 
         rc = NXT_UNIT_ERROR;
 
     } else {
         mm->hdr = hdr;
+        mm->size = mmap_stat.st_size;
 
         hdr->sent_over = 0xFFFFu;
 
@@ -4153,7 +4509,7 @@ nxt_unit_mmaps_destroy(nxt_unit_mmaps_t *mmaps)
         end = mmaps->elts + mmaps->size;
 
         for (mm = mmaps->elts; mm < end; mm++) {
-            munmap(mm->hdr, PORT_MMAP_SIZE);
+            munmap(mm->hdr, mm->size);
         }
 
         nxt_unit_free(NULL, mmaps->elts);
@@ -4607,7 +4963,7 @@ nxt_unit_run_once_impl(nxt_unit_ctx_t *ctx)
 static int
 nxt_unit_read_buf(nxt_unit_ctx_t *ctx, nxt_unit_read_buf_t *rbuf)
 {
-    int                   nevents, res, err;
+    int                   nevents, res, err, shared;
     nxt_uint_t            nfds;
     nxt_unit_impl_t       *lib;
     nxt_unit_ctx_impl_t   *ctx_impl;
@@ -4616,15 +4972,24 @@ nxt_unit_read_buf(nxt_unit_ctx_t *ctx, nxt_unit_read_buf_t *rbuf)
 
     ctx_impl = nxt_container_of(ctx, nxt_unit_ctx_impl_t, ctx);
 
-    if (ctx_impl->wait_items > 0 || !nxt_unit_chk_ready(ctx)) {
+    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+
+    shared = (ctx_impl->wait_items == 0 && nxt_unit_chk_ready(ctx));
+
+    if (lib->spin_wait != 0) {
+        res = nxt_unit_read_buf_spin(ctx, rbuf, shared);
+        if (res == NXT_UNIT_OK) {
+            return NXT_UNIT_OK;
+        }
+    }
+
+    if (!shared) {
         return nxt_unit_ctx_port_recv(ctx, ctx_impl->read_port, rbuf);
     }
 
     port_impl = nxt_container_of(ctx_impl->read_port, nxt_unit_port_impl_t,
                                  port);
 
-    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
-
 retry:
 
     if (port_impl->from_socket == 0) {
@@ -4671,6 +5036,11 @@ nxt_unit_read_buf(nxt_unit_ctx_t *ctx, nxt_unit_read_buf_t *rbuf)
     fds[1].revents = 0;
 
     nevents = poll(fds, nfds, -1);
+
+    if (lib->spin_wait != 0) {
+        nxt_unit_spin_stat(lib, 1);
+    }
+
     if (nxt_slow_path(nevents == -1)) {
         err = errno;
 
@@ -4833,8 +5203,11 @@ nxt_unit_process_ready_req(nxt_unit_ctx_t *ctx)
             /*
              * If application have separate data handler, we may start
              * request processing and process data when it is arrived.
+             * A streamed body is read by the request handler itself.
              */
-            if (lib->callbacks.data_handler == NULL) {
+            if (lib->callbacks.data_handler == NULL
+                && !req->request->content_stream)
+            {
                 continue;
             }
         }
@@ -4932,6 +5305,22 @@ nxt_unit_is_shm_ack(nxt_unit_read_buf_t *rbuf)
 }
 
 
+nxt_inline int
+nxt_unit_is_req_body(nxt_unit_read_buf_t *rbuf, uint32_t stream)
+{
+    nxt_port_msg_t  *port_msg;
+
+    if (nxt_fast_path(rbuf->size >= (ssize_t) sizeof(nxt_port_msg_t))) {
+        port_msg = (nxt_port_msg_t *) rbuf->buf;
+
+        return port_msg->type == _NXT_PORT_MSG_REQ_BODY
+               && port_msg->stream == stream;
+    }
+
+    return 0;
+}
+
+
 nxt_inline int
 nxt_unit_is_quit(nxt_unit_read_buf_t *rbuf)
 {
@@ -4961,6 +5350,20 @@ nxt_unit_run_shared(nxt_unit_ctx_t *ctx)
     rc = NXT_UNIT_OK;
 
     while (nxt_fast_path(nxt_unit_chk_ready(ctx))) {
+        rc = nxt_unit_shared_port_drain(ctx, lib->shared_port);
+
+        if (rc == NXT_UNIT_AGAIN && lib->spin_wait != 0) {
+            rc = nxt_unit_shared_port_spin(ctx);
+        }
+
+        if (rc == NXT_UNIT_OK) {
+            continue;
+        }
+
+        if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
+            break;
+        }
+
         rbuf = nxt_unit_read_buf_get(ctx);
         if (nxt_slow_path(rbuf == NULL)) {
             rc = NXT_UNIT_ERROR;
@@ -4974,6 +5377,10 @@ nxt_unit_run_shared(nxt_unit_ctx_t *ctx)
             goto retry;
         }
 
+        if (lib->spin_wait != 0) {
+            nxt_unit_spin_stat(lib, 1);
+        }
+
         if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
             nxt_unit_read_buf_release(ctx, rbuf);
             break;
@@ -5054,8 +5461,20 @@ nxt_unit_process_port_msg_impl(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port)
 
     lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
 
-    if (port == lib->shared_port && !nxt_unit_chk_ready(ctx)) {
-        return NXT_UNIT_AGAIN;
+    if (port == lib->shared_port) {
+        if (!nxt_unit_chk_ready(ctx)) {
+            return NXT_UNIT_AGAIN;
+        }
+
+        rc = nxt_unit_shared_port_drain(ctx, port);
+
+        if (rc == NXT_UNIT_OK) {
+            goto done;
+        }
+
+        if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
+            return NXT_UNIT_ERROR;
+        }
     }
 
     rbuf = nxt_unit_read_buf_get(ctx);
@@ -5080,6 +5499,8 @@ nxt_unit_process_port_msg_impl(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port)
         return NXT_UNIT_ERROR;
     }
 
+done:
+
     rc = nxt_unit_process_pending_rbuf(ctx);
     if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
         return NXT_UNIT_ERROR;
@@ -5134,7 +5555,7 @@ nxt_unit_ctx_alloc(nxt_unit_ctx_t *ctx, void *data)
 
     new_ctx->read_port = port;
 
-    queue_fd = nxt_unit_shm_open(&new_ctx->ctx, sizeof(nxt_port_queue_t));
+    queue_fd = nxt_unit_shm_open(&new_ctx->ctx, sizeof(nxt_port_queue_t), 0);
     if (nxt_slow_path(queue_fd == -1)) {
         goto fail;
     }
@@ -6185,6 +6606,208 @@ nxt_unit_shared_port_recv(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
 }
 
 
+/*
+ * Processes a batch of requests from the shared port queue.  Used by
+ * asynchronous contexts, which do not block on a request while the rest
+ * of the batch waits.  Returns NXT_UNIT_AGAIN if the queue is empty.
+ */
+
+static int
+nxt_unit_shared_port_drain(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port)
+{
+    int                  rc;
+    nxt_uint_t           i, n;
+    nxt_app_queue_msg_t  msgs[NXT_APP_QUEUE_BATCH];
+    nxt_unit_read_buf_t  *rbuf;
+
+    n = nxt_unit_app_queue_recv_batch(ctx, port, msgs, NXT_APP_QUEUE_BATCH);
+    if (n == 0) {
+        return NXT_UNIT_AGAIN;
+    }
+
+    for (i = 0; i < n; i++) {
+        rbuf = nxt_unit_read_buf_get(ctx);
+        if (nxt_slow_path(rbuf == NULL)) {
+            return NXT_UNIT_ERROR;
+        }
+
+        memcpy(rbuf->buf, msgs[i].data, msgs[i].size);
+        rbuf->size = msgs[i].size;
+
+        rc = nxt_unit_process_msg(ctx, rbuf, NULL);
+        if (nxt_slow_path(rc == NXT_UNIT_ERROR)) {
+            return NXT_UNIT_ERROR;
+        }
+    }
+
+    return NXT_UNIT_OK;
+}
+
+
+/*
+ * Polls the context port queue and, for a ready context, the shared queue
+ * until a message arrives or spin_wait expires.  Meanwhile the context
+ * port queue is held non-empty, so the router enqueues messages without
+ * writing notifications to the socket.
+ */
+
+static int
+nxt_unit_read_buf_spin(nxt_unit_ctx_t *ctx, nxt_unit_read_buf_t *rbuf,
+    int shared)
+{
+    int                   res;
+    nxt_unit_impl_t       *lib;
+    nxt_unit_spin_t       spin;
+    nxt_port_queue_t      *queue;
+    nxt_unit_ctx_impl_t   *ctx_impl;
+    nxt_unit_port_impl_t  *port_impl;
+
+    ctx_impl = nxt_container_of(ctx, nxt_unit_ctx_impl_t, ctx);
+    port_impl = nxt_container_of(ctx_impl->read_port, nxt_unit_port_impl_t,
+                                 port);
+
+    if (port_impl->from_socket > 0) {
+        return NXT_UNIT_AGAIN;
+    }
+
+    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+    queue = port_impl->queue;
+
+    nxt_atomic_fetch_add(&queue->nitems, 1);
+
+    nxt_unit_spin_start(lib, &spin);
+
+    do {
+        res = nxt_unit_port_queue_recv(ctx_impl->read_port, rbuf);
+
+        if (res == NXT_UNIT_OK) {
+            if (nxt_unit_is_read_socket(rbuf)) {
+                port_impl->from_socket++;
+                res = NXT_UNIT_AGAIN;
+            }
+
+            break;
+        }
+
+        if (shared) {
+            res = nxt_unit_app_queue_recv(ctx, lib->shared_port, rbuf);
+            if (res == NXT_UNIT_OK) {
+                break;
+            }
+        }
+
+    } while (nxt_unit_spin(&spin));
+
+    nxt_atomic_fetch_add(&queue->nitems, -1);
+
+    if (res == NXT_UNIT_OK) {
+        nxt_unit_spin_stat(lib, 0);
+    }
+
+    return res;
+}
+
+
+static int
+nxt_unit_shared_port_spin(nxt_unit_ctx_t *ctx)
+{
+    int              rc;
+    nxt_unit_impl_t  *lib;
+    nxt_unit_spin_t  spin;
+
+    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+
+    nxt_unit_spin_start(lib, &spin);
+
+    while (nxt_unit_spin(&spin)) {
+        rc = nxt_unit_shared_port_drain(ctx, lib->shared_port);
+
+        if (rc != NXT_UNIT_AGAIN) {
+            if (rc == NXT_UNIT_OK) {
+                nxt_unit_spin_stat(lib, 0);
+            }
+
+            return rc;
+        }
+    }
+
+    return NXT_UNIT_AGAIN;
+}
+
+
+static void
+nxt_unit_spin_start(nxt_unit_impl_t *lib, nxt_unit_spin_t *spin)
+{
+    spin->deadline = nxt_unit_monotonic_time() + lib->spin_wait;
+    spin->pause = 1;
+}
+
+
+/*
+ * Pauses the CPU for a period that doubles with each call up to
+ * NXT_UNIT_SPIN_PAUSE_MAX pauses.  Returns 0 once the deadline passes.
+ */
+
+static int
+nxt_unit_spin(nxt_unit_spin_t *spin)
+{
+    nxt_uint_t  i;
+
+    if (nxt_unit_monotonic_time() >= spin->deadline) {
+        return 0;
+    }
+
+    for (i = 0; i < spin->pause; i++) {
+        nxt_cpu_pause();
+    }
+
+    if (spin->pause < NXT_UNIT_SPIN_PAUSE_MAX) {
+        spin->pause *= 2;
+    }
+
+    return 1;
+}
+
+
+/*
+ * The counters live in the shared queue, so they add up for all
+ * processes of the application and are reported by the router.
+ */
+
+static void
+nxt_unit_spin_stat(nxt_unit_impl_t *lib, int woken)
+{
+    nxt_app_queue_t       *queue;
+    nxt_unit_port_impl_t  *port_impl;
+
+    if (nxt_slow_path(lib->shared_port == NULL)) {
+        return;
+    }
+
+    port_impl = nxt_container_of(lib->shared_port, nxt_unit_port_impl_t,
+                                 port);
+    queue = port_impl->queue;
+
+    if (woken) {
+        nxt_atomic_fetch_add(&queue->wakeups, 1);
+
+    } else {
+        nxt_atomic_fetch_add(&queue->spins, 1);
+    }
+}
+
+
+nxt_inline uint64_t
+nxt_unit_monotonic_time(void)
+{
+    struct timespec  ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
 static int
 nxt_unit_port_recv(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
     nxt_unit_read_buf_t *rbuf)
@@ -6269,14 +6892,8 @@ nxt_unit_app_queue_recv(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
     uint32_t              cookie;
     nxt_port_msg_t        *port_msg;
     nxt_app_queue_t       *queue;
-    nxt_unit_impl_t       *lib;
     nxt_unit_port_impl_t  *port_impl;
 
-    struct {
-        nxt_port_msg_t    msg;
-        uint8_t           quit_param;
-    } nxt_packed m;
-
     port_impl = nxt_container_of(port, nxt_unit_port_impl_t, port);
     queue = port_impl->queue;
 
@@ -6290,34 +6907,86 @@ nxt_unit_app_queue_recv(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
         port_msg = (nxt_port_msg_t *) rbuf->buf;
 
         if (nxt_app_queue_cancel(queue, cookie, port_msg->stream)) {
-            lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+            nxt_unit_request_limit_count(ctx);
 
-            if (lib->request_limit != 0) {
-                nxt_atomic_fetch_add(&lib->request_count, 1);
+            return NXT_UNIT_OK;
+        }
 
-                if (nxt_slow_path(lib->request_count >= lib->request_limit)) {
-                    nxt_unit_debug(ctx, "request limit reached");
+        nxt_unit_debug(NULL, "app_queue_recv: message cancelled");
 
-                    memset(&m.msg, 0, sizeof(nxt_port_msg_t));
+        goto retry;
+    }
 
-                    m.msg.pid = lib->pid;
-                    m.msg.type = _NXT_PORT_MSG_QUIT;
-                    m.quit_param = NXT_QUIT_GRACEFUL;
+    return (rbuf->size == -1) ? NXT_UNIT_AGAIN : NXT_UNIT_OK;
+}
 
-                    (void) nxt_unit_port_send(ctx, lib->main_ctx.read_port,
-                                              &m, sizeof(m), NULL);
-                }
-            }
 
-            return NXT_UNIT_OK;
+/*
+ * Dequeues a batch of messages from the application queue.  The batch
+ * never exceeds the number of requests left until the request limit.
+ */
+
+static nxt_uint_t
+nxt_unit_app_queue_recv_batch(nxt_unit_ctx_t *ctx, nxt_unit_port_t *port,
+    nxt_app_queue_msg_t *msgs, nxt_uint_t n)
+{
+    nxt_uint_t            i;
+    nxt_unit_impl_t       *lib;
+    nxt_unit_port_impl_t  *port_impl;
+
+    port_impl = nxt_container_of(port, nxt_unit_port_impl_t, port);
+
+    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+
+    if (lib->request_limit != 0) {
+        if (lib->request_count >= lib->request_limit) {
+            return 0;
         }
 
-        nxt_unit_debug(NULL, "app_queue_recv: message cancelled");
+        n = nxt_min(n, (nxt_uint_t) (lib->request_limit
+                                     - lib->request_count));
+    }
 
-        goto retry;
+    n = nxt_app_queue_recv_batch(port_impl->queue, msgs, n);
+
+    nxt_unit_debug(ctx, "app_queue_recv_batch: %d", (int) n);
+
+    for (i = 0; i < n; i++) {
+        nxt_unit_request_limit_count(ctx);
     }
 
-    return (rbuf->size == -1) ? NXT_UNIT_AGAIN : NXT_UNIT_OK;
+    return n;
+}
+
+
+static void
+nxt_unit_request_limit_count(nxt_unit_ctx_t *ctx)
+{
+    nxt_unit_impl_t  *lib;
+
+    struct {
+        nxt_port_msg_t   msg;
+        uint8_t          quit_param;
+    } nxt_packed m;
+
+    lib = nxt_container_of(ctx->unit, nxt_unit_impl_t, unit);
+
+    if (lib->request_limit != 0) {
+        nxt_atomic_fetch_add(&lib->request_count, 1);
+
+        if (nxt_slow_path(lib->request_count >= lib->request_limit)) {
+            nxt_unit_debug(ctx, "request limit reached");
+
+            memset(&m.msg, 0, sizeof(nxt_port_msg_t));
+
+            m.msg.pid = lib->pid;
+            m.msg.type = _NXT_PORT_MSG_QUIT;
+            m.quit_param = NXT_QUIT_GRACEFUL;
+
+            (void) nxt_unit_port_send(ctx, lib->main_ctx.read_port,
+                                      &m, sizeof(m), NULL);
+        }
+    }
 }
 
 
@@ -169,6 +169,9 @@ struct nxt_unit_init_s {
     uint32_t              request_data_size;
     uint32_t              shm_limit;
     uint32_t              request_limit;
+    uint32_t              shm_segment_size;
+    uint8_t               shm_huge_pages;
+    uint32_t              spin_wait;  /* usec */
 
     nxt_unit_callbacks_t  callbacks;
 
@@ -7,6 +7,7 @@
 #include <nxt_router.h>
 #include <nxt_http.h>
 #include <nxt_upstream.h>
+#include <nxt_status.h>
 
 
 static nxt_http_action_t *nxt_upstream_handler(nxt_task_t *task,
@@ -47,6 +48,11 @@ nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return NXT_ERROR;
     }
 
+    upstreams->health = nxt_upstreams_health_create(task, tmcf);
+    if (nxt_slow_path(upstreams->health == NULL)) {
+        return NXT_ERROR;
+    }
+
     upstreams->items = n;
     next = 0;
 
@@ -58,8 +64,15 @@ nxt_upstreams_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             return NXT_ERROR;
         }
 
+        ret = nxt_router_metric_conf(tmcf->router_conf,
+                                     NXT_STATUS_METRIC_UPSTREAM, string);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
         ret = nxt_upstream_round_robin_create(task, tmcf, upcf,
-                                              &upstreams->upstream[i]);
+                                              &upstreams->upstream[i],
+                                              upstreams->health);
         if (nxt_slow_path(ret != NXT_OK)) {
             return NXT_ERROR;
         }
@@ -147,5 +160,10 @@ nxt_upstream_handler(nxt_task_t *task, nxt_http_request_t *r,
 
     nxt_debug(task, "upstream handler: \"%V\"", &u->name);
 
+    nxt_router_metric_release(r->target_metric);
+
+    r->target_metric = nxt_router_metric(task->thread->engine,
+                                         NXT_STATUS_METRIC_UPSTREAM, &u->name);
+
     return nxt_upstream_proxy_handler(task, r, u);
 }
@@ -12,6 +12,8 @@ typedef struct nxt_upstream_proxy_s            nxt_upstream_proxy_t;
 typedef struct nxt_upstream_round_robin_s      nxt_upstream_round_robin_t;
 typedef struct nxt_upstream_round_robin_server_s
     nxt_upstream_round_robin_server_t;
+typedef struct nxt_upstream_health_s           nxt_upstream_health_t;
+typedef struct nxt_upstream_probe_s            nxt_upstream_probe_t;
 
 
 typedef void (*nxt_upstream_peer_ready_t)(nxt_task_t *task,
@@ -30,11 +32,14 @@ typedef nxt_upstream_t *(*nxt_upstream_joint_create_t)(
     nxt_router_temp_conf_t *tmcf, nxt_upstream_t *upstream);
 typedef void (*nxt_upstream_server_get_t)(nxt_task_t *task,
     nxt_upstream_server_t *us);
+typedef void (*nxt_upstream_server_free_t)(nxt_task_t *task,
+    nxt_upstream_server_t *us, nxt_bool_t failed);
 
 
 typedef struct {
     nxt_upstream_joint_create_t                joint_create;
     nxt_upstream_server_get_t                  get;
+    nxt_upstream_server_free_t                 free;
 } nxt_upstream_server_proto_t;
 
 
@@ -51,6 +56,7 @@ struct nxt_upstream_s {
 
 
 struct nxt_upstreams_s {
+    nxt_upstreams_health_t                     *health;
     uint32_t                                   items;
     nxt_upstream_t                             upstream[];
 };
@@ -63,6 +69,9 @@ struct nxt_upstream_server_s {
 
     uint8_t                                    protocol;
 
+    nxt_nsec_t                                 start;
+    nxt_nsec_t                                 header_time;
+
     union {
         nxt_upstream_round_robin_server_t      *round_robin;
     } server;
@@ -73,9 +82,64 @@ struct nxt_upstream_server_s {
 };
 
 
+/*
+ * The health state is shared by all engines and is updated
+ * without locks, so the fields may be read slightly stale.
+ */
+
+struct nxt_upstream_health_s {
+    nxt_atomic_t                               fails;
+    volatile nxt_msec_t                        fail_time;
+    volatile uint8_t                           down;       /* 1 bit */
+    volatile uint8_t                           unhealthy;  /* 1 bit */
+
+    uint32_t                                   max_fails;
+    nxt_msec_t                                 fail_timeout;
+
+    nxt_str_t                                  upstream;
+    nxt_str_t                                  name;
+    nxt_sockaddr_t                             *sockaddr;
+    nxt_upstream_probe_t                       *probe;
+};
+
+
+struct nxt_upstreams_health_s {
+    nxt_mp_t                                   *mem_pool;
+    nxt_atomic_t                               count;
+    volatile uint8_t                           stop;       /* 1 bit */
+
+    nxt_array_t                                *servers;
+};
+
+
 nxt_int_t nxt_upstream_round_robin_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *upstream_conf,
-    nxt_upstream_t *upstream);
+    nxt_upstream_t *upstream, nxt_upstreams_health_t *health);
+
+nxt_upstreams_health_t *nxt_upstreams_health_create(nxt_task_t *task,
+    nxt_router_temp_conf_t *tmcf);
+nxt_upstream_health_t *nxt_upstream_health_add(nxt_upstreams_health_t *uh,
+    nxt_str_t *upstream, nxt_str_t *name, nxt_sockaddr_t *sa,
+    nxt_conf_value_t *server_conf, nxt_conf_value_t *check_conf);
+void nxt_upstream_health_failed(nxt_task_t *task, nxt_upstream_health_t *h);
+void nxt_upstream_health_passed(nxt_task_t *task, nxt_upstream_health_t *h);
+
+
+nxt_inline nxt_bool_t
+nxt_upstream_health_available(nxt_upstream_health_t *h, nxt_msec_t now)
+{
+    if (h->unhealthy) {
+        return 0;
+    }
+
+    if (h->down
+        && nxt_msec_diff(now, h->fail_time) < (nxt_msec_int_t) h->fail_timeout)
+    {
+        return 0;
+    }
+
+    return 1;
+}
 
 
 #endif /* _NXT_UPSTREAM_H_INCLUDED_ */
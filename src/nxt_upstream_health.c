@@ -0,0 +1,704 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include <nxt_upstream.h>
+
+
+typedef struct {
+    uint32_t                max_fails;
+    nxt_msec_t              fail_timeout;
+} nxt_upstream_health_conf_t;
+
+
+typedef struct {
+    nxt_msec_t              interval;
+    nxt_msec_t              timeout;
+    nxt_str_t               uri;
+} nxt_upstream_probe_conf_t;
+
+
+struct nxt_upstream_probe_s {
+    nxt_timer_t             timer;
+    nxt_msec_t              interval;
+    nxt_msec_t              timeout;
+    nxt_str_t               request;
+
+    nxt_upstream_health_t   *health;
+    nxt_upstreams_health_t  *upstreams_health;
+};
+
+
+static void nxt_upstreams_health_cleanup(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_upstream_probe_t *nxt_upstream_probe_create(
+    nxt_upstreams_health_t *uh, nxt_upstream_health_t *h,
+    nxt_conf_value_t *check_conf);
+static void nxt_upstream_probe_start(nxt_task_t *task, void *obj, void *data);
+static void nxt_upstream_probe_connected(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_probe_sent(nxt_task_t *task, void *obj, void *data);
+static void nxt_upstream_probe_read(nxt_task_t *task, void *obj, void *data);
+static void nxt_upstream_probe_closed(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_probe_error(nxt_task_t *task, void *obj, void *data);
+static void nxt_upstream_probe_send_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_upstream_probe_read_timeout(nxt_task_t *task, void *obj,
+    void *data);
+static nxt_msec_t nxt_upstream_probe_timer_value(nxt_conn_t *c,
+    uintptr_t data);
+static void nxt_upstream_probe_done(nxt_task_t *task, nxt_conn_t *c,
+    nxt_bool_t passed);
+static void nxt_upstream_probe_free(nxt_task_t *task, void *obj, void *data);
+
+
+static nxt_conf_map_t  nxt_upstream_health_conf[] = {
+    {
+        nxt_string("max_fails"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_upstream_health_conf_t, max_fails),
+    },
+
+    {
+        nxt_string("fail_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_health_conf_t, fail_timeout),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_upstream_probe_conf[] = {
+    {
+        nxt_string("interval"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_probe_conf_t, interval),
+    },
+
+    {
+        nxt_string("timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_upstream_probe_conf_t, timeout),
+    },
+
+    {
+        nxt_string("uri"),
+        NXT_CONF_MAP_STR,
+        offsetof(nxt_upstream_probe_conf_t, uri),
+    },
+};
+
+
+static const nxt_conn_state_t  nxt_upstream_probe_connect_state;
+static const nxt_conn_state_t  nxt_upstream_probe_send_state;
+static const nxt_conn_state_t  nxt_upstream_probe_read_state;
+static const nxt_conn_state_t  nxt_upstream_probe_close_state;
+
+
+/*
+ * The health state of upstream servers is allocated in a separate memory
+ * pool, because it is used by active probes and by the status report
+ * that may outlive the router configuration.  The configuration holds
+ * a reference that is released when the configuration is destroyed.
+ */
+
+nxt_upstreams_health_t *
+nxt_upstreams_health_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
+{
+    nxt_mp_t                *mp;
+    nxt_int_t               ret;
+    nxt_upstreams_health_t  *uh;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return NULL;
+    }
+
+    uh = nxt_mp_zget(mp, sizeof(nxt_upstreams_health_t));
+    if (nxt_slow_path(uh == NULL)) {
+        goto fail;
+    }
+
+    uh->mem_pool = mp;
+    uh->count = 1;
+
+    uh->servers = nxt_array_create(mp, 4, sizeof(nxt_upstream_health_t *));
+    if (nxt_slow_path(uh->servers == NULL)) {
+        goto fail;
+    }
+
+    ret = nxt_mp_cleanup(tmcf->router_conf->mem_pool,
+                         nxt_upstreams_health_cleanup, &tmcf->engine->task,
+                         uh, NULL);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        goto fail;
+    }
+
+    return uh;
+
+fail:
+
+    nxt_mp_destroy(mp);
+
+    return NULL;
+}
+
+
+static void
+nxt_upstreams_health_cleanup(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_upstreams_health_t  *uh;
+
+    uh = obj;
+
+    uh->stop = 1;
+
+    nxt_upstreams_health_release(uh);
+}
+
+
+void
+nxt_upstreams_health_use(nxt_upstreams_health_t *uh)
+{
+    (void) nxt_atomic_fetch_add(&uh->count, 1);
+}
+
+
+void
+nxt_upstreams_health_release(nxt_upstreams_health_t *uh)
+{
+    nxt_mp_t  *mp;
+
+    if (nxt_atomic_fetch_add(&uh->count, -1) == 1) {
+        mp = uh->mem_pool;
+
+        nxt_mp_thread_adopt(mp);
+        nxt_mp_destroy(mp);
+    }
+}
+
+
+nxt_upstream_health_t *
+nxt_upstream_health_add(nxt_upstreams_health_t *uh, nxt_str_t *upstream,
+    nxt_str_t *name, nxt_sockaddr_t *sa, nxt_conf_value_t *server_conf,
+    nxt_conf_value_t *check_conf)
+{
+    nxt_mp_t                    *mp;
+    nxt_int_t                   ret;
+    nxt_upstream_health_t       *h, **hp;
+    nxt_upstream_health_conf_t  hcf;
+
+    hcf.max_fails = 0;
+    hcf.fail_timeout = 10 * 1000;
+
+    ret = nxt_conf_map_object(uh->mem_pool, server_conf,
+                              nxt_upstream_health_conf,
+                              nxt_nitems(nxt_upstream_health_conf), &hcf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NULL;
+    }
+
+    mp = uh->mem_pool;
+
+    h = nxt_mp_zget(mp, sizeof(nxt_upstream_health_t));
+    if (nxt_slow_path(h == NULL)) {
+        return NULL;
+    }
+
+    h->max_fails = hcf.max_fails;
+    h->fail_timeout = hcf.fail_timeout;
+
+    if (nxt_slow_path(nxt_str_dup(mp, &h->upstream, upstream) == NULL
+                      || nxt_str_dup(mp, &h->name, name) == NULL))
+    {
+        return NULL;
+    }
+
+    h->sockaddr = nxt_sockaddr_copy(mp, sa);
+    if (nxt_slow_path(h->sockaddr == NULL)) {
+        return NULL;
+    }
+
+    if (check_conf != NULL) {
+        h->probe = nxt_upstream_probe_create(uh, h, check_conf);
+        if (nxt_slow_path(h->probe == NULL)) {
+            return NULL;
+        }
+    }
+
+    hp = nxt_array_add(uh->servers);
+    if (nxt_slow_path(hp == NULL)) {
+        return NULL;
+    }
+
+    *hp = h;
+
+    return h;
+}
+
+
+void
+nxt_upstream_health_failed(nxt_task_t *task, nxt_upstream_health_t *h)
+{
+    nxt_atomic_uint_t  fails;
+
+    if (h->max_fails == 0) {
+        return;
+    }
+
+    fails = nxt_atomic_fetch_add(&h->fails, 1) + 1;
+
+    nxt_debug(task, "upstream \"%V\" server \"%V\" fails: %uA",
+              &h->upstream, &h->name, fails);
+
+    if (fails >= h->max_fails) {
+        h->fail_time = task->thread->engine->timers.now;
+
+        if (!h->down) {
+            h->down = 1;
+
+            nxt_log(task, NXT_LOG_WARN,
+                    "upstream \"%V\" server \"%V\" is temporarily disabled "
+                    "after %uA failures", &h->upstream, &h->name, fails);
+        }
+    }
+}
+
+
+void
+nxt_upstream_health_passed(nxt_task_t *task, nxt_upstream_health_t *h)
+{
+    if (h->fails != 0) {
+        h->fails = 0;
+    }
+
+    if (h->down) {
+        h->down = 0;
+
+        nxt_log(task, NXT_LOG_NOTICE,
+                "upstream \"%V\" server \"%V\" is enabled",
+                &h->upstream, &h->name);
+    }
+}
+
+
+static nxt_upstream_probe_t *
+nxt_upstream_probe_create(nxt_upstreams_health_t *uh, nxt_upstream_health_t *h,
+    nxt_conf_value_t *check_conf)
+{
+    u_char                     *p;
+    size_t                     size;
+    nxt_int_t                  ret;
+    nxt_str_t                  host;
+    nxt_upstream_probe_t       *probe;
+    nxt_upstream_probe_conf_t  pcf;
+
+    static const char  get[] = "GET ";
+    static const char  version[] = " HTTP/1.1\r\nHost: ";
+    static const char  close[] = "\r\nConnection: close\r\n\r\n";
+
+    pcf.interval = 5 * 1000;
+    pcf.timeout = 1000;
+    nxt_str_set(&pcf.uri, "/");
+
+    ret = nxt_conf_map_object(uh->mem_pool, check_conf, nxt_upstream_probe_conf,
+                              nxt_nitems(nxt_upstream_probe_conf), &pcf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NULL;
+    }
+
+    probe = nxt_mp_zget(uh->mem_pool, sizeof(nxt_upstream_probe_t));
+    if (nxt_slow_path(probe == NULL)) {
+        return NULL;
+    }
+
+    if (h->sockaddr->u.sockaddr.sa_family == AF_UNIX) {
+        nxt_str_set(&host, "localhost");
+
+    } else {
+        host = h->name;
+    }
+
+    size = nxt_length(get) + pcf.uri.length + nxt_length(version)
+           + host.length + nxt_length(close);
+
+    p = nxt_mp_nget(uh->mem_pool, size);
+    if (nxt_slow_path(p == NULL)) {
+        return NULL;
+    }
+
+    probe->request.start = p;
+    probe->request.length = size;
+
+    p = nxt_cpymem(p, get, nxt_length(get));
+    p = nxt_cpymem(p, pcf.uri.start, pcf.uri.length);
+    p = nxt_cpymem(p, version, nxt_length(version));
+    p = nxt_cpymem(p, host.start, host.length);
+    nxt_memcpy(p, close, nxt_length(close));
+
+    probe->interval = pcf.interval;
+    probe->timeout = pcf.timeout;
+    probe->health = h;
+    probe->upstreams_health = uh;
+
+    return probe;
+}
+
+
+/*
+ * Probes run on the router main engine.  Each running probe holds
+ * a reference to the health state and stops once the configuration
+ * that has created it is destroyed.
+ */
+
+void
+nxt_upstreams_health_start(nxt_task_t *task, nxt_upstreams_health_t *uh)
+{
+    nxt_uint_t             i;
+    nxt_event_engine_t     *engine;
+    nxt_upstream_probe_t   *probe;
+    nxt_upstream_health_t  **hp;
+
+    engine = task->thread->engine;
+
+    hp = uh->servers->elts;
+
+    for (i = 0; i < uh->servers->nelts; i++) {
+        probe = hp[i]->probe;
+
+        if (probe == NULL) {
+            continue;
+        }
+
+        nxt_upstreams_health_use(uh);
+
+        probe->timer.bias = NXT_TIMER_DEFAULT_BIAS;
+        probe->timer.work_queue = &engine->fast_work_queue;
+        probe->timer.handler = nxt_upstream_probe_start;
+        probe->timer.task = &engine->task;
+        probe->timer.log = probe->timer.task->log;
+
+        nxt_timer_add(engine, &probe->timer, 0);
+    }
+}
+
+
+static void
+nxt_upstream_probe_start(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_mp_t              *mp;
+    nxt_buf_t             *b;
+    nxt_conn_t            *c;
+    nxt_timer_t           *timer;
+    nxt_event_engine_t    *engine;
+    nxt_upstream_probe_t  *probe;
+
+    timer = obj;
+
+    probe = nxt_timer_data(timer, nxt_upstream_probe_t, timer);
+
+    if (probe->upstreams_health->stop) {
+        nxt_debug(task, "upstream probe \"%V\" stopped", &probe->health->name);
+
+        nxt_upstreams_health_release(probe->upstreams_health);
+        return;
+    }
+
+    nxt_debug(task, "upstream probe \"%V\"", &probe->health->name);
+
+    engine = task->thread->engine;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        goto fail;
+    }
+
+    c = nxt_conn_create(mp, task);
+    if (nxt_slow_path(c == NULL)) {
+        nxt_mp_destroy(mp);
+        goto fail;
+    }
+
+    b = nxt_buf_mem_alloc(mp, probe->request.length, 0);
+    if (nxt_slow_path(b == NULL)) {
+        nxt_conn_free(task, c);
+        goto fail;
+    }
+
+    b->mem.free = nxt_cpymem(b->mem.free, probe->request.start,
+                             probe->request.length);
+
+    c->write = b;
+    c->remote = probe->health->sockaddr;
+    c->socket.data = probe;
+    c->socket.write_ready = 1;
+
+    c->read_work_queue = c->socket.read_work_queue;
+    c->write_work_queue = c->socket.write_work_queue;
+
+    c->write_state = &nxt_upstream_probe_connect_state;
+
+    nxt_conn_connect(engine, c);
+
+    return;
+
+fail:
+
+    nxt_timer_add(engine, &probe->timer, probe->interval);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_probe_connect_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_probe_connected,
+    .close_handler = nxt_upstream_probe_error,
+    .error_handler = nxt_upstream_probe_error,
+
+    .timer_handler = nxt_upstream_probe_send_timeout,
+    .timer_value = nxt_upstream_probe_timer_value,
+};
+
+
+static void
+nxt_upstream_probe_connected(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    nxt_debug(task, "upstream probe connected");
+
+    c->write_state = &nxt_upstream_probe_send_state;
+
+    nxt_conn_write(task->thread->engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_probe_send_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_probe_sent,
+    .error_handler = nxt_upstream_probe_error,
+
+    .timer_handler = nxt_upstream_probe_send_timeout,
+    .timer_value = nxt_upstream_probe_timer_value,
+    .timer_autoreset = 1,
+};
+
+
+static void
+nxt_upstream_probe_sent(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *b;
+    nxt_conn_t          *c;
+    nxt_event_engine_t  *engine;
+
+    c = obj;
+
+    engine = task->thread->engine;
+
+    if (nxt_buf_mem_used_size(&c->write->mem) != 0) {
+        nxt_conn_write(engine, c);
+        return;
+    }
+
+    nxt_debug(task, "upstream probe sent");
+
+    /* The status line is enough to check the response. */
+
+    b = c->write;
+    c->write = NULL;
+
+    b->mem.pos = b->mem.start;
+    b->mem.free = b->mem.start;
+
+    c->read = b;
+    c->read_state = &nxt_upstream_probe_read_state;
+
+    nxt_conn_read(engine, c);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_probe_read_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_probe_read,
+    .close_handler = nxt_upstream_probe_closed,
+    .error_handler = nxt_upstream_probe_error,
+
+    .timer_handler = nxt_upstream_probe_read_timeout,
+    .timer_value = nxt_upstream_probe_timer_value,
+};
+
+
+static void
+nxt_upstream_probe_read(nxt_task_t *task, void *obj, void *data)
+{
+    u_char      *p;
+    nxt_int_t   status;
+    nxt_buf_t   *b;
+    nxt_conn_t  *c;
+
+    c = obj;
+    b = c->read;
+
+    /* "HTTP/1.x NNN" */
+
+    if (nxt_buf_mem_used_size(&b->mem) < 12) {
+        if (nxt_buf_mem_free_size(&b->mem) != 0) {
+            nxt_conn_read(task->thread->engine, c);
+            return;
+        }
+
+        nxt_upstream_probe_done(task, c, 0);
+        return;
+    }
+
+    p = b->mem.pos;
+
+    if (nxt_slow_path(memcmp(p, "HTTP/1.", 7) != 0 || p[8] != ' ')) {
+        nxt_upstream_probe_done(task, c, 0);
+        return;
+    }
+
+    status = nxt_int_parse(&p[9], 3);
+
+    nxt_debug(task, "upstream probe status: %i", status);
+
+    nxt_upstream_probe_done(task, c, status >= 200 && status < 400);
+}
+
+
+static void
+nxt_upstream_probe_closed(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_debug(task, "upstream probe closed");
+
+    nxt_upstream_probe_done(task, obj, 0);
+}
+
+
+static void
+nxt_upstream_probe_error(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_debug(task, "upstream probe error");
+
+    nxt_upstream_probe_done(task, obj, 0);
+}
+
+
+static void
+nxt_upstream_probe_send_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "upstream probe send timeout");
+
+    c = nxt_write_timer_conn(timer);
+    c->block_write = 1;
+    c->block_read = 1;
+
+    nxt_upstream_probe_done(task, c, 0);
+}
+
+
+static void
+nxt_upstream_probe_read_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t   *c;
+    nxt_timer_t  *timer;
+
+    timer = obj;
+
+    nxt_debug(task, "upstream probe read timeout");
+
+    c = nxt_read_timer_conn(timer);
+    c->block_write = 1;
+    c->block_read = 1;
+
+    nxt_upstream_probe_done(task, c, 0);
+}
+
+
+static nxt_msec_t
+nxt_upstream_probe_timer_value(nxt_conn_t *c, uintptr_t data)
+{
+    nxt_upstream_probe_t  *probe;
+
+    probe = c->socket.data;
+
+    return probe->timeout;
+}
+
+
+static void
+nxt_upstream_probe_done(nxt_task_t *task, nxt_conn_t *c, nxt_bool_t passed)
+{
+    nxt_event_engine_t     *engine;
+    nxt_upstream_probe_t   *probe;
+    nxt_upstream_health_t  *h;
+
+    probe = c->socket.data;
+    h = probe->health;
+
+    if (h->unhealthy == passed) {
+        h->unhealthy = !passed;
+
+        if (passed) {
+            nxt_log(task, NXT_LOG_NOTICE,
+                    "upstream \"%V\" server \"%V\" is healthy",
+                    &h->upstream, &h->name);
+
+        } else {
+            nxt_log(task, NXT_LOG_WARN,
+                    "upstream \"%V\" server \"%V\" is unhealthy",
+                    &h->upstream, &h->name);
+        }
+    }
+
+    engine = task->thread->engine;
+
+    nxt_timer_disable(engine, &c->read_timer);
+    nxt_timer_disable(engine, &c->write_timer);
+
+    c->read = NULL;
+    c->write = NULL;
+
+    if (c->socket.fd != -1) {
+        c->write_state = &nxt_upstream_probe_close_state;
+
+        nxt_conn_close(engine, c);
+
+    } else {
+        nxt_conn_free(task, c);
+    }
+
+    nxt_timer_add(engine, &probe->timer, probe->interval);
+}
+
+
+static const nxt_conn_state_t  nxt_upstream_probe_close_state
+    nxt_aligned(64) =
+{
+    .ready_handler = nxt_upstream_probe_free,
+};
+
+
+static void
+nxt_upstream_probe_free(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_conn_t  *c;
+
+    c = obj;
+
+    nxt_debug(task, "upstream probe free");
+
+    nxt_conn_free(task, c);
+}
@@ -17,12 +17,20 @@ struct nxt_upstream_round_robin_server_s {
     int32_t                            effective_weight;
     int32_t                            weight;
 
+    nxt_upstream_health_t              *health;
+
+    /* Per-engine load state used by least_conn and peak_ewma. */
+    uint32_t                           active;
+    double                             ewma;
+    nxt_nsec_t                         ewma_time;
+
     uint8_t                            protocol;
 };
 
 
 struct nxt_upstream_round_robin_s {
     uint32_t                           items;
+    uint32_t                           next;
     nxt_upstream_round_robin_server_t  server[];
 };
 
@@ -31,17 +39,54 @@ static nxt_upstream_t *nxt_upstream_round_robin_joint_create(
     nxt_router_temp_conf_t *tmcf, nxt_upstream_t *upstream);
 static void nxt_upstream_round_robin_server_get(nxt_task_t *task,
     nxt_upstream_server_t *us);
+static void nxt_upstream_least_conn_server_get(nxt_task_t *task,
+    nxt_upstream_server_t *us);
+static void nxt_upstream_peak_ewma_server_get(nxt_task_t *task,
+    nxt_upstream_server_t *us);
+nxt_inline nxt_bool_t nxt_upstream_round_robin_server_usable(
+    nxt_upstream_round_robin_server_t *s, nxt_msec_t now);
+nxt_inline double nxt_upstream_peak_ewma_cost(
+    nxt_upstream_round_robin_server_t *s, nxt_nsec_t now);
+nxt_inline double nxt_upstream_peak_ewma_decay(
+    nxt_upstream_round_robin_server_t *s, nxt_nsec_t now);
+static void nxt_upstream_round_robin_server_ready(nxt_task_t *task,
+    nxt_upstream_server_t *us, nxt_upstream_round_robin_server_t *s);
+static void nxt_upstream_round_robin_server_free(nxt_task_t *task,
+    nxt_upstream_server_t *us, nxt_bool_t failed);
+
+
+/* The decay time of the peak EWMA latency, 10 seconds in nanoseconds. */
+#define NXT_UPSTREAM_EWMA_DECAY     10e9
+
+/* A latency floor making idle servers still differ by active requests. */
+#define NXT_UPSTREAM_EWMA_BASE      1e3
 
 
 static const nxt_upstream_server_proto_t  nxt_upstream_round_robin_proto = {
     .joint_create = nxt_upstream_round_robin_joint_create,
     .get          = nxt_upstream_round_robin_server_get,
+    .free         = nxt_upstream_round_robin_server_free,
+};
+
+
+static const nxt_upstream_server_proto_t  nxt_upstream_least_conn_proto = {
+    .joint_create = nxt_upstream_round_robin_joint_create,
+    .get          = nxt_upstream_least_conn_server_get,
+    .free         = nxt_upstream_round_robin_server_free,
+};
+
+
+static const nxt_upstream_server_proto_t  nxt_upstream_peak_ewma_proto = {
+    .joint_create = nxt_upstream_round_robin_joint_create,
+    .get          = nxt_upstream_peak_ewma_server_get,
+    .free         = nxt_upstream_round_robin_server_free,
 };
 
 
 nxt_int_t
 nxt_upstream_round_robin_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
-    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream)
+    nxt_conf_value_t *upstream_conf, nxt_upstream_t *upstream,
+    nxt_upstreams_health_t *health)
 {
     double                      total, k, w;
     size_t                      size;
@@ -49,17 +94,41 @@ nxt_upstream_round_robin_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_mp_t                    *mp;
     nxt_str_t                   name;
     nxt_sockaddr_t              *sa;
-    nxt_conf_value_t            *servers_conf, *srvcf, *wtcf;
+    nxt_conf_value_t            *servers_conf, *srvcf, *wtcf, *checkcf;
+    nxt_conf_value_t            *balancercf;
     nxt_upstream_round_robin_t  *urr;
 
+    const nxt_upstream_server_proto_t  *proto;
+
     static const nxt_str_t  servers = nxt_string("servers");
     static const nxt_str_t  weight = nxt_string("weight");
+    static const nxt_str_t  health_check = nxt_string("health_check");
+    static const nxt_str_t  balancer = nxt_string("balancer");
+    static const nxt_str_t  least_conn = nxt_string("least_conn");
+    static const nxt_str_t  peak_ewma = nxt_string("peak_ewma");
 
     mp = tmcf->router_conf->mem_pool;
 
     servers_conf = nxt_conf_get_object_member(upstream_conf, &servers, NULL);
     n = nxt_conf_object_members_count(servers_conf);
 
+    checkcf = nxt_conf_get_object_member(upstream_conf, &health_check, NULL);
+
+    proto = &nxt_upstream_round_robin_proto;
+
+    balancercf = nxt_conf_get_object_member(upstream_conf, &balancer, NULL);
+
+    if (balancercf != NULL) {
+        nxt_conf_get_string(balancercf, &name);
+
+        if (nxt_strstr_eq(&name, &least_conn)) {
+            proto = &nxt_upstream_least_conn_proto;
+
+        } else if (nxt_strstr_eq(&name, &peak_ewma)) {
+            proto = &nxt_upstream_peak_ewma_proto;
+        }
+    }
+
     total = 0.0;
     next = 0;
 
@@ -110,9 +179,17 @@ nxt_upstream_round_robin_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
         urr->server[i].weight = wt;
         urr->server[i].effective_weight = wt;
+
+        urr->server[i].health = nxt_upstream_health_add(health,
+                                                         &upstream->name,
+                                                         &name, sa, srvcf,
+                                                         checkcf);
+        if (nxt_slow_path(urr->server[i].health == NULL)) {
+            return NXT_ERROR;
+        }
     }
 
-    upstream->proto = &nxt_upstream_round_robin_proto;
+    upstream->proto = proto;
     upstream->type.round_robin = urr;
 
     return NXT_OK;
@@ -152,6 +229,7 @@ nxt_upstream_round_robin_joint_create(nxt_router_temp_conf_t *tmcf,
 
     n = urrcf->items;
     urr->items = n;
+    urr->next = 0;
 
     for (i = 0; i < n; i++) {
         urr->server[i] = urrcf->server[i];
@@ -166,6 +244,7 @@ nxt_upstream_round_robin_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
 {
     int32_t                            total;
     uint32_t                           i, n;
+    nxt_msec_t                         now;
     nxt_upstream_round_robin_t         *round_robin;
     nxt_upstream_round_robin_server_t  *s, *best;
 
@@ -177,8 +256,14 @@ nxt_upstream_round_robin_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
     s = round_robin->server;
     n = round_robin->items;
 
+    now = task->thread->engine->timers.now;
+
     for (i = 0; i < n; i++) {
 
+        if (!nxt_upstream_health_available(s[i].health, now)) {
+            continue;
+        }
+
         s[i].current_weight += s[i].effective_weight;
         total += s[i].effective_weight;
 
@@ -197,9 +282,216 @@ nxt_upstream_round_robin_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
     }
 
     best->current_weight -= total;
-    us->sockaddr = best->sockaddr;
-    us->protocol = best->protocol;
-    us->server.round_robin = best;
+
+    nxt_upstream_round_robin_server_ready(task, us, best);
+}
+
+
+static void
+nxt_upstream_least_conn_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    uint32_t                           i, k, n;
+    nxt_msec_t                         now;
+    nxt_upstream_round_robin_t         *round_robin;
+    nxt_upstream_round_robin_server_t  *s, *best;
+
+    best = NULL;
+
+    round_robin = us->upstream->type.round_robin;
+
+    s = round_robin->server;
+    n = round_robin->items;
+
+    now = task->thread->engine->timers.now;
+
+    /* The scan starts after the last chosen server to spread ties. */
+
+    for (k = 0; k < n; k++) {
+        i = (round_robin->next + k) % n;
+
+        if (!nxt_upstream_round_robin_server_usable(&s[i], now)) {
+            continue;
+        }
+
+        /* Compare active / weight ratios without division. */
+
+        if (best == NULL
+            || (uint64_t) s[i].active * (uint32_t) best->weight
+               < (uint64_t) best->active * (uint32_t) s[i].weight)
+        {
+            best = &s[i];
+        }
+    }
+
+    if (best == NULL) {
+        us->state->error(task, us);
+        return;
+    }
+
+    round_robin->next = (best - s + 1) % n;
+
+    nxt_upstream_round_robin_server_ready(task, us, best);
+}
+
+
+/*
+ * Power of two choices: two random servers are compared by the peak EWMA
+ * latency multiplied by the number of active requests.  If either choice
+ * cannot be used, all servers are scanned for the lowest cost.
+ */
+
+static void
+nxt_upstream_peak_ewma_server_get(nxt_task_t *task, nxt_upstream_server_t *us)
+{
+    double                             cost, best_cost;
+    uint32_t                           i, a, b, n;
+    nxt_msec_t                         now;
+    nxt_nsec_t                         time;
+    nxt_upstream_round_robin_t         *round_robin;
+    nxt_upstream_round_robin_server_t  *s, *best;
+
+    round_robin = us->upstream->type.round_robin;
+
+    s = round_robin->server;
+    n = round_robin->items;
+
+    if (n == 0) {
+        us->state->error(task, us);
+        return;
+    }
+
+    now = task->thread->engine->timers.now;
+    time = nxt_thread_monotonic_time(task->thread);
+
+    a = nxt_random(&task->thread->random) % n;
+    b = a;
+
+    if (n > 1) {
+        b = (a + 1 + nxt_random(&task->thread->random) % (n - 1)) % n;
+    }
+
+    if (nxt_upstream_round_robin_server_usable(&s[a], now)
+        && nxt_upstream_round_robin_server_usable(&s[b], now))
+    {
+        best = (nxt_upstream_peak_ewma_cost(&s[a], time)
+                <= nxt_upstream_peak_ewma_cost(&s[b], time)) ? &s[a] : &s[b];
+
+    } else {
+        best = NULL;
+        best_cost = 0;
+
+        for (i = 0; i < n; i++) {
+
+            if (!nxt_upstream_round_robin_server_usable(&s[i], now)) {
+                continue;
+            }
+
+            cost = nxt_upstream_peak_ewma_cost(&s[i], time);
+
+            if (best == NULL || cost < best_cost) {
+                best = &s[i];
+                best_cost = cost;
+            }
+        }
+
+        if (best == NULL) {
+            us->state->error(task, us);
+            return;
+        }
+    }
+
+    nxt_upstream_round_robin_server_ready(task, us, best);
+}
+
+
+nxt_inline nxt_bool_t
+nxt_upstream_round_robin_server_usable(nxt_upstream_round_robin_server_t *s,
+    nxt_msec_t now)
+{
+    return s->weight != 0 && nxt_upstream_health_available(s->health, now);
+}
+
+
+/*
+ * The latency decays while a server is not chosen, so a server
+ * that was slow once is eventually tried again.
+ */
+
+nxt_inline double
+nxt_upstream_peak_ewma_cost(nxt_upstream_round_robin_server_t *s,
+    nxt_nsec_t now)
+{
+    double  ewma;
+
+    ewma = s->ewma * nxt_upstream_peak_ewma_decay(s, now);
+
+    return (ewma + NXT_UPSTREAM_EWMA_BASE) * (s->active + 1) / s->weight;
+}
+
+
+nxt_inline double
+nxt_upstream_peak_ewma_decay(nxt_upstream_round_robin_server_t *s,
+    nxt_nsec_t now)
+{
+    return exp(-((double) (now - s->ewma_time)) / NXT_UPSTREAM_EWMA_DECAY);
+}
+
+
+static void
+nxt_upstream_round_robin_server_ready(nxt_task_t *task,
+    nxt_upstream_server_t *us, nxt_upstream_round_robin_server_t *s)
+{
+    s->active++;
+
+    us->sockaddr = s->sockaddr;
+    us->protocol = s->protocol;
+    us->server.round_robin = s;
 
     us->state->ready(task, us);
 }
+
+
+static void
+nxt_upstream_round_robin_server_free(nxt_task_t *task,
+    nxt_upstream_server_t *us, nxt_bool_t failed)
+{
+    double                             rtt, w;
+    nxt_nsec_t                         now;
+    nxt_upstream_health_t              *health;
+    nxt_upstream_round_robin_server_t  *s;
+
+    s = us->server.round_robin;
+
+    if (s->active != 0) {
+        s->active--;
+    }
+
+    /*
+     * The peak EWMA takes a higher latency at once and decays
+     * towards lower ones depending on the time since the last sample.
+     */
+
+    if (!failed && us->header_time != 0) {
+        rtt = us->header_time - us->start;
+        now = nxt_thread_monotonic_time(task->thread);
+
+        if (rtt > s->ewma) {
+            s->ewma = rtt;
+
+        } else {
+            w = nxt_upstream_peak_ewma_decay(s, now);
+            s->ewma = s->ewma * w + rtt * (1 - w);
+        }
+
+        s->ewma_time = now;
+    }
+
+    health = s->health;
+
+    if (failed) {
+        nxt_upstream_health_failed(task, health);
+
+    } else {
+        nxt_upstream_health_passed(task, health);
+    }
+}
@@ -74,10 +74,18 @@ nxt_zlib_deflate(nxt_http_comp_compressor_ctx_t *ctx, const uint8_t *in_buf,
 }
 
 
+static void
+nxt_zlib_free(nxt_http_comp_compressor_ctx_t *ctx)
+{
+    deflateEnd(&ctx->zlib_ctx);
+}
+
+
 const nxt_http_comp_operations_t  nxt_http_comp_deflate_ops = {
     .init               = nxt_zlib_deflate_init,
     .bound              = nxt_zlib_bound,
     .deflate            = nxt_zlib_deflate,
+    .free               = nxt_zlib_free,
 };
 
 
@@ -85,4 +93,5 @@ const nxt_http_comp_operations_t  nxt_http_comp_gzip_ops = {
     .init               = nxt_zlib_gzip_init,
     .bound              = nxt_zlib_bound,
     .deflate            = nxt_zlib_deflate,
+    .free               = nxt_zlib_free,
 };
@@ -196,6 +196,18 @@ nxt_py_asgi_http_read_msg(nxt_py_asgi_http_t *http)
 
         read_res = nxt_unit_request_read(req, body_buf, size);
 
+        /* A streamed body may have only a part available. */
+
+        if (read_res > 0 && read_res < size
+            && nxt_slow_path(_PyBytes_Resize(&body, read_res) == -1))
+        {
+            nxt_unit_req_alert(req, "Python failed to resize body");
+            nxt_python_print_exception();
+
+            return PyErr_Format(PyExc_RuntimeError,
+                                "failed to resize Bytes object");
+        }
+
     } else {
         body = NULL;
         read_res = 0;
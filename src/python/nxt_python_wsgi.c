@@ -1223,6 +1223,12 @@ nxt_py_input_read(nxt_python_ctx_t *pctx, PyObject *args)
     buf = PyBytes_AS_STRING(content);
 
     size = nxt_unit_request_read(pctx->req, buf, size);
+    if (nxt_slow_path(size < 0)) {
+        Py_DECREF(content);
+
+        return PyErr_Format(PyExc_RuntimeError,
+                            "failed to read the request body");
+    }
 
     return content;
 }
@@ -0,0 +1,279 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_app_queue.h>
+#include "nxt_tests.h"
+
+
+/*
+ * The benchmark passes messages through an application queue shared
+ * between the router-like producer and a forked application-like
+ * consumer.  The producer writes a byte to a socket whenever it sets
+ * the notification flag, and the consumer sleeps in read() when the
+ * queue is empty, as libunit does with the shared port.  The "single"
+ * mode sends and receives one message per queue operation, the "batch"
+ * mode uses nxt_app_queue_send_batch() and nxt_app_queue_recv_batch();
+ * the latter also claims every message, as libunit does for requests.
+ */
+
+
+#define NXT_APP_QUEUE_TEST_MESSAGES  (1000 * 1000)
+#define NXT_APP_QUEUE_TEST_MSG_SIZE  24
+
+
+typedef struct {
+    nxt_app_queue_t        queue;
+    nxt_atomic_t           wakeups;
+} nxt_app_queue_test_shm_t;
+
+
+static nxt_int_t nxt_app_queue_bench(nxt_thread_t *thr,
+    nxt_app_queue_test_shm_t *shm, nxt_bool_t batch);
+static nxt_uint_t nxt_app_queue_test_send(nxt_app_queue_t *q, int fd,
+    nxt_bool_t batch);
+static void nxt_app_queue_test_recv(nxt_app_queue_test_shm_t *shm, int fd,
+    nxt_bool_t batch);
+static nxt_uint_t nxt_app_queue_test_recv_msgs(nxt_app_queue_t *q,
+    nxt_bool_t batch, uint64_t *sum);
+
+
+nxt_int_t
+nxt_app_queue_test(nxt_thread_t *thr)
+{
+    nxt_int_t                 ret;
+    nxt_app_queue_test_shm_t  *shm;
+
+    nxt_thread_time_update(thr);
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "app queue test started");
+
+    shm = mmap(NULL, sizeof(nxt_app_queue_test_shm_t),
+               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+
+    if (shm == MAP_FAILED) {
+        nxt_log_alert(thr->log, "mmap() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    ret = nxt_app_queue_bench(thr, shm, 0);
+
+    if (ret == NXT_OK) {
+        ret = nxt_app_queue_bench(thr, shm, 1);
+    }
+
+    munmap(shm, sizeof(nxt_app_queue_test_shm_t));
+
+    if (ret == NXT_OK) {
+        nxt_log_error(NXT_LOG_NOTICE, thr->log, "app queue test passed");
+    }
+
+    return ret;
+}
+
+
+static nxt_int_t
+nxt_app_queue_bench(nxt_thread_t *thr, nxt_app_queue_test_shm_t *shm,
+    nxt_bool_t batch)
+{
+    int         fd[2], status;
+    pid_t       pid;
+    nxt_uint_t  notifies;
+    nxt_nsec_t  start, end;
+
+    nxt_app_queue_init(&shm->queue);
+    shm->wakeups = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0) {
+        nxt_log_alert(thr->log, "socketpair() failed %E", nxt_errno);
+        return NXT_ERROR;
+    }
+
+    nxt_thread_time_update(thr);
+    start = nxt_thread_monotonic_time(thr);
+
+    pid = fork();
+
+    if (pid == -1) {
+        nxt_log_alert(thr->log, "fork() failed %E", nxt_errno);
+        close(fd[0]);
+        close(fd[1]);
+        return NXT_ERROR;
+    }
+
+    if (pid == 0) {
+        close(fd[0]);
+        nxt_app_queue_test_recv(shm, fd[1], batch);
+    }
+
+    close(fd[1]);
+
+    notifies = nxt_app_queue_test_send(&shm->queue, fd[0], batch);
+
+    if (waitpid(pid, &status, 0) != pid) {
+        nxt_log_alert(thr->log, "waitpid() failed %E", nxt_errno);
+        close(fd[0]);
+        return NXT_ERROR;
+    }
+
+    nxt_thread_time_update(thr);
+    end = nxt_thread_monotonic_time(thr);
+
+    close(fd[0]);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        nxt_log_alert(thr->log, "app queue %s test failed: "
+                      "consumer exit status %d",
+                      batch ? "batch" : "single", status);
+        return NXT_ERROR;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "app queue %s bench: %0.3fs, %0.1f Mmsg/s, "
+                  "%ui notifies, %uA wakeups",
+                  batch ? "batch" : "single",
+                  (end - start) / 1000000000.0,
+                  (double) NXT_APP_QUEUE_TEST_MESSAGES * 1000 / (end - start),
+                  notifies, shm->wakeups);
+
+    return NXT_OK;
+}
+
+
+static nxt_uint_t
+nxt_app_queue_test_send(nxt_app_queue_t *q, int fd, nxt_bool_t batch)
+{
+    int                  notify;
+    u_char               c;
+    uint32_t             v, cookie;
+    nxt_uint_t           i, k, n, notifies;
+    nxt_app_queue_msg_t  msgs[NXT_APP_QUEUE_BATCH];
+
+    c = 0;
+    notifies = 0;
+
+    for (i = 0; i < NXT_APP_QUEUE_TEST_MESSAGES; i += n) {
+        n = batch ? NXT_APP_QUEUE_BATCH : 1;
+        n = nxt_min(n, NXT_APP_QUEUE_TEST_MESSAGES - i);
+
+        for (k = 0; k < n; k++) {
+            v = i + k;
+
+            msgs[k].size = NXT_APP_QUEUE_TEST_MSG_SIZE;
+            nxt_memzero(msgs[k].data, NXT_APP_QUEUE_TEST_MSG_SIZE);
+            nxt_memcpy(msgs[k].data, &v, sizeof(uint32_t));
+            msgs[k].tracking = v + 1;
+        }
+
+        for ( ;; ) {
+            notify = 0;
+
+            if (batch) {
+                k = nxt_app_queue_send_batch(q, msgs, n, &notify);
+
+            } else {
+                k = (nxt_app_queue_send(q, msgs[0].data, msgs[0].size,
+                                        msgs[0].tracking, &notify, &cookie)
+                     == NXT_OK);
+            }
+
+            if (k != 0 && notify) {
+                notifies++;
+                (void) write(fd, &c, 1);
+            }
+
+            if (k == n) {
+                break;
+            }
+
+            nxt_memmove(msgs, &msgs[k],
+                        (n - k) * sizeof(nxt_app_queue_msg_t));
+            n -= k;
+            i += k;
+
+            nxt_thread_yield();
+        }
+    }
+
+    return notifies;
+}
+
+
+static void
+nxt_app_queue_test_recv(nxt_app_queue_test_shm_t *shm, int fd,
+    nxt_bool_t batch)
+{
+    u_char      buf[64];
+    uint64_t    sum, expected;
+    nxt_uint_t  n, received;
+
+    sum = 0;
+    received = 0;
+
+    while (received < NXT_APP_QUEUE_TEST_MESSAGES) {
+        n = nxt_app_queue_test_recv_msgs(&shm->queue, batch, &sum);
+
+        if (n != 0) {
+            received += n;
+            continue;
+        }
+
+        nxt_app_queue_notification_received(&shm->queue);
+
+        n = nxt_app_queue_test_recv_msgs(&shm->queue, batch, &sum);
+
+        if (n != 0) {
+            received += n;
+            continue;
+        }
+
+        if (read(fd, buf, sizeof(buf)) <= 0) {
+            _exit(1);
+        }
+
+        shm->wakeups++;
+    }
+
+    expected = (uint64_t) NXT_APP_QUEUE_TEST_MESSAGES
+               * (NXT_APP_QUEUE_TEST_MESSAGES - 1) / 2;
+
+    _exit(sum == expected ? 0 : 1);
+}
+
+
+static nxt_uint_t
+nxt_app_queue_test_recv_msgs(nxt_app_queue_t *q, nxt_bool_t batch,
+    uint64_t *sum)
+{
+    ssize_t              size;
+    uint32_t             v;
+    nxt_uint_t           i, n;
+    nxt_app_queue_msg_t  msgs[NXT_APP_QUEUE_BATCH];
+
+    if (batch) {
+        n = nxt_app_queue_recv_batch(q, msgs, NXT_APP_QUEUE_BATCH);
+
+    } else {
+        size = nxt_app_queue_recv(q, msgs[0].data, &msgs[0].cookie);
+        if (size == -1) {
+            return 0;
+        }
+
+        msgs[0].size = size;
+        n = 1;
+    }
+
+    for (i = 0; i < n; i++) {
+        nxt_memcpy(&v, msgs[i].data, sizeof(uint32_t));
+
+        if (msgs[i].size != NXT_APP_QUEUE_TEST_MSG_SIZE) {
+            _exit(1);
+        }
+
+        *sum += v;
+    }
+
+    return n;
+}
@@ -0,0 +1,313 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_hpack.h>
+#include "nxt_tests.h"
+
+
+typedef struct {
+    nxt_str_t   block;
+    nxt_str_t   fields;
+    size_t      table_size;
+} nxt_hpack_test_case_t;
+
+
+static nxt_int_t nxt_hpack_test_sequence(nxt_thread_t *thr, nxt_mp_t *mp,
+    const char *name, size_t limit, nxt_hpack_test_case_t *cases,
+    nxt_uint_t n);
+static nxt_int_t nxt_hpack_test_encode(nxt_thread_t *thr, nxt_mp_t *mp);
+static nxt_int_t nxt_hpack_test_invalid(nxt_thread_t *thr, nxt_mp_t *mp);
+
+
+/* RFC 7541, C.4: requests with Huffman coding. */
+
+static nxt_hpack_test_case_t  nxt_hpack_requests[] = {
+    {
+        nxt_string("\x82\x86\x84\x41\x8c\xf1\xe3\xc2\xe5\xf2\x3a\x6b\xa0\xab"
+                   "\x90\xf4\xff"),
+        nxt_string(":method: GET\n"
+                   ":scheme: http\n"
+                   ":path: /\n"
+                   ":authority: www.example.com\n"),
+        57
+    },
+    {
+        nxt_string("\x82\x86\x84\xbe\x58\x86\xa8\xeb\x10\x64\x9c\xbf"),
+        nxt_string(":method: GET\n"
+                   ":scheme: http\n"
+                   ":path: /\n"
+                   ":authority: www.example.com\n"
+                   "cache-control: no-cache\n"),
+        110
+    },
+    {
+        nxt_string("\x82\x87\x85\xbf\x40\x88\x25\xa8\x49\xe9\x5b\xa9\x7d\x7f"
+                   "\x89\x25\xa8\x49\xe9\x5b\xb8\xe8\xb4\xbf"),
+        nxt_string(":method: GET\n"
+                   ":scheme: https\n"
+                   ":path: /index.html\n"
+                   ":authority: www.example.com\n"
+                   "custom-key: custom-value\n"),
+        164
+    },
+};
+
+
+/* RFC 7541, C.6: responses with Huffman coding and eviction. */
+
+static nxt_hpack_test_case_t  nxt_hpack_responses[] = {
+    {
+        nxt_string("\x48\x82\x64\x02\x58\x85\xae\xc3\x77\x1a\x4b\x61\x96\xd0"
+                   "\x7a\xbe\x94\x10\x54\xd4\x44\xa8\x20\x05\x95\x04\x0b\x81"
+                   "\x66\xe0\x82\xa6\x2d\x1b\xff\x6e\x91\x9d\x29\xad\x17\x18"
+                   "\x63\xc7\x8f\x0b\x97\xc8\xe9\xae\x82\xae\x43\xd3"),
+        nxt_string(":status: 302\n"
+                   "cache-control: private\n"
+                   "date: Mon, 21 Oct 2013 20:13:21 GMT\n"
+                   "location: https://www.example.com\n"),
+        222
+    },
+    {
+        nxt_string("\x48\x83\x64\x0e\xff\xc1\xc0\xbf"),
+        nxt_string(":status: 307\n"
+                   "cache-control: private\n"
+                   "date: Mon, 21 Oct 2013 20:13:21 GMT\n"
+                   "location: https://www.example.com\n"),
+        222
+    },
+    {
+        nxt_string("\x88\xc1\x61\x96\xd0\x7a\xbe\x94\x10\x54\xd4\x44\xa8\x20"
+                   "\x05\x95\x04\x0b\x81\x66\xe0\x84\xa6\x2d\x1b\xff\xc0\x5a"
+                   "\x83\x9b\xd9\xab\x77\xad\x94\xe7\x82\x1d\xd7\xf2\xe6\xc7"
+                   "\xb3\x35\xdf\xdf\xcd\x5b\x39\x60\xd5\xaf\x27\x08\x7f\x36"
+                   "\x72\xc1\xab\x27\x0f\xb5\x29\x1f\x95\x87\x31\x60\x65\xc0"
+                   "\x03\xed\x4e\xe5\xb1\x06\x3d\x50\x07"),
+        nxt_string(":status: 200\n"
+                   "cache-control: private\n"
+                   "date: Mon, 21 Oct 2013 20:13:22 GMT\n"
+                   "location: https://www.example.com\n"
+                   "content-encoding: gzip\n"
+                   "set-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600;"
+                   " version=1\n"),
+        215
+    },
+};
+
+
+nxt_int_t
+nxt_hpack_test(nxt_thread_t *thr)
+{
+    nxt_mp_t   *mp;
+    nxt_int_t  ret;
+
+    nxt_thread_time_update(thr);
+
+    if (nxt_hpack_init() != NXT_OK) {
+        nxt_log_alert(thr->log, "nxt_hpack_init() failed");
+        return NXT_ERROR;
+    }
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (mp == NULL) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_hpack_test_sequence(thr, mp, "requests", 4096,
+                                  nxt_hpack_requests,
+                                  nxt_nitems(nxt_hpack_requests));
+    if (ret != NXT_OK) {
+        goto done;
+    }
+
+    ret = nxt_hpack_test_sequence(thr, mp, "responses", 256,
+                                  nxt_hpack_responses,
+                                  nxt_nitems(nxt_hpack_responses));
+    if (ret != NXT_OK) {
+        goto done;
+    }
+
+    ret = nxt_hpack_test_encode(thr, mp);
+    if (ret != NXT_OK) {
+        goto done;
+    }
+
+    ret = nxt_hpack_test_invalid(thr, mp);
+    if (ret != NXT_OK) {
+        goto done;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "hpack test passed");
+
+done:
+
+    nxt_mp_destroy(mp);
+
+    return ret;
+}
+
+
+static nxt_int_t
+nxt_hpack_test_sequence(nxt_thread_t *thr, nxt_mp_t *mp, const char *name,
+    size_t limit, nxt_hpack_test_case_t *cases, nxt_uint_t n)
+{
+    u_char       *pos, *end, *p;
+    nxt_int_t    ret;
+    nxt_str_t    fname, fvalue;
+    nxt_uint_t   i;
+    nxt_hpack_t  hp;
+    u_char       buf[512];
+
+    nxt_hpack_table_init(&hp, mp, limit);
+
+    for (i = 0; i < n; i++) {
+        pos = cases[i].block.start;
+        end = pos + cases[i].block.length;
+        p = buf;
+
+        for ( ;; ) {
+            ret = nxt_hpack_decode(&hp, &pos, end, mp, &fname, &fvalue);
+
+            if (ret != NXT_OK) {
+                break;
+            }
+
+            p = nxt_sprintf(p, buf + sizeof(buf), "%V: %V\n", &fname, &fvalue);
+        }
+
+        if (ret != NXT_DONE) {
+            nxt_log_alert(thr->log, "hpack %s test #%ui failed: decode error",
+                          name, i + 1);
+            return NXT_ERROR;
+        }
+
+        if (!nxt_str_eq(&cases[i].fields, buf, (size_t) (p - buf))) {
+            nxt_log_alert(thr->log, "hpack %s test #%ui failed: "
+                          "fields \"%*s\"", name, i + 1, p - buf, buf);
+            return NXT_ERROR;
+        }
+
+        if (hp.size != cases[i].table_size) {
+            nxt_log_alert(thr->log, "hpack %s test #%ui failed: "
+                          "table size %uz, expected %uz",
+                          name, i + 1, hp.size, cases[i].table_size);
+            return NXT_ERROR;
+        }
+    }
+
+    nxt_hpack_table_free(&hp);
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_test_encode(nxt_thread_t *thr, nxt_mp_t *mp)
+{
+    u_char       *pos, *end, *p;
+    nxt_int_t    ret;
+    nxt_str_t    name, value;
+    nxt_hpack_t  hp;
+    u_char       buf[512];
+
+    static const nxt_str_t  expected = nxt_string(
+        ":status: 200\n"
+        ":status: 418\n"
+        "content-type: text/plain\n"
+        "x-unit-test: abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz\n"
+    );
+
+    static const char  long_value[] =
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+
+    p = nxt_hpack_encode_status(buf, 200);
+    p = nxt_hpack_encode_status(p, 418);
+    p = nxt_hpack_encode_field(p, (u_char *) "Content-Type", 12,
+                               (u_char *) "text/plain", 10);
+    p = nxt_hpack_encode_field(p, (u_char *) "X-Unit-Test", 11,
+                               (u_char *) long_value, nxt_length(long_value));
+
+    nxt_hpack_table_init(&hp, mp, 4096);
+
+    pos = buf;
+    end = p;
+    p = buf + 256;
+
+    for ( ;; ) {
+        ret = nxt_hpack_decode(&hp, &pos, end, mp, &name, &value);
+
+        if (ret != NXT_OK) {
+            break;
+        }
+
+        p = nxt_sprintf(p, buf + sizeof(buf), "%V: %V\n", &name, &value);
+    }
+
+    if (ret != NXT_DONE
+        || !nxt_str_eq(&expected, buf + 256, (size_t) (p - (buf + 256))))
+    {
+        nxt_log_alert(thr->log, "hpack encode test failed");
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_hpack_test_invalid(nxt_thread_t *thr, nxt_mp_t *mp)
+{
+    u_char       *pos, *end;
+    nxt_int_t    ret;
+    nxt_str_t    name, value;
+    nxt_uint_t   i;
+    nxt_hpack_t  hp;
+
+    static const nxt_str_t  blocks[] = {
+        /* Zero index. */
+        nxt_string("\x80"),
+        /* Empty dynamic table. */
+        nxt_string("\xbe"),
+        /* Truncated integer. */
+        nxt_string("\xff\x80"),
+        /* Integer overflow. */
+        nxt_string("\xff\xff\xff\xff\xff\x7f"),
+        /* Integer wrapping around 32 bits to a valid table size. */
+        nxt_string("\x3f\x80\x80\x80\x80\x10"),
+        /* Truncated string. */
+        nxt_string("\x40\x05\x61\x62"),
+        /* Huffman padding longer than 7 bits. */
+        nxt_string("\x00\x82\x1f\xff\x01\x61"),
+        /* Huffman padding not corresponding to EOS. */
+        nxt_string("\x00\x81\x18\x01\x61"),
+        /* Table size update above the limit. */
+        nxt_string("\x3f\xe2\x1f"),
+    };
+
+    for (i = 0; i < nxt_nitems(blocks); i++) {
+        nxt_hpack_table_init(&hp, mp, 4096);
+
+        pos = blocks[i].start;
+        end = pos + blocks[i].length;
+
+        do {
+            ret = nxt_hpack_decode(&hp, &pos, end, mp, &name, &value);
+        } while (ret == NXT_OK);
+
+        nxt_hpack_table_free(&hp);
+
+        if (ret != NXT_ERROR) {
+            nxt_log_alert(thr->log, "hpack invalid block test #%ui failed",
+                          i + 1);
+            return NXT_ERROR;
+        }
+    }
+
+    return NXT_OK;
+}
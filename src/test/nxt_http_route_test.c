@@ -0,0 +1,353 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include "nxt_tests.h"
+
+
+#define NXT_HTTP_ROUTE_TEST_STEPS     3000
+#define NXT_HTTP_ROUTE_TEST_RUNS      20
+
+
+typedef struct {
+    nxt_str_t  host;
+    nxt_str_t  path;
+    nxt_str_t  method;
+} nxt_http_route_test_request_t;
+
+
+static nxt_conf_value_t *nxt_http_route_test_conf(nxt_mp_t *mp, nxt_uint_t n);
+static nxt_http_route_test_request_t *nxt_http_route_test_requests(
+    nxt_mp_t *mp, nxt_uint_t n);
+static nxt_int_t nxt_http_route_test_bench(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_routes_t *routes,
+    nxt_http_route_test_request_t *requests, nxt_uint_t n, nxt_bool_t linear);
+
+
+static const nxt_str_t  nxt_http_route_test_methods[] = {
+    nxt_string("GET"),
+    nxt_string("HEAD"),
+    nxt_string("POST"),
+};
+
+
+nxt_int_t
+nxt_http_route_test(nxt_thread_t *thr)
+{
+    nxt_mp_t                       *mp;
+    uint32_t                       step, linear_step;
+    nxt_int_t                      ret;
+    nxt_log_t                      log;
+    nxt_uint_t                     i, n;
+    nxt_task_t                     task;
+    nxt_conf_value_t               *conf;
+    nxt_http_request_t             r;
+    nxt_http_routes_t              *routes;
+    nxt_http_action_t              *action, *linear;
+    nxt_socket_conf_t              skcf;
+    nxt_router_conf_t              rtcf;
+    nxt_router_temp_conf_t         tmcf;
+    nxt_socket_conf_joint_t        joint;
+    nxt_http_route_test_request_t  *requests, *req;
+
+    ret = NXT_ERROR;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (nxt_slow_path(mp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    /* The linear search logs every step at the info level. */
+
+    log = *thr->log;
+    log.level = NXT_LOG_WARN;
+
+    task = *thr->task;
+    task.thread = thr;
+    task.log = &log;
+
+    nxt_memzero(&rtcf, sizeof(nxt_router_conf_t));
+    nxt_memzero(&tmcf, sizeof(nxt_router_temp_conf_t));
+    nxt_memzero(&skcf, sizeof(nxt_socket_conf_t));
+    nxt_memzero(&joint, sizeof(nxt_socket_conf_joint_t));
+
+    rtcf.mem_pool = mp;
+    rtcf.tstr_state = nxt_tstr_state_new(mp, 0);
+    if (nxt_slow_path(rtcf.tstr_state == NULL)) {
+        goto fail;
+    }
+
+    tmcf.mem_pool = mp;
+    tmcf.router_conf = &rtcf;
+
+    skcf.router_conf = &rtcf;
+    joint.socket_conf = &skcf;
+
+    n = NXT_HTTP_ROUTE_TEST_STEPS;
+
+    conf = nxt_http_route_test_conf(mp, n);
+    if (nxt_slow_path(conf == NULL)) {
+        nxt_log_alert(thr->log, "http route test failed: invalid JSON");
+        goto fail;
+    }
+
+    routes = nxt_http_routes_create(&task, &tmcf, conf);
+    if (nxt_slow_path(routes == NULL)) {
+        nxt_log_alert(thr->log, "http route test failed: no routes");
+        goto fail;
+    }
+
+    requests = nxt_http_route_test_requests(mp, n);
+    if (nxt_slow_path(requests == NULL)) {
+        goto fail;
+    }
+
+    nxt_memzero(&r, sizeof(nxt_http_request_t));
+
+    r.mem_pool = mp;
+    r.conf = &joint;
+
+    for (i = 0; i < n; i++) {
+        req = &requests[i];
+
+        r.host = req->host;
+        r.path = &req->path;
+        r.method = &req->method;
+
+        r.log_route = 0;
+        action = nxt_http_routes_match(&task, &r, routes, 0, &step);
+
+        r.log_route = 1;
+        linear = nxt_http_routes_match(&task, &r, routes, 0, &linear_step);
+
+        if (action != linear || (action != NULL && step != linear_step)) {
+            nxt_log_alert(thr->log, "http route test failed: "
+                          "\"%V\" \"%V\" \"%V\" matched step %uD "
+                          "instead of %uD", &req->method, &req->host,
+                          &req->path, step, linear_step);
+            goto fail;
+        }
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "http route test passed");
+
+    if (nxt_http_route_test_bench(&task, &r, routes, requests, n, 0)
+        != NXT_OK)
+    {
+        goto fail;
+    }
+
+    if (nxt_http_route_test_bench(&task, &r, routes, requests, n, 1)
+        != NXT_OK)
+    {
+        goto fail;
+    }
+
+    ret = NXT_OK;
+
+fail:
+
+    nxt_mp_destroy(mp);
+
+    return ret;
+}
+
+
+/*
+ * The steps cycle through exact hosts, URI prefixes, hosts with URI
+ * prefixes and methods, and URI prefixes with suffixes and methods.
+ * Some steps use wildcard hosts or negative URIs, and the last step
+ * matches any request.
+ */
+
+static nxt_conf_value_t *
+nxt_http_route_test_conf(nxt_mp_t *mp, nxt_uint_t n)
+{
+    u_char      *p, *end, *start;
+    nxt_uint_t  i;
+
+    start = nxt_mp_alloc(mp, n * 160 + 64);
+    if (nxt_slow_path(start == NULL)) {
+        return NULL;
+    }
+
+    p = start;
+    end = start + n * 160 + 64;
+
+    *p++ = '[';
+
+    for (i = 0; i < n; i++) {
+
+        if (i % 100 == 99) {
+            p = nxt_sprintf(p, end, "{\"match\":{\"host\":\"*.w%ui.com\"},",
+                            i);
+
+        } else if (i % 100 == 49) {
+            p = nxt_sprintf(p, end, "{\"match\":{\"host\":\"n%ui.com\","
+                            "\"uri\":\"!/api/*\"},", i);
+
+        } else {
+            switch (i % 4) {
+            case 0:
+                p = nxt_sprintf(p, end, "{\"match\":{\"host\":"
+                                "[\"h%ui.com\",\"www.h%ui.com\"]},", i, i);
+                break;
+
+            case 1:
+                p = nxt_sprintf(p, end, "{\"match\":{\"uri\":"
+                                "\"/api/v%ui/*\"},", i);
+                break;
+
+            case 2:
+                p = nxt_sprintf(p, end, "{\"match\":{\"host\":\"h%ui.com\","
+                                "\"uri\":\"/static/*\","
+                                "\"method\":[\"GET\",\"HEAD\"]},", i);
+                break;
+
+            default:
+                p = nxt_sprintf(p, end, "{\"match\":{\"uri\":"
+                                "\"/files/%ui/*.txt\",\"method\":\"POST\"},",
+                                i);
+                break;
+            }
+        }
+
+        p = nxt_sprintf(p, end, "\"action\":{\"return\":%ui}},",
+                        200 + i % 300);
+    }
+
+    p = nxt_cpymem(p, "{\"action\":{\"return\":404}}]", 26);
+
+    return nxt_conf_json_parse(mp, start, p, NULL);
+}
+
+
+static nxt_http_route_test_request_t *
+nxt_http_route_test_requests(nxt_mp_t *mp, nxt_uint_t n)
+{
+    u_char                         *p, *end;
+    nxt_uint_t                     i, j;
+    nxt_http_route_test_request_t  *requests, *req;
+
+    requests = nxt_mp_alloc(mp, n * sizeof(nxt_http_route_test_request_t));
+    if (nxt_slow_path(requests == NULL)) {
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        req = &requests[i];
+
+        p = nxt_mp_alloc(mp, 128);
+        if (nxt_slow_path(p == NULL)) {
+            return NULL;
+        }
+
+        end = p + 128;
+
+        j = (i * 7) % n;
+
+        req->host.start = p;
+
+        switch (i % 5) {
+        case 0:
+            p = nxt_sprintf(p, end, "www.h%ui.com", j & ~3);
+            break;
+
+        case 1:
+        case 2:
+            p = nxt_sprintf(p, end, "h%ui.com", j);
+            break;
+
+        case 3:
+            p = nxt_sprintf(p, end, "x.w%ui.com", j);
+            break;
+
+        default:
+            p = nxt_sprintf(p, end, "n%ui.com", j);
+            break;
+        }
+
+        req->host.length = p - req->host.start;
+
+        req->path.start = p;
+
+        switch (i % 3) {
+        case 0:
+            p = nxt_sprintf(p, end, "/api/v%ui/users", j);
+            break;
+
+        case 1:
+            p = nxt_sprintf(p, end, "/static/app.js");
+            break;
+
+        default:
+            p = nxt_sprintf(p, end, "/files/%ui/a.txt", j);
+            break;
+        }
+
+        req->path.length = p - req->path.start;
+
+        req->method = nxt_http_route_test_methods[i % 3];
+    }
+
+    return requests;
+}
+
+
+static nxt_int_t
+nxt_http_route_test_bench(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_routes_t *routes, nxt_http_route_test_request_t *requests,
+    nxt_uint_t n, nxt_bool_t linear)
+{
+    uint32_t                       step;
+    nxt_uint_t                     i, run, found;
+    nxt_nsec_t                     start, end;
+    nxt_thread_t                   *thr;
+    const char                     *name;
+    nxt_http_route_test_request_t  *req;
+
+    thr = task->thread;
+    name = linear ? "linear" : "indexed";
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "http route %s bench started: %ui steps, %ui requests, "
+                  "%ui runs", name, n + 1, n, NXT_HTTP_ROUTE_TEST_RUNS);
+
+    r->log_route = linear;
+    found = 0;
+
+    nxt_thread_time_update(thr);
+    start = nxt_thread_monotonic_time(thr);
+
+    for (run = 0; nxt_fast_path(run < NXT_HTTP_ROUTE_TEST_RUNS); run++) {
+
+        for (i = 0; nxt_fast_path(i < n); i++) {
+            req = &requests[i];
+
+            r->host = req->host;
+            r->path = &req->path;
+            r->method = &req->method;
+
+            if (nxt_http_routes_match(task, r, routes, 0, &step) != NULL) {
+                found++;
+            }
+        }
+    }
+
+    nxt_thread_time_update(thr);
+    end = nxt_thread_monotonic_time(thr);
+
+    if (nxt_slow_path(found != n * NXT_HTTP_ROUTE_TEST_RUNS)) {
+        nxt_log_alert(thr->log, "http route %s bench failed", name);
+        return NXT_ERROR;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "http route %s bench: %0.3fs",
+                  name, (end - start) / 1000000000.0);
+
+    return NXT_OK;
+}
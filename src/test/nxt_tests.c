@@ -158,6 +158,14 @@ main(int argc, char **argv)
         return 1;
     }
 
+    if (nxt_http_route_test(thr) != NXT_OK) {
+        return 1;
+    }
+
+    if (nxt_hpack_test(thr) != NXT_OK) {
+        return 1;
+    }
+
     if (nxt_strverscmp_test(thr) != NXT_OK) {
         return 1;
     }
@@ -166,6 +174,10 @@ main(int argc, char **argv)
         return 1;
     }
 
+    if (nxt_app_queue_test(thr) != NXT_OK) {
+        return 1;
+    }
+
 #if (NXT_HAVE_CLONE_NEWUSER)
     if (nxt_clone_creds_test(thr) != NXT_OK) {
         return 1;
@@ -0,0 +1,776 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+/*
+ * The client side of the round-trip benchmark.  Each thread sends
+ * requests over its own keep-alive connection and waits for every
+ * response before the next request, so the results reflect latency of
+ * the router to application path rather than of the network stack.
+ * The application is expected to be unit_bench_app running in a single
+ * process: its "/stats" response is used to count allocations of the
+ * application, and read and write system calls are taken from
+ * /proc/<pid>/io of the application and, if given with "-p", of the
+ * router.  /proc/<pid>/io counts only reads and writes, so with "-t"
+ * all threads of the router are also traced with ptrace() during the
+ * measurement to count every system call, including epoll_wait() and
+ * io_uring_enter(); the time and latency results are then affected.
+ */
+
+#include <nxt_clang.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+#define BENCH_BUF_SIZE    (64 * 1024)
+#define BENCH_TRACE_MAX   256
+
+
+typedef struct {
+    pthread_t           thread;
+    int                 fd;
+    unsigned            requests;
+    unsigned            warmup;
+    unsigned            errors;
+    uint64_t            *latency;
+    char                *buf;
+} bench_conn_t;
+
+
+typedef struct {
+    uint64_t            syscr;
+    uint64_t            syscw;
+} bench_io_t;
+
+
+typedef struct {
+    pid_t               tid;
+    int                 signo;
+    uint8_t             stopped;
+    uint8_t             exited;
+} bench_tracee_t;
+
+
+static int bench_connect(void);
+static void *bench_worker(void *data);
+static int bench_request(bench_conn_t *c);
+static int bench_stats(long *pid, uint64_t *allocations);
+static int bench_io(long pid, bench_io_t *io);
+static int bench_trace_attach(long pid);
+static int bench_trace(unsigned conns, uint64_t *syscalls);
+static int bench_trace_detach(void);
+static bench_tracee_t *bench_trace_wait(int resume, uint64_t *syscalls);
+static uint64_t bench_time(void);
+static int bench_cmp(const void *a, const void *b);
+static void bench_usage(const char *name);
+
+
+static struct sockaddr_storage  addr;
+static socklen_t                addr_len;
+static char                     *request;
+static size_t                   request_len;
+static size_t                   response_size;
+static pthread_barrier_t        barrier;
+static unsigned                 finished;
+static bench_tracee_t           tracees[BENCH_TRACE_MAX];
+static unsigned                 ntracees;
+
+
+int
+main(int argc, char **argv)
+{
+    int                 opt, trace;
+    char                *p, *port;
+    long                router_pid, app_pid;
+    size_t              body_size;
+    uint64_t            start, end, allocs[2], *latency, syscalls;
+    unsigned            i, k, n, requests, warmup, conns, errors;
+    bench_io_t          app_io[2], router_io[2];
+    bench_conn_t        *c;
+    struct sockaddr_in  *sin;
+    struct sockaddr_un  *sun;
+
+    conns = 1;
+    requests = 10000;
+    warmup = 1000;
+    body_size = 0;
+    router_pid = 0;
+    trace = 0;
+    syscalls = 0;
+
+    while ((opt = getopt(argc, argv, "c:n:w:s:r:p:t")) != -1) {
+        switch (opt) {
+        case 'c':
+            conns = atoi(optarg);
+            break;
+        case 'n':
+            requests = atoi(optarg);
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 's':
+            body_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            response_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            router_pid = atol(optarg);
+            break;
+        case 't':
+            trace = 1;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1
+        || conns == 0
+        || requests < conns
+        || (trace && router_pid == 0))
+    {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    p = argv[optind];
+
+    memset(&addr, 0, sizeof(addr));
+
+    if (strncmp(p, "unix:", 5) == 0) {
+        sun = (struct sockaddr_un *) &addr;
+
+        sun->sun_family = AF_UNIX;
+        snprintf(sun->sun_path, sizeof(sun->sun_path), "%s", p + 5);
+        addr_len = sizeof(struct sockaddr_un);
+
+    } else {
+        sin = (struct sockaddr_in *) &addr;
+
+        port = strrchr(p, ':');
+        if (port == NULL) {
+            bench_usage(argv[0]);
+            return 1;
+        }
+
+        *port = '\0';
+
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(atoi(port + 1));
+
+        if (inet_pton(AF_INET, p, &sin->sin_addr) != 1) {
+            fprintf(stderr, "invalid address \"%s\"\n", p);
+            return 1;
+        }
+
+        addr_len = sizeof(struct sockaddr_in);
+    }
+
+    if (response_size != 0) {
+        request = malloc(128);
+        if (request == NULL) {
+            return 1;
+        }
+
+        request_len = snprintf(request, 128,
+                               "GET /?size=%zu HTTP/1.1\r\n"
+                               "Host: localhost\r\n\r\n", response_size);
+
+    } else {
+        request = malloc(128 + body_size);
+        if (request == NULL) {
+            return 1;
+        }
+
+        request_len = snprintf(request, 128,
+                               "POST / HTTP/1.1\r\n"
+                               "Host: localhost\r\n"
+                               "Content-Length: %zu\r\n\r\n", body_size);
+
+        memset(request + request_len, 'b', body_size);
+        request_len += body_size;
+        response_size = body_size;
+    }
+
+    c = calloc(conns, sizeof(bench_conn_t));
+    latency = malloc(requests * sizeof(uint64_t));
+
+    if (c == NULL || latency == NULL) {
+        return 1;
+    }
+
+    pthread_barrier_init(&barrier, NULL, conns + 1);
+
+    for (i = 0, k = 0; i < conns; i++) {
+        n = requests / conns + (i < requests % conns);
+
+        c[i].requests = n;
+        c[i].warmup = warmup / conns;
+        c[i].latency = latency + k;
+        k += n;
+
+        c[i].fd = bench_connect();
+        c[i].buf = malloc(BENCH_BUF_SIZE);
+
+        if (c[i].fd == -1 || c[i].buf == NULL) {
+            return 1;
+        }
+
+        if (pthread_create(&c[i].thread, NULL, bench_worker, &c[i]) != 0) {
+            fprintf(stderr, "pthread_create() failed\n");
+            return 1;
+        }
+    }
+
+    /* Warmup. */
+    pthread_barrier_wait(&barrier);
+
+    if (bench_stats(&app_pid, &allocs[0]) != 0
+        || bench_io(app_pid, &app_io[0]) != 0
+        || (router_pid != 0 && bench_io(router_pid, &router_io[0]) != 0))
+    {
+        return 1;
+    }
+
+    if (trace && bench_trace_attach(router_pid) != 0) {
+        return 1;
+    }
+
+    start = bench_time();
+
+    pthread_barrier_wait(&barrier);
+
+    if (trace
+        && (bench_trace(conns, &syscalls) != 0 || bench_trace_detach() != 0))
+    {
+        return 1;
+    }
+
+    errors = 0;
+
+    for (i = 0; i < conns; i++) {
+        pthread_join(c[i].thread, NULL);
+        errors += c[i].errors;
+    }
+
+    end = bench_time();
+
+    /* The I/O of the second "/stats" request is not counted. */
+
+    if (bench_io(app_pid, &app_io[1]) != 0
+        || (router_pid != 0 && bench_io(router_pid, &router_io[1]) != 0)
+        || bench_stats(&app_pid, &allocs[1]) != 0)
+    {
+        return 1;
+    }
+
+    if (errors != 0) {
+        fprintf(stderr, "%u requests failed\n", errors);
+        return 1;
+    }
+
+    qsort(latency, requests, sizeof(uint64_t), bench_cmp);
+
+    printf("requests: %u\n", requests);
+    printf("connections: %u\n", conns);
+    printf("request body: %zu\n", body_size);
+    printf("response body: %zu\n", response_size);
+    printf("time: %.3f s\n", (end - start) / 1e9);
+    printf("rps: %.0f\n", requests * 1e9 / (end - start));
+    printf("latency p50: %.1f us\n", latency[requests / 2] / 1e3);
+    printf("latency p99: %.1f us\n",
+           latency[(uint64_t) requests * 99 / 100] / 1e3);
+    printf("app allocations/req: %.2f\n",
+           (double) (allocs[1] - allocs[0]) / requests);
+    printf("app syscalls/req: %.2f\n",
+           (double) (app_io[1].syscr + app_io[1].syscw
+                     - app_io[0].syscr - app_io[0].syscw) / requests);
+
+    if (router_pid != 0) {
+        printf("router syscalls/req: %.2f\n",
+               (double) (router_io[1].syscr + router_io[1].syscw
+                         - router_io[0].syscr - router_io[0].syscw)
+               / requests);
+    }
+
+    if (trace) {
+        printf("router traced syscalls/req: %.2f\n",
+               (double) syscalls / requests);
+    }
+
+    return 0;
+}
+
+
+static int
+bench_connect(void)
+{
+    int  fd, on;
+
+    fd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (fd == -1) {
+        fprintf(stderr, "socket() failed %d\n", errno);
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr *) &addr, addr_len) != 0) {
+        fprintf(stderr, "connect() failed %d\n", errno);
+        close(fd);
+        return -1;
+    }
+
+    if (addr.ss_family == AF_INET) {
+        on = 1;
+        (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    return fd;
+}
+
+
+static void *
+bench_worker(void *data)
+{
+    unsigned      i;
+    uint64_t      start;
+    bench_conn_t  *c;
+
+    c = data;
+
+    for (i = 0; i < c->warmup; i++) {
+        c->errors += bench_request(c);
+    }
+
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+
+    for (i = 0; i < c->requests; i++) {
+        start = bench_time();
+
+        c->errors += bench_request(c);
+
+        c->latency[i] = bench_time() - start;
+    }
+
+    /* The router is stopped on a system call caused by the close. */
+
+    __atomic_add_fetch(&finished, 1, __ATOMIC_RELEASE);
+
+    close(c->fd);
+
+    return NULL;
+}
+
+
+/*
+ * Sends the request and reads the response, expecting status 200 and
+ * "Content-Length" matching the size the application was asked for.
+ */
+
+static int
+bench_request(bench_conn_t *c)
+{
+    char     *p, *end, *hdr;
+    size_t   sent, len, length;
+    ssize_t  n;
+
+    for (sent = 0; sent < request_len; sent += n) {
+        n = write(c->fd, request + sent, request_len - sent);
+        if (n <= 0) {
+            return 1;
+        }
+    }
+
+    len = 0;
+
+    for ( ;; ) {
+        n = read(c->fd, c->buf + len, BENCH_BUF_SIZE - 1 - len);
+        if (n <= 0) {
+            return 1;
+        }
+
+        len += n;
+        c->buf[len] = '\0';
+
+        end = strstr(c->buf, "\r\n\r\n");
+        if (end != NULL) {
+            break;
+        }
+
+        if (len == BENCH_BUF_SIZE - 1) {
+            return 1;
+        }
+    }
+
+    end += 4;
+
+    if (strncmp(c->buf, "HTTP/1.1 200 ", 13) != 0) {
+        return 1;
+    }
+
+    length = (size_t) -1;
+
+    for (p = c->buf; p < end; p = hdr + 2) {
+        hdr = strstr(p, "\r\n");
+
+        if (strncasecmp(p, "Content-Length:", 15) == 0) {
+            length = strtoul(p + 15, NULL, 10);
+        }
+    }
+
+    if (length != response_size) {
+        return 1;
+    }
+
+    len -= end - c->buf;
+
+    while (len < length) {
+        n = read(c->fd, c->buf, nxt_min(BENCH_BUF_SIZE, length - len));
+        if (n <= 0) {
+            return 1;
+        }
+
+        len += n;
+    }
+
+    return len != length;
+}
+
+
+static int
+bench_stats(long *pid, uint64_t *allocations)
+{
+    int      fd;
+    char     *p, buf[1024];
+    ssize_t  n;
+    size_t   len;
+
+    static const char  req[] = "GET /stats HTTP/1.1\r\n"
+                               "Host: localhost\r\n"
+                               "Connection: close\r\n\r\n";
+
+    fd = bench_connect();
+    if (fd == -1) {
+        return 1;
+    }
+
+    if (write(fd, req, sizeof(req) - 1) != sizeof(req) - 1) {
+        close(fd);
+        return 1;
+    }
+
+    len = 0;
+
+    while (len < sizeof(buf) - 1) {
+        n = read(fd, buf + len, sizeof(buf) - 1 - len);
+        if (n <= 0) {
+            break;
+        }
+
+        len += n;
+    }
+
+    close(fd);
+
+    buf[len] = '\0';
+
+    p = strstr(buf, "\r\n\r\n");
+
+    if (p == NULL
+        || sscanf(p + 4, "pid: %ld\nallocations: %" SCNu64,
+                  pid, allocations) != 2)
+    {
+        fprintf(stderr, "invalid \"/stats\" response\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static int
+bench_io(long pid, bench_io_t *io)
+{
+    int   found;
+    char  name[64], line[128];
+    FILE  *f;
+
+    snprintf(name, sizeof(name), "/proc/%ld/io", pid);
+
+    f = fopen(name, "r");
+    if (f == NULL) {
+        fprintf(stderr, "fopen(\"%s\") failed %d\n", name, errno);
+        return 1;
+    }
+
+    found = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        found += sscanf(line, "syscr: %" SCNu64, &io->syscr);
+        found += sscanf(line, "syscw: %" SCNu64, &io->syscw);
+    }
+
+    fclose(f);
+
+    return found != 2;
+}
+
+
+/*
+ * Attaches to all threads of the router and waits until they are stopped,
+ * so that system calls are counted since the first request.
+ */
+
+static int
+bench_trace_attach(long pid)
+{
+    int             ret;
+    DIR             *dir;
+    char            name[64];
+    pid_t           tid;
+    unsigned        i, stopped;
+    struct dirent   *de;
+    bench_tracee_t  *t;
+
+    snprintf(name, sizeof(name), "/proc/%ld/task", pid);
+
+    dir = opendir(name);
+    if (dir == NULL) {
+        fprintf(stderr, "opendir(\"%s\") failed %d\n", name, errno);
+        return 1;
+    }
+
+    ret = 0;
+
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+
+        if (ntracees == BENCH_TRACE_MAX) {
+            fprintf(stderr, "too many router threads\n");
+            ret = 1;
+            break;
+        }
+
+        tid = atoi(de->d_name);
+
+        if (ptrace(PTRACE_SEIZE, tid, NULL, (void *) PTRACE_O_TRACESYSGOOD)
+            != 0)
+        {
+            fprintf(stderr, "ptrace(PTRACE_SEIZE, %d) failed %d\n",
+                    (int) tid, errno);
+            ret = 1;
+            break;
+        }
+
+        t = &tracees[ntracees++];
+        t->tid = tid;
+
+        (void) ptrace(PTRACE_INTERRUPT, tid, NULL, NULL);
+    }
+
+    closedir(dir);
+
+    for (stopped = 0; stopped < ntracees; stopped++) {
+        if (bench_trace_wait(0, NULL) == NULL) {
+            return 1;
+        }
+    }
+
+    if (ret != 0) {
+        (void) bench_trace_detach();
+        return ret;
+    }
+
+    for (i = 0; i < ntracees; i++) {
+        t = &tracees[i];
+
+        if (!t->exited) {
+            t->stopped = 0;
+            (void) ptrace(PTRACE_SYSCALL, t->tid, NULL,
+                          (void *) (long) t->signo);
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+bench_trace(unsigned conns, uint64_t *syscalls)
+{
+    while (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) != conns) {
+        if (bench_trace_wait(1, syscalls) == NULL) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+bench_trace_detach(void)
+{
+    unsigned        i, running;
+    bench_tracee_t  *t;
+
+    running = 0;
+
+    for (i = 0; i < ntracees; i++) {
+        t = &tracees[i];
+
+        if (!t->stopped) {
+            (void) ptrace(PTRACE_INTERRUPT, t->tid, NULL, NULL);
+            running++;
+        }
+    }
+
+    while (running != 0) {
+        if (bench_trace_wait(0, NULL) == NULL) {
+            return 1;
+        }
+
+        running--;
+    }
+
+    for (i = 0; i < ntracees; i++) {
+        t = &tracees[i];
+
+        if (!t->exited) {
+            (void) ptrace(PTRACE_DETACH, t->tid, NULL,
+                          (void *) (long) t->signo);
+        }
+    }
+
+    ntracees = 0;
+
+    return 0;
+}
+
+
+/*
+ * Waits for a stop of a running traced thread, counts a system call
+ * entry, and resumes the thread if "resume" is set.  A signal which
+ * has stopped the thread is delivered on resumption.
+ */
+
+static bench_tracee_t *
+bench_trace_wait(int resume, uint64_t *syscalls)
+{
+    int                           status, signo;
+    pid_t                         tid;
+    unsigned                      i;
+    bench_tracee_t                *t;
+    struct __ptrace_syscall_info  info;
+
+    tid = waitpid(-1, &status, __WALL);
+    if (tid == -1) {
+        fprintf(stderr, "waitpid() failed %d\n", errno);
+        return NULL;
+    }
+
+    t = NULL;
+
+    for (i = 0; i < ntracees; i++) {
+        if (tracees[i].tid == tid) {
+            t = &tracees[i];
+            break;
+        }
+    }
+
+    if (t == NULL) {
+        fprintf(stderr, "unknown traced thread %d\n", (int) tid);
+        return NULL;
+    }
+
+    if (!WIFSTOPPED(status)) {
+        t->stopped = 1;
+        t->exited = 1;
+        return t;
+    }
+
+    signo = WSTOPSIG(status);
+
+    if (signo == (SIGTRAP | 0x80)) {
+        signo = 0;
+
+        if (syscalls != NULL
+            && ptrace(PTRACE_GET_SYSCALL_INFO, tid, sizeof(info), &info) > 0
+            && info.op == PTRACE_SYSCALL_INFO_ENTRY)
+        {
+            (*syscalls)++;
+        }
+
+    } else if ((status >> 16) != 0) {
+        /* An interrupt or a group stop. */
+        signo = 0;
+    }
+
+    if (!resume) {
+        t->signo = signo;
+        t->stopped = 1;
+        return t;
+    }
+
+    (void) ptrace(PTRACE_SYSCALL, tid, NULL, (void *) (long) signo);
+
+    return t;
+}
+
+
+static uint64_t
+bench_time(void)
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static int
+bench_cmp(const void *a, const void *b)
+{
+    uint64_t  x, y;
+
+    x = *(const uint64_t *) a;
+    y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+static void
+bench_usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-c connections] [-n requests] [-w warmup requests]\n"
+            "          [-s request body size | -r response body size]\n"
+            "          [-p router pid [-t]] address:port | unix:path\n",
+            name);
+}
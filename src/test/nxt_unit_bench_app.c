@@ -0,0 +1,369 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+/*
+ * The application side of the round-trip benchmark, see unit_bench.
+ * A request to "/stats" returns the process ID and the number of heap
+ * allocations made so far, a request with "size=N" query returns N
+ * bytes, and any other request gets its body echoed back.
+ */
+
+#include <nxt_unit.h>
+#include <nxt_unit_request.h>
+#include <nxt_clang.h>
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+
+#define CONTENT_TYPE    "Content-Type"
+#define CONTENT_LENGTH  "Content-Length"
+#define TEXT_PLAIN      "text/plain"
+
+#define STATS_PATH      "/stats"
+#define SIZE_ARG        "size="
+
+#define BENCH_CHUNK     (64 * 1024)
+
+
+static int ready_handler(nxt_unit_ctx_t *ctx);
+static void *worker(void *main_ctx);
+static void bench_request_handler(nxt_unit_request_info_t *req);
+static int bench_stats(nxt_unit_request_info_t *req);
+static int bench_response(nxt_unit_request_info_t *req, uint64_t size,
+    int echo);
+
+
+static int            thread_count;
+static pthread_t      *threads;
+static unsigned long  allocations;
+
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+
+/*
+ * All heap allocations of the process, including those of libunit,
+ * are counted by interposing the glibc allocator entry points.  Address
+ * sanitizer builds have their own allocator, so nothing is counted there.
+ */
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *memalign(size_t alignment, size_t size);
+
+
+void *
+malloc(size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_malloc(size);
+}
+
+
+void *
+calloc(size_t n, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_calloc(n, size);
+}
+
+
+void *
+realloc(void *p, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_realloc(p, size);
+}
+
+
+/* libunit and nxt_memalign() allocate aligned memory with these. */
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void  *p;
+
+    if (alignment % sizeof(void *) != 0
+        || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    p = __libc_memalign(alignment, size);
+    if (p == NULL) {
+        return ENOMEM;
+    }
+
+    *memptr = p;
+
+    return 0;
+}
+
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_memalign(alignment, size);
+}
+
+
+void *
+memalign(size_t alignment, size_t size)
+{
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+    return __libc_memalign(alignment, size);
+}
+
+#endif
+
+
+int
+main(int argc, char **argv)
+{
+    int              i, err;
+    nxt_unit_ctx_t   *ctx;
+    nxt_unit_init_t  init;
+
+    if (argc == 3 && strcmp(argv[1], "-t") == 0) {
+        thread_count = atoi(argv[2]);
+    }
+
+    memset(&init, 0, sizeof(nxt_unit_init_t));
+
+    init.callbacks.request_handler = bench_request_handler;
+    init.callbacks.ready_handler = ready_handler;
+
+    ctx = nxt_unit_init(&init);
+    if (ctx == NULL) {
+        return 1;
+    }
+
+    err = nxt_unit_run(ctx);
+
+    nxt_unit_debug(ctx, "main worker finished with %d code", err);
+
+    if (thread_count > 1) {
+        for (i = 0; i < thread_count - 1; i++) {
+            err = pthread_join(threads[i], NULL);
+
+            if (nxt_slow_path(err != 0)) {
+                nxt_unit_alert(ctx, "pthread_join(#%d) failed: %s (%d)",
+                                    i, strerror(err), err);
+            }
+        }
+
+        nxt_unit_free(ctx, threads);
+    }
+
+    nxt_unit_done(ctx);
+
+    return 0;
+}
+
+
+static int
+ready_handler(nxt_unit_ctx_t *ctx)
+{
+    int  i, err;
+
+    if (thread_count <= 1) {
+        return NXT_UNIT_OK;
+    }
+
+    threads = nxt_unit_malloc(ctx, sizeof(pthread_t) * (thread_count - 1));
+    if (threads == NULL) {
+        return NXT_UNIT_ERROR;
+    }
+
+    for (i = 0; i < thread_count - 1; i++) {
+        err = pthread_create(&threads[i], NULL, worker, ctx);
+        if (err != 0) {
+            return NXT_UNIT_ERROR;
+        }
+    }
+
+    return NXT_UNIT_OK;
+}
+
+
+static void *
+worker(void *main_ctx)
+{
+    int             rc;
+    nxt_unit_ctx_t  *ctx;
+
+    ctx = nxt_unit_ctx_alloc(main_ctx, NULL);
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    rc = nxt_unit_run(ctx);
+
+    nxt_unit_done(ctx);
+
+    return (void *) (intptr_t) rc;
+}
+
+
+static void
+bench_request_handler(nxt_unit_request_info_t *req)
+{
+    int                 rc;
+    char                *query;
+    nxt_unit_request_t  *r;
+
+    r = req->request;
+
+    if (r->path_length == nxt_length(STATS_PATH)
+        && memcmp(nxt_unit_sptr_get(&r->path), STATS_PATH,
+                  nxt_length(STATS_PATH)) == 0)
+    {
+        rc = bench_stats(req);
+
+    } else if (r->query_length > nxt_length(SIZE_ARG)
+               && memcmp(nxt_unit_sptr_get(&r->query), SIZE_ARG,
+                         nxt_length(SIZE_ARG)) == 0)
+    {
+        query = (char *) nxt_unit_sptr_get(&r->query) + nxt_length(SIZE_ARG);
+
+        rc = bench_response(req, strtoull(query, NULL, 10), 0);
+
+    } else {
+        rc = bench_response(req, r->content_length, 1);
+    }
+
+    nxt_unit_request_done(req, rc);
+}
+
+
+static int
+bench_stats(nxt_unit_request_info_t *req)
+{
+    int   rc, len, length_len;
+    char  buf[64], length[24];
+
+    len = snprintf(buf, sizeof(buf), "pid: %d\nallocations: %lu\n",
+                   (int) getpid(),
+                   __atomic_load_n(&allocations, __ATOMIC_RELAXED));
+
+    length_len = snprintf(length, sizeof(length), "%d", len);
+
+    rc = nxt_unit_response_init(req, 200, 2,
+                                nxt_length(CONTENT_TYPE)
+                                + nxt_length(TEXT_PLAIN)
+                                + nxt_length(CONTENT_LENGTH) + length_len
+                                + len);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_add_field(req,
+                                     CONTENT_TYPE, nxt_length(CONTENT_TYPE),
+                                     TEXT_PLAIN, nxt_length(TEXT_PLAIN));
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_add_field(req,
+                                     CONTENT_LENGTH,
+                                     nxt_length(CONTENT_LENGTH),
+                                     length, length_len);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_add_content(req, buf, len);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    return nxt_unit_response_send(req);
+}
+
+
+static int
+bench_response(nxt_unit_request_info_t *req, uint64_t size, int echo)
+{
+    int             rc, len;
+    char            length[24];
+    ssize_t         n;
+    uint32_t        chunk;
+    nxt_unit_buf_t  *buf;
+
+    len = snprintf(length, sizeof(length), "%llu", (unsigned long long) size);
+
+    rc = nxt_unit_response_init(req, 200, 2,
+                                nxt_length(CONTENT_TYPE)
+                                + nxt_length(TEXT_PLAIN)
+                                + nxt_length(CONTENT_LENGTH) + len);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_add_field(req,
+                                     CONTENT_TYPE, nxt_length(CONTENT_TYPE),
+                                     TEXT_PLAIN, nxt_length(TEXT_PLAIN));
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_add_field(req,
+                                     CONTENT_LENGTH,
+                                     nxt_length(CONTENT_LENGTH),
+                                     length, len);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    rc = nxt_unit_response_send(req);
+    if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+        return rc;
+    }
+
+    while (size > 0) {
+        chunk = size < BENCH_CHUNK ? size : BENCH_CHUNK;
+
+        buf = nxt_unit_response_buf_alloc(req, chunk);
+        if (nxt_slow_path(buf == NULL)) {
+            return NXT_UNIT_ERROR;
+        }
+
+        if (echo) {
+            n = nxt_unit_request_read(req, buf->free, chunk);
+            if (nxt_slow_path(n <= 0)) {
+                nxt_unit_buf_free(buf);
+                return NXT_UNIT_ERROR;
+            }
+
+            chunk = n;
+
+        } else {
+            memset(buf->free, 'x', chunk);
+        }
+
+        buf->free += chunk;
+        size -= chunk;
+
+        rc = nxt_unit_buf_send(buf);
+        if (nxt_slow_path(rc != NXT_UNIT_OK)) {
+            return rc;
+        }
+    }
+
+    return NXT_UNIT_OK;
+}
@@ -0,0 +1,24 @@
+import json
+import os
+
+
+def application(environ, start_response):
+    ret = {'cpus': sorted(os.sched_getaffinity(0))}
+
+    try:
+        with open('/proc/self/numa_maps', encoding='utf-8') as f:
+            ret['policy'] = f.readline().split()[1]
+
+    except OSError:
+        ret['policy'] = None
+
+    out = json.dumps(ret).encode()
+
+    start_response(
+        '200',
+        [
+            ('Content-Type', 'application/json'),
+            ('Content-Length', str(len(out))),
+        ],
+    )
+    return [out]
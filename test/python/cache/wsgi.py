@@ -0,0 +1,30 @@
+import time
+from urllib.parse import parse_qs
+
+count = 0
+
+
+def application(environ, start_response):
+    global count
+
+    count += 1
+
+    args = parse_qs(environ.get('QUERY_STRING', ''))
+    body = str(count).encode()
+
+    if 'size' in args:
+        body += b'x' * int(args['size'][0])
+
+    if 'delay' in args:
+        time.sleep(int(args['delay'][0]))
+
+    headers = [('Content-Length', str(len(body)))]
+
+    for name in ('Cache-Control', 'Vary', 'Set-Cookie', 'Expires'):
+        value = args.get(name.lower())
+
+        if value is not None:
+            headers.append((name, value[0]))
+
+    start_response(args.get('status', ['200'])[0], headers)
+    return [body]
@@ -0,0 +1,16 @@
+import time
+
+
+def application(environ, start_response):
+    time.sleep(int(environ.get('HTTP_X_DELAY', 0)))
+
+    length = 0
+    while True:
+        data = environ['wsgi.input'].read(65536)
+        if not data:
+            break
+
+        length += len(data)
+
+    start_response('200', [('Content-Length', '0'), ('X-Length', str(length))])
+    return []
@@ -0,0 +1,24 @@
+import os
+import time
+
+requests = []
+
+
+def application(environ, start_response):
+    uri = environ['PATH_INFO']
+
+    if environ['QUERY_STRING']:
+        uri += f'?{environ["QUERY_STRING"]}'
+
+    if environ['PATH_INFO'] == '/target':
+        uri += f'={environ["HTTP_HOST"]}:{environ["SERVER_PORT"]}'
+
+    requests.append(uri)
+
+    if environ['PATH_INFO'] == '/slow':
+        time.sleep(2)
+
+    body = f'{os.getpid()} {",".join(requests)}'.encode()
+
+    start_response('200', [('Content-Length', str(len(body)))])
+    return [body]
@@ -392,6 +392,94 @@ def test_access_log_format_njs(require, search_in_file, wait_for_record):
     check_format(log_format, '{"status":"200","uri":"/"}')
 
 
+def set_buffer(buffer, flush=1, offload=False):
+    assert 'success' in client.conf(
+        {
+            'path': f'{option.temp_dir}/access.log',
+            'format': '$uri',
+            'buffer': buffer,
+            'flush': flush,
+            'offload': offload,
+        },
+        'access_log',
+    ), 'access_log buffer'
+
+
+def test_access_log_buffer(search_in_file, wait_for_record):
+    load('empty')
+    set_buffer(4096, flush=2)
+
+    assert client.get(url='/buffered')['status'] == 200
+
+    assert search_in_file(r'^/buffered$', 'access.log') is None, 'buffered'
+    assert wait_for_record(r'^/buffered$', 'access.log') is not None, 'flush'
+
+
+def test_access_log_buffer_full(wait_for_record):
+    load('empty')
+    set_buffer(64, flush=60)
+
+    for i in range(8):
+        assert client.get(url=f'/full_{i}_{"X" * 16}')['status'] == 200
+
+    assert (
+        wait_for_record(r'^/full_0_X+\n/full_1_X+$', 'access.log', wait=20)
+        is not None
+    ), 'size flush'
+
+
+def test_access_log_buffer_offload(search_in_file, wait_for_record):
+    load('empty')
+    set_buffer(64, flush=1, offload=True)
+
+    for i in range(8):
+        assert client.get(url=f'/offload_{i}_{"X" * 16}')['status'] == 200
+
+    assert (
+        wait_for_record(r'^/offload_7_X+$', 'access.log') is not None
+    ), 'offload'
+
+    records = search_in_file(r'^/offload_0_X+\n/offload_1_X+$', 'access.log')
+    assert records is not None, 'offload order'
+
+
+def test_access_log_buffer_offload_sync(temp_dir, wait_for_record):
+    load('empty')
+    set_buffer(64, flush=60, offload=True)
+
+    for i in range(8):
+        assert client.get(url=f'/offload_{i}_{"X" * 16}')['status'] == 200
+
+    set_buffer(0)
+
+    assert client.get(url='/sync')['status'] == 200
+
+    assert wait_for_record(r'^/sync$', 'access.log') is not None, 'sync'
+
+    with open(f'{temp_dir}/access.log', encoding='utf-8') as f:
+        records = f.read().split()
+
+    assert records == [f'/offload_{i}_{"X" * 16}' for i in range(8)] + [
+        '/sync'
+    ], 'sync order'
+
+
+def test_access_log_buffer_change(temp_dir, wait_for_record):
+    load('empty')
+    set_buffer(4096, flush=60)
+
+    assert client.get(url='/old')['status'] == 200
+
+    assert 'success' in client.conf(
+        {'path': f'{temp_dir}/new.log', 'format': '$uri'}, 'access_log'
+    )
+
+    assert client.get(url='/new')['status'] == 200
+
+    assert wait_for_record(r'^/old$', 'access.log') is not None, 'old'
+    assert wait_for_record(r'^/new$', 'new.log') is not None, 'new'
+
+
 def test_access_log_incorrect(temp_dir, skip_alert):
     skip_alert(r'failed to apply new conf')
 
@@ -409,3 +497,13 @@ def test_access_log_incorrect(temp_dir, skip_alert):
     ), 'access_log format incorrect'
 
     assert 'error' in client.conf('$arg_', 'access_log/if')
+
+    def check_buffer(conf):
+        assert 'error' in client.conf(
+            {'path': f'{temp_dir}/access.log', **conf}, 'access_log'
+        ), 'access_log buffer incorrect'
+
+    check_buffer({'buffer': -1})
+    check_buffer({'buffer': '4k'})
+    check_buffer({'flush': -1})
+    check_buffer({'offload': 1})
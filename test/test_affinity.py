@@ -0,0 +1,122 @@
+import os
+import re
+import subprocess
+from pathlib import Path
+
+import pytest
+
+from unit.applications.lang.python import ApplicationPython
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+NUMA_MAPS = Path('/proc/self/numa_maps').exists()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(system):
+    if system != 'Linux':
+        pytest.skip('requires Linux')
+
+
+def router_pid(unit_pid):
+    output = subprocess.check_output(['ps', 'ax', '-O', 'ppid']).decode()
+    return re.search(fr'\s*(\d+)\s*{unit_pid}.*unit: router', output).group(1)
+
+
+def threads_cpus(pid):
+    cpus = []
+
+    for task in sorted(Path(f'/proc/{pid}/task').iterdir()):
+        status = (task / 'status').read_text(encoding='utf-8')
+        cpus.append(re.search(r'Cpus_allowed_list:\s*(\S+)', status).group(1))
+
+    return cpus
+
+
+def load(**kwargs):
+    client.load('affinity', **kwargs)
+
+
+def test_affinity_app_cpus():
+    load()
+
+    assert client.getjson()['body']['cpus'] == sorted(
+        os.sched_getaffinity(0)
+    ), 'default'
+
+    assert 'success' in client.conf('"0"', 'applications/affinity/cpus')
+
+    assert client.getjson()['body']['cpus'] == [0], 'cpus'
+
+
+@pytest.mark.skipif(
+    not Path('/sys/devices/system/node/node0').exists(),
+    reason='requires NUMA node 0',
+)
+def test_affinity_app_numa_node(unit_pid):
+    load()
+
+    if NUMA_MAPS:
+        assert client.getjson()['body']['policy'] == 'default', 'default'
+
+    assert 'success' in client.conf('0', 'applications/affinity/numa_node')
+
+    body = client.getjson()['body']
+
+    cpulist = Path('/sys/devices/system/node/node0/cpulist').read_text(
+        encoding='utf-8'
+    )
+    assert body['cpus'][0] == int(re.match(r'\d+', cpulist).group()), 'cpus'
+
+    if not NUMA_MAPS:
+        return
+
+    assert body['policy'] == 'prefer:0', 'app policy'
+
+    numa_maps = Path(f'/proc/{router_pid(unit_pid)}/numa_maps').read_text(
+        encoding='utf-8'
+    )
+    assert re.search(r'prefer:0 file=/memfd:', numa_maps), 'router mmaps'
+
+
+def test_affinity_listen_cpus(unit_pid, skip_fds_check):
+    skip_fds_check(router=True)
+
+    assert 'success' in client.conf(
+        {
+            "settings": {"listen_threads": 2, "listen_cpus": "0"},
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        }
+    )
+
+    assert client.get()['status'] == 200
+
+    if len(os.sched_getaffinity(0)) == 1:
+        return
+
+    cpus = threads_cpus(router_pid(unit_pid))
+    assert cpus.count('0') >= 2, 'router threads'
+
+    assert 'success' in client.conf_delete('settings/listen_cpus')
+    assert client.get()['status'] == 200
+
+    cpus = threads_cpus(router_pid(unit_pid))
+    assert cpus.count('0') < 2, 'unpinned'
+
+
+def test_affinity_invalid():
+    load()
+
+    def check(path, value):
+        assert 'error' in client.conf(value, path), value
+
+    for value in ['""', '"-1"', '"3-1"', '"0,"', '"a"', '"0-1024"', '0']:
+        check('settings/listen_cpus', value)
+        check('applications/affinity/cpus', value)
+
+    for value in ['-1', '1024', '"0"']:
+        check('applications/affinity/numa_node', value)
@@ -0,0 +1,535 @@
+import socket
+import struct
+from pathlib import Path
+
+import pytest
+
+from unit.applications.lang.python import ApplicationPython
+from unit.option import option
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+PREFACE = b'PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n'
+
+DATA = 0x0
+HEADERS = 0x1
+RST_STREAM = 0x3
+SETTINGS = 0x4
+PING = 0x6
+GOAWAY = 0x7
+WINDOW_UPDATE = 0x8
+
+END_STREAM = 0x1
+ACK = 0x1
+END_HEADERS = 0x4
+
+STATIC_TABLE = [
+    (':authority', ''),
+    (':method', 'GET'),
+    (':method', 'POST'),
+    (':path', '/'),
+    (':path', '/index.html'),
+    (':scheme', 'http'),
+    (':scheme', 'https'),
+    (':status', '200'),
+    (':status', '204'),
+    (':status', '206'),
+    (':status', '304'),
+    (':status', '400'),
+    (':status', '404'),
+    (':status', '500'),
+    ('accept-charset', ''),
+    ('accept-encoding', 'gzip, deflate'),
+    ('accept-language', ''),
+    ('accept-ranges', ''),
+    ('accept', ''),
+    ('access-control-allow-origin', ''),
+    ('age', ''),
+    ('allow', ''),
+    ('authorization', ''),
+    ('cache-control', ''),
+    ('content-disposition', ''),
+    ('content-encoding', ''),
+    ('content-language', ''),
+    ('content-length', ''),
+    ('content-location', ''),
+    ('content-range', ''),
+    ('content-type', ''),
+    ('cookie', ''),
+    ('date', ''),
+    ('etag', ''),
+    ('expect', ''),
+    ('expires', ''),
+    ('from', ''),
+    ('host', ''),
+    ('if-match', ''),
+    ('if-modified-since', ''),
+    ('if-none-match', ''),
+    ('if-range', ''),
+    ('if-unmodified-since', ''),
+    ('last-modified', ''),
+    ('link', ''),
+    ('location', ''),
+    ('max-forwards', ''),
+    ('proxy-authenticate', ''),
+    ('proxy-authorization', ''),
+    ('range', ''),
+    ('referer', ''),
+    ('refresh', ''),
+    ('retry-after', ''),
+    ('server', ''),
+    ('set-cookie', ''),
+    ('strict-transport-security', ''),
+    ('transfer-encoding', ''),
+    ('user-agent', ''),
+    ('vary', ''),
+    ('via', ''),
+    ('www-authenticate', ''),
+]
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(temp_dir):
+    assets_dir = f'{temp_dir}/assets'
+
+    Path(assets_dir).mkdir()
+    Path(f'{assets_dir}/index.html').write_text('0123456789', encoding='utf-8')
+    Path(f'{assets_dir}/big').write_bytes(b'x' * 200000)
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes", "http2": True}},
+            "routes": [
+                {
+                    "match": {"uri": "/mirror"},
+                    "action": {"pass": "applications/mirror"},
+                },
+                {"action": {"share": f'{assets_dir}$uri'}},
+            ],
+            "applications": {
+                "mirror": {
+                    "type": client.get_application_type(),
+                    "processes": {"spare": 0},
+                    "path": f'{option.test_dir}/python/mirror',
+                    "working_directory": f'{option.test_dir}/python/mirror',
+                    "module": "wsgi",
+                }
+            },
+        }
+    )
+
+
+def encode_int(value, prefix, flags=0):
+    mask = (1 << prefix) - 1
+
+    if value < mask:
+        return bytes([flags | value])
+
+    out = [flags | mask]
+    value -= mask
+
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+
+    out.append(value)
+
+    return bytes(out)
+
+
+def decode_int(data, pos, prefix):
+    mask = (1 << prefix) - 1
+    value = data[pos] & mask
+    pos += 1
+
+    if value < mask:
+        return value, pos
+
+    shift = 0
+
+    while True:
+        b = data[pos]
+        pos += 1
+        value += (b & 0x7F) << shift
+        shift += 7
+
+        if not b & 0x80:
+            return value, pos
+
+
+def encode_headers(headers):
+    block = b''
+
+    for name, value in headers:
+        name = name.encode()
+        value = value.encode()
+
+        block += b'\x00' + encode_int(len(name), 7) + name
+        block += encode_int(len(value), 7) + value
+
+    return block
+
+
+def decode_headers(block):
+    headers = []
+    pos = 0
+
+    while pos < len(block):
+        b = block[pos]
+
+        if b & 0x80:
+            index, pos = decode_int(block, pos, 7)
+            headers.append(STATIC_TABLE[index - 1])
+            continue
+
+        assert not b & 0x40 and not b & 0x20, 'no dynamic table'
+
+        index, pos = decode_int(block, pos, 4)
+
+        if index:
+            name = STATIC_TABLE[index - 1][0]
+
+        else:
+            length, pos = decode_int(block, pos, 7)
+            name = block[pos : pos + length].decode()
+            pos += length
+
+        assert not block[pos] & 0x80, 'no huffman'
+
+        length, pos = decode_int(block, pos, 7)
+        headers.append((name, block[pos : pos + length].decode()))
+        pos += length
+
+    return headers
+
+
+def frame(ftype, flags, stream_id, payload=b''):
+    return (
+        struct.pack('>I', len(payload))[1:]
+        + bytes([ftype, flags])
+        + struct.pack('>I', stream_id)
+        + payload
+    )
+
+
+def recvall(sock, length):
+    data = b''
+
+    while len(data) < length:
+        chunk = sock.recv(length - len(data))
+
+        if not chunk:
+            return None
+
+        data += chunk
+
+    return data
+
+
+def read_frame(sock):
+    header = recvall(sock, 9)
+
+    if header is None:
+        return None
+
+    length = struct.unpack('>I', b'\x00' + header[:3])[0]
+    payload = recvall(sock, length) if length else b''
+
+    return {
+        'type': header[3],
+        'flags': header[4],
+        'stream': struct.unpack('>I', header[5:9])[0] & 0x7FFFFFFF,
+        'payload': payload,
+    }
+
+
+def h2_connect(settings=b''):
+    sock = socket.create_connection(('127.0.0.1', 8080))
+    sock.settimeout(10)
+    sock.sendall(PREFACE + frame(SETTINGS, 0, 0, settings))
+
+    return sock
+
+
+def h2_request(
+    sock, stream_id=1, method='GET', path='/', body=None, headers=None
+):
+    fields = [
+        (':method', method),
+        (':scheme', 'http'),
+        (':authority', 'localhost'),
+        (':path', path),
+    ]
+
+    if headers is not None:
+        fields += headers
+
+    flags = END_HEADERS if body is not None else END_HEADERS | END_STREAM
+
+    sock.sendall(frame(HEADERS, flags, stream_id, encode_headers(fields)))
+
+    if body is not None:
+        while len(body) > 16384:
+            sock.sendall(frame(DATA, 0, stream_id, body[:16384]))
+            body = body[16384:]
+
+        sock.sendall(frame(DATA, END_STREAM, stream_id, body))
+
+
+def h2_responses(sock, count=1):
+    responses = {}
+    done = 0
+
+    while done < count:
+        f = read_frame(sock)
+
+        assert f is not None, 'connection closed'
+
+        if f['type'] == SETTINGS and not f['flags'] & ACK:
+            sock.sendall(frame(SETTINGS, ACK, 0))
+            continue
+
+        if f['type'] == GOAWAY:
+            return responses, f
+
+        if f['type'] not in (HEADERS, DATA, RST_STREAM):
+            continue
+
+        resp = responses.setdefault(
+            f['stream'], {'headers': {}, 'body': b'', 'reset': None}
+        )
+
+        if f['type'] == HEADERS:
+            for name, value in decode_headers(f['payload']):
+                resp['headers'][name] = value
+
+        elif f['type'] == DATA:
+            resp['body'] += f['payload']
+
+            if f['payload']:
+                sock.sendall(
+                    frame(
+                        WINDOW_UPDATE,
+                        0,
+                        0,
+                        struct.pack('>I', len(f['payload'])),
+                    )
+                    + frame(
+                        WINDOW_UPDATE,
+                        0,
+                        f['stream'],
+                        struct.pack('>I', len(f['payload'])),
+                    )
+                )
+
+        else:
+            resp['reset'] = struct.unpack('>I', f['payload'])[0]
+            done += 1
+            continue
+
+        if f['flags'] & END_STREAM:
+            done += 1
+
+    return responses, None
+
+
+def h2_get(path='/index.html', **kwargs):
+    sock = h2_connect()
+    h2_request(sock, path=path, **kwargs)
+
+    responses, _ = h2_responses(sock)
+    sock.close()
+
+    return responses[1]
+
+
+def test_http2_get():
+    resp = h2_get()
+
+    assert resp['headers'][':status'] == '200', 'status'
+    assert resp['headers']['content-length'] == '10', 'content-length'
+    assert resp['body'] == b'0123456789', 'body'
+
+    assert h2_get(path='/blah')['headers'][':status'] == '404', 'not found'
+
+
+def test_http2_flow_control():
+    resp = h2_get(path='/big')
+
+    assert resp['headers'][':status'] == '200', 'status'
+    assert resp['body'] == b'x' * 200000, 'body'
+
+
+def test_http2_multiplexing():
+    sock = h2_connect()
+
+    for stream_id in (1, 3, 5, 7):
+        h2_request(sock, stream_id=stream_id, path='/index.html')
+
+    h2_request(sock, stream_id=9, path='/big')
+
+    responses, _ = h2_responses(sock, 5)
+    sock.close()
+
+    for stream_id in (1, 3, 5, 7):
+        assert responses[stream_id]['body'] == b'0123456789', 'body'
+
+    assert len(responses[9]['body']) == 200000, 'big body'
+
+
+def test_http2_post():
+    body = b'0123456789' * 6000
+
+    resp = h2_get(path='/mirror', method='POST', body=body)
+
+    assert resp['headers'][':status'] == '200', 'status'
+    assert resp['body'] == body, 'body'
+
+
+def test_http2_post_content_length():
+    resp = h2_get(
+        path='/mirror',
+        method='POST',
+        body=b'blah',
+        headers=[('content-length', '5')],
+    )
+
+    assert resp['headers'][':status'] == '400', 'content-length mismatch'
+
+
+def test_http2_bad_request():
+    assert (
+        h2_get(headers=[('connection', 'close')])['headers'][':status']
+        == '400'
+    ), 'connection-specific field'
+    assert (
+        h2_get(headers=[('Host', 'localhost')])['headers'][':status'] == '400'
+    ), 'uppercase field name'
+    assert (
+        h2_get(headers=[(':blah', 'blah')])['headers'][':status'] == '400'
+    ), 'unknown pseudo-header'
+    assert (
+        h2_get(path='/../index.html')['headers'][':status'] == '400'
+    ), 'invalid path'
+    assert (
+        h2_get(headers=[('te', 'trailers')])['headers'][':status'] == '200'
+    ), 'te trailers'
+
+
+def test_http2_ping():
+    sock = h2_connect()
+    sock.sendall(frame(PING, 0, 0, b'12345678'))
+
+    while True:
+        f = read_frame(sock)
+
+        if f['type'] == PING:
+            break
+
+    sock.close()
+
+    assert f['flags'] == ACK, 'ping ack'
+    assert f['payload'] == b'12345678', 'ping payload'
+
+
+def test_http2_ping_many():
+    sock = h2_connect()
+
+    for _ in range(10):
+        sock.sendall(frame(PING, 0, 0, b'12345678') * 100)
+
+    acks = 0
+
+    while acks < 1000:
+        f = read_frame(sock)
+
+        assert f is not None, 'connection closed'
+
+        if f['type'] == PING:
+            acks += 1
+
+    sock.close()
+
+
+def test_http2_settings_flood():
+    sock = h2_connect()
+    sock.sendall(frame(SETTINGS, 0, 0) * 1500)
+
+    _, goaway = h2_responses(sock)
+
+    assert goaway is not None, 'goaway'
+    assert struct.unpack('>I', goaway['payload'][4:8])[0] == 11, 'calm'
+    sock.close()
+
+
+def test_http2_rapid_reset():
+    sock = h2_connect()
+    stream_id = 1
+
+    for _ in range(10):
+        data = b''
+
+        for _ in range(40):
+            fields = [
+                (':method', 'POST'),
+                (':scheme', 'http'),
+                (':authority', 'localhost'),
+                (':path', '/mirror'),
+            ]
+
+            data += frame(
+                HEADERS, END_HEADERS, stream_id, encode_headers(fields)
+            )
+            data += frame(RST_STREAM, 0, stream_id, struct.pack('>I', 8))
+
+            stream_id += 2
+
+        sock.sendall(data)
+
+    _, goaway = h2_responses(sock)
+
+    assert goaway is not None, 'goaway'
+    assert struct.unpack('>I', goaway['payload'][4:8])[0] == 11, 'calm'
+    sock.close()
+
+
+def test_http2_protocol_error():
+    sock = h2_connect()
+    sock.sendall(frame(DATA, 0, 0, b'blah'))
+
+    _, goaway = h2_responses(sock)
+
+    assert goaway is not None, 'goaway'
+    assert struct.unpack('>I', goaway['payload'][4:8])[0] == 1, 'error code'
+
+    assert read_frame(sock) is None, 'connection closed'
+    sock.close()
+
+
+def test_http2_http1():
+    assert client.get(url='/index.html')['body'] == '0123456789', 'http/1.1'
+
+    assert 'success' in client.conf('false', 'listeners/*:8080/http2')
+
+    sock = socket.create_connection(('127.0.0.1', 8080))
+    sock.settimeout(10)
+    sock.sendall(PREFACE)
+
+    assert sock.recv(1024).startswith(b'HTTP/1.1 '), 'http2 disabled'
+    sock.close()
+
+
+def test_http2_idle_timeout():
+    assert 'success' in client.conf(
+        {"http": {"idle_timeout": 1}}, 'settings'
+    )
+
+    sock = h2_connect()
+
+    _, goaway = h2_responses(sock)
+
+    assert goaway is not None, 'goaway'
+    assert struct.unpack('>I', goaway['payload'][4:8])[0] == 0, 'no error'
+    sock.close()
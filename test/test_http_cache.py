@@ -0,0 +1,260 @@
+import time
+
+import pytest
+
+from unit.applications.lang.python import ApplicationPython
+from unit.option import option
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(temp_dir):
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [
+                {
+                    "action": {
+                        "pass": "applications/cache",
+                        "cache": {"path": temp_dir},
+                        "response_headers": {"X-Cache": "$cache_status"},
+                    }
+                }
+            ],
+            "applications": {
+                "cache": {
+                    "type": client.get_application_type(),
+                    "processes": 1,
+                    "path": f'{option.test_dir}/python/cache',
+                    "working_directory": f'{option.test_dir}/python/cache',
+                    "module": "wsgi",
+                }
+            },
+        }
+    )
+
+
+def cache_update(conf):
+    assert 'success' in client.conf(conf, 'routes/0/action/cache')
+
+
+def get(url, headers=None, method='GET'):
+    if headers is None:
+        headers = {}
+
+    headers.setdefault('Host', 'localhost')
+    headers.setdefault('Connection', 'close')
+
+    resp = client.http(method, url=url, headers=headers)
+
+    return resp['status'], resp['headers'].get('X-Cache'), resp['body']
+
+
+def test_http_cache():
+    url = '/?cache-control=max-age=60'
+
+    status, cache, body = get(url)
+    assert status == 200, 'miss status'
+    assert cache == 'MISS', 'miss'
+
+    resp = client.get(url=url)
+    assert resp['status'] == 200, 'hit status'
+    assert resp['headers']['X-Cache'] == 'HIT', 'hit'
+    assert resp['body'] == body, 'hit body'
+    assert resp['headers']['Content-Length'] == str(len(body)), 'length'
+    assert resp['headers']['Cache-Control'] == 'max-age=60', 'stored header'
+    assert 'Age' in resp['headers'], 'age'
+
+    assert get(url, method='HEAD')[1] == 'HIT', 'head hit'
+
+    assert get('/?cache-control=max-age=60&a')[1] == 'MISS', 'key'
+    assert get(url, method='POST')[1] == 'BYPASS', 'post'
+    assert get(url)[2] == body, 'post not stored'
+
+
+def test_http_cache_large():
+    url = '/?cache-control=max-age=60&size=500000'
+
+    _, cache, body = get(url)
+    assert cache == 'MISS', 'miss'
+    assert len(body) > 500000, 'miss length'
+
+    _, cache, body2 = get(url)
+    assert cache == 'HIT', 'hit'
+    assert body2 == body, 'hit body'
+
+
+def test_http_cache_not_stored():
+    for url in [
+        '/?a',
+        '/?cache-control=no-store,max-age=60',
+        '/?cache-control=private,max-age=60',
+        '/?cache-control=max-age=0',
+        '/?cache-control=max-age=60&set-cookie=a=b',
+        '/?cache-control=max-age=60&vary=*',
+        '/?cache-control=max-age=60&status=203',
+    ]:
+        status, cache, body = get(url)
+        assert cache == 'MISS', f'{url} miss'
+
+        status, cache, body2 = get(url)
+        assert cache == 'MISS', f'{url} not stored'
+        assert body2 != body, f'{url} body'
+
+
+def test_http_cache_valid():
+    assert get('/')[1] == 'MISS', 'miss'
+    assert get('/')[1] == 'MISS', 'not stored'
+
+    cache_update({"path": option.temp_dir, "valid": 60})
+
+    assert get('/')[1] == 'MISS', 'valid miss'
+    assert get('/')[1] == 'HIT', 'valid hit'
+
+    url = '/?expires=Thu,%2001%20Jan%201970%2000:00:00%20GMT'
+
+    assert get(url)[1] == 'MISS', 'expired miss'
+    assert get(url)[1] == 'MISS', 'expired not stored'
+
+
+def test_http_cache_expired():
+    url = '/?cache-control=max-age=1,stale-while-revalidate=60'
+
+    _, cache, body = get(url)
+    assert cache == 'MISS', 'miss'
+    assert get(url)[1] == 'HIT', 'hit'
+
+    time.sleep(2)
+
+    _, cache, body2 = get(url)
+    assert cache == 'EXPIRED', 'expired'
+    assert body2 != body, 'expired body'
+
+    _, cache, body3 = get(url)
+    assert cache == 'HIT', 'updated'
+    assert body3 == body2, 'updated body'
+
+
+def test_http_cache_lock():
+    url = '/?cache-control=max-age=60&delay=1'
+
+    sock = client.get(url=url, no_recv=True)
+
+    time.sleep(0.3)
+
+    _, cache, body = get(url)
+    assert cache == 'HIT', 'lock hit'
+
+    resp = client.recvall(sock).decode()
+    assert resp.endswith(f'\r\n\r\n{body}'), 'lock body'
+
+    sock.close()
+
+    url = '/?cache-control=max-age=60&delay=1&b'
+
+    sock = client.get(url=url, no_recv=True)
+
+    time.sleep(0.3)
+
+    waiter = client.get(url=url, no_recv=True)
+
+    time.sleep(0.1)
+
+    waiter.close()
+
+    client.recvall(sock)
+    sock.close()
+
+    assert get(url)[1] == 'HIT', 'lock waiter closed'
+
+    cache_update({"path": option.temp_dir, "lock_timeout": 0})
+
+    url = '/?cache-control=max-age=60&delay=1&a'
+
+    sock = client.get(url=url, no_recv=True)
+
+    time.sleep(0.3)
+
+    assert get(url)[1] == 'BYPASS', 'lock timeout'
+
+    client.recvall(sock)
+    sock.close()
+
+
+def test_http_cache_vary():
+    url = '/?cache-control=max-age=60&vary=Accept-Language'
+
+    _, cache, en = get(url, headers={'Accept-Language': 'en'})
+    assert cache == 'MISS', 'en miss'
+
+    _, cache, fr = get(url, headers={'Accept-Language': 'fr'})
+    assert cache == 'MISS', 'fr miss'
+    assert fr != en, 'fr body'
+
+    _, cache, body = get(url, headers={'Accept-Language': 'fr'})
+    assert cache == 'HIT', 'fr hit'
+    assert body == fr, 'fr hit body'
+
+    _, cache, body = get(url, headers={'Accept-Language': 'en'})
+    assert cache == 'HIT', 'en hit'
+    assert body == en, 'en hit body'
+
+    _, cache, body = get(url)
+    assert cache == 'MISS', 'none miss'
+
+    for lang, variant in (('en', en), ('fr', fr)):
+        _, cache, body = get(url, headers={'Accept-Language': lang})
+        assert cache == 'HIT', f'{lang} kept'
+        assert body == variant, f'{lang} kept body'
+
+
+def test_http_cache_authorization():
+    url = '/?cache-control=max-age=60'
+    headers = {'Authorization': 'Basic dTpw'}
+
+    assert get(url, headers=dict(headers))[1] == 'MISS', 'miss'
+    assert get(url, headers=dict(headers))[1] == 'MISS', 'not stored'
+
+    url = '/?cache-control=public,max-age=60'
+
+    assert get(url, headers=dict(headers))[1] == 'MISS', 'public miss'
+    assert get(url, headers=dict(headers))[1] == 'HIT', 'public hit'
+
+
+def test_http_cache_key():
+    cache_update({"path": option.temp_dir, "key": "$uri"})
+
+    assert get('/?cache-control=max-age=60')[1] == 'MISS', 'miss'
+    assert get('/?b')[1] == 'HIT', 'key hit'
+
+
+def test_http_cache_max_entries():
+    cache_update({"path": option.temp_dir, "valid": 60, "max_entries": 2})
+
+    assert get('/?1')[1] == 'MISS', 'miss 1'
+    assert get('/?2')[1] == 'MISS', 'miss 2'
+    assert get('/?1')[1] == 'HIT', 'hit 1'
+    assert get('/?3')[1] == 'MISS', 'miss 3'
+    assert get('/?1')[1] == 'HIT', 'lru 1'
+    assert get('/?2')[1] == 'MISS', 'evicted 2'
+
+
+def test_http_cache_max_size():
+    cache_update({"path": option.temp_dir, "valid": 60, "max_size": 0})
+
+    assert get('/')[1] == 'MISS', 'max_size miss'
+    assert get('/')[1] == 'MISS', 'max_size not stored'
+
+
+def test_http_cache_invalid():
+    def check_error(conf):
+        assert 'error' in client.conf(conf, 'routes/0/action/cache')
+
+    check_error({"path": 1})
+    check_error({"valid": "1"})
+    check_error({"max_entries": 0})
+    check_error({"blah": 1})
+    check_error('"/tmp"')
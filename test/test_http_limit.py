@@ -0,0 +1,223 @@
+import time
+
+import pytest
+
+from unit.applications.lang.python import ApplicationPython
+from unit.option import option
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture():
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [
+                {
+                    "match": {"uri": "/app"},
+                    "action": {
+                        "pass": "applications/delayed",
+                        "limit": {"key": "$remote_addr", "connections": 1},
+                    },
+                },
+                {
+                    "action": {
+                        "return": 200,
+                        "limit": {"key": "$remote_addr", "rate": 1},
+                    }
+                },
+            ],
+            "applications": {
+                "delayed": {
+                    "type": client.get_application_type(),
+                    "processes": 2,
+                    "path": f'{option.test_dir}/python/delayed',
+                    "working_directory": f'{option.test_dir}/python/delayed',
+                    "module": "wsgi",
+                }
+            },
+        }
+    )
+
+
+def limit_update(conf, step=1):
+    assert 'success' in client.conf(conf, f'routes/{step}/action/limit')
+
+
+def test_http_limit_rate():
+    assert client.get()['status'] == 200, 'first'
+    assert client.get()['status'] == 503, 'limited'
+
+    time.sleep(1.1)
+
+    assert client.get()['status'] == 200, 'leaked'
+
+    limit_update({"key": "$remote_addr", "rate": 1, "burst": 2})
+
+    for i in range(3):
+        assert client.get()['status'] == 200, f'burst {i}'
+
+    assert client.get()['status'] == 503, 'burst limited'
+
+    limit_update({"key": "$remote_addr", "rate": 1, "status": 429})
+
+    assert client.get()['status'] == 200, 'status first'
+    assert client.get()['status'] == 429, 'status'
+
+
+def get_key(key):
+    return client.get(
+        headers={'Host': 'localhost', 'X-Key': key, 'Connection': 'close'}
+    )['status']
+
+
+def test_http_limit_key():
+    limit_update({"key": "$header_x_key", "rate": 1})
+
+    assert get_key('a') == 200, 'key a'
+    assert get_key('b') == 200, 'key b'
+    assert get_key('a') == 503, 'key a limited'
+    assert get_key('b') == 503, 'key b limited'
+
+
+def test_http_limit_max_entries():
+    limit_update({"key": "$header_x_key", "rate": 1, "max_entries": 1})
+
+    assert get_key('a') == 200, 'first'
+
+    for i in range(64):
+        assert get_key(f'k{i}') == 200, 'keys'
+
+    assert get_key('a') == 200, 'evicted'
+
+
+def test_http_limit_max_entries_busy():
+    limit_update(
+        {"key": "$header_x_key", "connections": 1, "max_entries": 16}, 0
+    )
+
+    headers = {
+        'Host': 'localhost',
+        'X-Key': 'a',
+        'X-Delay': '1',
+        'Connection': 'close',
+    }
+
+    sock = client.get(url='/app', headers=headers, no_recv=True)
+
+    time.sleep(0.3)
+
+    def get_app(key):
+        return client.get(
+            url='/app',
+            headers={'Host': 'localhost', 'X-Key': key, 'Connection': 'close'},
+        )['status']
+
+    # The keys "a" and "q" fall into the same shard.
+
+    assert get_app('q') == 503, 'busy shard'
+    assert get_app('b') == 200, 'other shard'
+
+    assert client.recvall(sock).decode().startswith('HTTP/1.1 200')
+    sock.close()
+
+    assert get_app('q') == 200, 'evicted'
+
+
+def test_http_limit_reconfigure():
+    assert client.get()['status'] == 200, 'first'
+
+    assert 'success' in client.conf('"/app"', 'routes/0/match/uri')
+
+    assert client.get()['status'] == 503, 'kept'
+
+    limit_update({"zone": "a", "key": "$remote_addr", "rate": 1})
+
+    assert client.get()['status'] == 200, 'new zone'
+
+    limit_update({"zone": "a", "key": "$remote_addr", "rate": 1, "burst": 1})
+
+    assert client.get()['status'] == 200, 'zone burst'
+    assert client.get()['status'] == 503, 'zone kept'
+
+
+def test_http_limit_zone(skip_alert):
+    def routes(limit_a, limit):
+        return client.conf(
+            [
+                {
+                    "match": {"uri": "/a"},
+                    "action": {"return": 200, "limit": limit_a},
+                },
+                {"action": {"return": 200, "limit": limit}},
+            ],
+            'routes',
+        )
+
+    limit = {"key": "$remote_addr", "rate": 1}
+
+    assert 'success' in routes(limit, limit)
+
+    assert client.get(url='/a')['status'] == 200, 'first'
+    assert client.get()['status'] == 200, 'private'
+    assert client.get(url='/a')['status'] == 503, 'limited'
+
+    limit = {"zone": "z", "key": "$remote_addr", "rate": 1}
+
+    assert 'success' in routes(limit, limit)
+
+    assert client.get(url='/a')['status'] == 200, 'zone first'
+    assert client.get()['status'] == 503, 'zone shared'
+
+    skip_alert(
+        r'limit zone "z" is configured with different',
+        r'failed to apply new conf',
+    )
+
+    assert 'error' in routes(limit, {**limit, "max_entries": 16})
+
+
+def test_http_limit_delay():
+    limit_update(
+        {"key": "$remote_addr", "rate": 5, "burst": 5, "delay": True}
+    )
+
+    start = time.monotonic()
+
+    for _ in range(3):
+        assert client.get()['status'] == 200, 'delayed'
+
+    assert time.monotonic() - start >= 0.3, 'delay'
+
+
+def test_http_limit_connections():
+    headers = {'Host': 'localhost', 'X-Delay': '1', 'Connection': 'close'}
+
+    sock = client.get(url='/app', headers=headers, no_recv=True)
+
+    time.sleep(0.3)
+
+    assert client.get(url='/app')['status'] == 503, 'limited'
+
+    assert client.recvall(sock).decode().startswith('HTTP/1.1 200')
+    sock.close()
+
+    assert client.get(url='/app')['status'] == 200, 'released'
+
+
+def test_http_limit_invalid():
+    def check_error(conf):
+        assert 'error' in client.conf(conf, 'routes/1/action/limit')
+
+    check_error({"rate": 1})
+    check_error({"key": "$remote_addr"})
+    check_error({"key": "$remote_addr", "rate": 0})
+    check_error({"key": "$remote_addr", "connections": 0})
+    check_error({"key": "$remote_addr", "rate": 1, "status": 200})
+    check_error({"key": "$remote_addr", "rate": 1, "delay": 1})
+    check_error({"key": "$blah", "rate": 1})
+    check_error({"key": "$remote_addr", "rate": 1, "blah": 1})
+    check_error({"zone": 1, "key": "$remote_addr", "rate": 1})
@@ -132,6 +132,186 @@ def test_python_scale_updown():
     stop_all()
 
 
+def test_python_scaling():
+    client.load(
+        'delayed',
+        client.app_name,
+        processes={
+            "spare": 0,
+            "max": 4,
+            "idle_timeout": 1,
+            "scaling": {"backlog": 1, "step": 3, "cooldown": 0},
+        },
+    )
+
+    status_path = f'/status/applications/{client.app_name}/scaling'
+
+    assert client.conf_get(status_path) == {
+        'queued': 0,
+        'queue_wait': 0,
+        'started': 0,
+        'retired': 0,
+    }, 'scaling status'
+
+    socks = []
+    for _ in range(2):
+        sock = client.get(
+            headers={
+                'Host': 'localhost',
+                'X-Delay': '2',
+                'Connection': 'close',
+            },
+            no_recv=True,
+        )
+        socks.append(sock)
+
+    assert len(pids_for_process()) == 3, 'scaled up to step'
+
+    status = client.conf_get(status_path)
+    assert status['started'] == 1, 'scaled up'
+    assert status['queued'] == 0, 'queue empty'
+
+    for sock in socks:
+        assert client.recvall(sock).decode().startswith('HTTP/1.1 200')
+        sock.close()
+
+    time.sleep(2)
+
+    assert len(pids_for_process()) == 0, 'scaled down'
+    assert client.conf_get(f'{status_path}/retired') == 3, 'retired'
+
+
+def test_python_scaling_status():
+    assert 'error' in client.conf_get(
+        f'/status/applications/{client.app_name}/scaling'
+    ), 'no scaling status'
+
+
+def test_python_scaling_invalid():
+    def check_error(scaling):
+        assert 'error' in client.conf(
+            {"spare": 0, "max": 2, "scaling": scaling}, client.app_proc
+        )
+
+    check_error({"queue_wait": 0})
+    check_error({"backlog": 0})
+    check_error({"step": 0})
+    check_error({"cooldown": -1})
+    check_error({"queue_wait": "50"})
+    check_error({"window": 1})
+
+
+def test_python_restart_warm():
+    client.load(
+        'restart',
+        name=client.app_name,
+        module="warmup",
+        processes=2,
+    )
+
+    assert 'success' in client.conf(
+        {"warmup": ["/warm?a=1", "/ready"]},
+        f'applications/{client.app_name}/warm_restart',
+    ), 'configure warm restart'
+
+    pids = pids_for_process()
+    assert len(pids) == 2, 'warm restart 2 started'
+
+    assert client.get()['body'].endswith(' /'), 'cold process'
+
+    assert 'success' in client.conf_get(
+        f'/control/applications/{client.app_name}/restart'
+    ), 'restart processes'
+
+    new_pids = pids_for_process()
+    assert len(new_pids) == 2, 'warm restart still 2'
+    assert len(new_pids.intersection(pids)) == 0, 'warm restart all new'
+
+    pid, uris = client.get()['body'].split(' ')
+    assert pid in new_pids, 'served by new generation'
+    uris = uris.split(',')
+    assert sorted(uris[:2]) == ['/ready', '/warm?a=1'], 'warmed up'
+    assert uris[2:] == ['/'], 'warmed up before serving'
+
+
+def test_python_restart_warm_target():
+    client.load(
+        'restart',
+        name=client.app_name,
+        module="warmup",
+        processes=1,
+    )
+
+    assert 'success' in client.conf(
+        {
+            "warmup": ["/target"],
+            "host": "example.com",
+            "address": "127.0.0.1:8080",
+        },
+        f'applications/{client.app_name}/warm_restart',
+    ), 'configure warm restart'
+
+    assert 'success' in client.conf_get(
+        f'/control/applications/{client.app_name}/restart'
+    ), 'restart processes'
+
+    uris = client.get()['body'].split(' ')[1].split(',')
+    assert uris[0] == '/target=example.com:8080', 'warmup target'
+
+
+def test_python_restart_warm_drain():
+    client.load(
+        'restart',
+        name=client.app_name,
+        module="warmup",
+        processes=1,
+    )
+
+    assert 'success' in client.conf(
+        {}, f'applications/{client.app_name}/warm_restart'
+    ), 'configure warm restart'
+
+    pids = pids_for_process()
+    assert len(pids) == 1, 'warm restart 1 started'
+
+    sock = client.get(
+        url='/slow',
+        headers={'Host': 'localhost', 'Connection': 'close'},
+        no_recv=True,
+    )
+
+    time.sleep(0.5)
+
+    assert 'success' in client.conf_get(
+        f'/control/applications/{client.app_name}/restart'
+    ), 'restart processes'
+
+    pid = client.get()['body'].split(' ')[0]
+    assert pid not in pids, 'served by new generation'
+
+    resp = client.recvall(sock).decode()
+    sock.close()
+
+    assert resp.startswith('HTTP/1.1 200'), 'in-flight request drained'
+    assert resp.split('\r\n\r\n')[1].split(' ')[0] in pids, 'old process'
+
+    time.sleep(0.5)
+
+    assert pids_for_process() == {pid}, 'old generation stopped'
+
+
+def test_python_restart_warm_invalid():
+    path = f'applications/{client.app_name}/warm_restart'
+
+    assert 'error' in client.conf({"warmup": ["warm"]}, path)
+    assert 'error' in client.conf({"warmup": ["/a b"]}, path)
+    assert 'error' in client.conf({"warmup": "/"}, path)
+    assert 'error' in client.conf({"timeout": 0}, path)
+    assert 'error' in client.conf({"delay": 1}, path)
+    assert 'error' in client.conf({"address": "localhost:80"}, path)
+    assert 'error' in client.conf({"host": 1}, path)
+
+
 def test_python_reconfigure():
     conf_proc({"spare": 2, "max": 6, "idle_timeout": 1})
 
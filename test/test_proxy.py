@@ -1,5 +1,6 @@
 import re
 import socket
+import threading
 import time
 
 import pytest
@@ -13,6 +14,7 @@ prerequisites = {'modules': {'python': 'any'}}
 
 client = ApplicationPython()
 SERVER_PORT = 7999
+KEEPALIVE_PORT = 7998
 
 
 @pytest.fixture(autouse=True)
@@ -94,6 +96,61 @@ Content-Length: 10
         connection.close()
 
 
+def run_keepalive_server(server_port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+
+    sock.bind(('', server_port))
+    sock.listen(5)
+
+    lock = threading.Lock()
+    conns = [0]
+
+    def serve(connection):
+        data = b''
+        requests = 0
+
+        while True:
+            while b'\r\n\r\n' not in data:
+                part = connection.recv(4096)
+                if not part:
+                    connection.close()
+                    return
+                data += part
+
+            header, data = data.split(b'\r\n\r\n', 1)
+            requests += 1
+
+            if requests > 2:
+                # Imitates an upstream closing an idle connection.
+                connection.close()
+                return
+
+            if requests == 1:
+                with lock:
+                    conns[0] += 1
+                    body = str(conns[0]).encode()
+
+            fields = b''
+
+            if b'X-Close' in header:
+                fields = b'Connection: keep-alive, close\r\n'
+
+            connection.sendall(
+                b'HTTP/1.1 200 OK\r\nContent-Length: '
+                + str(len(body)).encode()
+                + b'\r\n'
+                + fields
+                + b'\r\n'
+                + body
+            )
+
+    while True:
+        connection, _ = sock.accept()
+
+        threading.Thread(target=serve, args=(connection,), daemon=True).start()
+
+
 def get_http10(*args, **kwargs):
     return client.get(*args, http_10=True, **kwargs)
 
@@ -456,6 +513,73 @@ def test_proxy_content_length():
     assert len(resp['body']) == 10, 'body gt Content-Length 15'
 
 
+def test_proxy_keepalive():
+    run_process(run_keepalive_server, KEEPALIVE_PORT)
+    waitforsocket(KEEPALIVE_PORT)
+
+    assert 'success' in client.conf(
+        [{"action": {"proxy": f'http://127.0.0.1:{KEEPALIVE_PORT}'}}],
+        'routes',
+    ), 'proxy backend configure'
+
+    def conn_id(headers=None):
+        if headers is None:
+            headers = {'Host': 'localhost', 'Connection': 'close'}
+
+        resp = client.get(headers=headers)
+        assert resp['status'] == 200, 'status'
+        return resp['body']
+
+    assert conn_id() == '1', 'first connection'
+    assert conn_id() == '1', 'connection reused'
+    assert conn_id() == '2', 'closed connection retried'
+    assert conn_id() == '2', 'new connection reused'
+
+    assert 'success' in client.conf(
+        {"http": {"proxy_keepalive": {"max_requests": 1}}}, 'settings'
+    )
+
+    assert conn_id() == '3', 'max_requests'
+    assert conn_id() == '4', 'max_requests 2'
+
+    assert 'success' in client.conf(
+        {"http": {"proxy_keepalive": {"max_idle": 0}}}, 'settings'
+    )
+
+    assert conn_id() == '5', 'keepalive disabled'
+    assert conn_id() == '6', 'keepalive disabled 2'
+
+    assert 'success' in client.conf(
+        {"http": {"proxy_keepalive": {"idle_timeout": 1}}}, 'settings'
+    )
+
+    assert conn_id() == '7', 'idle_timeout'
+
+    time.sleep(2)
+
+    assert conn_id() == '8', 'idle_timeout expired'
+
+    time.sleep(2)
+
+    assert (
+        conn_id({'Host': 'localhost', 'X-Close': '1', 'Connection': 'close'})
+        == '9'
+    ), 'connection close'
+    assert conn_id() == '10', 'connection close precedence'
+
+
+def test_proxy_keepalive_invalid():
+    def check_keepalive(conf):
+        assert 'error' in client.conf(
+            {"http": {"proxy_keepalive": conf}}, 'settings'
+        ), 'proxy keepalive invalid'
+
+    check_keepalive({"max_idle": -1})
+    check_keepalive({"max_requests": -1})
+    check_keepalive({"idle_timeout": "1s"})
+    check_keepalive({"blah": 1})
+
+
 def test_proxy_invalid():
     def check_proxy(proxy):
         assert 'error' in client.conf(
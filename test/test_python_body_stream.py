@@ -0,0 +1,230 @@
+import socket
+import time
+
+from unit.applications.lang.python import ApplicationPython
+from unit.option import option
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+
+def load(name, **kwargs):
+    client.load(name, **kwargs)
+
+    assert 'success' in client.conf(
+        {'http': {'body_stream': True, 'body_buffer_size': 1024}}, 'settings'
+    )
+
+
+def test_python_body_stream():
+    load('mirror')
+
+    body = '0123456789' * 100000
+
+    assert client.post(body=body)['body'] == body, 'body'
+    assert client.post(body='0123')['body'] == '0123', 'small body'
+
+    (resp, sock) = client.post(
+        body=body,
+        headers={'Host': 'localhost', 'Connection': 'keep-alive'},
+        start=True,
+        read_timeout=1,
+    )
+    assert resp['body'] == body, 'keep-alive body'
+
+    resp = client.post(body=body, sock=sock)
+    assert resp['body'] == body, 'keep-alive body 2'
+
+
+def test_python_body_stream_asgi():
+    load('mirror', module='asgi')
+
+    body = '0123456789' * 100000
+
+    assert client.post(body=body)['body'] == body, 'body'
+
+
+def test_python_body_stream_flow_control():
+    load('input_read_delay')
+
+    size = 64 * 1024 * 1024
+
+    assert 'success' in client.conf(
+        {
+            'body_stream': True,
+            'body_buffer_size': 65536,
+            'max_body_size': size,
+        },
+        'settings/http',
+    )
+    data = b'0' * 65536
+
+    sock = socket.create_connection(('127.0.0.1', 8080))
+    sock.sendall(
+        f"""POST / HTTP/1.1\r
+Host: localhost\r
+Content-Length: {size}\r
+X-Delay: 2\r
+Connection: close\r
+\r
+""".encode()
+    )
+
+    sent = 0
+    sock.settimeout(1)
+
+    try:
+        while sent < size:
+            sent += sock.send(data[: size - sent])
+
+    except socket.timeout:
+        pass
+
+    assert sent < size, 'paused'
+
+    sock.settimeout(None)
+
+    while sent < size:
+        sent += sock.send(data[: size - sent])
+
+    resp = client.recvall(sock, read_timeout=10).decode()
+    sock.close()
+
+    assert resp.startswith('HTTP/1.1 200 OK'), 'status'
+    assert f'X-Length: {size}' in resp, 'length'
+
+
+def test_python_body_stream_timeout():
+    load('mirror', limits={"timeout": 1})
+
+    sock = socket.create_connection(('127.0.0.1', 8080))
+    sock.sendall(
+        b"""POST / HTTP/1.1\r
+Host: localhost\r
+Content-Length: 3072\r
+Connection: close\r
+\r
+"""
+    )
+
+    for _ in range(3):
+        sock.sendall(b'0' * 1024)
+        time.sleep(0.7)
+
+    resp = client.recvall(sock, read_timeout=5).decode()
+    sock.close()
+
+    assert resp.startswith('HTTP/1.1 200 OK'), 'timeout after body'
+    assert resp.endswith('0' * 3072), 'body'
+
+
+def test_python_body_stream_readline():
+    load('input_readline')
+
+    body = '0123456789\n' * 1000 + 'last line'
+
+    resp = client.post(body=body)
+    assert resp['body'] == body, 'readline'
+    assert resp['headers']['X-Lines-Count'] == '1001', 'readline lines'
+
+
+def test_python_body_stream_early_response():
+    load('input_read_length')
+
+    sock = client.http(
+        b"""POST / HTTP/1.1
+Host: localhost
+Content-Length: 100000
+Input-Length: 10
+
+0123456789""",
+        start=True,
+        no_recv=True,
+        raw=True,
+    )
+
+    resp = client.recvall(sock, read_timeout=5).decode()
+    sock.close()
+
+    assert resp.startswith('HTTP/1.1 200 OK'), 'early response'
+    assert resp.endswith('0123456789'), 'early response body'
+
+
+def test_python_body_stream_incomplete(wait_for_record):
+    load('input_read_length')
+
+    sock = socket.create_connection(('127.0.0.1', 8080))
+    sock.sendall(
+        b"""POST / HTTP/1.1\r
+Host: localhost\r
+Content-Length: 100000\r
+Input-Length: 20000\r
+\r
+0123456789"""
+    )
+    sock.close()
+
+    assert (
+        wait_for_record(r'request body is incomplete') is not None
+    ), 'incomplete'
+
+    resp = client.post(
+        headers={
+            'Host': 'localhost',
+            'Input-Length': '5',
+            'Connection': 'close',
+        },
+        body='01234',
+    )
+    assert resp['body'] == '01234', 'next request'
+
+
+def test_python_body_stream_not_application():
+    client.load('mirror')
+
+    assert 'success' in client.conf(
+        {
+            "settings": {
+                "http": {"body_stream": True, "body_buffer_size": 1024}
+            },
+            "listeners": {
+                "*:8080": {"pass": "routes"},
+                "*:8081": {"pass": "applications/mirror"},
+            },
+            "routes": [
+                {
+                    "match": {"uri": "/return"},
+                    "action": {"return": 200},
+                },
+                {"action": {"proxy": "http://127.0.0.1:8081"}},
+            ],
+            "applications": {
+                "mirror": {
+                    "type": client.get_application_type(),
+                    "processes": {"spare": 0},
+                    "path": f'{option.test_dir}/python/mirror',
+                    "working_directory": f'{option.test_dir}/python/mirror',
+                    "module": "wsgi",
+                }
+            },
+        }
+    )
+
+    body = '0123456789' * 10000
+
+    (resp, sock) = client.post(
+        url='/return',
+        body=body,
+        headers={'Host': 'localhost', 'Connection': 'keep-alive'},
+        start=True,
+        read_timeout=1,
+    )
+    assert resp['status'] == 200, 'return'
+
+    resp = client.post(body=body, sock=sock)
+    assert resp['body'] == body, 'proxy'
+
+
+def test_python_body_stream_invalid():
+    assert 'error' in client.conf('"yes"', 'settings/http/body_stream')
@@ -0,0 +1,79 @@
+import pytest
+
+from unit.applications.proto import ApplicationProto
+
+client = ApplicationProto()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(system, skip_fds_check):
+    if system != 'Linux':
+        pytest.skip('requires /proc/net/tcp')
+
+    # New router threads keep their engine descriptors.
+
+    skip_fds_check(router=True)
+
+
+def listen_sockets(port=8080):
+    local = f':{port:04X}'
+    count = 0
+
+    with open('/proc/net/tcp', encoding='utf-8') as f:
+        for line in f.readlines()[1:]:
+            fields = line.split()
+
+            if fields[1].endswith(local) and fields[3] == '0A':
+                count += 1
+
+    return count
+
+
+def set_listener(reuseport, threads=4):
+    listener = {"pass": "routes"}
+
+    if reuseport is not None:
+        listener['reuseport'] = reuseport
+
+    return client.conf(
+        {
+            "settings": {"listen_threads": threads},
+            "listeners": {"*:8080": listener},
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        }
+    )
+
+
+def test_reuseport():
+    assert 'success' in set_listener(True)
+    assert listen_sockets() == 4, 'sockets'
+
+    for _ in range(20):
+        assert client.get()['status'] == 200, 'request'
+
+
+def test_reuseport_disabled():
+    assert 'success' in set_listener(None)
+    assert listen_sockets() == 1, 'default'
+
+    assert 'success' in set_listener(False, 2)
+    assert listen_sockets() == 1, 'false'
+
+
+def test_reuseport_threads():
+    assert 'success' in set_listener(True)
+    assert listen_sockets() == 4, 'sockets'
+
+    assert 'success' in set_listener(True, 2)
+    assert listen_sockets() == 2, 'threads decrease'
+    assert client.get()['status'] == 200, 'request'
+
+    assert 'success' in set_listener(True, 3)
+    assert listen_sockets() == 3, 'threads increase'
+    assert client.get()['status'] == 200, 'request increase'
+
+
+def test_reuseport_invalid():
+    assert 'error' in set_listener('yes')
+    assert 'error' in set_listener(1)
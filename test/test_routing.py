@@ -707,6 +707,73 @@ def test_routes_match_empty_array():
     assert client.get(url='/blah')['status'] == 200, 'empty array'
 
 
+def test_routes_index():
+    def req(url='/', host='localhost', method='GET'):
+        return client.http(
+            method,
+            url=url,
+            headers={'Host': host, 'Connection': 'close'},
+        )['status']
+
+    assert 'success' in client.conf(
+        [
+            {"match": {"uri": "/first"}, "action": {"return": 200}},
+            {
+                "match": {"host": "a.com", "uri": "/a"},
+                "action": {"return": 201},
+            },
+            {"match": {"host": "a.com"}, "action": {"return": 202}},
+            {"match": {"uri": "/b/c*"}, "action": {"return": 203}},
+            {"match": {"uri": "/b*"}, "action": {"return": 204}},
+            {
+                "match": {"uri": ["/m", "/m*"], "method": ["POST", "PUT"]},
+                "action": {"return": 205},
+            },
+            {"match": {"uri": "/m"}, "action": {"return": 206}},
+            {"match": {"host": "*.b.com"}, "action": {"return": 207}},
+            {"match": {"host": ["b.com", "c.com"]}, "action": {"return": 208}},
+            {"match": {"uri": "*x"}, "action": {"return": 209}},
+            {"match": {"uri": []}, "action": {"return": 210}},
+        ],
+        'routes',
+    ), 'index configure'
+
+    assert req('/first', 'a.com') == 200, 'first step'
+    assert req('/a', 'a.com') == 201, 'host uri'
+    assert req('/b', 'a.com') == 202, 'host before uri'
+    assert req('/b/c/d') == 203, 'uri prefix'
+    assert req('/b/d') == 204, 'uri short prefix'
+    assert req('/m', method='POST') == 205, 'method'
+    assert req('/mm', method='PUT') == 205, 'method prefix'
+    assert req('/m', method='DELETE') == 206, 'method mismatch'
+    assert req('/mm') == 210, 'method uri mismatch'
+    assert req('/y', 'x.b.com') == 207, 'host wildcard'
+    assert req('/y', 'c.com') == 208, 'host array'
+    assert req('/x', 'c.com') == 208, 'host array before uri'
+    assert req('/x') == 209, 'uri suffix'
+    assert req('/y', 'b.org') == 210, 'empty array'
+
+    assert 'success' in client.conf(
+        {"match": {"uri": "/m"}, "action": {"return": 211}},
+        'routes/0',
+    ), 'index edit'
+
+    assert req('/m', method='POST') == 211, 'edited'
+    assert req('/first') == 210, 'edited first'
+
+    steps = [
+        {"match": {"host": f'h{i}.com'}, "action": {"return": 200 + i}}
+        for i in range(50)
+    ]
+    steps.append({"action": {"return": 299}})
+
+    assert 'success' in client.conf(steps, 'routes'), 'index hosts'
+
+    assert req(host='h0.com') == 200, 'hosts first'
+    assert req(host='h49.com') == 249, 'hosts last'
+    assert req(host='h50.com') == 299, 'hosts fallback'
+
+
 def test_routes_reconfigure():
     assert 'success' in client.conf([], 'routes'), 'redefine'
     assert client.get()['status'] == 404, 'redefine request'
@@ -0,0 +1,86 @@
+from unit.applications.lang.python import ApplicationPython
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+SEGMENT_SIZE = 1024 * 1024
+
+
+def shm_status(name):
+    return client.conf_get(f'/status/applications/{name}/shared_memory')
+
+
+def test_shm_segment_size():
+    client.load('mirror', shm_segment_size=SEGMENT_SIZE)
+
+    body = '0123456789' * 300000
+
+    resp = client.post(body=body)
+    assert resp['status'] == 200, 'status'
+    assert resp['body'] == body, 'body larger than a segment'
+
+    status = shm_status('mirror')
+    assert status['segments'] >= 2, 'segments'
+    assert status['size'] <= status['segments'] * SEGMENT_SIZE, 'size'
+    assert status['used'] <= status['size'], 'used'
+
+
+def test_shm_segment_size_response():
+    client.load('body_generate', shm_segment_size=SEGMENT_SIZE)
+
+    length = 3 * SEGMENT_SIZE
+
+    resp = client.get(
+        headers={
+            'Host': 'localhost',
+            'X-Length': str(length),
+            'Connection': 'close',
+        }
+    )
+    assert resp['status'] == 200, 'status'
+    assert len(resp['body']) == length, 'response larger than a segment'
+
+
+def test_shm_huge_pages():
+    client.load(
+        'mirror',
+        shm_segment_size=2 * SEGMENT_SIZE,
+        shm_huge_pages=True,
+    )
+
+    body = '0123456789' * 300000
+
+    # Without reserved huge pages the segments use regular pages.
+
+    assert client.post(body=body)['body'] == body, 'body'
+    assert client.post(body='0123')['body'] == '0123', 'small body'
+
+    assert shm_status('mirror')['segments'] >= 1, 'segments'
+
+
+def test_shm_status_idle():
+    client.load('empty')
+
+    assert shm_status('empty') == {'segments': 0, 'size': 0, 'used': 0}
+
+    assert client.get()['status'] == 200
+
+    status = shm_status('empty')
+    assert status['segments'] >= 1, 'segments'
+    assert status['size'] > 0, 'size'
+
+
+def test_shm_segment_size_invalid():
+    client.load('empty')
+
+    def check_error(value):
+        assert 'error' in client.conf(
+            value, 'applications/empty/shm_segment_size'
+        )
+
+    check_error('1000')
+    check_error('104857600')
+    check_error('"1M"')
+
+    assert 'error' in client.conf('"yes"', 'applications/empty/shm_huge_pages')
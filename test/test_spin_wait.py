@@ -0,0 +1,95 @@
+import threading
+
+from unit.applications.lang.python import ApplicationPython
+
+prerequisites = {'modules': {'python': 'any'}}
+
+client = ApplicationPython()
+
+
+def polling(name):
+    return client.conf_get(f'/status/applications/{name}/polling')
+
+
+def test_spin_wait():
+    client.load('mirror', processes=2, spin_wait=1000)
+
+    before = polling('mirror')
+    assert before.keys() == {'spins', 'wakeups'}, 'initial'
+
+    for i in range(20):
+        body = f'{i}' * 100
+
+        resp = client.post(body=body)
+        assert resp['status'] == 200, 'status'
+        assert resp['body'] == body, 'body'
+
+    after = polling('mirror')
+    assert (
+        after['spins']
+        + after['wakeups']
+        - before['spins']
+        - before['wakeups']
+        >= 20
+    ), 'receives'
+
+
+def test_spin_wait_concurrent():
+    client.load('mirror', processes=2, spin_wait=200, threads=4)
+
+    errors = []
+
+    def run():
+        for i in range(25):
+            resp = client.post(body=str(i))
+
+            if resp['status'] != 200 or resp['body'] != str(i):
+                errors.append(resp)
+
+    threads = [threading.Thread(target=run) for _ in range(4)]
+
+    for t in threads:
+        t.start()
+
+    for t in threads:
+        t.join()
+
+    assert not errors, 'responses'
+
+    status = polling('mirror')
+    assert status['spins'] + status['wakeups'] >= 100, 'receives'
+
+
+def test_spin_wait_reconfigure():
+    client.load('mirror', processes=2, spin_wait=500)
+
+    assert client.post(body='0123')['body'] == '0123', 'spin'
+
+    assert 'success' in client.conf_delete('applications/mirror/spin_wait')
+
+    assert client.post(body='0123')['body'] == '0123', 'no spin'
+    assert 'error' in polling('mirror'), 'no polling status'
+
+
+def test_spin_wait_disabled():
+    client.load('empty')
+
+    assert client.get()['status'] == 200
+    assert 'error' in polling('empty'), 'no polling status'
+
+    client.load('empty', spin_wait=0)
+
+    assert client.get()['status'] == 200
+    assert 'error' in polling('empty'), 'zero spin_wait'
+
+
+def test_spin_wait_invalid():
+    client.load('empty')
+
+    def check_error(value):
+        assert 'error' in client.conf(value, 'applications/empty/spin_wait')
+
+    check_error('-1')
+    check_error('10001')
+    check_error('"100"')
+    check_error('1.5')
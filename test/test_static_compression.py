@@ -0,0 +1,133 @@
+import gzip
+import os
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import ApplicationProto
+
+client = ApplicationProto()
+
+content = 'compressible ' * 500
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(temp_dir):
+    Path(f'{temp_dir}/assets').mkdir()
+    Path(f'{temp_dir}/assets/file.txt').write_text(content, encoding='utf-8')
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [{"action": {"share": f'{temp_dir}/assets$uri'}}],
+            "applications": {},
+            "settings": {
+                "http": {
+                    "compression": {
+                        "types": ["text/*"],
+                        "compressors": [{"encoding": "gzip"}],
+                    }
+                }
+            },
+        }
+    )
+
+
+def compression_update(conf):
+    assert 'success' in client.conf(
+        conf, 'settings/http/compression'
+    ), 'compression update'
+
+
+def get_gzip(url='/file.txt'):
+    resp = client.get(
+        url=url,
+        headers={
+            'Host': 'localhost',
+            'Accept-Encoding': 'gzip',
+            'Connection': 'close',
+        },
+        encoding='latin-1',
+    )
+
+    assert resp['status'] == 200, 'status'
+    assert resp['headers']['Content-Encoding'] == 'gzip', 'encoding'
+
+    body = resp['body'].encode('latin-1')
+
+    assert int(resp['headers']['Content-Length']) == len(body), 'length'
+
+    return gzip.decompress(body).decode()
+
+
+def test_static_compression_cache():
+    assert get_gzip() == content, 'compressed'
+    assert get_gzip() == content, 'cached'
+
+    resp = client.get(url='/file.txt')
+    assert 'Content-Encoding' not in resp['headers'], 'identity'
+    assert resp['body'] == content, 'identity body'
+
+
+def test_static_compression_cache_modified(temp_dir):
+    assert get_gzip() == content, 'compressed'
+
+    Path(f'{temp_dir}/assets/file.txt').write_text(
+        'modified ' * 100, encoding='utf-8'
+    )
+
+    assert get_gzip() == 'modified ' * 100, 'modified'
+
+
+def test_static_compression_cache_disabled():
+    compression_update(
+        {
+            "types": ["text/*"],
+            "compressors": [{"encoding": "gzip"}],
+            "cache_size": 0,
+        }
+    )
+
+    assert get_gzip() == content, 'compressed'
+    assert get_gzip() == content, 'compressed again'
+
+
+def test_static_compression_precompressed(temp_dir):
+    sidecar = f'{temp_dir}/assets/file.txt.gz'
+
+    Path(sidecar).write_bytes(gzip.compress(b'precompressed'))
+
+    assert get_gzip() == content, 'sidecar disabled'
+
+    compression_update(
+        {
+            "types": ["text/*"],
+            "compressors": [{"encoding": "gzip"}],
+            "precompressed": True,
+        }
+    )
+
+    assert get_gzip() == 'precompressed', 'sidecar'
+
+    past = time.time() - 100
+    os.utime(sidecar, (past, past))
+
+    assert get_gzip() == content, 'sidecar stale'
+
+
+def test_static_compression_invalid():
+    def check_compression(conf):
+        assert 'error' in client.conf(
+            conf, 'settings/http/compression'
+        ), 'invalid compression'
+
+    check_compression(
+        {"compressors": {"encoding": "gzip"}, "cache_size": -1}
+    )
+    check_compression(
+        {"compressors": {"encoding": "gzip"}, "cache_files": "1"}
+    )
+    check_compression(
+        {"compressors": {"encoding": "gzip"}, "precompressed": 1}
+    )
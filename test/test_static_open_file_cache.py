@@ -0,0 +1,142 @@
+import os
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.proto import ApplicationProto
+
+client = ApplicationProto()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(temp_dir):
+    Path(f'{temp_dir}/assets').mkdir()
+    Path(f'{temp_dir}/assets/index.html').write_text(
+        '0123456789', encoding='utf-8'
+    )
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [{"action": {"share": f'{temp_dir}/assets$uri'}}],
+            "applications": {},
+            "settings": {
+                "http": {
+                    "static": {
+                        "open_file_cache": {"max_entries": 16, "valid": 60}
+                    }
+                }
+            },
+        }
+    )
+
+
+def cache_update(conf):
+    assert 'success' in client.conf(
+        conf, 'settings/http/static/open_file_cache'
+    ), 'open_file_cache update'
+
+
+def test_static_open_file_cache(temp_dir):
+    resp = client.get(url='/index.html')
+    assert resp['status'] == 200, 'status'
+    assert resp['body'] == '0123456789', 'body'
+
+    etag = resp['headers']['ETag']
+    last_modified = resp['headers']['Last-Modified']
+
+    os.unlink(f'{temp_dir}/assets/index.html')
+
+    resp = client.get(url='/index.html')
+    assert resp['status'] == 200, 'cached status'
+    assert resp['body'] == '0123456789', 'cached body'
+    assert resp['headers']['ETag'] == etag, 'cached etag'
+    assert resp['headers']['Last-Modified'] == last_modified, 'cached date'
+    assert (
+        resp['headers']['Content-Type'] == 'text/html'
+    ), 'cached content type'
+
+
+def test_static_open_file_cache_valid(temp_dir):
+    cache_update({"max_entries": 16, "valid": 1})
+
+    assert client.get(url='/index.html')['body'] == '0123456789', 'body'
+
+    Path(f'{temp_dir}/assets/index.html').unlink()
+    Path(f'{temp_dir}/assets/index.html').write_text(
+        'modified', encoding='utf-8'
+    )
+
+    assert client.get(url='/index.html')['body'] == '0123456789', 'cached'
+
+    time.sleep(1.5)
+
+    assert client.get(url='/index.html')['body'] == 'modified', 'expired'
+
+
+def test_static_open_file_cache_errors(temp_dir):
+    assert client.get(url='/file')['status'] == 404, 'not found'
+
+    Path(f'{temp_dir}/assets/file').write_text('blah', encoding='utf-8')
+
+    assert client.get(url='/file')['status'] == 404, 'cached error'
+
+    cache_update({"max_entries": 16, "errors": False})
+
+    assert client.get(url='/blah')['status'] == 404, 'not found'
+
+    Path(f'{temp_dir}/assets/blah').write_text('blah', encoding='utf-8')
+
+    assert client.get(url='/blah')['status'] == 200, 'error not cached'
+
+
+def test_static_open_file_cache_min_uses(temp_dir):
+    cache_update({"max_entries": 16, "min_uses": 2})
+
+    assert client.get(url='/index.html')['status'] == 200, 'first use'
+
+    Path(f'{temp_dir}/assets/index.html').write_text('blah', encoding='utf-8')
+
+    assert client.get(url='/index.html')['body'] == 'blah', 'second use'
+
+    Path(f'{temp_dir}/assets/index.html').unlink()
+
+    assert client.get(url='/index.html')['body'] == 'blah', 'cached'
+
+
+def test_static_open_file_cache_max_entries(temp_dir):
+    cache_update({"max_entries": 1})
+
+    Path(f'{temp_dir}/assets/file').write_text('blah', encoding='utf-8')
+
+    assert client.get(url='/index.html')['status'] == 200, 'index'
+    assert client.get(url='/file')['status'] == 200, 'file'
+
+    Path(f'{temp_dir}/assets/index.html').unlink()
+
+    assert client.get(url='/index.html')['status'] == 404, 'evicted'
+
+
+def test_static_open_file_cache_disabled(temp_dir):
+    cache_update({"max_entries": 0})
+
+    assert client.get(url='/index.html')['status'] == 200, 'index'
+
+    Path(f'{temp_dir}/assets/index.html').unlink()
+
+    assert client.get(url='/index.html')['status'] == 404, 'not cached'
+
+
+def test_static_open_file_cache_invalid():
+    def check_cache(conf):
+        assert 'error' in client.conf(
+            conf, 'settings/http/static/open_file_cache'
+        ), 'invalid open_file_cache'
+
+    check_cache({"max_entries": -1})
+    check_cache({"max_entries": "1"})
+    check_cache({"valid": -1})
+    check_cache({"min_uses": 1.5})
+    check_cache({"errors": 1})
+    check_cache({"blah": 1})
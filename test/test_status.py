@@ -152,7 +152,16 @@ def test_status_applications():
         assert apps == expert.sort()
 
     def check_application(name, running, starting, idle, active):
-        assert Status.get(f'/applications/{name}') == {
+        status = Status.get(f'/applications/{name}')
+
+        # Shared memory usage is covered by test_shm_segments.py.
+        assert status.pop('shared_memory').keys() == {
+            'segments',
+            'size',
+            'used',
+        }
+
+        assert status == {
             'processes': {
                 'running': running,
                 'starting': starting,
@@ -232,6 +241,7 @@ def test_status_proxy():
             "applications": {
                 "empty": app_default(),
             },
+            "settings": {"http": {"proxy_keepalive": {"max_idle": 0}}},
         },
     )
 
@@ -240,3 +250,190 @@ def test_status_proxy():
     assert client.get()['status'] == 200
     check_connections(2, 0, 0, 2)
     assert Status.get('/requests/total') == 2, 'proxy'
+
+
+def metrics(before=None):
+    resp = Status.control.get(**Status.control._get_args('/status/metrics'))
+
+    assert resp['status'] == 200, 'metrics status'
+    assert resp['headers']['Content-Type'].startswith(
+        'application/openmetrics-text'
+    ), 'metrics type'
+    assert resp['body'].endswith('# EOF\n'), 'metrics eof'
+
+    samples = {}
+
+    for line in resp['body'].splitlines():
+        if not line.startswith('#'):
+            name, value = line.rsplit(' ', 1)
+            samples[name] = float(value)
+
+    if before is not None:
+        for name in samples:
+            samples[name] -= before.get(name, 0)
+
+    return samples
+
+
+def wait_metrics(before, name, value):
+    for _ in range(50):
+        m = metrics(before)
+
+        if m.get(name) == value:
+            break
+
+        time.sleep(0.1)
+
+    return m
+
+
+def test_status_metrics():
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {"pass": "routes"},
+                "*:8081": {"pass": "applications/mirror"},
+            },
+            "routes": [
+                {
+                    "match": {"uri": "/mirror"},
+                    "action": {"pass": "applications/mirror"},
+                },
+                {"action": {"return": 404}},
+            ],
+            "applications": {"mirror": app_default("mirror")},
+        },
+    )
+
+    before = metrics()
+
+    assert client.post(url='/mirror', body='blah')['status'] == 200
+    assert client.get(url='/blah')['status'] == 404
+    assert client.post(port=8081, body='0123456789')['status'] == 200
+
+    m = wait_metrics(
+        before, 'unit_application_requests_total{application="mirror"}', 2
+    )
+
+    assert m['unit_requests_total'] == 3, 'requests'
+    assert m['unit_listener_requests_total{listener="*:8080"}'] == 2
+    assert m['unit_listener_requests_total{listener="*:8081"}'] == 1
+    assert (
+        m['unit_listener_responses_total{listener="*:8080",code="2xx"}'] == 1
+    ), 'listener 2xx'
+    assert (
+        m['unit_listener_responses_total{listener="*:8080",code="4xx"}'] == 1
+    ), 'listener 4xx'
+    assert m['unit_listener_sent_bytes_total{listener="*:8081"}'] == 10
+    assert m['unit_route_requests_total{route="routes/0"}'] == 1
+    assert (
+        m['unit_route_responses_total{route="routes/1",code="4xx"}'] == 1
+    ), 'route 4xx'
+    assert m['unit_application_requests_total{application="mirror"}'] == 2
+    assert m['unit_application_sent_bytes_total{application="mirror"}'] == 14
+    assert (
+        metrics()[
+            'unit_application_processes{application="mirror",state="running"}'
+        ]
+        == 1
+    ), 'processes'
+
+    histogram = 'unit_listener_request_duration_seconds'
+    listener = 'listener="*:8080"'
+
+    assert m[f'{histogram}_bucket{{{listener},le="+Inf"}}'] == 2
+    assert m[f'{histogram}_count{{{listener}}}'] == 2
+    assert (
+        m[f'{histogram}_bucket{{{listener},le="0.005"}}']
+        <= m[f'{histogram}_bucket{{{listener},le="10.0"}}']
+    ), 'cumulative buckets'
+
+    assert 'success' in client.conf({"return": 204}, 'routes/1/action')
+
+    assert client.get(url='/blah')['status'] == 204
+
+    m = wait_metrics(
+        before, 'unit_route_responses_total{route="routes/1",code="2xx"}', 1
+    )
+
+    assert (
+        m['unit_listener_requests_total{listener="*:8080"}'] == 3
+    ), 'reconfigured'
+
+
+def test_status_metrics_upstream():
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {"pass": "upstreams/one"},
+                "*:8081": {"pass": "applications/empty"},
+            },
+            "upstreams": {"one": {"servers": {"127.0.0.1:8081": {}}}},
+            "applications": {"empty": app_default()},
+        },
+    )
+
+    before = metrics()
+
+    assert client.get()['status'] == 200
+
+    m = wait_metrics(
+        before, 'unit_listener_requests_total{listener="*:8081"}', 1
+    )
+
+    assert m['unit_upstream_requests_total{upstream="one"}'] == 1
+    assert (
+        m['unit_upstream_responses_total{upstream="one",code="2xx"}'] == 1
+    ), 'upstream 2xx'
+
+
+def test_status_metrics_many_steps():
+    names = [c * 1000 for c in 'abcdef']
+
+    routes = {
+        "main": [
+            {
+                "match": {"uri": f'/{k}/*'},
+                "action": {"pass": f'routes/{name}'},
+            }
+            for k, name in enumerate(names)
+        ]
+    }
+
+    for k, name in enumerate(names):
+        routes[name] = [
+            {"match": {"uri": f'/{k}/{i}'}, "action": {"return": 200}}
+            for i in range(20)
+        ]
+
+    assert 'success' in client.conf(
+        {"listeners": {"*:8080": {"pass": "routes/main"}}, "routes": routes}
+    )
+
+    Status.init()
+
+    for k in range(len(names)):
+        for i in range(20):
+            assert client.get(url=f'/{k}/{i}')['status'] == 200
+
+    route = f'unit_route_requests_total{{route="routes/{names[5]}/19"}}'
+
+    m = wait_metrics({}, route, 1)
+
+    assert m[f'unit_route_requests_total{{route="routes/{names[0]}/0"}}'] == 1
+    assert Status.get('/requests/total') == 120, 'status'
+
+    resp = Status.control.get(**Status.control._get_args('/status/metrics'))
+    assert '\0' not in resp['body'], 'metrics nul'
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes/main"}},
+            "routes": {"main": [{"action": {"return": 200}}]},
+        }
+    )
+
+    m = metrics()
+
+    assert route not in m, 'route metric removed'
+    assert 'unit_route_requests_total{route="routes/main/0"}' in m
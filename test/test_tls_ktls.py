@@ -0,0 +1,139 @@
+import hashlib
+import ssl
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.tls import ApplicationTLS
+
+prerequisites = {'modules': {'openssl': 'any'}}
+
+client = ApplicationTLS()
+
+FILE_SIZE = 8 * 1024 * 1024
+
+context = ssl.create_default_context()
+context.check_hostname = False
+context.verify_mode = ssl.CERT_NONE
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture(temp_dir):
+    assets_dir = f'{temp_dir}/assets'
+
+    Path(assets_dir).mkdir()
+    Path(f'{assets_dir}/index.html').write_text(
+        '0123456789', encoding='utf-8'
+    )
+
+    data = b''.join(
+        f'{i:08x}\n'.encode() for i in range(FILE_SIZE // 9 + 1)
+    )[:FILE_SIZE]
+
+    Path(f'{assets_dir}/big').write_bytes(data)
+
+    client.certificate()
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {
+                    "pass": "routes",
+                    "tls": {"certificate": "default"},
+                },
+                "*:8081": {
+                    "pass": "routes",
+                    "tls": {"certificate": "default", "ktls": True},
+                },
+            },
+            "routes": [{"action": {"share": f'{assets_dir}$uri'}}],
+        }
+    )
+
+    return hashlib.sha256(data).hexdigest()
+
+
+def download(port, url='/big'):
+    sock = client.http(
+        f'GET {url} HTTP/1.1\r\nHost: localhost\r\n'
+        'Connection: close\r\n\r\n'.encode(),
+        port=port,
+        raw=True,
+        no_recv=True,
+        wrapper=context.wrap_socket,
+    )
+
+    data = bytearray()
+
+    with sock:
+        while True:
+            part = sock.recv(65536)
+            if not part:
+                break
+
+            data += part
+
+    head, _, body = bytes(data).partition(b'\r\n\r\n')
+
+    return head.decode(), body
+
+
+def test_tls_ktls_static(setup_method_fixture):
+    digest = setup_method_fixture
+
+    for port in [8080, 8081]:
+        head, body = download(port)
+
+        assert head.startswith('HTTP/1.1 200'), 'status'
+        assert f'Content-Length: {FILE_SIZE}' in head, 'content length'
+        assert hashlib.sha256(body).hexdigest() == digest, 'body'
+
+        head, body = download(port, '/index.html')
+
+        assert head.startswith('HTTP/1.1 200'), 'small status'
+        assert body == b'0123456789', 'small body'
+
+
+def test_tls_ktls_head():
+    for port in [8080, 8081]:
+        resp = client.http(
+            'HEAD',
+            url='/big',
+            port=port,
+            wrapper=context.wrap_socket,
+        )
+
+        assert resp['status'] == 200, 'status'
+        assert resp['headers']['Content-Length'] == str(FILE_SIZE), 'length'
+        assert resp['body'] == '', 'body'
+
+
+def test_tls_ktls_validation():
+    assert 'error' in client.conf(
+        '"yes"', 'listeners/*:8081/tls/ktls'
+    ), 'not a boolean'
+    assert 'success' in client.conf(
+        'false', 'listeners/*:8081/tls/ktls'
+    ), 'false'
+
+
+def test_tls_ktls_bench(setup_method_fixture):
+    digest = setup_method_fixture
+    rounds = 10
+
+    def throughput(port):
+        start = time.monotonic()
+
+        for _ in range(rounds):
+            _, body = download(port)
+            assert hashlib.sha256(body).hexdigest() == digest, 'body'
+
+        elapsed = time.monotonic() - start
+
+        return rounds * FILE_SIZE / elapsed / (1024 * 1024)
+
+    plain = throughput(8080)
+    ktls = throughput(8081)
+
+    print(f'\nstatic over TLS: {plain:.1f} MB/s, with ktls: {ktls:.1f} MB/s')
@@ -0,0 +1,238 @@
+import subprocess
+import time
+from pathlib import Path
+
+import pytest
+
+from unit.applications.tls import ApplicationTLS
+
+prerequisites = {'modules': {'openssl': 'any'}}
+
+client = ApplicationTLS()
+
+OCSP_PORT = 7999
+
+
+def openssl(*args):
+    return subprocess.check_output(
+        ['openssl', *args], stderr=subprocess.STDOUT
+    )
+
+
+@pytest.fixture
+def responder(temp_dir):
+    Path(f'{temp_dir}/ca.conf').write_text(
+        f"""[ ca ]
+default_ca = myca
+
+[ myca ]
+new_certs_dir = {temp_dir}
+database = {temp_dir}/certindex
+default_md = sha256
+policy = myca_policy
+serial = {temp_dir}/certserial
+default_days = 1
+x509_extensions = myca_extensions
+copy_extensions = copy
+
+[ myca_policy ]
+commonName = optional
+
+[ myca_extensions ]
+basicConstraints = critical,CA:FALSE
+authorityInfoAccess = OCSP;URI:http://127.0.0.1:{OCSP_PORT}""",
+        encoding='utf-8',
+    )
+    Path(f'{temp_dir}/certserial').write_text('1000', encoding='utf-8')
+    Path(f'{temp_dir}/certindex').touch()
+    Path(f'{temp_dir}/certindex.attr').touch()
+
+    client.certificate('root', False)
+
+    openssl(
+        'req',
+        '-new',
+        '-subj',
+        '/CN=end/',
+        '-config',
+        f'{temp_dir}/openssl.conf',
+        '-out',
+        f'{temp_dir}/end.csr',
+        '-keyout',
+        f'{temp_dir}/end.key',
+    )
+    openssl(
+        'ca',
+        '-batch',
+        '-config',
+        f'{temp_dir}/ca.conf',
+        '-keyfile',
+        f'{temp_dir}/root.key',
+        '-cert',
+        f'{temp_dir}/root.crt',
+        '-in',
+        f'{temp_dir}/end.csr',
+        '-out',
+        f'{temp_dir}/end.crt',
+    )
+
+    Path(f'{temp_dir}/end-root.crt').write_bytes(
+        Path(f'{temp_dir}/end.crt').read_bytes()
+        + Path(f'{temp_dir}/root.crt').read_bytes()
+    )
+
+    assert 'success' in client.certificate_load('end-root', 'end')
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {
+                    "pass": "routes",
+                    "tls": {"certificate": "end-root"},
+                }
+            },
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        }
+    )
+
+    proc = subprocess.Popen(
+        [
+            'openssl',
+            'ocsp',
+            '-index',
+            f'{temp_dir}/certindex',
+            '-port',
+            str(OCSP_PORT),
+            '-rsigner',
+            f'{temp_dir}/root.crt',
+            '-rkey',
+            f'{temp_dir}/root.key',
+            '-CA',
+            f'{temp_dir}/root.crt',
+            '-nmin',
+            '10',
+            '-ignore_err',
+        ],
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE,
+    )
+
+    # Probing the port would stall "openssl ocsp", wait for its banner.
+
+    for line in proc.stderr:
+        if b'waiting for OCSP client connections' in line:
+            break
+
+    yield proc
+
+    proc.terminate()
+    proc.wait()
+
+
+def set_ocsp(ocsp):
+    return client.conf(ocsp, 'listeners/*:8080/tls/ocsp')
+
+
+def status():
+    return subprocess.run(
+        ['openssl', 's_client', '-connect', '127.0.0.1:8080', '-status'],
+        input=b'',
+        stdout=subprocess.PIPE,
+        stderr=subprocess.DEVNULL,
+        timeout=10,
+        check=False,
+    ).stdout.decode()
+
+
+def wait_stapled():
+    for _ in range(50):
+        out = status()
+
+        if 'OCSP Response Status: successful' in out:
+            return out
+
+        time.sleep(0.1)
+
+    return out
+
+
+def test_tls_ocsp_stapling(responder):
+    assert 'no response sent' in status(), 'disabled'
+
+    assert 'success' in set_ocsp({"stapling": True})
+
+    out = wait_stapled()
+    assert 'OCSP Response Status: successful' in out, 'stapled'
+    assert 'Cert Status: good' in out, 'good'
+
+    responder.terminate()
+    responder.wait()
+
+    assert 'success' in client.conf('204', 'routes/0/action/return')
+
+    assert 'Cert Status: good' in status(), 'reconfigure'
+
+    assert 'success' in set_ocsp({"stapling": False})
+
+    assert 'no response sent' in status(), 'stapling false'
+
+
+def test_tls_ocsp_responder(responder):
+    assert 'success' in set_ocsp(
+        {"stapling": True, "responder": 'http://127.0.0.1:7998'}
+    )
+
+    for _ in range(5):
+        assert 'no response sent' in status(), 'responder unavailable'
+
+    assert 'success' in set_ocsp(
+        {"stapling": True, "responder": f'http://127.0.0.1:{OCSP_PORT}/'}
+    )
+
+    assert 'Cert Status: good' in wait_stapled(), 'responder'
+
+
+def test_tls_ocsp_no_issuer():
+    client.certificate()
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {
+                    "pass": "routes",
+                    "tls": {
+                        "certificate": "default",
+                        "ocsp": {"stapling": True},
+                    },
+                }
+            },
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        }
+    )
+
+    assert 'no response sent' in status(), 'no issuer'
+
+
+def test_tls_ocsp_invalid():
+    client.certificate()
+
+    def check_ocsp(ocsp):
+        assert 'error' in client.conf(
+            {
+                "listeners": {
+                    "*:8080": {
+                        "pass": "routes",
+                        "tls": {"certificate": "default", "ocsp": ocsp},
+                    }
+                },
+                "routes": [{"action": {"return": 200}}],
+            }
+        )
+
+    check_ocsp(True)
+    check_ocsp({"stapling": "yes"})
+    check_ocsp({"responder": "https://127.0.0.1"})
+    check_ocsp({"responder": "http://"})
+    check_ocsp({"blah": True})
@@ -48,8 +48,8 @@ def add_session(cache_size=None, timeout=None):
     return client.conf(session, 'listeners/*:8080/tls/session')
 
 
-def connect(ctx=None, session=None):
-    sock = socket.create_connection(('127.0.0.1', 8080))
+def connect(ctx=None, session=None, port=8080):
+    sock = socket.create_connection(('127.0.0.1', port))
 
     if ctx is None:
         ctx = Context(TLSv1_2_METHOD)
@@ -133,6 +133,56 @@ def test_tls_session_timeout():
     assert not reused, 'timeout'
 
 
+@pytest.mark.skipif(
+    not hasattr(_lib, 'SSL_session_reused'),
+    reason='session reuse is not supported',
+)
+def test_tls_session_reconfigure():
+    assert 'success' in add_session(cache_size=8)
+
+    _, sess, ctx, reused = connect()
+    assert not reused, 'new connection'
+
+    assert 'success' in client.conf('204', 'routes/0/action/return')
+
+    _, _, _, reused = connect(ctx, sess)
+    assert reused, 'reconfigure'
+
+    assert 'success' in add_session(cache_size=8, timeout=60)
+
+    _, _, _, reused = connect(ctx, sess)
+    assert reused, 'reconfigure session'
+
+    assert 'success' in add_session()
+
+    _, _, _, reused = connect(ctx, sess)
+    assert not reused, 'reconfigure no cache'
+
+
+@pytest.mark.skipif(
+    not hasattr(_lib, 'SSL_session_reused'),
+    reason='session reuse is not supported',
+)
+def test_tls_session_listeners():
+    assert 'success' in client.conf(
+        {
+            "pass": "routes",
+            "tls": {"certificate": "default", "session": {"cache_size": 8}},
+        },
+        'listeners/*:8081',
+    )
+    assert 'success' in add_session(cache_size=8)
+
+    _, sess, ctx, _ = connect()
+    _, sess2, ctx2, _ = connect(port=8081)
+
+    _, _, _, reused = connect(ctx, sess, port=8081)
+    assert not reused, 'other listener'
+
+    _, _, _, reused = connect(ctx2, sess2, port=8081)
+    assert reused, 'same listener'
+
+
 def test_tls_session_invalid():
     assert 'error' in add_session(cache_size=-1)
     assert 'error' in add_session(cache_size={})
@@ -105,6 +105,23 @@ def test_tls_ticket():
     assert not has_ticket(sess), 'tickets default (false)'
 
 
+@pytest.mark.skipif(
+    not hasattr(_lib, 'SSL_session_reused'),
+    reason='session reuse is not supported',
+)
+def test_tls_ticket_reconfigure():
+    sess, ctx, reused = connect()
+    assert not reused, 'tickets True not reused'
+
+    assert 'success' in client.conf('204', 'routes/0/action/return')
+
+    _, _, reused = connect(ctx, sess)
+    assert reused, 'tickets True reused after reconfiguration'
+
+    _, _, reused = connect(ctx, sess, port=8081)
+    assert not reused, 'tickets True other listener'
+
+
 @pytest.mark.skipif(
     not hasattr(_lib, 'SSL_SESSION_has_ticket'),
     reason='ticket check is not supported',
@@ -0,0 +1,95 @@
+import re
+import subprocess
+from pathlib import Path
+
+import pytest
+from conftest import pid_by_name
+from unit.applications.proto import ApplicationProto
+from unit.option import option
+
+client = ApplicationProto()
+
+
+@pytest.fixture(autouse=True)
+def setup_method_fixture():
+    builddir = f'{option.current_dir}/build'
+
+    for name in ['unit_bench_app', 'unit_bench']:
+        if not Path(f'{builddir}/{name}').is_file():
+            pytest.skip(f'{name} is not built, run "make tests"')
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "applications/bench"}},
+            "applications": {
+                "bench": {
+                    "type": "external",
+                    "processes": 1,
+                    "executable": f'{builddir}/unit_bench_app',
+                }
+            },
+        }
+    )
+
+
+def bench(*args, requests=2000):
+    router_pid = pid_by_name('unit: router')
+
+    result = subprocess.run(
+        [
+            f'{option.current_dir}/build/unit_bench',
+            '-c',
+            '4',
+            '-n',
+            str(requests),
+            '-w',
+            str(requests // 10),
+            '-p',
+            router_pid,
+            *args,
+            '127.0.0.1:8080',
+        ],
+        capture_output=True,
+        text=True,
+        timeout=60,
+        check=False,
+    )
+
+    assert result.returncode == 0, result.stderr
+
+    print(f'\n{result.stdout}')
+
+    stats = dict(re.findall(r'^(.+): ([\d.]+)', result.stdout, re.M))
+
+    for name in [
+        'rps',
+        'latency p50',
+        'latency p99',
+        'app allocations/req',
+        'app syscalls/req',
+        'router syscalls/req',
+    ]:
+        assert name in stats, name
+
+    assert float(stats['latency p50']) <= float(stats['latency p99'])
+
+    return stats
+
+
+def test_unit_bench_app_queue():
+    bench()
+
+
+def test_unit_bench_request_body():
+    stats = bench('-s', '262144', requests=500)
+    assert stats['request body'] == '262144'
+
+
+def test_unit_bench_response_body():
+    stats = bench('-r', '1048576', requests=500)
+    assert stats['response body'] == '1048576'
+
+
+def test_unit_bench_router_traced_syscalls():
+    stats = bench('-t', requests=500)
+    assert float(stats['router traced syscalls/req']) > 0
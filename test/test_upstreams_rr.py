@@ -1,5 +1,6 @@
 import os
 import re
+import time
 
 import pytest
 
@@ -387,6 +388,176 @@ def test_upstreams_rr_bad_server():
     assert sum(resps) == 20, 'bad server sum'
 
 
+def test_upstreams_rr_max_fails():
+    assert 'success' in client.conf(
+        {"max_fails": 1, "fail_timeout": 1},
+        'upstreams/one/servers/127.0.0.1:8084',
+    ), 'configure max_fails'
+
+    resps = get_resps_sc(req=30)
+    assert resps[0] + resps[1] == 29, 'max_fails sum'
+    assert abs(resps[0] - resps[1]) <= 1, 'max_fails'
+
+    server = client.conf_get('/status/upstreams/one/servers/127.0.0.1:8084')
+    assert server == {'state': 'down', 'fails': 1}, 'max_fails status'
+
+    assert client.conf_get(
+        '/status/upstreams/one/servers/127.0.0.1:8081/state'
+    ) == 'up', 'max_fails status up'
+
+    time.sleep(1.1)
+
+    resps = get_resps_sc(req=30)
+    assert resps[0] + resps[1] == 29, 'fail_timeout sum'
+
+
+def test_upstreams_rr_health_check():
+    assert 'success' in client.conf(
+        {"weight": 1}, 'upstreams/one/servers/127.0.0.1:8084'
+    ), 'configure bad server'
+    assert 'success' in client.conf(
+        {"interval": 1, "timeout": 1, "uri": "/health"},
+        'upstreams/one/health_check',
+    ), 'configure health check'
+
+    def unhealthy():
+        return (
+            client.conf_get(
+                '/status/upstreams/one/servers/127.0.0.1:8084/state'
+            )
+            == 'unhealthy'
+        )
+
+    for _ in range(50):
+        if unhealthy():
+            break
+
+        time.sleep(0.1)
+
+    assert unhealthy(), 'health check unhealthy'
+    assert client.conf_get(
+        '/status/upstreams/one/servers/127.0.0.1:8081/state'
+    ) == 'up', 'health check up'
+
+    resps = get_resps_sc(req=30)
+    assert resps[0] == 15, 'health check 0'
+    assert resps[1] == 15, 'health check 1'
+
+    assert 'success' in client.conf(
+        [{"action": {"return": 404}}], 'routes/one'
+    ), 'configure failing server'
+
+    for _ in range(50):
+        if (
+            client.conf_get(
+                '/status/upstreams/one/servers/127.0.0.1:8081/state'
+            )
+            == 'unhealthy'
+        ):
+            break
+
+        time.sleep(0.1)
+
+    resps = get_resps_sc(req=10)
+    assert resps == [0, 10], 'health check failing server'
+
+
+def conf_balancer_delayed(balancer):
+    threads_dir = f'{option.test_dir}/python/threads'
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:8080": {"pass": "upstreams/one"},
+                "*:8081": {"pass": "applications/threads"},
+                "*:8082": {"pass": "routes"},
+            },
+            "upstreams": {
+                "one": {
+                    "balancer": balancer,
+                    "servers": {
+                        "127.0.0.1:8081": {},
+                        "127.0.0.1:8082": {},
+                    },
+                },
+            },
+            "routes": [{"action": {"return": 201}}],
+            "applications": {
+                "threads": {
+                    "type": client.get_application_type(),
+                    "processes": {"spare": 0},
+                    "path": threads_dir,
+                    "working_directory": threads_dir,
+                    "module": "wsgi",
+                }
+            },
+        },
+    ), 'balancer configuration'
+
+
+def get_delayed(delay, **kwargs):
+    return client.get(
+        headers={
+            'Host': 'localhost',
+            'Content-Length': '0',
+            'X-Delay': str(delay),
+            'Connection': 'close',
+        },
+        **kwargs,
+    )
+
+
+def test_upstreams_rr_least_conn():
+    assert 'success' in client.conf(
+        '"least_conn"', 'upstreams/one/balancer'
+    ), 'least_conn'
+
+    resps = get_resps()
+    assert sum(resps) == 100, 'least_conn sum'
+    assert abs(resps[0] - resps[1]) <= client.cpu_count, 'least_conn idle'
+
+    assert 'success' in client.conf(
+        '0', 'upstreams/one/servers/127.0.0.1:8081/weight'
+    ), 'least_conn zero weight'
+
+    resps = get_resps(req=20)
+    assert resps[0] == 0 and resps[1] == 20, 'least_conn zero weight'
+
+    conf_balancer_delayed('least_conn')
+
+    sock = get_delayed(2, no_recv=True)
+
+    # Make sure the slow request reached the server.
+
+    time.sleep(0.5)
+
+    resps = get_resps(req=10)
+    assert resps[1] >= 10 - (client.cpu_count - 1), 'least_conn busy'
+
+    assert 'HTTP/1.1 200' in client.recvall(sock).decode(), 'slow'
+    sock.close()
+
+
+def test_upstreams_rr_peak_ewma():
+    assert 'success' in client.conf(
+        '"peak_ewma"', 'upstreams/one/balancer'
+    ), 'peak_ewma'
+
+    resps = get_resps()
+    assert sum(resps) == 100, 'peak_ewma sum'
+    assert resps[0] > 0 and resps[1] > 0, 'peak_ewma both'
+
+    conf_balancer_delayed('peak_ewma')
+
+    # Requests go to the fast server until the slow one is measured.
+
+    for _ in range(20):
+        if get_delayed(0.5)['status'] == 200:
+            break
+
+    resps = get_resps(req=10)
+    assert resps[1] >= 10 - (client.cpu_count - 1), 'peak_ewma slow'
+
+
 def test_upstreams_rr_pipeline():
     resps = get_resps_sc()
 
@@ -491,3 +662,32 @@ def test_upstreams_rr_invalid():
     check_weight('.01234567890123')
     check_weight('1000001')
     check_weight('2e6')
+
+    def check_option(value, option):
+        assert 'error' in client.conf(
+            value, f'upstreams/one/servers/127.0.0.1:8081/{option}'
+        ), f'invalid {option} option'
+
+    check_option('-1', 'max_fails')
+    check_option('"1"', 'max_fails')
+    check_option('0', 'fail_timeout')
+    check_option('1.5', 'fail_timeout')
+
+    def check_health_check(health_check):
+        assert 'error' in client.conf(
+            health_check, 'upstreams/one/health_check'
+        ), 'invalid health_check'
+
+    check_health_check([])
+    check_health_check({"interval": 0})
+    check_health_check({"timeout": -1})
+    check_health_check({"uri": "health"})
+    check_health_check({"uri": "/ HTTP/1.1"})
+    check_health_check({"blah": 1})
+
+    assert 'error' in client.conf(
+        '"random"', 'upstreams/one/balancer'
+    ), 'invalid balancer'
+    assert 'error' in client.conf(
+        '1', 'upstreams/one/balancer'
+    ), 'invalid balancer type'
@@ -25,6 +25,9 @@ class ApplicationProto(Control):
                     'isolation',
                     'processes',
                     'threads',
+                    'shm_segment_size',
+                    'shm_huge_pages',
+                    'spin_wait',
                 ]:
                     if key in kwargs:
                         app_conf[key] = kwargs[key]